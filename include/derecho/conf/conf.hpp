@@ -40,14 +40,40 @@ public:
     static constexpr const char* DERECHO_HEARTBEAT_MS = "DERECHO/heartbeat_ms";
     static constexpr const char* DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS = "DERECHO/p2p_loop_busy_wait_before_sleep_ms";
     static constexpr const char* DERECHO_SST_POLL_CQ_TIMEOUT_MS = "DERECHO/sst_poll_cq_timeout_ms";
+    static constexpr const char* DERECHO_COMPLETION_WAIT_STRATEGY = "DERECHO/completion_wait_strategy";
+    static constexpr const char* DERECHO_COMPLETION_SPIN_US = "DERECHO/completion_spin_us";
+    static constexpr const char* DERECHO_SHARED_COMPLETION_POLLER = "DERECHO/shared_completion_poller";
+    static constexpr const char* DERECHO_SST_POLLER_CPU = "DERECHO/sst_poller_cpu";
+    static constexpr const char* DERECHO_RDMC_POLLER_CPU = "DERECHO/rdmc_poller_cpu";
+    static constexpr const char* DERECHO_RDMC_PIPELINE_DEPTH = "DERECHO/rdmc_pipeline_depth";
+    static constexpr const char* DERECHO_RDMC_RACK_MAP = "DERECHO/rdmc_rack_map";
+    static constexpr const char* DERECHO_RDMC_RACK_UPLINK_CAPACITY = "DERECHO/rdmc_rack_uplink_capacity";
+    static constexpr const char* DERECHO_RDMC_BLOCK_SIZE_POLICY = "DERECHO/rdmc_block_size_policy";
+    static constexpr const char* DERECHO_RDMC_BLOCK_OVERHEAD_BYTES = "DERECHO/rdmc_block_overhead_bytes";
+    static constexpr const char* DERECHO_REGISTRATION_CACHE_ENTRIES = "DERECHO/registration_cache_entries";
+    static constexpr const char* DERECHO_REGISTERED_MEMORY_PAGES = "DERECHO/registered_memory_pages";
+    static constexpr const char* DERECHO_REGISTERED_MEMORY_NUMA_NODE = "DERECHO/registered_memory_numa_node";
+    static constexpr const char* DERECHO_SMC_DATAGRAM_MULTICAST = "DERECHO/smc_datagram_multicast";
+    static constexpr const char* DERECHO_SMC_DATAGRAM_GROUP = "DERECHO/smc_datagram_group";
+    static constexpr const char* DERECHO_SMC_DATAGRAM_PORT = "DERECHO/smc_datagram_port";
+    static constexpr const char* DERECHO_SMC_DATAGRAM_MAX_SIZE = "DERECHO/smc_datagram_max_size";
+    static constexpr const char* DERECHO_SMC_DATAGRAM_REPAIR_MS = "DERECHO/smc_datagram_repair_ms";
+    static constexpr const char* DERECHO_SMC_DATAGRAM_DEPLOYMENT_ID = "DERECHO/smc_datagram_deployment_id";
     static constexpr const char* DERECHO_RESTART_TIMEOUT_MS = "DERECHO/restart_timeout_ms";
+    static constexpr const char* DERECHO_CONTROL_PLANE_TIMEOUT_MS = "DERECHO/control_plane_timeout_ms";
     static constexpr const char* DERECHO_ENABLE_BACKUP_RESTART_LEADERS = "DERECHO/enable_backup_restart_leaders";
     static constexpr const char* DERECHO_DISABLE_PARTITIONING_SAFETY = "DERECHO/disable_partitioning_safety";
     static constexpr const char* DERECHO_MAX_NODE_ID = "DERECHO/max_node_id";
+    static constexpr const char* DERECHO_STATE_TRANSFER_CHUNK_SIZE = "DERECHO/state_transfer_chunk_size";
+    static constexpr const char* DERECHO_INCREMENTAL_STATE_TRANSFER = "DERECHO/incremental_state_transfer";
 
     static constexpr const char* DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE = "DERECHO/max_p2p_request_payload_size";
     static constexpr const char* DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE = "DERECHO/max_p2p_reply_payload_size";
     static constexpr const char* DERECHO_P2P_WINDOW_SIZE = "DERECHO/p2p_window_size";
+    static constexpr const char* DERECHO_P2P_OVERFLOW_QUEUE_SIZE = "DERECHO/p2p_overflow_queue_size";
+    static constexpr const char* DERECHO_EXTERNAL_P2P_WINDOW_SIZE = "DERECHO/external_p2p_window_size";
+    static constexpr const char* DERECHO_MAX_EXTERNAL_P2P_PAYLOAD_SIZE = "DERECHO/max_external_p2p_payload_size";
+    static constexpr const char* DERECHO_EXTERNAL_PREWARM_CONNECTIONS = "DERECHO/external_prewarm_connections";
 
     static constexpr const char* SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE = "SUBGROUP/DEFAULT/max_payload_size";
     static constexpr const char* SUBGROUP_DEFAULT_MAX_REPLY_PAYLOAD_SIZE = "SUBGROUP/DEFAULT/max_reply_payload_size";
@@ -60,6 +86,8 @@ public:
     static constexpr const char* RDMA_DOMAIN = "RDMA/domain";
     static constexpr const char* RDMA_TX_DEPTH = "RDMA/tx_depth";
     static constexpr const char* RDMA_RX_DEPTH = "RDMA/rx_depth";
+    static constexpr const char* RDMA_DOMAINS = "RDMA/domains";
+    static constexpr const char* RDMA_RAIL_WEIGHTS = "RDMA/rail_weights";
     static constexpr const char* PERS_FILE_PATH = "PERS/file_path";
     static constexpr const char* PERS_RAMDISK_PATH = "PERS/ramdisk_path";
     static constexpr const char* PERS_RESET = "PERS/reset";
@@ -98,13 +126,39 @@ private:
             {SUBGROUP_DEFAULT_RDMC_SEND_ALGORITHM, "binomial_send"},
             {DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS, "250"},
             {DERECHO_SST_POLL_CQ_TIMEOUT_MS, "2000"},
+            {DERECHO_COMPLETION_WAIT_STRATEGY, "spin_then_block"},
+            {DERECHO_COMPLETION_SPIN_US, "50000"},
+            {DERECHO_SHARED_COMPLETION_POLLER, "false"},
+            {DERECHO_SST_POLLER_CPU, "-1"},
+            {DERECHO_RDMC_POLLER_CPU, "-1"},
+            {DERECHO_RDMC_PIPELINE_DEPTH, "4"},
+            {DERECHO_RDMC_RACK_MAP, ""},
+            {DERECHO_RDMC_RACK_UPLINK_CAPACITY, "1"},
+            {DERECHO_RDMC_BLOCK_SIZE_POLICY, "fixed"},
+            {DERECHO_RDMC_BLOCK_OVERHEAD_BYTES, "65536"},
+            {DERECHO_REGISTRATION_CACHE_ENTRIES, "0"},
+            {DERECHO_REGISTERED_MEMORY_PAGES, "transparent"},
+            {DERECHO_REGISTERED_MEMORY_NUMA_NODE, "auto"},
+            {DERECHO_SMC_DATAGRAM_MULTICAST, "false"},
+            {DERECHO_SMC_DATAGRAM_GROUP, "239.255.42.0"},
+            {DERECHO_SMC_DATAGRAM_PORT, "38219"},
+            {DERECHO_SMC_DATAGRAM_MAX_SIZE, "1472"},
+            {DERECHO_SMC_DATAGRAM_REPAIR_MS, "20"},
+            {DERECHO_SMC_DATAGRAM_DEPLOYMENT_ID, "0"},
             {DERECHO_RESTART_TIMEOUT_MS, "2000"},
+            {DERECHO_CONTROL_PLANE_TIMEOUT_MS, "5000"},
             {DERECHO_DISABLE_PARTITIONING_SAFETY, "true"},
             {DERECHO_ENABLE_BACKUP_RESTART_LEADERS, "false"},
             {DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE, "10240"},
             {DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE, "10240"},
             {DERECHO_P2P_WINDOW_SIZE, "16"},
+            {DERECHO_P2P_OVERFLOW_QUEUE_SIZE, "256"},
+            {DERECHO_EXTERNAL_P2P_WINDOW_SIZE, "0"},
+            {DERECHO_MAX_EXTERNAL_P2P_PAYLOAD_SIZE, "0"},
+            {DERECHO_EXTERNAL_PREWARM_CONNECTIONS, "false"},
             {DERECHO_MAX_NODE_ID, "1024"},
+            {DERECHO_STATE_TRANSFER_CHUNK_SIZE, "1048576"},
+            {DERECHO_INCREMENTAL_STATE_TRANSFER, "true"},
             // [SUBGROUP/<subgroupname>]
             {SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE, "10240"},
             {SUBGROUP_DEFAULT_MAX_REPLY_PAYLOAD_SIZE, "10240"},
@@ -117,6 +171,8 @@ private:
             {RDMA_DOMAIN, "eth0"},
             {RDMA_TX_DEPTH, "256"},
             {RDMA_RX_DEPTH, "256"},
+            {RDMA_DOMAINS, ""},
+            {RDMA_RAIL_WEIGHTS, ""},
             // [PERS]
             {PERS_FILE_PATH, ".plog"},
             {PERS_RAMDISK_PATH, "/dev/shm/volatile_t"},
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <derecho/config.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace derecho {
+
+/**
+ * What a CompletionPoller's thread does when none of its completion queues
+ * have any completions ready.
+ */
+enum class CompletionWaitStrategy {
+    /** Keep polling; lowest latency, but uses a whole core at all times. */
+    BUSY_SPIN,
+    /**
+     * Poll for the configured spin time, then block on the completion
+     * queues' wait file descriptors until a completion arrives.
+     */
+    SPIN_THEN_BLOCK,
+    /**
+     * Poll for the configured spin time, then sleep between polls for
+     * exponentially longer intervals, up to 1 ms, until a completion arrives.
+     */
+    ADAPTIVE_BACKOFF
+};
+
+/**
+ * Parses the name of a wait strategy, as used in the configuration file:
+ * "busy_spin", "spin_then_block", or "adaptive_backoff".
+ * @throw std::invalid_argument if the name is not recognized
+ */
+CompletionWaitStrategy parse_completion_wait_strategy(const std::string& name);
+
+/**
+ * A completion queue serviced by a CompletionPoller, described by the
+ * callbacks the poller uses to read it and to wait on it.
+ */
+struct CompletionSource {
+    /** Identifies the source in log messages */
+    std::string name;
+    /**
+     * Reads a batch of completions from the queue and dispatches them.
+     * Called only by the poller's thread.
+     * @return The number of completions handled, or 0 if none were ready
+     */
+    std::function<int()> poll_batch;
+    /**
+     * A file descriptor that becomes readable when completions arrive, or -1
+     * if the queue has no wait object. The poller can only block if every
+     * one of its sources has a wait descriptor.
+     */
+    int wait_fd = -1;
+    /**
+     * Called just before the poller blocks on wait_fd, e.g. to call
+     * fi_trywait. May be empty.
+     * @return True if it is safe to block, false if completions may have
+     * arrived and the queue should be polled again first
+     */
+    std::function<bool()> prepare_to_block;
+};
+
+/**
+ * A thread that polls one or more completion queues and dispatches their
+ * completions to per-queue callbacks, using a configurable strategy to wait
+ * when the queues are idle. The SST and RDMC each register their completion
+ * queue with a poller; depending on the configuration, they share one poller
+ * or each have their own.
+ */
+class CompletionPoller {
+    const std::string thread_name;
+    const CompletionWaitStrategy wait_strategy;
+    std::atomic<uint64_t> spin_time_ns;
+    const int cpu;
+    /** The eventfd that wakes the thread when it is blocked, so it sees source changes and shutdown */
+    int wakeup_fd;
+    int epoll_fd;
+    std::atomic<bool> thread_shutdown;
+
+    /** Sources being serviced by the thread; only accessed by the thread */
+    std::list<std::pair<uint64_t, CompletionSource>> active_sources;
+    /** Sources waiting to be added by the thread */
+    std::list<std::pair<uint64_t, CompletionSource>> added_sources;
+    /** IDs of sources waiting to be removed by the thread */
+    std::vector<uint64_t> removed_source_ids;
+    uint64_t next_source_id;
+    /** Incremented by the thread each time it applies the pending additions and removals */
+    uint64_t changes_applied_count;
+    std::atomic<bool> changes_pending;
+    /** True if every active source has a wait descriptor; only accessed by the thread */
+    bool sources_can_block;
+    std::mutex sources_mutex;
+    std::condition_variable changes_applied_cv;
+    std::thread poll_thread;
+
+    void poll_loop();
+    /** Moves the added and removed sources into or out of active_sources. */
+    void apply_source_changes();
+    /**
+     * Blocks until one of the sources' wait descriptors becomes readable or
+     * the poller is woken up. Must only be called if sources_can_block.
+     * @return False if the poller did not block, because a source was not
+     * ready to block
+     */
+    bool block_on_sources();
+    void wake_up();
+
+public:
+    /**
+     * Creates a poller and starts its thread.
+     * @param thread_name The name to give the poller's thread
+     * @param wait_strategy What to do when the completion queues are idle
+     * @param spin_time The time to keep polling idle queues before blocking
+     * or backing off; ignored by BUSY_SPIN
+     * @param cpu The CPU to pin the thread to, or -1 to leave it unpinned
+     */
+    CompletionPoller(const std::string& thread_name,
+                     CompletionWaitStrategy wait_strategy,
+                     std::chrono::nanoseconds spin_time,
+                     int cpu = -1);
+    /** Stops the poller's thread. */
+    ~CompletionPoller();
+
+    /**
+     * Starts polling a completion queue.
+     * @return An ID that identifies the source to remove_source
+     */
+    uint64_t add_source(CompletionSource source);
+    /**
+     * Stops polling a completion queue. When this returns, the poller's thread
+     * is no longer calling any of the source's callbacks, so the queue can be
+     * closed. Must not be called from one of the source callbacks.
+     */
+    void remove_source(uint64_t source_id);
+    /**
+     * Changes how long the thread polls idle queues before it blocks or backs
+     * off; 0 makes it block as soon as the queues are empty.
+     */
+    void set_spin_time(std::chrono::nanoseconds spin_time);
+};
+
+/**
+ * Returns the completion poller that a subsystem should register its
+ * completion queue with, configured from the DERECHO/completion_* options.
+ * If DERECHO/shared_completion_poller is true, every caller gets the same
+ * poller while any of them still holds it; otherwise each caller gets a new
+ * poller with its own thread. A shared poller is pinned to the CPU requested
+ * by the caller that created it.
+ * @param thread_name The name of the poller's thread, if a new one is created
+ * @param cpu The CPU to pin a new poller's thread to, or -1 for none
+ */
+std::shared_ptr<CompletionPoller> get_completion_poller(const std::string& thread_name, int cpu);
+
+}  // namespace derecho
@@ -6,8 +6,11 @@
 #include "locked_reference.hpp"
 
 #include <cassert>
+#include <condition_variable>
 #include <map>
 #include <mutex>
+#include <optional>
+#include <set>
 
 
 namespace tcp {
@@ -16,13 +19,35 @@ using node_id_t = derecho::node_id_t;
 using ip_addr_t = derecho::ip_addr_t;
 
 class tcp_connections {
+    /** Guards the sockets and socket_mutexes maps and connecting_ids */
     std::mutex sockets_mutex;
 
     node_id_t my_id;
     std::unique_ptr<connection_listener> conn_listener;
     std::map<node_id_t, socket> sockets;
+    /**
+     * One mutex per socket, held while that socket is in use. These are only
+     * acquired while holding sockets_mutex, but get_socket releases
+     * sockets_mutex while the caller uses the socket.
+     */
+    std::map<node_id_t, std::mutex> socket_mutexes;
+    /**
+     * The IDs that add_node is connecting to without holding sockets_mutex.
+     * An ID is reserved here for the duration of the connect, and delete_node
+     * cancels the reservation so that the new socket is discarded.
+     */
+    std::set<node_id_t> connecting_ids;
+    /** Notified when an ID is removed from connecting_ids */
+    std::condition_variable connecting_ids_cv;
     bool add_connection(const node_id_t other_id,
                         const std::pair<ip_addr_t, uint16_t>& other_ip_and_port);
+    /**
+     * Opens an outgoing connection to a node with a lower ID than this node
+     * and checks its ID, without touching the sockets map.
+     * @return The connected socket, or an empty optional on failure
+     */
+    std::optional<socket> connect_to(const node_id_t other_id,
+                                     const std::pair<ip_addr_t, uint16_t>& other_ip_and_port);
 public:
     /**
      * Creates a TCP connection manager with an empty set of connections and
@@ -84,7 +109,10 @@ public:
      * Adds a TCP connection to a new node. If the new node's ID is lower than
      * this node's ID, this function initiates a new TCP connection to it;
      * otherwise, this function listens on a TCP socket and waits for the new
-     * node to make a connection.
+     * node to make a connection. Outgoing connections are made without
+     * holding the lock on the connection map, so several threads can add
+     * different nodes in parallel; callers must not add the same node from
+     * two threads at once.
      * @param new_id The ID of the new node
      * @param new_ip_addr_and_port The IP address and port number of the new node
      * @return True if the TCP connection was set up successfully, false if
@@ -114,6 +142,7 @@ public:
         std::lock_guard<std::mutex> lock(sockets_mutex);
         const auto it = sockets.find(node_id);
         assert(it != sockets.end());
+        std::lock_guard<std::mutex> socket_lock(socket_mutexes[node_id]);
         it->second.exchange(local, remote);
     }
     /**
@@ -138,9 +167,12 @@ public:
     /**
      * Gets a locked reference to the TCP socket connected to a particular node.
      * While the caller holds the locked reference to the socket, no other
-     * tcp_connections methods can be called. This makes it safe to use this
-     * method to access sockets directly, even though they are usually managed
-     * by the other tcp_connections methods.
+     * thread can use that socket, but other threads can use the sockets
+     * connected to other nodes, so transfers to different nodes can proceed
+     * in parallel. The caller must not call any other tcp_connections methods
+     * while holding the reference. This makes it safe to use this method to
+     * access sockets directly, even though they are usually managed by the
+     * other tcp_connections methods.
      * @param node_id The ID of the desired node
      * @return A LockedReference to the TCP socket connected to that node.
      */
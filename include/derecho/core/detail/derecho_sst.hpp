@@ -183,6 +183,14 @@ public:
     /** to check for failures - used by the thread running check_failures_loop in derecho_group **/
     SSTFieldVector<uint64_t> local_stability_frontier;
 
+    /**
+     * For each subgroup, the deployment ID of the datagram multicast this
+     * node has joined to receive the subgroup's SST multicasts, or 0 if it
+     * can't receive them as datagrams. Members only send datagrams once every
+     * member of the shard reports the same deployment ID.
+     */
+    SSTFieldVector<uint64_t> smc_datagram_deployment;
+
     /** to signal a graceful exit */
     SSTField<bool> rip;
     /**
@@ -218,14 +226,15 @@ public:
               slots(slot_size),
               num_received_sst(num_received_size),
               index(index_field_size),
-              local_stability_frontier(num_subgroups) {
+              local_stability_frontier(num_subgroups),
+              smc_datagram_deployment(num_subgroups) {
         SSTInit(seq_num, delivered_num, signatures,
                 persisted_num, signed_num, verified_num,
                 vid, suspected, changes, joiner_ips,
                 joiner_gms_ports, joiner_state_transfer_ports, joiner_sst_ports, joiner_rdmc_ports, joiner_external_ports,
                 num_changes, num_committed, num_acked, num_installed,
                 num_received, wedged, global_min, global_min_ready,
-                slots, num_received_sst, index, local_stability_frontier, rip);
+                slots, num_received_sst, index, local_stability_frontier, smc_datagram_deployment, rip);
         //Once superclass constructor has finished, table entries can be initialized
         for(unsigned int row = 0; row < get_num_rows(); ++row) {
             vid[row] = 0;
@@ -259,6 +268,9 @@ public:
             for(size_t i = 0; i < local_stability_frontier.size(); ++i) {
                 local_stability_frontier[row][i] = current_time_ns;
             }
+            for(size_t i = 0; i < smc_datagram_deployment.size(); ++i) {
+                smc_datagram_deployment[row][i] = 0;
+            }
             rip[row] = false;
         }
     }
@@ -10,7 +10,10 @@ ExternalClientCaller<T, ExternalGroupType>::ExternalClientCaller(subgroup_type_i
           subgroup_id(subgroup_id),
           group_client(group_client),
           wrapped_this(rpc::make_remote_invoker<T>(nid, type_id, subgroup_id,
-                                                   T::register_functions(), *group_client.receivers)) {
+                                                   T::register_functions(), *group_client.receivers)),
+          selection_policy(ReplicaSelectionPolicy::ROUND_ROBIN),
+          routing_mutex(std::make_unique<std::mutex>()),
+          shard_members_vid(-1) {
     this->client_stub_mutex = std::make_unique<std::mutex>();
 }
 
@@ -55,42 +58,7 @@ void ExternalClientCaller<T, ExternalGroupType>::add_p2p_connection(node_id_t de
     if(group_client.p2p_connections->contains_node(dest_node)) {
         return;
     }
-    dbg_default_info("p2p connection to {} is not established yet, establishing right now.", dest_node);
-    int rank = group_client.curr_view->rank_of(dest_node);
-    if(rank == -1) {
-        throw invalid_node_exception("Cannot send a p2p request to node "
-                                     + std::to_string(dest_node) + ": it is not a member of the Group.");
-    }
-    tcp::socket sock(group_client.curr_view->member_ips_and_ports[rank].ip_address,
-                     group_client.curr_view->member_ips_and_ports[rank].gms_port);
-
-    JoinResponse response;
-    uint64_t node_version_hashcode;
-    try {
-        sock.exchange(my_version_hashcode, node_version_hashcode);
-        if(node_version_hashcode != my_version_hashcode) {
-            throw derecho_exception("Unable to connect to Derecho member because the node is running on an incompatible platform or used an incompatible compiler.");
-        }
-        sock.write(JoinRequest{node_id, true});
-        sock.read(response);
-        if(response.code == JoinResponseCode::ID_IN_USE) {
-            dbg_default_error("Error! Derecho member refused connection because ID {} is already in use!", group_client.my_id);
-            dbg_default_flush();
-            throw derecho_exception("Leader rejected join, ID already in use.");
-        }
-        sock.write(ExternalClientRequest::ESTABLISH_P2P);
-        sock.write(getConfUInt16(Conf::DERECHO_EXTERNAL_PORT));
-    } catch(tcp::socket_error&) {
-        throw derecho_exception("Failed to establish P2P connection: socket error while sending join request.");
-    }
-
-    assert(dest_node != node_id);
-    if(!sst::add_external_node(dest_node, {group_client.curr_view->member_ips_and_ports[rank].ip_address,
-                                           group_client.curr_view->member_ips_and_ports[rank].external_port})) {
-        dbg_default_error("Failed to set up a TCP connection to {} on {}:{}", dest_node, group_client.curr_view->member_ips_and_ports[rank].ip_address, group_client.curr_view->member_ips_and_ports[rank].external_port);
-        throw derecho_exception("Failed to establish P2P connection: sst::add_external_node failed");
-    }
-    group_client.p2p_connections->add_connections({dest_node});
+    group_client.establish_p2p_connection(dest_node);
 }
 
 template <typename T, typename ExternalGroupType>
@@ -101,19 +69,372 @@ auto ExternalClientCaller<T, ExternalGroupType>::p2p_send(node_id_t dest_node, A
     uint64_t message_seq_num;
     auto return_pair = wrapped_this->template send<rpc::to_internal_tag<true>(tag)>(
             [this, &dest_node, &message_seq_num](size_t size) -> uint8_t* {
-                const std::size_t max_p2p_request_payload_size = getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE);
-                if(size <= max_p2p_request_payload_size) {
-                    auto buffer_handle = group_client.get_sendbuffer_ptr(dest_node,
-                                                                         sst::MESSAGE_TYPE::P2P_REQUEST);
-                    message_seq_num = buffer_handle.seq_num;
-                    return buffer_handle.buf_ptr;
-                } else {
-                    throw derecho_exception("The size of serialized args exceeds the maximum message size (Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE).");
-                }
+                auto buffer_handle = group_client.get_sendbuffer_ptr(dest_node,
+                                                                     sst::MESSAGE_TYPE::P2P_REQUEST, size);
+                message_seq_num = buffer_handle.seq_num;
+                return buffer_handle.buf_ptr;
             },
             std::forward<Args>(args)...);
     group_client.send_p2p_message(dest_node, subgroup_id, message_seq_num, return_pair.pending);
-    return std::move(*return_pair.results);
+    return std::move(return_pair.results);
+}
+
+template <typename T, typename ExternalGroupType>
+template <rpc::FunctionTag tag, typename... Args>
+auto ExternalClientCaller<T, ExternalGroupType>::try_p2p_send(node_id_t dest_node, Args&&... args) {
+    std::optional<decltype(p2p_send<tag>(dest_node, std::forward<Args>(args)...))> results;
+    add_p2p_connection(dest_node);
+    if(!group_client.p2p_send_has_space(dest_node)) {
+        return results;
+    }
+    results.emplace(p2p_send<tag>(dest_node, std::forward<Args>(args)...));
+    return results;
+}
+
+template <typename T, typename ExternalGroupType>
+void ExternalClientCaller<T, ExternalGroupType>::set_replica_selection_policy(ReplicaSelectionPolicy policy) {
+    std::lock_guard<std::mutex> lock(*routing_mutex);
+    selection_policy = policy;
+}
+
+template <typename T, typename ExternalGroupType>
+node_id_t ExternalClientCaller<T, ExternalGroupType>::choose_replica(uint32_t shard_num, const std::optional<uint64_t>& key) {
+    std::lock_guard<std::mutex> lock(*routing_mutex);
+    const int32_t current_vid = group_client.refresh_shard_layout(subgroup_id, shard_members_vid, shard_members);
+    if(current_vid != shard_members_vid) {
+        next_replica.resize(shard_members.size(), 0);
+        shard_members_vid = current_vid;
+    }
+    const std::vector<node_id_t>& replicas = shard_members.at(shard_num);
+    if(replicas.empty()) {
+        throw derecho_exception("Cannot route a P2P call to shard " + std::to_string(shard_num) + " of subgroup "
+                                + std::to_string(subgroup_id) + ": the shard has no members.");
+    }
+    ReplicaSelectionPolicy policy = selection_policy;
+    uint64_t hint;
+    if(policy == ReplicaSelectionPolicy::KEY_HASH && key) {
+        hint = *key;
+    } else {
+        if(policy == ReplicaSelectionPolicy::KEY_HASH) {
+            policy = ReplicaSelectionPolicy::ROUND_ROBIN;
+        }
+        // The other policies also use the round-robin position, to break ties
+        hint = next_replica[shard_num]++;
+    }
+    return group_client.select_replica(replicas, policy, hint);
+}
+
+template <typename T, typename ExternalGroupType>
+template <rpc::FunctionTag tag, typename... Args>
+auto ExternalClientCaller<T, ExternalGroupType>::routed_p2p_send(uint32_t shard_num, const std::optional<uint64_t>& key, Args&&... args) {
+    node_id_t replica = choose_replica(shard_num, key);
+    std::optional<decltype(p2p_send<tag>(replica, std::forward<Args>(args)...))> results;
+    try {
+        // Don't forward the arguments yet, since they may be needed for a retry
+        results.emplace(p2p_send<tag>(replica, args...));
+    } catch(derecho_exception& ex) {
+        // Nothing has been sent if p2p_send threw, so it is safe to try another member
+        dbg_default_debug("Routed P2P call to node {} failed ({}); refreshing the View and retrying", replica, ex.what());
+        group_client.mark_view_stale();
+        replica = choose_replica(shard_num, key);
+        results.emplace(p2p_send<tag>(replica, std::forward<Args>(args)...));
+    }
+    group_client.record_call_sent(replica);
+    const auto send_time = std::chrono::steady_clock::now();
+    ExternalGroupType* client = &group_client;
+    results->then([client, replica, send_time](auto&) {
+        client->record_call_completed(replica, std::chrono::steady_clock::now() - send_time);
+    });
+    return std::move(*results);
+}
+
+template <typename T, typename ExternalGroupType>
+template <rpc::FunctionTag tag, typename... Args>
+auto ExternalClientCaller<T, ExternalGroupType>::p2p_send_to_shard(uint32_t shard_num, Args&&... args) {
+    return routed_p2p_send<tag>(shard_num, std::nullopt, std::forward<Args>(args)...);
+}
+
+template <typename T, typename ExternalGroupType>
+template <rpc::FunctionTag tag, typename... Args>
+auto ExternalClientCaller<T, ExternalGroupType>::p2p_send_to_shard_by_key(uint32_t shard_num, uint64_t key, Args&&... args) {
+    return routed_p2p_send<tag>(shard_num, key, std::forward<Args>(args)...);
+}
+
+template <typename... ReplicatedTypes>
+int32_t ExternalGroupClient<ReplicatedTypes...>::refresh_shard_layout(subgroup_id_t subgroup_id, int32_t cached_vid,
+                                                                      std::vector<std::vector<node_id_t>>& shard_members) {
+    std::lock_guard<std::mutex> lock(view_refresh_mutex);
+    if(view_is_stale.exchange(false)) {
+        dbg_default_debug("External client {} is refreshing its View, which was reported stale", my_id);
+        if(!update_view()) {
+            dbg_default_warn("External client {} failed to refresh its View; still routing with View {}", my_id, get_current_view()->vid);
+            view_is_stale = true;
+        } else {
+            // Forget the load statistics of members that have left
+            const std::shared_ptr<View> view = get_current_view();
+            std::lock_guard<std::mutex> loads_lock(replica_loads_mutex);
+            for(auto load_iter = replica_loads.begin(); load_iter != replica_loads.end();) {
+                if(view->rank_of(load_iter->first) == -1) {
+                    load_iter = replica_loads.erase(load_iter);
+                } else {
+                    ++load_iter;
+                }
+            }
+        }
+    }
+    const std::shared_ptr<View> view = get_current_view();
+    if(view->vid != cached_vid) {
+        shard_members.clear();
+        for(const SubView& shard_view : view->subgroup_shard_views.at(subgroup_id)) {
+            shard_members.emplace_back(shard_view.members);
+        }
+    }
+    return view->vid;
+}
+
+template <typename... ReplicatedTypes>
+void ExternalGroupClient<ReplicatedTypes...>::mark_view_stale() {
+    view_is_stale = true;
+}
+
+template <typename... ReplicatedTypes>
+node_id_t ExternalGroupClient<ReplicatedTypes...>::select_replica(const std::vector<node_id_t>& replicas,
+                                                                  ReplicaSelectionPolicy policy, uint64_t hint) {
+    const std::size_t num_replicas = replicas.size();
+    switch(policy) {
+        case ReplicaSelectionPolicy::KEY_HASH:
+            // Mix the key (Fibonacci hashing) so that keys with a common stride still spread out
+            return replicas[((hint * 0x9E3779B97F4A7C15ull) >> 32) % num_replicas];
+        case ReplicaSelectionPolicy::LEAST_OUTSTANDING:
+        case ReplicaSelectionPolicy::LATENCY_EWMA: {
+            std::lock_guard<std::mutex> lock(replica_loads_mutex);
+            // Start the scan at the round-robin position, so ties are broken in rotation
+            std::size_t best_index = hint % num_replicas;
+            double best_score = std::numeric_limits<double>::max();
+            for(std::size_t i = 0; i < num_replicas; ++i) {
+                const std::size_t index = (hint + i) % num_replicas;
+                double score;
+                auto load_iter = replica_loads.find(replicas[index]);
+                if(load_iter == replica_loads.end()) {
+                    score = 0;
+                } else if(policy == ReplicaSelectionPolicy::LEAST_OUTSTANDING) {
+                    score = load_iter->second.outstanding;
+                } else if(load_iter->second.latency_samples == 0) {
+                    score = 0;
+                } else {
+                    score = load_iter->second.latency_ewma_us * (load_iter->second.outstanding + 1);
+                }
+                if(score < best_score) {
+                    best_score = score;
+                    best_index = index;
+                }
+            }
+            return replicas[best_index];
+        }
+        case ReplicaSelectionPolicy::ROUND_ROBIN:
+        default:
+            return replicas[hint % num_replicas];
+    }
+}
+
+template <typename... ReplicatedTypes>
+void ExternalGroupClient<ReplicatedTypes...>::record_call_sent(node_id_t replica) {
+    std::lock_guard<std::mutex> lock(replica_loads_mutex);
+    replica_loads[replica].outstanding++;
+}
+
+template <typename... ReplicatedTypes>
+void ExternalGroupClient<ReplicatedTypes...>::record_call_completed(node_id_t replica, std::chrono::nanoseconds latency) {
+    std::lock_guard<std::mutex> lock(replica_loads_mutex);
+    ReplicaLoad& load = replica_loads[replica];
+    if(load.outstanding > 0) {
+        load.outstanding--;
+    }
+    const double latency_us = latency.count() / 1000.0;
+    if(load.latency_samples == 0) {
+        load.latency_ewma_us = latency_us;
+    } else {
+        load.latency_ewma_us = latency_ewma_weight * latency_us + (1 - latency_ewma_weight) * load.latency_ewma_us;
+    }
+    load.latency_samples++;
+}
+
+template <typename... ReplicatedTypes>
+void ExternalGroupClient<ReplicatedTypes...>::establish_p2p_connection(node_id_t dest_node) {
+    const std::shared_ptr<View> view = get_current_view();
+    const int rank = view->rank_of(dest_node);
+    establish_p2p_connection(dest_node, rank == -1 ? std::nullopt
+                                                   : std::make_optional(view->member_ips_and_ports[rank]));
+}
+
+template <typename... ReplicatedTypes>
+void ExternalGroupClient<ReplicatedTypes...>::establish_p2p_connection(node_id_t dest_node,
+                                                                       const std::optional<IpAndPorts>& member_address) {
+    {
+        std::unique_lock<std::mutex> lock(connection_states_mutex);
+        // If another thread is already connecting to this node, wait for it instead of racing it
+        connection_state_changed.wait(lock, [this, dest_node]() {
+            auto state_iter = connection_states.find(dest_node);
+            return state_iter == connection_states.end() || state_iter->second != ConnectionState::CONNECTING;
+        });
+        if(p2p_connections->contains_node(dest_node)) {
+            connection_states[dest_node] = ConnectionState::CONNECTED;
+            return;
+        }
+        connection_states[dest_node] = ConnectionState::CONNECTING;
+    }
+    try {
+        dbg_default_info("p2p connection to {} is not established yet, establishing right now.", dest_node);
+        if(!member_address) {
+            throw invalid_node_exception("Cannot send a p2p request to node "
+                                         + std::to_string(dest_node) + ": it is not a member of the Group.");
+        }
+        tcp::socket sock(member_address->ip_address, member_address->gms_port);
+
+        JoinResponse response;
+        uint64_t node_version_hashcode;
+        try {
+            sock.exchange(my_version_hashcode, node_version_hashcode);
+            if(node_version_hashcode != my_version_hashcode) {
+                throw derecho_exception("Unable to connect to Derecho member because the node is running on an incompatible platform or used an incompatible compiler.");
+            }
+            sock.write(JoinRequest{my_id, true});
+            sock.read(response);
+            if(response.code == JoinResponseCode::ID_IN_USE) {
+                dbg_default_error("Error! Derecho member refused connection because ID {} is already in use!", my_id);
+                dbg_default_flush();
+                throw derecho_exception("Leader rejected join, ID already in use.");
+            }
+            sock.write(ExternalClientRequest::ESTABLISH_P2P);
+            sock.write(getConfUInt16(Conf::DERECHO_EXTERNAL_PORT));
+        } catch(tcp::socket_error&) {
+            throw derecho_exception("Failed to establish P2P connection: socket error while sending join request.");
+        }
+
+        assert(dest_node != my_id);
+        if(!sst::add_external_node(dest_node, {member_address->ip_address, member_address->external_port})) {
+            dbg_default_error("Failed to set up a TCP connection to {} on {}:{}", dest_node, member_address->ip_address, member_address->external_port);
+            throw derecho_exception("Failed to establish P2P connection: sst::add_external_node failed");
+        }
+        p2p_connections->add_connections({dest_node});
+    } catch(...) {
+        std::lock_guard<std::mutex> lock(connection_states_mutex);
+        connection_states[dest_node] = ConnectionState::FAILED;
+        connection_state_changed.notify_all();
+        throw;
+    }
+    std::lock_guard<std::mutex> lock(connection_states_mutex);
+    connection_states[dest_node] = ConnectionState::CONNECTED;
+    connection_state_changed.notify_all();
+}
+
+template <typename... ReplicatedTypes>
+std::vector<node_id_t> ExternalGroupClient<ReplicatedTypes...>::prewarm_connections(const std::vector<node_id_t>& nodes) {
+    // Look up every address before starting the workers, so they never read a View
+    // that another thread could replace, and so nodes may refer into the current View
+    std::vector<std::pair<node_id_t, std::optional<IpAndPorts>>> targets;
+    {
+        const std::shared_ptr<View> view = get_current_view();
+        for(const node_id_t node : nodes) {
+            if(node == my_id) {
+                continue;
+            }
+            const int rank = view->rank_of(node);
+            targets.emplace_back(node, rank == -1 ? std::nullopt
+                                                  : std::make_optional(view->member_ips_and_ports[rank]));
+        }
+    }
+    std::vector<node_id_t> failed_nodes;
+    std::mutex failed_nodes_mutex;
+    std::atomic<std::size_t> next_index{0};
+    // Each worker takes the next node from the list until the list is exhausted
+    auto connect_worker = [&]() {
+        for(std::size_t index = next_index++; index < targets.size(); index = next_index++) {
+            const node_id_t node = targets[index].first;
+            if(p2p_connections->contains_node(node)) {
+                continue;
+            }
+            try {
+                establish_p2p_connection(node, targets[index].second);
+            } catch(std::exception& ex) {
+                dbg_default_warn("Failed to pre-connect to node {}: {}", node, ex.what());
+                std::lock_guard<std::mutex> lock(failed_nodes_mutex);
+                failed_nodes.push_back(node);
+            }
+        }
+    };
+    const std::size_t num_workers = std::min(targets.size(), max_parallel_connects);
+    std::vector<std::thread> workers;
+    for(std::size_t i = 1; i < num_workers; ++i) {
+        workers.emplace_back(connect_worker);
+    }
+    connect_worker();
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+    return failed_nodes;
+}
+
+template <typename... ReplicatedTypes>
+template <typename SubgroupType>
+std::vector<node_id_t> ExternalGroupClient<ReplicatedTypes...>::prewarm_subgroup(uint32_t subgroup_index) {
+    const subgroup_type_id_t subgroup_type_id = get_index_of_type(typeid(SubgroupType));
+    const std::shared_ptr<View> view = get_current_view();
+    const subgroup_id_t subgroup_id = view->subgroup_ids_by_type_id.at(subgroup_type_id).at(subgroup_index);
+    {
+        std::lock_guard<std::mutex> lock(connection_states_mutex);
+        prewarmed_subgroups.insert(subgroup_id);
+    }
+    std::vector<node_id_t> subgroup_members;
+    for(const SubView& shard_view : view->subgroup_shard_views.at(subgroup_id)) {
+        subgroup_members.insert(subgroup_members.end(), shard_view.members.begin(), shard_view.members.end());
+    }
+    return prewarm_connections(subgroup_members);
+}
+
+template <typename... ReplicatedTypes>
+void ExternalGroupClient<ReplicatedTypes...>::reconnect_prewarmed_members() {
+    const std::shared_ptr<View> view = get_current_view();
+    std::vector<node_id_t> members_to_connect;
+    if(prewarm_all_members) {
+        members_to_connect = view->members;
+    } else {
+        std::lock_guard<std::mutex> lock(connection_states_mutex);
+        for(const subgroup_id_t subgroup_id : prewarmed_subgroups) {
+            if(subgroup_id >= view->subgroup_shard_views.size()) {
+                continue;
+            }
+            for(const SubView& shard_view : view->subgroup_shard_views[subgroup_id]) {
+                members_to_connect.insert(members_to_connect.end(), shard_view.members.begin(), shard_view.members.end());
+            }
+        }
+    }
+    if(!members_to_connect.empty()) {
+        prewarm_connections(members_to_connect);
+    }
+}
+
+template <typename... ReplicatedTypes>
+ConnectionState ExternalGroupClient<ReplicatedTypes...>::get_connection_state(node_id_t node_id) {
+    std::lock_guard<std::mutex> lock(connection_states_mutex);
+    auto state_iter = connection_states.find(node_id);
+    if(state_iter == connection_states.end()) {
+        return ConnectionState::NOT_CONNECTED;
+    }
+    return state_iter->second;
+}
+
+template <typename... ReplicatedTypes>
+template <typename SubgroupType>
+bool ExternalGroupClient<ReplicatedTypes...>::subgroup_connections_ready(uint32_t subgroup_index) {
+    for(const std::vector<node_id_t>& shard_members : get_subgroup_members<SubgroupType>(subgroup_index)) {
+        for(const node_id_t member : shard_members) {
+            if(member != my_id && !p2p_connections->contains_node(member)) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
 template <typename... ReplicatedTypes>
@@ -140,10 +461,15 @@ void ExternalGroupClient<ReplicatedTypes...>::initialize_p2p_connections() {
     p2p_connections = std::make_unique<sst::P2PConnectionManager>(sst::P2PParams{
             my_id,
             getConfUInt32(Conf::DERECHO_P2P_WINDOW_SIZE),
+            getConfUInt32(Conf::DERECHO_P2P_OVERFLOW_QUEUE_SIZE),
             view_max_rpc_window_size,
             getConfUInt64(Conf::DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE) + sizeof(header),
             getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE) + sizeof(header),
             view_max_rpc_reply_payload_size + sizeof(header),
+            getConfUInt32(Conf::DERECHO_EXTERNAL_P2P_WINDOW_SIZE),
+            getConfUInt64(Conf::DERECHO_MAX_EXTERNAL_P2P_PAYLOAD_SIZE)
+                    ? getConfUInt64(Conf::DERECHO_MAX_EXTERNAL_P2P_PAYLOAD_SIZE) + sizeof(header)
+                    : 0,
             true,
             NULL});
 }
@@ -152,6 +478,7 @@ template <typename... ReplicatedTypes>
 ExternalGroupClient<ReplicatedTypes...>::ExternalGroupClient()
         : my_id(getConfUInt32(Conf::DERECHO_LOCAL_ID)),
           receivers(new std::decay_t<decltype(*receivers)>()),
+          prewarm_all_members(getConfBoolean(Conf::DERECHO_EXTERNAL_PREWARM_CONNECTIONS)),
           // ExternalGroupClient needs to create the RPC logger since P2PConnectionManager uses it (but there is no RPCManager to create it)
           rpc_logger(LoggerFactory::createIfAbsent(LoggerFactory::RPC_LOGGER_NAME, getConfString(Conf::LOGGER_RPC_LOG_LEVEL))),
           busy_wait_before_sleep_ms(getConfUInt64(Conf::DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS)) {
@@ -171,6 +498,10 @@ ExternalGroupClient<ReplicatedTypes...>::ExternalGroupClient()
     initialize_p2p_connections();
 
     rpc_listener_thread = std::thread(&ExternalGroupClient<ReplicatedTypes...>::p2p_receive_loop, this);
+
+    if(prewarm_all_members) {
+        prewarm_connections(curr_view->members);
+    }
 }
 
 template <typename... ReplicatedTypes>
@@ -188,6 +519,7 @@ ExternalGroupClient<ReplicatedTypes...>::ExternalGroupClient(
 #else
           factories(make_kind_map<NoArgFactory>(factories...)),
 #endif
+          prewarm_all_members(getConfBoolean(Conf::DERECHO_EXTERNAL_PREWARM_CONNECTIONS)),
           rpc_logger(LoggerFactory::createIfAbsent(LoggerFactory::RPC_LOGGER_NAME, getConfString(Conf::LOGGER_RPC_LOG_LEVEL))),
           busy_wait_before_sleep_ms(getConfUInt64(Conf::DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS)) {
     RpcLoggerPtr::initialize();
@@ -210,6 +542,10 @@ ExternalGroupClient<ReplicatedTypes...>::ExternalGroupClient(
     initialize_p2p_connections();
 
     rpc_listener_thread = std::thread(&ExternalGroupClient<ReplicatedTypes...>::p2p_receive_loop, this);
+
+    if(prewarm_all_members) {
+        prewarm_connections(curr_view->members);
+    }
 }
 
 template <typename... ReplicatedTypes>
@@ -221,19 +557,20 @@ ExternalGroupClient<ReplicatedTypes...>::~ExternalGroupClient() {
 
     // gracefully inform each remote node that this client is leaving
     auto node_ids = p2p_connections->get_active_nodes();
+    const std::shared_ptr<View> view = get_current_view();
     for(const node_id_t remote_id : node_ids){
         if(remote_id == my_id) continue;
 
         dbg_default_info("informing node {} that this client is leaving.", remote_id);
-        int rank = curr_view->rank_of(remote_id);
+        int rank = view->rank_of(remote_id);
         if(rank == -1) {
             dbg_default_error("Cannot send a p2p request to node {}: it is not a member of the Group.", remote_id);
             dbg_default_flush();
             continue;
         }
 
-        tcp::socket sock(curr_view->member_ips_and_ports[rank].ip_address,
-                curr_view->member_ips_and_ports[rank].gms_port);
+        tcp::socket sock(view->member_ips_and_ports[rank].ip_address,
+                view->member_ips_and_ports[rank].gms_port);
 
         JoinResponse response;
         uint64_t node_version_hashcode;
@@ -274,10 +611,11 @@ ExternalGroupClient<ReplicatedTypes...>::~ExternalGroupClient() {
 template <typename... ReplicatedTypes>
 bool ExternalGroupClient<ReplicatedTypes...>::get_view(const node_id_t nid) {
     try {
+        const std::shared_ptr<View> old_view = get_current_view();
         tcp::socket sock = (nid == INVALID_NODE_ID)
                                    ? tcp::socket(getConfString(Conf::DERECHO_CONTACT_IP), getConfUInt16(Conf::DERECHO_CONTACT_PORT))
-                                   : tcp::socket(curr_view->member_ips_and_ports[curr_view->rank_of(nid)].ip_address,
-                                                 curr_view->member_ips_and_ports[curr_view->rank_of(nid)].gms_port, false);
+                                   : tcp::socket(old_view->member_ips_and_ports[old_view->rank_of(nid)].ip_address,
+                                                 old_view->member_ips_and_ports[old_view->rank_of(nid)].gms_port, false);
 
         JoinResponse leader_response;
         uint64_t leader_version_hashcode;
@@ -300,8 +638,10 @@ bool ExternalGroupClient<ReplicatedTypes...>::get_view(const node_id_t nid) {
         sock.read(size_of_view);
         uint8_t buffer[size_of_view];
         sock.read(buffer, size_of_view);
+        std::shared_ptr<View> new_view = mutils::from_bytes<View>(nullptr, buffer);
+        std::lock_guard<std::mutex> lock(view_mutex);
         prev_view = std::move(curr_view);
-        curr_view = mutils::from_bytes<View>(nullptr, buffer);
+        curr_view = std::move(new_view);
     } catch(tcp::connection_failure&) {
         dbg_default_error("Failed to connect to group member {} when requesting new view.", nid);
         dbg_default_flush();
@@ -320,31 +660,51 @@ bool ExternalGroupClient<ReplicatedTypes...>::get_view(const node_id_t nid) {
 
 template <typename... ReplicatedTypes>
 void ExternalGroupClient<ReplicatedTypes...>::clean_up() {
-    p2p_connections->filter_to(curr_view->members);
-    sst::filter_external_to(curr_view->members);
-
-    for(auto& fulfilled_pending_results_pair : fulfilled_pending_results) {
-        const subgroup_id_t subgroup_id = fulfilled_pending_results_pair.first;
-        // For each PendingResults in this subgroup, check the departed list of each shard in
-        // the subgroup, and call set_exception_for_removed_node for the departed nodes
-        for(auto pending_results_iter = fulfilled_pending_results_pair.second.begin();
-            pending_results_iter != fulfilled_pending_results_pair.second.end();) {
-            std::shared_ptr<AbstractPendingResults> live_pending_results = pending_results_iter->lock();
-            if(live_pending_results && !live_pending_results->all_responded()) {
-                for(uint32_t shard_num = 0;
-                    shard_num < curr_view->subgroup_shard_views[subgroup_id].size();
-                    ++shard_num) {
-                    for(auto removed_id : curr_view->subgroup_shard_views[subgroup_id][shard_num].departed) {
-                        // This will do nothing if removed_id was never in the
-                        // shard this PendingResult corresponds to
-                        dbg_debug(rpc_logger, "Setting exception for removed node {} on PendingResults for subgroup {}, shard {}", removed_id, subgroup_id, shard_num);
-                        live_pending_results->set_exception_for_removed_node(removed_id);
-                    }
-                }
-                pending_results_iter++;
+    const std::shared_ptr<View> view = get_current_view();
+    // Connections to members that are still in the View are kept
+    p2p_connections->filter_to(view->members);
+    sst::filter_external_to(view->members);
+    {
+        std::lock_guard<std::mutex> lock(connection_states_mutex);
+        for(auto state_iter = connection_states.begin(); state_iter != connection_states.end();) {
+            if(view->rank_of(state_iter->first) == -1) {
+                state_iter = connection_states.erase(state_iter);
             } else {
-                // Garbage-collect PendingResults pointers that are obsolete
-                pending_results_iter = fulfilled_pending_results_pair.second.erase(pending_results_iter);
+                ++state_iter;
+            }
+        }
+    }
+
+    // Exceptions are set after releasing fulfilled_pending_results_mutex, since they may run completion callbacks
+    std::vector<std::pair<subgroup_id_t, std::shared_ptr<AbstractPendingResults>>> live_pending_results_list;
+    {
+        std::lock_guard<std::mutex> lock(fulfilled_pending_results_mutex);
+        for(auto& fulfilled_pending_results_pair : fulfilled_pending_results) {
+            const subgroup_id_t subgroup_id = fulfilled_pending_results_pair.first;
+            for(auto pending_results_iter = fulfilled_pending_results_pair.second.begin();
+                pending_results_iter != fulfilled_pending_results_pair.second.end();) {
+                std::shared_ptr<AbstractPendingResults> live_pending_results = pending_results_iter->lock();
+                if(live_pending_results && !live_pending_results->all_responded()) {
+                    live_pending_results_list.emplace_back(subgroup_id, std::move(live_pending_results));
+                    pending_results_iter++;
+                } else {
+                    // Garbage-collect PendingResults pointers that are obsolete
+                    pending_results_iter = fulfilled_pending_results_pair.second.erase(pending_results_iter);
+                }
+            }
+        }
+    }
+    // For each PendingResults, check the departed list of each shard in its subgroup,
+    // and call set_exception_for_removed_node for the departed nodes
+    for(auto& [subgroup_id, live_pending_results] : live_pending_results_list) {
+        for(uint32_t shard_num = 0;
+            shard_num < view->subgroup_shard_views[subgroup_id].size();
+            ++shard_num) {
+            for(auto removed_id : view->subgroup_shard_views[subgroup_id][shard_num].departed) {
+                // This will do nothing if removed_id was never in the
+                // shard this PendingResult corresponds to
+                dbg_debug(rpc_logger, "Setting exception for removed node {} on PendingResults for subgroup {}, shard {}", removed_id, subgroup_id, shard_num);
+                live_pending_results->set_exception_for_removed_node(removed_id);
             }
         }
     }
@@ -352,30 +712,40 @@ void ExternalGroupClient<ReplicatedTypes...>::clean_up() {
 
 template <typename... ReplicatedTypes>
 bool ExternalGroupClient<ReplicatedTypes...>::update_view() {
-    for(auto& nid : curr_view->members) {
+    // get_view() replaces the current View, so iterate over a snapshot of it
+    const std::shared_ptr<View> view = get_current_view();
+    for(auto& nid : view->members) {
         if(get_view(nid)) {
             dbg_default_debug("Successfully got new view from {} ", nid);
             clean_up();
+            // Connect to members that replaced pre-warmed ones before any request needs them
+            reconnect_prewarmed_members();
             return true;
         }
     }
     return false;
 }
+template <typename... ReplicatedTypes>
+std::shared_ptr<View> ExternalGroupClient<ReplicatedTypes...>::get_current_view() const {
+    std::lock_guard<std::mutex> lock(view_mutex);
+    return curr_view;
+}
+
 template <typename... ReplicatedTypes>
 std::vector<node_id_t> ExternalGroupClient<ReplicatedTypes...>::get_members() const {
-    return curr_view->members;
+    return get_current_view()->members;
 }
 template <typename... ReplicatedTypes>
 std::vector<node_id_t> ExternalGroupClient<ReplicatedTypes...>::get_shard_members(uint32_t subgroup_id, uint32_t shard_num) const {
-    return curr_view->subgroup_shard_views[subgroup_id][shard_num].members;
+    return get_current_view()->subgroup_shard_views[subgroup_id][shard_num].members;
 }
 template <typename... ReplicatedTypes>
 template <typename SubgroupType>
 std::vector<node_id_t> ExternalGroupClient<ReplicatedTypes...>::get_shard_members(uint32_t subgroup_index, uint32_t shard_num) const {
     const subgroup_type_id_t subgroup_type_id = get_index_of_type(typeid(SubgroupType));
-    const auto& subgroup_ids = curr_view->subgroup_ids_by_type_id.at(subgroup_type_id);
-    const subgroup_id_t subgroup_id = subgroup_ids.at(subgroup_index);
-    return get_shard_members(subgroup_id, shard_num);
+    const std::shared_ptr<View> view = get_current_view();
+    const subgroup_id_t subgroup_id = view->subgroup_ids_by_type_id.at(subgroup_type_id).at(subgroup_index);
+    return view->subgroup_shard_views[subgroup_id][shard_num].members;
 }
 
 template <typename... ReplicatedTypes>
@@ -384,8 +754,7 @@ ExternalClientCaller<SubgroupType, ExternalGroupClient<ReplicatedTypes...>>& Ext
     // If there is not yet an ExternalClientCaller for this subgroup type, create one now
     if(external_callers.template get<SubgroupType>().find(subgroup_index) == external_callers.template get<SubgroupType>().end()) {
         const subgroup_type_id_t subgroup_type_id = get_index_of_type(typeid(SubgroupType));
-        const auto& subgroup_ids = curr_view->subgroup_ids_by_type_id.at(subgroup_type_id);
-        const subgroup_id_t subgroup_id = subgroup_ids.at(subgroup_index);
+        const subgroup_id_t subgroup_id = get_current_view()->subgroup_ids_by_type_id.at(subgroup_type_id).at(subgroup_index);
         external_callers.template get<SubgroupType>().emplace(
                 subgroup_index, ExternalClientCaller<SubgroupType, ExternalGroupClient<ReplicatedTypes...>>(subgroup_type_id, my_id, subgroup_id, *this));
     }
@@ -406,8 +775,64 @@ sst::P2PBufferHandle ExternalGroupClient<ReplicatedTypes...>::get_sendbuffer_ptr
     return *buffer;
 }
 
+template <typename... ReplicatedTypes>
+sst::P2PBufferHandle ExternalGroupClient<ReplicatedTypes...>::get_sendbuffer_ptr(uint32_t dest_id, sst::MESSAGE_TYPE type, std::size_t size) {
+    try {
+        const bool oversized = p2p_connections->needs_rendezvous(dest_id, type, size);
+        sst::P2PBufferHandle buffer = get_sendbuffer_ptr(dest_id, type);
+        if(oversized) {
+            buffer.buf_ptr = stage_rendezvous_message(dest_id, type, buffer, size);
+        }
+        return buffer;
+    } catch(std::out_of_range& map_error) {
+        throw node_removed_from_group_exception(dest_id);
+    }
+}
+
+template <typename... ReplicatedTypes>
+uint8_t* ExternalGroupClient<ReplicatedTypes...>::stage_rendezvous_message(node_id_t dest_id, sst::MESSAGE_TYPE type,
+                                                                           const sst::P2PBufferHandle& msg_buffer, std::size_t size) {
+    using namespace remote_invocation_utilities;
+    sst::RendezvousBufferHandle rendezvous_buffer = p2p_connections->allocate_rendezvous_buffer(
+            dest_id, type, msg_buffer.seq_num, size);
+    populate_rendezvous_message(msg_buffer.buf_ptr, my_id, type == sst::MESSAGE_TYPE::P2P_REPLY,
+                                RendezvousDescriptor{reinterpret_cast<uint64_t>(rendezvous_buffer.buf_ptr),
+                                                     rendezvous_buffer.rkey, size});
+    if(type == sst::MESSAGE_TYPE::P2P_REQUEST) {
+        // The request isn't serialized yet, so send_p2p_message completes the rendezvous message
+        std::lock_guard<std::mutex> lock(staged_rendezvous_requests_mutex);
+        staged_rendezvous_requests[{dest_id, msg_buffer.seq_num}] = {msg_buffer.buf_ptr, rendezvous_buffer.buf_ptr};
+    }
+    return rendezvous_buffer.buf_ptr;
+}
+
+template <typename... ReplicatedTypes>
+sst::RendezvousReadBuffer ExternalGroupClient<ReplicatedTypes...>::read_rendezvous_message(
+        node_id_t sender_id, sst::MESSAGE_TYPE type, const rpc::remote_invocation_utilities::RendezvousDescriptor& descriptor) {
+    dbg_trace(rpc_logger, "Reading a {}-byte rendezvous message from node {}", descriptor.size, sender_id);
+    return p2p_connections->read_rendezvous_buffer(sender_id, type, descriptor.remote_addr, descriptor.rkey, descriptor.size);
+}
+
+template <typename... ReplicatedTypes>
+bool ExternalGroupClient<ReplicatedTypes...>::p2p_send_has_space(uint32_t dest_id) {
+    try {
+        return p2p_connections->has_send_space(dest_id, sst::MESSAGE_TYPE::P2P_REQUEST);
+    } catch(std::out_of_range& map_error) {
+        throw node_removed_from_group_exception(dest_id);
+    }
+}
+
 template <typename... ReplicatedTypes>
 void ExternalGroupClient<ReplicatedTypes...>::send_p2p_message(node_id_t dest_id, subgroup_id_t dest_subgroup_id, uint64_t sequence_num, std::weak_ptr<rpc::AbstractPendingResults> pending_results_handle) {
+    {
+        std::lock_guard<std::mutex> lock(staged_rendezvous_requests_mutex);
+        auto staged_request = staged_rendezvous_requests.find({dest_id, sequence_num});
+        if(staged_request != staged_rendezvous_requests.end()) {
+            rpc::remote_invocation_utilities::complete_rendezvous_message(staged_request->second.first,
+                                                                          staged_request->second.second);
+            staged_rendezvous_requests.erase(staged_request);
+        }
+    }
     try {
         p2p_connections->send(dest_id, sst::MESSAGE_TYPE::P2P_REQUEST, sequence_num);
     } catch(std::out_of_range& map_error) {
@@ -416,10 +841,31 @@ void ExternalGroupClient<ReplicatedTypes...>::send_p2p_message(node_id_t dest_id
     std::shared_ptr<AbstractPendingResults> pending_results = pending_results_handle.lock();
     if(pending_results) {
         pending_results->fulfill_map({dest_id});
+        //An external client is never notified of persistence events
+        pending_results->end_persistence_events();
+        std::lock_guard<std::mutex> lock(fulfilled_pending_results_mutex);
         fulfilled_pending_results[dest_subgroup_id].push_back(pending_results_handle);
     }
 }
 
+template <typename... ReplicatedTypes>
+void ExternalGroupClient<ReplicatedTypes...>::send_exception_reply(node_id_t dest_id, const rpc::Opcode& request_opcode, void* invocation_id,
+                                                                   const rpc::remote_exception_info& exception_info) {
+    using namespace remote_invocation_utilities;
+    auto buffer_handle = p2p_connections->get_sendbuffer_ptr(dest_id, sst::MESSAGE_TYPE::P2P_REPLY);
+    assert(buffer_handle);
+    // Same format as the exception replies built by RemoteInvocable::receive_call
+    const std::size_t result_size = mutils::bytes_size(exception_info) + sizeof(invocation_id) + 1;
+    Opcode reply_opcode = request_opcode;
+    reply_opcode.is_reply = true;
+    uint8_t* out = buffer_handle->buf_ptr + header_space();
+    out[0] = true;
+    std::memcpy(out + 1, &invocation_id, sizeof(invocation_id));
+    mutils::to_bytes(exception_info, out + sizeof(invocation_id) + 1);
+    populate_header(buffer_handle->buf_ptr, result_size, reply_opcode, my_id, 0);
+    p2p_connections->send(dest_id, sst::MESSAGE_TYPE::P2P_REPLY, buffer_handle->seq_num);
+}
+
 template <typename... ReplicatedTypes>
 std::exception_ptr ExternalGroupClient<ReplicatedTypes...>::receive_message(
         const rpc::Opcode& indx, const node_id_t& received_from, uint8_t const* const buf,
@@ -458,7 +904,42 @@ void ExternalGroupClient<ReplicatedTypes...>::p2p_message_handler(node_id_t send
     node_id_t received_from;
     uint32_t flags;
     retrieve_header(msg_buf, payload_size, indx, received_from, flags);
+    if(indx.is_reply && RPC_HEADER_FLAG_TST(flags, STALE_VIEW)) {
+        // The member no longer hosts the subgroup this client addressed, so the request was not handled
+        int32_t member_vid;
+        void* invocation_id;
+        std::memcpy(&member_vid, msg_buf + header_size, sizeof(member_vid));
+        std::memcpy(&invocation_id, msg_buf + header_size + sizeof(member_vid), sizeof(invocation_id));
+        dbg_debug(rpc_logger, "Node {} does not host subgroup {} in view {}; this client has view {}",
+                  sender_id, indx.subgroup_id, member_vid, get_current_view()->vid);
+        mark_view_stale();
+        // The invocation ID is the address of the call's PendingResults, which is only safe to use
+        // if the call is still live, so look it up among the calls this client is waiting on
+        std::shared_ptr<AbstractPendingResults> stale_call;
+        {
+            std::lock_guard<std::mutex> lock(fulfilled_pending_results_mutex);
+            for(const auto& pending_results_handle : fulfilled_pending_results[indx.subgroup_id]) {
+                std::shared_ptr<AbstractPendingResults> live_pending_results = pending_results_handle.lock();
+                if(live_pending_results && dynamic_cast<void*>(live_pending_results.get()) == invocation_id) {
+                    stale_call = std::move(live_pending_results);
+                    break;
+                }
+            }
+        }
+        if(stale_call) {
+            stale_call->set_exception_for_removed_node(sender_id);
+        }
+        return;
+    }
     if(indx.is_reply) {
+        if(RPC_HEADER_FLAG_TST(flags, RENDEZVOUS)) {
+            // An oversized reply must be read from the sender's memory, which can take a
+            // while, so the rendezvous worker reads and handles it
+            std::lock_guard<std::mutex> lock(rendezvous_reply_mutex);
+            rendezvous_reply_queue.push(rendezvous_reply{sender_id, retrieve_rendezvous_descriptor(msg_buf)});
+            rendezvous_reply_cv.notify_one();
+            return;
+        }
         // REPLYs can be handled here because they do not block.
         receive_message(indx, received_from, msg_buf + header_size, payload_size,
                         [](size_t _size) -> uint8_t* {
@@ -500,6 +981,32 @@ void ExternalGroupClient<ReplicatedTypes...>::p2p_request_worker() {
             p2p_request_queue.pop();
         }
         retrieve_header(request.msg_buf, payload_size, indx, received_from, flags);
+        sst::RendezvousReadBuffer rendezvous_buf;
+        if(RPC_HEADER_FLAG_TST(flags, RENDEZVOUS)) {
+            try {
+                rendezvous_buf = read_rendezvous_message(request.sender_id, sst::MESSAGE_TYPE::P2P_REQUEST,
+                                                         retrieve_rendezvous_descriptor(request.msg_buf));
+            } catch(derecho_exception& ex) {
+                // Still answer the request, since the sender's request window advances on replies
+                dbg_error(rpc_logger, "Dropping a P2P request from node {} because its rendezvous buffer could not be read: {}",
+                          request.sender_id, ex.what());
+                void* invocation_id = retrieve_rendezvous_invocation_id(request.msg_buf);
+                if(invocation_id) {
+                    send_exception_reply(request.sender_id, indx, invocation_id,
+                                         rpc::remote_exception_info("derecho::derecho_exception",
+                                                                    std::string("Failed to read the request: ") + ex.what()));
+                } else {
+                    // Void functions have no invocation ID and expect a null reply
+                    auto buffer_handle = p2p_connections->get_sendbuffer_ptr(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY);
+                    assert(buffer_handle);
+                    reinterpret_cast<size_t*>(buffer_handle->buf_ptr)[0] = 0;
+                    p2p_connections->send(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY, buffer_handle->seq_num);
+                }
+                continue;
+            }
+            request.msg_buf = rendezvous_buf.get();
+            retrieve_header(request.msg_buf, payload_size, indx, received_from, flags);
+        }
         if(indx.is_reply || RPC_HEADER_FLAG_TST(flags, CASCADE)) {
             dbg_error(rpc_logger, "Invalid rpc message in fifo queue: is_reply={}, is_cascading={}",
                       indx.is_reply, RPC_HEADER_FLAG_TST(flags, CASCADE));
@@ -512,16 +1019,17 @@ void ExternalGroupClient<ReplicatedTypes...>::p2p_request_worker() {
         receive_message(indx, received_from, request.msg_buf + header_size, payload_size,
                         [this, &reply_size, &reply_seq_num, &request](size_t _size) {
                             reply_size = _size;
-                            if(reply_size <= p2p_connections->get_max_p2p_reply_size()) {
-                                auto buffer_handle = p2p_connections->get_sendbuffer_ptr(
-                                        request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY);
-                                if(!buffer_handle)
-                                    throw derecho_exception("Failed to allocate a buffer for a P2P reply because the send window was full!");
-                                reply_seq_num = buffer_handle->seq_num;
-                                return buffer_handle->buf_ptr;
-                            } else {
-                                throw buffer_overflow_exception("Size of a P2P reply exceeds the maximum P2P reply size.");
+                            const bool oversized = p2p_connections->needs_rendezvous(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY, reply_size);
+                            auto buffer_handle = p2p_connections->get_sendbuffer_ptr(
+                                    request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY);
+                            if(!buffer_handle)
+                                throw derecho_exception("Failed to allocate a buffer for a P2P reply because the send window was full!");
+                            reply_seq_num = buffer_handle->seq_num;
+                            if(oversized) {
+                                return stage_rendezvous_message(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY,
+                                                                *buffer_handle, reply_size);
                             }
+                            return buffer_handle->buf_ptr;
                         });
         if(reply_size > 0) {
             p2p_connections->send(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY, reply_seq_num);
@@ -536,11 +1044,52 @@ void ExternalGroupClient<ReplicatedTypes...>::p2p_request_worker() {
     }
 }
 
+template <typename... ReplicatedTypes>
+void ExternalGroupClient<ReplicatedTypes...>::rendezvous_reply_worker() {
+    pthread_setname_np(pthread_self(), "eg_rdv_wkr");
+    using namespace remote_invocation_utilities;
+    std::size_t payload_size;
+    Opcode indx;
+    node_id_t received_from;
+    uint32_t flags;
+    rendezvous_reply reply;
+
+    while(!thread_shutdown) {
+        {
+            std::unique_lock<std::mutex> lock(rendezvous_reply_mutex);
+            rendezvous_reply_cv.wait(lock, [&]() { return !rendezvous_reply_queue.empty() || thread_shutdown; });
+            if(thread_shutdown) {
+                break;
+            }
+            reply = rendezvous_reply_queue.front();
+            rendezvous_reply_queue.pop();
+        }
+        sst::RendezvousReadBuffer reply_buf;
+        try {
+            reply_buf = read_rendezvous_message(reply.sender_id, sst::MESSAGE_TYPE::P2P_REPLY, reply.descriptor);
+        } catch(derecho_exception& ex) {
+            dbg_error(rpc_logger, "Dropping a P2P reply from node {} because its rendezvous buffer could not be read: {}",
+                      reply.sender_id, ex.what());
+            continue;
+        }
+        if(!p2p_connections->contains_node(reply.sender_id)) {
+            // The member left while its reply was being read, and its pending queries were already given exceptions
+            continue;
+        }
+        retrieve_header(reply_buf.get(), payload_size, indx, received_from, flags);
+        receive_message(indx, received_from, reply_buf.get() + header_space(), payload_size,
+                        [](size_t _size) -> uint8_t* {
+                            throw derecho::derecho_exception("A P2P reply message attempted to generate another reply");
+                        });
+    }
+}
+
 template <typename... ReplicatedTypes>
 void ExternalGroupClient<ReplicatedTypes...>::p2p_receive_loop() {
     pthread_setname_np(pthread_self(), "eg_rpc_lsnr");
 
     request_worker_thread = std::thread(&ExternalGroupClient<ReplicatedTypes...>::p2p_request_worker, this);
+    rendezvous_reply_thread = std::thread(&ExternalGroupClient<ReplicatedTypes...>::rendezvous_reply_worker, this);
 
     uint64_t last_time_ms = get_walltime() / INT64_1E6;
 
@@ -570,6 +1119,11 @@ void ExternalGroupClient<ReplicatedTypes...>::p2p_receive_loop() {
     // stop fifo worker.
     request_queue_cv.notify_one();
     request_worker_thread.join();
+    {
+        std::lock_guard<std::mutex> lock(rendezvous_reply_mutex);
+        rendezvous_reply_cv.notify_one();
+    }
+    rendezvous_reply_thread.join();
 }
 
 template <typename... ReplicatedTypes>
@@ -592,16 +1146,18 @@ template <typename... ReplicatedTypes>
 template <typename SubgroupType>
 uint32_t ExternalGroupClient<ReplicatedTypes...>::get_number_of_subgroups() const {
     uint32_t type_idx = this->template get_index_of_type<SubgroupType>();
-    if(curr_view->subgroup_ids_by_type_id.find(type_idx) != curr_view->subgroup_ids_by_type_id.end()) {
-        return curr_view->subgroup_ids_by_type_id.at(type_idx).size();
+    const std::shared_ptr<View> view = get_current_view();
+    if(view->subgroup_ids_by_type_id.find(type_idx) != view->subgroup_ids_by_type_id.end()) {
+        return view->subgroup_ids_by_type_id.at(type_idx).size();
     }
     return 0;
 }
 
 template <typename... ReplicatedTypes>
 uint32_t ExternalGroupClient<ReplicatedTypes...>::get_number_of_shards(uint32_t subgroup_id) const {
-    if(subgroup_id < curr_view->subgroup_shard_views.size()) {
-        return curr_view->subgroup_shard_views[subgroup_id].size();
+    const std::shared_ptr<View> view = get_current_view();
+    if(subgroup_id < view->subgroup_shard_views.size()) {
+        return view->subgroup_shard_views[subgroup_id].size();
     }
     return 0;
 }
@@ -609,8 +1165,10 @@ uint32_t ExternalGroupClient<ReplicatedTypes...>::get_number_of_shards(uint32_t
 template <typename... ReplicatedTypes>
 template <typename SubgroupType>
 uint32_t ExternalGroupClient<ReplicatedTypes...>::get_number_of_shards(uint32_t subgroup_index) const {
-    if(subgroup_index < this->template get_number_of_subgroups<SubgroupType>()) {
-        return get_number_of_shards(curr_view->subgroup_ids_by_type_id.at(this->template get_index_of_type<SubgroupType>())[subgroup_index]);
+    const std::shared_ptr<View> view = get_current_view();
+    const auto subgroup_ids = view->subgroup_ids_by_type_id.find(this->template get_index_of_type<SubgroupType>());
+    if(subgroup_ids != view->subgroup_ids_by_type_id.end() && subgroup_index < subgroup_ids->second.size()) {
+        return view->subgroup_shard_views[subgroup_ids->second[subgroup_index]].size();
     }
     return 0;
 }
@@ -619,9 +1177,10 @@ template <typename... ReplicatedTypes>
 template <typename SubgroupType>
 std::vector<std::vector<node_id_t>> ExternalGroupClient<ReplicatedTypes...>::get_subgroup_members(uint32_t subgroup_index) const {
     std::vector<std::vector<node_id_t>> ret;
-    if(subgroup_index < this->template get_number_of_subgroups<SubgroupType>()) {
-        for (const auto& sv: curr_view->subgroup_shard_views[
-                curr_view->subgroup_ids_by_type_id.at(this->template get_index_of_type<SubgroupType>())[subgroup_index]]) {
+    const std::shared_ptr<View> view = get_current_view();
+    const auto subgroup_ids = view->subgroup_ids_by_type_id.find(this->template get_index_of_type<SubgroupType>());
+    if(subgroup_ids != view->subgroup_ids_by_type_id.end() && subgroup_index < subgroup_ids->second.size()) {
+        for (const auto& sv: view->subgroup_shard_views[subgroup_ids->second[subgroup_index]]) {
             ret.push_back(sv.members);
         }
     }
@@ -650,4 +1209,9 @@ template <typename... ReplicatedTypes>
 void ExternalGroupClient<ReplicatedTypes...>::deregister_oob_memory(void* addr) {
     sst::P2PConnection::deregister_oob_memory(addr);
 }
+
+template <typename... ReplicatedTypes>
+registered_array<uint8_t> ExternalGroupClient<ReplicatedTypes...>::allocate_oob_memory(size_t size) {
+    return allocate_registered_memory(size);
+}
 }  // namespace derecho
@@ -384,9 +384,8 @@ std::set<std::pair<subgroup_id_t, node_id_t>> Group<ReplicatedTypes...>::constru
                                                           my_id, subgroup_id, rpc_manager));
         }
         // create the external client callback object if we don't have one
-        external_client_callbacks.template get<FirstType>().emplace(
-                subgroup_index, ExternalClientCallback<FirstType>(subgroup_type_id,
-                                                                  my_id, subgroup_id, rpc_manager));
+        external_client_callbacks.template get<FirstType>().try_emplace(
+                subgroup_index, subgroup_type_id, my_id, subgroup_id, rpc_manager);
     }
     return functional_insert(subgroups_to_receive, construct_objects<RestTypes...>(curr_view, old_shard_leaders, in_restart));
 }
@@ -511,30 +510,107 @@ ShardIterator<SubgroupType> Group<ReplicatedTypes...>::get_shard_iterator(uint32
 
 template <typename... ReplicatedTypes>
 void Group<ReplicatedTypes...>::receive_objects(const std::set<std::pair<subgroup_id_t, node_id_t>>& subgroups_and_leaders) {
-    // This will receive one object from each shard leader in ascending order of subgroup ID
+    // Each leader sends its objects over one socket in ascending order of subgroup ID,
+    // but the sockets connected to different leaders can be read in parallel
+    std::map<node_id_t, std::vector<subgroup_id_t>> subgroups_by_leader;
+    // The log tail length of each persistent subgroup, and whether this node can rebuild
+    // the object's state from its own log once the missing entries are appended to it
+    std::map<subgroup_id_t, std::pair<persistent::version_t, bool>> log_tail_lengths;
     for(const auto& subgroup_and_leader : subgroups_and_leaders) {
-        LockedReference<std::unique_lock<std::mutex>, tcp::socket> leader_socket
-                = view_manager.get_transfer_socket(subgroup_and_leader.second);
+        subgroups_by_leader[subgroup_and_leader.second].push_back(subgroup_and_leader.first);
         ReplicatedObject* subgroup_object = objects_by_subgroup_id.at(subgroup_and_leader.first);
+        if(subgroup_object->is_persistent()) {
+            log_tail_lengths[subgroup_and_leader.first] = {subgroup_object->get_minimum_latest_persisted_version(),
+                                                           subgroup_object->can_rebuild_from_log()};
+        }
+    }
+    struct ReceivedObject {
+        subgroup_id_t subgroup_id;
+        std::unique_ptr<uint8_t[]> buffer;
+    };
+    std::mutex received_objects_mutex;
+    std::condition_variable received_objects_cv;
+    std::deque<ReceivedObject> received_objects;
+    std::size_t num_finished_leaders = 0;
+    std::optional<node_id_t> failed_leader;
+    // Any other exception in a receiver thread is rethrown on this thread after all of them are joined
+    std::exception_ptr receiver_exception;
+    auto receive_from_leader = [&](node_id_t leader_id, const std::vector<subgroup_id_t>& subgroup_ids) {
         try {
-            if(subgroup_object->is_persistent()) {
-                persistent::version_t log_tail_length = subgroup_object->get_minimum_latest_persisted_version();
-                dbg_default_debug("Sending log tail length of {} for subgroup {} to node {}.",
-                                  log_tail_length, subgroup_and_leader.first, subgroup_and_leader.second);
-                leader_socket.get().write(log_tail_length);
+            LockedReference<std::unique_lock<std::mutex>, tcp::socket> leader_socket
+                    = view_manager.get_transfer_socket(leader_id);
+            for(const subgroup_id_t subgroup_id : subgroup_ids) {
+                auto log_tail_iter = log_tail_lengths.find(subgroup_id);
+                if(log_tail_iter != log_tail_lengths.end()) {
+                    dbg_default_debug("Sending log tail length of {} for subgroup {} to node {}; can rebuild from log: {}",
+                                      log_tail_iter->second.first, subgroup_id, leader_id, log_tail_iter->second.second);
+                    leader_socket.get().write(log_tail_iter->second.first);
+                    leader_socket.get().write(log_tail_iter->second.second);
+                }
+                dbg_default_debug("Receiving Replicated Object state for subgroup {} from node {}",
+                                  subgroup_id, leader_id);
+                std::size_t buffer_size;
+                leader_socket.get().read(buffer_size);
+                std::unique_ptr<uint8_t[]> buffer = std::make_unique<uint8_t[]>(buffer_size);
+                leader_socket.get().read(buffer.get(), buffer_size);
+                std::lock_guard<std::mutex> lock(received_objects_mutex);
+                received_objects.push_back(ReceivedObject{subgroup_id, std::move(buffer)});
+                received_objects_cv.notify_all();
             }
-            dbg_default_debug("Receiving Replicated Object state for subgroup {} from node {}",
-                              subgroup_and_leader.first, subgroup_and_leader.second);
-            std::size_t buffer_size;
-            leader_socket.get().read(buffer_size);
-            std::unique_ptr<uint8_t[]> buffer = std::make_unique<uint8_t[]>(buffer_size);
-            leader_socket.get().read(buffer.get(), buffer_size);
-            dbg_default_trace("Deserializing Replicated Object from buffer of size {}", buffer_size);
-            subgroup_object->receive_object(buffer.get());
         } catch(tcp::socket_error& e) {
-            // Convert socket exceptions to a more readable error message, since this will cause a crash
-            throw derecho_exception("Fatal error: Node " + std::to_string(subgroup_and_leader.second) + " failed during state transfer!");
+            std::lock_guard<std::mutex> lock(received_objects_mutex);
+            failed_leader = leader_id;
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(received_objects_mutex);
+            if(!receiver_exception) {
+                receiver_exception = std::current_exception();
+            }
+        }
+        std::lock_guard<std::mutex> lock(received_objects_mutex);
+        num_finished_leaders++;
+        received_objects_cv.notify_all();
+    };
+    std::vector<std::thread> receiver_threads;
+    for(const auto& leader_and_subgroups : subgroups_by_leader) {
+        receiver_threads.emplace_back(receive_from_leader, leader_and_subgroups.first,
+                                      std::cref(leader_and_subgroups.second));
+    }
+    // Deserialize each object on this thread as soon as it arrives, overlapping with the remaining transfers.
+    // If deserialization fails, keep waiting for the receiver threads so they can be joined.
+    std::exception_ptr deserialization_exception;
+    while(true) {
+        std::unique_lock<std::mutex> lock(received_objects_mutex);
+        received_objects_cv.wait(lock, [&]() {
+            return !received_objects.empty() || num_finished_leaders == subgroups_by_leader.size();
+        });
+        if(received_objects.empty()) {
+            break;
+        }
+        ReceivedObject received_object = std::move(received_objects.front());
+        received_objects.pop_front();
+        lock.unlock();
+        if(deserialization_exception) {
+            continue;
         }
+        dbg_default_trace("Deserializing Replicated Object for subgroup {}", received_object.subgroup_id);
+        try {
+            objects_by_subgroup_id.at(received_object.subgroup_id)->receive_object(received_object.buffer.get());
+        } catch(...) {
+            deserialization_exception = std::current_exception();
+        }
+    }
+    for(std::thread& receiver_thread : receiver_threads) {
+        receiver_thread.join();
+    }
+    if(failed_leader) {
+        // Convert socket exceptions to a more readable error message, since this will cause a crash
+        throw derecho_exception("Fatal error: Node " + std::to_string(*failed_leader) + " failed during state transfer!");
+    }
+    if(receiver_exception) {
+        std::rethrow_exception(receiver_exception);
+    }
+    if(deserialization_exception) {
+        std::rethrow_exception(deserialization_exception);
     }
 
     dbg_default_debug("Done receiving all Replicated Objects from subgroup leaders {}", subgroups_and_leaders.empty() ? "(there were none to receive)" : "");
@@ -567,6 +643,11 @@ std::vector<IpAndPorts> Group<ReplicatedTypes...>::get_member_addresses() {
     return view_manager.get_member_addresses();
 }
 
+template <typename... ReplicatedTypes>
+ViewChangeTimings Group<ReplicatedTypes...>::get_last_view_change_timings() {
+    return view_manager.get_last_view_change_timings();
+}
+
 template <typename... ReplicatedTypes>
 template <typename SubgroupType>
 std::vector<std::vector<node_id_t>> Group<ReplicatedTypes...>::get_subgroup_members(uint32_t subgroup_index) {
@@ -648,4 +729,9 @@ void Group<ReplicatedTypes...>::deregister_oob_memory(void* addr) {
     sst::P2PConnection::deregister_oob_memory(addr);
 }
 
+template <typename... ReplicatedTypes>
+registered_array<uint8_t> Group<ReplicatedTypes...>::allocate_oob_memory(size_t size) {
+    return allocate_registered_memory(size);
+}
+
 } /* namespace derecho */
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <derecho/config.h>
+#include <derecho/core/derecho_type_definitions.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace derecho {
+
+/** The maximum number of rails (NICs) RDMC and the SST can use at once */
+constexpr uint32_t max_rails = 8;
+
+/**
+ * One of the NICs that RDMC and the SST send over, identified by the name of
+ * its libfabric domain.
+ */
+struct RailConfig {
+    std::string domain;
+    /** The rail's share of striped traffic, relative to the other rails */
+    uint32_t weight;
+};
+
+/**
+ * Reads the rails to use from the configuration. RDMA/domains lists one
+ * domain per rail; if it is empty, the single domain in RDMA/domain is the
+ * only rail. Each rail's weight comes from RDMA/rail_weights if it is set,
+ * and otherwise from the link rate the rail's device reports, so faster NICs
+ * carry proportionally more blocks. If any rail's rate is unknown, all rails
+ * get the same weight.
+ * @throw std::invalid_argument if more than max_rails rails are configured,
+ * or RDMA/rail_weights does not have one positive weight per rail
+ */
+std::vector<RailConfig> get_configured_rails();
+
+/**
+ * Checks whether a rail's link is up, using the port state of an RDMA device
+ * or the operational state of a network interface. Returns true if the state
+ * can't be determined, e.g. for a loopback alias.
+ */
+bool rail_link_is_up(const std::string& domain);
+
+/**
+ * Gets the NUMA node an RDMA device or network interface is attached to.
+ * @return The node, or -1 if it is unknown or the machine has only one node
+ */
+int get_rail_numa_node(const std::string& domain);
+
+/**
+ * Builds the repeating sequence of rails that striped transfers cycle through,
+ * using smooth weighted round-robin so each rail's turns are spread evenly.
+ * Both ends of a connection build the same pattern from the same weights.
+ * @param weights The weight of each rail; rails with weight 0 are skipped
+ * @return Indices into weights, one per turn
+ */
+std::vector<uint32_t> make_stripe_pattern(const std::vector<uint32_t>& weights);
+
+/**
+ * Picks the rail that a connection between two nodes should use if it isn't
+ * striped. Different pairs of nodes are spread across the rails in proportion
+ * to the rails' weights, and both nodes pick the same rail.
+ * @param weights The weight of each rail, 0 for rails that are not usable by
+ * both nodes
+ * @return An index into weights
+ */
+uint32_t choose_pair_rail(node_id_t node_a, node_id_t node_b, const std::vector<uint32_t>& weights);
+
+}  // namespace derecho
@@ -13,6 +13,7 @@
 #include "derecho_internal.hpp"
 #include "derecho_sst.hpp"
 #include "persistence_manager.hpp"
+#include "registered_memory.hpp"
 
 #include <spdlog/spdlog.h>
 
@@ -98,6 +99,10 @@ struct DerechoParams : public mutils::ByteRepresentable {
             return rdmc::send_algorithm::SEQUENTIAL_SEND;
         } else if(rdmc_send_algorithm_string == "tree_send") {
             return rdmc::send_algorithm::TREE_SEND;
+        } else if(rdmc_send_algorithm_string == "hierarchical_send") {
+            return rdmc::send_algorithm::HIERARCHICAL_SEND;
+        } else if(rdmc_send_algorithm_string == "adaptive_send") {
+            return rdmc::send_algorithm::ADAPTIVE_SEND;
         } else {
             throw "wrong value for RDMC send algorithm: " + rdmc_send_algorithm_string + ". Check your config file.";
         }
@@ -177,14 +182,14 @@ struct DerechoParams : public mutils::ByteRepresentable {
  * This is a move-only type, since memory regions can't be copied.
  */
 struct MessageBuffer {
-    std::unique_ptr<uint8_t[]> buffer;
+    registered_array<uint8_t> buffer;
     std::shared_ptr<rdma::memory_region> mr;
 
     MessageBuffer() {}
     MessageBuffer(size_t size) {
         if(size != 0) {
-            buffer = std::unique_ptr<uint8_t[]>(new uint8_t[size]);
-            mr = std::make_shared<rdma::memory_region>(buffer.get(), size);
+            buffer = allocate_registered_memory(size);
+            mr = std::make_shared<rdma::memory_region>(buffer.get(), size, true);
         }
     }
     MessageBuffer(const MessageBuffer&) = delete;
@@ -295,6 +300,8 @@ private:
     const unsigned int num_members;
     /** index of the local node in the members vector, which should also be its row index in the SST */
     const int member_index;
+    /** The ID of the view this group belongs to */
+    const int32_t vid;
     /** Message-delivery event callbacks, supplied by the client, for "raw" sends */
     const UserMessageCallbacks callbacks;
     /** Other message-delivery event callbacks for internal components */
@@ -527,6 +534,7 @@ public:
      * Standard constructor for setting up a MulticastGroup for the first time.
      * @param members A list of node IDs of members in this group
      * @param my_node_id The rank (ID) of this node in the group
+     * @param vid The ID of the view this group belongs to
      * @param sst The SST this group will use; created by the GMS (membership
      * service) for this group.
      * @param callbacks A set of user-supplied functions to call when messages
@@ -544,7 +552,7 @@ public:
      * elements of _members are nodes that have already failed in this view
      */
     MulticastGroup(
-            std::vector<node_id_t> members, node_id_t my_node_id,
+            std::vector<node_id_t> members, node_id_t my_node_id, int32_t vid,
             std::shared_ptr<DerechoSST> sst,
             UserMessageCallbacks callbacks,
             MulticastGroupCallbacks internal_callbacks,
@@ -556,7 +564,7 @@ public:
     /** Constructor to initialize a new MulticastGroup from an old one,
      * preserving the same settings but providing a new list of members. */
     MulticastGroup(
-            std::vector<node_id_t> members, node_id_t my_node_id,
+            std::vector<node_id_t> members, node_id_t my_node_id, int32_t vid,
             std::shared_ptr<DerechoSST> sst,
             MulticastGroup&& old_group,
             uint32_t total_num_subgroups,
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <derecho/config.h>
+#include <derecho/core/detail/registered_memory.hpp>
 #ifdef USE_VERBS_API
 #include <derecho/sst/detail/verbs.hpp>
 #else
@@ -9,6 +10,7 @@
 #include <derecho/utils/logger.hpp>
 
 #include <atomic>
+#include <deque>
 #include <iostream>
 #include <map>
 #include <memory>
@@ -33,9 +35,23 @@ static const MESSAGE_TYPE p2p_message_types[] = {P2P_REPLY,
 static const uint8_t num_p2p_message_types = 3;
 
 struct ConnectionParams {
+    /**
+     * The number of message buffers of each type. A window size of 0 means
+     * the connection has no region for that message type at all (connections
+     * to external clients have no RPC_REPLY region, since external clients
+     * never receive ordered-send replies), so messages of that type must
+     * never be sent or probed for on the connection.
+     */
     uint32_t window_sizes[num_p2p_message_types];
     uint32_t max_msg_sizes[num_p2p_message_types];
     uint64_t offsets[num_p2p_message_types];
+    /**
+     * The offset of the counter the remote node writes to acknowledge that it
+     * has read another of this node's rendezvous replies
+     */
+    uint64_t rendezvous_ack_offset;
+    /** The maximum number of P2P requests that can wait for space in the window */
+    uint32_t overflow_queue_size;
 };
 
 /**
@@ -48,22 +64,79 @@ struct P2PBufferHandle {
     uint64_t seq_num;
 };
 
+/**
+ * A P2P request that was assigned a sequence number while the sending window
+ * was full. Its contents are written to a local buffer, and copied into the
+ * P2P buffer slot for its sequence number once a reply frees that slot.
+ */
+struct OverflowMessage {
+    uint64_t seq_num;
+    std::unique_ptr<uint8_t[]> buffer;
+    /** True once the sender has finished writing the message and called send() */
+    bool ready_to_send;
+};
+
+/**
+ * A registered local buffer holding a P2P message that was too large for its
+ * slot, bundled with the key the remote node needs in order to read it.
+ */
+struct RendezvousBufferHandle {
+    uint8_t* buf_ptr;
+    uint64_t rkey;
+};
+
 class P2PConnection {
     const uint32_t my_node_id;
     const uint32_t remote_id;
     const ConnectionParams& connection_params;
     std::shared_ptr<spdlog::logger> rpc_logger;
-    std::unique_ptr<volatile uint8_t[]> incoming_p2p_buffer;
-    std::unique_ptr<volatile uint8_t[]> outgoing_p2p_buffer;
+    derecho::registered_array<volatile uint8_t> incoming_p2p_buffer;
+    derecho::registered_array<volatile uint8_t> outgoing_p2p_buffer;
     std::unique_ptr<resources> res;
     std::map<MESSAGE_TYPE, std::atomic<uint64_t>> incoming_seq_nums_map, outgoing_seq_nums_map;
+    /**
+     * P2P requests that have sequence numbers beyond the end of the current
+     * sending window, in sequence-number order.
+     */
+    std::deque<OverflowMessage> overflow_queue;
+    /**
+     * Registered buffers holding oversized outgoing messages, indexed by
+     * message type and sequence number. Each one is kept until the remote
+     * node must have finished reading it.
+     */
+    std::map<MESSAGE_TYPE, std::map<uint64_t, std::unique_ptr<uint8_t[]>>> rendezvous_buffers;
+    /** The number of reply rendezvous buffers freed after the remote node acknowledged them */
+    uint64_t rendezvous_replies_released = 0;
+    /** The number of the remote node's rendezvous replies this node has read and acknowledged */
+    uint64_t rendezvous_replies_acknowledged = 0;
     uint64_t getOffsetSeqNum(MESSAGE_TYPE type, uint64_t seq_num);
     uint64_t getOffsetBuf(MESSAGE_TYPE type, uint64_t seq_num);
+    /** @return True if the P2P buffer slot for the given request sequence number is free */
+    bool request_slot_available(uint64_t seq_num);
+    /** Writes the sequence number guard of a message buffer and transfers it to the remote node */
+    void post_message(MESSAGE_TYPE type, uint64_t sequence_num);
+    /**
+     * Copies overflow messages into the sending window and sends them, in
+     * order, until the window is full or the next message is not ready.
+     */
+    void drain_overflow_queue();
+    /**
+     * Deregisters and frees the rendezvous buffers of the given type whose
+     * sequence numbers are lower than end_seq_num.
+     */
+    void release_rendezvous_buffers(MESSAGE_TYPE type, uint64_t end_seq_num);
+    /**
+     * Frees the reply rendezvous buffers that the remote node has acknowledged
+     * reading. It reads them in order, so its counter covers the oldest ones.
+     */
+    void release_acknowledged_replies();
 
 protected:
     friend class P2PConnectionManager;
     resources* get_res();
     uint32_t num_rdma_writes = 0;
+    /** The size of each of the incoming and outgoing P2P buffers */
+    const uint64_t p2p_buf_size;
 
 public:
     P2PConnection(uint32_t my_node_id, uint32_t remote_id, uint64_t p2p_buf_size,
@@ -73,33 +146,86 @@ public:
     /**
      * Returns the pair (pointer into an incoming message buffer, type of message)
      * if there is a new incoming message from the remote node, or std::nullopt if
-     * there are no new messages.
+     * there are no new messages. This also frees any reply rendezvous buffers
+     * the remote node has acknowledged.
      */
     std::optional<std::pair<uint8_t*, MESSAGE_TYPE>> probe();
     /**
      * Increments the incoming sequence number for the specified message type,
      * indicating that the caller is finished handling the current incoming
-     * message of that type.
+     * message of that type. Receiving a P2P reply frees a slot in the request
+     * window, so this also sends any overflow requests that now fit, and frees
+     * the rendezvous buffers of the requests it answers.
      */
     void increment_incoming_seq_num(MESSAGE_TYPE type);
+    /**
+     * @return The largest message of the specified type that fits in one of
+     * this connection's message buffers
+     */
+    std::size_t get_max_msg_size(MESSAGE_TYPE type) const;
     /**
      * Returns a MessageHandle containing a pointer to the beginning of the
      * next available message buffer for the specified message type and the
      * sequence number associated with that buffer, then increments the
-     * outgoing message sequence number. If no message buffer is available,
-     * returns std::nullopt and does not increment the outgoing sequence number.
+     * outgoing message sequence number. If the P2P request window is full,
+     * the buffer is a local overflow buffer that will be sent once the window
+     * has space. If the overflow queue is also full, returns std::nullopt and
+     * does not increment the outgoing sequence number.
      * @param type The message type, which identifies the buffer region to use.
      */
     std::optional<P2PBufferHandle> get_sendbuffer_ptr(MESSAGE_TYPE type);
+    /**
+     * @return True if get_sendbuffer_ptr() would currently succeed for the
+     * given message type, i.e. a sender would not have to wait.
+     */
+    bool has_send_space(MESSAGE_TYPE type);
     /**
      * Sends the message identified by the provided type and sequence number.
      * This may be used to send messages out of order (send a higher sequence
      * number before a lower sequence number), but messages will only be received
-     * by the remote node in order of increasing sequence numbers.
+     * by the remote node in order of increasing sequence numbers. If the message
+     * is in the overflow queue, it is only marked ready, and will be transferred
+     * once the window has space for it.
      * @param type The type of message being sent, which identifies the buffer region to use.
      * @param sequence_num The sequence number of the buffer to send.
      */
     void send(MESSAGE_TYPE type, uint64_t sequence_num);
+    /**
+     * Allocates a buffer for a message that is too large to fit in a P2P
+     * slot, and registers it for remote reads. The caller should put only a
+     * descriptor of this buffer in the P2P slot for the same sequence number.
+     * A request's buffer is freed once its reply arrives, and a reply's buffer
+     * once the remote node acknowledges reading it.
+     * @param type The type of the message, which must be P2P_REQUEST or P2P_REPLY
+     * @param sequence_num The sequence number of the P2P slot that will carry the descriptor
+     * @param size The size of the message in bytes
+     * @return The new buffer and its remote access key
+     */
+    RendezvousBufferHandle allocate_rendezvous_buffer(MESSAGE_TYPE type, uint64_t sequence_num, std::size_t size);
+    /**
+     * Starts reading a message that the remote node staged in a rendezvous
+     * buffer. The calling thread must then call wait_for_rendezvous_read(),
+     * which does not need the connection's lock.
+     * @param dest_buf The registered local buffer to read into, which must be at least size bytes
+     * @param remote_addr The address of the remote node's rendezvous buffer
+     * @param rkey The remote access key of the rendezvous buffer
+     * @param size The size of the message in bytes
+     * @throws derecho::derecho_exception if the read can't be posted
+     */
+    void post_rendezvous_read(uint8_t* dest_buf, uint64_t remote_addr, uint64_t rkey, std::size_t size);
+    /**
+     * Waits for the read started by this thread's last call to post_rendezvous_read().
+     * @param timeout_us How long to wait for the read to complete
+     * @throws derecho::derecho_exception if the read fails or times out
+     */
+    void wait_for_rendezvous_read(uint64_t timeout_us);
+    /**
+     * Tells the remote node that this node has finished reading another of
+     * its rendezvous replies, so it can free the buffer. Replies must be
+     * acknowledged in the order they were received, whether or not they
+     * could be read.
+     */
+    void acknowledge_rendezvous_reply();
 
     /**
      * Get remote access key of a memory region
@@ -114,9 +240,12 @@ public:
      * @param addr      The address of the memory region
      * @param size      The size in bytes of the memory region
      * @param attr      The memory's attribute
+     * @param use_registration_cache    Whether the registration may come from
+     *                  the registration cache
      * @throw           derecho::derecho_exception on failure
      */
-    static void register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr);
+    static void register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr,
+                                       bool use_registration_cache = true);
 
     /**
      * Deregister Out-of-band memory region
@@ -2,6 +2,7 @@
 
 #include <derecho/config.h>
 #include "p2p_connection.hpp"
+#include "registered_memory.hpp"
 #ifdef USE_VERBS_API
 #include <derecho/sst/detail/verbs.hpp>
 #else
@@ -26,10 +27,18 @@ typedef std::function<void(node_id_t)> failure_upcall_t;
 struct P2PParams {
     node_id_t my_node_id;
     uint32_t p2p_window_size;
+    uint32_t p2p_overflow_queue_size;
     uint32_t rpc_window_size;
     uint64_t max_p2p_reply_size;
     uint64_t max_p2p_request_size;
     uint64_t max_rpc_reply_size;
+    /** Window size of connections between members and external clients; 0 means p2p_window_size */
+    uint32_t external_p2p_window_size;
+    /**
+     * Size of the request and reply buffers in connections between members and
+     * external clients; 0 means the same sizes as connections between members.
+     */
+    uint64_t max_external_p2p_msg_size;
     bool is_external;
     failure_upcall_t failure_upcall;
 };
@@ -40,18 +49,70 @@ struct MessagePointer {
     MESSAGE_TYPE type;
 };
 
+class RendezvousBufferPool;
+
+/** Returns a buffer to its RendezvousBufferPool, or frees it if it must not be reused */
+struct pooled_buffer_deleter {
+    RendezvousBufferPool* pool = nullptr;
+    std::size_t capacity = 0;
+    derecho::registered_memory_deleter unmap;
+    /** False if an RDMA operation may still write to the buffer, so it must be deregistered and freed */
+    bool recycle = true;
+    void operator()(uint8_t* buffer) const;
+};
+
+/** A buffer holding a rendezvous message that was read from a remote node */
+using RendezvousReadBuffer = std::unique_ptr<uint8_t[], pooled_buffer_deleter>;
+
+/**
+ * Buffers that stay registered for OOB transfers, for reading rendezvous
+ * messages into, so that each read doesn't pay for registering and
+ * deregistering its destination. Buffers come in power-of-two sizes, and a
+ * few of each size are kept once they are returned.
+ */
+class RendezvousBufferPool {
+    friend struct pooled_buffer_deleter;
+    static constexpr std::size_t min_capacity = 64 * 1024;
+    static constexpr std::size_t buffers_per_capacity = 4;
+    std::mutex pool_mutex;
+    std::map<std::size_t, std::vector<derecho::registered_array<uint8_t>>> free_buffers;
+
+    void release(uint8_t* buffer, const pooled_buffer_deleter& deleter);
+
+public:
+    RendezvousBufferPool() = default;
+    /** Frees the pooled buffers; every buffer acquired from the pool must already have been returned. */
+    ~RendezvousBufferPool();
+    /**
+     * @return A registered buffer of at least size bytes
+     * @throws derecho::derecho_exception if the buffer can't be registered
+     */
+    RendezvousReadBuffer acquire(std::size_t size);
+};
+
 class P2PConnectionManager {
     const node_id_t my_node_id;
     /** A pointer to the RPC-module logger (since these P2P connections are used for Derecho RPC) */
     std::shared_ptr<spdlog::logger> rpc_logger;
+    /** The layout of the P2P buffers in connections between group members */
     ConnectionParams request_params;
+    /**
+     * The layout of the P2P buffers in connections between group members and
+     * external clients. These have no RPC reply region, since clients can't
+     * send ordered RPCs, and can use a smaller window and smaller buffers.
+     */
+    ConnectionParams external_params;
+    /** True if this node is an external client, so all its connections use external_params */
+    const bool is_external;
     /**
      * Contains one entry per possible Node ID; the vector index is the node ID.
      * Each entry is a pair consisting of a mutex protecting that entry and a
      * possibly-null pointer to a P2PConnection to the node ID indicated by the
-     * index. You must lock the mutex before accessing the pointer.
+     * index. You must lock the mutex before accessing the pointer. The
+     * pointer is shared only so that a rendezvous read can wait for its
+     * completion without holding the mutex.
      */
-    std::vector<std::pair<std::mutex, std::unique_ptr<P2PConnection>>> p2p_connections;
+    std::vector<std::pair<std::mutex, std::shared_ptr<P2PConnection>>> p2p_connections;
     /**
      * An array containing one Boolean value for each entry in p2p_connections
      * that serves as a hint for whether that entry is non-null. The values are
@@ -65,10 +126,23 @@ class P2PConnectionManager {
     char* active_p2p_connections;
 
     uint64_t p2p_buf_size;
+    uint64_t external_p2p_buf_size;
+    /** How long to wait for the remote read of a rendezvous message, in microseconds */
+    uint64_t rendezvous_timeout_us;
+    /** The buffers that rendezvous messages are read into */
+    RendezvousBufferPool rendezvous_read_buffers;
     std::atomic<bool> thread_shutdown{false};
     std::thread timeout_thread;
 
     void check_failures_loop();
+    /**
+     * Computes the offset of each message type's region in a P2P buffer with
+     * the given window sizes and message sizes.
+     * @return The total size of the P2P buffer
+     */
+    static uint64_t compute_offsets(ConnectionParams& params);
+    void add_connections(const std::vector<node_id_t>& node_ids,
+                         const ConnectionParams& params, uint64_t buf_size);
     failure_upcall_t failure_upcall;
     std::mutex connections_mutex;
 
@@ -78,6 +152,11 @@ public:
     void shutdown_failures_thread();
 
     void add_connections(const std::vector<node_id_t>& node_ids);
+    /**
+     * Adds connections to external clients, which use the smaller external
+     * connection layout instead of the one used between group members.
+     */
+    void add_external_connections(const std::vector<node_id_t>& node_ids);
     void remove_connections(const std::vector<node_id_t>& node_ids);
     bool contains_node(const node_id_t node_id);
 
@@ -87,12 +166,13 @@ public:
     std::vector<node_id_t> get_active_nodes();
     /**
      * @return the size of the byte array used for sending a single P2P reply
-     * in any of the P2P connections. No messages larger than this can be sent.
+     * in a P2P connection between group members. Larger replies must be sent through a
+     * rendezvous buffer (see allocate_rendezvous_buffer()).
      */
     std::size_t get_max_p2p_reply_size();
     /**
      * @return the size of the byte array used for sending a single RPC reply
-     * in any of the P2P connections. No messages larger than this can be sent.
+     * in a P2P connection between group members. No messages larger than this can be sent.
      */
     std::size_t get_max_rpc_reply_size();
     /**
@@ -112,7 +192,9 @@ public:
     /**
      * Returns a P2PBufferHandle for the next available message buffer
      * for the specified message type in the specified node's P2P connection
-     * channel, or std::nullopt if no such message buffer is available.
+     * channel, or std::nullopt if no such message buffer is available. If the
+     * P2P request window is full, the buffer may be an overflow buffer that
+     * will be sent once the window has space.
      * @param node_id The ID of the remote node that will be sent to
      * @param type The type of P2P message to send
      * @return A P2PBufferHandle containing a pointer to the beginning
@@ -129,6 +211,65 @@ public:
      * @param sequence_num The sequence number of the buffer to send.
      */
     void send(node_id_t node_id, MESSAGE_TYPE type, uint64_t sequence_num);
+    /**
+     * Checks whether get_sendbuffer_ptr() would currently return a buffer for
+     * the specified node and message type. This can be used as a back-pressure
+     * signal by senders that should not block, but it is only a hint, since
+     * another thread could take the last buffer before the caller does.
+     * @param node_id The ID of the remote node that will be sent to
+     * @param type The type of P2P message to send
+     * @return True if a message buffer is available
+     */
+    bool has_send_space(node_id_t node_id, MESSAGE_TYPE type);
+    /**
+     * Checks whether a P2P message of the given type and size is too large
+     * for a message buffer in the connection to the specified node, and must
+     * be sent through a rendezvous buffer. Senders should call this before
+     * get_sendbuffer_ptr(), so that a message that can't be sent at all does
+     * not use up a sequence number.
+     * @param node_id The ID of the remote node that will be sent to
+     * @param type The type of P2P message
+     * @param size The size of the message in bytes
+     * @return True if the message needs a rendezvous buffer
+     * @throws std::out_of_range if there is no connection to node_id
+     * @throws derecho::buffer_overflow_exception if the message needs a
+     * rendezvous buffer but the RDMA provider does not support out-of-band memory
+     */
+    bool needs_rendezvous(node_id_t node_id, MESSAGE_TYPE type, std::size_t size);
+    /**
+     * Allocates a registered buffer for a P2P message that is too large for
+     * the message buffer with the given type and sequence number, which
+     * must already have been obtained from get_sendbuffer_ptr(). The remote
+     * node can read the message directly from this buffer, so the message
+     * buffer only needs to carry a descriptor of it. The buffer is freed
+     * automatically once the remote node has finished handling the message.
+     * @param node_id The ID of the remote node that will be sent to
+     * @param type The type of P2P message, either P2P_REQUEST or P2P_REPLY
+     * @param sequence_num The sequence number of the message buffer
+     * @param size The size of the message in bytes
+     * @return A pointer to the new buffer and its remote access key
+     * @throws std::out_of_range if there is no connection to node_id
+     */
+    RendezvousBufferHandle allocate_rendezvous_buffer(node_id_t node_id, MESSAGE_TYPE type,
+                                                      uint64_t sequence_num, std::size_t size);
+    /**
+     * Reads a P2P message that a remote node staged in a rendezvous buffer
+     * into a pooled, pre-registered local buffer. The connection's lock is
+     * only held while the read is posted, not while it is in flight, so other
+     * traffic to the node is not held up. For a reply, the remote node is then
+     * told that it can free its buffer, even if the read failed; replies from
+     * a node must therefore be read one at a time, in the order they arrived.
+     * @param node_id The ID of the remote node that sent the message
+     * @param type The type of the message, P2P_REQUEST or P2P_REPLY
+     * @param remote_addr The address of the remote rendezvous buffer
+     * @param rkey The remote access key of the rendezvous buffer
+     * @param size The size of the message in bytes
+     * @return A buffer containing the message
+     * @throws derecho::derecho_exception if the read fails or times out, or
+     * there is no connection to node_id
+     */
+    RendezvousReadBuffer read_rendezvous_buffer(node_id_t node_id, MESSAGE_TYPE type, uint64_t remote_addr,
+                                                uint64_t rkey, std::size_t size);
     /**
      * Compares the set of P2P connections to a list of known live nodes and
      * removes any connections to nodes not in that list. This is used to
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <derecho/config.h>
+#include <derecho/tcp/tcp.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace derecho {
+
+/**
+ * Writes a stream of bytes to a TCP socket in fixed-size chunks, using a
+ * background thread for the blocking socket writes. This lets the caller
+ * serialize the next chunk of an object (e.g. with mutils::post_object) while
+ * the previous chunk is still being sent, instead of alternating between
+ * serializing and waiting on the network. Used for state transfer, where
+ * objects can be several GB in size.
+ */
+class PipelinedSocketWriter {
+    tcp::socket& sock;
+    const std::size_t chunk_size;
+    const std::size_t num_chunks;
+    /** Chunks that are free to be filled by write() */
+    std::deque<std::unique_ptr<uint8_t[]>> free_chunks;
+    /** Filled chunks waiting to be written to the socket, with their sizes */
+    std::deque<std::pair<std::unique_ptr<uint8_t[]>, std::size_t>> full_chunks;
+    /** The chunk currently being filled by write() */
+    std::unique_ptr<uint8_t[]> current_chunk;
+    std::size_t current_chunk_used;
+    /** Set if the background thread failed to write a chunk */
+    std::exception_ptr write_error;
+    bool shutdown;
+    std::mutex chunks_mutex;
+    std::condition_variable chunks_cv;
+    std::thread sender_thread;
+
+    void sender_loop();
+    /** Hands current_chunk to the sender thread and waits for a free chunk to replace it. */
+    void submit_current_chunk();
+
+public:
+    /**
+     * Creates a writer for a socket and starts its sender thread.
+     * @param sock The socket to write to, which must outlive this object
+     * @param chunk_size The size of each chunk, in bytes
+     * @param num_chunks The number of chunks that can be in flight at once;
+     * at least 2, so one can be filled while another is sent
+     */
+    PipelinedSocketWriter(tcp::socket& sock, std::size_t chunk_size, std::size_t num_chunks = 2);
+    /** Stops the sender thread, discarding any data that was not flushed. */
+    ~PipelinedSocketWriter();
+    /**
+     * Appends bytes to the stream. Blocks only if every chunk is full and
+     * waiting to be sent. Fragments at least as large as a chunk are not
+     * copied; they are sent by the calling thread once the earlier chunks
+     * have been sent.
+     * @throw a subclass of tcp::socket_error if an earlier chunk could not
+     * be written to the socket
+     */
+    void write(const uint8_t* bytes, std::size_t size);
+    /**
+     * Sends any partially-filled chunk and waits until all the bytes written
+     * so far have been written to the socket.
+     * @throw a subclass of tcp::socket_error if a chunk could not be written
+     */
+    void flush();
+};
+
+}  // namespace derecho
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <derecho/config.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace derecho {
+
+/** Unmaps memory from allocate_registered_memory. */
+struct registered_memory_deleter {
+    /** The length of the mapping, which is the allocation rounded up to whole pages */
+    std::size_t mapping_length = 0;
+    void operator()(const volatile void* buffer) const;
+};
+
+/** An array in memory from allocate_registered_memory */
+template <typename T>
+using registered_array = std::unique_ptr<T[], registered_memory_deleter>;
+
+/**
+ * Allocates zeroed memory for a buffer that will be registered for RDMA.
+ * According to DERECHO/registered_memory_pages, the memory is backed by 2 MB
+ * or 1 GB huge pages, falling back to transparent huge pages if none are
+ * available, or by transparent huge pages or normal pages. Buffers smaller
+ * than half a huge page use transparent huge pages instead, since each
+ * allocation is rounded up to whole pages. Unless
+ * DERECHO/registered_memory_numa_node says otherwise, it is placed on the
+ * NUMA node of the first rail's NIC, so the NIC doesn't reach across the
+ * interconnect for every transfer.
+ *
+ * The memory is mapped with mmap and released with munmap, so the
+ * registration cache sees it being freed.
+ * @param size The number of bytes; 0 returns an empty pointer
+ * @throw std::bad_alloc if the memory can't be mapped
+ */
+registered_array<uint8_t> allocate_registered_memory(std::size_t size);
+
+/**
+ * Checks whether a range of memory lies within a single live allocation from
+ * allocate_registered_memory. Only such memory is known to be released with
+ * munmap, so only its registrations can safely be cached.
+ * @param addr The start of the range
+ * @param size The length of the range, in bytes
+ */
+bool is_registered_memory(const void* addr, std::size_t size);
+
+struct registered_memory_statistics {
+    uint64_t allocations = 0;
+    /** Bytes mapped with explicit (hugetlbfs) huge pages */
+    uint64_t huge_page_bytes = 0;
+    /** Bytes mapped with transparent huge pages requested */
+    uint64_t transparent_huge_page_bytes = 0;
+    /** Bytes mapped with normal pages */
+    uint64_t normal_page_bytes = 0;
+    /** Allocations that asked for explicit huge pages and didn't get them */
+    uint64_t huge_page_fallbacks = 0;
+    /** Bytes placed on the NIC's NUMA node, or the configured one */
+    uint64_t numa_bound_bytes = 0;
+    /** Bytes mapped and not yet released */
+    uint64_t bytes_in_use = 0;
+};
+
+/**
+ * Returns the totals of all the registered memory allocated so far. The
+ * ViewManager logs them after each view change.
+ */
+registered_memory_statistics get_registered_memory_statistics();
+
+}  // namespace derecho
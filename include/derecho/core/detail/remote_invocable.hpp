@@ -95,7 +95,7 @@ struct RemoteInvoker<Tag, std::function<Ret(Args...)>> {
     struct send_return {
         std::size_t size;                            //The size of the message in bytes
         uint8_t* buf;                                //A pointer to the beginning of the message in its buffer
-        std::unique_ptr<QueryResults<Ret>> results;  //The QueryResults (futures) object for this RPC call
+        QueryResults<Ret> results;                   //The QueryResults (futures) object for this RPC call
         std::weak_ptr<PendingResults<Ret>> pending;  //A non-owning pointer to the PendingResults (promises) object for this RPC call
     };
 
@@ -109,37 +109,32 @@ struct RemoteInvoker<Tag, std::function<Ret(Args...)>> {
     send_return send(const std::function<uint8_t*(std::size_t)>& out_alloc,
                      const std::decay_t<Args>&... remote_args) {
         //Create a new PendingResults/QueryResults pair for this RPC
-        std::shared_ptr<PendingResults<Ret>> pending_results = std::make_shared<PendingResults<Ret>>();
-        std::unique_ptr<QueryResults<Ret>> query_results = pending_results->get_future();
-        //A heap-allocated shared_ptr to the PendingResults will be the "invocation ID" for this RPC message
-        std::shared_ptr<PendingResults<Ret>>* results_heap_ptr = nullptr;
-        //But void functions will never send replies, so we only need to keep track of the
-        //PendingResults if the return type is non-void
-        if constexpr(!std::is_void_v<Ret>) {
-            results_heap_ptr = new std::shared_ptr<PendingResults<Ret>>(pending_results);
-        }
-        pending_results->set_self_ptr(results_heap_ptr);
+        std::shared_ptr<PendingResults<Ret>> pending_results = PendingResults<Ret>::create();
+        QueryResults<Ret> query_results = pending_results->get_future();
+        //The address of the PendingResults will be the "invocation ID" for this RPC message.
+        //Void functions will never send replies, so the PendingResults only needs to keep
+        //itself alive until the replies arrive if the return type is non-void (otherwise
+        //hold_self_reference() returns nullptr).
+        PendingResults<Ret>* invocation_id = pending_results->hold_self_reference();
         //Compute the size of the message
-        std::size_t size = mutils::bytes_size(results_heap_ptr);
+        std::size_t size = mutils::bytes_size(invocation_id);
         size += (mutils::bytes_size(remote_args) + ... + 0);
 
         /*
          * Request message format:
          * ------------------------------------------------------------------------------
-         * | RPC header (added by   | address of a               | serialized function  |
-         * | RemoteInvokerForClass) | shared_ptr<PendingResults> | arguments            |
+         * | RPC header (added by   | address of the             | serialized function  |
+         * | RemoteInvokerForClass) | PendingResults             | arguments            |
          * ------------------------------------------------------------------------------
          */
         uint8_t* serialized_args = out_alloc(size);
         {
-            auto buf_ptr = serialized_args + mutils::to_bytes(results_heap_ptr, serialized_args);
-            auto check_size = mutils::bytes_size(results_heap_ptr) + serialize_all(buf_ptr, remote_args...);
+            auto buf_ptr = serialized_args + mutils::to_bytes(invocation_id, serialized_args);
+            auto check_size = mutils::bytes_size(invocation_id) + serialize_all(buf_ptr, remote_args...);
             assert_always(check_size == size);
         }
 
-        dbg_trace(RpcLoggerPtr::get(), "Ready to send an RPC call message with invocation ID {}", reinterpret_cast<uint64_t>(results_heap_ptr));
-        //The return struct can get a new weak_ptr, different from the one stored on the heap,
-        //since it will only be used by RPCManager (not the response message)
+        dbg_trace(RpcLoggerPtr::get(), "Ready to send an RPC call message with invocation ID {}", reinterpret_cast<uint64_t>(invocation_id));
         return send_return{size, serialized_args, std::move(query_results),
                            std::weak_ptr<PendingResults<Ret>>(pending_results)};
     }
@@ -157,29 +152,28 @@ struct RemoteInvoker<Tag, std::function<Ret(Args...)>> {
             const node_id_t& nid, const uint8_t* response,
             const std::function<definitely_uint8*(int)>&) {
         bool is_exception = response[0];
-        std::shared_ptr<PendingResults<Ret>>* results_heap_ptr;
-        std::memcpy(&results_heap_ptr, (response + 1), sizeof(results_heap_ptr));
-        dbg_trace(RpcLoggerPtr::get(), "Received an RPC response from node {} with invocation ID {}", nid, fmt::ptr(results_heap_ptr));
-        //Hold this lock while calling set_value and all_responded to ensure that
-        //only one thread will get all_responded = true and delete the pointer.
-        std::unique_lock<std::mutex> results_object_lock((*results_heap_ptr)->object_mutex());
+        PendingResults<Ret>* pending_results;
+        std::memcpy(&pending_results, (response + 1), sizeof(pending_results));
+        dbg_trace(RpcLoggerPtr::get(), "Received an RPC response from node {} with invocation ID {}", nid, fmt::ptr(pending_results));
+        //set_value and set_exception return true in exactly one thread, the one that
+        //recorded the last response, so only that thread will release the self-reference.
+        //No other thread may touch pending_results after that, since it could be deleted.
+        bool last_response;
         if(is_exception) {
-            auto exception_info = mutils::from_bytes_noalloc<remote_exception_info>(nullptr, response + 1 + sizeof(results_heap_ptr));
-            dbg_trace(RpcLoggerPtr::get(), "Received an exception from node {} in response to invocation ID {}", nid, fmt::ptr(results_heap_ptr));
+            auto exception_info = mutils::from_bytes_noalloc<remote_exception_info>(nullptr, response + 1 + sizeof(pending_results));
+            dbg_trace(RpcLoggerPtr::get(), "Received an exception from node {} in response to invocation ID {}", nid, fmt::ptr(pending_results));
             rls_default_error("Received an exception from node {}. Exception message: {}", nid, exception_info->exception_what);
-            (*results_heap_ptr)->set_exception(nid, std::make_exception_ptr(remote_exception_occurred{nid, exception_info->exception_name, exception_info->exception_what}));
+            last_response = pending_results->set_exception(nid, std::make_exception_ptr(remote_exception_occurred{nid, exception_info->exception_name, exception_info->exception_what}));
         } else {
-            dbg_trace(RpcLoggerPtr::get(), "Received an RPC response for invocation ID {} from node {}", fmt::ptr(results_heap_ptr), nid);
-            (*results_heap_ptr)->set_value(nid, *mutils::from_bytes<Ret>(dsm, response + 1 + sizeof(results_heap_ptr)));
+            dbg_trace(RpcLoggerPtr::get(), "Received an RPC response for invocation ID {} from node {}", fmt::ptr(pending_results), nid);
+            last_response = pending_results->set_value(nid, std::move(*mutils::from_bytes<Ret>(dsm, response + 1 + sizeof(pending_results))));
         }
         //If this was the last RPC reponse, RemoteInvoker no longer needs the PendingResults,
-        //so we can delete the shared_ptr to it. The PendingResults will get deleted when its
+        //so it can release the self-reference. The PendingResults will get deleted when its
         //QueryResults goes out of scope (if it hasn't already).
-        if((*results_heap_ptr)->all_responded()) {
-            results_object_lock.unlock();
-            //Note that delete_self_ptr() deletes results_heap_ptr
-            dbg_trace(RpcLoggerPtr::get(), "Calling delete_self_ptr on {}", fmt::ptr(results_heap_ptr));
-            (*results_heap_ptr)->delete_self_ptr();
+        if(last_response) {
+            dbg_trace(RpcLoggerPtr::get(), "Calling delete_self_ptr on {}", fmt::ptr(pending_results));
+            pending_results->delete_self_ptr();
         }
 
         return recv_ret{Opcode(), 0, nullptr, nullptr};
@@ -285,8 +279,8 @@ struct RemoteInvocable<Tag, std::function<Ret(Args...)>> {
         /*
          * Response message format:
          * --------------------------------------------------------------------------------------
-         * | is_exception | address of a                     | serialized response value OR     |
-         * |              | std::shared_ptr<PendingResults>  | serialized remote_exception_info |
+         * | is_exception | address of the                   | serialized response value OR     |
+         * |              | PendingResults                   | serialized remote_exception_info |
          * --------------------------------------------------------------------------------------
          */
         try {
@@ -734,14 +728,14 @@ public:
         */
         populate_header(buf, payload_size, invoker.invoke_opcode, nid, flags);
 
-        //sent_return.results is a unique_ptr<QueryResults<Ret>>
-        using Ret = typename decltype(sent_return.results)::element_type::type;
+        //sent_return.results is a QueryResults<Ret>
+        using Ret = typename decltype(sent_return.results)::type;
         /*
           much like previous definition, except with
           two fewer fields
         */
         struct send_return {
-            std::unique_ptr<QueryResults<Ret>> results;
+            QueryResults<Ret> results;
             std::weak_ptr<PendingResults<Ret>> pending;
         };
         return send_return{std::move(sent_return.results),
@@ -768,7 +762,7 @@ public:
 
     template <FunctionTag Tag, typename... Args>
     std::size_t get_size(Args&&... a) {
-        std::weak_ptr<PendingResults<void>>* invocation_id = nullptr;
+        PendingResults<void>* invocation_id = nullptr;
         std::size_t size = mutils::bytes_size(invocation_id);
         {
             auto t = {std::size_t{0}, std::size_t{0}, mutils::bytes_size(a)...};
@@ -855,14 +849,14 @@ public:
         }
         populate_header(buf, payload_size, invoker.invoke_opcode, nid, flags);
 
-        //sent_return.results is a unique_ptr<QueryResults<Ret>>
-        using Ret = typename decltype(sent_return.results)::element_type::type;
+        //sent_return.results is a QueryResults<Ret>
+        using Ret = typename decltype(sent_return.results)::type;
         /*
           much like previous definition, except with
           two fewer fields
         */
         struct send_return {
-            std::unique_ptr<QueryResults<Ret>> results;
+            QueryResults<Ret> results;
             std::weak_ptr<PendingResults<Ret>> pending;
         };
         return send_return{std::move(sent_return.results),
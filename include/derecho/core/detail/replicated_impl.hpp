@@ -8,6 +8,7 @@
 
 #include <functional>
 #include <mutex>
+#include <optional>
 #include <utility>
 
 namespace derecho {
@@ -108,26 +109,33 @@ auto Replicated<T>::p2p_send(node_id_t dest_node, Args&&... args) const {
         // Convert the user's desired tag into an "internal" function tag for a P2P function
         auto return_pair = wrapped_this->template send<rpc::to_internal_tag<true>(tag)>(
                 // Invoke the sending function with a buffer-allocator that uses the P2P request buffers
+                // (requests too large for a P2P request buffer are sent through a rendezvous buffer)
                 [this, &dest_node, &message_seq_num](std::size_t size) -> uint8_t* {
-                    const std::size_t max_p2p_request_payload_size = getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE);
-                    if(size <= max_p2p_request_payload_size) {
-                        auto buffer_handle = group_rpc_manager.get_sendbuffer_ptr(dest_node,
-                                                                                  sst::MESSAGE_TYPE::P2P_REQUEST);
-                        // Record the sequence number for this message buffer
-                        message_seq_num = buffer_handle.seq_num;
-                        return buffer_handle.buf_ptr;
-                    } else {
-                        throw buffer_overflow_exception("The size of a P2P message exceeds the maximum P2P message size.");
-                    }
+                    auto buffer_handle = group_rpc_manager.get_sendbuffer_ptr(dest_node,
+                                                                              sst::MESSAGE_TYPE::P2P_REQUEST, size);
+                    // Record the sequence number for this message buffer
+                    message_seq_num = buffer_handle.seq_num;
+                    return buffer_handle.buf_ptr;
                 },
                 std::forward<Args>(args)...);
         group_rpc_manager.send_p2p_message(dest_node, subgroup_id, message_seq_num, return_pair.pending);
-        return std::move(*return_pair.results);
+        return std::move(return_pair.results);
     } else {
         throw empty_reference_exception{"Attempted to use an empty Replicated<T>"};
     }
 }
 
+template <typename T>
+template <rpc::FunctionTag tag, typename... Args>
+auto Replicated<T>::try_p2p_send(node_id_t dest_node, Args&&... args) const {
+    std::optional<decltype(p2p_send<tag>(dest_node, std::forward<Args>(args)...))> results;
+    if(is_valid() && !group_rpc_manager.p2p_send_has_space(dest_node)) {
+        return results;
+    }
+    results.emplace(p2p_send<tag>(dest_node, std::forward<Args>(args)...));
+    return results;
+}
+
 template <typename T>
 template <rpc::FunctionTag tag, typename... Args>
 auto Replicated<T>::ordered_send(Args&&... args) {
@@ -137,7 +145,7 @@ auto Replicated<T>::ordered_send(Args&&... args) {
         using Ret = typename std::remove_pointer<decltype(wrapped_this->template getReturnType<rpc::to_internal_tag<false>(tag)>(
                 std::forward<Args>(args)...))>::type;
         // These pointers help "return" the PendingResults/QueryResults out of the lambda
-        std::unique_ptr<rpc::QueryResults<Ret>> results_ptr;
+        std::optional<rpc::QueryResults<Ret>> results;
         std::weak_ptr<rpc::PendingResults<Ret>> pending_ptr;
         auto serializer = [&](uint8_t* buffer) {
             // By the time this lambda runs, the current thread will be holding a read lock on view_mutex
@@ -152,7 +160,7 @@ auto Replicated<T>::ordered_send(Args&&... args) {
                         }
                     },
                     std::forward<Args>(args)...);
-            results_ptr = std::move(send_return_struct.results);
+            results.emplace(std::move(send_return_struct.results));
             pending_ptr = send_return_struct.pending;
         };
 
@@ -162,7 +170,7 @@ auto Replicated<T>::ordered_send(Args&&... args) {
                     ->multicast_group->send(subgroup_id, payload_size_for_multicast_send, serializer, true);
         });
         group_rpc_manager.register_rpc_results(subgroup_id, pending_ptr);
-        return std::move(*results_ptr);
+        return std::move(*results);
     } else {
         throw empty_reference_exception{"Attempted to use an empty Replicated<T>"};
     }
@@ -192,10 +200,24 @@ void Replicated<T>::send_object(tcp::socket& receiver_socket) const {
 
 template <typename T>
 void Replicated<T>::send_object_raw(tcp::socket& receiver_socket) const {
-    auto bind_socket_write = [&receiver_socket](const uint8_t* bytes, std::size_t size) {
-        receiver_socket.write(bytes, size);
+    const std::size_t chunk_size = getConfUInt64(Conf::DERECHO_STATE_TRANSFER_CHUNK_SIZE);
+    if(chunk_size == 0) {
+        // Serialize straight into the socket, but gather small fragments so each one isn't a system call
+        VectoredSocketWriter socket_writer(receiver_socket);
+        auto bind_socket_write = [&socket_writer](const uint8_t* bytes, std::size_t size) {
+            socket_writer.write(bytes, size);
+        };
+        mutils::post_object(bind_socket_write, **user_object_ptr);
+        socket_writer.flush();
+        return;
+    }
+    // Serialize into chunks that a background thread sends, so serialization overlaps with the network
+    PipelinedSocketWriter chunk_writer(receiver_socket, chunk_size);
+    auto bind_chunk_write = [&chunk_writer](const uint8_t* bytes, std::size_t size) {
+        chunk_writer.write(bytes, size);
     };
-    mutils::post_object(bind_socket_write, **user_object_ptr);
+    mutils::post_object(bind_chunk_write, **user_object_ptr);
+    chunk_writer.flush();
 }
 
 template <typename T>
@@ -276,6 +298,11 @@ persistent::version_t Replicated<T>::get_minimum_latest_persisted_version() {
     return persistent_registry->getMinimumLatestPersistedVersion();
 }
 
+template <typename T>
+bool Replicated<T>::can_rebuild_from_log() const {
+    return persistent_registry->canRebuildFromLog();
+}
+
 template <typename T>
 void Replicated<T>::post_next_version(persistent::version_t version, uint64_t ts_us) {
     current_version = version;
@@ -364,20 +391,15 @@ auto PeerCaller<T>::p2p_send(node_id_t dest_node, Args&&... args) {
         uint64_t message_seq_num;
         auto return_pair = wrapped_this->template send<rpc::to_internal_tag<true>(tag)>(
                 [this, &dest_node, &message_seq_num](size_t size) -> uint8_t* {
-                    const std::size_t max_payload_size = group_rpc_manager.view_manager.get_max_payload_sizes().at(subgroup_id);
-                    if(size <= max_payload_size) {
-                        auto buffer_handle = group_rpc_manager.get_sendbuffer_ptr(dest_node,
-                                                                                  sst::MESSAGE_TYPE::P2P_REQUEST);
-                        // Record the sequence number for this message buffer
-                        message_seq_num = buffer_handle.seq_num;
-                        return buffer_handle.buf_ptr;
-                    } else {
-                        throw buffer_overflow_exception("The size of a P2P message exceeds the maximum P2P message size.");
-                    }
+                    auto buffer_handle = group_rpc_manager.get_sendbuffer_ptr(dest_node,
+                                                                              sst::MESSAGE_TYPE::P2P_REQUEST, size);
+                    // Record the sequence number for this message buffer
+                    message_seq_num = buffer_handle.seq_num;
+                    return buffer_handle.buf_ptr;
                 },
                 std::forward<Args>(args)...);
         group_rpc_manager.send_p2p_message(dest_node, subgroup_id, message_seq_num, return_pair.pending);
-        return std::move(*return_pair.results);
+        return std::move(return_pair.results);
     } else {
         throw empty_reference_exception{"Attempted to use an empty Replicated<T>"};
     }
@@ -408,25 +430,60 @@ auto ExternalClientCallback<T>::p2p_send(node_id_t dest_node, Args&&... args) {
         uint64_t message_seq_num;
         auto return_pair = wrapped_this->template send<rpc::to_internal_tag<true>(tag)>(
                 [this, &dest_node, &message_seq_num](size_t size) -> uint8_t* {
-                    const std::size_t max_payload_size = getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE);
-                    if(size <= max_payload_size) {
-                        auto buffer_handle = group_rpc_manager.get_sendbuffer_ptr(dest_node,
-                                                                                  sst::MESSAGE_TYPE::P2P_REQUEST);
-                        // Record the sequence number for this message buffer
-                        message_seq_num = buffer_handle.seq_num;
-                        return buffer_handle.buf_ptr;
-                    } else {
-                        throw buffer_overflow_exception("The size of a P2P message exceeds the maximum P2P message size.");
-                    }
+                    auto buffer_handle = group_rpc_manager.get_sendbuffer_ptr(dest_node,
+                                                                              sst::MESSAGE_TYPE::P2P_REQUEST, size);
+                    // Record the sequence number for this message buffer
+                    message_seq_num = buffer_handle.seq_num;
+                    return buffer_handle.buf_ptr;
                 },
                 std::forward<Args>(args)...);
         group_rpc_manager.send_p2p_message(dest_node, subgroup_id, message_seq_num, return_pair.pending);
-        return std::move(*return_pair.results);
+        return std::move(return_pair.results);
     } else {
         throw empty_reference_exception{"Attempted to use an empty Replicated<T>"};
     }
 }
 
+template <typename T>
+template <rpc::FunctionTag tag, typename... Args>
+auto ExternalClientCallback<T>::try_p2p_send(node_id_t dest_node, Args&&... args) {
+    std::optional<decltype(p2p_send<tag>(dest_node, std::forward<Args>(args)...))> results;
+    if(is_valid() && !group_rpc_manager.p2p_send_has_space(dest_node)) {
+        return results;
+    }
+    results.emplace(p2p_send<tag>(dest_node, std::forward<Args>(args)...));
+    return results;
+}
+
+template <typename T>
+template <typename CopyOfT>
+std::enable_if_t<std::is_base_of_v<derecho::NotificationSupport, CopyOfT>, NotificationDispatcher&>
+ExternalClientCallback<T>::get_notification_dispatcher(const NotificationDispatcherOptions& options) {
+    std::lock_guard<std::mutex> lock(dispatcher_mutex);
+    if(!notification_dispatcher) {
+        NotificationDispatcherOptions dispatcher_options = options;
+        if(dispatcher_options.max_batch_bytes == 0) {
+            uint64_t max_payload_size = getConfUInt64(Conf::DERECHO_MAX_EXTERNAL_P2P_PAYLOAD_SIZE);
+            if(max_payload_size == 0) {
+                max_payload_size = getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE);
+            }
+            // Leave room for the message_type and size fields of the NotificationMessage that wraps the batch
+            const std::size_t batch_header_size = sizeof(uint64_t) + sizeof(std::size_t);
+            dispatcher_options.max_batch_bytes = max_payload_size > batch_header_size
+                                                         ? max_payload_size - batch_header_size
+                                                         : 1;
+        }
+        // The dispatcher's thread must never block on a slow client, so it uses try_p2p_send
+        // and leaves the client's notifications queued if the connection is full
+        notification_dispatcher = std::make_unique<NotificationDispatcher>(
+                [this](node_id_t client_id, const NotificationMessage& message) {
+                    return try_p2p_send<RPC_NAME(notify)>(client_id, message).has_value();
+                },
+                dispatcher_options);
+    }
+    return *notification_dispatcher;
+}
+
 template <typename T>
 template <rpc::FunctionTag tag, typename... Args>
 auto ShardIterator<T>::p2p_send(Args&&... args) {
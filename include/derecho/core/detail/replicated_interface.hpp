@@ -23,6 +23,7 @@ public:
     virtual bool is_persistent() const = 0;
     virtual bool is_signed() const = 0;
     virtual persistent::version_t get_minimum_latest_persisted_version() = 0;
+    virtual bool can_rebuild_from_log() const = 0;
     virtual std::vector<uint8_t> get_signature(persistent::version_t version) = 0;
     virtual bool verify_log(persistent::version_t version, openssl::Verifier& verifier,
                             const uint8_t* signature) = 0;
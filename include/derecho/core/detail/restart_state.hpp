@@ -11,6 +11,7 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -135,15 +136,53 @@ private:
     const node_id_t my_id;
 
     /**
-     * Helper method for await_quorum that processes the logged View and
-     * RaggedTrims from a single rejoining node. This may update curr_view or
-     * logged_ragged_trim if the joiner has newer information.
-     * @param joiner_id The ID of the rejoining node
+     * How long await_quorum waits for a new connection before checking
+     * whether any rejoining nodes have finished sending their logs.
+     */
+    static constexpr int rejoin_poll_interval_ms = 50;
+
+    /**
+     * Everything a rejoining node sends the restart leader before it starts
+     * waiting for the restart view.
+     */
+    struct RejoinedNode {
+        node_id_t id;
+        IpAndPorts ips_and_ports;
+        tcp::socket socket;
+        std::unique_ptr<View> logged_view;
+        std::vector<std::unique_ptr<RaggedTrim>> ragged_trims;
+    };
+
+    /**
+     * Helper method for await_quorum that does the whole handshake with a
+     * single rejoining node: checks its version code, reads its join request
+     * and ports, and receives its logged View and RaggedTrims. It only uses
+     * the socket, not the leader's state, so it can run on a separate thread
+     * for each rejoining node.
      * @param client_socket The TCP socket connected to the rejoining node
+     * @return The node's information, or std::nullopt if the node was rejected
+     * or disconnected (crashed) before sending all of it
+     */
+    std::optional<RejoinedNode> receive_rejoin(tcp::socket client_socket);
+
+    /**
+     * Helper method for receive_rejoin that receives the logged View and
+     * RaggedTrims from a single rejoining node.
+     * @param rejoined The node's information, whose logged_view and
+     * ragged_trims will be filled in
      * @return True if the logs were received successfully, false if the client
      * disconnected (crashed) while sending them
      */
-    bool receive_joiner_logs(const node_id_t& joiner_id, tcp::socket& client_socket);
+    bool receive_joiner_logs(RejoinedNode& rejoined);
+
+    /**
+     * Helper method for await_quorum that adds a rejoined node to the set of
+     * nodes waiting for the restart view and processes its logged View and
+     * RaggedTrims. This may update curr_view or logged_ragged_trim if the
+     * joiner has newer information.
+     * @param rejoined The node's information, as returned by receive_rejoin
+     */
+    void merge_joiner_logs(RejoinedNode&& rejoined);
 
     /**
      * Recomputes the restart view based on the current set of nodes that have
@@ -169,7 +208,9 @@ public:
      * Waits for nodes to rejoin at this node, updating the last known View and
      * RaggedTrim (and corresponding longest-log information) as each node connects,
      * until there is a quorum of nodes from the last known View and a new View
-     * can be installed that is adequately provisioned.
+     * can be installed that is adequately provisioned. Rejoining nodes are
+     * received concurrently, one thread per node, and the nodes that finished
+     * sending their logs are merged in a batch before checking for a quorum.
      * @param server_socket The TCP socket to listen for rejoining nodes on
      */
     void await_quorum(tcp::connection_listener& server_socket);
@@ -203,6 +203,25 @@ class RPCManager {
     std::mutex request_queue_mutex;
     /** Notified when the request worker thread has work to do. */
     std::condition_variable request_queue_cv;
+    /** The thread that reads and handles oversized P2P replies; implemented by rendezvous_reply_worker() */
+    std::thread rendezvous_reply_thread;
+    /** A P2P reply that must be read from the sender's rendezvous buffer */
+    struct rendezvous_reply {
+        node_id_t sender_id;
+        remote_invocation_utilities::RendezvousDescriptor descriptor;
+    };
+    /** Oversized P2P replies, in the order they arrived, which must be read in that order */
+    std::queue<rendezvous_reply> rendezvous_reply_queue;
+    std::mutex rendezvous_reply_mutex;
+    /** Notified when the rendezvous reply thread has work to do. */
+    std::condition_variable rendezvous_reply_cv;
+    /**
+     * The P2P message buffer and rendezvous buffer of each oversized request
+     * that has been staged but not yet sent, by destination node and sequence
+     * number, so send_p2p_message can complete the rendezvous message.
+     */
+    std::map<std::pair<node_id_t, uint64_t>, std::pair<uint8_t*, uint8_t*>> staged_rendezvous_requests;
+    std::mutex staged_rendezvous_requests_mutex;
 
     /** The caller id of the latest rpc */
     static thread_local node_id_t rpc_caller_id;
@@ -213,6 +232,18 @@ class RPCManager {
     /** Handles non-cascading P2P Send requests in FIFO order. */
     void p2p_request_worker();
 
+    /**
+     * Reads oversized P2P replies from their senders' memory and handles
+     * them, so that a large reply doesn't hold up the P2P listening thread.
+     */
+    void rendezvous_reply_worker();
+
+    /**
+     * Handles a P2P reply whose full message is in msg_buf. The caller must
+     * hold a shared lock on the current View.
+     */
+    void handle_p2p_reply(node_id_t sender_id, uint8_t* msg_buf);
+
     /**
      * Handler to be called by p2p_receive_loop each time it receives a
      * peer-to-peer message over an RDMA P2P connection.
@@ -221,6 +252,72 @@ class RPCManager {
      */
     void p2p_message_handler(node_id_t sender_id, uint8_t* msg_buf);
 
+    /**
+     * Stages an outgoing P2P message that is too large for its P2P message
+     * buffer: allocates a registered rendezvous buffer for it, and fills the
+     * P2P message buffer with a descriptor that the receiver can use to read
+     * the rendezvous buffer.
+     * @param dest_id The ID of the node the message will be sent to
+     * @param type The type of the P2P message
+     * @param msg_buffer The P2P message buffer obtained for the message
+     * @param size The size of the message, including its header
+     * @return A pointer to the rendezvous buffer, which the message should be
+     * written to instead of the P2P message buffer
+     */
+    uint8_t* stage_rendezvous_message(node_id_t dest_id, sst::MESSAGE_TYPE type,
+                                      const sst::P2PBufferHandle& msg_buffer, std::size_t size);
+
+    /**
+     * Reads the message described by a rendezvous message (one with the
+     * RENDEZVOUS header flag) from the sender's memory.
+     * @param sender_id The ID of the node that sent the rendezvous message
+     * @param type The type of the message, P2P_REQUEST or P2P_REPLY
+     * @param descriptor The descriptor carried by the rendezvous message
+     * @return A buffer containing the full message, including its header
+     */
+    sst::RendezvousReadBuffer read_rendezvous_message(node_id_t sender_id, sst::MESSAGE_TYPE type,
+                                                      const remote_invocation_utilities::RendezvousDescriptor& descriptor);
+
+    /**
+     * Answers a P2P request for a subgroup this node does not host with a
+     * reply that has the STALE_VIEW header flag set, so that the sender (most
+     * likely an external client with an old View) can refresh its View
+     * instead of waiting forever for a real reply.
+     * @param dest_id The ID of the node that sent the request
+     * @param request_opcode The opcode of the request that could not be handled
+     * @param invocation_id The invocation ID of the request, which the reply
+     * carries so the sender can fail only that call
+     */
+    void send_stale_view_reply(node_id_t dest_id, const Opcode& request_opcode, void* invocation_id);
+
+    /**
+     * Answers a P2P request for a function this node does not have, in a
+     * subgroup it does host, with an exception reply, since the sender's View
+     * is not the problem.
+     * @param dest_id The ID of the node that sent the request
+     * @param request_opcode The opcode of the request that could not be handled
+     * @param invocation_id The invocation ID of the request
+     */
+    void send_unknown_function_reply(node_id_t dest_id, const Opcode& request_opcode, void* invocation_id);
+
+    /**
+     * Answers a P2P request with an exception reply, in the same format as
+     * the ones built by RemoteInvocable::receive_call, so that the sender's
+     * QueryResults throws remote_exception_occurred.
+     * @param dest_id The ID of the node that sent the request
+     * @param request_opcode The opcode of the request that failed
+     * @param invocation_id The invocation ID of the request
+     * @param exception_info The exception to report to the sender
+     */
+    void send_exception_reply(node_id_t dest_id, const Opcode& request_opcode, void* invocation_id,
+                              const remote_exception_info& exception_info);
+
+    /**
+     * @return True if this node has receivers for any function of the
+     * subgroup addressed by the given opcode
+     */
+    bool hosts_subgroup(const Opcode& opcode) const;
+
     /**
      * Reports to the view manager that the given node has failed if it's an
      * internal member, or removes its global SST connection if it's an external member.
@@ -407,12 +504,33 @@ public:
     /**
      * Retrieves a buffer for sending P2P messages from the RPCManager's pool of
      * P2P RDMA connections. After filling it with data, the next call to
-     * send_p2p_message will send it.
+     * send_p2p_message will send it. If the connection's P2P window and
+     * overflow queue are both full, this blocks until a reply frees space.
      * @param dest_id The ID of the node that the P2P message will be sent to
      * @param type The type of P2P message that will be sent
      */
     sst::P2PBufferHandle get_sendbuffer_ptr(uint32_t dest_id, sst::MESSAGE_TYPE type);
 
+    /**
+     * Retrieves a buffer for sending a P2P message of a specific size. If the
+     * message fits in a P2P message buffer this is the same as
+     * get_sendbuffer_ptr(dest_id, type); otherwise the returned pointer is to
+     * a registered rendezvous buffer that the receiver will read the message
+     * from, and the P2P message buffer only carries a descriptor of it.
+     * @param dest_id The ID of the node that the P2P message will be sent to
+     * @param type The type of P2P message that will be sent
+     * @param size The size of the message, including its header
+     */
+    sst::P2PBufferHandle get_sendbuffer_ptr(uint32_t dest_id, sst::MESSAGE_TYPE type, std::size_t size);
+
+    /**
+     * Checks whether get_sendbuffer_ptr() could currently return a buffer for
+     * a P2P request to the specified node without blocking.
+     * @param dest_id The ID of the node that the P2P message will be sent to
+     * @return True if there is space in the node's P2P window or overflow queue
+     */
+    bool p2p_send_has_space(uint32_t dest_id);
+
     /**
      * Sends the P2P message buffer with the specified sequence number over an RDMA
      * connection to the specified node, and registers the "promise object" pointed
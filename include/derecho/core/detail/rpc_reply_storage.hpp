@@ -0,0 +1,396 @@
+/**
+ * @file rpc_reply_storage.hpp
+ *
+ * Low-level building blocks used by PendingResults and QueryResults to collect
+ * RPC replies without allocating a separate shared state for every reply.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace derecho {
+
+namespace rpc {
+
+/**
+ * The number of reply slots that a PendingResults stores inline, without a
+ * separate heap allocation. Shards with more members than this will spill
+ * their reply slots to the heap.
+ */
+constexpr std::size_t DERECHO_INLINE_REPLY_SLOTS = 8;
+
+/**
+ * The maximum number of recycled PendingResults allocations that a single
+ * thread will cache in its free list.
+ */
+constexpr std::size_t DERECHO_PENDING_RESULTS_POOL_SIZE = 256;
+
+/**
+ * A single wait primitive shared by all of the events tracked by one RPC
+ * call (every reply, plus the version and persistence events). Waiters block
+ * on a condition variable until a caller-supplied predicate becomes true;
+ * notifiers only touch the mutex if some thread is actually waiting, so
+ * fulfilling an event that nobody is waiting for costs a single atomic load.
+ *
+ * The predicate must read state that is published with sequentially-consistent
+ * atomic stores before notify() is called.
+ */
+class CompletionSignal {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<uint32_t> num_waiters{0};
+
+public:
+    /** Blocks until ready() returns true. */
+    template <typename Predicate>
+    void wait(Predicate ready) {
+        if(ready()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        num_waiters++;
+        cv.wait(lock, ready);
+        num_waiters--;
+    }
+
+    /**
+     * Blocks until ready() returns true or the timeout expires.
+     * @return The final value of ready()
+     */
+    template <typename Predicate, typename Rep, typename Period>
+    bool wait_for(Predicate ready, const std::chrono::duration<Rep, Period>& timeout) {
+        if(ready()) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        num_waiters++;
+        bool result = cv.wait_for(lock, timeout, ready);
+        num_waiters--;
+        return result;
+    }
+
+    /** Wakes up all waiting threads so they can re-check their predicates. */
+    void notify() {
+        if(num_waiters.load() > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_all();
+        }
+    }
+};
+
+/**
+ * A function that runs a completion callback somewhere other than the thread
+ * that detected the completion, e.g. by posting it to a thread pool or an event
+ * loop. An empty completion_executor_t means "run the callback inline".
+ */
+using completion_executor_t = std::function<void(std::function<void()>)>;
+
+/**
+ * The callbacks registered on the events of one RPC call. Each callback waits
+ * for any one of a set of event bits, and runs exactly once: either when it
+ * is registered, if one of its events has already happened, or when the first
+ * of its events is raised. Raising an event when no callback was ever
+ * registered costs a single atomic load.
+ *
+ * While any callback is pending, the list holds an owning reference to the
+ * object that the events belong to, so that callers can register a callback
+ * and then drop their own handle to the RPC call.
+ */
+class EventCallbacks {
+public:
+    using callback_t = std::function<void()>;
+
+    /**
+     * The callbacks removed from the list by collect(). The caller should run
+     * the ready callbacks, then let this object go out of scope, which may
+     * release the last reference to the owner of the list.
+     */
+    struct Collected {
+        std::shared_ptr<void> released_owner;
+        std::vector<callback_t> dropped;
+        std::vector<callback_t> ready;
+    };
+
+private:
+    struct Entry {
+        uint32_t event_mask;
+        callback_t callback;
+    };
+    std::mutex mutex;
+    std::vector<Entry> entries;
+    std::shared_ptr<void> owner_reference;
+    std::atomic<bool> any_registered{false};
+
+public:
+    /**
+     * Registers a callback for the events in event_mask.
+     * @param event_mask The event bits that should trigger the callback
+     * @param callback The callback, which is moved into the list only if it
+     * was stored
+     * @param events The current event bitmask of the owner
+     * @param never_happening A bitmask of the owner's events that will never be raised
+     * @param owner A reference to the owner, kept until no callbacks are pending
+     * @return True if one of the events has already happened, in which case
+     * the callback was not stored and the caller should run it immediately.
+     */
+    bool add(uint32_t event_mask, callback_t& callback, const std::atomic<uint32_t>& events,
+             const std::atomic<uint32_t>& never_happening, std::shared_ptr<void> owner) {
+        //This must be stored before events is read, so that a concurrent
+        //collect() either sees the flag or this function sees the event
+        any_registered.store(true);
+        std::lock_guard<std::mutex> lock(mutex);
+        if(events.load() & event_mask) {
+            return true;
+        }
+        if((event_mask & ~never_happening.load()) == 0) {
+            //None of the events can happen any more, so the callback will never run
+            return false;
+        }
+        entries.push_back(Entry{event_mask, std::move(callback)});
+        if(!owner_reference) {
+            owner_reference = std::move(owner);
+        }
+        return false;
+    }
+
+    /**
+     * Removes the callbacks whose events have happened, as well as the
+     * callbacks that can never run because all of their events are in
+     * never_happening.
+     * @param events The current event bitmask of the owner
+     * @param never_happening A bitmask of events that will never be raised
+     */
+    Collected collect(const std::atomic<uint32_t>& events, uint32_t never_happening) {
+        Collected result;
+        if(!any_registered.load()) {
+            return result;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        const uint32_t current_events = events.load();
+        auto kept_end = entries.begin();
+        for(auto iter = entries.begin(); iter != entries.end(); ++iter) {
+            if(iter->event_mask & current_events) {
+                result.ready.emplace_back(std::move(iter->callback));
+            } else if((iter->event_mask & ~never_happening) == 0) {
+                result.dropped.emplace_back(std::move(iter->callback));
+            } else {
+                if(kept_end != iter) {
+                    *kept_end = std::move(*iter);
+                }
+                ++kept_end;
+            }
+        }
+        entries.erase(kept_end, entries.end());
+        if(entries.empty()) {
+            result.released_owner = std::move(owner_reference);
+        }
+        return result;
+    }
+};
+
+/**
+ * A fixed-size array whose size is chosen once at runtime. Arrays of up to
+ * InlineCapacity elements live inside the object itself; larger arrays are
+ * allocated on the heap. The elements are default-constructed in place and
+ * never moved, so T does not need to be movable.
+ */
+template <typename T, std::size_t InlineCapacity>
+class InlineArray {
+    std::array<T, InlineCapacity> inline_storage;
+    std::unique_ptr<T[]> heap_storage;
+    std::size_t count = 0;
+
+public:
+    InlineArray() = default;
+    InlineArray(const InlineArray&) = delete;
+    InlineArray& operator=(const InlineArray&) = delete;
+
+    /**
+     * Sets the number of elements in the array. This can only be called
+     * once, since existing elements are never relocated.
+     */
+    void resize(std::size_t new_size) {
+        assert(count == 0);
+        if(new_size > InlineCapacity) {
+            heap_storage.reset(new T[new_size]);
+        }
+        count = new_size;
+    }
+
+    T* data() { return heap_storage ? heap_storage.get() : inline_storage.data(); }
+    const T* data() const { return heap_storage ? heap_storage.get() : inline_storage.data(); }
+    std::size_t size() const { return count; }
+    T* begin() { return data(); }
+    T* end() { return data() + count; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + count; }
+    T& operator[](std::size_t i) { return data()[i]; }
+    const T& operator[](std::size_t i) const { return data()[i]; }
+};
+
+/**
+ * An allocator that recycles single-object allocations through per-thread
+ * pools. It is intended for std::allocate_shared, so that creating and
+ * destroying the shared state of an RPC call (the object plus its shared_ptr
+ * control block) does not go through the global heap in steady state.
+ *
+ * Each block records the pool it came from, and always goes back to that
+ * pool: the RPC call that a thread creates is usually destroyed by the thread
+ * that receives its last reply, and if blocks stayed with the freeing thread
+ * the caller's pool would drain and every call would hit the heap again.
+ * Blocks freed by the owning thread go straight onto its free list; blocks
+ * freed by other threads go onto a locked return list, which the owner takes
+ * over whenever its own list runs out.
+ */
+template <typename T>
+class PooledAllocator {
+    struct Pool {
+        /** Only touched by the thread that owns the pool */
+        std::vector<void*> blocks;
+        std::mutex returned_mutex;
+        /** Blocks freed by other threads, guarded by returned_mutex */
+        std::vector<void*> returned;
+        /** Set under returned_mutex when the owning thread exits, after which nothing is returned */
+        bool owner_exited = false;
+        /** Lets the owner check for returned blocks without taking the lock */
+        std::atomic<bool> has_returned{false};
+        /**
+         * One for the owning thread, plus one for each block that is
+         * allocated and not yet freed. Whoever drops it to zero deletes the
+         * pool, since blocks can outlive the thread that allocated them.
+         */
+        std::atomic<std::size_t> references{1};
+
+        Pool() { blocks.reserve(DERECHO_PENDING_RESULTS_POOL_SIZE); }
+
+        void release() {
+            if(references.fetch_sub(1) == 1) {
+                delete this;
+            }
+        }
+    };
+
+    /** Sits in front of each block, so that it can find its way home */
+    struct alignas(std::max_align_t) BlockHeader {
+        Pool* owner;
+    };
+    static_assert(alignof(T) <= alignof(std::max_align_t), "PooledAllocator does not support over-aligned types");
+
+    struct PoolHandle {
+        Pool* pool = new Pool;
+        ~PoolHandle() {
+            std::vector<void*> unused = std::move(pool->blocks);
+            {
+                std::lock_guard<std::mutex> lock(pool->returned_mutex);
+                pool->owner_exited = true;
+                unused.insert(unused.end(), pool->returned.begin(), pool->returned.end());
+                pool->returned.clear();
+            }
+            for(void* block : unused) {
+                ::operator delete(block);
+            }
+            pool_destroyed() = true;
+            pool->release();
+        }
+    };
+    /** Set once the calling thread's pool has been handed off (at thread exit). */
+    static bool& pool_destroyed() {
+        static thread_local bool destroyed = false;
+        return destroyed;
+    }
+    /** @return The calling thread's pool, or nullptr if the thread is exiting */
+    static Pool* thread_pool() {
+        if(pool_destroyed()) {
+            return nullptr;
+        }
+        static thread_local PoolHandle handle;
+        return handle.pool;
+    }
+    static BlockHeader* header_of(T* ptr) {
+        return reinterpret_cast<BlockHeader*>(ptr) - 1;
+    }
+
+public:
+    using value_type = T;
+
+    PooledAllocator() noexcept = default;
+    template <typename U>
+    PooledAllocator(const PooledAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if(n != 1) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        Pool* pool = thread_pool();
+        void* block = nullptr;
+        if(pool) {
+            if(pool->blocks.empty() && pool->has_returned.load()) {
+                std::lock_guard<std::mutex> lock(pool->returned_mutex);
+                pool->blocks.swap(pool->returned);
+                pool->has_returned.store(false);
+            }
+            if(!pool->blocks.empty()) {
+                block = pool->blocks.back();
+                pool->blocks.pop_back();
+            }
+            pool->references++;
+        }
+        if(!block) {
+            block = ::operator new(sizeof(BlockHeader) + sizeof(T));
+        }
+        BlockHeader* header = static_cast<BlockHeader*>(block);
+        header->owner = pool;
+        return reinterpret_cast<T*>(header + 1);
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept {
+        if(n != 1) {
+            ::operator delete(ptr);
+            return;
+        }
+        BlockHeader* header = header_of(ptr);
+        Pool* pool = header->owner;
+        if(!pool) {
+            ::operator delete(header);
+            return;
+        }
+        if(pool == thread_pool()) {
+            if(pool->blocks.size() < DERECHO_PENDING_RESULTS_POOL_SIZE) {
+                pool->blocks.push_back(header);
+                header = nullptr;
+            }
+        } else {
+            std::lock_guard<std::mutex> lock(pool->returned_mutex);
+            if(!pool->owner_exited && pool->returned.size() < DERECHO_PENDING_RESULTS_POOL_SIZE) {
+                pool->returned.push_back(header);
+                pool->has_returned.store(true);
+                header = nullptr;
+            }
+        }
+        if(header) {
+            ::operator delete(header);
+        }
+        pool->release();
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PooledAllocator<T>&, const PooledAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const PooledAllocator<T>&, const PooledAllocator<U>&) { return false; }
+
+}  // namespace rpc
+}  // namespace derecho
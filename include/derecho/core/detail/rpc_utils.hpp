@@ -12,15 +12,20 @@
 #include <derecho/mutils-serialization/SerializationSupport.hpp>
 #include <derecho/utils/logger.hpp>
 #include "derecho_internal.hpp"
+#include "rpc_reply_storage.hpp"
 
 #include <mutils/macro_utils.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <cstring>
 #include <exception>
 #include <functional>
 #include <future>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
 #include <sstream>
 #include <string>
@@ -31,6 +36,11 @@
 #include <vector>
 #include <cstdarg>
 
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define DERECHO_RPC_COROUTINES 1
+#endif
+
 namespace derecho {
 
 namespace rpc {
@@ -243,124 +253,222 @@ template <typename Ret>
 class PendingResults;
 
 /**
- * The type of map contained in a QueryResults::ReplyMap. The template parameter
- * should be the return type of the query.
+ * The events after delivery that an RPC function call's update goes through
+ * in a persistent (and possibly signed) subgroup.
  */
-template <typename T>
-using futures_map = std::map<node_id_t, std::future<T>>;
+enum class PersistenceEvent {
+    LOCAL,
+    GLOBAL,
+    SIGNATURE
+};
+
+/**
+ * The "future" end of a single node's reply to an RPC function call. Unlike
+ * std::future, it does not own a separate heap-allocated shared state: it is
+ * stored in-place inside its PendingResults, and waits on the CompletionSignal
+ * that all the replies of the same RPC call share. It supports the subset of
+ * the std::future interface that callers of QueryResults rely on.
+ * @tparam Ret The return type of the RPC function
+ */
+template <typename Ret>
+class ReplyFuture {
+    template <typename>
+    friend class PendingResults;
+
+    enum : uint8_t { EMPTY,
+                     WRITING,
+                     VALUE,
+                     EXCEPTION,
+                     RETRIEVED };
+
+    CompletionSignal* signal = nullptr;
+    std::atomic<uint8_t> status{EMPTY};
+    std::optional<Ret> value;
+    std::exception_ptr exception;
+    /**
+     * The number of the PendingResults' reply callbacks that have been run
+     * on this reply. Guarded by PendingResults::reply_callbacks_mutex.
+     */
+    std::size_t callbacks_delivered = 0;
+
+    /**
+     * Atomically claims this reply slot for writing.
+     * @return True if this thread claimed the slot, false if a response was
+     * already recorded for this node.
+     */
+    bool claim() {
+        uint8_t expected = EMPTY;
+        return status.compare_exchange_strong(expected, WRITING);
+    }
+
+    bool set_value(Ret&& v) {
+        if(!claim()) {
+            return false;
+        }
+        value.emplace(std::move(v));
+        status.store(VALUE);
+        signal->notify();
+        return true;
+    }
+
+    bool set_exception(const std::exception_ptr& e) {
+        if(!claim()) {
+            return false;
+        }
+        exception = e;
+        status.store(EXCEPTION);
+        signal->notify();
+        return true;
+    }
+
+    bool has_result() const {
+        const uint8_t current = status.load();
+        return current == VALUE || current == EXCEPTION;
+    }
+
+    /** @return True if a result has been stored, even if it has since been retrieved */
+    bool has_arrived() const {
+        return status.load() >= VALUE;
+    }
+
+public:
+    ReplyFuture() = default;
+    ReplyFuture(const ReplyFuture&) = delete;
+
+    /** @return True if the result has not yet been retrieved with get() */
+    bool valid() const {
+        return status.load() != RETRIEVED;
+    }
+
+    /** @return True if the node has replied (or failed), i.e. get() will not block */
+    bool is_ready() const {
+        return has_result();
+    }
+
+    /** Blocks until the node's reply (or an exception) is available. */
+    void wait() const {
+        signal->wait([this]() { return has_arrived(); });
+    }
+
+    /**
+     * Waits up to the specified duration for the node's reply to become available.
+     * @return std::future_status::ready if the reply is available, or
+     * std::future_status::timeout otherwise
+     */
+    template <typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+        return signal->wait_for([this]() { return has_arrived(); }, timeout)
+                       ? std::future_status::ready
+                       : std::future_status::timeout;
+    }
+
+    /**
+     * Blocks until the reply is available, then returns it (or rethrows the
+     * exception the call generated). Like std::future::get(), this moves the
+     * value out, so it can only be called once.
+     */
+    Ret get() {
+        wait();
+        assert(valid());
+        if(status.load() == EXCEPTION) {
+            status.store(RETRIEVED);
+            std::rethrow_exception(exception);
+        }
+        Ret result = std::move(*value);
+        value.reset();
+        status.store(RETRIEVED);
+        return result;
+    }
+};
+
+/**
+ * One entry in a QueryResults::ReplyMap, pairing a node ID with the future for
+ * that node's reply. Its members are named like those of std::pair so that
+ * iterating over a ReplyMap looks the same as iterating over a std::map.
+ */
+template <typename Ret>
+struct ReplyEntry {
+    node_id_t first;
+    ReplyFuture<Ret> second;
+};
 
 /**
  * Data structure that (indirectly) holds a set of futures for a single RPC
  * function call; there is one future for each node contacted to make the
  * call, and it will eventually contain that node's reply. The futures are
- * actually stored inside an internal struct of type ReplyMap, which can be
+ * accessed through an internal struct of type ReplyMap, which can be
  * retrieved with the get() method. The ReplyMap will not be returned until
  * it is "fulfilled" by the sender, which should happen when the RPC call
  * is delivered in the current View (and thus, the current View is the set
  * of nodes who should reply to the RPC).
+ *
+ * All of the state is stored in the paired PendingResults, so a QueryResults
+ * is only a handle and is cheap to move.
  * @tparam Ret The return type of the RPC function that this query invoked
  */
 template <typename Ret>
 class QueryResults {
 public:
-    /** A future for a futures_map held by unique_ptr (so it can be more easily moved) */
-    using map_fut = std::future<std::unique_ptr<futures_map<Ret>>>;
     using type = Ret;
 
     /**
-     * A wrapper around a std::map from node IDs to std::futures. Implements
-     * the iterator interface by passing calls through to the underlying std::map,
-     * so ReplyMap can be iterated over in a for-each loop as if it is actually
-     * a map rather than a wrapper around a map.
+     * A view of the reply slots stored in the PendingResults. Implements the
+     * iterator interface, so ReplyMap can be iterated over in a for-each loop
+     * as if it is actually a map from node IDs to futures.
      */
     class ReplyMap {
     private:
-        QueryResults& parent;
+        PendingResults<Ret>* results;
 
     public:
-        futures_map<Ret> rmap;
-
-        ReplyMap(QueryResults& qr) : parent(qr){};
+        ReplyMap(PendingResults<Ret>* results) : results(results){};
         ReplyMap(const ReplyMap&) = delete;
-        ReplyMap(ReplyMap&& rm) : parent(rm.parent), rmap(std::move(rm.rmap)) {}
+        ReplyMap(ReplyMap&& rm) : results(rm.results) {}
 
         bool valid(const node_id_t& nid) {
-            assert(rmap.size() == 0 || rmap.count(nid) != 0);
-            return (rmap.size() > 0) && rmap.at(nid).valid();
+            ReplyEntry<Ret>* entry = results->find_reply(nid);
+            return entry != nullptr && entry->second.valid();
         }
 
         /*
           returns true if we sent to this node,
           regardless of whether this node has replied.
         */
-        bool contains(const node_id_t& nid) { return rmap.count(nid); }
+        bool contains(const node_id_t& nid) { return results->find_reply(nid) != nullptr; }
 
-        auto begin() { return std::begin(rmap); }
+        ReplyEntry<Ret>* begin() { return results->replies_begin(); }
 
-        auto end() { return std::end(rmap); }
+        ReplyEntry<Ret>* end() { return results->replies_end(); }
 
         Ret get(const node_id_t& nid) {
-            if(rmap.size() == 0) {
-                //This should never happen. Since the ReplyMap member is private, the only way to
-                //invoke get(nid) on a ReplyMap is to retrieve a reference to it with the parent
-                //QueryResults's wait() or get(), which must have executed the assignment
-                //replies.rmap = std::move(*pending_rmap.get()).
-                assert(parent.pending_rmap.valid());
-                rmap = std::move(*parent.pending_rmap.get());
-            }
-            assert(rmap.size() > 0);
-            assert(rmap.count(nid));
-            assert(rmap.at(nid).valid());
-            return rmap.at(nid).get();
+            ReplyEntry<Ret>* entry = results->find_reply(nid);
+            assert(entry != nullptr);
+            assert(entry->second.valid());
+            return entry->second.get();
         }
     };
 
-    map_fut pending_rmap;
-
 private:
-    ReplyMap replies{*this};
-    /** This will be fulfilled with this RPC function call's version-timestamp pair, once it has been assigned */
-    std::future<std::pair<persistent::version_t, uint64_t>> persistent_version;
-    /** This signals that local persistence has completed for the version assigned to this RPC function call */
-    std::future<void> local_persistence_done;
-    /** This signals that global persistence has completed for the version assigned to this RPC function call */
-    std::future<void> global_persistence_done;
-    /** This signals that the signature has been verified at all replicas on the version assigned to this RPC function call */
-    std::future<void> signature_done;
     /**
      * An owning pointer to the PendingResults that is paired with this QueryResults
      * (i.e. the one that constructed this QueryResults). It ensures that the
      * PendingResults has the same lifetime as the QueryResults.
      */
     std::shared_ptr<PendingResults<Ret>> paired_pending_results;
+    ReplyMap replies;
 
 public:
     /**
-     * Constructs a QueryResults from a future for a reply-map (which is itself
-     * a map of futures), and the futures for the persistent events it will also
-     * track. The promise ends of these futures should reside in a corresponding
-     * PendingResults that constructed this QueryResults, and the first parameter
-     * should be a shared_ptr to that PendingResults.
-     */
-    QueryResults(std::shared_ptr<PendingResults<Ret>> paired_pending_results,
-                 map_fut reply_map_future, std::future<std::pair<persistent::version_t, uint64_t>> persistent_version,
-                 std::future<void> local_persistence_done, std::future<void> global_persistence_done,
-                 std::future<void> signature_done)
-            : pending_rmap(std::move(reply_map_future)),
-              persistent_version(std::move(persistent_version)),
-              local_persistence_done(std::move(local_persistence_done)),
-              global_persistence_done(std::move(global_persistence_done)),
-              signature_done(std::move(signature_done)),
-              paired_pending_results(paired_pending_results) {}
+     * Constructs a QueryResults that reads its replies and persistence events
+     * from the given PendingResults.
+     */
+    QueryResults(std::shared_ptr<PendingResults<Ret>> paired_pending_results)
+            : paired_pending_results(std::move(paired_pending_results)),
+              replies(this->paired_pending_results.get()) {}
     /** Move constructor for QueryResults. */
     QueryResults(QueryResults&& o)
-            : pending_rmap{std::move(o.pending_rmap)},
-              replies{std::move(o.replies)},
-              persistent_version{std::move(o.persistent_version)},
-              local_persistence_done{std::move(o.local_persistence_done)},
-              global_persistence_done{std::move(o.global_persistence_done)},
-              signature_done{std::move(o.signature_done)},
-              paired_pending_results{std::move(o.paired_pending_results)} {}
+            : paired_pending_results{std::move(o.paired_pending_results)},
+              replies{std::move(o.replies)} {}
     /** QueryResults, like std::future, is not copyable. */
     QueryResults(const QueryResults&) = delete;
 
@@ -370,14 +478,11 @@ public:
      */
     template <typename Time>
     ReplyMap* wait(Time t) {
-        if(replies.rmap.size() == 0) {
-            if(pending_rmap.wait_for(t) == std::future_status::ready) {
-                replies.rmap = std::move(*pending_rmap.get());
-                return &replies;
-            } else
-                return nullptr;
-        } else
+        if(paired_pending_results->await_reply_map_for(t)) {
             return &replies;
+        } else {
+            return nullptr;
+        }
     }
 
     /**
@@ -386,12 +491,8 @@ public:
      * scope, and cannot be copied.
      */
     ReplyMap& get() {
-        using namespace std::chrono;
-        while(true) {
-            if(auto rmap = wait(5min)) {
-                return *rmap;
-            }
-        }
+        paired_pending_results->await_reply_map();
+        return replies;
     }
 
     /**
@@ -401,16 +502,7 @@ public:
      * @return true/false
      */
     bool is_ready() {
-        if(replies.rmap.size() != 0) {
-            for(auto& reply : replies) {
-                using namespace std::chrono;
-                if(reply.second.wait_for(std::chrono::seconds(0s)) != std::future_status::ready) {
-                    return false;
-                }
-            }
-            return true;
-        }
-        return false;
+        return paired_pending_results->all_replies_ready();
     }
 
     /**
@@ -424,7 +516,18 @@ public:
      * should be const anyway, so it should not generate a new version).
      */
     std::pair<persistent::version_t, uint64_t> get_persistent_version() {
-        return persistent_version.get();
+        return paired_pending_results->await_persistent_version();
+    }
+
+    /**
+     * Tells the RPC layer that the caller will never wait for the persistence
+     * or signature events of this RPC function call, so it does not need to
+     * keep tracking them once the call has been delivered. After calling this,
+     * await_local_persistence(), await_global_persistence() and
+     * await_signature_verification() will throw an exception instead of blocking.
+     */
+    void skip_persistence_tracking() {
+        paired_pending_results->disable_persistence_tracking();
     }
 
     /**
@@ -438,7 +541,7 @@ public:
      * persistence events related to it.
      */
     void await_local_persistence() {
-        local_persistence_done.get();
+        paired_pending_results->await_local_persistence();
     }
 
     /**
@@ -452,7 +555,7 @@ public:
      * persistence events related to it.
      */
     void await_global_persistence() {
-        global_persistence_done.get();
+        paired_pending_results->await_global_persistence();
     }
 
     /**
@@ -465,7 +568,7 @@ public:
      * signature events related to it.
      */
     void await_signature_verification() {
-        signature_done.get();
+        paired_pending_results->await_signature_verification();
     }
 
     /**
@@ -473,7 +576,7 @@ public:
      * blocking; returns true if so.
      */
     bool local_persistence_is_ready() const {
-        return local_persistence_done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        return paired_pending_results->local_persistence_is_ready();
     }
 
     /**
@@ -481,7 +584,7 @@ public:
      * blocking; returns true if so.
      */
     bool global_persistence_is_ready() const {
-        return global_persistence_done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        return paired_pending_results->global_persistence_is_ready();
     }
 
     /**
@@ -489,88 +592,137 @@ public:
      * blocking; returns true if so.
      */
     bool global_verification_is_ready() const {
-        return signature_done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        return paired_pending_results->signature_is_ready();
+    }
+
+    /**
+     * Registers a continuation to run once every node has replied (or been
+     * removed from the group), i.e. once get() and the get() of every reply
+     * will no longer block. If this has already happened, the continuation
+     * runs immediately on the calling thread. Otherwise it runs on the thread
+     * that delivers the last reply, which is one of Derecho's RPC threads, so
+     * it should not block; supply an executor to run it somewhere else.
+     * The continuation receives its own QueryResults handle to the same RPC
+     * call, so this QueryResults does not need to be kept alive.
+     * If the caller is removed from its subgroup before the call is
+     * delivered, the continuation still runs, and get() will throw.
+     * @param continuation The function to call when the RPC call completes
+     * @param executor An optional executor to run the continuation with
+     */
+    void then(std::function<void(QueryResults<Ret>&)> continuation,
+              const completion_executor_t& executor = {}) {
+        paired_pending_results->template add_continuation<Ret>(std::move(continuation), executor);
+    }
+
+    /**
+     * Registers a callback to run once for each node's reply, as soon as
+     * that reply (or an exception for that node) arrives. Replies that have
+     * already arrived are passed to the callback immediately, on the calling
+     * thread. Calling get() on the ReplyFuture from the callback consumes the
+     * reply, just as it would from a loop over the ReplyMap.
+     * @param callback The function to call with each node's ID and reply
+     * @param executor An optional executor to run the callback with
+     */
+    void on_reply(std::function<void(const node_id_t&, ReplyFuture<Ret>&)> callback,
+                  const completion_executor_t& executor = {}) {
+        paired_pending_results->add_reply_callback(std::move(callback), executor);
+    }
+
+    /**
+     * Registers a callback to run when this RPC function call's update has
+     * finished persisting locally; the callback equivalent of
+     * await_local_persistence(). Callbacks for persistence events that will
+     * never happen (e.g. on the result of a p2p_send) are discarded without
+     * being called.
+     */
+    void on_local_persistence(std::function<void()> callback, const completion_executor_t& executor = {}) {
+        paired_pending_results->add_persistence_callback(PersistenceEvent::LOCAL, std::move(callback), executor);
+    }
+
+    /**
+     * Registers a callback to run when this RPC function call's update has
+     * finished persisting on all replicas; the callback equivalent of
+     * await_global_persistence().
+     */
+    void on_global_persistence(std::function<void()> callback, const completion_executor_t& executor = {}) {
+        paired_pending_results->add_persistence_callback(PersistenceEvent::GLOBAL, std::move(callback), executor);
+    }
+
+    /**
+     * Registers a callback to run when this RPC function call's update has
+     * been signed and verified on all replicas; the callback equivalent of
+     * await_signature_verification().
+     */
+    void on_signature_verification(std::function<void()> callback, const completion_executor_t& executor = {}) {
+        paired_pending_results->add_persistence_callback(PersistenceEvent::SIGNATURE, std::move(callback), executor);
     }
+
+#ifdef DERECHO_RPC_COROUTINES
+    /**
+     * Lets a C++20 coroutine write `auto& replies = co_await results;` to
+     * suspend until the RPC call has completed, without blocking a thread.
+     * The coroutine is resumed by the continuation mechanism of then(), so
+     * it resumes on the thread that delivered the last reply.
+     */
+    auto operator co_await() & {
+        struct Awaiter {
+            QueryResults<Ret>& results;
+            bool await_ready() { return results.is_ready(); }
+            void await_suspend(std::coroutine_handle<> handle) {
+                results.then([handle](QueryResults<Ret>&) { handle.resume(); });
+            }
+            ReplyMap& await_resume() { return results.get(); }
+        };
+        return Awaiter{*this};
+    }
+#endif
 };
 
 /**
  * Specialization of QueryResults for void functions, which do not generate
- * replies. Here the "reply map" is actually a set, and simply records the set
- * of nodes to which the RPC was sent. The internal ReplyMap is fulfilled when
- * the set of nodes that received the RPC is known, which is when the RPC
- * message was delivered in the current View.
+ * replies. Here the "reply map" is actually a list of node IDs, and simply
+ * records the set of nodes to which the RPC was sent. The internal ReplyMap is
+ * fulfilled when the set of nodes that received the RPC is known, which is
+ * when the RPC message was delivered in the current View.
  */
 template <>
 class QueryResults<void> {
 public:
-    using map_fut = std::future<std::unique_ptr<std::set<node_id_t>>>;
     using type = void;
 
     class ReplyMap {
     private:
-        QueryResults& parent;
+        PendingResults<void>* results;
 
     public:
-        std::set<node_id_t> rmap;
-
-        ReplyMap(QueryResults& qr) : parent(qr){};
+        ReplyMap(PendingResults<void>* results) : results(results){};
         ReplyMap(const ReplyMap&) = delete;
-        ReplyMap(ReplyMap&& rm) : parent(rm.parent), rmap(std::move(rm.rmap)) {}
+        ReplyMap(ReplyMap&& rm) : results(rm.results) {}
 
-        bool valid(const node_id_t& nid) {
-            assert(rmap.size() == 0 || rmap.count(nid) != 0);
-            return (rmap.size() > 0) && rmap.count(nid) > 0;
-        }
+        inline bool valid(const node_id_t& nid);
 
         /*
           returns true if we sent to this node,
           regardless of whether this node has replied.
         */
-        bool contains(const node_id_t& nid) { return rmap.count(nid); }
+        inline bool contains(const node_id_t& nid);
 
-        auto begin() { return std::begin(rmap); }
+        inline const node_id_t* begin();
 
-        auto end() { return std::end(rmap); }
+        inline const node_id_t* end();
     };
 
-    map_fut pending_rmap;
-
 private:
-    ReplyMap replies{*this};
-    /** This will be fulfilled with this RPC function call's version-timestamp pair, once it has been assigned */
-    std::future<std::pair<persistent::version_t, uint64_t>> persistent_version;
-    /** This signals that local persistence has completed for the version assigned to this RPC function call */
-    std::future<void> local_persistence_done;
-    /** This signals that global persistence has completed for the version assigned to this RPC function call */
-    std::future<void> global_persistence_done;
-    /** This signals that the signature has been verified at all replicas on the version assigned to this RPC function call */
-    std::future<void> signature_done;
-    /**
-     * An owning pointer to the PendingResults that is paired with this QueryResults
-     * (i.e. the one that constructed this QueryResults). It ensures that the
-     * PendingResults has the same lifetime as the QueryResults.
-     */
     std::shared_ptr<PendingResults<void>> paired_pending_results;
+    ReplyMap replies;
 
 public:
-    QueryResults(std::shared_ptr<PendingResults<void>> paired_pending_results,
-                 map_fut reply_map_future, std::future<std::pair<persistent::version_t, uint64_t>> persistent_version,
-                 std::future<void> local_persistence_done, std::future<void> global_persistence_done,
-                 std::future<void> signature_done)
-            : pending_rmap(std::move(reply_map_future)),
-              persistent_version(std::move(persistent_version)),
-              local_persistence_done(std::move(local_persistence_done)),
-              global_persistence_done(std::move(global_persistence_done)),
-              signature_done(std::move(signature_done)),
-              paired_pending_results(paired_pending_results) {}
+    QueryResults(std::shared_ptr<PendingResults<void>> paired_pending_results)
+            : paired_pending_results(std::move(paired_pending_results)),
+              replies(this->paired_pending_results.get()) {}
     QueryResults(QueryResults&& o)
-            : pending_rmap{std::move(o.pending_rmap)},
-              replies{std::move(o.replies)},
-              persistent_version{std::move(o.persistent_version)},
-              local_persistence_done{std::move(o.local_persistence_done)},
-              global_persistence_done{std::move(o.global_persistence_done)},
-              signature_done{std::move(o.signature_done)},
-              paired_pending_results{std::move(o.paired_pending_results)} {}
+            : paired_pending_results{std::move(o.paired_pending_results)},
+              replies{std::move(o.replies)} {}
     QueryResults(const QueryResults&) = delete;
 
     /**
@@ -578,30 +730,14 @@ public:
      * after that duration, return it. Otherwise return nullptr.
      */
     template <typename Time>
-    ReplyMap* wait(Time t) {
-        if(replies.rmap.size() == 0) {
-            if(pending_rmap.wait_for(t) == std::future_status::ready) {
-                replies.rmap = std::move(*pending_rmap.get());
-                return &replies;
-            } else
-                return nullptr;
-        } else
-            return &replies;
-    }
+    inline ReplyMap* wait(Time t);
 
     /**
      * Block until the ReplyMap is fulfilled, then return the map by reference.
      * The ReplyMap is only valid as long as this QueryResults remains in
      * scope, and cannot be copied.
      */
-    ReplyMap& get() {
-        using namespace std::chrono;
-        while(true) {
-            if(auto rmap = wait(5min)) {
-                return *rmap;
-            }
-        }
-    }
+    inline ReplyMap& get();
 
     /**
      * Test if all the future entries are ready.
@@ -609,9 +745,7 @@ public:
      *
      * @return true/false
      */
-    bool is_ready() {
-        return (replies.rmap.size() != 0);
-    }
+    inline bool is_ready();
 
     /**
      * Retrieves the persistent version number and timestamp that has been assigned
@@ -619,74 +753,96 @@ public:
      * once the ReplyMap has been fulfilled (they are set at the same time), so this
      * will block unless get() has been previously called on the QueryResults.
      */
-    std::pair<persistent::version_t, uint64_t> get_persistent_version() {
-        return persistent_version.get();
-    }
+    inline std::pair<persistent::version_t, uint64_t> get_persistent_version();
+
+    /**
+     * Tells the RPC layer that the caller will never wait for the persistence
+     * or signature events of this RPC function call. See the non-void version.
+     */
+    inline void skip_persistence_tracking();
 
     /**
      * Blocks until the update caused by this RPC function call has finished
      * persisting locally (i.e. the version number assigned to it has reached
      * the "locally persisted" state). Note that this is meaningless if the
      * Replicated Object has no Persistent<T> fields, and it will only work on
-     * QueryResults that are generated by ordered_send calls. It will block
-     * forever if called on the result of a p2p_send call, since only the
-     * members of the subgroup that receives an RPC message will be notified of
-     * persistence events related to it.
+     * QueryResults that are generated by ordered_send calls.
      */
-    void await_local_persistence() {
-        local_persistence_done.get();
-    }
+    inline void await_local_persistence();
 
     /**
      * Blocks until the update caused by this RPC function call has finished
-     * persisting locally (i.e. the version number assigned to it has reached
-     * the "locally persisted" state). Note that this is meaningless if the
-     * Replicated Object has no Persistent<T> fields, and it will only work on
-     * QueryResults that are generated by ordered_send calls. It will block
-     * forever if called on the result of a p2p_send call, since only the
-     * members of the subgroup that receives an RPC message will be notified of
-     * persistence events related to it.
+     * persisting on all replicas (i.e. the version number assigned to it has
+     * reached the "globally persisted" state). Note that this is meaningless
+     * if the Replicated Object has no Persistent<T> fields, and it will only
+     * work on QueryResults that are generated by ordered_send calls.
      */
-    void await_global_persistence() {
-        global_persistence_done.get();
-    }
+    inline void await_global_persistence();
 
     /**
      * Blocks until the update caused by this RPC function call has been signed
      * on all replicas and the signatures have been verified. Note that this is
      * meaningless if signed updates are not enabled, and it will only work on
-     * QueryResults that are generated by ordered_send calls. It will block
-     * forever if called on the result of a p2p_send call, since only the
-     * members of the subgroup that receives an RPC message will be notified of
-     * signature events related to it.
+     * QueryResults that are generated by ordered_send calls.
      */
-    void await_signature_verification() {
-        signature_done.get();
-    }
+    inline void await_signature_verification();
 
     /**
      * Checks if a call to await_local_persistence() would succeed without
      * blocking; returns true if so.
      */
-    bool local_persistence_is_ready() const {
-        return local_persistence_done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
-    }
+    inline bool local_persistence_is_ready() const;
 
     /**
      * Checks if a call to await_global_persistence() would succeed without
      * blocking; returns true if so.
      */
-    bool global_persistence_is_ready() const {
-        return global_persistence_done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
-    }
+    inline bool global_persistence_is_ready() const;
 
     /**
      * Checks if a call to await_signature_verification() would succeed without
      * blocking; returns true if so.
      */
-    bool global_verification_is_ready() const {
-        return signature_done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    inline bool global_verification_is_ready() const;
+
+    /**
+     * Registers a continuation to run once the ReplyMap is fulfilled (or the
+     * caller is removed from its subgroup). See the non-void version.
+     */
+    inline void then(std::function<void(QueryResults<void>&)> continuation,
+                     const completion_executor_t& executor = {});
+
+    /**
+     * Registers a callback for the local persistence event. See the non-void version.
+     */
+    inline void on_local_persistence(std::function<void()> callback, const completion_executor_t& executor = {});
+
+    /**
+     * Registers a callback for the global persistence event. See the non-void version.
+     */
+    inline void on_global_persistence(std::function<void()> callback, const completion_executor_t& executor = {});
+
+    /**
+     * Registers a callback for the signature verification event. See the non-void version.
+     */
+    inline void on_signature_verification(std::function<void()> callback, const completion_executor_t& executor = {});
+
+#ifdef DERECHO_RPC_COROUTINES
+    /**
+     * Lets a C++20 coroutine co_await the ReplyMap. See the non-void version.
+     */
+    auto operator co_await() & {
+        struct Awaiter {
+            QueryResults<void>& results;
+            bool await_ready() { return results.is_ready(); }
+            void await_suspend(std::coroutine_handle<> handle) {
+                results.then([handle](QueryResults<void>&) { handle.resume(); });
+            }
+            ReplyMap& await_resume() { return results.get(); }
+        };
+        return Awaiter{*this};
     }
+#endif
 };
 
 /**
@@ -705,254 +861,553 @@ public:
     virtual void set_exception_for_removed_node(const node_id_t&) = 0;
     virtual void set_exception_for_caller_removed() = 0;
     virtual bool all_responded() = 0;
+    virtual bool tracks_persistence() const = 0;
+    virtual void end_persistence_events() = 0;
     virtual ~AbstractPendingResults() {}
 };
 
 /**
- * Data structure that holds a set of promises for a single RPC function call;
- * the promises transmit one response (either a value or an exception) for
- * each node that was called. The future ends of these promises are stored in
- * a corresponding QueryResults object.
- * @tparam Ret The return type of the RPC function, which is the type of a
- * response's value.
+ * The part of PendingResults that does not depend on the RPC function's
+ * return type: the version number assigned to the call, the persistence and
+ * signature events, and the single CompletionSignal that every waiter on this
+ * RPC call (including waiters on individual replies) blocks on. Each event is
+ * one bit in an atomic bitmask, so setting an event that nobody waits for
+ * does not touch any lock. Callbacks registered on these events run on the
+ * thread that raises the event, after the waiters have been notified.
  */
-template <typename Ret>
-class PendingResults : public AbstractPendingResults, public std::enable_shared_from_this<PendingResults<Ret>> {
-private:
-    /** A promise for a map containing one future for each reply to the RPC function
-     * call. The future end of this promise lives in QueryResults, and is fulfilled
-     * when the RPC function call is actually sent and the set of repliers is known. */
-    std::promise<std::unique_ptr<futures_map<Ret>>> promise_for_pending_map;
+class PendingResultsState : public AbstractPendingResults, public std::enable_shared_from_this<PendingResultsState> {
+protected:
+    enum : uint32_t {
+        REPLY_MAP_READY = 1u << 0,
+        VERSION_ASSIGNED = 1u << 1,
+        LOCAL_PERSISTED = 1u << 2,
+        GLOBAL_PERSISTED = 1u << 3,
+        SIGNATURE_VERIFIED = 1u << 4,
+        CALLER_REMOVED = 1u << 5,
+        ALL_REPLIED = 1u << 6
+    };
+    static constexpr uint32_t PERSISTENCE_EVENTS = LOCAL_PERSISTED | GLOBAL_PERSISTED | SIGNATURE_VERIFIED;
+
+    CompletionSignal signal;
+    /** A bitmask of the events (from the enum above) that have occurred */
+    std::atomic<uint32_t> events{0};
+    /** A bitmask of the events that RPCManager has promised never to raise */
+    std::atomic<uint32_t> ended_events{0};
+    /** The callbacks waiting for events in the bitmask */
+    EventCallbacks callbacks;
+    /**
+     * False if the caller has declared that it will not wait for persistence
+     * or signature events, in which case RPCManager can stop tracking this call
+     * as soon as it has been delivered.
+     */
+    std::atomic<bool> persistence_tracked{true};
+    /**
+     * The persistent version (a pair of a version number and a timestamp)
+     * assigned to the update represented by this RPC function call. Only
+     * valid once VERSION_ASSIGNED has been raised.
+     */
+    std::pair<persistent::version_t, uint64_t> version_and_timestamp;
+
+    void raise_event(uint32_t event) {
+        events.fetch_or(event);
+        signal.notify();
+        run_callbacks(callbacks.collect(events, ended_events.load()));
+    }
 
-    std::promise<std::map<node_id_t, std::promise<Ret>>> promise_for_reply_promises;
-    /** A future for a map containing one promise for each reply to the RPC function
-     * call. It will be fulfilled when fulfill_map is called, which means the RPC
-     * function call was actually sent and the set of destination nodes is known. */
-    std::future<std::map<node_id_t, std::promise<Ret>>> reply_promises_are_ready;
-    std::mutex reply_promises_are_ready_mutex;
     /**
-     * Contains one promise for each node that the RPC function call was sent to,
-     * which will be fulfilled when that node replies. Indexed by the node's ID.
+     * Runs the callbacks that were collected from the callback list. Any
+     * exception they throw is logged rather than propagated into the thread
+     * that raised the event. When the Collected object is destroyed it may
+     * release the last reference to this object, so the caller must hold its
+     * own reference if it touches this object afterwards.
      */
-    std::map<node_id_t, std::promise<Ret>> reply_promises;
+    static void run_callbacks(EventCallbacks::Collected&& collected) {
+        for(EventCallbacks::callback_t& callback : collected.ready) {
+            invoke_callback(callback);
+        }
+    }
+
+    template <typename Callback>
+    static void invoke_callback(Callback&& callback) {
+        try {
+            callback();
+        } catch(const std::exception& e) {
+            dbg_error(RpcLoggerPtr::get(), "An RPC completion callback threw an exception: {}", e.what());
+        } catch(...) {
+            dbg_error(RpcLoggerPtr::get(), "An RPC completion callback threw an exception");
+        }
+    }
+
     /**
-     * True if the reply map has been fulfilled, i.e. fulfill_map() has been
-     * called and promise_for_pending_map has had a value set. This is necessary
-     * because it's impossible to ask a std::promise if set_value() has been
-     * called on it.
-    */
-    bool map_fulfilled = false;
+     * Runs a callback with an executor, or on the current thread if the
+     * executor is empty.
+     */
+    static void dispatch(const completion_executor_t& executor, std::function<void()> callback) {
+        if(executor) {
+            executor(std::move(callback));
+        } else {
+            invoke_callback(callback);
+        }
+    }
+
     /**
-     * The set of nodes that the RPC function call was sent to; equal to the
-     * key set of reply_promises.
+     * Registers a callback to run when any of the events in event_mask is
+     * raised, or runs it immediately if one already has been.
      */
-    std::set<node_id_t> dest_nodes;
+    void add_event_callback(uint32_t event_mask, EventCallbacks::callback_t callback) {
+        if(callbacks.add(event_mask, callback, events, ended_events, shared_from_this())) {
+            invoke_callback(callback);
+        }
+    }
+
+    bool has_event(uint32_t event_mask) const {
+        return (events.load() & event_mask) != 0;
+    }
+
+    void await_event(uint32_t event_mask) {
+        signal.wait([this, event_mask]() { return has_event(event_mask); });
+    }
+
+    void await_persistence_event(uint32_t event) {
+        if(!persistence_tracked.load()) {
+            throw derecho_exception("Persistence tracking was disabled for this RPC call with skip_persistence_tracking()");
+        }
+        await_event(event);
+    }
+
     /**
-     * The set of nodes that have responded to the RPC function call, either by
-     * delivering a reply or by failing. If a node ID is in this set, its future
-     * in reply_promises has been fulfilled with either set_value or set_exception.
+     * Throws an exception if the reply-map wait ended because this node was
+     * removed from its subgroup before the map could be fulfilled.
      */
-    std::set<node_id_t> responded_nodes;
+    void check_reply_map() {
+        if(!has_event(REPLY_MAP_READY)) {
+            throw sender_removed_from_group_exception();
+        }
+    }
+
+public:
+    void await_reply_map() {
+        await_event(REPLY_MAP_READY | CALLER_REMOVED);
+        check_reply_map();
+    }
+
+    template <typename Time>
+    bool await_reply_map_for(Time t) {
+        if(!signal.wait_for([this]() { return has_event(REPLY_MAP_READY | CALLER_REMOVED); }, t)) {
+            return false;
+        }
+        check_reply_map();
+        return true;
+    }
+
+    std::pair<persistent::version_t, uint64_t> await_persistent_version() {
+        await_event(VERSION_ASSIGNED);
+        return version_and_timestamp;
+    }
+
+    void await_local_persistence() { await_persistence_event(LOCAL_PERSISTED); }
+    void await_global_persistence() { await_persistence_event(GLOBAL_PERSISTED); }
+    void await_signature_verification() { await_persistence_event(SIGNATURE_VERIFIED); }
+    bool local_persistence_is_ready() const { return has_event(LOCAL_PERSISTED); }
+    bool global_persistence_is_ready() const { return has_event(GLOBAL_PERSISTED); }
+    bool signature_is_ready() const { return has_event(SIGNATURE_VERIFIED); }
+
+    void disable_persistence_tracking() {
+        persistence_tracked = false;
+    }
+
     /**
-     * Controls access to responded_nodes because std::set isn't thread-safe.
-     * Both the predicates thread and the P2P worker thread may access
-     * responded_nodes at the same time (especially during view changes).
+     * Registers a callback for one of the persistence events of this RPC call.
+     * Throws an exception if persistence tracking has been disabled.
      */
-    std::mutex responded_nodes_mutex;
+    void add_persistence_callback(PersistenceEvent event, std::function<void()> callback,
+                                  const completion_executor_t& executor) {
+        if(!persistence_tracked.load()) {
+            throw derecho_exception("Persistence tracking was disabled for this RPC call with skip_persistence_tracking()");
+        }
+        const uint32_t event_bit = event == PersistenceEvent::LOCAL    ? LOCAL_PERSISTED
+                                   : event == PersistenceEvent::GLOBAL ? GLOBAL_PERSISTED
+                                                                       : SIGNATURE_VERIFIED;
+        add_event_callback(event_bit, [executor, callback = std::move(callback)]() {
+            dispatch(executor, callback);
+        });
+    }
+
+    /**
+     * Registers a continuation that receives a new QueryResults handle to
+     * this RPC call once all of its replies have arrived, or once the caller
+     * has been removed from the group. The handle is created on the thread
+     * that raises the event, so the continuation keeps this object alive even
+     * if it runs later on an executor.
+     * @tparam Ret The return type of the RPC function; this must actually be
+     * a PendingResults<Ret>.
+     */
+    template <typename Ret>
+    void add_continuation(std::function<void(QueryResults<Ret>&)> continuation,
+                          const completion_executor_t& executor) {
+        add_event_callback(ALL_REPLIED | CALLER_REMOVED, [this, executor, continuation = std::move(continuation)]() {
+            auto handle = std::make_shared<QueryResults<Ret>>(
+                    std::static_pointer_cast<PendingResults<Ret>>(shared_from_this()));
+            dispatch(executor, [handle, continuation]() { continuation(*handle); });
+        });
+    }
+
+    /**
+     * Tells this PendingResults that RPCManager will not raise any more
+     * persistence or signature events for it (e.g. because its subgroup is not
+     * persistent, or because it was a P2P call). Callbacks waiting only for
+     * those events are discarded, which may release the reference they held.
+     */
+    void end_persistence_events() {
+        ended_events.fetch_or(PERSISTENCE_EVENTS);
+        run_callbacks(callbacks.collect(events, ended_events.load()));
+    }
+
+    bool tracks_persistence() const {
+        return persistence_tracked.load();
+    }
+
+    /**
+     * Records the persistent version assigned to this RPC function call.
+     * @param   assigned_version    The persistent version number that was assigned
+     *                              to the update generated by this RPC function call
+     * @param   assigned_timestamp  The timestamp to assign to the update
+     */
+    void set_persistent_version(persistent::version_t assigned_version, uint64_t assigned_timestamp) {
+        version_and_timestamp = {assigned_version, assigned_timestamp};
+        raise_event(VERSION_ASSIGNED);
+    }
+
+    /**
+     * Signals client code that the update has finished persisting locally on
+     * this node.
+     */
+    void set_local_persistence() {
+        raise_event(LOCAL_PERSISTED);
+    }
+
+    /**
+     * Signals client code that the update has finished persisting on all
+     * replicas of this subgroup.
+     */
+    void set_global_persistence() {
+        raise_event(GLOBAL_PERSISTED);
+    }
+
+    /**
+     * Signals client code that the update has been correctly signed on all
+     * replicas of this subgroup.
+     */
+    void set_signature_verified() {
+        raise_event(SIGNATURE_VERIFIED);
+    }
+};
+
+/**
+ * Data structure that collects the responses to a single RPC function call,
+ * one response (either a value or an exception) for each node that was called.
+ * The reply slots are stored inline for shards of up to
+ * DERECHO_INLINE_REPLY_SLOTS members, and the whole object is allocated from a
+ * per-thread pool with create(), so an RPC call normally costs no heap
+ * allocations for its result tracking. The future end of these replies is a
+ * corresponding QueryResults object.
+ * @tparam Ret The return type of the RPC function, which is the type of a
+ * response's value.
+ */
+template <typename Ret>
+class PendingResults : public PendingResultsState {
+private:
+    using reply_callback_t = std::function<void(const node_id_t&, ReplyFuture<Ret>&)>;
 
     /**
-     * A promise for a persistent version (which is actually a pair of a version
-     * number and a timestamp) assigned to the update represented by this RPC
-     * function call. The future end of this promise lives in the corresponding
-     * QueryResults. It is fulfilled when the RPC function call is actually sent,
-     * which means it has been ordered and a version is assigned to it.
+     * Contains one reply slot for each node that the RPC function call was
+     * sent to. Sized and filled in by fulfill_map().
      */
-    std::promise<std::pair<persistent::version_t, uint64_t>> version_promise;
+    InlineArray<ReplyEntry<Ret>, DERECHO_INLINE_REPLY_SLOTS> replies;
     /**
-     * A promise representing the "local persistence" event for the update
-     * caused by this RPC call; the future end lives in QueryResults. This is
-     * fulfilled to signal that the update has finished persisting locally.
+     * The number of reply slots that have been filled with either a value or
+     * an exception. Since each slot can only be filled once, exactly one
+     * thread will observe this reaching replies.size().
      */
-    std::promise<void> local_persistence_promise;
+    std::atomic<std::size_t> num_responded{0};
+
     /**
-     * A promise representing the "global persistence" event for the update
-     * caused by this RPC call; the future end lives in QueryResults. This is
-     * fulfilled to signal that the update has finished persisting on all
-     * replicas.
+     * A reference to this object held on behalf of the remote nodes that have
+     * not yet replied. RemoteInvoker uses the raw address of this object as
+     * the invocation ID of the RPC message, and this reference keeps it alive
+     * until all the replies have arrived (or the nodes have failed), even if
+     * the QueryResults is destroyed first.
      */
-    std::promise<void> global_persistence_promise;
+    std::shared_ptr<PendingResults<Ret>> self_reference;
     /**
-     * A promise representing the "signature verified" event for the update
-     * caused by this RPC call; the future end lives in QueryResults.
+     * Set to true the first time delete_self_ptr() is called, so that only
+     * one thread releases self_reference.
      */
-    std::promise<void> signature_verified_promise;
+    std::atomic<bool> self_reference_released{false};
 
     /**
-     * A flag set to true the first time delete_self_ptr() is called, to
-     * prevent it from attempting to delete the pointer again if it is
-     * mistakenly called twice on the same object.
+     * The callbacks registered with add_reply_callback(), each paired with the
+     * executor it should run on. Callbacks are only ever appended, so each
+     * reply slot records how many of them it has been delivered to.
      */
-    bool heap_pointer_deleted;
+    std::vector<std::pair<reply_callback_t, completion_executor_t>> reply_callbacks;
+    std::mutex reply_callbacks_mutex;
+    /** Set before the first reply callback is added, so replies can skip the mutex until then */
+    std::atomic<bool> has_reply_callbacks{false};
+
+    std::shared_ptr<PendingResults<Ret>> shared_self() {
+        return std::static_pointer_cast<PendingResults<Ret>>(shared_from_this());
+    }
 
     /**
-     * A raw pointer to a heap-allocated shared_ptr to this PendingResults object,
-     * which is used by RemoteInvoker to locate this object when a reply arrives.
-     * Stored here so that the shared_ptr can still be deleted by RPCManager if
-     * a node fails before sending its reply; RemoteInvoker will lose the
-     * shared_ptr if it doesn't get all the replies to a given invocation.
+     * Runs the reply callbacks that have not yet seen the given reply, which
+     * must already contain a value or an exception.
      */
-    std::shared_ptr<PendingResults<Ret>>* self_heap_ptr;
+    void deliver_reply(ReplyEntry<Ret>& entry) {
+        if(!has_reply_callbacks.load()) {
+            return;
+        }
+        std::vector<std::pair<reply_callback_t, completion_executor_t>> undelivered;
+        {
+            std::lock_guard<std::mutex> lock(reply_callbacks_mutex);
+            undelivered.assign(reply_callbacks.begin() + entry.second.callbacks_delivered, reply_callbacks.end());
+            entry.second.callbacks_delivered = reply_callbacks.size();
+        }
+        for(auto& callback_and_executor : undelivered) {
+            run_reply_callback(entry, callback_and_executor.first, callback_and_executor.second);
+        }
+    }
+
+    void run_reply_callback(ReplyEntry<Ret>& entry, const reply_callback_t& callback,
+                            const completion_executor_t& executor) {
+        if(executor) {
+            //The executor may run the callback later, so it must keep this object alive
+            executor([self = shared_self(), &entry, callback]() {
+                invoke_callback([&]() { callback(entry.first, entry.second); });
+            });
+        } else {
+            invoke_callback([&]() { callback(entry.first, entry.second); });
+        }
+    }
 
     /**
-     * A mutex that can be used to control access to this object "as a whole,"
-     * in order to make a sequence of method invocations atomic. This is
-     * necessary to make receive_response thread-safe, since the sequence
-     * "set_value()/set_exception() then all_responded()" needs to be atomic.
+     * Counts one more response, and raises the ALL_REPLIED event if it was
+     * the last one.
+     * @return True if this was the last outstanding response.
      */
-    std::mutex this_object_mutex;
+    bool record_response() {
+        if(num_responded.fetch_add(1) + 1 == replies.size()) {
+            raise_event(ALL_REPLIED);
+            return true;
+        }
+        return false;
+    }
 
 public:
-    PendingResults()
-            : reply_promises_are_ready(promise_for_reply_promises.get_future()),
-              heap_pointer_deleted(false),
-              self_heap_ptr(nullptr) {}
+    PendingResults() = default;
     virtual ~PendingResults() {}
 
+    /**
+     * Constructs a new PendingResults using the pooled allocator.
+     */
+    static std::shared_ptr<PendingResults<Ret>> create() {
+        return std::allocate_shared<PendingResults<Ret>>(PooledAllocator<PendingResults<Ret>>{});
+    }
+
     /**
      * Constructs and returns a QueryResults representing the "future" end of
-     * the response promises in this PendingResults.
-     * @return A new QueryResults holding a set of futures for this RPC function call
+     * the responses in this PendingResults.
+     * @return A new QueryResults for this RPC function call
      */
-    std::unique_ptr<QueryResults<Ret>> get_future() {
-        return std::make_unique<QueryResults<Ret>>(this->shared_from_this(),
-                                                   promise_for_pending_map.get_future(),
-                                                   version_promise.get_future(),
-                                                   local_persistence_promise.get_future(),
-                                                   global_persistence_promise.get_future(),
-                                                   signature_verified_promise.get_future());
+    QueryResults<Ret> get_future() {
+        return QueryResults<Ret>(shared_self());
     }
 
     /**
-     * Fill pending_map and reply_promises with one promise/future pair for
-     * each node that was contacted in this RPC call
+     * Creates one reply slot for each node that was contacted in this RPC call.
+     * If no nodes were contacted, the call is already complete, so this also
+     * releases the self-reference; the caller must hold its own shared_ptr.
      * @param who A list of nodes from which to expect responses.
      */
     void fulfill_map(const node_list_t& who) {
         dbg_trace(RpcLoggerPtr::get(), "Got a call to fulfill_map for PendingResults<{}>", typeid(Ret).name());
-        std::unique_ptr<futures_map<Ret>> futures = std::make_unique<futures_map<Ret>>();
-        std::map<node_id_t, std::promise<Ret>> promises;
-        for(const auto& e : who) {
-            futures->emplace(e, promises[e].get_future());
+        replies.resize(who.size());
+        for(std::size_t i = 0; i < who.size(); ++i) {
+            replies[i].first = who[i];
+            replies[i].second.signal = &signal;
         }
-        dest_nodes.insert(who.begin(), who.end());
-        dbg_trace(RpcLoggerPtr::get(), "Setting a value for reply_promises_are_ready");
-        promise_for_reply_promises.set_value(std::move(promises));
-        promise_for_pending_map.set_value(std::move(futures));
-        map_fulfilled = true;
+        if(who.empty()) {
+            //No reply will ever arrive to raise ALL_REPLIED or release the self-reference
+            raise_event(REPLY_MAP_READY | ALL_REPLIED);
+            delete_self_ptr();
+        } else {
+            raise_event(REPLY_MAP_READY);
+        }
+    }
+
+    /**
+     * Makes this PendingResults hold a reference to itself until all replies
+     * have arrived, and returns the invocation ID that identifies it in the
+     * RPC message.
+     */
+    PendingResults<Ret>* hold_self_reference() {
+        self_reference = shared_self();
+        return this;
     }
 
     /**
-     * Stores the address of a heap-allocated shared_ptr to this PendingResults
-     * object, which was allocated by RemoteInvoker and used as an invocation ID.
-     * @param heap_ptr A pointer to a shared_ptr to this PendingResults object.
+     * Registers a callback to run on each reply as it arrives, and runs it
+     * immediately on the replies that have already arrived.
      */
-    void set_self_ptr(std::shared_ptr<PendingResults<Ret>>* heap_ptr) {
-        self_heap_ptr = heap_ptr;
+    void add_reply_callback(reply_callback_t callback, const completion_executor_t& executor) {
+        //As with EventCallbacks, the flag must be set before any reply status is read
+        has_reply_callbacks.store(true);
+        std::vector<ReplyEntry<Ret>*> arrived;
+        {
+            std::lock_guard<std::mutex> lock(reply_callbacks_mutex);
+            reply_callbacks.emplace_back(callback, executor);
+            //If the reply map is not ready, no replies have arrived yet
+            if(has_event(REPLY_MAP_READY)) {
+                for(ReplyEntry<Ret>& entry : replies) {
+                    //A reply that has not been delivered to all the earlier callbacks
+                    //has a pending deliver_reply() call, which will also deliver it to this one
+                    if(entry.second.has_arrived() && entry.second.callbacks_delivered + 1 == reply_callbacks.size()) {
+                        entry.second.callbacks_delivered = reply_callbacks.size();
+                        arrived.push_back(&entry);
+                    }
+                }
+            }
+        }
+        for(ReplyEntry<Ret>* entry : arrived) {
+            run_reply_callback(*entry, callback, executor);
+        }
     }
 
     /**
-     * Deletes RemoteInvoker's heap-allocated shared_ptr to this PendingResults
-     * object, assuming it was previously set with set_self_ptr(). This should
-     * only be called by RemoteInvoker or RPCManager. It is safe to call this
-     * method more than once, and it will have no effect after the first call.
+     * Releases the self-reference created by hold_self_reference(). This
+     * should only be called by RemoteInvoker or RPCManager. It is safe to call
+     * this method more than once, and it will have no effect after the first call.
+     * Note that this may destroy the PendingResults if there are no other
+     * references to it, so the caller must not touch it afterwards unless it
+     * holds its own shared_ptr.
      */
     void delete_self_ptr() {
-        if(!heap_pointer_deleted) {
-            dbg_trace(RpcLoggerPtr::get(), "delete_self_ptr() deleting the shared_ptr at {}", fmt::ptr(self_heap_ptr));
-            heap_pointer_deleted = true;
-            //This must be the last statement in the method, since it might result in this object getting deleted
-            delete self_heap_ptr;
+        if(!self_reference_released.exchange(true)) {
+            dbg_trace(RpcLoggerPtr::get(), "delete_self_ptr() releasing the self-reference of {}", fmt::ptr(this));
+            //Moving the pointer out ensures the member is not touched after this object is destroyed
+            std::shared_ptr<PendingResults<Ret>> released = std::move(self_reference);
+        }
+    }
+
+    /**
+     * @return A pointer to the reply slot for the given node, or nullptr if
+     * the RPC function call was not sent to that node.
+     */
+    ReplyEntry<Ret>* find_reply(const node_id_t& nid) {
+        for(ReplyEntry<Ret>& entry : replies) {
+            if(entry.first == nid) {
+                return &entry;
+            }
         }
+        return nullptr;
+    }
+
+    ReplyEntry<Ret>* replies_begin() { return replies.begin(); }
+    ReplyEntry<Ret>* replies_end() { return replies.end(); }
+
+    /**
+     * @return True if the reply map has been fulfilled and every node has
+     * replied, i.e. no get() on any reply will block.
+     */
+    bool all_replies_ready() {
+        if(!has_event(REPLY_MAP_READY)) {
+            return false;
+        }
+        for(ReplyEntry<Ret>& entry : replies) {
+            if(entry.second.valid() && !entry.second.is_ready()) {
+                return false;
+            }
+        }
+        return true;
     }
 
     /**
      * Sets exceptions to indicate to the sender of this RPC call that it has been
-     * removed from its subgroup/shard, and can no longer expect responses.
+     * removed from its subgroup/shard, and can no longer expect responses. Since
+     * no more replies or persistence events will be delivered, this also
+     * releases the self-reference and discards any persistence callbacks.
      */
     void set_exception_for_caller_removed() {
-        if(!map_fulfilled) {
-            promise_for_pending_map.set_exception(
-                    std::make_exception_ptr(sender_removed_from_group_exception{}));
+        if(!has_event(REPLY_MAP_READY)) {
+            raise_event(CALLER_REMOVED);
         } else {
-            if(reply_promises.size() == 0) {
-                reply_promises = std::move(reply_promises_are_ready.get());
-            }
             //Set exceptions for any nodes that have not yet responded
-            for(auto& node_and_promise : reply_promises) {
-                std::lock_guard<std::mutex> lock(responded_nodes_mutex);
-                if(responded_nodes.find(node_and_promise.first)
-                   == responded_nodes.end()) {
-                    node_and_promise.second.set_exception(
-                            std::make_exception_ptr(sender_removed_from_group_exception{}));
+            for(ReplyEntry<Ret>& entry : replies) {
+                if(entry.second.set_exception(std::make_exception_ptr(sender_removed_from_group_exception{}))) {
+                    deliver_reply(entry);
+                    record_response();
                 }
             }
         }
+        end_persistence_events();
+        delete_self_ptr();
     }
 
     /**
-     * Fulfills a promise for a single node's reply to indicate that the node
-     * will never reply, by putting a node_removed_from_group_exception in the
-     * promise. This happens if the node is removed in a View change while the
-     * RPC is still awaiting its reply.
+     * Fulfills a single node's reply slot to indicate that the node will never
+     * reply, by putting a node_removed_from_group_exception in it. This happens
+     * if the node is removed in a View change while the RPC is still awaiting
+     * its reply.
      */
     void set_exception_for_removed_node(const node_id_t& removed_nid) {
-        assert(map_fulfilled);
-        if(reply_promises.size() == 0) {
-            reply_promises = std::move(reply_promises_are_ready.get());
-        }
-        std::lock_guard<std::mutex> lock(responded_nodes_mutex);
-        if(dest_nodes.find(removed_nid) != dest_nodes.end()
-           && responded_nodes.find(removed_nid) == responded_nodes.end()) {
-            //Mark the node as "responded" for the purposes of the other methods
-            responded_nodes.insert(removed_nid);
-            reply_promises.at(removed_nid).set_exception(std::make_exception_ptr(node_removed_from_group_exception{removed_nid}));
+        assert(has_event(REPLY_MAP_READY));
+        ReplyEntry<Ret>* entry = find_reply(removed_nid);
+        //If the node already responded, set_exception does nothing
+        if(entry && entry->second.set_exception(std::make_exception_ptr(node_removed_from_group_exception{removed_nid}))) {
+            deliver_reply(*entry);
+            record_response();
         }
     }
 
     /**
-     * Fulfills a promise for a single node's reply by setting the value that
-     * the node returned for the RPC call
+     * Fulfills a single node's reply slot by setting the value that the node
+     * returned for the RPC call. If the reply map has not been fulfilled yet,
+     * waits until it is.
      * @param nid The node that responded to the RPC call
      * @param v The value that it returned as the result of the RPC function
+     * @return True if this was the last reply the RPC call was waiting for,
+     * in which case the caller is responsible for calling delete_self_ptr()
      */
-    void set_value(const node_id_t& nid, const Ret& v) {
-        std::lock_guard<std::mutex> lock(reply_promises_are_ready_mutex);
-        {
-            std::lock_guard<std::mutex> lock(responded_nodes_mutex);
-            responded_nodes.insert(nid);
+    bool set_value(const node_id_t& nid, Ret v) {
+        if(!has_event(REPLY_MAP_READY)) {
+            dbg_trace(RpcLoggerPtr::get(), "PendingResults<{}>::set_value about to wait for the reply map", typeid(Ret).name());
+            await_event(REPLY_MAP_READY);
         }
-        if(reply_promises.size() == 0) {
-            dbg_trace(RpcLoggerPtr::get(), "PendingResults<{}>::set_value about to wait on reply_promises_are_ready", typeid(Ret).name());
-            reply_promises = std::move(reply_promises_are_ready.get());
+        ReplyEntry<Ret>* entry = find_reply(nid);
+        if(entry && entry->second.set_value(std::move(v))) {
+            deliver_reply(*entry);
+            return record_response();
         }
-        reply_promises.at(nid).set_value(v);
+        return false;
     }
 
     /**
-     * Fulfills a promise for a single node's reply by setting an exception that
-     * was thrown by the RPC function call.
+     * Fulfills a single node's reply slot by setting an exception that was
+     * thrown by the RPC function call.
      * @param nid The node that responded to the RPC call with an exception
      * @param e The exception_ptr that the RPC function call returned
+     * @return True if this was the last reply the RPC call was waiting for
      */
-    void set_exception(const node_id_t& nid, const std::exception_ptr e) {
-        {
-            std::lock_guard<std::mutex> lock(responded_nodes_mutex);
-            responded_nodes.insert(nid);
+    bool set_exception(const node_id_t& nid, const std::exception_ptr e) {
+        if(!has_event(REPLY_MAP_READY)) {
+            await_event(REPLY_MAP_READY);
         }
-        if(reply_promises.size() == 0) {
-            reply_promises = std::move(reply_promises_are_ready.get());
+        ReplyEntry<Ret>* entry = find_reply(nid);
+        if(entry && entry->second.set_exception(e)) {
+            deliver_reply(*entry);
+            return record_response();
         }
-        reply_promises.at(nid).set_exception(e);
+        return false;
     }
 
     /**
@@ -960,151 +1415,156 @@ public:
      * responded, either by sending a reply or by being removed from the group
      */
     bool all_responded() {
-        std::lock_guard<std::mutex> lock(responded_nodes_mutex);
-        return map_fulfilled && (responded_nodes == dest_nodes);
-    }
-
-    /**
-     * Fulfills the promise for the persistent version number.
-     * @param   assigned_version    The persistent version number that was assigned
-     *                              to the update generated by this RPC function call
-     * @param   assigned_timestamp  The timestamp to assign to the update
-     */
-    void set_persistent_version(persistent::version_t assigned_version, uint64_t assigned_timestamp) {
-        version_promise.set_value({assigned_version, assigned_timestamp});
-    }
-
-    /**
-     * Fulfills the local persistence promise, unblocking the future end. This
-     * should be called to signal client code that the update has finished
-     * persisting locally on this node.
-     */
-    void set_local_persistence() {
-        local_persistence_promise.set_value();
-    }
-
-    /**
-     * Fulfills the global persistence promise, unblocking the future end. This
-     * should be called to signal client code that the update has finished
-     * persisting on all replicas of this subgroup.
-     */
-    void set_global_persistence() {
-        global_persistence_promise.set_value();
-    }
-
-    /**
-     * Fulfills the signature verification promise, unblocking the future end.
-     * This should be called to signal client code that the update has been
-     * correctly signed on all replicas of this subgroup.
-     */
-    void set_signature_verified() {
-        signature_verified_promise.set_value();
-    }
-
-    /**
-     * @return A reference to the "object mutex" stored in this PendingResults.
-     * Callers should lock this mutex before performing a sequence of multiple
-     * method calls to prevent threads from interleaving between them.
-     */
-    std::mutex& object_mutex() {
-        return this_object_mutex;
+        return has_event(REPLY_MAP_READY) && num_responded.load() == replies.size();
     }
 };
 
 /**
  * Specialization of PendingResults for void functions, which do not generate
  * replies. It still fulfills the "reply map" in its corresponding QueryResults<void>,
- * which is just a set of nodes to which the RPC message was delivered. It also
- * fulfills the local and global persistence promises, since void functions can still
+ * which is just a list of nodes to which the RPC message was delivered. It also
+ * fulfills the local and global persistence events, since void functions can still
  * cause new persistent versions to be generated.
  */
 template <>
-class PendingResults<void> : public AbstractPendingResults, public std::enable_shared_from_this<PendingResults<void>> {
+class PendingResults<void> : public PendingResultsState {
 private:
-    std::promise<std::unique_ptr<std::set<node_id_t>>> promise_for_pending_map;
-    bool map_fulfilled = false;
-    std::promise<std::pair<persistent::version_t, uint64_t>> version_promise;
-    std::promise<void> local_persistence_promise;
-    std::promise<void> global_persistence_promise;
-    std::promise<void> signature_verified_promise;
+    /** The nodes that the RPC message was delivered to */
+    InlineArray<node_id_t, DERECHO_INLINE_REPLY_SLOTS> sent_nodes;
 
 public:
-    std::unique_ptr<QueryResults<void>> get_future() {
-        return std::make_unique<QueryResults<void>>(shared_from_this(),
-                                                    promise_for_pending_map.get_future(),
-                                                    version_promise.get_future(),
-                                                    local_persistence_promise.get_future(),
-                                                    global_persistence_promise.get_future(),
-                                                    signature_verified_promise.get_future());
+    static std::shared_ptr<PendingResults<void>> create() {
+        return std::allocate_shared<PendingResults<void>>(PooledAllocator<PendingResults<void>>{});
+    }
+
+    QueryResults<void> get_future() {
+        return QueryResults<void>(std::static_pointer_cast<PendingResults<void>>(shared_from_this()));
     }
 
-    void set_self_ptr(std::shared_ptr<PendingResults<void>>* heap_ptr) {
-        //Does nothing because RemoteInvoker doesn't create a heap-allocated pointer for PendingResults<void>
+    PendingResults<void>* hold_self_reference() {
+        //Does nothing because void functions never get replies, so nothing needs to find this object by its address
+        return nullptr;
     }
 
     void delete_self_ptr() {
         //Also does nothing for the above reason
     }
 
-    void fulfill_map(const node_list_t& sent_nodes) {
-        auto nodes_sent_set = std::make_unique<std::set<node_id_t>>();
-        for(const node_id_t& node : sent_nodes) {
-            nodes_sent_set->emplace(node);
-        }
-        promise_for_pending_map.set_value(std::move(nodes_sent_set));
-        map_fulfilled = true;
+    void fulfill_map(const node_list_t& who) {
+        sent_nodes.resize(who.size());
+        std::copy(who.begin(), who.end(), sent_nodes.begin());
+        //A void function has no replies to wait for, so it is also complete
+        raise_event(REPLY_MAP_READY | ALL_REPLIED);
+    }
+
+    bool contains(const node_id_t& nid) const {
+        return std::find(sent_nodes.begin(), sent_nodes.end(), nid) != sent_nodes.end();
+    }
+
+    const node_id_t* sent_nodes_begin() const { return sent_nodes.begin(); }
+    const node_id_t* sent_nodes_end() const { return sent_nodes.end(); }
+
+    bool reply_map_ready() const {
+        return has_event(REPLY_MAP_READY);
     }
 
     void set_exception_for_removed_node(const node_id_t&) {}
 
     void set_exception_for_caller_removed() {
-        if(!map_fulfilled) {
-            promise_for_pending_map.set_exception(
-                    std::make_exception_ptr(sender_removed_from_group_exception()));
+        if(!has_event(REPLY_MAP_READY)) {
+            raise_event(CALLER_REMOVED);
         }
+        end_persistence_events();
     }
 
     bool all_responded() {
-        return map_fulfilled;
+        return has_event(REPLY_MAP_READY);
     }
+};
 
-    /**
-     * Fulfills the promise for the persistent version number.
-     * @param   assigned_version    The persistent version number that was assigned
-     *                              to the update generated by this RPC function call
-     * @param   assigned_timestamp  The timestamp to assign to the update
-     */
-    void set_persistent_version(persistent::version_t assigned_version, uint64_t assigned_timestamp) {
-        version_promise.set_value({assigned_version, assigned_timestamp});
-    }
+bool QueryResults<void>::ReplyMap::valid(const node_id_t& nid) {
+    return results->reply_map_ready() && results->contains(nid);
+}
 
-    /**
-     * Fulfills the local persistence promise, unblocking the future end. This
-     * should be called to signal client code that the update has finished
-     * persisting locally on this node.
-     */
-    void set_local_persistence() {
-        local_persistence_promise.set_value();
-    }
+bool QueryResults<void>::ReplyMap::contains(const node_id_t& nid) {
+    return results->contains(nid);
+}
 
-    /**
-     * Fulfills the global persistence promise, unblocking the future end. This
-     * should be called to signal client code that the update has finished
-     * persisting on all replicas of this subgroup.
-     */
-    void set_global_persistence() {
-        global_persistence_promise.set_value();
-    }
+const node_id_t* QueryResults<void>::ReplyMap::begin() {
+    return results->sent_nodes_begin();
+}
 
-    /**
-     * Fulfills the signature verification promise, unblocking the future end.
-     * This should be called to signal client code that the update has been
-     * correctly signed on all replicas of this subgroup.
-     */
-    void set_signature_verified() {
-        signature_verified_promise.set_value();
+const node_id_t* QueryResults<void>::ReplyMap::end() {
+    return results->sent_nodes_end();
+}
+
+template <typename Time>
+QueryResults<void>::ReplyMap* QueryResults<void>::wait(Time t) {
+    if(paired_pending_results->await_reply_map_for(t)) {
+        return &replies;
+    } else {
+        return nullptr;
     }
-};
+}
+
+QueryResults<void>::ReplyMap& QueryResults<void>::get() {
+    paired_pending_results->await_reply_map();
+    return replies;
+}
+
+bool QueryResults<void>::is_ready() {
+    return paired_pending_results->reply_map_ready();
+}
+
+std::pair<persistent::version_t, uint64_t> QueryResults<void>::get_persistent_version() {
+    return paired_pending_results->await_persistent_version();
+}
+
+void QueryResults<void>::skip_persistence_tracking() {
+    paired_pending_results->disable_persistence_tracking();
+}
+
+void QueryResults<void>::await_local_persistence() {
+    paired_pending_results->await_local_persistence();
+}
+
+void QueryResults<void>::await_global_persistence() {
+    paired_pending_results->await_global_persistence();
+}
+
+void QueryResults<void>::await_signature_verification() {
+    paired_pending_results->await_signature_verification();
+}
+
+bool QueryResults<void>::local_persistence_is_ready() const {
+    return paired_pending_results->local_persistence_is_ready();
+}
+
+bool QueryResults<void>::global_persistence_is_ready() const {
+    return paired_pending_results->global_persistence_is_ready();
+}
+
+bool QueryResults<void>::global_verification_is_ready() const {
+    return paired_pending_results->signature_is_ready();
+}
+
+void QueryResults<void>::then(std::function<void(QueryResults<void>&)> continuation,
+                              const completion_executor_t& executor) {
+    paired_pending_results->add_continuation<void>(std::move(continuation), executor);
+}
+
+void QueryResults<void>::on_local_persistence(std::function<void()> callback, const completion_executor_t& executor) {
+    paired_pending_results->add_persistence_callback(PersistenceEvent::LOCAL, std::move(callback), executor);
+}
+
+void QueryResults<void>::on_global_persistence(std::function<void()> callback, const completion_executor_t& executor) {
+    paired_pending_results->add_persistence_callback(PersistenceEvent::GLOBAL, std::move(callback), executor);
+}
+
+void QueryResults<void>::on_signature_verification(std::function<void()> callback, const completion_executor_t& executor) {
+    paired_pending_results->add_persistence_callback(PersistenceEvent::SIGNATURE, std::move(callback), executor);
+}
+
 
 /**
  * Utility functions for manipulating the headers of RPC messages
@@ -1119,7 +1579,13 @@ namespace remote_invocation_utilities {
 
 // add new rpc header flags here.
 #define _RPC_HEADER_FLAG_CASCADE (0)
-#define _RPC_HEADER_FLAG_RESERVED (1)
+// the message body is a RendezvousDescriptor for a message the receiver must read from the sender
+#define _RPC_HEADER_FLAG_RENDEZVOUS (1)
+// the reply is not a real reply: the receiver of the request does not host the addressed subgroup,
+// so the requester's View is out of date. The body is the replying node's current View ID (int32_t)
+// followed by the invocation ID of the request it answers
+#define _RPC_HEADER_FLAG_STALE_VIEW (2)
+#define _RPC_HEADER_FLAG_RESERVED (3)
 
 inline std::size_t header_space() {
     return sizeof(std::size_t) + sizeof(Opcode) + sizeof(node_id_t) + sizeof(uint32_t);
@@ -1158,6 +1624,75 @@ inline void retrieve_header(const uint8_t* reply_buf,
     offset += sizeof(from);
     flags = reinterpret_cast<const uint32_t*>(reply_buf + offset)[0];
 }
+
+/**
+ * The body of a P2P message with the RENDEZVOUS header flag set. It identifies
+ * a registered buffer on the sending node that holds the real message (header
+ * included), which was too large to fit in a P2P message buffer.
+ */
+struct RendezvousDescriptor {
+    uint64_t remote_addr;
+    uint64_t rkey;
+    std::size_t size;
+};
+
+/**
+ * Fills a P2P message buffer with a rendezvous message: a header with the
+ * RENDEZVOUS flag set, followed by the descriptor of the staged message.
+ * @param msg_buf The P2P message buffer
+ * @param from The ID of the sending node
+ * @param is_reply Whether the staged message is a reply
+ * @param descriptor The descriptor of the buffer containing the staged message
+ */
+inline void populate_rendezvous_message(uint8_t* msg_buf, const node_id_t& from, bool is_reply,
+                                        const RendezvousDescriptor& descriptor) {
+    uint32_t flags = 0;
+    RPC_HEADER_FLAG_SET(flags, RENDEZVOUS);
+    Opcode op{};
+    op.is_reply = is_reply;
+    populate_header(msg_buf, sizeof(RendezvousDescriptor), op, from, flags);
+    std::memcpy(msg_buf + header_space(), &descriptor, sizeof(RendezvousDescriptor));
+}
+
+/**
+ * Extracts the descriptor of the staged message from a rendezvous message
+ * (one with the RENDEZVOUS header flag).
+ */
+inline RendezvousDescriptor retrieve_rendezvous_descriptor(const uint8_t* msg_buf) {
+    RendezvousDescriptor descriptor;
+    std::memcpy(&descriptor, msg_buf + header_space(), sizeof(RendezvousDescriptor));
+    return descriptor;
+}
+
+/**
+ * Copies the opcode and invocation ID of a staged request into its rendezvous
+ * message, once the request has been serialized into the rendezvous buffer.
+ * This lets the receiver answer the request with an exception even if it
+ * cannot read the staged message.
+ * @param msg_buf The P2P message buffer holding the rendezvous message
+ * @param staged_msg The rendezvous buffer holding the serialized request
+ */
+inline void complete_rendezvous_message(uint8_t* msg_buf, const uint8_t* staged_msg) {
+    std::size_t payload_size;
+    Opcode staged_op;
+    Opcode rendezvous_op;
+    node_id_t from;
+    uint32_t flags;
+    retrieve_header(staged_msg, payload_size, staged_op, from, flags);
+    retrieve_header(msg_buf, payload_size, rendezvous_op, from, flags);
+    populate_header(msg_buf, sizeof(RendezvousDescriptor) + sizeof(void*), staged_op, from, flags);
+    std::memcpy(msg_buf + header_space() + sizeof(RendezvousDescriptor), staged_msg + header_space(), sizeof(void*));
+}
+
+/**
+ * Extracts the invocation ID of the staged request from a rendezvous message
+ * that was completed by complete_rendezvous_message().
+ */
+inline void* retrieve_rendezvous_invocation_id(const uint8_t* msg_buf) {
+    void* invocation_id;
+    std::memcpy(&invocation_id, msg_buf + header_space() + sizeof(RendezvousDescriptor), sizeof(invocation_id));
+    return invocation_id;
+}
 }  // namespace remote_invocation_utilities
 
 }  // namespace rpc
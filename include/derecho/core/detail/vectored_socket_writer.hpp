@@ -0,0 +1,80 @@
+#pragma once
+
+#include <derecho/config.h>
+#include <derecho/tcp/tcp.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace derecho {
+
+/**
+ * Writes a stream of fragments, such as the ones produced by
+ * mutils::post_object, to a TCP socket with as few system calls as possible.
+ * Small fragments are copied into a staging buffer and sent together once it
+ * fills up. Large fragments are not copied: they are sent straight from the
+ * caller's memory, gathered into a single writev call with whatever is
+ * already in the staging buffer. This keeps serializing a container of many
+ * small elements from making a write() call per element, without adding a
+ * copy for objects made of a few large fragments.
+ *
+ * Fragments are always fully sent or copied before write() returns, so they
+ * can point to temporary memory.
+ */
+class VectoredSocketWriter {
+    tcp::socket& sock;
+    const std::size_t buffer_size;
+    const std::size_t direct_write_threshold;
+    std::unique_ptr<uint8_t[]> staging_buffer;
+    std::size_t staging_buffer_used;
+    /** The number of exceptions in flight when this writer was created */
+    const int uncaught_exceptions_at_creation;
+
+public:
+    /** The default size of the staging buffer, in bytes */
+    static constexpr std::size_t default_buffer_size = 64 * 1024;
+    /** The default size at which a fragment is sent without being copied, in bytes */
+    static constexpr std::size_t default_direct_write_threshold = 16 * 1024;
+
+    /**
+     * Creates a writer for a socket.
+     * @param sock The socket to write to, which must outlive this object
+     * @param buffer_size The size of the staging buffer for small fragments
+     * @param direct_write_threshold The size at or above which a fragment is
+     * sent directly from the caller's memory instead of being copied
+     */
+    VectoredSocketWriter(tcp::socket& sock,
+                         std::size_t buffer_size = default_buffer_size,
+                         std::size_t direct_write_threshold = default_direct_write_threshold);
+    /**
+     * Sends any data still in the staging buffer, unless the writer is being
+     * destroyed because an exception is propagating out of its scope. In that
+     * case the staged data is discarded, since it is probably an incomplete
+     * message that the remote node would misinterpret. Errors are ignored, so
+     * callers that need to know the data was sent should call flush() first.
+     */
+    ~VectoredSocketWriter();
+    /**
+     * Appends bytes to the stream.
+     * @throw a subclass of tcp::socket_error if the bytes, or bytes staged
+     * earlier, could not be written to the socket
+     */
+    void write(const uint8_t* bytes, std::size_t size);
+    /**
+     * Convenience method for appending a single POD object to the stream,
+     * like tcp::socket::write(const T&).
+     */
+    template <typename T>
+    void write(const T& obj) {
+        static_assert(std::is_pod<T>::value, "Can't use simple VectoredSocketWriter::write on non-POD types");
+        write(reinterpret_cast<const uint8_t*>(&obj), sizeof(obj));
+    }
+    /**
+     * Sends any data in the staging buffer.
+     * @throw a subclass of tcp::socket_error if it could not be written
+     */
+    void flush();
+};
+
+}  // namespace derecho
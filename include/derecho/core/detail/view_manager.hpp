@@ -10,6 +10,7 @@
 #include "../view.hpp"
 #include <derecho/conf/conf.hpp>
 #include <derecho/mutils-serialization/SerializationSupport.hpp>
+#include <derecho/tcp/event_loop.hpp>
 #include "derecho_internal.hpp"
 #include "locked_reference.hpp"
 #include "multicast_group.hpp"
@@ -20,6 +21,7 @@
 
 #include <spdlog/spdlog.h>
 
+#include <chrono>
 #include <list>
 #include <map>
 #include <memory>
@@ -106,6 +108,54 @@ enum class ExternalClientRequest {
     REMOVE_P2P     //!< REMOVE_P2P The external client is informing that it is exiting
 };
 
+/**
+ * A connection to this node's GMS port that the GMS event loop has finished
+ * reading from, waiting to be handled by the predicate thread. Connections
+ * come back through this queue after each stage of the handshake, so that
+ * the predicate thread never has to wait for the remote node to send
+ * something.
+ */
+struct PendingConnection {
+    tcp::socket socket;
+    JoinRequest join_request;
+    /**
+     * True once the remote node's answer to JoinResponseCode::OK has been
+     * received: the ports of a joining member, or the request of an external
+     * client.
+     */
+    bool request_received = false;
+    /** The request sent by an external client, if request_received is true */
+    ExternalClientRequest external_request = ExternalClientRequest::GET_VIEW;
+    /**
+     * The ports sent by a joining member, if request_received is true. For an
+     * external client that sent ESTABLISH_P2P, only external_port is set.
+     */
+    IpAndPorts ports;
+};
+
+/**
+ * The time this node spent in each phase of a view change, measured from the
+ * moment it wedged the old view until it installed the new one.
+ */
+struct ViewChangeTimings {
+    /** The ID of the view that was installed, or -1 if no view change has completed */
+    int32_t vid = -1;
+    /** Waiting for every live member to wedge the old view */
+    std::chrono::microseconds meta_wedge{0};
+    /** Flushing SST messages and waiting for the shard leaders' ragged trims */
+    std::chrono::microseconds epoch_termination{0};
+    /** Logging and echoing the ragged trims, and waiting for every member to echo them */
+    std::chrono::microseconds ragged_trim{0};
+    /** Delivering the ragged-edge messages and waiting for them to be persisted */
+    std::chrono::microseconds delivery_and_persistence{0};
+    /** Exchanging the new view and transferring state to new subgroup members */
+    std::chrono::microseconds state_transfer{0};
+    /** Connecting to joiners and setting up the new SST and MulticastGroup */
+    std::chrono::microseconds multicast_setup{0};
+    /** The whole view change, including the final view upcalls */
+    std::chrono::microseconds total{0};
+};
+
 template <typename T>
 using SharedLockedReference = LockedReference<std::shared_lock<std::shared_timed_mutex>, T>;
 
@@ -142,10 +192,10 @@ private:
      *  in the process of transitioning to a new view. */
     std::unique_ptr<View> next_view;
 
-    /** contains client sockets for pending requests that have not yet been handled.*/
-    LockedQueue<tcp::socket> pending_new_sockets;
-    /** On the leader node, contains client sockets for pending joins that have not yet been handled.*/
-    std::list<std::pair<node_id_t, tcp::socket>> pending_join_sockets;
+    /** contains client connections for pending requests that have not yet been handled.*/
+    LockedQueue<PendingConnection> pending_new_sockets;
+    /** On the leader node, contains connections to joining nodes that have sent their ports but have not yet been proposed.*/
+    std::list<PendingConnection> pending_join_sockets;
     /** The sockets connected to clients that will join in the next view, if any */
     std::list<std::pair<node_id_t, tcp::socket>> proposed_join_sockets;
     /**
@@ -153,7 +203,7 @@ private:
      * These must wait until the first view has committed and the SST is created before
      * being handled. After system startup, this list will be empty.
      */
-    std::list<std::pair<node_id_t, tcp::socket>> startup_pending_external_sockets;
+    std::list<PendingConnection> startup_pending_external_sockets;
 
     /** Contains old Views that need to be cleaned up. */
     std::queue<std::unique_ptr<View>> old_views;
@@ -168,8 +218,14 @@ private:
     tcp::connection_listener server_socket;
     /** A flag to signal background threads to shut down; set to true when the group is destroyed. */
     std::atomic<bool> thread_shutdown;
-    /** The background thread that listens for clients connecting on our server socket. */
-    std::thread client_listener_thread;
+    /**
+     * The event loop that accepts connections on server_socket and carries on
+     * the join and external-client handshakes, without blocking the predicate
+     * thread while it waits for a slow or unresponsive peer.
+     */
+    tcp::event_loop gms_event_loop;
+    /** The time the GMS event loop waits for a peer to send each part of a handshake. */
+    const int control_plane_timeout_ms;
     std::thread old_view_cleanup_thread;
 
     /**
@@ -268,6 +324,16 @@ private:
      */
     std::vector<std::vector<int64_t>> prior_view_shard_leaders;
 
+    /** The time at which this node started the view change in progress. */
+    std::chrono::steady_clock::time_point view_change_start_time;
+    /** The time at which the current phase of the view change in progress started. */
+    std::chrono::steady_clock::time_point view_change_phase_start_time;
+    /** Phase timings for the view change in progress; only accessed by the predicate thread. */
+    ViewChangeTimings pending_view_change_timings;
+    /** Phase timings for the last view change that completed. */
+    ViewChangeTimings last_view_change_timings;
+    std::mutex view_change_timings_mutex;
+
     /**
      * On a graceful exit, nodes will be agree to leave at some point, where
      * the view manager should stop throw exception on "failure". Set
@@ -289,9 +355,10 @@ private:
      */
     void new_suspicion(DerechoSST& gmsSST);
     /**
-     * A gateway that handles any socket connections, exchanges version code,
-     * reads JoinRequest and then decides whether to propose changes, redirect
-     * to leader, or handle as an external connection request.
+     * A gateway that handles the connections whose JoinRequest (or later
+     * handshake stage) has been received by the GMS event loop, and then
+     * decides whether to propose changes, redirect to leader, or handle as an
+     * external connection request.
      */
     void process_new_sockets();
     /**
@@ -303,8 +370,31 @@ private:
 
     /** Runs on non-leaders to redirect confused new members to the current leader. */
     void redirect_join_attempt(tcp::socket& client_socket);
-    /** Handles join request from external clients. */
-    void external_join_handler(tcp::socket& client_socket, const node_id_t& joiner_id);
+    /**
+     * Handles join request from external clients: responds to the JoinRequest,
+     * then has the GMS event loop receive the client's request.
+     */
+    void external_join_handler(PendingConnection&& connection);
+    /** Carries out an external client's request once the GMS event loop has received it. */
+    void handle_external_request(PendingConnection& connection);
+    /**
+     * Runs only on the leader. Responds to a joining node's JoinRequest, then
+     * has the GMS event loop receive the joining node's ports.
+     */
+    void accept_join_request(PendingConnection&& connection);
+    /**
+     * Called by the GMS event loop for each new connection on server_socket.
+     * Exchanges version codes and reads the JoinRequest without blocking,
+     * then queues the connection for process_new_sockets.
+     */
+    void receive_join_request(tcp::socket client_socket);
+    /**
+     * Has the GMS event loop read a fixed-size message that is the next stage
+     * of a handshake, then queues the connection for process_new_sockets
+     * again with the message filled in by fill_request.
+     */
+    void receive_handshake_stage(PendingConnection&& connection, std::size_t size,
+                                 std::function<void(PendingConnection&, const uint8_t*)> fill_request);
     /**
      * Runs once on a node that becomes a leader due to a failure. Searches for
      * and re-proposes changes proposed by prior leaders, as well as suspicions
@@ -362,12 +452,13 @@ private:
     /* ------------------- Helper methods for view-management triggers ------------------ */
 
     /**
-     * Assuming this node is the leader, handles a join request from a client.
-     * @param client_socket A TCP socket connected to the joining client
+     * Assuming this node is the leader, proposes a join for a client whose
+     * ports have already been received by the GMS event loop.
+     * @param joiner The connection to the joining client
      * @return True if the join succeeded, false if it failed because the
      *         client's ID was already in use.
      */
-    bool receive_join(DerechoSST& gmsSST, const node_id_t joiner_id, tcp::socket& client_socket);
+    bool receive_join(DerechoSST& gmsSST, PendingConnection& joiner);
 
     /**
      * Assuming the suspected[] array in the SST has changed, searches through
@@ -392,6 +483,16 @@ private:
     /** Sends a single subgroup's replicated object to a new member after a view change. */
     void send_subgroup_object(subgroup_id_t subgroup_id, node_id_t new_node_id);
 
+    /**
+     * Sends replicated objects to several nodes at once, using one thread per
+     * receiving node. Each node's objects are sent over its state-transfer
+     * socket in the order given, which must be the order in which the node
+     * receives them (ascending subgroup ID).
+     * @param subgroups_by_receiver A map from each receiving node's ID to the
+     * IDs of the subgroups whose objects it should be sent
+     */
+    void send_objects_in_parallel(const std::map<node_id_t, std::vector<subgroup_id_t>>& subgroups_by_receiver);
+
     /** Sends a joining node the new view that has been constructed to include it.*/
     void send_view(const View& new_view, tcp::socket& client_socket);
 
@@ -432,7 +533,8 @@ private:
      * Implements the Ragged Edge Cleanup algorithm for a subgroup/shard leader,
      * operating on the shard that this node is a member of. This computes the
      * last safely-deliverable message from each sender in the shard and places
-     * it in this node's SST row in the global_min field.
+     * it in this node's SST row in the global_min field; push_global_mins
+     * sends it to the rest of the shard.
      * @param subgroup_num The subgroup ID of the subgroup to do cleanup on
      * @param num_received_offset The offset into the SST's num_received field
      * that corresponds to the specified subgroup's entries in it
@@ -447,8 +549,9 @@ private:
                                     uint num_shard_senders);
     /**
      * Implements the Ragged Edge Cleanup algorithm for a non-leader node in a
-     * subgroup. This simply waits for the leader to write a value to global_min
-     * and then copies and uses it.
+     * subgroup. This copies the global_min the leader wrote into this node's
+     * SST row, which must be done only after the ragged trim has been logged;
+     * push_global_mins then echoes it to the rest of the shard.
      * @param subgroup_num The subgroup ID of the subgroup to do cleanup on
      * @param shard_leader_rank The rank of the leader node in this node's shard
      * of the specified subgroup
@@ -461,6 +564,28 @@ private:
                                       uint shard_leader_rank,
                                       const uint32_t num_received_offset,
                                       uint num_shard_senders);
+    /**
+     * Sends this node's global_min and global_min_ready entries for a set of
+     * subgroups to the members of its shards in those subgroups, using one
+     * RDMA write for each field instead of two per subgroup. Should be called
+     * after leader_ragged_edge_cleanup or follower_ragged_edge_cleanup has been
+     * called on every subgroup in the set.
+     * @param subgroups A map whose keys are the subgroup IDs to send
+     */
+    void push_global_mins(const std::map<subgroup_id_t, int>& subgroups);
+    /**
+     * Persists the ragged trims for several subgroups to disk at the same time,
+     * using one thread per subgroup, and returns when all of them are saved.
+     * @param shard_leader_ranks A map from subgroup ID to the rank of the node
+     * whose global_min row contains the ragged trim for that subgroup
+     */
+    void log_ragged_trims(const std::map<subgroup_id_t, int>& shard_leader_ranks);
+    /**
+     * Records the time elapsed since the start of the current view-change phase
+     * and starts the next phase.
+     * @param phase_duration The field of pending_view_change_timings to update
+     */
+    void end_view_change_phase(std::chrono::microseconds& phase_duration);
 
     /* -- Static helper methods that implement chunks of view-management functionality -- */
     /** Copies the local node's suspected array from the SST to an ordinary vector. */
@@ -861,6 +986,9 @@ public:
     /** Returns the order of this node in the sequence of members of the group */
     int32_t get_my_rank();
 
+    /** Returns the per-phase timings of the last view change this node completed */
+    ViewChangeTimings get_last_view_change_timings();
+
     /** Returns a vector of vectors listing the members of a single subgroup
      * (identified by type and index), organized by shard number. */
     std::vector<std::vector<node_id_t>> get_subgroup_members(subgroup_type_id_t subgroup_type, uint32_t subgroup_index);
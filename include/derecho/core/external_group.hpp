@@ -13,16 +13,23 @@
 #include "notification.hpp"
 #include "view.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <exception>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
+#include <set>
 #include <thread>
 #include <chrono>
+#include <condition_variable>
 #include <unordered_map>
+#include <vector>
 
 namespace derecho {
 
@@ -31,6 +38,41 @@ class ExternalGroupClient;
 
 using namespace rpc;
 
+/**
+ * The ways an ExternalClientCaller can choose which member of a shard a
+ * routed P2P call (p2p_send_to_shard) is sent to.
+ */
+enum class ReplicaSelectionPolicy {
+    /** Cycle through the members of the shard */
+    ROUND_ROBIN,
+    /** Pick the member with the fewest calls from this client still awaiting replies */
+    LEAST_OUTSTANDING,
+    /**
+     * Pick the member with the lowest exponentially-weighted moving average of
+     * reply latency, scaled by its number of outstanding calls so that a fast
+     * member does not attract every call; members with no latency samples yet
+     * are tried first
+     */
+    LATENCY_EWMA,
+    /**
+     * Pick a member by hashing the key passed to p2p_send_to_shard_by_key, so
+     * calls with the same key go to the same member while the shard is unchanged
+     */
+    KEY_HASH
+};
+
+/** The state of an ExternalGroupClient's P2P connection to a group member */
+enum class ConnectionState {
+    /** No connection has been attempted since the member joined */
+    NOT_CONNECTED,
+    /** A thread is currently setting up the connection */
+    CONNECTING,
+    /** The connection is ready for P2P calls */
+    CONNECTED,
+    /** The last attempt to connect failed; the next call to the member will retry */
+    FAILED
+};
+
 /**
  * This class represents a "handle" for communicating with a specific type of
  * subgroup using its RPC functions. It can be used to send P2P RPC messages to
@@ -57,6 +99,35 @@ private:
     mutable std::unique_ptr<std::mutex> client_stub_mutex;
     std::unique_ptr<rpc::RemoteInvocableOf<T>> remote_invocable_ptr;
 
+    /** The policy used by p2p_send_to_shard to choose a member of the shard */
+    ReplicaSelectionPolicy selection_policy;
+    /** Guards the routing cache below; a pointer so that ExternalClientCaller stays movable */
+    std::unique_ptr<std::mutex> routing_mutex;
+    /** The routing cache: the members of each shard of this subgroup, copied from the client's View */
+    std::vector<std::vector<node_id_t>> shard_members;
+    /** The ID of the View that shard_members was copied from, or -1 if it has not been filled in */
+    int32_t shard_members_vid;
+    /** The round-robin position in each shard */
+    std::vector<uint32_t> next_replica;
+
+    /**
+     * Chooses the member of a shard that a routed call should be sent to,
+     * refreshing the routing cache first if the client's View has changed or
+     * has been reported as stale.
+     * @param shard_num The shard to send to
+     * @param key The key to hash if the policy is KEY_HASH; if empty, KEY_HASH
+     * falls back to round-robin
+     * @return The ID of the chosen member
+     */
+    node_id_t choose_replica(uint32_t shard_num, const std::optional<uint64_t>& key);
+
+    /**
+     * Sends a routed call to a member of a shard, retrying once with a
+     * refreshed View if the chosen member turns out to have left the group.
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto routed_p2p_send(uint32_t shard_num, const std::optional<uint64_t>& key, Args&&... args);
+
 public:
     /**
      * Constructs an ExternalClientCaller that can communicate with members of
@@ -103,6 +174,47 @@ public:
      */
     template <rpc::FunctionTag tag, typename... Args>
     auto p2p_send(node_id_t dest_node, Args&&... args);
+
+    /**
+     * Sends a peer-to-peer message like p2p_send(), but returns std::nullopt
+     * instead of blocking if the P2P connection's window and overflow queue
+     * are both full.
+     * @param dest_node The ID of the node that the P2P message should be sent to
+     * @param args The arguments to the RPC function being invoked
+     * @return An optional containing the rpc::QueryResults<Ret> that p2p_send()
+     * would return, or std::nullopt if the connection to dest_node is full
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto try_p2p_send(node_id_t dest_node, Args&&... args);
+
+    /**
+     * Sends a peer-to-peer message to one member of a shard of this subgroup,
+     * chosen by the caller's ReplicaSelectionPolicy from a cached copy of the
+     * shard's membership. If the group reports that the cached membership is
+     * out of date, the client's View is refreshed before the next routed call.
+     * @param shard_num The shard that should handle the call
+     * @param args The arguments to the RPC function being invoked
+     * @return An instance of rpc::QueryResults<Ret>, where Ret is the return type
+     * of the RPC function being invoked
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto p2p_send_to_shard(uint32_t shard_num, Args&&... args);
+
+    /**
+     * Sends a peer-to-peer message to one member of a shard like
+     * p2p_send_to_shard(), providing a key for the KEY_HASH policy. Under any
+     * other policy the key is ignored.
+     * @param shard_num The shard that should handle the call
+     * @param key A key identifying the object the call is about
+     * @param args The arguments to the RPC function being invoked
+     * @return An instance of rpc::QueryResults<Ret>, where Ret is the return type
+     * of the RPC function being invoked
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto p2p_send_to_shard_by_key(uint32_t shard_num, uint64_t key, Args&&... args);
+
+    /** Changes the policy used to choose a shard member for p2p_send_to_shard. */
+    void set_replica_selection_policy(ReplicaSelectionPolicy policy);
 };
 
 /**
@@ -123,13 +235,48 @@ private:
     template <typename T, typename ExternalGroupType>
     friend class ExternalClientCaller;
     const node_id_t my_id;
-    std::unique_ptr<View> prev_view;
-    std::unique_ptr<View> curr_view;
+    /**
+     * The previous and current Views. get_view() replaces them while holding
+     * view_mutex; every other function reads the current View through a
+     * snapshot from get_current_view(), since the View may be replaced by
+     * another thread at any time.
+     */
+    std::shared_ptr<View> prev_view;
+    std::shared_ptr<View> curr_view;
+    mutable std::mutex view_mutex;
     std::unique_ptr<sst::P2PConnectionManager> p2p_connections;
     std::unique_ptr<std::map<rpc::Opcode, rpc::receive_fun_t>> receivers;
     std::map<subgroup_id_t, std::list<std::weak_ptr<AbstractPendingResults>>> fulfilled_pending_results;
+    /** Guards fulfilled_pending_results, which the P2P listening thread also uses */
+    std::mutex fulfilled_pending_results_mutex;
     std::map<subgroup_id_t, uint64_t> max_payload_sizes;
 
+    /** Load statistics for one group member, used to route calls from ExternalClientCallers */
+    struct ReplicaLoad {
+        /** The number of routed calls to this member that are still awaiting replies */
+        uint32_t outstanding = 0;
+        /** The exponentially-weighted moving average of reply latency, in microseconds */
+        double latency_ewma_us = 0;
+        /** The number of latency samples that contributed to latency_ewma_us */
+        uint64_t latency_samples = 0;
+    };
+    /** The weight of the newest sample in ReplicaLoad::latency_ewma_us */
+    static constexpr double latency_ewma_weight = 0.2;
+    std::map<node_id_t, ReplicaLoad> replica_loads;
+    /**
+     * Guards replica_loads. Completion callbacks of routed calls take this
+     * lock, so no other lock may be held while acquiring it.
+     */
+    std::mutex replica_loads_mutex;
+    /** Serializes the lazy refresh of the View by routed calls */
+    std::mutex view_refresh_mutex;
+    /**
+     * Set when a member reports that it does not host a subgroup this client
+     * sent a request to, or when a member this client was routed to has left;
+     * the View will be refreshed before the next routed call.
+     */
+    std::atomic<bool> view_is_stale{false};
+
     template <typename T>
     using external_caller_index_map = std::map<uint32_t, ExternalClientCaller<T, ExternalGroupClient<ReplicatedTypes...>>>;
     mutils::KindMap<external_caller_index_map, ReplicatedTypes...> external_callers;
@@ -143,12 +290,27 @@ private:
      */
     mutils::KindMap<NoArgFactory, ReplicatedTypes...> factories;
 
+    /** The state of each member connection that has been attempted; members with no entry are NOT_CONNECTED */
+    std::map<node_id_t, ConnectionState> connection_states;
+    /** Guards connection_states and prewarmed_subgroups */
+    std::mutex connection_states_mutex;
+    /** Notified whenever a connection leaves the CONNECTING state */
+    std::condition_variable connection_state_changed;
+    /** The subgroups passed to prewarm_subgroup, whose new members are connected after each view change */
+    std::set<subgroup_id_t> prewarmed_subgroups;
+    /** True if every member of the group is connected at construction and after each view change */
+    const bool prewarm_all_members;
+    /** The maximum number of threads prewarm_connections uses to connect to members */
+    static constexpr std::size_t max_parallel_connects = 16;
+
     /**
      * requests a new view from group member nid
      * if nid is -1, then request a view from Conf::DERECHO_CONTACT_IP
      * defined in derecho.cfg
      */
     bool get_view(const node_id_t nid);
+    /** @return A snapshot of the current View, which stays valid even if the View is replaced */
+    std::shared_ptr<View> get_current_view() const;
     void clean_up();
     uint32_t get_index_of_type(const std::type_info& ti) const;
     /**
@@ -156,12 +318,74 @@ private:
      * on the current view and uses them to construct p2p_connections.
      */
     void initialize_p2p_connections();
+    /**
+     * Sets up the P2P connection to a group member, if it does not already
+     * exist. If another thread is already connecting to the same member, waits
+     * for that attempt to finish instead of starting a second one.
+     * @param dest_node The ID of the member
+     * @throw derecho_exception if the connection could not be established
+     */
+    void establish_p2p_connection(node_id_t dest_node);
+    /**
+     * Sets up the P2P connection to a group member like
+     * establish_p2p_connection(node_id_t), using an address that was already
+     * looked up in the View.
+     * @param dest_node The ID of the member
+     * @param member_address The member's addresses, or std::nullopt if it is
+     * not in the View
+     * @throw derecho_exception if the connection could not be established
+     */
+    void establish_p2p_connection(node_id_t dest_node, const std::optional<IpAndPorts>& member_address);
+    /**
+     * Connects to the current members of every pre-warmed subgroup (or of the
+     * whole group if prewarm_all_members is set) that are not yet connected.
+     * Called after each view change.
+     */
+    void reconnect_prewarmed_members();
+
+    /**
+     * Refreshes the View if it has been marked stale, then copies the shard
+     * membership of a subgroup from the View if the caller's copy is older.
+     * Called by ExternalClientCallers before routing a call.
+     * @param subgroup_id The subgroup whose shard membership is needed
+     * @param cached_vid The ID of the View the caller's copy came from
+     * @param shard_members The caller's copy, which is overwritten if the View
+     * has changed since cached_vid
+     * @return The ID of the current View
+     */
+    int32_t refresh_shard_layout(subgroup_id_t subgroup_id, int32_t cached_vid,
+                                 std::vector<std::vector<node_id_t>>& shard_members);
+    /** Marks the View as stale, so it will be refreshed before the next routed call. */
+    void mark_view_stale();
+    /**
+     * Chooses a member of a shard according to a policy, using the load
+     * statistics collected from earlier routed calls.
+     * @param replicas The members of the shard, which must not be empty
+     * @param policy The selection policy
+     * @param hint The round-robin position or hashed key, depending on the policy
+     */
+    node_id_t select_replica(const std::vector<node_id_t>& replicas, ReplicaSelectionPolicy policy, uint64_t hint);
+    /** Records that a routed call has been sent to a member */
+    void record_call_sent(node_id_t replica);
+    /** Records that a routed call to a member completed after the given time */
+    void record_call_completed(node_id_t replica, std::chrono::nanoseconds latency);
 
     /** ======================== copy/paste from rpc_manager ======================== **/
     std::shared_ptr<spdlog::logger> rpc_logger;
     const uint64_t busy_wait_before_sleep_ms;
     sst::P2PBufferHandle get_sendbuffer_ptr(uint32_t dest_id, sst::MESSAGE_TYPE type);
+    sst::P2PBufferHandle get_sendbuffer_ptr(uint32_t dest_id, sst::MESSAGE_TYPE type, std::size_t size);
+    uint8_t* stage_rendezvous_message(node_id_t dest_id, sst::MESSAGE_TYPE type,
+                                      const sst::P2PBufferHandle& msg_buffer, std::size_t size);
+    sst::RendezvousReadBuffer read_rendezvous_message(node_id_t sender_id, sst::MESSAGE_TYPE type,
+                                                      const rpc::remote_invocation_utilities::RendezvousDescriptor& descriptor);
+    bool p2p_send_has_space(uint32_t dest_id);
     void send_p2p_message(node_id_t dest_id, subgroup_id_t dest_subgroup_id, uint64_t sequence_num, std::weak_ptr<AbstractPendingResults> pending_results_handle);
+    void send_exception_reply(node_id_t dest_id, const rpc::Opcode& request_opcode, void* invocation_id,
+                              const rpc::remote_exception_info& exception_info);
+    /** message and rendezvous buffers of staged requests, completed by send_p2p_message */
+    std::map<std::pair<node_id_t, uint64_t>, std::pair<uint8_t*, uint8_t*>> staged_rendezvous_requests;
+    std::mutex staged_rendezvous_requests_mutex;
     std::atomic<bool> thread_shutdown{false};
     std::thread rpc_listener_thread;
     /** p2p send and queries are queued in fifo worker */
@@ -179,9 +403,19 @@ private:
     std::queue<p2p_req> p2p_request_queue;
     std::mutex request_queue_mutex;
     std::condition_variable request_queue_cv;
+    /** oversized replies are read and handled by their own worker, in the order they arrived */
+    std::thread rendezvous_reply_thread;
+    struct rendezvous_reply {
+        node_id_t sender_id;
+        rpc::remote_invocation_utilities::RendezvousDescriptor descriptor;
+    };
+    std::queue<rendezvous_reply> rendezvous_reply_queue;
+    std::mutex rendezvous_reply_mutex;
+    std::condition_variable rendezvous_reply_cv;
     mutils::RemoteDeserialization_v deserialization_contexts;
     void p2p_receive_loop();
     void p2p_request_worker();
+    void rendezvous_reply_worker();
     void p2p_message_handler(node_id_t sender_id, uint8_t* msg_buf);
     std::exception_ptr receive_message(const rpc::Opcode& indx, const node_id_t& received_from,
                                        uint8_t const* const buf, std::size_t payload_size,
@@ -291,6 +525,40 @@ public:
     template <typename SubgroupType>
     std::vector<std::vector<node_id_t>> get_subgroup_members(uint32_t subgroup_index = 0) const;
 
+    /**
+     * Connects to a set of group members in parallel, so later P2P calls to
+     * them do not pay the connection setup cost. Members that are already
+     * connected are skipped.
+     * @param nodes The IDs of the members to connect to
+     * @return The IDs of the members that could not be connected to
+     */
+    std::vector<node_id_t> prewarm_connections(const std::vector<node_id_t>& nodes);
+    /**
+     * Connects to every member of a subgroup in parallel, and remembers the
+     * subgroup so that members that join it in later views are connected as
+     * soon as this client learns of the new view. Connections to members that
+     * stay in the subgroup are kept across view changes.
+     * @tparam SubgroupType     The type of the subgroup
+     * @param subgroup_index    The index of the subgroup of type 'SubgroupType'
+     * @return The IDs of the members that could not be connected to
+     */
+    template <typename SubgroupType>
+    std::vector<node_id_t> prewarm_subgroup(uint32_t subgroup_index = 0);
+    /**
+     * Get the state of this client's P2P connection to a group member.
+     * @param node_id   The ID of the member
+     * @return      The connection state
+     */
+    ConnectionState get_connection_state(node_id_t node_id);
+    /**
+     * Check whether this client is connected to every member of a subgroup.
+     * @tparam SubgroupType     The type of the subgroup
+     * @param subgroup_index    The index of the subgroup of type 'SubgroupType'
+     * @return      true if every member of the subgroup can be sent P2P calls without connecting first
+     */
+    template <typename SubgroupType>
+    bool subgroup_connections_ready(uint32_t subgroup_index = 0);
+
     /**
      * Get Out-of-band memory region's remote access key
      * @param addr      The address of the memory region
@@ -326,6 +594,20 @@ public:
      * @throw           derecho::derecho_exception on failure
      */
     void deregister_oob_memory(void* addr);
+
+    /**
+     * Allocates zeroed memory for out-of-band buffers from Derecho's registered
+     * memory allocator, which places it on the pages and NUMA node configured
+     * for RDMA memory. If DERECHO/registration_cache_entries is nonzero,
+     * registering buffers inside this memory with register_oob_memory reuses
+     * cached registrations; memory from any other allocator is registered
+     * every time. The memory is freed when the returned pointer is destroyed.
+     *
+     * @param size      The size in bytes of the memory
+     * @return          The memory, or an empty pointer if size is 0
+     * @throw           std::bad_alloc if the memory can't be allocated
+     */
+    registered_array<uint8_t> allocate_oob_memory(size_t size);
 };
 }  // namespace derecho
 
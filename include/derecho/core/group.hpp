@@ -11,6 +11,7 @@
 #include "derecho_exception.hpp"
 #include "detail/derecho_internal.hpp"
 #include "detail/persistence_manager.hpp"
+#include "detail/registered_memory.hpp"
 #include "detail/rpc_manager.hpp"
 #include "detail/view_manager.hpp"
 #include "notification.hpp"
@@ -21,15 +22,19 @@
 #include <mutils-containers/TypeMap2.hpp>
 
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <ctime>
+#include <deque>
 #include <exception>
 #include <iostream>
 #include <list>
 #include <map>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <typeindex>
 #include <utility>
@@ -262,7 +267,10 @@ private:
     /**
      * Updates the state of the replicated objects that correspond to subgroups
      * identified in the provided map, by receiving serialized state from the
-     * shard leader whose ID is paired with that subgroup ID.
+     * shard leader whose ID is paired with that subgroup ID. Objects from
+     * different leaders are received in parallel, and each object is
+     * deserialized as soon as it arrives, while the others are still being
+     * received.
      * @param subgroups_and_leaders Pairs of (subgroup ID, leader's node ID) for
      * subgroups that need to have their state initialized from the leader.
      */
@@ -455,6 +463,12 @@ public:
      */
     std::vector<IpAndPorts> get_member_addresses();
 
+    /**
+     * @returns how long each phase of the last view change took on this node,
+     * or a ViewChangeTimings with vid -1 if no view change has completed yet.
+     */
+    ViewChangeTimings get_last_view_change_timings();
+
     /**
      * Returns the number of subgroups of the specified type. This information
      * is also in the configuration file or SubgroupInfo function, but this method
@@ -573,6 +587,20 @@ public:
      * @throw       derecho::derecho_exception on failure
      */
     void deregister_oob_memory(void* addr);
+
+    /**
+     * Allocates zeroed memory for out-of-band buffers from Derecho's registered
+     * memory allocator, which places it on the pages and NUMA node configured
+     * for RDMA memory. If DERECHO/registration_cache_entries is nonzero,
+     * registering buffers inside this memory with register_oob_memory reuses
+     * cached registrations; memory from any other allocator is registered
+     * every time. The memory is freed when the returned pointer is destroyed.
+     *
+     * @param size      The size in bytes of the memory
+     * @return          The memory, or an empty pointer if size is 0
+     * @throw           std::bad_alloc if the memory can't be allocated
+     */
+    registered_array<uint8_t> allocate_oob_memory(size_t size);
 };
 
 } /* namespace derecho */
@@ -8,15 +8,32 @@
 #include <derecho/config.h>
 #include <derecho/mutils-serialization/SerializationMacros.hpp>
 #include <derecho/mutils-serialization/SerializationSupport.hpp>
+#include "derecho_type_definitions.hpp"
 #include "register_rpc_functions.hpp"
 
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 namespace derecho {
 
 struct NotificationMessage : mutils::ByteRepresentable {
+    /**
+     * The message_type reserved for messages that carry several coalesced
+     * notifications in their body. Each notification in a batch is encoded
+     * the same way NotificationMessage::to_bytes encodes it. User-defined
+     * notification types must not use this value.
+     */
+    static constexpr uint64_t BATCH_MESSAGE_TYPE = std::numeric_limits<uint64_t>::max();
+
     /**
      * A number identifying the type of notification message, which can be
      * defined and interpreted by the notification-supporting class in any
@@ -93,6 +110,15 @@ struct NotificationMessage : mutils::ByteRepresentable {
     static mutils::context_ptr<const NotificationMessage> from_bytes_noalloc_const(
             mutils::DeserializationManager* ctx,
             const uint8_t* const buffer);
+
+    /**
+     * Calls a function on each notification contained in this message. If
+     * this is a batch message (its type is BATCH_MESSAGE_TYPE), the function
+     * is called once for each coalesced notification, in the order they were
+     * published, with a temporary that does not own its body; otherwise it is
+     * called once on this message.
+     */
+    void for_each_message(const std::function<void(const NotificationMessage&)>& func) const;
 };
 
 using notification_handler_t = std::function<void(const NotificationMessage&)>;
@@ -109,7 +135,7 @@ public:
     virtual void notify(const NotificationMessage& msg) const {
         dbg_default_trace("notification message of type {} received.", msg.message_type);
         if (handler) {
-            (*handler)(msg);
+            msg.for_each_message(*handler);
         }
     }
 
@@ -122,4 +148,135 @@ public:
     }
 };
 
+/**
+ * What a NotificationDispatcher does when a notification is published to a
+ * client whose queue is already full, i.e. a client that is consuming
+ * notifications more slowly than they are being published.
+ */
+enum class SlowConsumerPolicy {
+    /** Discard the oldest queued notification to make room for the new one */
+    DROP_OLDEST,
+    /** Discard the new notification and keep the queue as it is */
+    DROP_NEWEST,
+    /**
+     * Replace any queued notification with the same topic and message_type
+     * by the new one, so the client only sees the latest value of each. This
+     * is applied even when the queue is not full; if there is nothing to
+     * merge with and the queue is full, the oldest notification is dropped.
+     */
+    MERGE_BY_TYPE
+};
+
+struct NotificationDispatcherOptions {
+    /** The maximum number of notifications queued for a single client; 0 means unbounded */
+    std::size_t max_queue_depth = 1024;
+    /**
+     * The maximum size, in serialized bytes, of the notifications that will be
+     * coalesced into one message to a client; 0 means no limit.
+     */
+    std::size_t max_batch_bytes = 0;
+    SlowConsumerPolicy slow_consumer_policy = SlowConsumerPolicy::DROP_OLDEST;
+};
+
+struct NotificationDispatcherStats {
+    /** Number of calls to publish() or notify_client() */
+    uint64_t published = 0;
+    /** Number of notifications placed in a client queue */
+    uint64_t enqueued = 0;
+    /** Number of notifications that reached a client's P2P connection */
+    uint64_t delivered = 0;
+    /** Number of P2P messages sent; less than delivered when notifications were coalesced */
+    uint64_t messages_sent = 0;
+    /** Number of notifications discarded because a client's queue was full */
+    uint64_t dropped = 0;
+    /** Number of notifications that replaced a queued one under MERGE_BY_TYPE */
+    uint64_t merged = 0;
+};
+
+/**
+ * A server-side engine for sending notifications to many external clients.
+ * Clients subscribe to numeric topics, and publish() queues a notification for
+ * every subscriber of a topic and returns without sending anything, so it is
+ * safe to call from an RPC handler. A dedicated thread drains the per-client
+ * queues, coalescing everything queued for a client into a single message,
+ * and skips over clients whose P2P connection has no space rather than
+ * waiting for them. While a client is backed up, its queue is bounded
+ * according to the configured SlowConsumerPolicy.
+ */
+class NotificationDispatcher {
+public:
+    using topic_t = uint64_t;
+    /**
+     * The function the dispatcher uses to send a message to one client. It
+     * should return false, without blocking, if the message cannot be sent
+     * right now, and throw a derecho_exception if the client is gone.
+     */
+    using send_function_t = std::function<bool(node_id_t, const NotificationMessage&)>;
+
+private:
+    using queue_entry_t = std::pair<topic_t, std::shared_ptr<const NotificationMessage>>;
+    struct ClientQueue {
+        std::unordered_set<topic_t> topics;
+        std::deque<queue_entry_t> pending;
+        /** True if the client is in ready_clients or blocked_clients, or is being sent to */
+        bool scheduled = false;
+    };
+
+    const send_function_t send_function;
+    const NotificationDispatcherOptions options;
+    /** Guards all of the state below */
+    std::mutex state_mutex;
+    std::condition_variable work_available;
+    std::condition_variable queues_drained;
+    std::unordered_map<topic_t, std::unordered_set<node_id_t>> subscribers;
+    std::unordered_map<node_id_t, ClientQueue> clients;
+    /** Clients that have notifications waiting to be sent */
+    std::deque<node_id_t> ready_clients;
+    /** Clients whose last send failed for lack of space, to be retried after a short wait */
+    std::deque<node_id_t> blocked_clients;
+    /** Total number of notifications in all client queues, plus those being sent */
+    std::size_t total_pending;
+    NotificationDispatcherStats stats;
+    bool thread_shutdown;
+    std::thread dispatch_thread;
+
+    void dispatch_loop();
+    /** Adds a notification to a client's queue, applying the slow-consumer policy. Called with state_mutex held. */
+    void enqueue(node_id_t client_id, ClientQueue& queue, topic_t topic,
+                 const std::shared_ptr<const NotificationMessage>& message);
+    /** Removes a client and all of its subscriptions. Called with state_mutex held. */
+    void remove_client_locked(node_id_t client_id);
+
+public:
+    NotificationDispatcher(const send_function_t& send_function,
+                           const NotificationDispatcherOptions& options = NotificationDispatcherOptions{});
+    NotificationDispatcher(const NotificationDispatcher&) = delete;
+    /** Stops the dispatch thread; notifications that have not been sent yet are discarded. */
+    ~NotificationDispatcher();
+
+    /** Subscribes an external client to a topic. Subscribing twice has no effect. */
+    void subscribe(node_id_t client_id, topic_t topic);
+    /** Unsubscribes an external client from a topic; notifications already queued are still sent. */
+    void unsubscribe(node_id_t client_id, topic_t topic);
+    /** Removes all of a client's subscriptions and discards its queued notifications. */
+    void remove_client(node_id_t client_id);
+
+    /**
+     * Queues a notification for every client subscribed to a topic. The
+     * message is copied once and shared among all of the client queues.
+     * @return The number of clients the notification was queued for
+     */
+    std::size_t publish(topic_t topic, NotificationMessage message);
+    /**
+     * Queues a notification for a single client, regardless of its
+     * subscriptions. It is coalesced with the client's other notifications as
+     * if it had been published to topic 0.
+     */
+    void notify_client(node_id_t client_id, NotificationMessage message);
+
+    /** Blocks until every queued notification has been sent or discarded. */
+    void wait_until_drained();
+    NotificationDispatcherStats get_stats();
+};
+
 }  // namespace derecho
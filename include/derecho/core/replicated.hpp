@@ -9,7 +9,10 @@
 #include <derecho/persistent/Persistent.hpp>
 #include <derecho/tcp/tcp.hpp>
 #include "derecho_exception.hpp"
+#include "notification.hpp"
 #include "detail/derecho_internal.hpp"
+#include "detail/pipelined_socket_writer.hpp"
+#include "detail/vectored_socket_writer.hpp"
 #include "detail/remote_invocable.hpp"
 #include "detail/replicated_interface.hpp"
 #include "detail/rpc_manager.hpp"
@@ -18,6 +21,7 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <tuple>
 #include <type_traits>
@@ -266,6 +270,20 @@ public:
     template <rpc::FunctionTag tag, typename... Args>
     auto p2p_send(node_id_t dest_node, Args&&... args) const;
 
+    /**
+     * Sends a peer-to-peer message like p2p_send(), but only if it can be sent
+     * without waiting for the destination node to reply to earlier messages.
+     * P2P requests that do not fit in the connection's window are held in an
+     * overflow queue; when that queue is also full, p2p_send() would block,
+     * and this method returns an empty optional instead.
+     * @param dest_node The ID of the node that the P2P message should be sent to
+     * @param args The arguments to the RPC function being invoked
+     * @return An optional containing the rpc::QueryResults<Ret> that p2p_send()
+     * would return, or std::nullopt if the connection to dest_node is full
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto try_p2p_send(node_id_t dest_node, Args&&... args) const;
+
     /**
      * Sends a multicast to the entire subgroup that replicates this Replicated<T>,
      * invoking the RPC function identified by the FunctionTag template parameter.
@@ -319,6 +337,13 @@ public:
      */
     virtual persistent::version_t get_minimum_latest_persisted_version();
 
+    /**
+     * Returns true if every Persistent field of this object can rebuild its
+     * current state from its local log, so that a joining node only needs to
+     * be sent the log entries it is missing.
+     */
+    virtual bool can_rebuild_from_log() const;
+
     /**
      * Returns the current global persistence frontier, aka, stable frontier that will survive whole system restart.
      * Please note this applies to persistent data ONLY. The data not in Persistent<> are not saved.
@@ -490,7 +515,9 @@ public:
      * this Replicated<T> over the given socket *without* first sending its size.
      * Should only be used when sending a list of objects, preceded by their
      * total size, otherwise the recipient will have no way of knowing how large
-     * a buffer to allocate for this object.
+     * a buffer to allocate for this object. Unless the configured
+     * state-transfer chunk size is 0, the object is serialized into chunks
+     * that a background thread sends while the next chunk is serialized.
      * @param receiver_socket
      */
     virtual void send_object_raw(tcp::socket& receiver_socket) const;
@@ -611,11 +638,20 @@ private:
     rpc::RPCManager& group_rpc_manager;
     /** The actual implementation of ExternalClientCallback, which has lots of ugly template parameters */
     std::unique_ptr<rpc::RemoteInvokerFor<T>> wrapped_this;
+    /** Guards the lazy construction of notification_dispatcher */
+    std::mutex dispatcher_mutex;
+    /**
+     * The fan-out engine used to send notifications to subscribed clients, created
+     * by the first call to get_notification_dispatcher(). It is declared last so
+     * that its thread stops before the rest of this object is destroyed.
+     */
+    std::unique_ptr<NotificationDispatcher> notification_dispatcher;
 
 public:
     ExternalClientCallback(uint32_t type_id, node_id_t nid, subgroup_id_t subgroup_id, rpc::RPCManager& group_rpc_manager);
 
-    ExternalClientCallback(ExternalClientCallback&&) = default;
+    // Not movable, since the notification dispatcher's send function refers to this object
+    ExternalClientCallback(ExternalClientCallback&&) = delete;
     ExternalClientCallback(const ExternalClientCallback&) = delete;
 
     /**
@@ -642,6 +678,32 @@ public:
     template <rpc::FunctionTag tag, typename... Args>
     auto p2p_send(node_id_t dest_node, Args&&... args);
 
+    /**
+     * Sends a peer-to-peer message like p2p_send(), but returns an empty
+     * optional instead of blocking if the connection to the client is full.
+     * @param dest_node The ID of the node that the P2P message should be sent to
+     * @param args The arguments to the RPC function being invoked
+     * @return An optional containing the rpc::QueryResults<Ret> that p2p_send()
+     * would return, or std::nullopt if the connection to dest_node is full
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto try_p2p_send(node_id_t dest_node, Args&&... args);
+
+    /**
+     * Gets the NotificationDispatcher that sends notifications from this node to
+     * the external clients of this subgroup, starting its fan-out thread on the
+     * first call. The dispatcher delivers messages by calling the client's
+     * notify() P2P function, so it is only available for subgroup types that
+     * derive from NotificationSupport.
+     * @param options The queueing and coalescing options for the dispatcher. These
+     * only take effect on the first call; if max_batch_bytes is 0, batches are
+     * limited to the maximum P2P payload size of a client connection.
+     * @return A reference to the NotificationDispatcher for this subgroup
+     */
+    template <typename CopyOfT = T>
+    std::enable_if_t<std::is_base_of_v<derecho::NotificationSupport, CopyOfT>, NotificationDispatcher&>
+    get_notification_dispatcher(const NotificationDispatcherOptions& options = NotificationDispatcherOptions{});
+
     bool is_valid() const { return true; }
 };
 
@@ -179,6 +179,13 @@ public:
     /** Returns the minimum of the latest persisted versions among all Persistent fields. */
     version_t getMinimumLatestPersistedVersion();
 
+    /**
+     * Returns true if every Persistent field can rebuild its current state
+     * from its local log, so a log tail is enough to bring them all up to
+     * date (see PersistentObject::canRebuildWrappedObjectFromLog).
+     */
+    bool canRebuildFromLog() const;
+
     /**
      * Set the earliest version for serialization, exclusive. This version will
      * be stored in a thread-local variable. When to_bytes() is next called on
@@ -194,6 +201,21 @@ public:
     /** Returns the earliest version for serialization. */
     static int64_t getEarliestVersionToSerialize() noexcept(true);
 
+    /**
+     * Set whether Persistent<T> should leave the current state of its wrapped
+     * object out of its serialized form when its log is not empty. Like the
+     * earliest version to serialize, this is stored in a thread-local variable.
+     * It is used for incremental state transfer to a node that already has a
+     * prefix of the log: that node rebuilds the current state from its own
+     * copy of the log after appending the serialized log tail to it.
+     * @param log_only True to serialize only the log, false to also serialize
+     * the current state
+     */
+    static void setSerializeLogOnly(bool log_only) noexcept(true);
+
+    /** Returns true if Persistent<T> should leave its current state out of its serialized form. */
+    static bool getSerializeLogOnly() noexcept(true);
+
     /**
      * Truncates the log, deleting all versions newer than the provided argument.
      * Since this throws away recently-used data, it should only be used during
@@ -316,6 +338,11 @@ protected:
      */
     static thread_local int64_t earliest_version_to_serialize;
 
+    /**
+     * Whether to leave the current state out of serialized Persistent<T>s.
+     */
+    static thread_local bool serialize_log_only;
+
     /**
      * Determines the next version in any signed field after the provided version,
      * skipping both nonexistant versions and versions that only exist in non-
@@ -476,7 +503,9 @@ public:
      * the object name, a unique_ptr to the wrapped object, and a unique_ptr to
      * the log.
      * @param object_name           The name is used for persistent data in file.
-     * @param wrapped_obj_ptr       A unique pointer to the wrapped object.
+     * @param wrapped_obj_ptr       A unique pointer to the wrapped object. If it is null, the
+     *                              object is rebuilt from the latest version in the local log,
+     *                              after log_tail has been applied to it.
      * @param enable_signatures     True if the received log has signatures in it, false if not
      * @param log_tail              A pointer to the beginning of the log within the serialized buffer
      * @param persistent_registry   A pointer to the persistent registry
@@ -948,6 +977,16 @@ public:
      */
     virtual version_t getLastPersistedVersion() const;
 
+    /**
+     * canRebuildWrappedObjectFromLog()
+     *
+     * Check whether the current state can be rebuilt from the local log: it is
+     * not empty and, for IDeltaSupport types, has not been trimmed.
+     *
+     * @return true if the log is enough to rebuild the current state.
+     */
+    virtual bool canRebuildWrappedObjectFromLog() const;
+
     /**
      * getIndexAtTime
      *
@@ -1126,6 +1165,10 @@ protected:
     std::shared_ptr<spdlog::logger> m_logger;
     // get the static name maker.
     static _NameMaker<ObjectType, storageType>& getNameMaker(const std::string& prefix = std::string(""));
+    // true unless PersistentRegistry::serialize_log_only is set and the log can rebuild the current state.
+    // For IDeltaSupport types that requires a log that has not been trimmed, since deltas are replayed
+    // from the first entry
+    bool includeWrappedObjectInSerialization() const;
 
     //serialization supports
 public:
@@ -1133,11 +1176,13 @@ public:
     // Serialization and Deserialization of Persistent<T>
     // Serialization of the persistent<T> is packed in the following order
     // 1) the log name
-    // 2) current state of the object
-    // 3) number of log entries
-    // 4) the log entries from the earliest to the latest
-    // TODO.
-    //Note: this rely on PersistentRegistry::earliest_version_to_serialize
+    // 2) a flag indicating whether the current state follows
+    // 3) current state of the object, unless left out (see PersistentRegistry::setSerializeLogOnly)
+    // 4) a flag indicating whether the log has signatures
+    // 5) number of log entries
+    // 6) the log entries from the earliest to the latest
+    //Note: this rely on PersistentRegistry::earliest_version_to_serialize and
+    //PersistentRegistry::serialize_log_only
     std::size_t to_bytes(uint8_t* ret) const;
     std::size_t bytes_size() const;
     void post_object(const std::function<void(uint8_t const* const, std::size_t)>& f) const;
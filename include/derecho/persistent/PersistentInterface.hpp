@@ -128,6 +128,12 @@ public:
      * @param latest_version The latest version to keep
      */
     virtual void truncate(version_t latest_version) = 0;
+    /**
+     * @return true if the current state can be rebuilt from the local log: it
+     * is not empty and, for objects that store deltas, has not been trimmed,
+     * since deltas are replayed from the first entry
+     */
+    virtual bool canRebuildWrappedObjectFromLog() const = 0;
     /**
      * Ensure destructors continue to work with inheritance
      */
@@ -173,7 +173,7 @@ Persistent<ObjectType, storageType>::Persistent(
         bool enable_signatures,
         const uint8_t* log_tail,
         PersistentRegistry* persistent_registry,
-        mutils::DeserializationManager)
+        mutils::DeserializationManager dm)
         : m_pRegistry(persistent_registry),
           m_logger(PersistLogger::get()) {
     // Initialize log
@@ -183,8 +183,17 @@ Persistent<ObjectType, storageType>::Persistent(
         this->m_pLog->applyLogTail(log_tail);
     }
     // Initialize Wrapped Object
-    assert(wrapped_obj_ptr != nullptr);
-    this->m_pWrappedObject = std::move(wrapped_obj_ptr);
+    if(wrapped_obj_ptr != nullptr) {
+        this->m_pWrappedObject = std::move(wrapped_obj_ptr);
+    } else {
+        // The sender left out the current state, since the patched log should be enough to rebuild it
+        if(!canRebuildWrappedObjectFromLog()) {
+            throw persistent_exception("Persistent<T> " + this->m_pLog->m_sName
+                                       + " received only a log tail, but its local log is empty or has been trimmed,"
+                                         " so the current state cannot be rebuilt from it");
+        }
+        this->m_pWrappedObject = this->getByIndex(this->getLatestIndex(), &dm);
+    }
     // Register with PersistentRegistry
     if(this->m_pRegistry) {
         this->m_pRegistry->registerPersistent(this->m_pLog->m_sName, this);
@@ -669,9 +678,13 @@ std::size_t Persistent<ObjectType, storageType>::to_bytes(uint8_t* ret) const {
     // object name
     dbg_trace(m_logger, "{0}[{1}] object_name starts at {2}", this->m_pLog->m_sName, __func__, sz);
     sz += mutils::to_bytes(this->m_pLog->m_sName, ret + sz);
-    // wrapped object
-    dbg_trace(m_logger, "{0}[{1}] wrapped_object starts at {2}", this->m_pLog->m_sName, __func__, sz);
-    sz += mutils::to_bytes(*this->m_pWrappedObject, ret + sz);
+    // wrapped object, unless the receiver can rebuild it from the log
+    const bool include_wrapped_object = includeWrappedObjectInSerialization();
+    sz += mutils::to_bytes(include_wrapped_object, ret + sz);
+    if(include_wrapped_object) {
+        dbg_trace(m_logger, "{0}[{1}] wrapped_object starts at {2}", this->m_pLog->m_sName, __func__, sz);
+        sz += mutils::to_bytes(*this->m_pWrappedObject, ret + sz);
+    }
     // flag to indicate whether the log has signatures
     dbg_trace(m_logger, "{0}[{1}] signatures_enabled starts at {2}", this->m_pLog->m_sName, __func__, sz);
     const bool signatures_enabled = this->m_pLog->signature_size > 0;
@@ -682,12 +695,39 @@ std::size_t Persistent<ObjectType, storageType>::to_bytes(uint8_t* ret) const {
     return sz;
 }
 
+template <typename ObjectType,
+          StorageType storageType>
+bool Persistent<ObjectType, storageType>::includeWrappedObjectInSerialization() const {
+    if(!PersistentRegistry::getSerializeLogOnly() || this->getNumOfVersions() == 0) {
+        return true;
+    }
+    if constexpr(std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value) {
+        // A delta object is rebuilt by replaying the log from its first entry, which only
+        // reproduces the current state if no entry has been trimmed from the log
+        return this->getEarliestIndex() != 0;
+    }
+    return false;
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+bool Persistent<ObjectType, storageType>::canRebuildWrappedObjectFromLog() const {
+    if(this->getNumOfVersions() == 0) {
+        return false;
+    }
+    if constexpr(std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value) {
+        return this->getEarliestIndex() == 0;
+    }
+    return true;
+}
+
 template <typename ObjectType,
           StorageType storageType>
 std::size_t Persistent<ObjectType, storageType>::bytes_size() const {
-    // object name, wrapped object, signature flag, and log
+    // object name, wrapped object flag, wrapped object, signature flag, and log
     return mutils::bytes_size(this->m_pLog->m_sName)
-           + mutils::bytes_size(*this->m_pWrappedObject)
+           + sizeof(bool)
+           + (includeWrappedObjectInSerialization() ? mutils::bytes_size(*this->m_pWrappedObject) : 0)
            + sizeof(bool)
            + this->m_pLog->bytes_size(PersistentRegistry::getEarliestVersionToSerialize());
 }
@@ -698,8 +738,12 @@ void Persistent<ObjectType, storageType>::post_object(const std::function<void(u
         const {
     // object name
     mutils::post_object(f, this->m_pLog->m_sName);
-    // wrapped object
-    mutils::post_object(f, *this->m_pWrappedObject);
+    // wrapped object, unless the receiver can rebuild it from the log
+    const bool include_wrapped_object = includeWrappedObjectInSerialization();
+    mutils::post_object(f, include_wrapped_object);
+    if(include_wrapped_object) {
+        mutils::post_object(f, *this->m_pWrappedObject);
+    }
     // flag to indicate whether the log has signatures
     mutils::post_object(f, (this->m_pLog->signature_size > 0));
     // and the log
@@ -714,9 +758,14 @@ std::unique_ptr<Persistent<ObjectType, storageType>> Persistent<ObjectType, stor
     auto obj_name = mutils::from_bytes<std::string>(dsm, v);
     ofst += mutils::bytes_size(*obj_name);
 
-    dbg_trace(PersistLogger::get(), "{0} wrapped_obj is loaded at {1}", __func__, ofst);
-    auto wrapped_obj = mutils::from_bytes<ObjectType>(dsm, v + ofst);
-    ofst += mutils::bytes_size(*wrapped_obj);
+    bool wrapped_object_included = *mutils::from_bytes_noalloc<bool>(dsm, v + ofst);
+    ofst += mutils::bytes_size(wrapped_object_included);
+    std::unique_ptr<ObjectType> wrapped_obj;
+    if(wrapped_object_included) {
+        dbg_trace(PersistLogger::get(), "{0} wrapped_obj is loaded at {1}", __func__, ofst);
+        wrapped_obj = mutils::from_bytes<ObjectType>(dsm, v + ofst);
+        ofst += mutils::bytes_size(*wrapped_obj);
+    }
 
     dbg_trace(PersistLogger::get(), "{0} signatures_enabled is loaded at {1}", __func__, ofst);
     bool signatures_enabled = *mutils::from_bytes_noalloc<bool>(dsm, v + ofst);
@@ -727,7 +776,9 @@ std::unique_ptr<Persistent<ObjectType, storageType>> Persistent<ObjectType, stor
         pr = &dsm->mgr<PersistentRegistry>();
     }
     dbg_trace(PersistLogger::get(), "{0}[{1}] create object from serialized bytes.", obj_name->c_str(), __func__);
-    return std::make_unique<Persistent>(obj_name->data(), wrapped_obj, signatures_enabled, v + ofst, pr);
+    // The deserialization contexts are needed if the wrapped object must be rebuilt from the log
+    return std::make_unique<Persistent>(obj_name->data(), wrapped_obj, signatures_enabled, v + ofst, pr,
+                                        mutils::DeserializationManager{dsm ? dsm->registered_v : mutils::RemoteDeserialization_v{}});
 }
 
 template <typename ObjectType,
@@ -0,0 +1,140 @@
+#pragma once
+#ifndef BLOCK_SIZE_HPP
+#define BLOCK_SIZE_HPP
+
+#include <derecho/config.h>
+#include "message.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class schedule;
+
+/** How an RDMC group picks the block size of each message it sends */
+enum class block_size_policy {
+    /** Always use the group's block size */
+    FIXED,
+    /**
+     * Use the block size that a cost model predicts will deliver the message
+     * fastest, given its length and the group's schedule
+     */
+    MODEL,
+    /**
+     * Start from the model's block size, then adjust it separately for each
+     * range of message lengths, based on the throughput of earlier messages
+     */
+    AUTO_TUNE
+};
+
+/**
+ * Parses the name of a block size policy, as used in the configuration file:
+ * "fixed", "model", or "auto_tune".
+ * @throw std::invalid_argument if the name is not recognized
+ */
+block_size_policy parse_block_size_policy(const std::string& name);
+
+/**
+ * Chooses the block size of each message an RDMC group sends. A message's
+ * block size is the group's block size shifted right by 0 to max_shift bits,
+ * so it always divides the group's block size: receive buffers sized for the
+ * group's block size fit every message, and no block is larger than the
+ * buffers set aside for a single block. The shift is sent with every block.
+ *
+ * The model estimates the time to send a message as the number of rounds the
+ * schedule needs for its blocks, times the time to send one block, which is
+ * a fixed per-block overhead plus the block's length. Small blocks shorten
+ * the rounds and fill the pipeline sooner, which pays off for large groups,
+ * while large blocks amortize the overhead, which pays off for large messages.
+ */
+class block_size_selector {
+public:
+    static constexpr uint32_t max_shift = 15;
+    /** Blocks are never made smaller than this, unless the group's block size is */
+    static constexpr size_t min_block_size = 4096;
+
+private:
+    const block_size_policy policy;
+    const size_t max_block_size;
+    /** The fixed cost of sending a block, as the number of bytes that could be sent in the same time */
+    const double block_overhead_bytes;
+    /** The schedule needs about rounds_per_block * num_blocks + pipeline_fill_rounds rounds */
+    const double rounds_per_block;
+    const double pipeline_fill_rounds;
+    /** The largest shift that keeps blocks a whole number of bytes and at least min_block_size */
+    uint32_t largest_shift;
+
+    /** Measurements for messages whose lengths have the same highest set bit */
+    struct length_class {
+        /** A moving average of the throughput seen with each shift, in bytes per ns; 0 if untried */
+        std::array<double, max_shift + 1> throughput{};
+        uint32_t best_shift;
+        uint32_t messages_until_probe;
+        bool probe_smaller_blocks = true;
+    };
+    std::map<uint32_t, length_class> length_classes;
+
+    /** The largest shift that doesn't split a message into more blocks than the immediate can count */
+    uint32_t largest_shift_for(size_t message_length) const;
+
+public:
+    /**
+     * @param policy How to choose block sizes
+     * @param max_block_size The group's block size
+     * @param block_overhead_bytes The fixed cost of sending a block, as the
+     * number of bytes that could be sent in the same time
+     * @param rounds_per_block The slope of the schedule's rounds, as a
+     * function of the number of blocks
+     * @param pipeline_fill_rounds The rounds the schedule needs beyond
+     * rounds_per_block per block
+     */
+    block_size_selector(block_size_policy policy, size_t max_block_size,
+                        double block_overhead_bytes, double rounds_per_block,
+                        double pipeline_fill_rounds);
+
+    /**
+     * Makes a selector for a group that uses the given schedule, fitting the
+     * rounds the schedule needs to a line in the number of blocks, from
+     * estimates at two message sizes that are both past the pipeline fill.
+     * @param policy How to choose block sizes
+     * @param max_block_size The group's block size
+     * @param block_overhead_bytes The fixed cost of sending a block
+     * @param member_schedules The schedule of each member of the group, in
+     * member order
+     * @param member_racks The rack of each member of the group
+     * @param uplink_capacity The rack uplink capacity, as passed to
+     * estimate_schedule_time
+     */
+    static block_size_selector for_schedule(block_size_policy policy, size_t max_block_size,
+                                            double block_overhead_bytes,
+                                            const std::vector<std::unique_ptr<schedule>>& member_schedules,
+                                            const std::vector<uint32_t>& member_racks,
+                                            double uplink_capacity);
+
+    size_t get_block_size(uint32_t shift) const { return max_block_size >> shift; }
+    /** True if messages may use a block size other than the group's, so blocks must carry their shift */
+    bool varies_block_size() const { return policy != block_size_policy::FIXED; }
+    /** The most blocks a message can have in this group */
+    size_t max_blocks() const { return max_blocks_per_message(varies_block_size()); }
+    /**
+     * Returns the shift a receiver should expect for a message of the given
+     * length: 0 for the FIXED policy, and otherwise the model's choice.
+     */
+    uint32_t expected_shift(size_t message_length) const;
+    /** Returns the shift the cost model predicts is fastest for a message. */
+    uint32_t model_shift(size_t message_length) const;
+    /**
+     * Chooses the shift for a message about to be sent. With the AUTO_TUNE
+     * policy, every few messages of each length class try a block size next
+     * to the best one measured so far.
+     */
+    uint32_t choose_shift(size_t message_length);
+    /** Records how long a message took to send, for the AUTO_TUNE policy. */
+    void record_transfer(size_t message_length, uint32_t shift, std::chrono::nanoseconds duration);
+};
+
+#endif /* BLOCK_SIZE_HPP */
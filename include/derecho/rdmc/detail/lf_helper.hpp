@@ -16,6 +16,7 @@
 #include <vector>
 
 #include <derecho/core/derecho_type_definitions.hpp>
+#include <derecho/core/detail/registered_memory.hpp>
 #include <derecho/utils/logger.hpp>
 
 #ifndef LF_VERSION
@@ -61,10 +62,21 @@ class unsupported_feature : public exception {};
  * the provided buffer on construction, and deregisters it on destruction.
  */
 class memory_region {
-    /** Smart pointer for managing the registered memory region */
-    std::unique_ptr<fid_mr, std::function<void(fid_mr*)>> mr;
+    /**
+     * Smart pointers for managing the registrations of the memory region, one
+     * in each rail's domain, indexed by rail. Rails that failed to open have
+     * no registration.
+     */
+    using rail_registrations = std::vector<std::unique_ptr<fid_mr, std::function<void(fid_mr*)>>>;
+    /**
+     * The registrations of the buffer, which may cover more than the buffer
+     * and be shared with the registration cache if they came from it
+     */
+    std::shared_ptr<rail_registrations> mrs;
     /** Smart pointer for managing the buffer the mr uses */
-    std::unique_ptr<uint8_t[]> allocated_buffer;
+    derecho::registered_array<uint8_t> allocated_buffer;
+
+    memory_region(derecho::registered_array<uint8_t> buffer, size_t size);
 
     friend class endpoint;
     friend class task;
@@ -86,14 +98,26 @@ public:
      * @param buffer The allocated memory that will be registered.
      * @param size The size in bytes of the buffer to be associated with
      *      the memory region.
+     * @param use_registration_cache Whether to take the registration from
+     *      the registration cache, if it is enabled, so that buffers inside
+     *      memory registered earlier don't need registering again. Only
+     *      pass true if the buffer's memory will be released with munmap
+     *      (or never); see derecho::registration_cache.
      */
-    memory_region(uint8_t* buffer, size_t size);
+    memory_region(uint8_t* buffer, size_t size, bool use_registration_cache = false);
     /**
      * get_key
      * Returns the key associated with the registered memory region, which
      * is used to access the region.
+     *
+     * @param rail The rail whose registration to get the key of.
      */
-    uint64_t get_key() const;
+    uint64_t get_key(uint32_t rail = 0) const;
+    /**
+     * Registers a range of memory in each rail's domain, bypassing the
+     * registration cache. Used by the cache itself on a miss.
+     */
+    static std::shared_ptr<rail_registrations> register_memory(void* start, size_t size);
 
     uint8_t* const buffer;
     const size_t size;
@@ -112,11 +136,24 @@ public:
      */
     remote_memory_region(uint64_t remote_address, size_t length,
                          uint64_t remote_key)
-            : buffer(remote_address), size(length), rkey(remote_key) {}
+            : buffer(remote_address), size(length), rkeys{remote_key} {}
+    /**
+     * Constructor
+     * Takes in parameters representing a remote memory region that is
+     * registered on several rails.
+     *
+     * @param remote_address The address of the remote buffer.
+     * @param length The size of the remote buffer in bytes.
+     * @param remote_keys The key used to refer to the buffer for remote
+     *     accesses through each rail, indexed by rail.
+     */
+    remote_memory_region(uint64_t remote_address, size_t length,
+                         std::vector<uint64_t> remote_keys)
+            : buffer(remote_address), size(length), rkeys(std::move(remote_keys)) {}
 
     const uint64_t buffer;
     const size_t size;
-    const uint64_t rkey;
+    const std::vector<uint64_t> rkeys;
 };
 
 /**
@@ -166,12 +203,46 @@ public:
  */
 class endpoint {
 protected:
-    /** Smart pointer for managing the endpoint */
-    std::unique_ptr<fid_eq, std::function<void(fid_eq*)>> eq;
-    std::unique_ptr<fid_ep, std::function<void(fid_ep*)>> ep;
+    /** The connection to the remote node through one rail */
+    struct rail_endpoint {
+        /** The index of the rail this connection uses */
+        uint32_t rail;
+        /** Smart pointer for managing the endpoint */
+        std::unique_ptr<fid_eq, std::function<void(fid_eq*)>> eq;
+        std::unique_ptr<fid_ep, std::function<void(fid_ep*)>> ep;
+    };
+    /**
+     * The connections to the remote node, one per rail that both nodes can
+     * use, in increasing order of rail. The first one carries all messages
+     * that are not striped.
+     */
+    std::vector<rail_endpoint> rail_endpoints;
+    /**
+     * The sequence of connections, as indices into rail_endpoints, that
+     * data sends and receives cycle through. Both nodes build the same
+     * sequence, so the n-th data receive posted by one node is on the same
+     * rail as the n-th data send posted by the other.
+     */
+    std::vector<uint32_t> stripe_pattern;
+    /** The number of data sends posted so far */
+    uint64_t num_data_sends = 0;
+    /** The number of data receives posted so far */
+    uint64_t num_data_recvs = 0;
 
     explicit endpoint() {}
 
+    /**
+     * Connects to the remote node through one rail.
+     *
+     * @param rail_ep The rail connection to set up, whose rail is set.
+     * @param is_lf_server Whether to wait for the remote node to connect.
+     * @param remote_pep_addr The address of the remote node's passive
+     *     endpoint on the rail.
+     * @param remote_pep_addr_len The length of remote_pep_addr.
+     */
+    void connect_rail(rail_endpoint& rail_ep, bool is_lf_server,
+                      const char* remote_pep_addr, size_t remote_pep_addr_len);
+
     friend class task;
 
 public:
@@ -205,15 +276,19 @@ public:
     endpoint(endpoint&&) = default;
     /**
      * init
-     * Creates an endpoint, and then initializes/enables it
+     * Creates an endpoint on a rail, and then initializes/enables it
      *
+     * @param rail_ep The rail connection to create the endpoint for.
      * @param fi A struct containing information about the current
      *     fabric services.
      */
-    int init(struct fi_info* fi);
+    int init(rail_endpoint& rail_ep, struct fi_info* fi);
     /**
      * connect
-     * Uses the initialized endpoint to connect to a remote node
+     * Connects to a remote node through every rail that both nodes can use.
+     * The nodes exchange which of their rails are usable and how they are
+     * weighted, and stripe data sends across the rails they have in common
+     * in proportion to the lower of their two weights.
      *
      * @param remote_index The index of the remote node in the group.
      * @param is_lf_server This parameter decide local role in connection.
@@ -228,7 +303,8 @@ public:
 
     /**
      * post_send
-     * Uses the libfabrics API to post a buffer to an endpoint.
+     * Uses the libfabrics API to post a buffer to an endpoint, on the next
+     * rail in the stripe pattern.
      *
      * @param mr The wrapper around the memory region that is being sent.
      * @param offset The offset into the buffer managed by mr.
@@ -242,7 +318,8 @@ public:
                    const message_type& type);
     /**
      * post_recv
-     * Uses the libfabrics API to post a buffer to the recv queue of an endpoint.
+     * Uses the libfabrics API to post a buffer to the recv queue of an endpoint,
+     * on the next rail in the stripe pattern.
      *
      * @param mr The wrapper around the memory region that is being posted.
      * @param offset The offset into the buffer managed by mr.
@@ -254,6 +331,7 @@ public:
                    size_t size, uint64_t wr_id,
                    const message_type& type);
 
+    /** Empty sends and receives, and writes, always use the first rail. */
     bool post_empty_send(uint64_t wr_id, uint32_t immediate,
                          const message_type& type);
     bool post_empty_recv(uint64_t wr_id, const message_type& type);
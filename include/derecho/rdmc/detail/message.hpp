@@ -3,6 +3,7 @@
 #define MESSAGE_HPP
 
 #include <derecho/config.h>
+#include <cstddef>
 #include <cstdint>
 #include <utility>
 
@@ -25,17 +26,41 @@ inline uint64_t form_tag(uint16_t group_number, uint32_t target) {
     return (((uint64_t)group_number) << 32) | (uint64_t)target;
 }
 
+// The immediate holds a message's number of blocks and the number of the
+// block, 16 bits each. Groups that choose a block size per message also put
+// the message's block size in the top 4 bits, as a right shift of the group's
+// block size, which leaves 14 bits for each of the block counts.
+constexpr uint32_t immediate_block_number_bits = 16;
+constexpr uint32_t shifted_immediate_block_number_bits = 14;
+
+/** The most blocks a message can have, given the layout of the immediate */
+constexpr size_t max_blocks_per_message(bool with_block_size_shift) {
+    return (size_t{1} << (with_block_size_shift ? shifted_immediate_block_number_bits
+                                                : immediate_block_number_bits))
+           - 1;
+}
+
 struct ParsedImmediate {
+    uint8_t block_size_shift;
     uint16_t total_blocks;
     uint16_t block_number;
 };
 
-inline ParsedImmediate parse_immediate(uint32_t imm) {
-    return ParsedImmediate{(uint16_t)((imm & 0xffff0000) >> 16),
-                           (uint16_t)(imm & 0x0000ffff)};
+inline ParsedImmediate parse_immediate(uint32_t imm, bool with_block_size_shift) {
+    const uint32_t bits = with_block_size_shift ? shifted_immediate_block_number_bits
+                                                : immediate_block_number_bits;
+    const uint32_t block_mask = (1u << bits) - 1;
+    return ParsedImmediate{(uint8_t)(with_block_size_shift ? imm >> (2 * bits) : 0),
+                           (uint16_t)((imm >> bits) & block_mask),
+                           (uint16_t)(imm & block_mask)};
 }
-inline uint32_t form_immediate(uint16_t total_blocks, uint16_t block_number) {
-    return ((uint32_t)total_blocks) << 16 | ((uint32_t)block_number);
+inline uint32_t form_immediate(bool with_block_size_shift, uint8_t block_size_shift,
+                               uint16_t total_blocks, uint16_t block_number) {
+    const uint32_t bits = with_block_size_shift ? shifted_immediate_block_number_bits
+                                                : immediate_block_number_bits;
+    return (with_block_size_shift ? ((uint32_t)block_size_shift) << (2 * bits) : 0)
+           | ((uint32_t)total_blocks) << bits
+           | ((uint32_t)block_number);
 }
 
 /**
@@ -5,6 +5,7 @@
 #include <derecho/config.h>
 #include <cmath>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -32,6 +33,13 @@ public:
     virtual optional<block_transfer> get_incoming_transfer(size_t num_blocks, size_t receive_step) const = 0;
     virtual optional<block_transfer> get_first_block(size_t num_blocks) const = 0;
     virtual size_t get_total_steps(size_t num_blocks) const = 0;
+    /**
+     * Returns the round in which this member would take a step if every
+     * member sent one block per round as soon as it could. Members of most
+     * schedules take exactly one step per round; this is only used to
+     * estimate how long a schedule takes.
+     */
+    virtual size_t get_step_round(size_t num_blocks, size_t step) const { return step; }
 };
 
 class chain_schedule : public schedule {
@@ -107,4 +115,66 @@ public:
     size_t get_total_steps(size_t num_blocks) const;
 };
 
+/**
+ * A schedule for groups whose members are spread across several racks (or
+ * switches), which sends each block over the inter-rack network only once per
+ * rack. The first member of each rack in rank order is its leader, and the
+ * sender leads its own rack. Blocks are sent to the rack leaders with a
+ * binomial pipeline, and each leader forwards them down a chain through the
+ * rest of its rack in the order it receives them.
+ */
+class hierarchical_schedule : public schedule {
+private:
+    /** Member indices of the rack leaders; the sender's rack comes first */
+    vector<uint32_t> leaders;
+    /** Member indices of this member's rack in chain order, starting with its leader */
+    vector<uint32_t> rack_chain;
+    /** This member's position in rack_chain */
+    uint32_t chain_position;
+    /** The binomial schedule among the leaders, from the point of view of this member's rack leader */
+    std::unique_ptr<binomial_schedule> leader_schedule;
+
+    // The order in which this member's rack leader obtains the blocks of a
+    // message, and which block it receives at each step of leader_schedule.
+    // Cached for the most recent message size, since computing them requires
+    // stepping through the whole binomial schedule.
+    mutable optional<size_t> cached_num_blocks;
+    mutable vector<size_t> leader_block_order;
+    mutable vector<optional<size_t>> leader_block_arrivals;
+    // The step of leader_schedule in which the leader receives each block of leader_block_order
+    mutable vector<size_t> leader_block_arrival_steps;
+
+    /** True if this member sends to other racks, which interleaves its binomial and chain steps */
+    bool is_multi_rack_leader() const { return chain_position == 0 && leaders.size() > 1; }
+    void compute_leader_block_order(size_t num_blocks) const;
+
+public:
+    /**
+     * @param member_racks The rack of each member, indexed by member index
+     * @param index This member's index
+     */
+    hierarchical_schedule(const vector<uint32_t>& member_racks, uint32_t index);
+
+    vector<uint32_t> get_connections() const;
+    optional<block_transfer> get_outgoing_transfer(size_t num_blocks, size_t send_step) const;
+    optional<block_transfer> get_incoming_transfer(size_t num_blocks, size_t receive_step) const;
+    optional<block_transfer> get_first_block(size_t num_blocks) const;
+    size_t get_total_steps(size_t num_blocks) const;
+    size_t get_step_round(size_t num_blocks, size_t step) const;
+};
+
+/**
+ * Estimates how long a schedule takes to deliver a message, in units of the
+ * time it takes to send one block over an uncontended link. Each round of the
+ * schedule takes as long as its most heavily loaded member NIC or rack uplink.
+ * @param member_schedules The schedule of every member, indexed by member index
+ * @param member_racks The rack of every member, indexed by member index
+ * @param num_blocks The number of blocks in the message
+ * @param uplink_capacity The number of blocks that can leave (or enter) a rack
+ * at the same time without slowing each other down
+ */
+double estimate_schedule_time(const vector<std::unique_ptr<schedule>>& member_schedules,
+                              const vector<uint32_t>& member_racks,
+                              size_t num_blocks, double uplink_capacity);
+
 #endif /* SCHEDULE_HPP */
@@ -4,6 +4,7 @@
 
 #include <derecho/config.h>
 #include <derecho/rdmc/rdmc.hpp>
+#include "detail/block_size.hpp"
 #include "detail/schedule.hpp"
 
 #ifdef USE_VERBS_API
@@ -12,6 +13,7 @@
     #include "detail/lf_helper.hpp"
 #endif
 
+#include <chrono>
 #include <cstdint>
 #include <optional>
 #include <map>
@@ -31,6 +33,7 @@ class group {
 protected:
     const vector<uint32_t> members;  // first element is the sender
     const uint16_t group_number;
+    // The largest block size; each message may use a smaller one
     const size_t block_size;
     const uint32_t num_members;
     const uint32_t member_index;  // our index in the members list
@@ -56,7 +59,7 @@ protected:
 public:
     virtual ~group();
 
-    virtual void receive_block(uint32_t send_imm, size_t size) = 0;
+    virtual void receive_block(uint32_t send_imm, size_t size, uint32_t sender) = 0;
     virtual void receive_ready_for_block(uint32_t step, uint32_t sender) = 0;
     virtual void complete_block_send() = 0;
     virtual void send_message(std::shared_ptr<rdma::memory_region> message_mr,
@@ -64,27 +67,68 @@ public:
             = 0;
 };
 
+/**
+ * A group that sends messages by following its schedule one step at a time.
+ * Blocks are pipelined: each member keeps receives posted for up to
+ * pipeline_depth upcoming blocks from each neighbor, and grants the neighbor
+ * one "credit" per posted receive with a single ready-for-block message.
+ * A sender can start sending a block as soon as it has a credit from the
+ * block's target, so up to pipeline_depth blocks can be in flight on each
+ * link instead of one.
+ */
 class polling_group : public group {
 private:
-    // Set of receivers who are ready to receive the next block from us.
-    std::set<uint32_t> receivers_ready;
-
+    /** The number of blocks that can be in flight to or from each neighbor at once */
+    const uint32_t pipeline_depth;
+
+    block_size_selector block_sizes;
+    // The block size of the current message, and the shift that identifies it
+    size_t message_block_size;
+    uint32_t message_block_shift = 0;
+    // When the current message started sending, if this node is the sender
+    std::chrono::steady_clock::time_point send_start_time;
+
+    // Number of blocks each receiver is ready to receive from us, i.e. the
+    // number of receives they have posted that we haven't sent to yet.
+    map<uint32_t, uint32_t> receiver_credits;
+
+    // Used to receive the first block when the destination of the message
+    // isn't known until the block arrives
     unique_ptr<rdma::memory_region> first_block_mr;
     optional<size_t> first_block_number;
-    unique_ptr<uint8_t[]> first_block_buffer;
+    derecho::registered_array<uint8_t> first_block_buffer;
+    // The length of the first block, which may be the message's short last block
+    size_t first_block_length;
+
+    // The size of the messages expected in this group, or 0 if unknown. If
+    // it is known, the destination of each message is requested as soon as
+    // the previous message completes, and the first block is received
+    // straight into it.
+    const size_t expected_message_size;
+    // The destination of the next message, if it has been requested before
+    // the message's first block arrived
+    optional<rdmc::receive_destination> next_destination;
+    // Where the first block is received in next_destination, relative to its
+    // offset, or nullopt if it is received into first_block_mr
+    optional<size_t> first_block_landing_offset;
+    // True if the current message's first block was received into mr rather
+    // than first_block_mr
+    bool first_block_in_destination = false;
 
-    size_t incoming_block;
     size_t message_number = 0;
 
     size_t outgoing_block;
-    bool sending = false;  // Whether a block send is in progress
+    uint32_t sends_in_flight = 0;  // Number of block sends posted but not completed
     size_t send_step = 0;  // Number of blocks sent/stalls so far
 
     // Total number of blocks received and the number of chunks
     // received for ecah block, respectively.
     size_t num_received_blocks = 0;
+    // The next step of the schedule to post a receive for
     size_t receive_step = 0;
     vector<bool> received_blocks;
+    // Number of receives posted for each neighbor that haven't been filled yet
+    map<uint32_t, uint32_t> receives_in_flight;
 
     // maps from member_indices to the queue pairs
 #ifdef USE_VERBS_API
@@ -106,10 +150,13 @@ public:
                   vector<uint32_t> members, uint32_t member_index,
                   incoming_message_callback_t upcall,
                   completion_callback_t callback,
-                  unique_ptr<schedule> transfer_schedule);
+                  unique_ptr<schedule> transfer_schedule,
+                  block_size_selector block_sizes,
+                  uint32_t pipeline_depth = 1,
+                  size_t expected_message_size = 0);
 
-    virtual void receive_block(uint32_t send_imm, size_t size);
-    virtual void receive_ready_for_block(uint32_t step, uint32_t sender);
+    virtual void receive_block(uint32_t send_imm, size_t size, uint32_t sender);
+    virtual void receive_ready_for_block(uint32_t num_credits, uint32_t sender);
     virtual void complete_block_send();
 
     virtual void send_message(std::shared_ptr<rdma::memory_region> message_mr,
@@ -117,10 +164,22 @@ public:
 
 private:
     void post_recv(schedule::block_transfer transfer);
+    /**
+     * Posts receives for upcoming steps, in schedule order, until a neighbor
+     * has pipeline_depth receives in flight, and grants each neighbor credits
+     * for the new receives with one ready-for-block message.
+     */
+    void post_receives();
+    /** Sends every block, in schedule order, that is available and has a credit. */
     void send_next_block();
     void complete_message();
+    /**
+     * Posts the receive for the first block of the next message. If the
+     * expected message size is known, this first asks incoming_message_upcall
+     * for the next message's destination, so the block can land in place.
+     */
     void prepare_for_next_message();
-    void send_ready_for_block(uint32_t neighbor);
+    void send_ready_for_block(uint32_t neighbor, uint32_t num_credits);
     void connect(uint32_t neighbor);
 };
 
@@ -34,7 +34,15 @@ enum send_algorithm {
     BINOMIAL_SEND = 1,
     CHAIN_SEND = 2,
     SEQUENTIAL_SEND = 3,
-    TREE_SEND = 4
+    TREE_SEND = 4,
+    /** Binomial between racks, then a chain within each rack; see hierarchical_schedule */
+    HIERARCHICAL_SEND = 5,
+    /**
+     * Chooses between the binomial, chain and hierarchical schedules when the
+     * group is created, based on its size, its members' racks and the size of
+     * its messages
+     */
+    ADAPTIVE_SEND = 6
 };
 
 struct receive_destination {
@@ -63,18 +71,25 @@ void shutdown();
  * @param algorithm Which RDMC send algorithm to use in this group.
  * @param incoming_receive The function to call when there is a new incoming
  * message in this group; it must provide a destination to receive the message
- * into.
+ * into. If message_size is nonzero, it is called with message_size as soon as
+ * the previous message completes, before the next message arrives; it is
+ * only called again for that message if the message doesn't fit.
  * @param send_callback The function to call when RDMC completes receiving a
  * message in this group
  * @param failure_callback The function to call when RDMC detects a failure in
  * this group. It will be called with the suspected failed node's ID.
+ * @param message_size The typical size of the messages that will be sent in
+ * this group, which ADAPTIVE_SEND uses to choose a schedule and receivers use
+ * to obtain destinations in advance. If it is 0, the messages are assumed to
+ * fit in one block, and destinations are only requested when messages arrive.
  * @return True if group creation succeeds, false if it fails.
  */
 bool create_group(uint16_t group_number, std::vector<uint32_t> members,
                   size_t block_size, send_algorithm algorithm,
                   incoming_message_callback_t incoming_receive,
                   completion_callback_t send_callback,
-                  failure_callback_t failure_callback)
+                  failure_callback_t failure_callback,
+                  size_t message_size = 0)
         __attribute__((warn_unused_result));
 void destroy_group(uint16_t group_number);
 
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <derecho/config.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <netinet/in.h>
+#include <string>
+#include <thread>
+
+namespace sst {
+
+/**
+ * Settings for sending a multicast group's messages as unreliable IP multicast
+ * datagrams instead of one RDMA write per member.
+ */
+struct datagram_settings {
+    /** The IPv4 multicast address the group's datagrams are sent to */
+    std::string group_address;
+    uint16_t port;
+    /** The IPv4 address of the local interface to send and receive on */
+    std::string interface_address;
+    /** The largest datagram to send; batches of messages that don't fit are written over RDMA */
+    uint32_t max_datagram_size;
+    /** How long a member can go without acknowledging a message before it is resent over RDMA */
+    std::chrono::milliseconds repair_timeout;
+    /** Identifies the group and view; datagrams with any other session ID are ignored */
+    uint64_t session_id;
+    /**
+     * Identifies the deployment, so that separate deployments sharing a network
+     * segment ignore each other's datagrams even if their session IDs collide.
+     * Must be nonzero.
+     */
+    uint64_t deployment_id;
+};
+
+/**
+ * A UDP socket that has joined an IP multicast group, with a thread that hands
+ * every datagram it receives to a callback. Datagrams may be lost, duplicated
+ * or reordered; the caller is responsible for detecting and repairing gaps.
+ */
+class datagram_multicast {
+    const uint32_t max_datagram_size;
+    const std::function<void(const uint8_t*, std::size_t)> receive_callback;
+    int socket_fd;
+    sockaddr_in group_sockaddr;
+    std::atomic<bool> thread_shutdown;
+    std::thread receive_thread;
+
+    void receive_loop();
+
+public:
+    /**
+     * Joins the multicast group and starts the receive thread.
+     * @param settings The group to join; only the address, port, interface
+     * and maximum datagram size are used
+     * @param receive_callback The function to call, on the receive thread,
+     * with the contents of each datagram received. This includes datagrams
+     * sent by this node.
+     * @throw std::invalid_argument if the addresses can't be parsed
+     * @throw std::system_error if the socket can't be set up
+     */
+    datagram_multicast(const datagram_settings& settings,
+                       std::function<void(const uint8_t*, std::size_t)> receive_callback);
+    /** Stops the receive thread and leaves the group. */
+    ~datagram_multicast();
+
+    /**
+     * Sends a datagram to the group.
+     * @return False if the datagram could not be sent
+     */
+    bool send(const uint8_t* data, std::size_t size);
+};
+
+}  // namespace sst
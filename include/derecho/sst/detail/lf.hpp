@@ -9,10 +9,12 @@
 #include <derecho/config.h>
 #include <derecho/core/derecho_type_definitions.hpp>
 #include <derecho/core/detail/connection_manager.hpp>
+#include <derecho/core/detail/registered_memory.hpp>
 #include <derecho/utils/logger.hpp>
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <rdma/fabric.h>
 #include <rdma/fi_errno.h>
 #include <thread>
@@ -21,6 +23,7 @@
 #include <map>
 #include <tuple>
 #include <queue>
+#include <vector>
 
 #ifndef LF_VERSION
 #define LF_VERSION FI_VERSION(1, 5)
@@ -62,6 +65,44 @@ public:
     inline bool is_managed() { return _managed; }
 };
 
+/**
+ * A connected endpoint and its event queue, which can be shared by the
+ * resources objects of several SSTs. When a node stays in the group across a
+ * view change, the next SST reuses the endpoint the previous one used to reach
+ * it, instead of closing it and connecting a new one.
+ */
+struct lf_endpoint {
+    struct fid_ep* ep;
+    struct fid_eq* eq;
+    /** Identifies the connection; both ends of it have the same ID */
+    uint64_t connection_id;
+    /** The rail the endpoint was opened on */
+    uint32_t rail;
+    lf_endpoint(struct fid_ep* ep, struct fid_eq* eq, uint64_t connection_id, uint32_t rail)
+            : ep(ep), eq(eq), connection_id(connection_id), rail(rail) {}
+    /** Closes the endpoint and the event queue */
+    ~lf_endpoint();
+};
+
+/**
+ * A block of memory that holds all the rows of an SST, registered for RDMA
+ * once as a single memory region on each rail. It is shared by the resources
+ * objects of the SST's rows, and deregistered and freed with the SST, so
+ * writes still in flight from an earlier view are rejected under the keys
+ * of the freed block rather than landing in a later SST's rows.
+ */
+struct row_memory {
+    derecho::registered_array<uint8_t> allocation;
+    uint8_t* buffer;
+    std::size_t capacity;
+    /** The block's registration in each rail's domain, or nullptr for rails that failed to open */
+    std::vector<struct fid_mr*> mrs;
+    /** Allocates and registers a block of the requested size */
+    explicit row_memory(std::size_t capacity);
+    /** Deregisters and frees the block */
+    ~row_memory();
+};
+
 /**
  * Represents the set of RDMA resources needed to maintain a two-way connection
  * to a single remote node.
@@ -127,6 +168,22 @@ public:
     fi_addr_t remote_fi_addr;
     /** the event queue */
     struct fid_eq* eq;
+    /** The start of the memory region that write_buf belongs to */
+    uint8_t* mr_base;
+    /** False if write_mr and read_mr belong to an SST's row_memory rather than this object */
+    bool owns_memory_regions;
+    /** True if this connects an SST row, whose endpoint can be shared with other SSTs */
+    bool shares_sst_endpoint;
+    /** Set if ep and eq are owned by a shared lf_endpoint rather than this object */
+    std::shared_ptr<lf_endpoint> shared_endpoint;
+    /** The SST rows this connection writes, or nullptr if it registered its own buffers */
+    const row_memory* rows;
+    /**
+     * The rail (NIC) the connection uses. Connections behind SST rows are
+     * spread across the rails both nodes can use; other connections use the
+     * first rail, where out-of-band memory is registered.
+     */
+    uint32_t rail;
 
     /**
      * Out-of-Band memory and send management
@@ -136,6 +193,12 @@ private:
         void*           addr;
         size_t          size;
         struct  fid_mr* mr;
+        /**
+         * Owns mr, which may cover more than [addr, addr + size) if it came
+         * from the registration cache. Dropping it deregisters the memory,
+         * unless the cache or another region still holds it.
+         */
+        std::shared_ptr<void> registration;
     };
     static std::shared_mutex  oob_mrs_mutex;
     static std::map<uint64_t,struct oob_mr_t> oob_mrs;
@@ -179,10 +242,16 @@ public:
      * @param addr  the address of the OOB memory
      * @param size  the size of the OOB memory
      * @param attr  the memory attribute
+     * @param use_registration_cache    whether the registration may come from,
+     *              and stay in, the registration cache if it is enabled. Only
+     *              memory from derecho::allocate_registered_memory (which
+     *              applications get through allocate_oob_memory) is cached;
+     *              other memory is always registered on its own.
      *
      * @throws derecho_exception on failure.
      */
-    static void register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr);
+    static void register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr,
+                                       bool use_registration_cache = true);
 
     /**
      * Deregister oob memory
@@ -305,6 +374,18 @@ public:
      */
     _resources(int r_id, uint8_t* write_addr, uint8_t* read_addr, int size_w,
                int size_r, int is_lf_server);
+    /**
+     * Constructor for the connection behind one row of an SST. Instead of
+     * registering its own buffers, it uses the memory region of the SST's
+     * rows, and if the remote node is still connected through the endpoint of
+     * an earlier SST, it reuses that endpoint instead of connecting a new one.
+     *
+     * @param rows The registered memory holding all the rows of the SST;
+     * write_addr and read_addr must point into it
+     * Other parameters are the same as in the other constructor.
+     */
+    _resources(int r_id, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+               int size_r, int is_lf_server, const row_memory& rows);
     /** Destroys the resources. */
     virtual ~_resources();
 };
@@ -319,6 +400,11 @@ public:
     resources(int r_id, uint8_t* write_addr, uint8_t* read_addr, int size_w,
               int size_r, int is_lf_server) : _resources(r_id, write_addr, read_addr, size_w, size_r, is_lf_server) {
     }
+    /** Constructor for SST rows: simply forwards to _resources::_resources */
+    resources(int r_id, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+              int size_r, int is_lf_server, const row_memory& rows)
+            : _resources(r_id, write_addr, read_addr, size_w, size_r, is_lf_server, rows) {
+    }
     /**
      * Report that the remote node this object is connected to has failed.
      * This will cause all future remote operations to be no-ops.
@@ -379,7 +465,8 @@ bool add_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr
  */
 bool add_external_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port);
 /**
- * Removes a node from the SST TCP connections set
+ * Removes a node from the SST TCP connections set, and forgets the SST
+ * endpoint connected to it so that no later SST reuses it
  */
 bool remove_node(uint32_t node_id);
 /**
@@ -1,32 +1,97 @@
 #pragma once
 
 #include <derecho/config.h>
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #include <optional>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
 namespace sst {
 namespace util {
+/**
+ * Hands completions read from the completion queue by the polling thread to
+ * the threads that posted the corresponding operations. Each thread that
+ * waits for completions has its own single-producer, single-consumer ring:
+ * the polling thread is the only writer and the owning thread is the only
+ * reader, so neither of them takes a lock to deliver or retrieve a completion.
+ * Completions that arrive while a ring is full are kept in an overflow list,
+ * which is the only part that needs a lock. When a thread exits, its ring is
+ * emptied and given to the next thread that registers.
+ */
 class PollingData {
-    // map:node_id->[list of return values]
-    std::vector<std::map<int32_t, std::list<int32_t>>> completion_entries;
+public:
+    /** The maximum number of live threads that can wait for completions */
+    static constexpr uint32_t max_threads = 256;
+    /** The number of completions a thread's ring holds before they spill into its overflow list */
+    static constexpr uint32_t ring_capacity = 1024;
+
+private:
+    struct CompletionRing {
+        // (node_id, result) pairs
+        std::array<std::pair<int32_t, int32_t>, ring_capacity> entries;
+        /** The next slot the polling thread will fill; only written by the polling thread */
+        alignas(64) std::atomic<uint64_t> head{0};
+        /** The next slot the owning thread will read; only written by the owning thread */
+        alignas(64) std::atomic<uint64_t> tail{0};
+        /** Set while overflow is non-empty, so the polling thread keeps completions in order */
+        std::atomic<bool> has_overflow{false};
+        std::atomic<bool> waiting{false};
+        std::mutex overflow_mutex;
+        std::list<std::pair<int32_t, int32_t>> overflow;
+        // map:node_id->[list of return values], for completions already taken
+        // out of the ring. Only accessed by the owning thread.
+        std::map<int32_t, std::list<int32_t>> pending;
+    };
+    std::array<std::unique_ptr<CompletionRing>, max_threads> rings;
+    /** The number of rings in use; rings below this index are never moved or freed */
+    std::atomic<uint32_t> num_rings{0};
     std::map<std::thread::id, uint32_t> tid_to_index;
-    std::vector<bool> if_waiting;
+    /** Indices of rings whose threads have exited, ready to be reused */
+    std::vector<uint32_t> free_indices;
+    /** Guards tid_to_index and free_indices, and the creation of new rings */
+    std::mutex registration_mutex;
     std::condition_variable poll_cv;
     std::mutex poll_mutex;
     bool check_waiting();
+    /** Moves every completion delivered to a ring into its pending map. Only called by the ring's owner. */
+    void drain_ring(CompletionRing& ring);
+
 public:
+    /**
+     * Delivers a completion to a thread's ring. Must only be called by the
+     * polling thread. Completions for an index that no thread registered are
+     * dropped.
+     * @param index The completion entry index of the thread that posted the operation
+     * @param ce A pair of (node_id, result)
+     */
     void insert_completion_entry(uint32_t index, std::pair<int32_t, int32_t> ce);
 
-    // std::optional<std::pair<int32_t, int32_t>> get_completion_entry(const std::thread::id id);
+    /**
+     * Retrieves the oldest completion from a node that was delivered to the
+     * calling thread, if there is one. Must be called by the thread identified
+     * by tid.
+     */
     std::optional<int32_t> get_completion_entry(const std::thread::id tid, const int nid);
 
+    /**
+     * @return The completion entry index of a thread, registering the thread
+     * if this is the first time it has been seen
+     */
     uint32_t get_index(const std::thread::id id);
 
+    /**
+     * Returns a thread's completion entry index to the pool, so that a thread
+     * registered later can reuse its ring. Called automatically when a thread
+     * that registered itself through get_index exits.
+     */
+    void release_index(const std::thread::id id, uint32_t index);
+
     void set_waiting(const std::thread::id id);
 
     void reset_waiting(const std::thread::id id);
@@ -35,9 +35,11 @@ SST<DerivedSST>::~SST() {
         if(thread.joinable()) thread.join();
     }
 
+#ifdef USE_VERBS_API
     if(rows != nullptr) {
         delete[](const_cast<uint8_t*>(rows));
     }
+#endif
 }
 
 /**
@@ -164,10 +166,11 @@ void SST<DerivedSST>::put_with_completion(const std::vector<uint32_t> receiver_r
     uint32_t ce_idx = util::polling_data.get_index(tid);
 
     util::polling_data.set_waiting(tid);
+    // indexed by row, since receiver_ranks may be any subset of the rows
 #ifdef USE_VERBS_API
-    verbs_sender_ctxt ce_ctxt[receiver_ranks.size()];
+    verbs_sender_ctxt ce_ctxt[num_members];
 #else
-    lf_completion_entry_ctxt ce_ctxt[receiver_ranks.size()];
+    lf_completion_entry_ctxt ce_ctxt[num_members];
 #endif
     for(auto index : receiver_ranks) {
         // don't write to yourself or a frozen row
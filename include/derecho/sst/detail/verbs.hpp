@@ -156,10 +156,14 @@ public:
      * @param addr  the address of the OOB memory
      * @param size  the size of the OOB memory
      * @param attr  the memory attribute
+     * @param use_registration_cache    whether the registration may come from,
+     *              and stay in, the registration cache if it is enabled. Pass
+     *              false for memory that will be freed without munmap.
      *
      * @throws derecho_exception on failure.
      */
-    static void register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr);
+    static void register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr,
+                                       bool use_registration_cache = true);
 
     /**
      * Deregister oob memory
@@ -1,13 +1,18 @@
 #include "sst.hpp"
+#include "detail/datagram_multicast.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
+#include <optional>
 #include <thread>
 #include <vector>
 
@@ -51,6 +56,38 @@ class multicast_group {
 
     std::thread timeout_thread;
 
+    /** Starts every datagram, followed by num_messages message_datagram_headers and their messages */
+    struct datagram_header {
+        uint64_t session_id;
+        uint64_t deployment_id;
+        uint32_t sender_row;
+        /** The sender's index before this batch; the batch can only be applied on top of it */
+        int32_t previous_index;
+        /** The sender's index after this batch */
+        int32_t committed_index;
+        uint32_t num_messages;
+    };
+    struct message_datagram_header {
+        int32_t index;
+        /** The number of bytes of the slot that follow */
+        uint32_t length;
+        /** The message size stored at the end of the slot */
+        uint64_t size_field;
+    };
+
+    // settings for sending through datagram_transport, if it is not null
+    uint64_t datagram_session_id = 0;
+    uint64_t datagram_deployment_id = 0;
+    uint32_t max_datagram_size = 0;
+    std::chrono::milliseconds repair_timeout{0};
+    std::vector<uint8_t> datagram_buffer;
+    std::chrono::steady_clock::time_point last_repair_check;
+    int32_t index_at_last_repair_check = -1;
+    // set once every member is known to receive the datagrams; until then messages are only written over RDMA
+    std::atomic<bool> datagram_sending_enabled{false};
+    // declared last, so its receive thread stops before the rest of the group is destroyed
+    std::unique_ptr<datagram_multicast> datagram_transport;
+
     void initialize() {
         for(auto i : row_indices) {
             for(uint j = num_received_offset; j < num_received_offset + num_senders; ++j) {
@@ -67,7 +104,8 @@ public:
                     std::vector<int> is_sender = {},
                     uint32_t num_received_offset = 0,
                     uint32_t slots_offset = 0,
-                    int32_t index_offset = 0)
+                    int32_t index_offset = 0,
+                    const std::optional<datagram_settings>& datagram = std::nullopt)
             : my_row(sst->get_local_index()),
               sst(sst),
               row_indices(row_indices),
@@ -105,6 +143,38 @@ public:
             my_sender_index = -1;
         }
         initialize();
+        if(datagram) {
+            datagram_session_id = datagram->session_id;
+            datagram_deployment_id = datagram->deployment_id;
+            max_datagram_size = datagram->max_datagram_size;
+            repair_timeout = datagram->repair_timeout;
+            datagram_buffer.resize(max_datagram_size);
+            last_repair_check = std::chrono::steady_clock::now();
+            datagram_transport = std::make_unique<datagram_multicast>(
+                    *datagram, [this](const uint8_t* data, std::size_t size) {
+                        receive_datagram(data, size);
+                    });
+        }
+    }
+
+    /**
+     * @return True if this node joined the group's datagram multicast, and can
+     * therefore receive the other members' messages as datagrams
+     */
+    bool has_datagram_transport() const {
+        return datagram_transport != nullptr;
+    }
+
+    /**
+     * Starts sending this node's messages as datagrams. Must only be called
+     * once every other member has joined the same datagram multicast, since a
+     * member that can't receive the datagrams would only get the messages
+     * through repairs. Has no effect if this node has no datagram transport.
+     */
+    void enable_datagram_sending() {
+        if(datagram_transport) {
+            datagram_sending_enabled = true;
+        }
     }
 
     volatile uint8_t* get_buffer(uint64_t msg_size) {
@@ -143,6 +213,207 @@ public:
     void send(uint32_t committed_index, uint32_t ready_to_be_sent = 1,
               uint32_t num_nulls_queued = 0, int32_t first_null_index = -1,
               size_t header_size = 0) {
+        if(datagram_sending_enabled && ready_to_be_sent > 0) {
+            if(send_datagram(committed_index, ready_to_be_sent, num_nulls_queued, first_null_index, header_size)) {
+                return;
+            }
+            // The index written by put_slots would let a member that lost an
+            // earlier datagram skip over the missing messages, so rewrite
+            // every message that hasn't been acknowledged by all members first
+            put_unacknowledged_slots(committed_index - ready_to_be_sent);
+        }
+        put_slots(committed_index, ready_to_be_sent, num_nulls_queued, first_null_index, header_size);
+    }
+
+    /**
+     * If messages are being sent as datagrams, resends the messages that
+     * members have gone longer than the repair timeout without acknowledging,
+     * by writing them over RDMA. Must be called periodically by the thread
+     * that calls send().
+     */
+    void repair_datagram_losses() {
+        if(!datagram_sending_enabled || my_sender_index < 0) {
+            return;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if(now - last_repair_check < repair_timeout) {
+            return;
+        }
+        last_repair_check = now;
+        const int32_t committed_index = sst->index[my_row][index_offset];
+        std::vector<uint32_t> lagging_rows;
+        int32_t first_missing_index = committed_index + 1;
+        for(auto i : row_indices) {
+            if(i == my_row) {
+                continue;
+            }
+            const int32_t num_received = sst->num_received_sst[i][num_received_offset + my_sender_index];
+            // Rows that are still missing messages sent a full timeout ago
+            if(num_received < index_at_last_repair_check) {
+                lagging_rows.push_back(i);
+                first_missing_index = std::min(first_missing_index, num_received + 1);
+            }
+        }
+        index_at_last_repair_check = committed_index;
+        if(lagging_rows.empty()) {
+            return;
+        }
+        put_slot_range(lagging_rows, first_missing_index, committed_index);
+        // Waiting for the index write also waits for the slot writes posted before it,
+        // so a repair can't land on top of slots that have since been reused
+        sst->put_with_completion(lagging_rows,
+                                 (uint8_t*)std::addressof(sst->index[0][index_offset]) - sst->getBaseAddress(),
+                                 sizeof(sst->index[0][index_offset]));
+    }
+
+private:
+    /**
+     * Writes the entire slots of a range of messages to some of the members
+     * over RDMA, without writing the index.
+     * @param rows The rows to write to
+     * @param first_index The index of the first message to write
+     * @param last_index The index of the last message to write
+     */
+    void put_slot_range(const std::vector<uint32_t>& rows, int32_t first_index, int32_t last_index) {
+        if(first_index > last_index) {
+            return;
+        }
+        // A slot can't be reused until every member has acknowledged its
+        // message, so unacknowledged messages are all still in their slots
+        const uint32_t num_slots = std::min<int64_t>(last_index - first_index + 1, window_size);
+        const uint32_t first_slot = (last_index - num_slots + 1) % window_size;
+        const uint32_t num_before_wrap = std::min(num_slots, window_size - first_slot);
+        sst->put(rows,
+                 (uint8_t*)std::addressof(sst->slots[0][slots_offset + max_msg_size * first_slot]) - sst->getBaseAddress(),
+                 num_before_wrap * max_msg_size);
+        if(num_slots > num_before_wrap) {
+            sst->put(rows,
+                     (uint8_t*)std::addressof(sst->slots[0][slots_offset]) - sst->getBaseAddress(),
+                     (num_slots - num_before_wrap) * max_msg_size);
+        }
+    }
+
+    /**
+     * Writes every message up to last_index that some member has not yet
+     * acknowledged to all the other members over RDMA, so that no member can
+     * be missing one of them when the index is written after them.
+     */
+    void put_unacknowledged_slots(int32_t last_index) {
+        std::vector<uint32_t> other_rows;
+        int32_t first_unacknowledged_index = last_index + 1;
+        for(auto i : row_indices) {
+            if(i == my_row) {
+                continue;
+            }
+            other_rows.push_back(i);
+            const int32_t num_received = sst->num_received_sst[i][num_received_offset + my_sender_index];
+            first_unacknowledged_index = std::min(first_unacknowledged_index, num_received + 1);
+        }
+        put_slot_range(other_rows, first_unacknowledged_index, last_index);
+    }
+
+    /**
+     * Sends a batch of committed messages to the group in a single datagram,
+     * copying only the used part of each slot.
+     * @return False if the batch doesn't fit in a datagram or couldn't be
+     * sent, in which case nothing was sent
+     */
+    bool send_datagram(uint32_t committed_index, uint32_t ready_to_be_sent,
+                       uint32_t num_nulls_queued, int32_t first_null_index,
+                       size_t header_size) {
+        const int32_t previous_index = committed_index - ready_to_be_sent;
+        std::size_t datagram_size = sizeof(datagram_header);
+        uint32_t num_messages = 0;
+        for(int32_t index = previous_index + 1; index <= (int32_t)committed_index; ++index) {
+            const uint32_t slot = index % window_size;
+            const uint64_t slot_start = slots_offset + max_msg_size * slot;
+            message_datagram_header message_header;
+            message_header.index = index;
+            message_header.size_field = (uint64_t&)sst->slots[my_row][slot_start + max_msg_size - sizeof(uint64_t)];
+            message_header.length = std::min<uint64_t>(message_header.size_field, max_msg_size - sizeof(uint64_t));
+            if(num_nulls_queued > 0 && index == first_null_index) {
+                // A run of nulls only uses the header in the first null's slot
+                message_header.length = header_size;
+                index += num_nulls_queued - 1;
+            }
+            if(datagram_size + sizeof(message_header) + message_header.length > max_datagram_size) {
+                return false;
+            }
+            memcpy(&datagram_buffer[datagram_size], &message_header, sizeof(message_header));
+            datagram_size += sizeof(message_header);
+            memcpy(&datagram_buffer[datagram_size], const_cast<uint8_t*>(&sst->slots[my_row][slot_start]), message_header.length);
+            datagram_size += message_header.length;
+            num_messages++;
+        }
+        const datagram_header header{datagram_session_id, datagram_deployment_id, my_row,
+                                     previous_index, (int32_t)committed_index, num_messages};
+        memcpy(datagram_buffer.data(), &header, sizeof(header));
+        return datagram_transport->send(datagram_buffer.data(), datagram_size);
+    }
+
+    /**
+     * Applies a datagram from another sender to the local copy of its row, as
+     * if the sender had written the slots and then its index over RDMA. A
+     * batch is only applied if it directly follows the messages already
+     * received from the sender; after a lost datagram, the gap is filled by
+     * the sender's repair_datagram_losses().
+     */
+    void receive_datagram(const uint8_t* data, std::size_t size) {
+        datagram_header header;
+        if(size < sizeof(header)) {
+            return;
+        }
+        memcpy(&header, data, sizeof(header));
+        if(header.session_id != datagram_session_id || header.deployment_id != datagram_deployment_id
+           || header.sender_row == my_row
+           || std::find(row_indices.begin(), row_indices.end(), header.sender_row) == row_indices.end()
+           || sst->is_row_frozen(header.sender_row)) {
+            return;
+        }
+        volatile int32_t* sender_index = &sst->index[header.sender_row][index_offset];
+        int32_t current_index = __atomic_load_n(sender_index, __ATOMIC_ACQUIRE);
+        if(header.previous_index > current_index || header.committed_index <= current_index) {
+            return;
+        }
+        std::size_t offset = sizeof(header);
+        for(uint32_t i = 0; i < header.num_messages; ++i) {
+            message_datagram_header message_header;
+            if(size - offset < sizeof(message_header)) {
+                return;
+            }
+            memcpy(&message_header, data + offset, sizeof(message_header));
+            offset += sizeof(message_header);
+            if(message_header.length > max_msg_size - sizeof(uint64_t) || size - offset < message_header.length) {
+                return;
+            }
+            // Slots of messages that were already received may have been reused
+            if(message_header.index > current_index) {
+                // A repair over RDMA may have delivered this message since the
+                // batch was checked, after which the sender can reuse its slot
+                if(__atomic_load_n(sender_index, __ATOMIC_ACQUIRE) >= message_header.index) {
+                    return;
+                }
+                const uint64_t slot_start = slots_offset + max_msg_size * (message_header.index % window_size);
+                memcpy(const_cast<uint8_t*>(&sst->slots[header.sender_row][slot_start]), data + offset, message_header.length);
+                (uint64_t&)sst->slots[header.sender_row][slot_start + max_msg_size - sizeof(uint64_t)] = message_header.size_field;
+                // The sender can only reuse the slot after this node delivers the
+                // message, which needs the index to reach it first. If it still
+                // hasn't, nothing newer can have been written to the slot;
+                // otherwise the RDMA path has taken over, so stop applying the batch.
+                if(__atomic_load_n(sender_index, __ATOMIC_ACQUIRE) >= message_header.index) {
+                    return;
+                }
+            }
+            offset += message_header.length;
+        }
+        // Publish the slots before the index; if a repair moved the index in the meantime, it already has these messages
+        __atomic_compare_exchange_n(sender_index, &current_index, header.committed_index, false,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+
+    void put_slots(uint32_t committed_index, uint32_t ready_to_be_sent,
+                   uint32_t num_nulls_queued, int32_t first_null_index,
+                   size_t header_size) {
         if(ready_to_be_sent == 0) {
             // Push the index
             sst->put(sst->index, index_offset);
@@ -168,10 +439,11 @@ public:
         }
         sst->put((uint8_t*)std::addressof(sst->slots[0][slots_offset + max_msg_size * first_slot]) - sst->getBaseAddress(),
                  size_to_push);
-        send(committed_index, ready_to_be_sent, num_nulls_queued,
-             first_null_index, header_size);
+        put_slots(committed_index, ready_to_be_sent, num_nulls_queued,
+                  first_null_index, header_size);
     }
 
+public:
     void debug_print() {
         using std::cout;
         using std::endl;
@@ -171,7 +171,13 @@ private:
     void init_SSTFields(Fields&... fields) {
         rowLen = 0;
         compute_rowLen(rowLen, fields...);
+#ifdef USE_VERBS_API
         void* mem_ptr = new uint8_t[rowLen * num_members];
+#else
+        // Register all the rows as one block, which every row's resources share
+        row_memory_block = std::make_shared<row_memory>(rowLen * num_members);
+        void* mem_ptr = row_memory_block->buffer;
+#endif
         memset(mem_ptr, 0, rowLen * num_members);
         rows = (volatile uint8_t*)mem_ptr;
         // snapshot = new uint8_t[rowLen * num_members];
@@ -195,6 +201,10 @@ private:
     const uint32_t poll_cq_timeout_ms;
     /** Pointer to memory where the SST rows are stored. */
     volatile uint8_t* rows;
+#ifndef USE_VERBS_API
+    /** The registered memory block that rows points into. */
+    std::shared_ptr<row_memory> row_memory_block;
+#endif
     // uint8_t* snapshot;
     /** Length of each row in this SST, in bytes. */
     size_t rowLen;
@@ -295,7 +305,8 @@ public:
                         node_rank, write_addr, read_addr, rowLen, rowLen);
 #else  // use libfabric api by default
                 res_vec[sst_index] = std::make_unique<resources>(
-                        node_rank, write_addr, read_addr, rowLen, rowLen, (my_node_id < node_rank));
+                        node_rank, write_addr, read_addr, rowLen, rowLen, (my_node_id < node_rank),
+                        *row_memory_block);
 #endif
                 // update qp_num_to_index
                 // qp_num_to_index[res_vec[sst_index].get()->qp->qp_num] = sst_index;
@@ -327,6 +338,9 @@ public:
     /** Gets the index of the local row in the table. */
     unsigned int get_local_index() const { return my_index; }
 
+    /** Checks whether a row has been frozen because its node has failed. */
+    bool is_row_frozen(uint32_t row_index) const { return row_is_frozen[row_index]; }
+
     const uint8_t* getBaseAddress() {
         return const_cast<uint8_t*>(rows);
     }
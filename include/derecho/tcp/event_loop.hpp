@@ -0,0 +1,151 @@
+#pragma once
+
+#include <derecho/config.h>
+#include <derecho/tcp/tcp.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tcp {
+
+/**
+ * A single-threaded, epoll-based event loop for control-plane TCP traffic,
+ * such as join handshakes and external-client requests. A socket is handed to
+ * the loop along with a read or write to perform on it; the loop performs the
+ * operation with nonblocking I/O, multiplexed with every other pending
+ * operation, and calls a handler when the operation completes, fails, or
+ * exceeds its timeout. This lets one thread carry on handshakes with many
+ * peers at once, and keeps a slow or unresponsive peer from delaying the rest.
+ *
+ * Handlers run on the event loop's thread, so they should not block. A handler
+ * takes ownership of the socket, and may give it back to the loop with
+ * another operation. Sockets are always in blocking mode when they are passed
+ * to a handler, so they can also be used with the ordinary socket methods.
+ */
+class event_loop {
+public:
+    /** Called with each new connection accepted by a listener. */
+    using accept_handler = std::function<void(socket)>;
+    /** Called with the socket and the bytes read when a read completes. */
+    using read_handler = std::function<void(socket, std::vector<uint8_t>)>;
+    /** Called with the socket when a write completes. */
+    using write_handler = std::function<void(socket)>;
+    /** Called with the socket and the reason when a read or write fails or times out. */
+    using error_handler = std::function<void(socket, const socket_error&)>;
+
+private:
+    /** A read or write in progress on a socket owned by the event loop. */
+    struct operation {
+        socket sock;
+        bool is_write;
+        /** For reads, the buffer being filled; its size is the number of bytes to read */
+        std::vector<uint8_t> read_buffer;
+        /** For writes, the buffers to send, in order */
+        std::vector<std::vector<uint8_t>> write_buffers;
+        /** The number of bytes read or written so far */
+        std::size_t bytes_done;
+        bool has_deadline;
+        std::chrono::steady_clock::time_point deadline;
+        read_handler on_read;
+        write_handler on_write;
+        error_handler on_error;
+    };
+
+    int epoll_fd;
+    /** An eventfd that wakes up the event loop thread when an operation is submitted or the loop is stopped */
+    int wakeup_fd;
+    std::atomic<bool> thread_shutdown;
+    /** Operations submitted by any thread that the loop thread has not started yet */
+    std::list<operation> submitted_operations;
+    /** Listeners that have been added to the loop, by file descriptor */
+    std::map<int, accept_handler> listeners;
+    std::mutex submitted_mutex;
+    /** Operations in progress, by file descriptor. Only accessed by the loop thread. */
+    std::map<int, operation> active_operations;
+    std::thread loop_thread;
+
+    void loop(const std::string& thread_name);
+    void submit(operation&& op);
+    /** Registers the submitted operations with epoll. */
+    void start_submitted_operations();
+    /** Accepts every pending connection on a listener that epoll reported readable. */
+    void accept_connections(int listener_fd);
+    /**
+     * Reads or writes as many bytes as the socket will take without blocking.
+     * @return True if the operation is finished
+     * @throw a subclass of socket_error if the read or write failed
+     */
+    bool make_progress(operation& op);
+    /** Removes an operation's socket from epoll and calls its completion handler. */
+    void finish_operation(std::map<int, operation>::iterator op_iter);
+    /** Removes an operation's socket from epoll and calls its error handler. */
+    void fail_operation(std::map<int, operation>::iterator op_iter, const socket_error& error);
+    /** Fails every operation whose deadline has passed with socket_timeout_error. */
+    void expire_operations();
+    /** @return The number of milliseconds until the nearest deadline, or -1 if there are none. */
+    int time_to_next_deadline() const;
+
+public:
+    /**
+     * Creates an event loop and starts its thread.
+     * @param thread_name The name to give the event loop's thread
+     */
+    explicit event_loop(const std::string& thread_name = "tcp_events");
+    /** Stops the event loop, closing any sockets that still have operations in progress. */
+    ~event_loop();
+
+    /**
+     * Makes the event loop accept connections on a listener, and pass each new
+     * socket to a handler. The listener is switched to nonblocking mode, so it
+     * should not be used outside the event loop after this call, and must
+     * outlive the event loop.
+     * @param listener The connection listener to accept connections on
+     * @param on_accept The handler to call with each new connection
+     */
+    void add_listener(connection_listener& listener, accept_handler on_accept);
+
+    /**
+     * Reads a fixed number of bytes from a socket without blocking the caller.
+     * @param sock The socket to read from, which is owned by the event loop
+     * until one of the handlers is called
+     * @param size The number of bytes to read
+     * @param timeout_ms The number of milliseconds to wait for all the bytes
+     * to arrive before failing with socket_timeout_error, or a negative
+     * value to wait indefinitely
+     * @param on_complete The handler to call with the bytes that were read
+     * @param on_error The handler to call if the read fails or times out
+     */
+    void async_read(socket sock, std::size_t size, int timeout_ms,
+                    read_handler on_complete, error_handler on_error);
+
+    /**
+     * Writes a sequence of buffers to a socket without blocking the caller,
+     * gathering them into as few system calls as possible.
+     * @param sock The socket to write to, which is owned by the event loop
+     * until one of the handlers is called
+     * @param buffers The buffers to send, in order
+     * @param timeout_ms The number of milliseconds to wait for all the bytes
+     * to be sent before failing with socket_timeout_error, or a negative
+     * value to wait indefinitely
+     * @param on_complete The handler to call once every byte has been written
+     * @param on_error The handler to call if the write fails or times out
+     */
+    void async_write(socket sock, std::vector<std::vector<uint8_t>> buffers, int timeout_ms,
+                     write_handler on_complete, error_handler on_error);
+
+    /**
+     * Stops the event loop's thread. Operations still in progress are
+     * abandoned without calling their handlers.
+     */
+    void stop();
+};
+
+}  // namespace tcp
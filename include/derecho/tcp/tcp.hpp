@@ -6,6 +6,9 @@
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <sys/uio.h>
+
+struct sockaddr_storage;
 
 namespace tcp {
 
@@ -52,6 +55,16 @@ struct incomplete_read_error : public socket_error {
     incomplete_read_error(const std::string& message = "") : socket_error(message){};
 };
 
+/**
+ * An exception that reports that a socket operation did not complete before
+ * its timeout expired. Only operations with a timeout, such as those performed
+ * by event_loop or on a socket with a timeout set by socket::set_timeout, can
+ * fail this way.
+ */
+struct socket_timeout_error : public socket_error {
+    socket_timeout_error(const std::string& message = "") : socket_error(message){};
+};
+
 /**
  * An exception that reports that a socket operation failed because of the error
  * "connection reset by peer." This is a subclass of socket_io_error with the
@@ -80,6 +93,7 @@ class socket {
             : sock(_sock), remote_ip(remote_ip), remote_port(remote_port) {}
 
     friend class connection_listener;
+    friend class event_loop;
     std::string remote_ip;
     uint16_t remote_port;
 
@@ -120,6 +134,16 @@ public:
      * to (or an empty string if this socket is unconnected).
      */
     std::string get_remote_ip() const noexcept { return remote_ip; }
+    /**
+     * Limits how long a single blocking read or write on this socket can wait
+     * for the remote host. Once a timeout is set, read() and write() throw
+     * socket_timeout_error if the remote host stops sending or receiving for
+     * longer than the timeout.
+     * @param timeout_ms The timeout in milliseconds, or 0 to block
+     * indefinitely (the default for a new socket)
+     * @throw socket_io_error if the timeout could not be set
+     */
+    void set_timeout(int timeout_ms);
     /**
      * @return The TCP port on the remote peer that this socket is connected to
      * (or 0 if this socket is unconnected).
@@ -184,6 +208,18 @@ public:
      */
     void write(const uint8_t* buffer, size_t size);
 
+    /**
+     * Writes the contents of several buffers to the socket, in order, using
+     * as few system calls as possible (a "gather" write). Equivalent to
+     * calling write() on each buffer, but avoids a system call per buffer
+     * when sending a message that is made of many small pieces.
+     * @param buffers An array of iovecs describing the buffers to send
+     * @param count The number of iovecs in the array
+     * @throw a subclass of socket_error if there was an error before all the
+     * bytes could be written, with the same meaning as for write()
+     */
+    void writev(const struct iovec* buffers, int count);
+
     /**
      * Convenience method for sending a single POD object (e.g. an int) over
      * the socket.
@@ -234,6 +270,13 @@ class connection_listener {
     std::unique_ptr<int, std::function<void(int*)>> fd;
     uint16_t port;
 
+    friend class event_loop;
+    /**
+     * Wraps a socket descriptor returned by accept() in a socket object,
+     * recording the address of the client that connected.
+     */
+    static socket wrap_client_socket(int client_sock, const struct sockaddr_storage& client_addr_info);
+
 public:
     /**
      * Constructs a connection listener ("server socket") that listens on the
@@ -0,0 +1,115 @@
+#pragma once
+#ifndef REGISTRATION_CACHE_HPP
+#define REGISTRATION_CACHE_HPP
+
+#include <derecho/config.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace derecho {
+
+/**
+ * A cache of RDMA memory registrations, so that registering a buffer that
+ * lies within memory registered earlier doesn't pay for another registration.
+ *
+ * Registrations are kept in a tree ordered by the address range they cover,
+ * and are shared: a registration is in use as long as anyone other than the
+ * cache holds a pointer to it, and is deregistered (by the deleter the
+ * register function gave it) when the last pointer goes away. Registrations
+ * that are not in use stay in the cache until it holds more than its maximum
+ * number of entries, when the least recently used ones are evicted.
+ *
+ * Registrations pin the physical pages behind a range of addresses, so a
+ * cached registration goes stale if its memory is unmapped and the addresses
+ * are reused. To catch this, the library interposes on munmap and mremap and
+ * removes every cached registration that overlaps the range being unmapped.
+ * Memory that an allocator returns to the system without calling munmap
+ * through the dynamic linker (glibc's malloc does this for large blocks) is
+ * not seen by the hook, so only enable the cache for buffers that are mapped
+ * with mmap or that live as long as the process.
+ */
+class registration_cache {
+public:
+    /** A registration, whose deleter deregisters it */
+    using registration_t = std::shared_ptr<void>;
+    /**
+     * Registers a range of memory.
+     * @throw any exception, which acquire() passes on to its caller
+     */
+    using register_function_t = std::function<registration_t(void* start, std::size_t length)>;
+
+    struct statistics {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t invalidations = 0;
+    };
+
+private:
+    struct entry;
+    /** Keyed by [start, end); ranges may overlap */
+    using index_t = std::map<std::pair<uintptr_t, uintptr_t>, entry>;
+    struct entry {
+        registration_t registration;
+        /** The entry's position in lru_list */
+        std::list<index_t::iterator>::iterator lru_position;
+    };
+
+    const std::size_t max_entries;
+    const register_function_t register_function;
+    mutable std::mutex cache_mutex;
+    index_t index;
+    /** Most recently used first */
+    std::list<index_t::iterator> lru_list;
+    /** The length of the longest range ever cached, which bounds how far back a lookup searches */
+    uintptr_t max_range_length;
+    statistics stats;
+
+    /** Finds an entry whose range covers [start, end); assumes cache_mutex is held. */
+    index_t::iterator find_covering(uintptr_t start, uintptr_t end);
+    /**
+     * Removes an entry from the cache; assumes cache_mutex is held. The
+     * registration is moved to released, so it can be dropped after the lock is.
+     */
+    void remove(index_t::iterator entry_it, std::list<registration_t>& released);
+    /** Evicts unused entries until the cache is within max_entries; assumes cache_mutex is held. */
+    void evict(std::list<registration_t>& released);
+
+public:
+    /**
+     * Creates a cache and starts invalidating its entries when memory is unmapped.
+     * @param max_entries The number of registrations to keep, counting the
+     * ones in use, before evicting unused ones
+     * @param register_function The function that registers memory on a miss
+     */
+    registration_cache(std::size_t max_entries, register_function_t register_function);
+    /** Stops watching for unmapped memory and drops the cache's references to its registrations. */
+    ~registration_cache();
+
+    registration_cache(const registration_cache&) = delete;
+    registration_cache& operator=(const registration_cache&) = delete;
+
+    /**
+     * Returns a registration that covers [addr, addr + length), registering
+     * the pages that contain the range if no cached registration does. The
+     * registration stays valid for as long as the caller holds the pointer,
+     * even if it is evicted or its range is unmapped in the meantime.
+     */
+    registration_t acquire(void* addr, std::size_t length);
+    /** Removes every cached registration that overlaps [addr, addr + length). */
+    void invalidate(const void* addr, std::size_t length);
+    /** Removes every cached registration. */
+    void clear();
+    statistics get_statistics() const;
+};
+
+}  // namespace derecho
+
+#endif /* REGISTRATION_CACHE_HPP */
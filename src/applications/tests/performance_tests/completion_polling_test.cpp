@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <derecho/sst/detail/poll_utils.hpp>
+
+using std::cout;
+using std::endl;
+
+/**
+ * The number of completions each waiting thread has outstanding at once,
+ * like a thread that posts a batch of writes and then waits for all of them.
+ */
+constexpr uint64_t window_size = 64;
+/** The number of remote nodes each thread's completions are spread across */
+constexpr int32_t num_remote_nodes = 16;
+
+/** Per-thread counters shared between a waiting thread and the simulated polling thread. */
+struct WaiterState {
+    alignas(64) std::atomic<uint64_t> num_posted{0};
+    alignas(64) uint64_t num_delivered = 0;
+    uint32_t ce_idx = 0;
+};
+
+/**
+ * Measures how many completions per second the SST polling thread can hand
+ * off to threads waiting in sst::util::PollingData, as the number of waiting
+ * threads grows. The main thread plays the role of the polling thread,
+ * delivering a completion for every operation a waiting thread has "posted";
+ * each waiting thread keeps window_size operations outstanding and retrieves
+ * their completions with get_completion_entry, as P2PConnectionManager and
+ * the OOB operations do. No RDMA hardware is needed.
+ * Command line arguments: [max_threads [completions_per_thread]]
+ */
+int main(int argc, char* argv[]) {
+    const uint32_t max_threads = argc > 1 ? std::stoul(argv[1]) : 16;
+    const uint64_t completions_per_thread = argc > 2 ? std::stoull(argv[2]) : 1000000;
+
+    for(uint32_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        std::vector<std::unique_ptr<WaiterState>> waiters;
+        for(uint32_t i = 0; i < num_threads; ++i) {
+            waiters.emplace_back(std::make_unique<WaiterState>());
+        }
+        std::atomic<uint32_t> num_ready{0};
+        std::atomic<bool> start{false};
+        std::vector<std::thread> waiter_threads;
+        for(uint32_t i = 0; i < num_threads; ++i) {
+            waiter_threads.emplace_back([&, i]() {
+                WaiterState& state = *waiters[i];
+                const auto tid = std::this_thread::get_id();
+                state.ce_idx = sst::util::polling_data.get_index(tid);
+                num_ready++;
+                while(!start) {
+                    std::this_thread::yield();
+                }
+                uint64_t num_received = 0;
+                state.num_posted = window_size;
+                while(num_received < completions_per_thread) {
+                    const uint64_t prev_received = num_received;
+                    for(int32_t nid = 0; nid < num_remote_nodes; ++nid) {
+                        while(sst::util::polling_data.get_completion_entry(tid, nid)) {
+                            num_received++;
+                        }
+                    }
+                    if(num_received == prev_received) {
+                        // Don't starve the polling thread if there are fewer cores than threads
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    // "Post" another operation for each completion received
+                    state.num_posted = std::min(num_received + window_size, completions_per_thread);
+                }
+            });
+        }
+        while(num_ready < num_threads) {
+            std::this_thread::yield();
+        }
+        auto begin_time = std::chrono::steady_clock::now();
+        start = true;
+        uint64_t total_delivered = 0;
+        const uint64_t total_completions = completions_per_thread * num_threads;
+        while(total_delivered < total_completions) {
+            const uint64_t prev_delivered = total_delivered;
+            for(auto& state : waiters) {
+                const uint64_t num_posted = state->num_posted.load();
+                for(; state->num_delivered < num_posted; ++state->num_delivered) {
+                    sst::util::polling_data.insert_completion_entry(
+                            state->ce_idx, {static_cast<int32_t>(state->num_delivered % num_remote_nodes), 1});
+                    total_delivered++;
+                }
+            }
+            if(total_delivered == prev_delivered) {
+                std::this_thread::yield();
+            }
+        }
+        for(std::thread& waiter_thread : waiter_threads) {
+            waiter_thread.join();
+        }
+        auto end_time = std::chrono::steady_clock::now();
+        double total_seconds = std::chrono::duration_cast<std::chrono::microseconds>(end_time - begin_time).count() / 1000000.0;
+        cout << "waiting threads: " << num_threads
+             << ", completions: " << total_completions
+             << ", time: " << total_seconds << " s"
+             << ", completions per second: " << total_completions / total_seconds << endl;
+    }
+}
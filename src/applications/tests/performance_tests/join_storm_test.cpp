@@ -0,0 +1,145 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+#include <derecho/core/detail/version_code.hpp>
+#include <derecho/core/detail/view_manager.hpp>
+
+using std::cout;
+using std::endl;
+
+class StormObject : public mutils::ByteRepresentable {
+    int state;
+
+public:
+    StormObject() : state(0) {}
+    StormObject(int init_state) : state(init_state) {}
+    int read_state() const { return state; }
+
+    DEFAULT_SERIALIZATION_SUPPORT(StormObject, state);
+    REGISTER_RPC_FUNCTIONS(StormObject, P2P_TARGETS(read_state));
+};
+
+void run_server() {
+    derecho::SubgroupInfo subgroup_info{&derecho::one_subgroup_entire_view};
+    derecho::Group<StormObject> group({}, subgroup_info, {}, std::vector<derecho::view_upcall_t>{},
+                                      [](persistent::PersistentRegistry*, derecho::subgroup_id_t) {
+                                          return std::make_unique<StormObject>();
+                                      });
+    cout << "Finished constructing/joining Group" << endl;
+    cout << "Press enter when finished with test." << endl;
+    std::cin.get();
+    group.leave(true);
+}
+
+/**
+ * Does what an external client does to download the View from a member:
+ * exchanges version codes, sends an external JoinRequest, and sends GET_VIEW.
+ * @return True if the View was received
+ */
+bool download_view(const std::string& member_ip, uint16_t member_gms_port, derecho::node_id_t client_id) {
+    try {
+        tcp::socket sock(member_ip, member_gms_port);
+        uint64_t member_version_hashcode;
+        sock.exchange(derecho::my_version_hashcode, member_version_hashcode);
+        if(member_version_hashcode != derecho::my_version_hashcode) {
+            return false;
+        }
+        sock.write(derecho::JoinRequest{client_id, true});
+        derecho::JoinResponse response;
+        sock.read(response);
+        if(response.code != derecho::JoinResponseCode::OK) {
+            return false;
+        }
+        sock.write(derecho::ExternalClientRequest::GET_VIEW);
+        std::size_t view_size;
+        sock.read(view_size);
+        std::vector<uint8_t> view_buffer(view_size);
+        sock.read(view_buffer.data(), view_size);
+        return true;
+    } catch(tcp::socket_error&) {
+        return false;
+    } catch(tcp::connection_failure&) {
+        return false;
+    }
+}
+
+/**
+ * Opens num_clients connections to a member's GMS port at once, and measures
+ * how long it takes them all to download the View. num_stalled of the
+ * connections never send their JoinRequest, to show that peers that stop
+ * responding do not delay the others.
+ */
+void run_storm(const std::string& member_ip, uint16_t member_gms_port,
+               uint32_t num_clients, uint32_t num_stalled) {
+    std::vector<tcp::socket> stalled_sockets;
+    for(uint32_t i = 0; i < num_stalled; ++i) {
+        stalled_sockets.emplace_back(member_ip, member_gms_port);
+    }
+    std::atomic<uint32_t> num_succeeded{0};
+    std::vector<std::thread> client_threads;
+    //External client IDs must not collide with member IDs, so start far above them
+    const derecho::node_id_t first_client_id = derecho::getConfUInt32(derecho::Conf::DERECHO_MAX_NODE_ID);
+    auto begin_time = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < num_clients; ++i) {
+        client_threads.emplace_back([&, i]() {
+            if(download_view(member_ip, member_gms_port, first_client_id + i)) {
+                num_succeeded++;
+            }
+        });
+    }
+    for(std::thread& client_thread : client_threads) {
+        client_thread.join();
+    }
+    auto end_time = std::chrono::steady_clock::now();
+    double total_ms = std::chrono::duration_cast<std::chrono::microseconds>(end_time - begin_time).count() / 1000.0;
+    cout << "clients: " << num_clients
+         << ", stalled connections: " << num_stalled
+         << ", views received: " << num_succeeded
+         << ", total time: " << total_ms << " ms"
+         << ", requests per second: " << num_succeeded / (total_ms / 1000.0) << endl;
+}
+
+/**
+ * Measures how well a group member handles a "join storm" of many external
+ * clients connecting to its GMS port at once. Run it on the members with
+ * "server", then once with "client", which connects to the member at
+ * member_ip:member_gms_port.
+ * Command line arguments: server|client [member_ip member_gms_port num_clients [num_stalled]]
+ */
+int main(int argc, char* argv[]) {
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+    if(argc < dashdash_pos + 2) {
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] server|client "
+             << "[member_ip member_gms_port num_clients [num_stalled]]" << endl;
+        return -1;
+    }
+    derecho::Conf::initialize(argc, argv);
+
+    const std::string role = argv[dashdash_pos + 1];
+    if(role == "client") {
+        if(argc < dashdash_pos + 5) {
+            cout << "The client needs member_ip, member_gms_port, and num_clients" << endl;
+            return -1;
+        }
+        const std::string member_ip = argv[dashdash_pos + 2];
+        const uint16_t member_gms_port = std::stoul(argv[dashdash_pos + 3]);
+        const uint32_t num_clients = std::stoul(argv[dashdash_pos + 4]);
+        const uint32_t num_stalled = argc > dashdash_pos + 5 ? std::stoul(argv[dashdash_pos + 5]) : 0;
+        run_storm(member_ip, member_gms_port, num_clients, num_stalled);
+    } else {
+        run_server();
+    }
+}
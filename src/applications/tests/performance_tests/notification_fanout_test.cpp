@@ -0,0 +1,171 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+
+using derecho::node_id_t;
+using std::cout;
+using std::endl;
+using std::chrono::duration_cast;
+
+/** Message types used by this test */
+enum : uint64_t {
+    DATA_NOTIFICATION = 0,
+    END_NOTIFICATION = 1
+};
+
+/** The topic all clients subscribe to */
+const uint64_t test_topic = 42;
+
+/** Counts the clients that have subscribed to the publishing member */
+std::atomic<uint32_t> num_subscribed{0};
+
+class FanoutObject : public mutils::ByteRepresentable,
+                     public derecho::NotificationSupport,
+                     public derecho::GroupReference {
+    int state;
+
+public:
+    FanoutObject() : state(0) {}
+    FanoutObject(int init_state) : state(init_state) {}
+
+    bool subscribe(const uint64_t& topic) const {
+        auto& callback = group->get_client_callback<FanoutObject>(this->subgroup_index);
+        callback.get_notification_dispatcher().subscribe(group->get_rpc_caller_id(), topic);
+        num_subscribed++;
+        return true;
+    }
+
+    DEFAULT_SERIALIZATION_SUPPORT(FanoutObject, state);
+    REGISTER_RPC_FUNCTIONS_WITH_NOTIFICATION(FanoutObject, P2P_TARGETS(subscribe));
+};
+
+derecho::SlowConsumerPolicy parse_policy(const std::string& policy_name) {
+    if(policy_name == "drop_newest") {
+        return derecho::SlowConsumerPolicy::DROP_NEWEST;
+    } else if(policy_name == "merge") {
+        return derecho::SlowConsumerPolicy::MERGE_BY_TYPE;
+    }
+    return derecho::SlowConsumerPolicy::DROP_OLDEST;
+}
+
+void run_server(uint32_t num_clients, uint32_t num_notifications, uint64_t msg_size,
+                const derecho::NotificationDispatcherOptions& options) {
+    derecho::SubgroupInfo subgroup_info{&derecho::one_subgroup_entire_view};
+    derecho::Group<FanoutObject> group({}, subgroup_info, {}, std::vector<derecho::view_upcall_t>{},
+                                       [](persistent::PersistentRegistry*, derecho::subgroup_id_t) {
+                                           return std::make_unique<FanoutObject>();
+                                       });
+    cout << "Finished constructing/joining Group" << endl;
+    // Only the member with rank 0 publishes; clients subscribe to it
+    if(group.get_my_rank() == 0) {
+        derecho::NotificationDispatcher& dispatcher
+                = group.get_client_callback<FanoutObject>().get_notification_dispatcher(options);
+        cout << "Waiting for " << num_clients << " clients to subscribe" << endl;
+        while(num_subscribed < num_clients) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        derecho::NotificationMessage message(DATA_NOTIFICATION, msg_size);
+        memset(message.body, 'a', msg_size);
+
+        auto begin_time = std::chrono::steady_clock::now();
+        for(uint32_t i = 0; i < num_notifications; ++i) {
+            dispatcher.publish(test_topic, message);
+        }
+        auto publish_end_time = std::chrono::steady_clock::now();
+        dispatcher.wait_until_drained();
+        auto end_time = std::chrono::steady_clock::now();
+
+        derecho::NotificationDispatcherStats stats = dispatcher.get_stats();
+        double publish_seconds = duration_cast<std::chrono::nanoseconds>(publish_end_time - begin_time).count() / 1e9;
+        double total_seconds = duration_cast<std::chrono::nanoseconds>(end_time - begin_time).count() / 1e9;
+        cout << "clients: " << num_clients
+             << ", publish rate: " << num_notifications / publish_seconds << " notifications/s"
+             << ", delivery rate: " << stats.delivered / total_seconds << " notifications/s"
+             << ", P2P messages: " << stats.messages_sent
+             << ", notifications per message: " << (double)stats.delivered / std::max<uint64_t>(stats.messages_sent, 1)
+             << ", dropped: " << stats.dropped
+             << ", merged: " << stats.merged << endl;
+        // The end marker is published after the queues are drained so no policy can discard it
+        dispatcher.publish(test_topic, derecho::NotificationMessage(END_NOTIFICATION, std::size_t{0}));
+        dispatcher.wait_until_drained();
+    }
+    cout << "Press enter when finished with test." << endl;
+    std::cin.get();
+    group.leave(true);
+}
+
+void run_client() {
+    derecho::ExternalGroupClient<FanoutObject> client([]() { return std::make_unique<FanoutObject>(); });
+    cout << "Finished constructing ExternalGroupClient" << endl;
+    node_id_t publisher = client.get_members()[0];
+    auto& caller = client.get_subgroup_caller<FanoutObject>();
+
+    std::mutex end_mutex;
+    std::condition_variable end_cv;
+    bool ended = false;
+    uint64_t num_received = 0;
+    caller.add_p2p_connection(publisher);
+    caller.register_notification_handler([&](const derecho::NotificationMessage& message) {
+        if(message.message_type == END_NOTIFICATION) {
+            std::lock_guard<std::mutex> lock(end_mutex);
+            ended = true;
+            end_cv.notify_all();
+        } else {
+            num_received++;
+        }
+    });
+    caller.p2p_send<RPC_NAME(subscribe)>(publisher, test_topic).get();
+    cout << "Subscribed to node " << publisher << ", awaiting notifications" << endl;
+
+    std::unique_lock<std::mutex> lock(end_mutex);
+    end_cv.wait(lock, [&]() { return ended; });
+    cout << "Received " << num_received << " notifications" << endl;
+}
+
+/**
+ * Measures how many notifications per second a member can fan out to a
+ * varying number of external clients through NotificationDispatcher. Run it
+ * on the members with "server" and once per client with "client"; the member
+ * with rank 0 publishes once num_clients clients have subscribed.
+ * Command line arguments: server|client num_clients num_notifications msg_size [drop_oldest|drop_newest|merge] [max_queue_depth]
+ */
+int main(int argc, char* argv[]) {
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+    if(argc < dashdash_pos + 5) {
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] server|client num_clients num_notifications msg_size "
+             << "[drop_oldest|drop_newest|merge] [max_queue_depth]" << endl;
+        return -1;
+    }
+    derecho::Conf::initialize(argc, argv);
+
+    const std::string role = argv[dashdash_pos + 1];
+    const uint32_t num_clients = std::stoul(argv[dashdash_pos + 2]);
+    const uint32_t num_notifications = std::stoul(argv[dashdash_pos + 3]);
+    const uint64_t msg_size = std::stoull(argv[dashdash_pos + 4]);
+    derecho::NotificationDispatcherOptions options;
+    if(argc > dashdash_pos + 5) {
+        options.slow_consumer_policy = parse_policy(argv[dashdash_pos + 5]);
+    }
+    if(argc > dashdash_pos + 6) {
+        options.max_queue_depth = std::stoull(argv[dashdash_pos + 6]);
+    }
+
+    if(role == "client") {
+        run_client();
+    } else {
+        run_server(num_clients, num_notifications, msg_size, options);
+    }
+}
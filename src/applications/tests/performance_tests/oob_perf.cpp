@@ -152,6 +152,11 @@ bool OOBRDMA::get(const uint64_t& callee_addr, const uint64_t& caller_addr, cons
     return true;
 }
 
+/**
+ * @param transient_group   If not null, the local buffers are registered with
+ *                          this group before, and deregistered after, every
+ *                          operation, as they would be if they were transient.
+ */
 template <typename P2PCaller>
 void perf_test (
         P2PCaller& p2p_caller,
@@ -162,7 +167,8 @@ void perf_test (
         size_t oob_data_size,
         size_t duration_sec,
         size_t nround = 1,
-        bool   inband = false) {
+        bool   inband = false,
+        derecho::Group<OOBRDMA>* transient_group = nullptr) {
     std::cout << "put_buffer_addr=" << put_buffer_laddr << std::endl;
     std::cout << "get_buffer_addr=" << get_buffer_laddr << std::endl;
     memset(put_buffer_laddr, 'A', oob_data_size);
@@ -182,6 +188,17 @@ void perf_test (
     uint8_t* buf = new uint8_t[oob_data_size];
     Bytes bytes(buf,oob_data_size);
     delete[] buf;
+    auto register_transient = [&](void* laddr) {
+        if (transient_group) {
+            transient_group->register_oob_memory(laddr, oob_data_size);
+            rkey = transient_group->get_oob_memory_key(laddr);
+        }
+    };
+    auto deregister_transient = [&](void* laddr) {
+        if (transient_group) {
+            transient_group->deregister_oob_memory(laddr);
+        }
+    };
 
     // STEP 1 Warmup: put 10 times
     uint64_t remote_addr;
@@ -191,8 +208,10 @@ void perf_test (
             auto results = p2p_caller.template p2p_send<RPC_NAME(inband_put)>(nid,bytes);
             results.get().get(nid);
         } else {
+            register_transient(put_buffer_laddr);
             auto results = p2p_caller.template p2p_send<RPC_NAME(put)>(nid,reinterpret_cast<uint64_t>(put_buffer_laddr),rkey,oob_data_size);
             remote_addr = results.get().get(nid);
+            deregister_transient(put_buffer_laddr);
         }
     }
 
@@ -208,8 +227,10 @@ void perf_test (
             auto results = p2p_caller.template p2p_send<RPC_NAME(inband_put)>(nid,bytes);
             results.get().get(nid);
         } else {
+            register_transient(put_buffer_laddr);
             auto results = p2p_caller.template p2p_send<RPC_NAME(put)>(nid,reinterpret_cast<uint64_t>(put_buffer_laddr),rkey,oob_data_size);
             remote_addr = results.get().get(nid);
+            deregister_transient(put_buffer_laddr);
         }
         num_put ++;
         cur_ns = get_time();
@@ -231,8 +252,10 @@ void perf_test (
             auto results = p2p_caller.template p2p_send<RPC_NAME(inband_get)>(nid);
             results.get().get(nid);
         } else {
+            register_transient(get_buffer_laddr);
             auto results = p2p_caller.template p2p_send<RPC_NAME(get)>(nid,remote_addr,reinterpret_cast<uint64_t>(get_buffer_laddr),rkey,oob_data_size);
             results.get().get(nid);
+            deregister_transient(get_buffer_laddr);
         }
         num_get ++;
         cur_ns = get_time();
@@ -257,6 +280,10 @@ void print_help() {
                  "     set number of rounds.\n"
                  "--inband\n"
                  "     use inband mode instead. By default, we use out-of-band(oob) mode.\n"
+                 "--transient, -t\n"
+                 "     register the local buffers before, and deregister them after, every\n"
+                 "     operation, as if they were transient. Compare runs with and without\n"
+                 "     registration_cache_entries set in derecho.cfg to measure the cache.\n"
                  "--help, -h\n"
                  "     print this information"
               << std::endl;
@@ -271,6 +298,7 @@ int main(int argc, char** argv) {
         {"hugepage",    required_argument,  0,  'H'},
         {"count",       required_argument,  0,  'c'},
         {"inband",      no_argument,        0,  'i'},
+        {"transient",   no_argument,        0,  't'},
         {"help",        no_argument,        0,  'h'},
         {0,0,0,0}
     };
@@ -280,9 +308,10 @@ int main(int argc, char** argv) {
     size_t hugepage_size = 0;
     size_t count         = 1;
     bool   inband        = false;
+    bool   transient     = false;
     while(true) {
         int c,option_index=0;
-        c = getopt_long(argc,argv,"d:D:H:c:ih",perf_options,&option_index);
+        c = getopt_long(argc,argv,"d:D:H:c:ith",perf_options,&option_index);
         if (c == -1) {
             break;
         }
@@ -302,6 +331,9 @@ int main(int argc, char** argv) {
             case 'i':
                 inband = true;
                 break;
+            case 't':
+                transient = true;
+                break;
             case 'h':
                 print_help();
                 return 0;
@@ -329,6 +361,7 @@ int main(int argc, char** argv) {
     }
     std::cout << "\tcount       = " << count << "\n"
               << "\tinband      = " << inband << "\n"
+              << "\ttransient   = " << transient << "\n"
               << std::endl;
 
 
@@ -368,6 +401,14 @@ int main(int argc, char** argv) {
                                       std::vector<derecho::view_upcall_t>{}, oobrdma_factory);
 
         std::cout << "Finished constructing/joining Group." << std::endl;
+        // The local buffers of the transient mode, which are only registered during each
+        // operation. They come from the Group's allocator, since the registration cache
+        // only holds registrations of memory allocated there.
+        derecho::registered_array<uint8_t> transient_buffer;
+        if (transient) {
+            transient_buffer = group.allocate_oob_memory(oob_mr_size);
+        }
+        void* transient_ptr = transient_buffer.get();
         memset(oob_mr_ptr,'A',oob_mr_size);
         group.register_oob_memory(oob_mr_ptr, oob_mr_size);
         std::cout << oob_mr_size << "bytes of OOB Memory registered" << std::endl;
@@ -375,8 +416,9 @@ int main(int argc, char** argv) {
         // test OOB put/get to a random peer
         if (group.get_my_rank() == 0) {
             uint64_t rkey           = group.get_oob_memory_key(oob_mr_ptr);
-            void* put_buffer_laddr  = oob_mr_ptr;
-            void* get_buffer_laddr  = reinterpret_cast<void*>(reinterpret_cast<uint64_t>(oob_mr_ptr) + oob_mr_size - oob_data_size);
+            void* local_ptr         = transient ? transient_ptr : oob_mr_ptr;
+            void* put_buffer_laddr  = local_ptr;
+            void* get_buffer_laddr  = reinterpret_cast<void*>(reinterpret_cast<uint64_t>(local_ptr) + oob_mr_size - oob_data_size);
 
             for(const auto& member: group.get_members()) {
                 if (member == group.get_my_id()) {
@@ -384,7 +426,8 @@ int main(int argc, char** argv) {
                 }
                 // TEST
                 for (size_t nr=1;nr<=count;nr++) {
-                    perf_test(group.get_subgroup<OOBRDMA>(),member,rkey,put_buffer_laddr,get_buffer_laddr,oob_data_size,duration_sec,nr);
+                    perf_test(group.get_subgroup<OOBRDMA>(),member,rkey,put_buffer_laddr,get_buffer_laddr,oob_data_size,duration_sec,nr,
+                              inband,transient ? &group : nullptr);
                 }
             }
         }
@@ -0,0 +1,107 @@
+#include <derecho/rdmc/detail/block_size.hpp>
+#include <derecho/rdmc/detail/message.hpp>
+#include <derecho/rdmc/detail/schedule.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::cout;
+using std::endl;
+
+constexpr size_t max_block_size = 1 << 20;
+constexpr double block_overhead_bytes = 65536;
+
+/**
+ * Makes a MODEL selector for a binomial pipeline over the given number of
+ * members, with the same schedule fit rdmc::create_group uses.
+ */
+block_size_selector make_model_selector(uint32_t num_members) {
+    std::vector<std::unique_ptr<schedule>> member_schedules;
+    std::vector<uint32_t> member_racks(num_members, 0);
+    for(uint32_t member = 0; member < num_members; ++member) {
+        member_schedules.emplace_back(std::make_unique<binomial_schedule>(num_members, member));
+    }
+    return block_size_selector::for_schedule(block_size_policy::MODEL, max_block_size, block_overhead_bytes,
+                                             member_schedules, member_racks, 1);
+}
+
+/**
+ * Checks that block size shifts survive the trip through the immediate, that
+ * the cost model picks smaller blocks for larger groups and mid-sized messages
+ * than for small groups and huge messages, and that AUTO_TUNE finds the
+ * fastest block size of a simulated network.
+ */
+int main(int argc, char** argv) {
+    int failures = 0;
+    auto check = [&](bool condition, const std::string& description) {
+        if(!condition) {
+            cout << "FAILED: " << description << endl;
+            failures++;
+        }
+    };
+
+    for(uint8_t shift = 0; shift <= block_size_selector::max_shift; ++shift) {
+        for(uint16_t total_blocks : {size_t{1}, size_t{2}, size_t{1000}, max_blocks_per_message(true)}) {
+            const uint16_t block_number = total_blocks - 1;
+            const ParsedImmediate parsed = parse_immediate(form_immediate(true, shift, total_blocks, block_number), true);
+            check(parsed.block_size_shift == shift && parsed.total_blocks == total_blocks
+                          && parsed.block_number == block_number,
+                  "immediate round trip with shift " + std::to_string(shift) + " and "
+                          + std::to_string(total_blocks) + " blocks");
+        }
+    }
+    for(uint16_t total_blocks : {size_t{1}, size_t{1000}, size_t{20000}, max_blocks_per_message(false)}) {
+        const uint16_t block_number = total_blocks - 1;
+        const ParsedImmediate parsed = parse_immediate(form_immediate(false, 0, total_blocks, block_number), false);
+        check(parsed.block_size_shift == 0 && parsed.total_blocks == total_blocks
+                      && parsed.block_number == block_number,
+              "immediate round trip without a shift and " + std::to_string(total_blocks) + " blocks");
+    }
+
+    block_size_selector fixed(block_size_policy::FIXED, max_block_size, block_overhead_bytes, 1, 0);
+    check(fixed.choose_shift(4 << 20) == 0 && fixed.expected_shift(4 << 20) == 0,
+          "the fixed policy always uses the group's block size");
+    check(!fixed.varies_block_size() && fixed.max_blocks() == 65535,
+          "the fixed policy keeps the full 16-bit block counts");
+
+    block_size_selector small_group = make_model_selector(2);
+    block_size_selector large_group = make_model_selector(16);
+    const size_t mid_size = 4 << 20;
+    const size_t huge_size = size_t{1} << 30;
+    check(small_group.model_shift(mid_size) == 0,
+          "two members need no pipeline, so they use the largest blocks");
+    check(large_group.model_shift(mid_size) > 0,
+          "16 members use smaller blocks for a 4 MB message");
+    check(large_group.model_shift(huge_size) < large_group.model_shift(mid_size),
+          "16 members use larger blocks for a 1 GB message than for a 4 MB message");
+    check(large_group.get_block_size(large_group.model_shift(1)) >= block_size_selector::min_block_size,
+          "blocks are never smaller than the minimum block size");
+    const size_t too_many_blocks = large_group.max_blocks() * (max_block_size >> 4) + 1;
+    check((too_many_blocks - 1) / large_group.get_block_size(large_group.model_shift(too_many_blocks)) + 1
+                  <= large_group.max_blocks(),
+          "no message has more blocks than the immediate can count");
+
+    // A simulated network where 64 KB blocks (shift 4) are fastest, and every
+    // step away from them costs 20% of the throughput
+    const uint32_t fastest_shift = 4;
+    block_size_selector tuner(block_size_policy::AUTO_TUNE, max_block_size, block_overhead_bytes, 1, 0);
+    uint32_t shift = 0;
+    for(int message = 0; message < 2000; ++message) {
+        shift = tuner.choose_shift(mid_size);
+        const double bytes_per_ns = 10.0 * std::pow(0.8, std::abs((int)shift - (int)fastest_shift));
+        tuner.record_transfer(mid_size, shift, std::chrono::nanoseconds((int64_t)(mid_size / bytes_per_ns)));
+    }
+    int fastest_choices = 0;
+    for(int message = 0; message < 64; ++message) {
+        fastest_choices += tuner.choose_shift(mid_size) == fastest_shift;
+    }
+    check(fastest_choices >= 56, "auto-tuning settles on the fastest block size");
+
+    if(failures == 0) {
+        cout << "All block size checks passed" << endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
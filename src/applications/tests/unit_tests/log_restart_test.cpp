@@ -5,9 +5,13 @@
  * persistent logs on disk. It will create a group with one persistent subgroup
  * and one non-persistent subgroup, with the persistent subgroup split into a
  * configurable number of shards, and have the persistent subgroup make many
- * random changes to each shard's state.
+ * random changes to each shard's state. It also reports how long it took to
+ * construct the Group, which after a total crash is the time taken by the
+ * restart protocol (collecting logs, truncating them, and sending log tails
+ * to nodes that are behind), so it can be used as a restart benchmark.
  */
 
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <random>
@@ -70,28 +74,35 @@ constexpr int fault_tolerance = 1;
 //Number of nodes in the non-persistent subgroup, which has no state to recover
 constexpr int non_persistent_subgroup_size = 2;
 
-//Number of updates each member of a persistent shard will multicast to the others
-constexpr int num_persistent_updates = 100000;
-//Number of updates each member of the non-persistent shard will multicast to the others
-constexpr int num_volatile_updates = 100000;
+//Default number of updates each member of a shard will multicast to the others
+constexpr int default_num_updates = 100000;
 
 /*
  * Command-line arguments:
  * 1. total number of nodes in this test
  * 2. nodes per shard of the persistent subgroup
+ * 3. (optional) number of updates each member will send, which determines how
+ *    long the persistent logs will be when the group is restarted
  */
 int main(int argc, char** argv) {
     pthread_setname_np(pthread_self(), "restart");
     std::mt19937 random_generator(getpid());
-    int num_args = 2;
-    if(argc < (num_args + 1) || (argc > (num_args + 1) && strcmp("--", argv[argc - (num_args + 1)]))) {
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+    if(argc < dashdash_pos + 3) {
         std::cout << "Invalid command line arguments." << std::endl;
-        std::cout << "USAGE:" << argv[0] << "[ derecho-config-list -- ] total_nodes members_per_persistent_shard" << std::endl;
+        std::cout << "USAGE:" << argv[0] << "[ derecho-config-list -- ] total_nodes members_per_persistent_shard [num_updates]" << std::endl;
         return -1;
     }
 
-    const uint num_nodes = std::stoi(argv[argc - num_args]);
-    const uint members_per_shard = std::stoi(argv[argc - num_args + 1]);
+    const uint num_nodes = std::stoi(argv[dashdash_pos + 1]);
+    const uint members_per_shard = std::stoi(argv[dashdash_pos + 2]);
+    const int num_updates = argc > dashdash_pos + 3 ? std::stoi(argv[dashdash_pos + 3]) : default_num_updates;
     if(num_nodes < members_per_shard + non_persistent_subgroup_size) {
         std::cout << "Must have at least " << (members_per_shard + non_persistent_subgroup_size)
                   << " members" << std::endl;
@@ -119,9 +130,14 @@ int main(int argc, char** argv) {
         return std::make_unique<NonPersistentThing>(0);
     };
 
+    auto group_start_time = std::chrono::steady_clock::now();
     derecho::Group<PersistentThing, NonPersistentThing> group(subgroup_info,
                                                               persistent_factory,
                                                               nonpersistent_factory);
+    auto group_end_time = std::chrono::steady_clock::now();
+    std::cout << "Constructed Group in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(group_end_time - group_start_time).count()
+              << " ms" << std::endl;
     if(group.get_my_rank() == -1) {
         std::cout << "Error joining group! My rank is -1" << std::endl;
         return 1;
@@ -133,7 +149,7 @@ int main(int argc, char** argv) {
         //"Main" code for the members of PersistentThing shards
         std::cout << "In the PersistentThing subgroup" << std::endl;
         Replicated<PersistentThing>& persistent_handle = group.get_subgroup<PersistentThing>();
-        for(int counter = 0; counter < num_persistent_updates; ++counter) {
+        for(int counter = 0; counter < num_updates; ++counter) {
             derecho::rpc::QueryResults<int> results = persistent_handle.ordered_send<RPC_NAME(read_state)>();
             derecho::rpc::QueryResults<int>::ReplyMap& replies = results.get();
             for(auto& reply_pair : replies) {
@@ -153,7 +169,7 @@ int main(int argc, char** argv) {
         //"Main" code for the members of the NonPersistentThing subgroup
         std::cout << "In the NonPersistentThing subgroup" << std::endl;
         Replicated<NonPersistentThing>& thing_handle = group.get_subgroup<NonPersistentThing>();
-        for(int counter = 0; counter < num_volatile_updates; ++counter) {
+        for(int counter = 0; counter < num_updates; ++counter) {
             derecho::rpc::QueryResults<int> results = thing_handle.ordered_send<RPC_NAME(read_state)>();
             derecho::rpc::QueryResults<int>::ReplyMap& replies = results.get();
             for(auto& reply_pair : replies) {
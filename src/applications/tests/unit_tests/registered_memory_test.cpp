@@ -0,0 +1,86 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/detail/registered_memory.hpp>
+
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using std::cout;
+using std::endl;
+
+/**
+ * Checks the page policy of the registered memory allocator with 2 MB huge
+ * pages configured: small buffers skip the reserved huge pages, large ones
+ * either get them or fall back to transparent huge pages and count the
+ * fallback, and the live-allocation tracking used by the registration cache
+ * follows each buffer until it is freed. The machine doesn't need any huge
+ * pages reserved; without them the large buffers test the fallback.
+ */
+int main(int argc, char** argv) {
+    char program_name[] = "registered_memory_test";
+    char pages_option[] = "--DERECHO/registered_memory_pages=2mb";
+    char numa_option[] = "--DERECHO/registered_memory_numa_node=none";
+    char* conf_argv[] = {program_name, pages_option, numa_option, nullptr};
+    derecho::Conf::initialize(3, conf_argv);
+
+    int failures = 0;
+    auto check = [&](bool condition, const std::string& description) {
+        if(!condition) {
+            cout << "FAILED: " << description << endl;
+            failures++;
+        }
+    };
+    const std::size_t page_size = sysconf(_SC_PAGESIZE);
+    const std::size_t huge_page_size = 2 << 20;
+
+    check(derecho::allocate_registered_memory(0) == nullptr, "a zero-byte allocation is empty");
+
+    const derecho::registered_memory_statistics before = derecho::get_registered_memory_statistics();
+    auto small = derecho::allocate_registered_memory(page_size);
+    derecho::registered_memory_statistics after = derecho::get_registered_memory_statistics();
+    check(after.huge_page_bytes == before.huge_page_bytes && after.huge_page_fallbacks == before.huge_page_fallbacks,
+          "a buffer smaller than half a huge page does not use explicit huge pages");
+    check(after.normal_page_bytes == before.normal_page_bytes + page_size,
+          "a buffer smaller than a transparent huge page uses normal pages");
+    check(after.bytes_in_use == before.bytes_in_use + page_size, "a small buffer is rounded up to one page");
+    check(derecho::is_registered_memory(small.get(), page_size), "a small buffer is registered memory");
+    check(!derecho::is_registered_memory(small.get(), page_size + 1),
+          "a range that runs past the end of a buffer is not registered memory");
+
+    // Half a huge page is the smallest buffer that is given a whole huge page
+    for(const std::size_t size : {huge_page_size / 2, huge_page_size + huge_page_size / 2}) {
+        const derecho::registered_memory_statistics before_large = derecho::get_registered_memory_statistics();
+        auto large = derecho::allocate_registered_memory(size);
+        const derecho::registered_memory_statistics after_large = derecho::get_registered_memory_statistics();
+        const uint64_t rounded_size = (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+        const bool got_huge_pages = after_large.huge_page_bytes == before_large.huge_page_bytes + rounded_size;
+        const bool fell_back = after_large.huge_page_fallbacks == before_large.huge_page_fallbacks + 1
+                               && after_large.huge_page_bytes == before_large.huge_page_bytes;
+        check(got_huge_pages != fell_back,
+              "a " + std::to_string(size) + "-byte buffer either gets huge pages or counts one fallback");
+        if(fell_back) {
+            check(after_large.transparent_huge_page_bytes + after_large.normal_page_bytes
+                          == before_large.transparent_huge_page_bytes + before_large.normal_page_bytes + size,
+                  "a buffer that falls back is mapped with page-sized rounding instead");
+        }
+        check(large[0] == 0 && large[size - 1] == 0, "registered memory is zeroed");
+        large[size - 1] = 1;
+        check(derecho::is_registered_memory(large.get() + 100, size - 100),
+              "a range inside a large buffer is registered memory");
+        uint8_t* const freed_address = large.get();
+        large.reset();
+        check(!derecho::is_registered_memory(freed_address, 1), "a freed buffer is no longer registered memory");
+    }
+
+    small.reset();
+    after = derecho::get_registered_memory_statistics();
+    check(after.bytes_in_use == before.bytes_in_use, "freeing every buffer releases all the bytes in use");
+    check(after.allocations == before.allocations + 3, "every nonempty buffer counts as an allocation");
+    uint8_t stack_buffer[16];
+    check(!derecho::is_registered_memory(stack_buffer, sizeof(stack_buffer)), "stack memory is not registered memory");
+
+    if(failures == 0) {
+        cout << "All registered memory checks passed" << endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
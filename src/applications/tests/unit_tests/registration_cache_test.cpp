@@ -0,0 +1,77 @@
+#include <derecho/utils/registration_cache.hpp>
+
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using std::cout;
+using std::endl;
+
+/**
+ * Checks the registration cache with a fake register function that counts
+ * registrations and deregistrations: buffers inside a cached registration
+ * hit, unused registrations are evicted least recently used first, and
+ * unmapping memory removes its registrations without pulling them out from
+ * under anyone still holding them.
+ */
+int main(int argc, char** argv) {
+    int failures = 0;
+    auto check = [&](bool condition, const std::string& description) {
+        if(!condition) {
+            cout << "FAILED: " << description << endl;
+            failures++;
+        }
+    };
+    int num_registered = 0;
+    int num_deregistered = 0;
+    derecho::registration_cache cache(2, [&](void* start, std::size_t length) {
+        num_registered++;
+        return derecho::registration_cache::registration_t(start, [&](void*) { num_deregistered++; });
+    });
+
+    const std::size_t page_size = getpagesize();
+    const std::size_t mapping_size = 16 * page_size;
+    uint8_t* mapping = static_cast<uint8_t*>(mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE,
+                                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if(mapping == MAP_FAILED) {
+        cout << "FAILED: could not map memory" << endl;
+        return 1;
+    }
+
+    auto first = cache.acquire(mapping + 100, 1000);
+    auto same_page = cache.acquire(mapping + 2000, 50);
+    check(first == same_page && num_registered == 1,
+          "a buffer on a page that is already registered hits");
+    first.reset();
+    same_page.reset();
+    check(num_deregistered == 0, "an unused registration stays cached");
+
+    auto second = cache.acquire(mapping + 4 * page_size, 10);
+    auto third = cache.acquire(mapping + 8 * page_size, 10);
+    check(num_registered == 3 && num_deregistered == 1,
+          "the least recently used registration is evicted once the cache is full");
+    auto fourth = cache.acquire(mapping + 12 * page_size, 10);
+    check(num_deregistered == 1, "registrations in use are not evicted");
+
+    munmap(mapping + 4 * page_size, 12 * page_size);
+    check(num_deregistered == 1, "unmapping memory leaves registrations in use alive");
+    second.reset();
+    third.reset();
+    fourth.reset();
+    check(num_deregistered == 4, "invalidated registrations are deregistered when released");
+    auto stats = cache.get_statistics();
+    check(stats.hits == 1 && stats.misses == 4 && stats.evictions == 1 && stats.invalidations == 3,
+          "the statistics count every hit, miss, eviction and invalidation");
+
+    auto again = cache.acquire(mapping, 10);
+    check(num_registered == 5, "a registration invalidated or evicted earlier is registered again");
+    again.reset();
+    munmap(mapping, 4 * page_size);
+    check(num_deregistered == 5, "unmapping memory deregisters unused registrations at once");
+
+    if(failures == 0) {
+        cout << "All registration cache checks passed" << endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -64,11 +64,26 @@ public:
     std::map<uint32_t, uint64_t> get_map() const {
         return map_state;
     }
+    // With enough entries, the argument and the return value are larger than a P2P message buffer
+    uint64_t sum_values(const std::map<uint32_t, uint64_t>& other_map) const {
+        uint64_t sum = 0;
+        for(const auto& entry : other_map) {
+            sum += entry.second;
+        }
+        return sum;
+    }
+    std::map<uint32_t, uint64_t> make_map(const uint32_t& num_entries) const {
+        std::map<uint32_t, uint64_t> new_map;
+        for(uint32_t i = 0; i < num_entries; ++i) {
+            new_map.emplace(i, i);
+        }
+        return new_map;
+    }
 
     MapTest(const std::map<uint32_t, uint64_t>& initial_map = {}) : map_state(initial_map) {}
 
     DEFAULT_SERIALIZATION_SUPPORT(MapTest, map_state);
-    REGISTER_RPC_FUNCTIONS(MapTest, P2P_TARGETS(get, get_map), ORDERED_TARGETS(put, get, set_map, get_map))
+    REGISTER_RPC_FUNCTIONS(MapTest, P2P_TARGETS(get, get_map, sum_values, make_map), ORDERED_TARGETS(put, get, set_map, get_map))
 };
 
 using derecho::flexible_even_shards;
@@ -139,5 +154,33 @@ int main(int argc, char** argv) {
         map_state.emplace(64, 128);
         map_state.emplace(65536, 1024);
         map_test.ordered_send<RPC_NAME(set_map)>(map_state);
+
+        // P2P requests and replies larger than the P2P buffers should be sent out-of-band
+        const uint32_t large_map_entries = derecho::getConfUInt64(derecho::Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE);
+        const std::vector<node_id_t> map_test_group_members = group.get_subgroup_members<MapTest>()[0];
+        node_id_t p2p_target = map_test_group_members.front();
+        for(const node_id_t member : map_test_group_members) {
+            if(member != static_cast<node_id_t>(my_id)) {
+                p2p_target = member;
+                break;
+            }
+        }
+        derecho::rpc::QueryResults<std::map<uint32_t, uint64_t>> large_reply_results
+                = map_test.p2p_send<RPC_NAME(make_map)>(p2p_target, large_map_entries);
+        std::map<uint32_t, uint64_t> large_map = large_reply_results.get().get(p2p_target);
+        std::cout << "Received a map with " << large_map.size() << " entries from node " << p2p_target << std::endl;
+        if(large_map.size() != large_map_entries) {
+            std::cerr << "FAILED: expected a map with " << large_map_entries << " entries" << std::endl;
+            return 1;
+        }
+        derecho::rpc::QueryResults<uint64_t> large_request_results
+                = map_test.p2p_send<RPC_NAME(sum_values)>(p2p_target, large_map);
+        const uint64_t expected_sum = static_cast<uint64_t>(large_map_entries) * (large_map_entries - 1) / 2;
+        const uint64_t large_map_sum = large_request_results.get().get(p2p_target);
+        std::cout << "Sum of the map computed by node " << p2p_target << " was " << large_map_sum << std::endl;
+        if(large_map_sum != expected_sum) {
+            std::cerr << "FAILED: expected a sum of " << expected_sum << std::endl;
+            return 1;
+        }
     }
 }
@@ -4,6 +4,8 @@
  * @date Nov 16, 2018
  * @author edward
  */
+#include <atomic>
+#include <future>
 #include <iostream>
 #include <string>
 
@@ -77,4 +79,24 @@ int main(int argc, char** argv) {
         }
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     }
+
+    //Send a batch of reads without waiting for any of them, and collect the replies with callbacks
+    const int pipelined_reads = 100;
+    std::atomic<int> replies_received = 0;
+    std::atomic<int> calls_completed = 0;
+    std::promise<void> all_calls_completed;
+    for(int i = 0; i < pipelined_reads; ++i) {
+        QueryResults<std::string> print_results = rpc_handle.ordered_send<RPC_NAME(print)>();
+        print_results.on_reply([&](const node_id_t& node, ReplyFuture<std::string>& reply) {
+            reply.get();
+            replies_received++;
+        });
+        print_results.then([&](QueryResults<std::string>&) {
+            if(++calls_completed == pipelined_reads) {
+                all_calls_completed.set_value();
+            }
+        });
+    }
+    all_calls_completed.get_future().wait();
+    std::cout << "Received " << replies_received << " replies to " << pipelined_reads << " pipelined print() calls" << std::endl;
 }
@@ -0,0 +1,137 @@
+#include <derecho/rdmc/detail/schedule.hpp>
+
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::cout;
+using std::endl;
+
+using schedule_factory = std::function<std::unique_ptr<schedule>(uint32_t member_index)>;
+
+/**
+ * Checks that a schedule delivers every block of a message to every member,
+ * by playing out the transfers the way polling_group does: each member sends
+ * in the order of its outgoing steps as soon as it has the block, and each
+ * link delivers blocks in the order the receiver posted receives for them.
+ * @return An empty string if the schedule is correct, or a description of
+ * the first problem found
+ */
+std::string check_schedule(uint32_t num_members, size_t num_blocks, const schedule_factory& make_schedule) {
+    std::vector<std::unique_ptr<schedule>> schedules;
+    for(uint32_t member = 0; member < num_members; ++member) {
+        schedules.emplace_back(make_schedule(member));
+    }
+    // The blocks each member expects from each neighbor, in the order it posts receives
+    std::vector<std::map<uint32_t, std::deque<size_t>>> expected(num_members);
+    std::vector<std::vector<bool>> has_block(num_members, std::vector<bool>(num_blocks, false));
+    for(uint32_t member = 1; member < num_members; ++member) {
+        auto first = schedules[member]->get_first_block(num_blocks);
+        if(!first) {
+            return "member " + std::to_string(member) + " has no first block";
+        }
+        size_t first_block = std::min(first->block_number, num_blocks - 1);
+        expected[member][first->target].push_back(first_block);
+        for(size_t step = 0; step < schedules[member]->get_total_steps(num_blocks); ++step) {
+            auto transfer = schedules[member]->get_incoming_transfer(num_blocks, step);
+            if(transfer && transfer->block_number != first_block) {
+                expected[member][transfer->target].push_back(transfer->block_number);
+            }
+        }
+    }
+    for(size_t block = 0; block < num_blocks; ++block) {
+        has_block[0][block] = true;
+    }
+
+    std::vector<size_t> send_step(num_members, 0);
+    bool progress = true;
+    while(progress) {
+        progress = false;
+        for(uint32_t member = 0; member < num_members; ++member) {
+            while(send_step[member] < schedules[member]->get_total_steps(num_blocks)) {
+                auto transfer = schedules[member]->get_outgoing_transfer(num_blocks, send_step[member]);
+                if(transfer) {
+                    if(!has_block[member][transfer->block_number]) break;
+                    auto& queue = expected[transfer->target][member];
+                    if(queue.empty() || queue.front() != transfer->block_number) {
+                        return "member " + std::to_string(member) + " sent block "
+                               + std::to_string(transfer->block_number) + " to member "
+                               + std::to_string(transfer->target) + ", which did not expect it";
+                    }
+                    queue.pop_front();
+                    if(has_block[transfer->target][transfer->block_number]) {
+                        return "member " + std::to_string(transfer->target) + " received block "
+                               + std::to_string(transfer->block_number) + " twice";
+                    }
+                    has_block[transfer->target][transfer->block_number] = true;
+                }
+                send_step[member]++;
+                progress = true;
+            }
+        }
+    }
+    for(uint32_t member = 0; member < num_members; ++member) {
+        if(send_step[member] < schedules[member]->get_total_steps(num_blocks)) {
+            return "member " + std::to_string(member) + " is stuck at step " + std::to_string(send_step[member]);
+        }
+        for(size_t block = 0; block < num_blocks; ++block) {
+            if(!has_block[member][block]) {
+                return "member " + std::to_string(member) + " never received block " + std::to_string(block);
+            }
+        }
+    }
+    return "";
+}
+
+/**
+ * Checks the RDMC schedules against every group size up to 20 members and a
+ * range of message sizes, including hierarchical schedules over several
+ * arrangements of members into racks.
+ */
+int main(int argc, char** argv) {
+    int failures = 0;
+    auto check = [&](const std::string& name, uint32_t num_members, size_t num_blocks, const schedule_factory& make_schedule) {
+        std::string error = check_schedule(num_members, num_blocks, make_schedule);
+        if(!error.empty()) {
+            cout << "FAILED: " << name << " with " << num_members << " members and "
+                 << num_blocks << " blocks: " << error << endl;
+            failures++;
+        }
+    };
+    for(uint32_t num_members = 2; num_members <= 20; ++num_members) {
+        for(size_t num_blocks : {1, 2, 3, 7, 16, 100}) {
+            check("binomial_schedule", num_members, num_blocks, [&](uint32_t index) {
+                return std::make_unique<binomial_schedule>(num_members, index);
+            });
+            check("chain_schedule", num_members, num_blocks, [&](uint32_t index) {
+                return std::make_unique<chain_schedule>(num_members, index);
+            });
+            // Racks of 1, 3 and 4 members, assigned in blocks and round-robin
+            for(uint32_t rack_size : {1, 3, 4}) {
+                std::vector<uint32_t> blocked_racks;
+                std::vector<uint32_t> interleaved_racks;
+                const uint32_t num_racks = (num_members + rack_size - 1) / rack_size;
+                for(uint32_t member = 0; member < num_members; ++member) {
+                    blocked_racks.push_back(member / rack_size);
+                    interleaved_racks.push_back(member % num_racks);
+                }
+                check("hierarchical_schedule (racks of " + std::to_string(rack_size) + ")",
+                      num_members, num_blocks, [&](uint32_t index) {
+                          return std::make_unique<hierarchical_schedule>(blocked_racks, index);
+                      });
+                check("hierarchical_schedule (" + std::to_string(num_racks) + " interleaved racks)",
+                      num_members, num_blocks, [&](uint32_t index) {
+                          return std::make_unique<hierarchical_schedule>(interleaved_racks, index);
+                      });
+            }
+        }
+    }
+    if(failures == 0) {
+        cout << "All schedules delivered every block" << endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
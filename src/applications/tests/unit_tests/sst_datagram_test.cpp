@@ -0,0 +1,231 @@
+#include <derecho/sst/multicast.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using std::cout;
+using std::endl;
+
+/**
+ * Stands in for the SST of one of several members simulated in this process,
+ * with only the fields sst::multicast_group uses. put() copies part of the
+ * local row into the other members' tables, like an RDMA write that has
+ * completed by the time it returns.
+ */
+class simulated_sst {
+public:
+    template <typename T>
+    class field {
+        simulated_sst* const table;
+        const std::size_t offset;
+        const std::size_t length;
+
+    public:
+        field(simulated_sst* table, std::size_t offset, std::size_t length)
+                : table(table), offset(offset), length(length) {}
+        volatile T* operator[](uint32_t row) const {
+            return reinterpret_cast<volatile T*>(table->rows.data() + row * table->row_length + offset);
+        }
+        std::size_t size() const { return length; }
+    };
+
+private:
+    const std::vector<simulated_sst*>& members;
+    const uint32_t my_row;
+    const std::size_t row_length;
+    std::vector<uint8_t> rows;
+
+public:
+    field<uint8_t> slots;
+    field<int32_t> num_received_sst;
+    field<int32_t> index;
+
+    simulated_sst(const std::vector<simulated_sst*>& members, uint32_t num_rows, uint32_t my_row, std::size_t slots_size)
+            : members(members),
+              my_row(my_row),
+              row_length(slots_size + 2 * sizeof(int32_t)),
+              rows(num_rows * row_length, 0),
+              slots(this, 0, slots_size),
+              num_received_sst(this, slots_size, 1),
+              index(this, slots_size + sizeof(int32_t), 1) {
+        // As initialized by MulticastGroup, before any message is sent
+        for(uint32_t row = 0; row < num_rows; ++row) {
+            index[row][0] = -1;
+        }
+    }
+
+    uint32_t get_local_index() const { return my_row; }
+    bool is_row_frozen(uint32_t row) const { return false; }
+    const uint8_t* getBaseAddress() { return rows.data(); }
+
+    void put(const std::vector<uint32_t>& receiver_rows, std::size_t offset, std::size_t size) {
+        for(uint32_t row : receiver_rows) {
+            if(row != my_row) {
+                memcpy(members[row]->rows.data() + my_row * row_length + offset,
+                       rows.data() + my_row * row_length + offset, size);
+            }
+        }
+    }
+    void put(std::size_t offset, std::size_t size) {
+        std::vector<uint32_t> all_rows;
+        for(uint32_t row = 0; row < members.size(); ++row) {
+            all_rows.push_back(row);
+        }
+        put(all_rows, offset, size);
+    }
+    template <typename T>
+    void put(field<T>& vec_field, std::size_t index) {
+        put(const_cast<uint8_t*>(reinterpret_cast<volatile uint8_t*>(std::addressof(vec_field[0][index])))
+                    - getBaseAddress(),
+            sizeof(T));
+    }
+    void put_with_completion(const std::vector<uint32_t>& receiver_rows, std::size_t offset, std::size_t size) {
+        put(receiver_rows, offset, size);
+    }
+};
+
+constexpr uint32_t num_members = 3;
+constexpr uint32_t window_size = 8;
+constexpr uint64_t max_msg_size = 200;
+// The SST adds the message size to the end of each slot
+constexpr uint64_t slot_size = max_msg_size + sizeof(uint64_t);
+
+/**
+ * Checks the datagram transport of SST multicast with one sender and two
+ * receivers over loopback IP multicast. One receiver belongs to another
+ * deployment, so it discards every datagram as if it had been lost. Checks
+ * that messages are written over RDMA until datagrams are enabled, that the
+ * lost datagrams are repaired over RDMA, and that a batch too large for a
+ * datagram falls back to RDMA without skipping a message that was lost just
+ * before it.
+ */
+int main(int argc, char** argv) {
+    std::vector<simulated_sst*> members;
+    std::vector<std::shared_ptr<simulated_sst>> tables;
+    for(uint32_t row = 0; row < num_members; ++row) {
+        tables.push_back(std::make_shared<simulated_sst>(members, num_members, row, window_size * slot_size));
+        members.push_back(tables.back().get());
+    }
+    sst::datagram_settings settings;
+    settings.group_address = "239.255.42.250";
+    settings.port = 40000 + getpid() % 10000;
+    settings.interface_address = "127.0.0.1";
+    settings.max_datagram_size = 512;
+    settings.repair_timeout = std::chrono::milliseconds(20);
+    settings.session_id = 1;
+    settings.deployment_id = 1;
+    sst::datagram_settings other_deployment_settings = settings;
+    other_deployment_settings.deployment_id = 2;
+
+    std::vector<std::unique_ptr<sst::multicast_group<simulated_sst>>> groups;
+    try {
+        for(uint32_t row = 0; row < num_members; ++row) {
+            groups.push_back(std::make_unique<sst::multicast_group<simulated_sst>>(
+                    tables[row], std::vector<uint32_t>{0, 1, 2}, window_size, max_msg_size,
+                    std::vector<int>{1, 0, 0}, 0, 0, 0, row == 2 ? other_deployment_settings : settings));
+        }
+    } catch(const std::exception& e) {
+        cout << "FAILED: could not join the multicast group on the loopback interface: " << e.what() << endl;
+        return 1;
+    }
+    sst::multicast_group<simulated_sst>& sender = *groups[0];
+
+    int failures = 0;
+    auto check = [&](bool condition, const std::string& description) {
+        if(!condition) {
+            cout << "FAILED: " << description << endl;
+            failures++;
+        }
+    };
+    // Like the receive predicate, acknowledges every message each member has, including the sender
+    auto acknowledge = [&]() {
+        for(uint32_t row = 0; row < num_members; ++row) {
+            members[row]->num_received_sst[row][0] = members[row]->index[0][0];
+            members[row]->put(members[row]->num_received_sst, 0);
+        }
+    };
+    auto received_index = [&](uint32_t row) -> int32_t {
+        return __atomic_load_n(members[row]->index[0], __ATOMIC_ACQUIRE);
+    };
+    auto wait_for = [&](const std::function<bool()>& condition, bool repair) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while(!condition() && std::chrono::steady_clock::now() < deadline) {
+            acknowledge();
+            if(repair) {
+                sender.repair_datagram_losses();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        acknowledge();
+        return condition();
+    };
+    // Message i is filled with the byte i + 1 and has size length(i)
+    auto length = [](int32_t index) -> uint64_t { return index < 5 ? 10 + index : max_msg_size; };
+    auto send_batch = [&](int32_t first_index, uint32_t count) {
+        for(int32_t index = first_index; index < first_index + static_cast<int32_t>(count); ++index) {
+            volatile uint8_t* buffer = sender.get_buffer(length(index));
+            check(buffer != nullptr, "the window has room for message " + std::to_string(index));
+            if(buffer) {
+                memset(const_cast<uint8_t*>(buffer), index + 1, length(index));
+            }
+        }
+        sender.send(sender.commit_send(count), count);
+    };
+    auto has_messages = [&](uint32_t row, int32_t first_index, int32_t last_index) {
+        for(int32_t index = first_index; index <= last_index; ++index) {
+            const uint64_t slot_start = (index % window_size) * slot_size;
+            if((uint64_t&)members[row]->slots[0][slot_start + slot_size - sizeof(uint64_t)] != length(index)) {
+                return false;
+            }
+            for(uint64_t byte = 0; byte < length(index); ++byte) {
+                if(members[row]->slots[0][slot_start + byte] != index + 1) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    check(sender.has_datagram_transport() && groups[2]->has_datagram_transport(), "every member joined the multicast group");
+
+    // Until the members agree that datagrams work, messages are written over RDMA
+    send_batch(0, 1);
+    check(received_index(1) == 0 && received_index(2) == 0, "a message sent before enabling datagrams is written to every member");
+    check(has_messages(1, 0, 0) && has_messages(2, 0, 0), "the message written before enabling datagrams is intact");
+    acknowledge();
+
+    sender.enable_datagram_sending();
+    for(int32_t index = 1; index <= 3; ++index) {
+        send_batch(index, 1);
+    }
+    check(wait_for([&]() { return received_index(1) == 3; }, false),
+          "a member of the same deployment receives the datagrams");
+    check(has_messages(1, 1, 3), "the messages received as datagrams are intact");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(received_index(2) == 0, "a member of another deployment ignores the datagrams");
+
+    check(wait_for([&]() { return received_index(2) == 3; }, true),
+          "the messages another member lost are repaired over RDMA");
+    check(has_messages(2, 1, 3), "the repaired messages are intact");
+
+    // Message 4 is lost by member 2, then 5 to 7 don't fit in a datagram
+    send_batch(4, 1);
+    send_batch(5, 3);
+    check(received_index(2) == 7, "a batch too large for a datagram is written over RDMA");
+    check(has_messages(2, 4, 7), "falling back to RDMA also writes the message lost just before");
+    check(wait_for([&]() { return received_index(1) == 7; }, false) && has_messages(1, 4, 7),
+          "the other member receives both the datagram and the RDMA fallback");
+
+    groups.clear();
+    if(failures == 0) {
+        cout << "All SST datagram checks passed" << endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
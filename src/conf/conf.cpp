@@ -44,13 +44,39 @@ struct option Conf::long_options[] = {
         MAKE_LONG_OPT_ENTRY(DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS),
         MAKE_LONG_OPT_ENTRY(DERECHO_HEARTBEAT_MS),
         MAKE_LONG_OPT_ENTRY(DERECHO_SST_POLL_CQ_TIMEOUT_MS),
+        MAKE_LONG_OPT_ENTRY(DERECHO_COMPLETION_WAIT_STRATEGY),
+        MAKE_LONG_OPT_ENTRY(DERECHO_COMPLETION_SPIN_US),
+        MAKE_LONG_OPT_ENTRY(DERECHO_SHARED_COMPLETION_POLLER),
+        MAKE_LONG_OPT_ENTRY(DERECHO_SST_POLLER_CPU),
+        MAKE_LONG_OPT_ENTRY(DERECHO_RDMC_POLLER_CPU),
+        MAKE_LONG_OPT_ENTRY(DERECHO_RDMC_PIPELINE_DEPTH),
+        MAKE_LONG_OPT_ENTRY(DERECHO_RDMC_RACK_MAP),
+        MAKE_LONG_OPT_ENTRY(DERECHO_RDMC_RACK_UPLINK_CAPACITY),
+        MAKE_LONG_OPT_ENTRY(DERECHO_RDMC_BLOCK_SIZE_POLICY),
+        MAKE_LONG_OPT_ENTRY(DERECHO_RDMC_BLOCK_OVERHEAD_BYTES),
+        MAKE_LONG_OPT_ENTRY(DERECHO_REGISTRATION_CACHE_ENTRIES),
+        MAKE_LONG_OPT_ENTRY(DERECHO_REGISTERED_MEMORY_PAGES),
+        MAKE_LONG_OPT_ENTRY(DERECHO_REGISTERED_MEMORY_NUMA_NODE),
+        MAKE_LONG_OPT_ENTRY(DERECHO_SMC_DATAGRAM_MULTICAST),
+        MAKE_LONG_OPT_ENTRY(DERECHO_SMC_DATAGRAM_GROUP),
+        MAKE_LONG_OPT_ENTRY(DERECHO_SMC_DATAGRAM_PORT),
+        MAKE_LONG_OPT_ENTRY(DERECHO_SMC_DATAGRAM_MAX_SIZE),
+        MAKE_LONG_OPT_ENTRY(DERECHO_SMC_DATAGRAM_REPAIR_MS),
+        MAKE_LONG_OPT_ENTRY(DERECHO_SMC_DATAGRAM_DEPLOYMENT_ID),
         MAKE_LONG_OPT_ENTRY(DERECHO_RESTART_TIMEOUT_MS),
+        MAKE_LONG_OPT_ENTRY(DERECHO_CONTROL_PLANE_TIMEOUT_MS),
         MAKE_LONG_OPT_ENTRY(DERECHO_ENABLE_BACKUP_RESTART_LEADERS),
         MAKE_LONG_OPT_ENTRY(DERECHO_DISABLE_PARTITIONING_SAFETY),
         MAKE_LONG_OPT_ENTRY(DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE),
         MAKE_LONG_OPT_ENTRY(DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE),
         MAKE_LONG_OPT_ENTRY(DERECHO_P2P_WINDOW_SIZE),
+        MAKE_LONG_OPT_ENTRY(DERECHO_P2P_OVERFLOW_QUEUE_SIZE),
+        MAKE_LONG_OPT_ENTRY(DERECHO_EXTERNAL_P2P_WINDOW_SIZE),
+        MAKE_LONG_OPT_ENTRY(DERECHO_MAX_EXTERNAL_P2P_PAYLOAD_SIZE),
+        MAKE_LONG_OPT_ENTRY(DERECHO_EXTERNAL_PREWARM_CONNECTIONS),
         MAKE_LONG_OPT_ENTRY(DERECHO_MAX_NODE_ID),
+        MAKE_LONG_OPT_ENTRY(DERECHO_STATE_TRANSFER_CHUNK_SIZE),
+        MAKE_LONG_OPT_ENTRY(DERECHO_INCREMENTAL_STATE_TRANSFER),
         MAKE_LONG_OPT_ENTRY(LAYOUT_JSON_LAYOUT),
         MAKE_LONG_OPT_ENTRY(LAYOUT_JSON_LAYOUT_FILE),
         // [SUBGROUP/<subgroup name>]
@@ -65,6 +91,8 @@ struct option Conf::long_options[] = {
         MAKE_LONG_OPT_ENTRY(RDMA_DOMAIN),
         MAKE_LONG_OPT_ENTRY(RDMA_TX_DEPTH),
         MAKE_LONG_OPT_ENTRY(RDMA_RX_DEPTH),
+        MAKE_LONG_OPT_ENTRY(RDMA_DOMAINS),
+        MAKE_LONG_OPT_ENTRY(RDMA_RAIL_WEIGHTS),
         // [PERS]
         MAKE_LONG_OPT_ENTRY(PERS_FILE_PATH),
         MAKE_LONG_OPT_ENTRY(PERS_RAMDISK_PATH),
@@ -0,0 +1,225 @@
+#include <derecho/core/detail/completion_poller.hpp>
+
+#include <derecho/conf/conf.hpp>
+#include <derecho/utils/logger.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace derecho {
+
+CompletionWaitStrategy parse_completion_wait_strategy(const std::string& name) {
+    if(name == "busy_spin") {
+        return CompletionWaitStrategy::BUSY_SPIN;
+    } else if(name == "spin_then_block") {
+        return CompletionWaitStrategy::SPIN_THEN_BLOCK;
+    } else if(name == "adaptive_backoff") {
+        return CompletionWaitStrategy::ADAPTIVE_BACKOFF;
+    }
+    throw std::invalid_argument("Unknown completion wait strategy: " + name);
+}
+
+CompletionPoller::CompletionPoller(const std::string& thread_name,
+                                   CompletionWaitStrategy wait_strategy,
+                                   std::chrono::nanoseconds spin_time,
+                                   int cpu)
+        : thread_name(thread_name),
+          wait_strategy(wait_strategy),
+          spin_time_ns(spin_time.count()),
+          cpu(cpu),
+          wakeup_fd(eventfd(0, EFD_NONBLOCK)),
+          epoll_fd(epoll_create1(0)),
+          thread_shutdown(false),
+          next_source_id(0),
+          changes_applied_count(0),
+          changes_pending(false),
+          sources_can_block(true) {
+    if(wakeup_fd < 0 || epoll_fd < 0) {
+        throw std::runtime_error("CompletionPoller: failed to create eventfd or epoll descriptor: "
+                                 + std::string(strerror(errno)));
+    }
+    struct epoll_event wakeup_event;
+    memset(&wakeup_event, 0, sizeof(wakeup_event));
+    wakeup_event.events = EPOLLIN;
+    wakeup_event.data.fd = wakeup_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &wakeup_event);
+    poll_thread = std::thread(&CompletionPoller::poll_loop, this);
+}
+
+CompletionPoller::~CompletionPoller() {
+    thread_shutdown = true;
+    wake_up();
+    if(poll_thread.joinable()) {
+        poll_thread.join();
+    }
+    close(epoll_fd);
+    close(wakeup_fd);
+}
+
+void CompletionPoller::wake_up() {
+    uint64_t wakeup = 1;
+    [[maybe_unused]] ssize_t ignored = ::write(wakeup_fd, &wakeup, sizeof(wakeup));
+}
+
+uint64_t CompletionPoller::add_source(CompletionSource source) {
+    std::unique_lock<std::mutex> lock(sources_mutex);
+    const uint64_t source_id = next_source_id++;
+    added_sources.emplace_back(source_id, std::move(source));
+    changes_pending = true;
+    wake_up();
+    return source_id;
+}
+
+void CompletionPoller::remove_source(uint64_t source_id) {
+    std::unique_lock<std::mutex> lock(sources_mutex);
+    removed_source_ids.push_back(source_id);
+    changes_pending = true;
+    wake_up();
+    // Wait for the thread to stop calling the source's callbacks
+    const uint64_t target_count = changes_applied_count + 1;
+    changes_applied_cv.wait(lock, [&]() {
+        return changes_applied_count >= target_count || thread_shutdown;
+    });
+}
+
+void CompletionPoller::set_spin_time(std::chrono::nanoseconds spin_time) {
+    spin_time_ns = spin_time.count();
+}
+
+void CompletionPoller::apply_source_changes() {
+    std::lock_guard<std::mutex> lock(sources_mutex);
+    for(auto& id_and_source : added_sources) {
+        if(id_and_source.second.wait_fd >= 0) {
+            struct epoll_event source_event;
+            memset(&source_event, 0, sizeof(source_event));
+            source_event.events = EPOLLIN;
+            source_event.data.fd = id_and_source.second.wait_fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, id_and_source.second.wait_fd, &source_event);
+        } else if(wait_strategy == CompletionWaitStrategy::SPIN_THEN_BLOCK) {
+            dbg_default_warn("Completion source {} has no wait descriptor, so poller {} will back off instead of blocking",
+                             id_and_source.second.name, thread_name);
+        }
+    }
+    active_sources.splice(active_sources.end(), added_sources);
+    for(uint64_t source_id : removed_source_ids) {
+        auto source_iter = std::find_if(active_sources.begin(), active_sources.end(),
+                                        [source_id](const auto& id_and_source) { return id_and_source.first == source_id; });
+        if(source_iter == active_sources.end()) {
+            continue;
+        }
+        if(source_iter->second.wait_fd >= 0) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, source_iter->second.wait_fd, nullptr);
+        }
+        active_sources.erase(source_iter);
+    }
+    removed_source_ids.clear();
+    sources_can_block = std::all_of(active_sources.begin(), active_sources.end(),
+                                    [](const auto& id_and_source) { return id_and_source.second.wait_fd >= 0; });
+    changes_pending = false;
+    changes_applied_count++;
+    changes_applied_cv.notify_all();
+}
+
+bool CompletionPoller::block_on_sources() {
+    for(auto& id_and_source : active_sources) {
+        if(id_and_source.second.prepare_to_block && !id_and_source.second.prepare_to_block()) {
+            return false;
+        }
+    }
+    constexpr int max_events = 8;
+    struct epoll_event events[max_events];
+    // The timeout is only a safety net in case a provider fails to signal its descriptor
+    int num_events = epoll_wait(epoll_fd, events, max_events, 50);
+    for(int i = 0; i < num_events; ++i) {
+        if(events[i].data.fd == wakeup_fd) {
+            uint64_t wakeups;
+            [[maybe_unused]] ssize_t ignored = ::read(wakeup_fd, &wakeups, sizeof(wakeups));
+        }
+    }
+    return true;
+}
+
+void CompletionPoller::poll_loop() {
+    pthread_setname_np(pthread_self(), thread_name.c_str());
+    if(cpu >= 0) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        if(pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+            dbg_default_warn("Failed to pin completion poller {} to CPU {}", thread_name, cpu);
+        }
+    }
+    constexpr auto max_backoff = std::chrono::milliseconds(1);
+    std::chrono::nanoseconds backoff(0);
+    // Idle polls are counted so the clock is read only once every 64 of them
+    uint32_t idle_polls = 0;
+    auto idle_start = std::chrono::steady_clock::now();
+    while(!thread_shutdown) {
+        if(changes_pending) {
+            apply_source_changes();
+        }
+        int num_completions = 0;
+        for(auto& id_and_source : active_sources) {
+            num_completions += id_and_source.second.poll_batch();
+        }
+        if(num_completions > 0) {
+            idle_polls = 0;
+            backoff = std::chrono::nanoseconds(0);
+            continue;
+        }
+        if(wait_strategy == CompletionWaitStrategy::BUSY_SPIN && !active_sources.empty()) {
+            continue;
+        }
+        if(idle_polls++ == 0) {
+            idle_start = std::chrono::steady_clock::now();
+            continue;
+        }
+        if(idle_polls % 64 != 0 && !active_sources.empty()) {
+            continue;
+        }
+        if(std::chrono::steady_clock::now() - idle_start < std::chrono::nanoseconds(spin_time_ns.load())
+           && !active_sources.empty()) {
+            continue;
+        }
+        if(wait_strategy != CompletionWaitStrategy::ADAPTIVE_BACKOFF && sources_can_block) {
+            // Poll right away after waking up, or if a source wasn't ready to block. The
+            // spin only starts over once completions arrive, so a timeout doesn't cause one.
+            block_on_sources();
+            continue;
+        }
+        backoff = std::min<std::chrono::nanoseconds>(std::max<std::chrono::nanoseconds>(backoff * 2, std::chrono::microseconds(1)),
+                                                     max_backoff);
+        std::this_thread::sleep_for(backoff);
+    }
+    // Let any thread waiting in remove_source return
+    std::lock_guard<std::mutex> lock(sources_mutex);
+    active_sources.clear();
+    changes_applied_cv.notify_all();
+}
+
+std::shared_ptr<CompletionPoller> get_completion_poller(const std::string& thread_name, int cpu) {
+    const CompletionWaitStrategy wait_strategy = parse_completion_wait_strategy(
+            getConfString(Conf::DERECHO_COMPLETION_WAIT_STRATEGY));
+    const std::chrono::microseconds spin_time(getConfUInt64(Conf::DERECHO_COMPLETION_SPIN_US));
+    if(!getConfBoolean(Conf::DERECHO_SHARED_COMPLETION_POLLER)) {
+        return std::make_shared<CompletionPoller>(thread_name, wait_strategy, spin_time, cpu);
+    }
+    static std::mutex shared_poller_mutex;
+    static std::weak_ptr<CompletionPoller> shared_poller;
+    std::lock_guard<std::mutex> lock(shared_poller_mutex);
+    std::shared_ptr<CompletionPoller> poller = shared_poller.lock();
+    if(!poller) {
+        poller = std::make_shared<CompletionPoller>("rdma_poll", wait_strategy, spin_time, cpu);
+        shared_poller = poller;
+    }
+    return poller;
+}
+
+}  // namespace derecho
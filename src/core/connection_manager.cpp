@@ -5,36 +5,45 @@
 #include <set>
 
 namespace tcp {
-bool tcp_connections::add_connection(const node_id_t other_id,
-                                     const std::pair<ip_addr_t, uint16_t>& other_ip_and_port) {
-    if(other_id < my_id) {
-        try {
-            sockets[other_id] = socket(other_ip_and_port.first, other_ip_and_port.second);
-        } catch(connection_failure&) {
-            std::cerr << "WARNING: failed to connect to node " << other_id << " at "
-                      << other_ip_and_port.first << ":" << other_ip_and_port.second << std::endl;
-            return false;
-        }
+std::optional<socket> tcp_connections::connect_to(const node_id_t other_id,
+                                                  const std::pair<ip_addr_t, uint16_t>& other_ip_and_port) {
+    std::optional<socket> new_socket;
+    try {
+        new_socket.emplace(other_ip_and_port.first, other_ip_and_port.second);
+    } catch(connection_failure&) {
+        std::cerr << "WARNING: failed to connect to node " << other_id << " at "
+                  << other_ip_and_port.first << ":" << other_ip_and_port.second << std::endl;
+        return std::nullopt;
+    }
 
-        node_id_t remote_id = 0;
+    node_id_t remote_id = 0;
 
-        try {
-            sockets[other_id].exchange(my_id, remote_id);
-        } catch(socket_error&) {
-            std::cerr << "WARNING: failed to exchange rank with node "
-                      << other_id << " at " << other_ip_and_port.first << ":" << other_ip_and_port.second
-                      << std::endl;
-            sockets.erase(other_id);
-            return false;
-        }
-        if(remote_id != other_id) {
-            std::cerr << "WARNING: node at " << other_ip_and_port.first << ":" << other_ip_and_port.second
-                      << " replied with wrong id (expected " << other_id
-                      << " but got " << remote_id << ")" << std::endl;
+    try {
+        new_socket->exchange(my_id, remote_id);
+    } catch(socket_error&) {
+        std::cerr << "WARNING: failed to exchange rank with node "
+                  << other_id << " at " << other_ip_and_port.first << ":" << other_ip_and_port.second
+                  << std::endl;
+        return std::nullopt;
+    }
+    if(remote_id != other_id) {
+        std::cerr << "WARNING: node at " << other_ip_and_port.first << ":" << other_ip_and_port.second
+                  << " replied with wrong id (expected " << other_id
+                  << " but got " << remote_id << ")" << std::endl;
+        return std::nullopt;
+    }
+    return new_socket;
+}
 
-            sockets.erase(other_id);
+bool tcp_connections::add_connection(const node_id_t other_id,
+                                     const std::pair<ip_addr_t, uint16_t>& other_ip_and_port) {
+    if(other_id < my_id) {
+        std::optional<socket> new_socket = connect_to(other_id, other_ip_and_port);
+        if(!new_socket) {
             return false;
         }
+        std::lock_guard<std::mutex> socket_lock(socket_mutexes[other_id]);
+        sockets[other_id] = std::move(*new_socket);
         return true;
     } else if(other_id > my_id) {
         while(true) {
@@ -44,6 +53,7 @@ bool tcp_connections::add_connection(const node_id_t other_id,
                 node_id_t remote_id = 0;
                 s.exchange(my_id, remote_id);
 
+                std::lock_guard<std::mutex> socket_lock(socket_mutexes[remote_id]);
                 sockets[remote_id] = std::move(s);
                 //If the connection we got wasn't the intended node, keep
                 //looping and try again; there must be multiple nodes connecting
@@ -76,7 +86,13 @@ tcp_connections::tcp_connections(node_id_t my_id)
 
 void tcp_connections::destroy() {
     std::lock_guard<std::mutex> lock(sockets_mutex);
+    //Wait for any threads still using a socket from get_socket
+    for(auto& id_mutex_pair : socket_mutexes) {
+        id_mutex_pair.second.lock();
+        id_mutex_pair.second.unlock();
+    }
     sockets.clear();
+    socket_mutexes.clear();
     conn_listener.reset();
 }
 
@@ -85,6 +101,7 @@ void tcp_connections::write(node_id_t node_id, uint8_t const* buffer,
     std::lock_guard<std::mutex> lock(sockets_mutex);
     const auto it = sockets.find(node_id);
     assert(it != sockets.end());
+    std::lock_guard<std::mutex> socket_lock(socket_mutexes[node_id]);
     it->second.write(buffer, size);
 }
 
@@ -94,6 +111,7 @@ void tcp_connections::write_all(uint8_t const* buffer, size_t size) {
         if(p.first == my_id) {
             continue;
         }
+        std::lock_guard<std::mutex> socket_lock(socket_mutexes[p.first]);
         p.second.write(buffer, size);
     }
 }
@@ -103,20 +121,54 @@ void tcp_connections::read(node_id_t node_id, uint8_t* buffer,
     std::lock_guard<std::mutex> lock(sockets_mutex);
     const auto it = sockets.find(node_id);
     assert(it != sockets.end());
+    std::lock_guard<std::mutex> socket_lock(socket_mutexes[node_id]);
     it->second.read(buffer, size);
 }
 
 bool tcp_connections::add_node(node_id_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port) {
-    std::lock_guard<std::mutex> lock(sockets_mutex);
     assert(new_id != my_id);
+    std::unique_lock<std::mutex> lock(sockets_mutex);
+    //If another thread is already connecting to this ID, wait for it to finish
+    connecting_ids_cv.wait(lock, [&]() { return connecting_ids.count(new_id) == 0; });
     //If there's already a connection to this ID, just return "success"
     if(sockets.count(new_id) > 0)
         return true;
-    return add_connection(new_id, new_ip_addr_and_port);
+    if(new_id > my_id) {
+        //Accepting uses the shared listener, so it must happen under the lock
+        return add_connection(new_id, new_ip_addr_and_port);
+    }
+    //Connecting out only involves the new socket, so other connections can proceed meanwhile.
+    //Reserve the ID so no other thread connects to it until this attempt is finished.
+    connecting_ids.insert(new_id);
+    lock.unlock();
+    std::optional<socket> new_socket = connect_to(new_id, new_ip_addr_and_port);
+    lock.lock();
+    //If delete_node cancelled the reservation, the node was removed while connecting
+    const bool still_reserved = connecting_ids.erase(new_id) > 0;
+    connecting_ids_cv.notify_all();
+    if(!new_socket || !still_reserved) {
+        return false;
+    }
+    if(sockets.count(new_id) > 0) {
+        //Keep the connection that is already in use, and close the new one
+        return true;
+    }
+    std::lock_guard<std::mutex> socket_lock(socket_mutexes[new_id]);
+    sockets[new_id] = std::move(*new_socket);
+    return true;
 }
 
 bool tcp_connections::delete_node(node_id_t remove_id) {
     std::lock_guard<std::mutex> lock(sockets_mutex);
+    //Cancel any connection add_node is still setting up, so it won't be added afterwards
+    connecting_ids.erase(remove_id);
+    auto mutex_iter = socket_mutexes.find(remove_id);
+    if(mutex_iter != socket_mutexes.end()) {
+        //Wait for any thread still using the socket before closing it
+        mutex_iter->second.lock();
+        mutex_iter->second.unlock();
+        socket_mutexes.erase(mutex_iter);
+    }
     return (sockets.erase(remove_id) > 0);
 }
 
@@ -128,6 +180,7 @@ bool tcp_connections::contains_node(node_id_t node_id) {
 int32_t tcp_connections::probe_all() {
     std::lock_guard<std::mutex> lock(sockets_mutex);
     for(auto& p : sockets) {
+        std::lock_guard<std::mutex> socket_lock(socket_mutexes[p.first]);
         bool new_data_available = p.second.probe();
         if(new_data_available == true) {
             return p.first;
@@ -146,7 +199,13 @@ void tcp_connections::filter_to(const std::vector<node_id_t>& live_nodes_list) {
         if(!std::binary_search(sorted_nodes_list.begin(),
                                sorted_nodes_list.end(),
                                socket_map_iter->first)) {
-            //If the node ID is not in the list, delete the socket
+            //If the node ID is not in the list, delete the socket once no thread is using it
+            auto mutex_iter = socket_mutexes.find(socket_map_iter->first);
+            if(mutex_iter != socket_mutexes.end()) {
+                mutex_iter->second.lock();
+                mutex_iter->second.unlock();
+                socket_mutexes.erase(mutex_iter);
+            }
             socket_map_iter = sockets.erase(socket_map_iter);
         } else {
             socket_map_iter++;
@@ -155,6 +214,8 @@ void tcp_connections::filter_to(const std::vector<node_id_t>& live_nodes_list) {
 }
 
 derecho::LockedReference<std::unique_lock<std::mutex>, socket> tcp_connections::get_socket(node_id_t node_id) {
-    return derecho::LockedReference<std::unique_lock<std::mutex>, socket>(sockets.at(node_id), sockets_mutex);
+    std::lock_guard<std::mutex> lock(sockets_mutex);
+    //Only the node's own socket stays locked after this returns
+    return derecho::LockedReference<std::unique_lock<std::mutex>, socket>(sockets.at(node_id), socket_mutexes[node_id]);
 }
 }  // namespace tcp
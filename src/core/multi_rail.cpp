@@ -0,0 +1,167 @@
+#include <derecho/core/detail/multi_rail.hpp>
+
+#include <derecho/conf/conf.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace derecho {
+
+/** Splits a comma-separated list, trimming whitespace and dropping empty items. */
+static std::vector<std::string> split_list(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream list_stream(list);
+    std::string item;
+    while(std::getline(list_stream, item, ',')) {
+        const auto first = item.find_first_not_of(" \t");
+        if(first == std::string::npos) {
+            continue;
+        }
+        items.emplace_back(item.substr(first, item.find_last_not_of(" \t") - first + 1));
+    }
+    return items;
+}
+
+/** Reads the first line of a sysfs file, or returns an empty string if it can't be read. */
+static std::string read_sysfs_line(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+/**
+ * Gets the link rate of an RDMA device's first port or of a network
+ * interface, in Mb/s.
+ * @return The rate, or 0 if it is unknown
+ */
+static uint64_t get_link_rate(const std::string& domain) {
+    // An RDMA port's rate looks like "100 Gb/sec (4X EDR)"
+    std::string rate = read_sysfs_line("/sys/class/infiniband/" + domain + "/ports/1/rate");
+    if(!rate.empty()) {
+        try {
+            return static_cast<uint64_t>(std::stod(rate) * 1000);
+        } catch(std::logic_error&) {
+            return 0;
+        }
+    }
+    // A network interface's speed is in Mb/s, or -1 if it has none (e.g. loopback)
+    std::string speed = read_sysfs_line("/sys/class/net/" + domain + "/speed");
+    try {
+        long long mbps = std::stoll(speed);
+        return mbps > 0 ? mbps : 0;
+    } catch(std::logic_error&) {
+        return 0;
+    }
+}
+
+std::vector<RailConfig> get_configured_rails() {
+    std::vector<std::string> domains = split_list(getConfString(Conf::RDMA_DOMAINS));
+    if(domains.empty()) {
+        domains.push_back(getConfString(Conf::RDMA_DOMAIN));
+    }
+    if(domains.size() > max_rails) {
+        throw std::invalid_argument("RDMA/domains lists " + std::to_string(domains.size())
+                                    + " rails, but at most " + std::to_string(max_rails) + " are supported");
+    }
+    std::vector<RailConfig> rails;
+    const std::vector<std::string> weights = split_list(getConfString(Conf::RDMA_RAIL_WEIGHTS));
+    if(!weights.empty()) {
+        if(weights.size() != domains.size()) {
+            throw std::invalid_argument("RDMA/rail_weights must have one weight for each of the "
+                                        + std::to_string(domains.size()) + " rails");
+        }
+        for(std::size_t i = 0; i < domains.size(); ++i) {
+            const unsigned long weight = std::stoul(weights[i]);
+            if(weight == 0) {
+                throw std::invalid_argument("RDMA/rail_weights must be positive");
+            }
+            rails.push_back({domains[i], static_cast<uint32_t>(weight)});
+        }
+        return rails;
+    }
+    std::vector<uint64_t> rates;
+    for(const std::string& domain : domains) {
+        rates.push_back(get_link_rate(domain));
+    }
+    const uint64_t max_rate = *std::max_element(rates.begin(), rates.end());
+    const bool rates_known = std::find(rates.begin(), rates.end(), 0) == rates.end();
+    for(std::size_t i = 0; i < domains.size(); ++i) {
+        // Scale the rates to small weights, so the stripe pattern stays short
+        const uint32_t weight = rates_known ? std::max<uint32_t>(1, std::lround(16.0 * rates[i] / max_rate)) : 1;
+        rails.push_back({domains[i], weight});
+    }
+    return rails;
+}
+
+bool rail_link_is_up(const std::string& domain) {
+    const std::string ports_path = "/sys/class/infiniband/" + domain + "/ports";
+    if(DIR* ports_dir = opendir(ports_path.c_str())) {
+        bool any_port_active = false;
+        while(struct dirent* port = readdir(ports_dir)) {
+            if(port->d_name[0] == '.') {
+                continue;
+            }
+            // A port's state looks like "4: ACTIVE"
+            if(read_sysfs_line(ports_path + "/" + port->d_name + "/state").find("ACTIVE") != std::string::npos) {
+                any_port_active = true;
+                break;
+            }
+        }
+        closedir(ports_dir);
+        return any_port_active;
+    }
+    const std::string operstate = read_sysfs_line("/sys/class/net/" + domain + "/operstate");
+    return operstate != "down" && operstate != "lowerlayerdown";
+}
+
+int get_rail_numa_node(const std::string& domain) {
+    std::string node = read_sysfs_line("/sys/class/infiniband/" + domain + "/device/numa_node");
+    if(node.empty()) {
+        node = read_sysfs_line("/sys/class/net/" + domain + "/device/numa_node");
+    }
+    try {
+        return std::max(std::stoi(node), -1);
+    } catch(std::logic_error&) {
+        return -1;
+    }
+}
+
+std::vector<uint32_t> make_stripe_pattern(const std::vector<uint32_t>& weights) {
+    int64_t total_weight = 0;
+    for(uint32_t weight : weights) {
+        total_weight += weight;
+    }
+    std::vector<uint32_t> pattern;
+    pattern.reserve(total_weight);
+    std::vector<int64_t> current_weights(weights.size(), 0);
+    for(int64_t turn = 0; turn < total_weight; ++turn) {
+        int64_t chosen = -1;
+        for(uint32_t rail = 0; rail < weights.size(); ++rail) {
+            if(weights[rail] == 0) {
+                continue;
+            }
+            current_weights[rail] += weights[rail];
+            if(chosen < 0 || current_weights[rail] > current_weights[chosen]) {
+                chosen = rail;
+            }
+        }
+        current_weights[chosen] -= total_weight;
+        pattern.push_back(chosen);
+    }
+    return pattern;
+}
+
+uint32_t choose_pair_rail(node_id_t node_a, node_id_t node_b, const std::vector<uint32_t>& weights) {
+    const std::vector<uint32_t> pattern = make_stripe_pattern(weights);
+    if(pattern.empty()) {
+        throw std::invalid_argument("choose_pair_rail: no rail has a nonzero weight");
+    }
+    return pattern[(static_cast<uint64_t>(node_a) + node_b) % pattern.size()];
+}
+
+}  // namespace derecho
@@ -9,10 +9,13 @@
 #include <derecho/utils/time.h>
 
 #include <algorithm>
+#include <arpa/inet.h>
 #include <atomic>
 #include <cassert>
 #include <chrono>
 #include <limits>
+#include <optional>
+#include <stdexcept>
 #include <thread>
 
 namespace derecho {
@@ -31,7 +34,7 @@ size_t index_of(T container, U elem) {
 }
 
 MulticastGroup::MulticastGroup(
-        std::vector<node_id_t> _members, node_id_t my_node_id,
+        std::vector<node_id_t> _members, node_id_t my_node_id, int32_t vid,
         std::shared_ptr<DerechoSST> sst,
         UserMessageCallbacks callbacks,
         MulticastGroupCallbacks internal_callbacks,
@@ -43,6 +46,7 @@ MulticastGroup::MulticastGroup(
         : members(_members),
           num_members(members.size()),
           member_index(index_of(members, my_node_id)),
+          vid(vid),
           callbacks(callbacks),
           internal_callbacks(internal_callbacks),
           total_num_subgroups(total_num_subgroups),
@@ -76,11 +80,13 @@ MulticastGroup::MulticastGroup(
         node_id_to_sst_index[members[i]] = i;
     }
 
+    // Each sender's RDMC group holds one extra buffer as the destination of
+    // its next message, so buffers are allocated for window_size + 1 messages
     for(const auto& p : subgroup_settings_by_id) {
         subgroup_id_t id = p.first;
         const SubgroupSettings& settings = p.second;
         auto num_shard_members = settings.members.size();
-        while(free_message_buffers[id].size() < settings.profile.window_size * num_shard_members) {
+        while(free_message_buffers[id].size() < (settings.profile.window_size + 1) * num_shard_members) {
             free_message_buffers[id].emplace_back(settings.profile.max_msg_size);
         }
     }
@@ -105,7 +111,7 @@ MulticastGroup::MulticastGroup(
 }
 
 MulticastGroup::MulticastGroup(
-        std::vector<node_id_t> _members, node_id_t my_node_id,
+        std::vector<node_id_t> _members, node_id_t my_node_id, int32_t vid,
         std::shared_ptr<DerechoSST> sst,
         MulticastGroup&& old_group,
         uint32_t total_num_subgroups,
@@ -114,6 +120,7 @@ MulticastGroup::MulticastGroup(
         : members(_members),
           num_members(members.size()),
           member_index(index_of(members, my_node_id)),
+          vid(vid),
           callbacks(old_group.callbacks),
           internal_callbacks(old_group.internal_callbacks),
           total_num_subgroups(total_num_subgroups),
@@ -175,7 +182,7 @@ MulticastGroup::MulticastGroup(
         subgroup_id_t id = p.first;
         const SubgroupSettings& settings = p.second;
         auto num_shard_members = settings.members.size();
-        while(free_message_buffers[id].size() < settings.profile.window_size * num_shard_members) {
+        while(free_message_buffers[id].size() < (settings.profile.window_size + 1) * num_shard_members) {
             free_message_buffers[id].emplace_back(settings.profile.max_msg_size);
         }
     }
@@ -189,7 +196,7 @@ MulticastGroup::MulticastGroup(
         auto num_shard_members = settings.members.size();
         // for later: don't move extra message buffers
         free_message_buffers[subgroup_num].swap(old_group.free_message_buffers[subgroup_num]);
-        while(free_message_buffers[subgroup_num].size() < settings.profile.window_size * num_shard_members) {
+        while(free_message_buffers[subgroup_num].size() < (settings.profile.window_size + 1) * num_shard_members) {
             free_message_buffers[subgroup_num].emplace_back(settings.profile.max_msg_size);
         }
     }
@@ -221,7 +228,7 @@ MulticastGroup::MulticastGroup(
         subgroup_id_t id = p.first;
         const SubgroupSettings& settings = p.second;
         auto num_shard_members = settings.members.size();
-        while(free_message_buffers[id].size() < settings.profile.window_size * num_shard_members) {
+        while(free_message_buffers[id].size() < (settings.profile.window_size + 1) * num_shard_members) {
             free_message_buffers[id].emplace_back(settings.profile.max_msg_size);
         }
     }
@@ -277,6 +284,56 @@ MulticastGroup::MulticastGroup(
     timeout_thread = std::thread(&MulticastGroup::check_failures_loop, this);
 }
 
+/**
+ * Returns the ID that keeps this deployment's datagrams apart from those of
+ * other deployments on the same network: DERECHO/smc_datagram_deployment_id
+ * if it is set, or else a hash of the contact address. The result is never 0.
+ */
+static uint64_t get_datagram_deployment_id() {
+    uint64_t deployment_id = getConfUInt64(Conf::DERECHO_SMC_DATAGRAM_DEPLOYMENT_ID);
+    if(deployment_id == 0) {
+        // 64-bit FNV-1a, since std::hash isn't guaranteed to agree between members
+        const std::string contact_address = getConfString(Conf::DERECHO_CONTACT_IP) + ":"
+                                            + std::to_string(getConfUInt16(Conf::DERECHO_CONTACT_PORT));
+        deployment_id = 14695981039346656037ull;
+        for(const char c : contact_address) {
+            deployment_id = (deployment_id ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+        }
+    }
+    // 0 marks a member that can't receive datagrams in the SST
+    return deployment_id == 0 ? 1 : deployment_id;
+}
+
+/**
+ * Reads the settings for sending a shard's SST multicasts as IP multicast
+ * datagrams, if that is enabled. Each shard gets its own group address and
+ * each subgroup its own port, counting up from the configured base address
+ * and port.
+ */
+static std::optional<sst::datagram_settings> get_datagram_settings(int32_t vid, subgroup_id_t subgroup_num,
+                                                                   const SubgroupSettings& subgroup_settings) {
+    if(!getConfBoolean(Conf::DERECHO_SMC_DATAGRAM_MULTICAST) || subgroup_settings.members.size() < 2) {
+        return std::nullopt;
+    }
+    in_addr group_address;
+    if(inet_pton(AF_INET, getConfString(Conf::DERECHO_SMC_DATAGRAM_GROUP).c_str(), &group_address) != 1) {
+        throw std::invalid_argument("DERECHO/smc_datagram_group is not an IPv4 address");
+    }
+    group_address.s_addr = htonl(ntohl(group_address.s_addr) + subgroup_settings.shard_num);
+    char group_address_string[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &group_address, group_address_string, sizeof(group_address_string));
+    sst::datagram_settings settings;
+    settings.group_address = group_address_string;
+    settings.port = getConfUInt16(Conf::DERECHO_SMC_DATAGRAM_PORT) + subgroup_num;
+    settings.interface_address = getConfString(Conf::DERECHO_LOCAL_IP);
+    settings.max_datagram_size = getConfUInt32(Conf::DERECHO_SMC_DATAGRAM_MAX_SIZE);
+    settings.repair_timeout = std::chrono::milliseconds(getConfUInt32(Conf::DERECHO_SMC_DATAGRAM_REPAIR_MS));
+    settings.session_id = (static_cast<uint64_t>(static_cast<uint32_t>(vid)) << 32)
+                          | (static_cast<uint64_t>(subgroup_num) << 16) | (subgroup_settings.shard_num & 0xffff);
+    settings.deployment_id = get_datagram_deployment_id();
+    return settings;
+}
+
 bool MulticastGroup::create_rdmc_sst_groups() {
     for(const auto& p : subgroup_settings_map) {
         uint32_t subgroup_num = p.first;
@@ -287,9 +344,24 @@ bool MulticastGroup::create_rdmc_sst_groups() {
         uint32_t num_shard_senders = get_num_senders(shard_senders);
         auto shard_sst_indices = get_shard_sst_indices(subgroup_num);
 
-        sst_multicast_group_ptrs[subgroup_num] = std::make_unique<sst::multicast_group<DerechoSST>>(
-                sst, shard_sst_indices, subgroup_settings.profile.window_size, subgroup_settings.profile.sst_max_msg_size, subgroup_settings.senders,
-                subgroup_settings.num_received_offset, subgroup_settings.slot_offset, subgroup_settings.index_offset);
+        const std::optional<sst::datagram_settings> datagram_settings
+                = get_datagram_settings(vid, subgroup_num, subgroup_settings);
+        try {
+            sst_multicast_group_ptrs[subgroup_num] = std::make_unique<sst::multicast_group<DerechoSST>>(
+                    sst, shard_sst_indices, subgroup_settings.profile.window_size, subgroup_settings.profile.sst_max_msg_size, subgroup_settings.senders,
+                    subgroup_settings.num_received_offset, subgroup_settings.slot_offset, subgroup_settings.index_offset,
+                    datagram_settings);
+        } catch(const std::exception& e) {
+            // The other members see that this node can't receive datagrams and keep writing to it over RDMA
+            dbg_default_warn("Could not set up datagram multicast for subgroup {}: {}. Datagrams are disabled for the subgroup.",
+                             subgroup_num, e.what());
+            sst_multicast_group_ptrs[subgroup_num] = std::make_unique<sst::multicast_group<DerechoSST>>(
+                    sst, shard_sst_indices, subgroup_settings.profile.window_size, subgroup_settings.profile.sst_max_msg_size, subgroup_settings.senders,
+                    subgroup_settings.num_received_offset, subgroup_settings.slot_offset, subgroup_settings.index_offset);
+        }
+        // Published with the rest of the row before the view's sync_with_members()
+        sst->smc_datagram_deployment[member_index][subgroup_num]
+                = sst_multicast_group_ptrs[subgroup_num]->has_datagram_transport() ? datagram_settings->deployment_id : 0;
 
         if(subgroup_settings.profile.max_msg_size > subgroup_settings.profile.sst_max_msg_size) {
             for(uint shard_rank = 0, sender_rank = -1; shard_rank < num_shard_members; ++shard_rank) {
@@ -436,7 +508,8 @@ bool MulticastGroup::create_rdmc_sst_groups() {
                                    return {nullptr, 0};
                                },
                                receive_handler_plus_notify,
-                               [](std::optional<uint32_t>) {})) {
+                               [](std::optional<uint32_t>) {},
+                               subgroup_settings.profile.max_msg_size)) {
                         return false;
                     }
                     subgroup_to_rdmc_group[subgroup_num] = rdmc_group_num_offset;
@@ -462,7 +535,8 @@ bool MulticastGroup::create_rdmc_sst_groups() {
                                    assert(ret.mr->buffer != nullptr);
                                    return ret;
                                },
-                               rdmc_receive_handler, [](std::optional<uint32_t>) {})) {
+                               rdmc_receive_handler, [](std::optional<uint32_t>) {},
+                               subgroup_settings.profile.max_msg_size)) {
                         return false;
                     }
                     rdmc_group_num_offset++;
@@ -489,6 +563,7 @@ void MulticastGroup::initialize_sst_row() {
     memset(const_cast<uint8_t*>(sst->signatures[member_index]), 0, sst->signatures.size());
     for(uint j = 0; j < total_num_subgroups; j++) {
         sst->index[member_index][j] = -1;
+        sst->smc_datagram_deployment[member_index][j] = 0;
     }
     // No put(), no sync(). The caller will issue them later.
 }
@@ -919,6 +994,7 @@ void MulticastGroup::sst_send_trigger(subgroup_id_t subgroup_num, const Subgroup
         sst_multicast_group_ptrs[subgroup_num]->send(current_committed_index, to_be_sent, current_num_nulls_queued,
                                                      current_first_null_index, sizeof(header));
     }
+    sst_multicast_group_ptrs[subgroup_num]->repair_datagram_losses();
 }
 
 void MulticastGroup::update_min_persisted_num(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
@@ -1008,6 +1084,29 @@ void MulticastGroup::register_predicates() {
         receiver_pred_handles.emplace_back(sst->predicates.insert(sst_send_pred, sst_send_trig,
                                                                   sst::PredicateType::RECURRENT));
 
+        // A sender only starts sending datagrams once every member of the shard has joined the
+        // same datagram multicast. If one of them couldn't, it keeps writing over RDMA instead.
+        if(subgroup_settings.sender_rank >= 0 && sst_multicast_group_ptrs[subgroup_num]
+           && sst_multicast_group_ptrs[subgroup_num]->has_datagram_transport()) {
+            auto datagram_pred = [=](const DerechoSST& sst) {
+                const uint64_t deployment_id = sst.smc_datagram_deployment[member_index][subgroup_num];
+                for(uint i = 0; i < num_shard_members; ++i) {
+                    if(sst.smc_datagram_deployment[node_id_to_sst_index.at(subgroup_settings.members[i])][subgroup_num]
+                       != deployment_id) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            auto datagram_trig = [this, subgroup_num](DerechoSST& sst) {
+                dbg_default_debug("Every member of subgroup {} receives datagrams, so its SST multicasts are now sent as datagrams",
+                                  subgroup_num);
+                sst_multicast_group_ptrs[subgroup_num]->enable_datagram_sending();
+            };
+            receiver_pred_handles.emplace_back(sst->predicates.insert(datagram_pred, datagram_trig,
+                                                                      sst::PredicateType::ONE_TIME));
+        }
+
         if(subgroup_settings.mode != Mode::UNORDERED) {
             auto delivery_pred = [](const DerechoSST& sst) {
                 return true;
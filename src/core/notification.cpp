@@ -1,7 +1,11 @@
+#include <derecho/core/derecho_exception.hpp>
 #include <derecho/core/notification.hpp>
+#include <derecho/utils/logger.hpp>
 
+#include <chrono>
 #include <cstring>
 #include <memory>
+#include <vector>
 
 namespace derecho {
 
@@ -161,4 +165,272 @@ mutils::context_ptr<const NotificationMessage> NotificationMessage::from_bytes_n
                                     false)};
 }
 
+void NotificationMessage::for_each_message(const std::function<void(const NotificationMessage&)>& func) const {
+    if(message_type != BATCH_MESSAGE_TYPE) {
+        func(*this);
+        return;
+    }
+    std::size_t offset = 0;
+    while(offset < size) {
+        auto message = from_bytes_noalloc_const(nullptr, body + offset);
+        offset += message->bytes_size();
+        func(*message);
+    }
+}
+
+/* ---------------------------------- NotificationDispatcher ---------------------------------- */
+
+/** How long the dispatch thread waits before retrying clients whose connections were full */
+static constexpr std::chrono::microseconds blocked_client_retry_interval{100};
+
+NotificationDispatcher::NotificationDispatcher(const send_function_t& send_function,
+                                               const NotificationDispatcherOptions& options)
+        : send_function(send_function),
+          options(options),
+          total_pending(0),
+          thread_shutdown(false),
+          dispatch_thread(&NotificationDispatcher::dispatch_loop, this) {}
+
+NotificationDispatcher::~NotificationDispatcher() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        thread_shutdown = true;
+    }
+    work_available.notify_all();
+    if(dispatch_thread.joinable()) {
+        dispatch_thread.join();
+    }
+}
+
+void NotificationDispatcher::subscribe(node_id_t client_id, topic_t topic) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    clients[client_id].topics.insert(topic);
+    subscribers[topic].insert(client_id);
+}
+
+void NotificationDispatcher::unsubscribe(node_id_t client_id, topic_t topic) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    auto client_iter = clients.find(client_id);
+    if(client_iter != clients.end()) {
+        client_iter->second.topics.erase(topic);
+    }
+    auto topic_iter = subscribers.find(topic);
+    if(topic_iter != subscribers.end()) {
+        topic_iter->second.erase(client_id);
+        if(topic_iter->second.empty()) {
+            subscribers.erase(topic_iter);
+        }
+    }
+}
+
+void NotificationDispatcher::remove_client(node_id_t client_id) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    remove_client_locked(client_id);
+    if(total_pending == 0) {
+        queues_drained.notify_all();
+    }
+}
+
+void NotificationDispatcher::remove_client_locked(node_id_t client_id) {
+    auto client_iter = clients.find(client_id);
+    if(client_iter == clients.end()) {
+        return;
+    }
+    for(const topic_t& topic : client_iter->second.topics) {
+        auto topic_iter = subscribers.find(topic);
+        if(topic_iter != subscribers.end()) {
+            topic_iter->second.erase(client_id);
+            if(topic_iter->second.empty()) {
+                subscribers.erase(topic_iter);
+            }
+        }
+    }
+    stats.dropped += client_iter->second.pending.size();
+    total_pending -= client_iter->second.pending.size();
+    // If the client is still in ready_clients or blocked_clients, the dispatch
+    // thread will skip it when it fails to find it in the map
+    clients.erase(client_iter);
+}
+
+std::size_t NotificationDispatcher::publish(topic_t topic, NotificationMessage message) {
+    auto shared_message = std::make_shared<const NotificationMessage>(std::move(message));
+    std::size_t num_queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stats.published++;
+        auto topic_iter = subscribers.find(topic);
+        if(topic_iter == subscribers.end()) {
+            return 0;
+        }
+        for(const node_id_t& client_id : topic_iter->second) {
+            enqueue(client_id, clients[client_id], topic, shared_message);
+            num_queued++;
+        }
+    }
+    work_available.notify_one();
+    return num_queued;
+}
+
+void NotificationDispatcher::notify_client(node_id_t client_id, NotificationMessage message) {
+    auto shared_message = std::make_shared<const NotificationMessage>(std::move(message));
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stats.published++;
+        enqueue(client_id, clients[client_id], 0, shared_message);
+    }
+    work_available.notify_one();
+}
+
+void NotificationDispatcher::enqueue(node_id_t client_id, ClientQueue& queue, topic_t topic,
+                                     const std::shared_ptr<const NotificationMessage>& message) {
+    if(options.slow_consumer_policy == SlowConsumerPolicy::MERGE_BY_TYPE) {
+        for(queue_entry_t& entry : queue.pending) {
+            if(entry.first == topic && entry.second->message_type == message->message_type) {
+                entry.second = message;
+                stats.merged++;
+                return;
+            }
+        }
+    }
+    if(options.max_queue_depth > 0 && queue.pending.size() >= options.max_queue_depth) {
+        stats.dropped++;
+        if(options.slow_consumer_policy == SlowConsumerPolicy::DROP_NEWEST) {
+            return;
+        }
+        queue.pending.pop_front();
+        total_pending--;
+    }
+    queue.pending.emplace_back(topic, message);
+    total_pending++;
+    stats.enqueued++;
+    if(!queue.scheduled) {
+        queue.scheduled = true;
+        ready_clients.push_back(client_id);
+    }
+}
+
+void NotificationDispatcher::wait_until_drained() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    queues_drained.wait(lock, [this]() { return total_pending == 0 || thread_shutdown; });
+}
+
+NotificationDispatcherStats NotificationDispatcher::get_stats() {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    return stats;
+}
+
+void NotificationDispatcher::dispatch_loop() {
+    pthread_setname_np(pthread_self(), "notify_fanout");
+    std::vector<queue_entry_t> batch;
+    std::unique_lock<std::mutex> lock(state_mutex);
+    while(!thread_shutdown) {
+        if(ready_clients.empty()) {
+            if(blocked_clients.empty()) {
+                work_available.wait(lock, [this]() { return thread_shutdown || !ready_clients.empty(); });
+            } else {
+                // Give full connections a chance to drain, then try them again
+                work_available.wait_for(lock, blocked_client_retry_interval);
+                ready_clients.insert(ready_clients.end(), blocked_clients.begin(), blocked_clients.end());
+                blocked_clients.clear();
+            }
+            continue;
+        }
+        const node_id_t client_id = ready_clients.front();
+        ready_clients.pop_front();
+        auto client_iter = clients.find(client_id);
+        if(client_iter == clients.end()) {
+            continue;
+        }
+        ClientQueue& queue = client_iter->second;
+        if(queue.pending.empty()) {
+            queue.scheduled = false;
+            continue;
+        }
+        // Take as many queued notifications as fit in one message
+        std::size_t batch_bytes = 0;
+        while(!queue.pending.empty()) {
+            const std::size_t next_bytes = queue.pending.front().second->bytes_size();
+            if(!batch.empty() && options.max_batch_bytes > 0
+               && batch_bytes + next_bytes > options.max_batch_bytes) {
+                break;
+            }
+            batch_bytes += next_bytes;
+            batch.emplace_back(std::move(queue.pending.front()));
+            queue.pending.pop_front();
+        }
+        lock.unlock();
+        bool sent = false;
+        bool client_gone = false;
+        try {
+            if(batch.size() == 1) {
+                sent = send_function(client_id, *batch.front().second);
+            } else {
+                NotificationMessage batch_message(NotificationMessage::BATCH_MESSAGE_TYPE, batch_bytes);
+                std::size_t offset = 0;
+                for(const queue_entry_t& entry : batch) {
+                    offset += entry.second->to_bytes(batch_message.body + offset);
+                }
+                sent = send_function(client_id, batch_message);
+            }
+        } catch(derecho_exception& ex) {
+            dbg_default_debug("NotificationDispatcher: removing client {} after a failed send: {}", client_id, ex.what());
+            client_gone = true;
+        }
+        lock.lock();
+        client_iter = clients.find(client_id);
+        if(sent) {
+            stats.delivered += batch.size();
+            stats.messages_sent++;
+            total_pending -= batch.size();
+        } else if(client_gone || client_iter == clients.end()) {
+            stats.dropped += batch.size();
+            total_pending -= batch.size();
+            remove_client_locked(client_id);
+        } else {
+            // Put the batch back in front of anything published in the meantime,
+            // then re-apply the queue bound
+            ClientQueue& requeue = client_iter->second;
+            for(auto entry = batch.rbegin(); entry != batch.rend(); ++entry) {
+                bool superseded = false;
+                if(options.slow_consumer_policy == SlowConsumerPolicy::MERGE_BY_TYPE) {
+                    for(const queue_entry_t& newer : requeue.pending) {
+                        if(newer.first == entry->first && newer.second->message_type == entry->second->message_type) {
+                            superseded = true;
+                            break;
+                        }
+                    }
+                }
+                if(superseded) {
+                    stats.merged++;
+                    total_pending--;
+                } else {
+                    requeue.pending.emplace_front(std::move(*entry));
+                }
+            }
+            while(options.max_queue_depth > 0 && requeue.pending.size() > options.max_queue_depth) {
+                if(options.slow_consumer_policy == SlowConsumerPolicy::DROP_NEWEST) {
+                    requeue.pending.pop_back();
+                } else {
+                    requeue.pending.pop_front();
+                }
+                stats.dropped++;
+                total_pending--;
+            }
+            blocked_clients.push_back(client_id);
+        }
+        batch.clear();
+        if(sent && client_iter != clients.end()) {
+            if(client_iter->second.pending.empty()) {
+                client_iter->second.scheduled = false;
+            } else {
+                ready_clients.push_back(client_id);
+            }
+        }
+        if(total_pending == 0) {
+            queues_drained.notify_all();
+        }
+    }
+    queues_drained.notify_all();
+}
+
 }  // namespace derecho
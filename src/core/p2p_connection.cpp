@@ -3,6 +3,7 @@
 #include <derecho/core/detail/rpc_utils.hpp>
 #include <derecho/sst/detail/poll_utils.hpp>
 
+#include <cassert>
 #include <cstring>
 #include <map>
 #include <sstream>
@@ -26,9 +27,11 @@ std::ostream& operator<<(std::ostream& os, MESSAGE_TYPE mt) {
 }
 
 P2PConnection::P2PConnection(uint32_t my_node_id, uint32_t remote_id, uint64_t p2p_buf_size, const ConnectionParams& connection_params)
-        : my_node_id(my_node_id), remote_id(remote_id), connection_params(connection_params), rpc_logger(spdlog::get(LoggerFactory::RPC_LOGGER_NAME)) {
-    incoming_p2p_buffer = std::make_unique<volatile uint8_t[]>(p2p_buf_size);
-    outgoing_p2p_buffer = std::make_unique<volatile uint8_t[]>(p2p_buf_size);
+        : my_node_id(my_node_id), remote_id(remote_id), connection_params(connection_params), rpc_logger(spdlog::get(LoggerFactory::RPC_LOGGER_NAME)), p2p_buf_size(p2p_buf_size) {
+    auto incoming_memory = derecho::allocate_registered_memory(p2p_buf_size);
+    auto outgoing_memory = derecho::allocate_registered_memory(p2p_buf_size);
+    incoming_p2p_buffer = derecho::registered_array<volatile uint8_t>(incoming_memory.release(), incoming_memory.get_deleter());
+    outgoing_p2p_buffer = derecho::registered_array<volatile uint8_t>(outgoing_memory.release(), outgoing_memory.get_deleter());
 
     for(auto type : p2p_message_types) {
         incoming_seq_nums_map.try_emplace(type, 0);
@@ -52,16 +55,33 @@ resources* P2PConnection::get_res() {
     return res.get();
 }
 uint64_t P2PConnection::getOffsetSeqNum(MESSAGE_TYPE type, uint64_t seq_num) {
+    assert(connection_params.window_sizes[type] != 0);
     return connection_params.offsets[type] + connection_params.max_msg_sizes[type] * ((seq_num % connection_params.window_sizes[type]) + 1) - sizeof(uint64_t);
 }
 
 uint64_t P2PConnection::getOffsetBuf(MESSAGE_TYPE type, uint64_t seq_num) {
+    assert(connection_params.window_sizes[type] != 0);
     return connection_params.offsets[type] + connection_params.max_msg_sizes[type] * (seq_num % connection_params.window_sizes[type]);
 }
 
+std::size_t P2PConnection::get_max_msg_size(MESSAGE_TYPE type) const {
+    // A connection with no region for this type can't send any message of it
+    if(connection_params.window_sizes[type] == 0) {
+        return 0;
+    }
+    return connection_params.max_msg_sizes[type] - sizeof(uint64_t);
+}
+
 // check if there's a new request from some node
 std::optional<std::pair<uint8_t*, MESSAGE_TYPE>> P2PConnection::probe() {
+    if(!rendezvous_buffers[P2P_REPLY].empty()) {
+        release_acknowledged_replies();
+    }
     for(auto type : p2p_message_types) {
+        // Connections to external clients have no RPC reply region
+        if(connection_params.window_sizes[type] == 0) {
+            continue;
+        }
         // C-style cast: reinterpret the bytes of the buffer as a uint64_t, and also cast away volatile
         if(((uint64_t&)incoming_p2p_buffer[getOffsetSeqNum(type, incoming_seq_nums_map[type])])
            == incoming_seq_nums_map[type] + 1) {
@@ -76,15 +96,35 @@ std::optional<std::pair<uint8_t*, MESSAGE_TYPE>> P2PConnection::probe() {
 void P2PConnection::increment_incoming_seq_num(MESSAGE_TYPE type) {
     dbg_trace(rpc_logger, "P2PConnection updating incoming_seq_num for type {} to {}", type, incoming_seq_nums_map[type] + 1);
     incoming_seq_nums_map[type]++;
+    if(type == MESSAGE_TYPE::P2P_REPLY) {
+        // The remote node read request k's rendezvous buffer before replying to it
+        release_rendezvous_buffers(P2P_REQUEST, incoming_seq_nums_map[type]);
+        if(!overflow_queue.empty()) {
+            drain_overflow_queue();
+        }
+    }
+}
+
+bool P2PConnection::request_slot_available(uint64_t seq_num) {
+    // The slot for a request is free once the reply to the request that used it
+    // (window_size sequence numbers earlier) has been received
+    return seq_num - incoming_seq_nums_map[MESSAGE_TYPE::P2P_REPLY] < connection_params.window_sizes[P2P_REQUEST];
+}
+
+bool P2PConnection::has_send_space(MESSAGE_TYPE type) {
+    return type != MESSAGE_TYPE::P2P_REQUEST
+           || (overflow_queue.empty() && request_slot_available(outgoing_seq_nums_map[MESSAGE_TYPE::P2P_REQUEST]))
+           || overflow_queue.size() < connection_params.overflow_queue_size;
 }
 
 std::optional<P2PBufferHandle> P2PConnection::get_sendbuffer_ptr(MESSAGE_TYPE type) {
     // For P2P_REQUEST buffers, check to ensure a buffer is available in the sending window by
     // comparing request and reply sequence numbers. P2P_REPLY and RPC_REPLY buffers are always
     // available, since they are only used in response to a message in the current sending window.
+    // Requests must also wait if earlier requests are still in the overflow queue, so that
+    // they are delivered in sequence-number order.
     if(type != MESSAGE_TYPE::P2P_REQUEST
-       || outgoing_seq_nums_map[MESSAGE_TYPE::P2P_REQUEST] - incoming_seq_nums_map[MESSAGE_TYPE::P2P_REPLY]
-                  < connection_params.window_sizes[P2P_REQUEST]) {
+       || (overflow_queue.empty() && request_slot_available(outgoing_seq_nums_map[MESSAGE_TYPE::P2P_REQUEST]))) {
         uint64_t cur_seq_num = outgoing_seq_nums_map[type];
         uint64_t next_seq_num = ++outgoing_seq_nums_map[type];
         // C-style cast: reinterpret the bytes of the buffer as a uint64_t, and also cast away volatile
@@ -93,11 +133,46 @@ std::optional<P2PBufferHandle> P2PConnection::get_sendbuffer_ptr(MESSAGE_TYPE ty
                                        + getOffsetBuf(type, cur_seq_num),
                                cur_seq_num};
     }
+    if(overflow_queue.size() < connection_params.overflow_queue_size) {
+        // The window is full, so give the sender a local buffer that will be copied into the window later
+        uint64_t cur_seq_num = outgoing_seq_nums_map[type]++;
+        overflow_queue.push_back(OverflowMessage{cur_seq_num,
+                                                 std::make_unique<uint8_t[]>(connection_params.max_msg_sizes[type] - sizeof(uint64_t)),
+                                                 false});
+        dbg_trace(rpc_logger, "P2PConnection: Send window to node {} was full, queued request {} as overflow message {}", remote_id, cur_seq_num, overflow_queue.size());
+        return P2PBufferHandle{overflow_queue.back().buffer.get(), cur_seq_num};
+    }
     dbg_trace(rpc_logger, "P2PConnection: Send buffer was full: incoming_seq_nums[REPLY] = {}, but outgoing_seq_nums[REQUEST] = {}", incoming_seq_nums_map[MESSAGE_TYPE::P2P_REPLY], outgoing_seq_nums_map[MESSAGE_TYPE::P2P_REQUEST]);
     return std::nullopt;
 }
 
+void P2PConnection::drain_overflow_queue() {
+    while(!overflow_queue.empty() && overflow_queue.front().ready_to_send
+          && request_slot_available(overflow_queue.front().seq_num)) {
+        const uint64_t seq_num = overflow_queue.front().seq_num;
+        std::memcpy(const_cast<uint8_t*>(outgoing_p2p_buffer.get()) + getOffsetBuf(P2P_REQUEST, seq_num),
+                    overflow_queue.front().buffer.get(),
+                    connection_params.max_msg_sizes[P2P_REQUEST] - sizeof(uint64_t));
+        // C-style cast: reinterpret the bytes of the buffer as a uint64_t, and also cast away volatile
+        ((uint64_t&)outgoing_p2p_buffer[getOffsetSeqNum(P2P_REQUEST, seq_num)]) = seq_num + 1;
+        overflow_queue.pop_front();
+        dbg_trace(rpc_logger, "P2PConnection: Sending overflow request {} to node {}", seq_num, remote_id);
+        post_message(P2P_REQUEST, seq_num);
+    }
+}
+
 void P2PConnection::send(MESSAGE_TYPE type, uint64_t sequence_num) {
+    if(type == MESSAGE_TYPE::P2P_REQUEST && !overflow_queue.empty()
+       && sequence_num >= overflow_queue.front().seq_num) {
+        // Sequence numbers in the queue are consecutive, so the message's position can be computed
+        overflow_queue[sequence_num - overflow_queue.front().seq_num].ready_to_send = true;
+        drain_overflow_queue();
+        return;
+    }
+    post_message(type, sequence_num);
+}
+
+void P2PConnection::post_message(MESSAGE_TYPE type, uint64_t sequence_num) {
     if(remote_id == my_node_id) {
         // there's no reason why memcpy shouldn't also copy guard and data separately
         std::memcpy(const_cast<uint8_t*>(incoming_p2p_buffer.get()) + getOffsetBuf(type, sequence_num),
@@ -124,12 +199,85 @@ void P2PConnection::send(MESSAGE_TYPE type, uint64_t sequence_num) {
     }
 }
 
+RendezvousBufferHandle P2PConnection::allocate_rendezvous_buffer(MESSAGE_TYPE type, uint64_t sequence_num, std::size_t size) {
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[size]);
+    RendezvousBufferHandle handle{buffer.get(), 0};
+    // Messages to myself are copied directly from the buffer, so it doesn't need to be registered
+    if(remote_id != my_node_id) {
+        memory_attribute_t attr;
+        attr.type = memory_attribute_t::SYSTEM;
+        // Rendezvous buffers are freed with delete[], which the registration
+        // cache can't detect, so their registrations must not be cached
+        register_oob_memory_ex(handle.buf_ptr, size, attr, false);
+        handle.rkey = get_oob_memory_key(handle.buf_ptr);
+    }
+    rendezvous_buffers[type].emplace(sequence_num, std::move(buffer));
+    dbg_trace(rpc_logger, "P2PConnection: Staged {} {} to node {} in a {}-byte rendezvous buffer", type, sequence_num, remote_id, size);
+    return handle;
+}
+
+void P2PConnection::release_rendezvous_buffers(MESSAGE_TYPE type, uint64_t end_seq_num) {
+    auto& buffers = rendezvous_buffers[type];
+    if(buffers.empty()) {
+        return;
+    }
+    auto end = buffers.lower_bound(end_seq_num);
+    if(remote_id != my_node_id) {
+        for(auto iter = buffers.begin(); iter != end; ++iter) {
+            deregister_oob_memory(iter->second.get());
+        }
+    }
+    buffers.erase(buffers.begin(), end);
+}
+
+void P2PConnection::release_acknowledged_replies() {
+    // C-style cast: reinterpret the bytes of the buffer as a uint64_t, and also cast away volatile
+    const uint64_t acknowledged = (uint64_t&)incoming_p2p_buffer[connection_params.rendezvous_ack_offset];
+    auto& buffers = rendezvous_buffers[P2P_REPLY];
+    while(rendezvous_replies_released < acknowledged && !buffers.empty()) {
+        if(remote_id != my_node_id) {
+            deregister_oob_memory(buffers.begin()->second.get());
+        }
+        buffers.erase(buffers.begin());
+        rendezvous_replies_released++;
+    }
+}
+
+void P2PConnection::post_rendezvous_read(uint8_t* dest_buf, uint64_t remote_addr, uint64_t rkey, std::size_t size) {
+    if(remote_id == my_node_id) {
+        std::memcpy(dest_buf, reinterpret_cast<const uint8_t*>(remote_addr), size);
+        return;
+    }
+    struct iovec iov;
+    iov.iov_base = dest_buf;
+    iov.iov_len = size;
+    res->oob_remote_read(&iov, 1, reinterpret_cast<void*>(remote_addr), rkey, size);
+}
+
+void P2PConnection::wait_for_rendezvous_read(uint64_t timeout_us) {
+    if(remote_id != my_node_id) {
+        res->wait_for_oob_op(OOB_OP_READ, timeout_us);
+    }
+}
+
+void P2PConnection::acknowledge_rendezvous_reply() {
+    rendezvous_replies_acknowledged++;
+    // C-style cast: reinterpret the bytes of the buffer as a uint64_t, and also cast away volatile
+    ((uint64_t&)outgoing_p2p_buffer[connection_params.rendezvous_ack_offset]) = rendezvous_replies_acknowledged;
+    if(remote_id == my_node_id) {
+        ((uint64_t&)incoming_p2p_buffer[connection_params.rendezvous_ack_offset]) = rendezvous_replies_acknowledged;
+    } else {
+        res->post_remote_write(connection_params.rendezvous_ack_offset, sizeof(uint64_t));
+    }
+}
+
 uint64_t P2PConnection::get_oob_memory_key(void *addr) {
     return _resources::get_oob_mr_key(addr);
 }
 
-void P2PConnection::register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr) {
-    _resources::register_oob_memory_ex(addr,size,attr);
+void P2PConnection::register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr,
+                                           bool use_registration_cache) {
+    _resources::register_oob_memory_ex(addr,size,attr,use_registration_cache);
 }
 
 void P2PConnection::deregister_oob_memory(void* addr) {
@@ -156,6 +304,10 @@ void P2PConnection::oob_recv(const struct iovec* iov, int iovcnt) {
     res->oob_recv(iov,iovcnt);
 }
 
-P2PConnection::~P2PConnection() {}
+P2PConnection::~P2PConnection() {
+    for(auto& type_buffers : rendezvous_buffers) {
+        release_rendezvous_buffers(type_buffers.first, UINT64_MAX);
+    }
+}
 
 }  // namespace sst
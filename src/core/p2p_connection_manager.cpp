@@ -18,6 +18,7 @@ namespace sst {
 P2PConnectionManager::P2PConnectionManager(const P2PParams params)
         : my_node_id(params.my_node_id),
           rpc_logger(spdlog::get(LoggerFactory::RPC_LOGGER_NAME)),
+          is_external(params.is_external),
           p2p_connections(derecho::getConfUInt32(derecho::Conf::DERECHO_MAX_NODE_ID)),
           active_p2p_connections(new char[derecho::getConfUInt32(derecho::Conf::DERECHO_MAX_NODE_ID)]),
           failure_upcall(params.failure_upcall) {
@@ -29,19 +30,34 @@ P2PConnectionManager::P2PConnectionManager(const P2PParams params)
     request_params.max_msg_sizes[P2P_REPLY] = params.max_p2p_reply_size;
     request_params.max_msg_sizes[P2P_REQUEST] = params.max_p2p_request_size;
     request_params.max_msg_sizes[RPC_REPLY] = params.max_rpc_reply_size;
+    request_params.overflow_queue_size = params.p2p_overflow_queue_size;
+
+    const uint32_t external_window_size = params.external_p2p_window_size ? params.external_p2p_window_size
+                                                                          : params.p2p_window_size;
+    external_params.window_sizes[P2P_REPLY] = external_window_size;
+    external_params.window_sizes[P2P_REQUEST] = external_window_size;
+    // External clients never receive ordered-send replies, so their connections have no
+    // RPC_REPLY region. A window size of 0 marks it as absent: probe() skips it, and
+    // P2PConnection asserts that it is never indexed.
+    external_params.window_sizes[RPC_REPLY] = 0;
+    external_params.max_msg_sizes[P2P_REPLY] = params.max_external_p2p_msg_size ? params.max_external_p2p_msg_size
+                                                                                : params.max_p2p_reply_size;
+    external_params.max_msg_sizes[P2P_REQUEST] = params.max_external_p2p_msg_size ? params.max_external_p2p_msg_size
+                                                                                  : params.max_p2p_request_size;
+    external_params.max_msg_sizes[RPC_REPLY] = 0;
+    external_params.overflow_queue_size = params.p2p_overflow_queue_size;
+    rendezvous_timeout_us = static_cast<uint64_t>(derecho::getConfUInt32(derecho::Conf::DERECHO_SST_POLL_CQ_TIMEOUT_MS)) * 1000;
 
     for(uint32_t i = 0; i < derecho::getConfUInt32(derecho::Conf::DERECHO_MAX_NODE_ID); ++i) {
         active_p2p_connections[i] = false;
     }
 
-    p2p_buf_size = 0;
-    for(uint8_t i = 0; i < num_p2p_message_types; ++i) {
-        request_params.offsets[i] = p2p_buf_size;
-        p2p_buf_size += request_params.window_sizes[i] * request_params.max_msg_sizes[i];
-    }
-    p2p_buf_size += sizeof(bool);
+    p2p_buf_size = compute_offsets(request_params);
+    external_p2p_buf_size = compute_offsets(external_params);
+    dbg_debug(rpc_logger, "P2P buffer size is {} bytes per connection between members and {} bytes per external client connection",
+              p2p_buf_size, external_p2p_buf_size);
 
-    p2p_connections[my_node_id].second = std::make_unique<P2PConnection>(my_node_id, my_node_id, p2p_buf_size, request_params);
+    p2p_connections[my_node_id].second = std::make_shared<P2PConnection>(my_node_id, my_node_id, p2p_buf_size, request_params);
     active_p2p_connections[my_node_id] = true;
 
     // external client doesn't need failure checking
@@ -50,6 +66,74 @@ P2PConnectionManager::P2PConnectionManager(const P2PParams params)
     }
 }
 
+uint64_t P2PConnectionManager::compute_offsets(ConnectionParams& params) {
+    uint64_t buf_size = 0;
+    for(uint8_t i = 0; i < num_p2p_message_types; ++i) {
+        params.offsets[i] = buf_size;
+        buf_size += params.window_sizes[i] * params.max_msg_sizes[i];
+    }
+    params.rendezvous_ack_offset = (buf_size + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+    buf_size = params.rendezvous_ack_offset + sizeof(uint64_t);
+    // The last byte is the target of the failure-detection writes
+    return buf_size + sizeof(bool);
+}
+
+void pooled_buffer_deleter::operator()(uint8_t* buffer) const {
+    if(pool && recycle) {
+        pool->release(buffer, *this);
+        return;
+    }
+    P2PConnection::deregister_oob_memory(buffer);
+    derecho::registered_array<uint8_t> memory(buffer, unmap);
+}
+
+RendezvousReadBuffer RendezvousBufferPool::acquire(std::size_t size) {
+    std::size_t capacity = min_capacity;
+    while(capacity < size) {
+        capacity *= 2;
+    }
+    derecho::registered_array<uint8_t> memory;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        auto& buffers = free_buffers[capacity];
+        if(!buffers.empty()) {
+            memory = std::move(buffers.back());
+            buffers.pop_back();
+        }
+    }
+    if(!memory) {
+        memory = derecho::allocate_registered_memory(capacity);
+        memory_attribute_t attr;
+        attr.type = memory_attribute_t::SYSTEM;
+        // The buffer stays registered for as long as it is pooled, so there is nothing to cache
+        P2PConnection::register_oob_memory_ex(memory.get(), capacity, attr, false);
+    }
+    pooled_buffer_deleter deleter{this, capacity, memory.get_deleter()};
+    return RendezvousReadBuffer(memory.release(), deleter);
+}
+
+void RendezvousBufferPool::release(uint8_t* buffer, const pooled_buffer_deleter& deleter) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        auto& buffers = free_buffers[deleter.capacity];
+        if(buffers.size() < buffers_per_capacity) {
+            buffers.emplace_back(buffer, deleter.unmap);
+            return;
+        }
+    }
+    pooled_buffer_deleter discard = deleter;
+    discard.recycle = false;
+    discard(buffer);
+}
+
+RendezvousBufferPool::~RendezvousBufferPool() {
+    for(auto& capacity_buffers : free_buffers) {
+        for(auto& memory : capacity_buffers.second) {
+            P2PConnection::deregister_oob_memory(memory.get());
+        }
+    }
+}
+
 P2PConnectionManager::~P2PConnectionManager() {
     shutdown_failures_thread();
     //plain C array must be deleted
@@ -57,10 +141,24 @@ P2PConnectionManager::~P2PConnectionManager() {
 }
 
 void P2PConnectionManager::add_connections(const std::vector<node_id_t>& node_ids) {
+    // An external client's connections to group members are all external connections
+    if(is_external) {
+        add_connections(node_ids, external_params, external_p2p_buf_size);
+    } else {
+        add_connections(node_ids, request_params, p2p_buf_size);
+    }
+}
+
+void P2PConnectionManager::add_external_connections(const std::vector<node_id_t>& node_ids) {
+    add_connections(node_ids, external_params, external_p2p_buf_size);
+}
+
+void P2PConnectionManager::add_connections(const std::vector<node_id_t>& node_ids,
+                                           const ConnectionParams& params, uint64_t buf_size) {
     for(const node_id_t remote_id : node_ids) {
         std::lock_guard<std::mutex> connection_lock(p2p_connections[remote_id].first);
         if(!p2p_connections[remote_id].second) {
-            p2p_connections[remote_id].second = std::make_unique<P2PConnection>(my_node_id, remote_id, p2p_buf_size, request_params);
+            p2p_connections[remote_id].second = std::make_shared<P2PConnection>(my_node_id, remote_id, buf_size, params);
             active_p2p_connections[remote_id] = true;
         }
     }
@@ -152,6 +250,77 @@ std::optional<P2PBufferHandle> P2PConnectionManager::get_sendbuffer_ptr(node_id_
     throw std::out_of_range(std::string(__PRETTY_FUNCTION__) + " cannot find a connection to node:" + std::to_string(node_id));
 }
 
+bool P2PConnectionManager::has_send_space(node_id_t node_id, MESSAGE_TYPE type) {
+    std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
+    if(p2p_connections[node_id].second) {
+        return p2p_connections[node_id].second->has_send_space(type);
+    }
+    throw std::out_of_range(std::string(__PRETTY_FUNCTION__) + " cannot find a connection to node:" + std::to_string(node_id));
+}
+
+bool P2PConnectionManager::needs_rendezvous(node_id_t node_id, MESSAGE_TYPE type, std::size_t size) {
+    {
+        std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
+        if(!p2p_connections[node_id].second) {
+            throw std::out_of_range(std::string(__PRETTY_FUNCTION__) + " cannot find a connection to node:" + std::to_string(node_id));
+        }
+        if(size <= p2p_connections[node_id].second->get_max_msg_size(type)) {
+            return false;
+        }
+    }
+#ifdef USE_VERBS_API
+    // The verbs backend does not implement out-of-band memory, so oversized messages can't be sent
+    throw derecho::buffer_overflow_exception("The size of a " + std::string(type == P2P_REPLY ? "P2P reply" : "P2P request")
+                                             + " exceeds the P2P message buffer size, and the verbs API does not support out-of-band transfers.");
+#endif
+    return true;
+}
+
+RendezvousBufferHandle P2PConnectionManager::allocate_rendezvous_buffer(node_id_t node_id, MESSAGE_TYPE type,
+                                                                       uint64_t sequence_num, std::size_t size) {
+    std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
+    if(p2p_connections[node_id].second) {
+        return p2p_connections[node_id].second->allocate_rendezvous_buffer(type, sequence_num, size);
+    }
+    throw std::out_of_range(std::string(__PRETTY_FUNCTION__) + " cannot find a connection to node:" + std::to_string(node_id));
+}
+
+RendezvousReadBuffer P2PConnectionManager::read_rendezvous_buffer(node_id_t node_id, MESSAGE_TYPE type, uint64_t remote_addr,
+                                                                  uint64_t rkey, std::size_t size) {
+    RendezvousReadBuffer buffer = rendezvous_read_buffers.acquire(size);
+    std::shared_ptr<P2PConnection> connection;
+    auto acknowledge = [&]() {
+        if(type != P2P_REPLY) {
+            return;
+        }
+        std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
+        // If the connection was replaced, the remote node's buffers went with the old one
+        if(p2p_connections[node_id].second == connection) {
+            connection->acknowledge_rendezvous_reply();
+        }
+    };
+    try {
+        {
+            std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
+            connection = p2p_connections[node_id].second;
+            if(connection == nullptr) {
+                throw derecho::derecho_exception("rendezvous read from unconnected node:" + std::to_string(node_id));
+            }
+            connection->post_rendezvous_read(buffer.get(), remote_addr, rkey, size);
+        }
+        connection->wait_for_rendezvous_read(rendezvous_timeout_us);
+    } catch(derecho::derecho_exception&) {
+        // A read that timed out may still land in the buffer, so it can't go back to the pool
+        buffer.get_deleter().recycle = false;
+        if(connection) {
+            acknowledge();
+        }
+        throw;
+    }
+    acknowledge();
+    return buffer;
+}
+
 void P2PConnectionManager::send(node_id_t node_id, MESSAGE_TYPE type, uint64_t sequence_num) {
     std::lock_guard<std::mutex> connection_lock(p2p_connections[node_id].first);
     p2p_connections[node_id].second->send(type, sequence_num);
@@ -199,7 +368,7 @@ void P2PConnectionManager::check_failures_loop() {
             ce_ctxt[node_id].set_ce_idx(ce_idx);
 
             p2p_connections[node_id].second->get_res()->post_remote_write_with_completion(&ce_ctxt[node_id],
-                                                                                          p2p_buf_size - sizeof(bool),
+                                                                                          p2p_connections[node_id].second->p2p_buf_size - sizeof(bool),
                                                                                           sizeof(bool));
             posted_write_to.insert(node_id);
         }
@@ -0,0 +1,116 @@
+#include <derecho/core/detail/pipelined_socket_writer.hpp>
+
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace derecho {
+
+PipelinedSocketWriter::PipelinedSocketWriter(tcp::socket& sock, std::size_t chunk_size, std::size_t num_chunks)
+        : sock(sock),
+          chunk_size(chunk_size),
+          num_chunks(std::max<std::size_t>(num_chunks, 2)),
+          current_chunk(std::make_unique<uint8_t[]>(chunk_size)),
+          current_chunk_used(0),
+          shutdown(false) {
+    for(std::size_t i = 1; i < this->num_chunks; ++i) {
+        free_chunks.emplace_back(std::make_unique<uint8_t[]>(chunk_size));
+    }
+    sender_thread = std::thread(&PipelinedSocketWriter::sender_loop, this);
+}
+
+PipelinedSocketWriter::~PipelinedSocketWriter() {
+    {
+        std::lock_guard<std::mutex> lock(chunks_mutex);
+        shutdown = true;
+    }
+    chunks_cv.notify_all();
+    if(sender_thread.joinable()) {
+        sender_thread.join();
+    }
+}
+
+void PipelinedSocketWriter::sender_loop() {
+    pthread_setname_np(pthread_self(), "st_sender");
+    std::unique_lock<std::mutex> lock(chunks_mutex);
+    while(true) {
+        chunks_cv.wait(lock, [this]() { return shutdown || !full_chunks.empty(); });
+        if(full_chunks.empty()) {
+            return;
+        }
+        auto [chunk, size] = std::move(full_chunks.front());
+        full_chunks.pop_front();
+        // After a failed write, drain the queue without sending so the writer doesn't block forever
+        if(!write_error) {
+            lock.unlock();
+            try {
+                sock.write(chunk.get(), size);
+            } catch(tcp::socket_error&) {
+                lock.lock();
+                write_error = std::current_exception();
+                lock.unlock();
+            }
+            lock.lock();
+        }
+        free_chunks.emplace_back(std::move(chunk));
+        chunks_cv.notify_all();
+    }
+}
+
+void PipelinedSocketWriter::submit_current_chunk() {
+    std::unique_lock<std::mutex> lock(chunks_mutex);
+    full_chunks.emplace_back(std::move(current_chunk), current_chunk_used);
+    chunks_cv.notify_all();
+    chunks_cv.wait(lock, [this]() { return !free_chunks.empty(); });
+    current_chunk = std::move(free_chunks.front());
+    free_chunks.pop_front();
+    current_chunk_used = 0;
+    if(write_error) {
+        std::rethrow_exception(write_error);
+    }
+}
+
+void PipelinedSocketWriter::write(const uint8_t* bytes, std::size_t size) {
+    if(size >= chunk_size) {
+        // Copying a fragment this large into chunks saves no system calls, so once the
+        // sender thread is idle, send it straight from the caller's memory along with
+        // the partially-filled chunk
+        std::unique_lock<std::mutex> lock(chunks_mutex);
+        chunks_cv.wait(lock, [this]() { return free_chunks.size() + 1 == num_chunks; });
+        if(write_error) {
+            std::rethrow_exception(write_error);
+        }
+        lock.unlock();
+        struct iovec buffers[2] = {{current_chunk.get(), current_chunk_used},
+                                   {const_cast<uint8_t*>(bytes), size}};
+        current_chunk_used = 0;
+        sock.writev(buffers, 2);
+        return;
+    }
+    while(size > 0) {
+        const std::size_t copy_size = std::min(size, chunk_size - current_chunk_used);
+        std::memcpy(current_chunk.get() + current_chunk_used, bytes, copy_size);
+        current_chunk_used += copy_size;
+        bytes += copy_size;
+        size -= copy_size;
+        if(current_chunk_used == chunk_size) {
+            submit_current_chunk();
+        }
+    }
+}
+
+void PipelinedSocketWriter::flush() {
+    if(current_chunk_used > 0) {
+        submit_current_chunk();
+    }
+    std::unique_lock<std::mutex> lock(chunks_mutex);
+    // Every chunk other than current_chunk is free once the sender thread is done with them
+    chunks_cv.wait(lock, [this]() { return free_chunks.size() + 1 == num_chunks; });
+    if(write_error) {
+        std::rethrow_exception(write_error);
+    }
+}
+
+}  // namespace derecho
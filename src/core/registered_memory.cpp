@@ -0,0 +1,241 @@
+#include <derecho/core/detail/registered_memory.hpp>
+
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/detail/multi_rail.hpp>
+#include <derecho/utils/logger.hpp>
+
+#include <atomic>
+#include <climits>
+#include <linux/mempolicy.h>
+#include <map>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace derecho {
+
+/** The pages that back registered memory */
+enum class page_policy {
+    NORMAL,
+    TRANSPARENT,
+    HUGE_2MB,
+    HUGE_1GB
+};
+
+struct registered_memory_settings {
+    page_policy pages;
+    /** The NUMA node to place memory on, or -1 to leave it to the kernel */
+    int numa_node;
+};
+
+constexpr std::size_t transparent_huge_page_size = 2 << 20;
+
+static std::atomic<uint64_t> allocations{0};
+static std::atomic<uint64_t> huge_page_bytes{0};
+static std::atomic<uint64_t> transparent_huge_page_bytes{0};
+static std::atomic<uint64_t> normal_page_bytes{0};
+static std::atomic<uint64_t> huge_page_fallbacks{0};
+static std::atomic<uint64_t> numa_bound_bytes{0};
+static std::atomic<uint64_t> bytes_in_use{0};
+
+/** The mapping length of every live allocation, by start address */
+static std::map<uintptr_t, std::size_t> live_allocations;
+static std::mutex live_allocations_mutex;
+
+static registered_memory_settings load_settings() {
+    registered_memory_settings settings;
+    const std::string pages = getConfString(Conf::DERECHO_REGISTERED_MEMORY_PAGES);
+    if(pages == "normal") {
+        settings.pages = page_policy::NORMAL;
+    } else if(pages == "transparent") {
+        settings.pages = page_policy::TRANSPARENT;
+    } else if(pages == "2mb") {
+        settings.pages = page_policy::HUGE_2MB;
+    } else if(pages == "1gb") {
+        settings.pages = page_policy::HUGE_1GB;
+    } else {
+        dbg_default_error("Unknown registered_memory_pages setting {}; using transparent huge pages", pages);
+        settings.pages = page_policy::TRANSPARENT;
+    }
+
+    const std::string numa_node = getConfString(Conf::DERECHO_REGISTERED_MEMORY_NUMA_NODE);
+    settings.numa_node = -1;
+    if(numa_node == "auto") {
+        try {
+            std::vector<RailConfig> rails = get_configured_rails();
+            if(!rails.empty()) {
+                settings.numa_node = get_rail_numa_node(rails.front().domain);
+            }
+        } catch(std::invalid_argument&) {
+            // The rail configuration is reported when RDMC and the SST start
+        }
+    } else if(numa_node != "none") {
+        try {
+            settings.numa_node = std::stoi(numa_node);
+        } catch(std::logic_error&) {
+            dbg_default_error("Unknown registered_memory_numa_node setting {}; not binding memory to a NUMA node", numa_node);
+        }
+    }
+    dbg_default_debug("Registered memory uses {} pages and NUMA node {}", pages, settings.numa_node);
+    return settings;
+}
+
+static const registered_memory_settings& get_settings() {
+    static const registered_memory_settings settings = load_settings();
+    return settings;
+}
+
+/** The smallest allocation that is given explicit huge pages of 2^size_shift bytes: half a page */
+static std::size_t explicit_huge_page_threshold(int size_shift) {
+    return (std::size_t{1} << size_shift) / 2;
+}
+
+static std::size_t round_up(std::size_t size, std::size_t multiple) {
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+/** Maps anonymous memory, or returns nullptr if it can't. */
+static uint8_t* map_anonymous(std::size_t length, int extra_flags) {
+    void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+    return mapping == MAP_FAILED ? nullptr : static_cast<uint8_t*>(mapping);
+}
+
+/**
+ * Maps anonymous memory that starts on a multiple of alignment, by mapping
+ * extra and unmapping the ends, since the kernel can only use transparent
+ * huge pages for aligned memory.
+ */
+static uint8_t* map_aligned(std::size_t length, std::size_t alignment) {
+    const std::size_t page_size = sysconf(_SC_PAGESIZE);
+    uint8_t* mapping = map_anonymous(length + alignment - page_size, 0);
+    if(!mapping) {
+        return nullptr;
+    }
+    uint8_t* aligned = reinterpret_cast<uint8_t*>(round_up(reinterpret_cast<uintptr_t>(mapping), alignment));
+    if(aligned > mapping) {
+        munmap(mapping, aligned - mapping);
+    }
+    const std::size_t tail = (mapping + length + alignment - page_size) - (aligned + length);
+    if(tail > 0) {
+        munmap(aligned + length, tail);
+    }
+    return aligned;
+}
+
+/** Asks the kernel to place memory on a NUMA node, if it has one. */
+static bool bind_to_numa_node(uint8_t* buffer, std::size_t length, int node) {
+    constexpr std::size_t bits_per_word = sizeof(unsigned long) * CHAR_BIT;
+    std::vector<unsigned long> node_mask(node / bits_per_word + 1, 0);
+    node_mask[node / bits_per_word] = 1ul << (node % bits_per_word);
+    // Preferred rather than bound, so the allocation still succeeds if the node is full
+    return syscall(SYS_mbind, buffer, length, MPOL_PREFERRED, node_mask.data(),
+                   node_mask.size() * bits_per_word + 1, 0)
+           == 0;
+}
+
+void registered_memory_deleter::operator()(const volatile void* buffer) const {
+    if(buffer) {
+        {
+            std::lock_guard<std::mutex> lock(live_allocations_mutex);
+            live_allocations.erase(reinterpret_cast<uintptr_t>(buffer));
+        }
+        munmap(const_cast<void*>(buffer), mapping_length);
+        bytes_in_use -= mapping_length;
+    }
+}
+
+registered_array<uint8_t> allocate_registered_memory(std::size_t size) {
+    if(size == 0) {
+        return nullptr;
+    }
+    const registered_memory_settings& settings = get_settings();
+    const std::size_t page_size = sysconf(_SC_PAGESIZE);
+    uint8_t* buffer = nullptr;
+    std::size_t mapping_length = 0;
+    page_policy pages = settings.pages;
+    if(pages == page_policy::HUGE_2MB || pages == page_policy::HUGE_1GB) {
+        const int size_shift = pages == page_policy::HUGE_2MB ? 21 : 30;
+        if(size < explicit_huge_page_threshold(size_shift)) {
+            // Rounding a small buffer up to a whole reserved huge page would waste more than the
+            // buffer uses, and run out of reserved pages long before the memory is actually used
+            pages = page_policy::TRANSPARENT;
+        }
+    }
+    if(pages == page_policy::HUGE_2MB || pages == page_policy::HUGE_1GB) {
+        const int size_shift = pages == page_policy::HUGE_2MB ? 21 : 30;
+        mapping_length = round_up(size, std::size_t{1} << size_shift);
+        buffer = map_anonymous(mapping_length, MAP_HUGETLB | (size_shift << MAP_HUGE_SHIFT));
+        if(buffer) {
+            huge_page_bytes += mapping_length;
+        } else {
+            if(huge_page_fallbacks++ == 0) {
+                dbg_default_warn("Could not map {} bytes of {} huge pages; using transparent huge pages instead. "
+                                 "Check /sys/kernel/mm/hugepages for free pages.",
+                                 mapping_length, pages == page_policy::HUGE_2MB ? "2 MB" : "1 GB");
+            }
+            pages = page_policy::TRANSPARENT;
+        }
+    }
+    if(!buffer) {
+        mapping_length = round_up(size, page_size);
+        if(pages == page_policy::TRANSPARENT && mapping_length >= transparent_huge_page_size) {
+            buffer = map_aligned(mapping_length, transparent_huge_page_size);
+            // Without transparent huge pages in the kernel this fails, and the memory uses normal pages
+            if(buffer && madvise(buffer, mapping_length, MADV_HUGEPAGE) == 0) {
+                transparent_huge_page_bytes += mapping_length;
+            } else if(buffer) {
+                normal_page_bytes += mapping_length;
+            }
+        } else {
+            buffer = map_anonymous(mapping_length, 0);
+            if(buffer) {
+                normal_page_bytes += mapping_length;
+            }
+        }
+    }
+    if(!buffer) {
+        throw std::bad_alloc();
+    }
+    // The pages are only allocated when first touched, so this is in time
+    if(settings.numa_node >= 0 && bind_to_numa_node(buffer, mapping_length, settings.numa_node)) {
+        numa_bound_bytes += mapping_length;
+    }
+    allocations++;
+    bytes_in_use += mapping_length;
+    {
+        std::lock_guard<std::mutex> lock(live_allocations_mutex);
+        live_allocations[reinterpret_cast<uintptr_t>(buffer)] = mapping_length;
+    }
+    return registered_array<uint8_t>(buffer, registered_memory_deleter{mapping_length});
+}
+
+bool is_registered_memory(const void* addr, std::size_t size) {
+    const uintptr_t start = reinterpret_cast<uintptr_t>(addr);
+    std::lock_guard<std::mutex> lock(live_allocations_mutex);
+    // The last allocation that starts at or before the range is the only one that can contain it
+    auto allocation = live_allocations.upper_bound(start);
+    if(allocation == live_allocations.begin()) {
+        return false;
+    }
+    --allocation;
+    return start + size <= allocation->first + allocation->second;
+}
+
+registered_memory_statistics get_registered_memory_statistics() {
+    registered_memory_statistics stats;
+    stats.allocations = allocations;
+    stats.huge_page_bytes = huge_page_bytes;
+    stats.transparent_huge_page_bytes = transparent_huge_page_bytes;
+    stats.normal_page_bytes = normal_page_bytes;
+    stats.huge_page_fallbacks = huge_page_fallbacks;
+    stats.numa_bound_bytes = numa_bound_bytes;
+    stats.bytes_in_use = bytes_in_use;
+    return stats;
+}
+
+}  // namespace derecho
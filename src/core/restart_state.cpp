@@ -1,5 +1,6 @@
 #include <derecho/core/detail/restart_state.hpp>
 
+#include <derecho/core/detail/vectored_socket_writer.hpp>
 #include <derecho/core/detail/version_code.hpp>
 #include <derecho/utils/container_template_functions.hpp>
 #include <derecho/utils/logger.hpp>
@@ -7,8 +8,12 @@
 #include <derecho/core/detail/view_manager.hpp>
 #include <derecho/persistent/Persistent.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <list>
+#include <mutex>
 #include <optional>
+#include <thread>
 
 namespace derecho {
 
@@ -111,79 +116,62 @@ RestartLeaderState::RestartLeaderState(std::unique_ptr<View> _curr_view, Restart
 
 void RestartLeaderState::await_quorum(tcp::connection_listener& server_socket) {
     bool ready_to_restart = false;
+    bool all_members_rejoined = false;
     int time_remaining_ms = getConfUInt32(Conf::DERECHO_RESTART_TIMEOUT_MS);
-    while(time_remaining_ms > 0) {
+    //Each rejoining node is received on its own thread, so a node with large logs
+    //or a slow connection doesn't hold up the others. The threads leave their
+    //results in received_rejoins, and this thread merges them.
+    std::mutex received_rejoins_mutex;
+    std::list<RejoinedNode> received_rejoins;
+    std::vector<std::thread> rejoin_threads;
+    auto merge_received_rejoins = [&]() {
+        std::list<RejoinedNode> new_rejoins;
+        {
+            std::lock_guard<std::mutex> lock(received_rejoins_mutex);
+            new_rejoins.splice(new_rejoins.end(), received_rejoins);
+        }
+        if(new_rejoins.empty()) {
+            return;
+        }
+        for(RejoinedNode& rejoined : new_rejoins) {
+            merge_joiner_logs(std::move(rejoined));
+        }
+        //Check for quorum once per batch of rejoined nodes
+        ready_to_restart = has_restart_quorum();
+        all_members_rejoined = std::includes(rejoined_node_ids.begin(), rejoined_node_ids.end(),
+                                             last_known_view_members.begin(), last_known_view_members.end());
+    };
+    while(time_remaining_ms > 0 && !all_members_rejoined) {
         using namespace std::chrono;
         auto start_time = high_resolution_clock::now();
-        std::optional<tcp::socket> client_socket = server_socket.try_accept(time_remaining_ms);
+        std::optional<tcp::socket> client_socket = server_socket.try_accept(
+                std::min(time_remaining_ms, rejoin_poll_interval_ms));
+        if(client_socket) {
+            rejoin_threads.emplace_back([this, &received_rejoins_mutex, &received_rejoins](tcp::socket socket) {
+                std::optional<RejoinedNode> rejoined = receive_rejoin(std::move(socket));
+                if(rejoined) {
+                    std::lock_guard<std::mutex> lock(received_rejoins_mutex);
+                    received_rejoins.emplace_back(std::move(*rejoined));
+                }
+            },
+                                        std::move(*client_socket));
+        }
+        merge_received_rejoins();
         auto end_time = high_resolution_clock::now();
         milliseconds time_waited = duration_cast<milliseconds>(end_time - start_time);
         time_remaining_ms -= time_waited.count();
-        if(client_socket) {
-            uint64_t joiner_version_code;
-            client_socket->exchange(my_version_hashcode, joiner_version_code);
-            if(joiner_version_code != my_version_hashcode) {
-                rls_warn(vm_logger, "Rejected a connection from node at {}. Node was running on an incompatible platform or used an incompatible compiler.", client_socket->get_remote_ip());
-                continue;
-            }
-            JoinRequest join_request;
-            try {
-                client_socket->read(join_request);
-                client_socket->write(JoinResponse{JoinResponseCode::TOTAL_RESTART, my_id});
-            } catch(tcp::socket_error& ex) {
-                dbg_debug(vm_logger, "Node at {} disconnected before completing initial handshake", client_socket->get_remote_ip());
-                dbg_trace(vm_logger, "Exception description: {}", ex.what());
-                continue;
-            }
-            dbg_debug(vm_logger, "Node {} rejoined", join_request.joiner_id);
-            if(join_request.is_external) {
-                dbg_debug(vm_logger, "Rejected request from external client {} during total restart", join_request.joiner_id);
-                continue;
-            }
-            rejoined_node_ids.emplace(join_request.joiner_id);
-            //Receive the joining node's ports - this is part of the standard join logic
-            uint16_t joiner_gms_port = 0;
-            uint16_t joiner_state_transfer_port = 0;
-            uint16_t joiner_sst_port = 0;
-            uint16_t joiner_rdmc_port = 0;
-            uint16_t joiner_external_port = 0;
-            try {
-                client_socket->read(joiner_gms_port);
-                client_socket->read(joiner_state_transfer_port);
-                client_socket->read(joiner_sst_port);
-                client_socket->read(joiner_rdmc_port);
-                client_socket->read(joiner_external_port);
-            } catch(tcp::socket_error& ex) {
-                dbg_debug(vm_logger, "Node {} disconnected while sending its port information", join_request.joiner_id);
-                dbg_trace(vm_logger, "Exception in socket connected to node {}: {}", join_request.joiner_id, ex.what());
-                rejoined_node_ids.erase(join_request.joiner_id);
-                continue;
-            }
-            //Receive and process the joining node's logs of the last known View and RaggedTrim
-            bool received = receive_joiner_logs(join_request.joiner_id, *client_socket);
-            if(!received) {
-                rejoined_node_ids.erase(join_request.joiner_id);
-                continue;
-            }
-
-            const ip_addr_t& joiner_ip = client_socket->get_remote_ip();
-            rejoined_node_ips_and_ports[join_request.joiner_id] = {joiner_ip, joiner_gms_port,
-                                                                   joiner_state_transfer_port, joiner_sst_port,
-                                                                   joiner_rdmc_port, joiner_external_port};
-            //Done receiving from this socket (for now), so store it in waiting_join_sockets for later
-            waiting_join_sockets.emplace(join_request.joiner_id, std::move(*client_socket));
-            //Check for quorum
-            ready_to_restart = has_restart_quorum();
-            //If all the members have rejoined, no need to keep waiting
-            if(std::includes(rejoined_node_ids.begin(), rejoined_node_ids.end(),
-                             last_known_view_members.begin(), last_known_view_members.end())) {
-                return;
-            }
-        } else if(!ready_to_restart) {
-            //Accept timed out, but we haven't heard from enough nodes yet, so reset the timer
+        if(time_remaining_ms <= 0 && !ready_to_restart) {
+            //We haven't heard from enough nodes yet, so reset the timer
             time_remaining_ms = getConfUInt32(Conf::DERECHO_RESTART_TIMEOUT_MS);
         }
     }
+    //Finish receiving from any nodes that were still sending their logs. Their
+    //sockets have the control-plane timeout set, so a stalled node can only delay
+    //this by that long before its thread gives up on it.
+    for(std::thread& rejoin_thread : rejoin_threads) {
+        rejoin_thread.join();
+    }
+    merge_received_rejoins();
 }
 
 bool RestartLeaderState::has_restart_quorum() {
@@ -203,36 +191,83 @@ bool RestartLeaderState::has_restart_quorum() {
     return compute_restart_view();
 }
 
-bool RestartLeaderState::receive_joiner_logs(const node_id_t& joiner_id, tcp::socket& client_socket) {
+std::optional<RestartLeaderState::RejoinedNode> RestartLeaderState::receive_rejoin(tcp::socket client_socket) {
+    uint64_t joiner_version_code;
+    JoinRequest join_request;
+    try {
+        //Bound every read and write during the rejoin, so a node that stalls while
+        //sending its logs is dropped instead of holding up await_quorum's final join
+        client_socket.set_timeout(getConfUInt32(Conf::DERECHO_CONTROL_PLANE_TIMEOUT_MS));
+        client_socket.exchange(my_version_hashcode, joiner_version_code);
+        if(joiner_version_code != my_version_hashcode) {
+            rls_warn(vm_logger, "Rejected a connection from node at {}. Node was running on an incompatible platform or used an incompatible compiler.", client_socket.get_remote_ip());
+            return std::nullopt;
+        }
+        client_socket.read(join_request);
+        client_socket.write(JoinResponse{JoinResponseCode::TOTAL_RESTART, my_id});
+    } catch(tcp::socket_error& ex) {
+        dbg_debug(vm_logger, "Node at {} disconnected before completing initial handshake", client_socket.get_remote_ip());
+        dbg_trace(vm_logger, "Exception description: {}", ex.what());
+        return std::nullopt;
+    }
+    dbg_debug(vm_logger, "Node {} rejoined", join_request.joiner_id);
+    if(join_request.is_external) {
+        dbg_debug(vm_logger, "Rejected request from external client {} during total restart", join_request.joiner_id);
+        return std::nullopt;
+    }
+    //Receive the joining node's ports - this is part of the standard join logic
+    uint16_t joiner_gms_port = 0;
+    uint16_t joiner_state_transfer_port = 0;
+    uint16_t joiner_sst_port = 0;
+    uint16_t joiner_rdmc_port = 0;
+    uint16_t joiner_external_port = 0;
+    try {
+        client_socket.read(joiner_gms_port);
+        client_socket.read(joiner_state_transfer_port);
+        client_socket.read(joiner_sst_port);
+        client_socket.read(joiner_rdmc_port);
+        client_socket.read(joiner_external_port);
+    } catch(tcp::socket_error& ex) {
+        dbg_debug(vm_logger, "Node {} disconnected while sending its port information", join_request.joiner_id);
+        dbg_trace(vm_logger, "Exception in socket connected to node {}: {}", join_request.joiner_id, ex.what());
+        return std::nullopt;
+    }
+    const ip_addr_t joiner_ip = client_socket.get_remote_ip();
+    RejoinedNode rejoined{join_request.joiner_id,
+                          {joiner_ip, joiner_gms_port, joiner_state_transfer_port, joiner_sst_port,
+                           joiner_rdmc_port, joiner_external_port},
+                          std::move(client_socket),
+                          nullptr,
+                          {}};
+    //Receive the joining node's logs of the last known View and RaggedTrim
+    if(!receive_joiner_logs(rejoined)) {
+        return std::nullopt;
+    }
+    //The rest of the restart protocol may legitimately wait longer on this socket
+    try {
+        rejoined.socket.set_timeout(0);
+    } catch(tcp::socket_error& ex) {
+        dbg_debug(vm_logger, "Failed to clear the timeout on the socket to node {}: {}", rejoined.id, ex.what());
+        return std::nullopt;
+    }
+    return rejoined;
+}
+
+bool RestartLeaderState::receive_joiner_logs(RejoinedNode& rejoined) {
+    const node_id_t joiner_id = rejoined.id;
+    tcp::socket& client_socket = rejoined.socket;
     //Receive the joining node's saved View
-    std::unique_ptr<View> client_view;
     try {
         std::size_t size_of_view;
         client_socket.read(size_of_view);
-        uint8_t view_buffer[size_of_view];
-        client_socket.read(view_buffer, size_of_view);
-        client_view = mutils::from_bytes<View>(nullptr, view_buffer);
+        std::vector<uint8_t> view_buffer(size_of_view);
+        client_socket.read(view_buffer.data(), size_of_view);
+        rejoined.logged_view = mutils::from_bytes<View>(nullptr, view_buffer.data());
     } catch(tcp::socket_error& ex) {
         dbg_debug(vm_logger, "Node {} disconnected before sending its view", joiner_id);
         dbg_trace(vm_logger, "Exception in socket to node {}: {}", joiner_id, ex.what());
         return false;
     }
-
-    if(client_view->vid > curr_view->vid) {
-        dbg_trace(vm_logger, "Node {} had newer view {}, replacing view {} and discarding ragged trim",
-                  joiner_id, client_view->vid, curr_view->vid);
-        //The joining node has a newer View, so discard any ragged trims that are not longest-log records
-        for(auto& subgroup_to_map : restart_state.logged_ragged_trim) {
-            auto trim_map_iterator = subgroup_to_map.second.begin();
-            while(trim_map_iterator != subgroup_to_map.second.end()) {
-                if(trim_map_iterator->second->leader_id != -1) {
-                    trim_map_iterator = subgroup_to_map.second.erase(trim_map_iterator);
-                } else {
-                    ++trim_map_iterator;
-                }
-            }
-        }
-    }
     //Receive the joining node's RaggedTrims
     std::size_t num_of_ragged_trims;
     try {
@@ -243,20 +278,47 @@ bool RestartLeaderState::receive_joiner_logs(const node_id_t& joiner_id, tcp::so
         return false;
     }
     for(std::size_t i = 0; i < num_of_ragged_trims; ++i) {
-        std::unique_ptr<RaggedTrim> ragged_trim;
         try {
             std::size_t size_of_ragged_trim;
             client_socket.read(size_of_ragged_trim);
-            uint8_t buffer[size_of_ragged_trim];
-            client_socket.read(buffer, size_of_ragged_trim);
-            ragged_trim = mutils::from_bytes<RaggedTrim>(nullptr, buffer);
+            std::vector<uint8_t> buffer(size_of_ragged_trim);
+            client_socket.read(buffer.data(), size_of_ragged_trim);
+            rejoined.ragged_trims.emplace_back(mutils::from_bytes<RaggedTrim>(nullptr, buffer.data()));
         } catch(tcp::socket_error& ex) {
             dbg_debug(vm_logger, "Node {} disconnected while sending its ragged trims", joiner_id);
             dbg_trace(vm_logger, "Exception in socket to node {}: {}", joiner_id, ex.what());
             return false;
         }
         dbg_trace(vm_logger, "Received ragged trim for subgroup {}, shard {} from node {}",
-                  ragged_trim->subgroup_id, ragged_trim->shard_num, joiner_id);
+                  rejoined.ragged_trims.back()->subgroup_id, rejoined.ragged_trims.back()->shard_num, joiner_id);
+    }
+    return true;
+}
+
+void RestartLeaderState::merge_joiner_logs(RejoinedNode&& rejoined) {
+    const node_id_t joiner_id = rejoined.id;
+    std::unique_ptr<View>& client_view = rejoined.logged_view;
+    rejoined_node_ids.emplace(joiner_id);
+    rejoined_node_ips_and_ports[joiner_id] = rejoined.ips_and_ports;
+    //Done receiving from this socket (for now), so store it in waiting_join_sockets for later
+    waiting_join_sockets.emplace(joiner_id, std::move(rejoined.socket));
+
+    if(client_view->vid > curr_view->vid) {
+        dbg_trace(vm_logger, "Node {} had newer view {}, replacing view {} and discarding ragged trim",
+                  joiner_id, client_view->vid, curr_view->vid);
+        //The joining node has a newer View, so discard any ragged trims that are not longest-log records
+        for(auto& subgroup_to_map : restart_state.logged_ragged_trim) {
+            auto trim_map_iterator = subgroup_to_map.second.begin();
+            while(trim_map_iterator != subgroup_to_map.second.end()) {
+                if(trim_map_iterator->second->leader_id != -1) {
+                    trim_map_iterator = subgroup_to_map.second.erase(trim_map_iterator);
+                } else {
+                    ++trim_map_iterator;
+                }
+            }
+        }
+    }
+    for(std::unique_ptr<RaggedTrim>& ragged_trim : rejoined.ragged_trims) {
         /* If the joining node has an obsolete View, we only care about the
          * "ragged trims" if they are actually longest-log records and from
          * a newer view than any ragged trims we have for this subgroup. */
@@ -299,7 +361,6 @@ bool RestartLeaderState::receive_joiner_logs(const node_id_t& joiner_id, tcp::so
         last_known_view_members.clear();
         last_known_view_members.insert(curr_view->members.begin(), curr_view->members.end());
     }
-    return true;
 }
 
 bool RestartLeaderState::compute_restart_view() {
@@ -312,32 +373,29 @@ int64_t RestartLeaderState::send_restart_view() {
     members_sent_restart_view.clear();
     for(auto waiting_sockets_iter = waiting_join_sockets.begin();
         waiting_sockets_iter != waiting_join_sockets.end();) {
-        std::size_t view_buffer_size = mutils::bytes_size(*restart_view);
-        std::size_t leaders_buffer_size = mutils::bytes_size(nodes_with_longest_log);
-        uint8_t view_buffer[view_buffer_size];
-        uint8_t leaders_buffer[leaders_buffer_size];
         try {
+            //The view, ragged trims, and leader locations are gathered into as few writes as possible
+            VectoredSocketWriter socket_writer(waiting_sockets_iter->second);
+            auto bind_socket_write = [&socket_writer](const uint8_t* bytes, std::size_t size) {
+                socket_writer.write(bytes, size);
+            };
             dbg_debug(vm_logger, "Sending post-recovery view {} to node {}", restart_view->vid, waiting_sockets_iter->first);
-            waiting_sockets_iter->second.write(view_buffer_size);
-            mutils::to_bytes(*restart_view, view_buffer);
-            waiting_sockets_iter->second.write(view_buffer, view_buffer_size);
+            socket_writer.write(mutils::bytes_size(*restart_view));
+            mutils::post_object(bind_socket_write, *restart_view);
             dbg_debug(vm_logger, "Sending ragged-trim information to node {}", waiting_sockets_iter->first);
             std::size_t num_ragged_trims = multimap_size(restart_state.logged_ragged_trim);
-            waiting_sockets_iter->second.write(num_ragged_trims);
+            socket_writer.write(num_ragged_trims);
             //Unroll the maps and send each RaggedTrim individually, since it contains its subgroup_id and shard_num
             for(const auto& subgroup_to_shard_map : restart_state.logged_ragged_trim) {
                 for(const auto& shard_trim_pair : subgroup_to_shard_map.second) {
-                    std::size_t trim_buffer_size = mutils::bytes_size(*shard_trim_pair.second);
-                    uint8_t trim_buffer[trim_buffer_size];
-                    waiting_sockets_iter->second.write(trim_buffer_size);
-                    mutils::to_bytes(*shard_trim_pair.second, trim_buffer);
-                    waiting_sockets_iter->second.write(trim_buffer, trim_buffer_size);
+                    socket_writer.write(mutils::bytes_size(*shard_trim_pair.second));
+                    mutils::post_object(bind_socket_write, *shard_trim_pair.second);
                 }
             }
             dbg_debug(vm_logger, "Sending longest-log locations to node {}", waiting_sockets_iter->first);
-            waiting_sockets_iter->second.write(leaders_buffer_size);
-            mutils::to_bytes(nodes_with_longest_log, leaders_buffer);
-            waiting_sockets_iter->second.write(leaders_buffer, leaders_buffer_size);
+            socket_writer.write(mutils::bytes_size(nodes_with_longest_log));
+            mutils::post_object(bind_socket_write, nodes_with_longest_log);
+            socket_writer.flush();
             members_sent_restart_view.emplace(waiting_sockets_iter->first);
             waiting_sockets_iter++;
         } catch(tcp::socket_error& e) {
@@ -8,6 +8,7 @@
 #include <derecho/core/detail/view_manager.hpp>
 
 #include <cassert>
+#include <cstring>
 #include <exception>
 #include <functional>
 #include <iostream>
@@ -59,10 +60,15 @@ void RPCManager::create_connections() {
     connections = std::make_unique<sst::P2PConnectionManager>(sst::P2PParams{
             nid,
             getConfUInt32(Conf::DERECHO_P2P_WINDOW_SIZE),
+            getConfUInt32(Conf::DERECHO_P2P_OVERFLOW_QUEUE_SIZE),
             view_manager.view_max_rpc_window_size,
             getConfUInt64(Conf::DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE) + sizeof(header),
             getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE) + sizeof(header),
             view_manager.view_max_rpc_reply_payload_size + sizeof(header),
+            getConfUInt32(Conf::DERECHO_EXTERNAL_P2P_WINDOW_SIZE),
+            getConfUInt64(Conf::DERECHO_MAX_EXTERNAL_P2P_PAYLOAD_SIZE)
+                    ? getConfUInt64(Conf::DERECHO_MAX_EXTERNAL_P2P_PAYLOAD_SIZE) + sizeof(header)
+                    : 0,
             false,
             [this](const uint32_t node_id) { report_failure(node_id); }});
 }
@@ -176,6 +182,8 @@ void RPCManager::rpc_message_handler(subgroup_id_t subgroup_id, node_id_t sender
     if(sender_id == nid) {
         //This is a self-receive of an RPC message I sent, so I have a reply-map that needs fulfilling
         const uint32_t my_shard = view_manager.unsafe_get_current_view().my_subgroups.at(subgroup_id);
+        std::shared_ptr<AbstractPendingResults> pending_results;
+        bool tracking_persistence = false;
         {
             whenlog(int32_t msg_seq_num = persistent::unpack_version<int32_t>(version).second);
             dbg_trace(rpc_logger, "RPCManager got a self-receive for message {}", msg_seq_num);
@@ -185,15 +193,13 @@ void RPCManager::rpc_message_handler(subgroup_id_t subgroup_id, node_id_t sender
             // thread that called the orderedSend signal us
             // although the race condition is infinitely rare
             pending_results_cv.wait(lock, [&]() { return !pending_results_to_fulfill[subgroup_id].empty(); });
-            std::shared_ptr<AbstractPendingResults> pending_results = pending_results_to_fulfill[subgroup_id].front().lock();
+            pending_results = pending_results_to_fulfill[subgroup_id].front().lock();
             if(pending_results) {
-                //We now know the membership of "all nodes in my shard of the subgroup" in the current view
-                pending_results->fulfill_map(
-                        view_manager.unsafe_get_current_view().subgroup_shard_views.at(subgroup_id).at(my_shard).members);
-                pending_results->set_persistent_version(version, timestamp);
-                //Move the fulfilled PendingResults to either the "completed" list or the "awaiting persistence" list
-                //(but move the weak_ptr, not the shared_ptr)
-                if(view_manager.subgroup_is_persistent(subgroup_id)) {
+                //Move the PendingResults to either the "completed" list or the "awaiting persistence" list
+                //(but move the weak_ptr, not the shared_ptr). If the caller opted out of persistence events,
+                //there is no need to track this version through the persistence maps.
+                tracking_persistence = view_manager.subgroup_is_persistent(subgroup_id) && pending_results->tracks_persistence();
+                if(tracking_persistence) {
                     results_awaiting_local_persistence[subgroup_id].emplace(version,
                                                                             pending_results_to_fulfill[subgroup_id].front());
                 } else {
@@ -205,6 +211,16 @@ void RPCManager::rpc_message_handler(subgroup_id_t subgroup_id, node_id_t sender
             //Regardless of whether the weak_ptr was valid, delete the entry because we're done with it
             pending_results_to_fulfill[subgroup_id].pop();
         }  //release pending_results_mutex
+        //Fulfill the PendingResults outside the lock, since this may run the caller's completion callbacks
+        if(pending_results) {
+            //We now know the membership of "all nodes in my shard of the subgroup" in the current view
+            pending_results->fulfill_map(
+                    view_manager.unsafe_get_current_view().subgroup_shard_views.at(subgroup_id).at(my_shard).members);
+            pending_results->set_persistent_version(version, timestamp);
+            if(!tracking_persistence) {
+                pending_results->end_persistence_events();
+            }
+        }
         if(reply_size > 0) {
             // Since this was a self-receive, the reply also goes to myself.
             // Note that we pass the outgoing buffer obtained from connections->get_sendbuffer_ptr()
@@ -235,11 +251,17 @@ void RPCManager::p2p_message_handler(node_id_t sender_id, uint8_t* msg_buf) {
     dbg_trace(rpc_logger, "Handling a P2P message: function_id = {}, is_reply = {}, received_from = {}, payload_size = {}, invocation_id = {}",
               indx.function_id, indx.is_reply, received_from, payload_size, ((long*)(msg_buf + header_size))[0]);
     if(indx.is_reply) {
+        if(RPC_HEADER_FLAG_TST(flags, RENDEZVOUS)) {
+            // An oversized reply must be read from the sender's memory, which can take a
+            // while, so the worker reads and handles it. Only the descriptor is needed,
+            // since this P2P message buffer is reused once this function returns.
+            std::lock_guard<std::mutex> lock(rendezvous_reply_mutex);
+            rendezvous_reply_queue.push(rendezvous_reply{sender_id, retrieve_rendezvous_descriptor(msg_buf)});
+            rendezvous_reply_cv.notify_one();
+            return;
+        }
         // REPLYs can be handled here because they do not block.
-        receive_message(indx, received_from, msg_buf + header_size, payload_size,
-                        [](size_t _size) -> uint8_t* {
-                            throw derecho::derecho_exception("A P2P reply message attempted to generate another reply");
-                        });
+        handle_p2p_reply(sender_id, msg_buf);
     } else if(RPC_HEADER_FLAG_TST(flags, CASCADE)) {
         // TODO: what is the lifetime of msg_buf? discuss with Sagar to make
         // sure the buffers are safely managed.
@@ -253,6 +275,61 @@ void RPCManager::p2p_message_handler(node_id_t sender_id, uint8_t* msg_buf) {
     }
 }
 
+void RPCManager::handle_p2p_reply(node_id_t sender_id, uint8_t* msg_buf) {
+    using namespace remote_invocation_utilities;
+    std::size_t payload_size;
+    Opcode indx;
+    node_id_t received_from;
+    uint32_t flags;
+    retrieve_header(msg_buf, payload_size, indx, received_from, flags);
+    if(RPC_HEADER_FLAG_TST(flags, STALE_VIEW)) {
+        // Members only address nodes in the current View, so this can only be a
+        // race with a view change, which will clean up the pending query
+        dbg_debug(rpc_logger, "Node {} reported that it does not host subgroup {}; ignoring its reply",
+                  sender_id, indx.subgroup_id);
+        return;
+    }
+    receive_message(indx, received_from, msg_buf + header_space(), payload_size,
+                    [](size_t _size) -> uint8_t* {
+                        throw derecho::derecho_exception("A P2P reply message attempted to generate another reply");
+                    });
+}
+
+void RPCManager::rendezvous_reply_worker() {
+    pthread_setname_np(pthread_self(), "p2p_rdv_wkr");
+    // Replies are handled as if on the listening thread
+    _in_rpc_handler = true;
+    rendezvous_reply reply;
+    while(!thread_shutdown) {
+        {
+            std::unique_lock<std::mutex> lock(rendezvous_reply_mutex);
+            rendezvous_reply_cv.wait(lock, [&]() { return !rendezvous_reply_queue.empty() || thread_shutdown; });
+            if(thread_shutdown) {
+                break;
+            }
+            reply = rendezvous_reply_queue.front();
+            rendezvous_reply_queue.pop();
+        }
+        sst::RendezvousReadBuffer reply_buf;
+        try {
+            reply_buf = read_rendezvous_message(reply.sender_id, sst::MESSAGE_TYPE::P2P_REPLY, reply.descriptor);
+        } catch(derecho_exception& ex) {
+            // If the sender failed, the pending query will get a node_removed_from_group_exception
+            dbg_error(rpc_logger, "Dropping a P2P reply from node {} because its rendezvous buffer could not be read: {}",
+                      reply.sender_id, ex.what());
+            continue;
+        }
+        // Hold the View lock while handling the reply, as the listening thread does
+        SharedLockedReference<View> view_and_lock = view_manager.get_current_view();
+        if(!connections->contains_node(reply.sender_id)) {
+            // The sender was removed while its reply was being read, and its pending queries were already given exceptions
+            dbg_debug(rpc_logger, "Dropping a P2P reply from node {}, which left the group while the reply was being read", reply.sender_id);
+            continue;
+        }
+        handle_p2p_reply(reply.sender_id, reply_buf.get());
+    }
+}
+
 //This is always called while holding a write lock on view_manager.view_mutex
 void RPCManager::new_view_callback(const View& new_view) {
     connections->remove_connections(new_view.departed);
@@ -357,62 +434,86 @@ void RPCManager::new_view_callback(const View& new_view) {
 
 void RPCManager::notify_persistence_finished(subgroup_id_t subgroup_id, persistent::version_t version) {
     dbg_trace(rpc_logger, "RPCManager: Got a local persistence callback for version {}", version);
-    std::lock_guard<std::mutex> lock(pending_results_mutex);
-    //PendingResults in each per-subgroup map are ordered by version number, so all entries before
-    //the argument version number have been persisted and need to be notified
-    for(auto pending_results_iter = results_awaiting_local_persistence[subgroup_id].begin();
-        pending_results_iter != results_awaiting_local_persistence[subgroup_id].upper_bound(version);) {
-        dbg_trace(rpc_logger, "RPCManager: Setting local persistence on version {}", pending_results_iter->first);
-        std::shared_ptr<AbstractPendingResults> live_pending_results = pending_results_iter->second.lock();
-        if(live_pending_results) {
-            live_pending_results->set_local_persistence();
-            //If the PendingResults still exists, move the pointer to results_awaiting_global_persistence
-            results_awaiting_global_persistence[subgroup_id].emplace(*pending_results_iter);
+    //Events are raised after releasing pending_results_mutex, since they may run completion callbacks
+    std::vector<std::shared_ptr<AbstractPendingResults>> persisted_results;
+    {
+        std::lock_guard<std::mutex> lock(pending_results_mutex);
+        //PendingResults in each per-subgroup map are ordered by version number, so all entries before
+        //the argument version number have been persisted and need to be notified
+        for(auto pending_results_iter = results_awaiting_local_persistence[subgroup_id].begin();
+            pending_results_iter != results_awaiting_local_persistence[subgroup_id].upper_bound(version);) {
+            dbg_trace(rpc_logger, "RPCManager: Setting local persistence on version {}", pending_results_iter->first);
+            std::shared_ptr<AbstractPendingResults> live_pending_results = pending_results_iter->second.lock();
+            if(live_pending_results) {
+                persisted_results.emplace_back(std::move(live_pending_results));
+                //If the PendingResults still exists, move the pointer to results_awaiting_global_persistence
+                results_awaiting_global_persistence[subgroup_id].emplace(*pending_results_iter);
+            }
+            pending_results_iter = results_awaiting_local_persistence[subgroup_id].erase(pending_results_iter);
         }
-        pending_results_iter = results_awaiting_local_persistence[subgroup_id].erase(pending_results_iter);
+    }
+    for(const auto& pending_results : persisted_results) {
+        pending_results->set_local_persistence();
     }
 }
 
 void RPCManager::notify_global_persistence_finished(subgroup_id_t subgroup_id, persistent::version_t version) {
     dbg_trace(rpc_logger, "RPCManager: Got a global persistence callback for version {}", version);
-    std::lock_guard<std::mutex> lock(pending_results_mutex);
-    //PendingResults in each per-subgroup map are ordered by version number, so all entries before
-    //the argument version number have been persisted and need to be notified
-    for(auto pending_results_iter = results_awaiting_global_persistence[subgroup_id].begin();
-        pending_results_iter != results_awaiting_global_persistence[subgroup_id].upper_bound(version);) {
-        dbg_trace(rpc_logger, "RPCManager: Setting global persistence on version {}", pending_results_iter->first);
-        std::shared_ptr<AbstractPendingResults> live_pending_results = pending_results_iter->second.lock();
-        if(live_pending_results) {
-            live_pending_results->set_global_persistence();
-            //If the subgroup needs signatures, move the pointer to results_awaiting_signature
-            if(view_manager.subgroup_is_signed(subgroup_id)) {
-                results_awaiting_signature[subgroup_id].emplace(*pending_results_iter);
+    //Pairs of (PendingResults, whether it still awaits a signature event)
+    std::vector<std::pair<std::shared_ptr<AbstractPendingResults>, bool>> persisted_results;
+    {
+        std::lock_guard<std::mutex> lock(pending_results_mutex);
+        //PendingResults in each per-subgroup map are ordered by version number, so all entries before
+        //the argument version number have been persisted and need to be notified
+        for(auto pending_results_iter = results_awaiting_global_persistence[subgroup_id].begin();
+            pending_results_iter != results_awaiting_global_persistence[subgroup_id].upper_bound(version);) {
+            dbg_trace(rpc_logger, "RPCManager: Setting global persistence on version {}", pending_results_iter->first);
+            std::shared_ptr<AbstractPendingResults> live_pending_results = pending_results_iter->second.lock();
+            if(live_pending_results) {
+                //If the subgroup needs signatures, move the pointer to results_awaiting_signature
+                const bool awaits_signature = view_manager.subgroup_is_signed(subgroup_id) && live_pending_results->tracks_persistence();
+                if(awaits_signature) {
+                    results_awaiting_signature[subgroup_id].emplace(*pending_results_iter);
+                }
+                //If not, no need to put the pointer in completed_pending_results, since all the replicas have
+                //responded by now, and completed_pending_results is only used for set_exception_for_removed_node
+                persisted_results.emplace_back(std::move(live_pending_results), awaits_signature);
             }
-            //If not, no need to put the pointer in completed_pending_results, since all the replicas have
-            //responded by now, and completed_pending_results is only used for set_exception_for_removed_node
+            pending_results_iter = results_awaiting_global_persistence[subgroup_id].erase(pending_results_iter);
+        }
+    }
+    for(const auto& pending_results_pair : persisted_results) {
+        pending_results_pair.first->set_global_persistence();
+        if(!pending_results_pair.second) {
+            pending_results_pair.first->end_persistence_events();
         }
-        pending_results_iter = results_awaiting_global_persistence[subgroup_id].erase(pending_results_iter);
     }
 }
 
 void RPCManager::notify_verification_finished(subgroup_id_t subgroup_id, persistent::version_t version) {
     dbg_trace(rpc_logger, "RPCManager: Got a global verification callback for version {}", version);
-    std::lock_guard<std::mutex> lock(pending_results_mutex);
-    for(auto pending_results_iter = results_awaiting_signature[subgroup_id].begin();
-        pending_results_iter != results_awaiting_signature[subgroup_id].upper_bound(version);) {
-        dbg_trace(rpc_logger, "RPCManager: Setting signature verification on version {}", pending_results_iter->first);
-        std::shared_ptr<AbstractPendingResults> live_pending_results = pending_results_iter->second.lock();
-        if(live_pending_results) {
-            live_pending_results->set_signature_verified();
+    std::vector<std::shared_ptr<AbstractPendingResults>> verified_results;
+    {
+        std::lock_guard<std::mutex> lock(pending_results_mutex);
+        for(auto pending_results_iter = results_awaiting_signature[subgroup_id].begin();
+            pending_results_iter != results_awaiting_signature[subgroup_id].upper_bound(version);) {
+            dbg_trace(rpc_logger, "RPCManager: Setting signature verification on version {}", pending_results_iter->first);
+            std::shared_ptr<AbstractPendingResults> live_pending_results = pending_results_iter->second.lock();
+            if(live_pending_results) {
+                verified_results.emplace_back(std::move(live_pending_results));
+            }
+            //Either way, delete the weak_ptr, since it won't be needed by completed_pending_results
+            pending_results_iter = results_awaiting_signature[subgroup_id].erase(pending_results_iter);
         }
-        //Either way, delete the weak_ptr, since it won't be needed by completed_pending_results
-        pending_results_iter = results_awaiting_signature[subgroup_id].erase(pending_results_iter);
+    }
+    for(const auto& pending_results : verified_results) {
+        pending_results->set_signature_verified();
     }
 }
 
 void RPCManager::add_external_connection(node_id_t node_id) {
     external_client_ids.emplace(node_id);
-    connections->add_connections({node_id});
+    connections->add_external_connections({node_id});
 }
 
 void RPCManager::remove_external_connection(node_id_t node_id) {
@@ -450,12 +551,133 @@ sst::P2PBufferHandle RPCManager::get_sendbuffer_ptr(uint32_t dest_id, sst::MESSA
     return *buffer;
 }
 
+sst::P2PBufferHandle RPCManager::get_sendbuffer_ptr(uint32_t dest_id, sst::MESSAGE_TYPE type, std::size_t size) {
+    bool oversized;
+    try {
+        oversized = connections->needs_rendezvous(dest_id, type, size);
+    } catch(std::out_of_range& map_error) {
+        throw node_removed_from_group_exception(dest_id);
+    }
+    sst::P2PBufferHandle buffer = get_sendbuffer_ptr(dest_id, type);
+    if(oversized) {
+        SharedLockedReference<View> view_and_lock = view_manager.get_current_view();
+        try {
+            buffer.buf_ptr = stage_rendezvous_message(dest_id, type, buffer, size);
+        } catch(std::out_of_range& map_error) {
+            throw node_removed_from_group_exception(dest_id);
+        }
+    }
+    return buffer;
+}
+
+uint8_t* RPCManager::stage_rendezvous_message(node_id_t dest_id, sst::MESSAGE_TYPE type,
+                                              const sst::P2PBufferHandle& msg_buffer, std::size_t size) {
+    using namespace remote_invocation_utilities;
+    sst::RendezvousBufferHandle rendezvous_buffer = connections->allocate_rendezvous_buffer(
+            dest_id, type, msg_buffer.seq_num, size);
+    populate_rendezvous_message(msg_buffer.buf_ptr, nid, type == sst::MESSAGE_TYPE::P2P_REPLY,
+                                RendezvousDescriptor{reinterpret_cast<uint64_t>(rendezvous_buffer.buf_ptr),
+                                                     rendezvous_buffer.rkey, size});
+    if(type == sst::MESSAGE_TYPE::P2P_REQUEST) {
+        // The request isn't serialized yet, so send_p2p_message completes the rendezvous message
+        std::lock_guard<std::mutex> lock(staged_rendezvous_requests_mutex);
+        staged_rendezvous_requests[{dest_id, msg_buffer.seq_num}] = {msg_buffer.buf_ptr, rendezvous_buffer.buf_ptr};
+    }
+    return rendezvous_buffer.buf_ptr;
+}
+
+sst::RendezvousReadBuffer RPCManager::read_rendezvous_message(node_id_t sender_id, sst::MESSAGE_TYPE type,
+                                                              const remote_invocation_utilities::RendezvousDescriptor& descriptor) {
+    dbg_trace(rpc_logger, "Reading a {}-byte rendezvous message from node {}", descriptor.size, sender_id);
+    return connections->read_rendezvous_buffer(sender_id, type, descriptor.remote_addr, descriptor.rkey, descriptor.size);
+}
+
+void RPCManager::send_stale_view_reply(node_id_t dest_id, const Opcode& request_opcode, void* invocation_id) {
+    using namespace remote_invocation_utilities;
+    const int32_t current_vid = view_manager.get_current_view().get().vid;
+    dbg_debug(rpc_logger, "Node {} sent a P2P request for subgroup {}, which this node does not host in view {}",
+              dest_id, request_opcode.subgroup_id, current_vid);
+    auto buffer_handle = connections->get_sendbuffer_ptr(dest_id, sst::MESSAGE_TYPE::P2P_REPLY);
+    if(!buffer_handle) {
+        dbg_error(rpc_logger, "Failed to allocate a buffer for a stale-view reply to node {}", dest_id);
+        return;
+    }
+    Opcode reply_opcode = request_opcode;
+    reply_opcode.is_reply = true;
+    uint32_t flags = 0;
+    RPC_HEADER_FLAG_SET(flags, STALE_VIEW);
+    populate_header(buffer_handle->buf_ptr, sizeof(current_vid) + sizeof(invocation_id), reply_opcode, nid, flags);
+    std::memcpy(buffer_handle->buf_ptr + header_space(), &current_vid, sizeof(current_vid));
+    std::memcpy(buffer_handle->buf_ptr + header_space() + sizeof(current_vid), &invocation_id, sizeof(invocation_id));
+    connections->send(dest_id, sst::MESSAGE_TYPE::P2P_REPLY, buffer_handle->seq_num);
+}
+
+void RPCManager::send_unknown_function_reply(node_id_t dest_id, const Opcode& request_opcode, void* invocation_id) {
+    dbg_error(rpc_logger, "Node {} sent a P2P request for function {} of subgroup {}, which has no such function",
+              dest_id, request_opcode.function_id, request_opcode.subgroup_id);
+    send_exception_reply(dest_id, request_opcode, invocation_id,
+                         remote_exception_info("derecho::derecho_exception",
+                                               "No function with ID " + std::to_string(request_opcode.function_id)
+                                                       + " in subgroup " + std::to_string(request_opcode.subgroup_id)));
+}
+
+void RPCManager::send_exception_reply(node_id_t dest_id, const Opcode& request_opcode, void* invocation_id,
+                                      const remote_exception_info& exception_info) {
+    using namespace remote_invocation_utilities;
+    auto buffer_handle = connections->get_sendbuffer_ptr(dest_id, sst::MESSAGE_TYPE::P2P_REPLY);
+    if(!buffer_handle) {
+        dbg_error(rpc_logger, "Failed to allocate a buffer for an exception reply to node {}", dest_id);
+        return;
+    }
+    const std::size_t result_size = mutils::bytes_size(exception_info) + sizeof(invocation_id) + 1;
+    Opcode reply_opcode = request_opcode;
+    reply_opcode.is_reply = true;
+    uint8_t* out = buffer_handle->buf_ptr + header_space();
+    out[0] = true;
+    std::memcpy(out + 1, &invocation_id, sizeof(invocation_id));
+    mutils::to_bytes(exception_info, out + sizeof(invocation_id) + 1);
+    populate_header(buffer_handle->buf_ptr, result_size, reply_opcode, nid, 0);
+    connections->send(dest_id, sst::MESSAGE_TYPE::P2P_REPLY, buffer_handle->seq_num);
+}
+
+bool RPCManager::hosts_subgroup(const Opcode& opcode) const {
+    // receivers is ordered by class ID, then subgroup ID, so the subgroup's receivers are contiguous.
+    // Only request receivers count, since callers of a subgroup have receivers for its replies.
+    for(auto receiver_iter = receivers->lower_bound(Opcode{opcode.class_id, opcode.subgroup_id, 0, false});
+        receiver_iter != receivers->end() && receiver_iter->first.class_id == opcode.class_id
+        && receiver_iter->first.subgroup_id == opcode.subgroup_id;
+        ++receiver_iter) {
+        if(!receiver_iter->first.is_reply) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RPCManager::p2p_send_has_space(uint32_t dest_id) {
+    SharedLockedReference<View> view_and_lock = view_manager.get_current_view();
+    try {
+        return connections->has_send_space(dest_id, sst::MESSAGE_TYPE::P2P_REQUEST);
+    } catch(std::out_of_range& map_error) {
+        throw node_removed_from_group_exception(dest_id);
+    }
+}
+
 void RPCManager::send_p2p_message(node_id_t dest_id, subgroup_id_t dest_subgroup_id, uint64_t sequence_num,
                                   std::weak_ptr<AbstractPendingResults> pending_results_handle) {
     try {
         // ViewManager's view_mutex also prevents connections from being removed (because
         // that happens in new_view_callback)
         SharedLockedReference<View> view_and_lock = view_manager.get_current_view();
+        {
+            std::lock_guard<std::mutex> lock(staged_rendezvous_requests_mutex);
+            auto staged_request = staged_rendezvous_requests.find({dest_id, sequence_num});
+            if(staged_request != staged_rendezvous_requests.end()) {
+                remote_invocation_utilities::complete_rendezvous_message(staged_request->second.first,
+                                                                         staged_request->second.second);
+                staged_rendezvous_requests.erase(staged_request);
+            }
+        }
         // The type of message being sent here is always a P2P request, not a reply
         connections->send(dest_id, sst::MESSAGE_TYPE::P2P_REQUEST, sequence_num);
     } catch(std::out_of_range& map_error) {
@@ -464,6 +686,7 @@ void RPCManager::send_p2p_message(node_id_t dest_id, subgroup_id_t dest_subgroup
     std::shared_ptr<AbstractPendingResults> pending_results = pending_results_handle.lock();
     if(pending_results) {
         pending_results->fulfill_map({dest_id});
+        pending_results->end_persistence_events();
         std::lock_guard<std::mutex> lock(pending_results_mutex);
         // These PendingResults don't need to have ReplyMaps fulfilled, and they
         // won't ever get version numbers or persistence notifications (since P2P sends are read-only)
@@ -493,27 +716,66 @@ void RPCManager::p2p_request_worker() {
             p2p_request_queue.pop();
         }
         retrieve_header(request.msg_buf, payload_size, indx, received_from, flags);
+        // Read oversized requests here, rather than in p2p_message_handler, so the read doesn't block the receive loop
+        sst::RendezvousReadBuffer rendezvous_buf;
+        if(RPC_HEADER_FLAG_TST(flags, RENDEZVOUS)) {
+            try {
+                rendezvous_buf = read_rendezvous_message(request.sender_id, sst::MESSAGE_TYPE::P2P_REQUEST,
+                                                         retrieve_rendezvous_descriptor(request.msg_buf));
+            } catch(derecho_exception& ex) {
+                // Still answer the request, since the sender's request window advances on replies
+                dbg_error(rpc_logger, "Dropping a P2P request from node {} because its rendezvous buffer could not be read: {}",
+                          request.sender_id, ex.what());
+                void* invocation_id = retrieve_rendezvous_invocation_id(request.msg_buf);
+                if(invocation_id) {
+                    send_exception_reply(request.sender_id, indx, invocation_id,
+                                         remote_exception_info("derecho::derecho_exception",
+                                                               std::string("Failed to read the request: ") + ex.what()));
+                } else {
+                    // Void functions have no invocation ID and expect a null reply
+                    auto buffer_handle = connections->get_sendbuffer_ptr(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY);
+                    if(buffer_handle) {
+                        reinterpret_cast<size_t*>(buffer_handle->buf_ptr)[0] = 0;
+                        connections->send(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY, buffer_handle->seq_num);
+                    }
+                }
+                continue;
+            }
+            request.msg_buf = rendezvous_buf.get();
+            retrieve_header(request.msg_buf, payload_size, indx, received_from, flags);
+        }
         if(indx.is_reply || RPC_HEADER_FLAG_TST(flags, CASCADE)) {
             dbg_error(rpc_logger, "Invalid rpc message in fifo queue: is_reply={}, is_cascading={}",
                       indx.is_reply, RPC_HEADER_FLAG_TST(flags, CASCADE));
             throw derecho::derecho_exception("invalid rpc message in fifo queue...crash.");
         }
+        if(receivers->find(indx) == receivers->end()) {
+            void* invocation_id;
+            std::memcpy(&invocation_id, request.msg_buf + header_size, sizeof(invocation_id));
+            if(hosts_subgroup(indx)) {
+                send_unknown_function_reply(request.sender_id, indx, invocation_id);
+            } else {
+                send_stale_view_reply(request.sender_id, indx, invocation_id);
+            }
+            continue;
+        }
         reply_size = 0;
         uint64_t reply_seq_num = 0;
         RPCManager::rpc_caller_id = received_from;
         receive_message(indx, received_from, request.msg_buf + header_size, payload_size,
                         [this, &reply_size, &reply_seq_num, &request](size_t _size) -> uint8_t* {
                             reply_size = _size;
-                            if(reply_size <= connections->get_max_p2p_reply_size()) {
-                                auto buffer_handle = connections->get_sendbuffer_ptr(
-                                        request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY);
-                                if(!buffer_handle)
-                                    throw derecho_exception("Failed to allocate a buffer for a P2P reply because the send window was full!");
-                                reply_seq_num = buffer_handle->seq_num;
-                                return buffer_handle->buf_ptr;
-                            } else {
-                                throw buffer_overflow_exception("Size of a P2P reply exceeds the maximum P2P reply size.");
+                            const bool oversized = connections->needs_rendezvous(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY, reply_size);
+                            auto buffer_handle = connections->get_sendbuffer_ptr(
+                                    request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY);
+                            if(!buffer_handle)
+                                throw derecho_exception("Failed to allocate a buffer for a P2P reply because the send window was full!");
+                            reply_seq_num = buffer_handle->seq_num;
+                            if(oversized) {
+                                return stage_rendezvous_message(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY,
+                                                                *buffer_handle, reply_size);
                             }
+                            return buffer_handle->buf_ptr;
                         });
         if(reply_size > 0) {
             dbg_trace(rpc_logger, "Sending a P2P reply to node {} for invocation ID {} of function {}",
@@ -544,6 +806,7 @@ void RPCManager::p2p_receive_loop() {
     dbg_debug(rpc_logger, "P2P listening thread started");
     // start the fifo worker thread
     request_worker_thread = std::thread(&RPCManager::p2p_request_worker, this);
+    rendezvous_reply_thread = std::thread(&RPCManager::rendezvous_reply_worker, this);
 
     uint64_t last_time_ms = get_walltime() / INT64_1E6;
 
@@ -583,6 +846,11 @@ void RPCManager::p2p_receive_loop() {
     // stop fifo worker.
     request_queue_cv.notify_one();
     request_worker_thread.join();
+    {
+        std::lock_guard<std::mutex> lock(rendezvous_reply_mutex);
+        rendezvous_reply_cv.notify_one();
+    }
+    rendezvous_reply_thread.join();
 }
 
 node_id_t RPCManager::get_rpc_caller_id() {
@@ -0,0 +1,53 @@
+#include <derecho/core/detail/vectored_socket_writer.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <sys/uio.h>
+
+namespace derecho {
+
+VectoredSocketWriter::VectoredSocketWriter(tcp::socket& sock, std::size_t buffer_size, std::size_t direct_write_threshold)
+        : sock(sock),
+          buffer_size(buffer_size),
+          direct_write_threshold(std::min(direct_write_threshold, buffer_size)),
+          staging_buffer(std::make_unique<uint8_t[]>(buffer_size)),
+          staging_buffer_used(0),
+          uncaught_exceptions_at_creation(std::uncaught_exceptions()) {}
+
+VectoredSocketWriter::~VectoredSocketWriter() {
+    // Don't send a partly-written message if the writer's scope is being unwound
+    if(std::uncaught_exceptions() > uncaught_exceptions_at_creation) {
+        return;
+    }
+    try {
+        flush();
+    } catch(tcp::socket_error&) {
+    }
+}
+
+void VectoredSocketWriter::write(const uint8_t* bytes, std::size_t size) {
+    if(size >= direct_write_threshold) {
+        // Send the staged bytes and the fragment together, without copying the fragment
+        struct iovec buffers[2] = {{staging_buffer.get(), staging_buffer_used},
+                                   {const_cast<uint8_t*>(bytes), size}};
+        staging_buffer_used = 0;
+        sock.writev(buffers, 2);
+        return;
+    }
+    if(staging_buffer_used + size > buffer_size) {
+        flush();
+    }
+    std::memcpy(staging_buffer.get() + staging_buffer_used, bytes, size);
+    staging_buffer_used += size;
+}
+
+void VectoredSocketWriter::flush() {
+    if(staging_buffer_used > 0) {
+        const std::size_t bytes_to_send = staging_buffer_used;
+        staging_buffer_used = 0;
+        sock.write(staging_buffer.get(), bytes_to_send);
+    }
+}
+
+}  // namespace derecho
@@ -6,6 +6,8 @@
 
 #include <derecho/core/derecho_exception.hpp>
 #include <derecho/core/detail/public_key_store.hpp>
+#include <derecho/core/detail/registered_memory.hpp>
+#include <derecho/core/detail/vectored_socket_writer.hpp>
 #include <derecho/core/detail/version_code.hpp>
 #include <derecho/core/git_version.hpp>
 #include <derecho/core/replicated.hpp>
@@ -16,6 +18,11 @@
 #include <mutils/macro_utils.hpp>
 
 #include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <set>
+#include <thread>
 #include <tuple>
 
 namespace derecho {
@@ -34,6 +41,8 @@ ViewManager::ViewManager(
         : vm_logger(LoggerFactory::createIfAbsent(LoggerFactory::VIEWMANAGER_LOGGER_NAME, getConfString(Conf::LOGGER_VIEWMANAGER_LOG_LEVEL))),
           server_socket(getConfUInt16(Conf::DERECHO_GMS_PORT)),
           thread_shutdown(false),
+          gms_event_loop("gms_listener"),
+          control_plane_timeout_ms(getConfUInt32(Conf::DERECHO_CONTROL_PLANE_TIMEOUT_MS)),
           disable_partitioning_safety(getConfBoolean(Conf::DERECHO_DISABLE_PARTITIONING_SAFETY)),
           view_upcalls(_view_upcalls),
           subgroup_info(subgroup_info),
@@ -49,11 +58,7 @@ ViewManager::ViewManager(
 
 ViewManager::~ViewManager() {
     thread_shutdown = true;
-    // force accept to return.
-    tcp::socket s{"localhost", getConfUInt16(Conf::DERECHO_GMS_PORT)};
-    if(client_listener_thread.joinable()) {
-        client_listener_thread.join();
-    }
+    gms_event_loop.stop();
 
     old_views_cv.notify_all();
     if(old_view_cleanup_thread.joinable()) {
@@ -316,11 +321,13 @@ bool ViewManager::send_join_request() {
             restart_state->num_leader_failures = 0;
         }
         dbg_debug(vm_logger, "Sending view {} to leader", curr_view->vid);
-        auto leader_socket_write = [this](const uint8_t* bytes, std::size_t size) {
-            leader_connection->write(bytes, size);
-        };
         try {
-            leader_connection->write(mutils::bytes_size(*curr_view));
+            //The view and ragged trims are sent as one stream, so their many small fragments are gathered into a few writes
+            VectoredSocketWriter leader_writer(*leader_connection);
+            auto leader_socket_write = [&leader_writer](const uint8_t* bytes, std::size_t size) {
+                leader_writer.write(bytes, size);
+            };
+            leader_writer.write(mutils::bytes_size(*curr_view));
             mutils::post_object(leader_socket_write, *curr_view);
             //Restore this non-serializeable field to curr_view before using it
             curr_view->subgroup_type_order = subgroup_type_order;
@@ -330,13 +337,14 @@ bool ViewManager::send_join_request() {
             /* Protocol: Send the number of RaggedTrim objects, then serialize each RaggedTrim */
             /* Since we know this node is only a member of one shard per subgroup,
              * the size of the outer map (subgroup IDs) is the number of RaggedTrims. */
-            leader_connection->write(restart_state->logged_ragged_trim.size());
+            leader_writer.write(restart_state->logged_ragged_trim.size());
             for(const auto& id_to_shard_map : restart_state->logged_ragged_trim) {
                 assert(id_to_shard_map.second.size() == 1);  //The inner map has one entry
                 const std::unique_ptr<RaggedTrim>& ragged_trim = id_to_shard_map.second.begin()->second;
-                leader_connection->write(mutils::bytes_size(*ragged_trim));
+                leader_writer.write(mutils::bytes_size(*ragged_trim));
                 mutils::post_object(leader_socket_write, *ragged_trim);
             }
+            leader_writer.flush();
         } catch(tcp::socket_error& e) {
             //If any of the leader socket operations throws an error, stop and return false
             return false;
@@ -433,22 +441,17 @@ void ViewManager::check_view_committed(bool& view_confirmed, bool& leader_failed
 
 void ViewManager::truncate_logs() {
     assert(in_total_restart);
-    for(const auto& subgroup_and_map : restart_state->logged_ragged_trim) {
-        for(const auto& shard_and_trim : subgroup_and_map.second) {
-            persistent::saveObject(*shard_and_trim.second,
-                                   ragged_trim_filename(subgroup_and_map.first, shard_and_trim.first).c_str());
-        }
-    }
     dbg_debug(vm_logger, "Truncating persistent logs to conform to leader's ragged trim");
 
     const node_id_t my_id = getConfUInt32(Conf::DERECHO_LOCAL_ID);
-
+    //On the restart leader, the proposed view is still in RestartLeaderState
+    //On all the other nodes, it's been received and stored in curr_view
+    const View& restart_view = curr_view ? *curr_view : restart_leader_state_machine->get_restart_view();
+    //First compute the truncation version for every subgroup this node belongs to
+    std::map<subgroup_id_t, persistent::version_t> truncation_versions;
     for(const auto& id_to_shard_map : restart_state->logged_ragged_trim) {
         subgroup_id_t subgroup_id = id_to_shard_map.first;
         uint32_t my_shard_id;
-        //On the restart leader, the proposed view is still in RestartLeaderState
-        //On all the other nodes, it's been received and stored in curr_view
-        const View& restart_view = curr_view ? *curr_view : restart_leader_state_machine->get_restart_view();
         //Determine which shard, if any, this node belongs to in subgroup subgroup_id.
         //At this point, initialize_multicast_groups has not yet been called, so
         //my_subgroups has not yet been initialized in the restart view.
@@ -464,12 +467,32 @@ void ViewManager::truncate_logs() {
             continue;
         }
         const auto& my_shard_ragged_trim = id_to_shard_map.second.at(my_shard_id);
-        persistent::version_t max_delivered_version = RestartState::ragged_trim_to_latest_version(
+        truncation_versions[subgroup_id] = RestartState::ragged_trim_to_latest_version(
                 my_shard_ragged_trim->vid, my_shard_ragged_trim->max_received_by_sender);
-        dbg_trace(vm_logger, "Truncating persistent log for subgroup {} to version {}", subgroup_id, max_delivered_version);
-        dbg_flush(vm_logger);
-        subgroup_objects.at(subgroup_id)->truncate(max_delivered_version);
     }
+    //Then save the ragged trims and truncate the logs, one subgroup per thread,
+    //since each subgroup's ragged trim files and persistent logs are independent
+    std::vector<std::thread> truncate_threads;
+    for(const auto& subgroup_and_map : restart_state->logged_ragged_trim) {
+        const subgroup_id_t subgroup_id = subgroup_and_map.first;
+        auto truncation_version = truncation_versions.find(subgroup_id);
+        const bool truncate_subgroup = truncation_version != truncation_versions.end();
+        const persistent::version_t max_delivered_version = truncate_subgroup ? truncation_version->second : persistent::INVALID_VERSION;
+        truncate_threads.emplace_back([this, subgroup_id, &subgroup_and_map, truncate_subgroup, max_delivered_version]() {
+            for(const auto& shard_and_trim : subgroup_and_map.second) {
+                persistent::saveObject(*shard_and_trim.second,
+                                       ragged_trim_filename(subgroup_id, shard_and_trim.first).c_str());
+            }
+            if(truncate_subgroup) {
+                dbg_trace(vm_logger, "Truncating persistent log for subgroup {} to version {}", subgroup_id, max_delivered_version);
+                subgroup_objects.at(subgroup_id)->truncate(max_delivered_version);
+            }
+        });
+    }
+    for(std::thread& truncate_thread : truncate_threads) {
+        truncate_thread.join();
+    }
+    dbg_flush(vm_logger);
 }
 
 void ViewManager::initialize_multicast_groups(const UserMessageCallbacks& callbacks,
@@ -521,12 +544,13 @@ void ViewManager::finish_setup() {
         dbg_debug(vm_logger, "Joining node initialized its SST row from the leader");
     }
 
-    // Handle any external-client requests that were waiting for the group to start
-    for(auto& external_socket : startup_pending_external_sockets) {
-        dbg_info(vm_logger, "Processing join request from external client {} at address {}", external_socket.first, external_socket.second.get_remote_ip());
-        external_join_handler(external_socket.second, external_socket.first);
+    // Queue any external-client requests that were waiting for the group to start;
+    // they will be handled as soon as predicate evaluation starts
+    {
+        auto pending_new_sockets_locked = pending_new_sockets.locked();
+        pending_new_sockets_locked.access.splice(pending_new_sockets_locked.access.end(),
+                                                 startup_pending_external_sockets);
     }
-    startup_pending_external_sockets.clear();
 
     create_threads();
     register_predicates();
@@ -544,6 +568,7 @@ void ViewManager::send_logs() {
     /* If we're in total restart mode, prior_view_shard_leaders is equal
      * to restart_state->restart_shard_leaders */
     node_id_t my_id = getConfUInt32(Conf::DERECHO_LOCAL_ID);
+    std::map<node_id_t, std::vector<subgroup_id_t>> subgroups_by_receiver;
     for(subgroup_id_t subgroup_id = 0; subgroup_id < prior_view_shard_leaders.size(); ++subgroup_id) {
         for(uint32_t shard = 0; shard < prior_view_shard_leaders[subgroup_id].size(); ++shard) {
             if(my_id == prior_view_shard_leaders[subgroup_id][shard]) {
@@ -551,12 +576,13 @@ void ViewManager::send_logs() {
                 //Send object data to all shard members, since they will all be in receive_objects()
                 for(node_id_t shard_member : restart_view.subgroup_shard_views[subgroup_id][shard].members) {
                     if(shard_member != my_id) {
-                        send_subgroup_object(subgroup_id, shard_member);
+                        subgroups_by_receiver[shard_member].push_back(subgroup_id);
                     }
                 }
             }
         }
     }
+    send_objects_in_parallel(subgroups_by_receiver);
 }
 
 void ViewManager::setup_initial_tcp_connections(const View& initial_view, const node_id_t my_id) {
@@ -635,7 +661,7 @@ void ViewManager::await_first_view() {
                 client_socket.read(join_request);
                 if(join_request.is_external) {
                     dbg_debug(vm_logger, "Delaying an external-client request from {} until the initial view is formed", client_socket.get_remote_ip());
-                    startup_pending_external_sockets.emplace_back(join_request.joiner_id, std::move(client_socket));
+                    startup_pending_external_sockets.emplace_back(PendingConnection{std::move(client_socket), join_request});
                     continue;
                 }
                 joiner_id = join_request.joiner_id;
@@ -819,14 +845,10 @@ void ViewManager::initialize_rdmc_sst() {
 }
 
 void ViewManager::create_threads() {
-    client_listener_thread = std::thread{[this]() {
-        pthread_setname_np(pthread_self(), "gms_listener");
-        while(!thread_shutdown) {
-            tcp::socket client_socket = server_socket.accept();
-            dbg_debug(vm_logger, "GMS listener got a new connection from {}", client_socket.get_remote_ip());
-            pending_new_sockets.locked().access.emplace_back(std::move(client_socket));
-        }
-    }};
+    gms_event_loop.add_listener(server_socket, [this](tcp::socket client_socket) {
+        dbg_debug(vm_logger, "GMS listener got a new connection from {}", client_socket.get_remote_ip());
+        receive_join_request(std::move(client_socket));
+    });
 
     old_view_cleanup_thread = std::thread([this]() {
         pthread_setname_np(pthread_self(), "old_view");
@@ -1012,13 +1034,14 @@ void ViewManager::propose_changes(DerechoSST& gmsSST) {
                 continue;
             }
 
-            proposed_join_sockets.splice(proposed_join_sockets.end(),
-                                         pending_join_sockets,
-                                         pending_join_sockets.begin());
+            PendingConnection joiner = std::move(pending_join_sockets.front());
+            pending_join_sockets.pop_front();
 
-            bool success = receive_join(gmsSST, proposed_join_sockets.back().first, proposed_join_sockets.back().second);
-            //If the join failed, close the socket
-            if(!success) proposed_join_sockets.pop_back();
+            bool success = receive_join(gmsSST, joiner);
+            //If the join failed, the socket is closed when joiner goes out of scope
+            if(success) {
+                proposed_join_sockets.emplace_back(joiner.join_request.joiner_id, std::move(joiner.socket));
+            }
 
             done_with_joins = !has_pending_join();
         }
@@ -1052,99 +1075,198 @@ void ViewManager::propose_changes(DerechoSST& gmsSST) {
 
 void ViewManager::redirect_join_attempt(tcp::socket& joiner_socket) {
     try {
-        joiner_socket.write(JoinResponse{JoinResponseCode::LEADER_REDIRECT,
+        VectoredSocketWriter joiner_writer(joiner_socket);
+        joiner_writer.write(JoinResponse{JoinResponseCode::LEADER_REDIRECT,
                                          curr_view->members[curr_view->my_rank]});
         // Send the node the IP address of the current leader
         const int rank_of_leader = curr_view->find_rank_of_leader();
-        joiner_socket.write(mutils::bytes_size(
+        joiner_writer.write(mutils::bytes_size(
                 curr_view->member_ips_and_ports[rank_of_leader].ip_address));
-        auto bind_socket_write = [&joiner_socket](const uint8_t* bytes, std::size_t size) {
-            joiner_socket.write(bytes, size);
+        auto bind_socket_write = [&joiner_writer](const uint8_t* bytes, std::size_t size) {
+            joiner_writer.write(bytes, size);
         };
         mutils::post_object(bind_socket_write,
                             curr_view->member_ips_and_ports[rank_of_leader].ip_address);
-        joiner_socket.write(curr_view->member_ips_and_ports[rank_of_leader].gms_port);
+        joiner_writer.write(curr_view->member_ips_and_ports[rank_of_leader].gms_port);
+        joiner_writer.flush();
     } catch(tcp::socket_error& ex) {
         // Log the error, but otherwise ignore it, since we no longer care about this connection anyway
         dbg_debug(vm_logger, "TCP connection to node at {} failed while attempting to send it a leader-redirect message. Description: {}", joiner_socket.get_remote_ip(), ex.what());
     }
 }
 
-void ViewManager::process_new_sockets() {
-    tcp::socket client_socket;
-    {
-        auto pending_new_sockets_locked = pending_new_sockets.locked();
-        client_socket = std::move(pending_new_sockets_locked.access.front());
-        pending_new_sockets_locked.access.pop_front();
-    }
-    JoinRequest join_request;
+void ViewManager::receive_join_request(tcp::socket client_socket) {
+    // Exchange version codes; close the socket if the remote node has an incompatible version.
+    // The version code is only 8 bytes on a new connection, so writing it never blocks.
     try {
-        // Exchange version codes; close the socket if the remote node has an incompatible version
-        uint64_t joiner_version_code;
-        client_socket.exchange(my_version_hashcode, joiner_version_code);
-        if(joiner_version_code != my_version_hashcode) {
-            rls_default_warn("Rejected a connection from node at {}. Node was running on an incompatible platform or used an incompatible compiler.",
-                             client_socket.get_remote_ip());
-            return;
-        }
-        client_socket.read(join_request);
+        client_socket.write(my_version_hashcode);
     } catch(tcp::socket_error& ex) {
         dbg_warn(vm_logger, "TCP connection to {} failed before it could send a join request. Ignoring request.", client_socket.get_remote_ip());
         dbg_debug(vm_logger, "Error description: {}", ex.what());
         return;
     }
-    if(join_request.is_external) {
-        dbg_info(vm_logger, "Received an external join request from client {} at address {}.", join_request.joiner_id, client_socket.get_remote_ip());
-        external_join_handler(client_socket, join_request.joiner_id);
-    } else {
-        if(active_leader) {
-            pending_join_sockets.emplace_back(join_request.joiner_id, std::move(client_socket));
+    auto on_error = [this](tcp::socket client_socket, const tcp::socket_error& ex) {
+        dbg_warn(vm_logger, "TCP connection to {} failed before it could send a join request. Ignoring request.", client_socket.get_remote_ip());
+        dbg_debug(vm_logger, "Error description: {}", ex.what());
+    };
+    gms_event_loop.async_read(
+            std::move(client_socket), sizeof(uint64_t), control_plane_timeout_ms,
+            [this, on_error](tcp::socket client_socket, std::vector<uint8_t> bytes) {
+                uint64_t joiner_version_code;
+                std::memcpy(&joiner_version_code, bytes.data(), sizeof(joiner_version_code));
+                if(joiner_version_code != my_version_hashcode) {
+                    rls_default_warn("Rejected a connection from node at {}. Node was running on an incompatible platform or used an incompatible compiler.",
+                                     client_socket.get_remote_ip());
+                    return;
+                }
+                gms_event_loop.async_read(
+                        std::move(client_socket), sizeof(JoinRequest), control_plane_timeout_ms,
+                        [this](tcp::socket client_socket, std::vector<uint8_t> bytes) {
+                            PendingConnection connection{std::move(client_socket), JoinRequest{}};
+                            std::memcpy(&connection.join_request, bytes.data(), sizeof(JoinRequest));
+                            pending_new_sockets.locked().access.emplace_back(std::move(connection));
+                        },
+                        on_error);
+            },
+            on_error);
+}
+
+void ViewManager::receive_handshake_stage(PendingConnection&& connection, std::size_t size,
+                                          std::function<void(PendingConnection&, const uint8_t*)> fill_request) {
+    const node_id_t remote_id = connection.join_request.joiner_id;
+    const JoinRequest join_request = connection.join_request;
+    const IpAndPorts ports = connection.ports;
+    gms_event_loop.async_read(
+            std::move(connection.socket), size, control_plane_timeout_ms,
+            [this, join_request, ports, fill_request](tcp::socket client_socket, std::vector<uint8_t> bytes) {
+                PendingConnection connection{std::move(client_socket), join_request, true};
+                connection.ports = ports;
+                fill_request(connection, bytes.data());
+                pending_new_sockets.locked().access.emplace_back(std::move(connection));
+            },
+            [this, remote_id](tcp::socket client_socket, const tcp::socket_error& ex) {
+                dbg_warn(vm_logger, "TCP connection to node {} at IP {} failed during join-request handshake. Ignoring request.", remote_id, client_socket.get_remote_ip());
+                dbg_debug(vm_logger, "Socket error description: {}", ex.what());
+            });
+}
+
+void ViewManager::process_new_sockets() {
+    //Handle every connection that is ready at once, so a burst of joins is proposed together
+    std::list<PendingConnection> new_connections;
+    {
+        auto pending_new_sockets_locked = pending_new_sockets.locked();
+        new_connections.swap(pending_new_sockets_locked.access);
+    }
+    for(PendingConnection& connection : new_connections) {
+        if(connection.join_request.is_external) {
+            if(connection.request_received) {
+                handle_external_request(connection);
+            } else {
+                dbg_info(vm_logger, "Received an external join request from client {} at address {}.", connection.join_request.joiner_id, connection.socket.get_remote_ip());
+                external_join_handler(std::move(connection));
+            }
+        } else if(!active_leader) {
+            if(connection.request_received) {
+                //This node stopped being the leader after accepting the join; the joiner will have to try again
+                dbg_info(vm_logger, "Dropping join request from node {}, since this node is no longer the leader", connection.join_request.joiner_id);
+            } else {
+                redirect_join_attempt(connection.socket);
+            }
+        } else if(connection.request_received) {
+            pending_join_sockets.emplace_back(std::move(connection));
         } else {
-            redirect_join_attempt(client_socket);
+            accept_join_request(std::move(connection));
         }
     }
-    return;
 }
-void ViewManager::external_join_handler(tcp::socket& client_socket, const node_id_t& joiner_id) {
-    ExternalClientRequest request;
+
+void ViewManager::accept_join_request(PendingConnection&& connection) {
+    const node_id_t joiner_id = connection.join_request.joiner_id;
+    const node_id_t my_id = curr_view->members[curr_view->my_rank];
+    try {
+        if(curr_view->rank_of(joiner_id) != -1) {
+            dbg_warn(vm_logger, "Joining node at IP {} announced it has ID {}, which is already in the View!", connection.socket.get_remote_ip(), joiner_id);
+            connection.socket.write(JoinResponse{JoinResponseCode::ID_IN_USE, my_id});
+            return;
+        }
+        connection.socket.write(JoinResponse{JoinResponseCode::OK, my_id});
+    } catch(tcp::socket_error& ex) {
+        dbg_warn(vm_logger, "TCP connection to node {} at IP {} failed during join-request handshake. Ignoring request.", joiner_id, connection.socket.get_remote_ip());
+        dbg_debug(vm_logger, "Socket error description: {}", ex.what());
+        return;
+    }
+    //The joiner sends its five ports back to back, so they can be received with a single read
+    receive_handshake_stage(std::move(connection), 5 * sizeof(uint16_t),
+                            [](PendingConnection& connection, const uint8_t* bytes) {
+                                uint16_t ports[5];
+                                std::memcpy(ports, bytes, sizeof(ports));
+                                connection.ports.gms_port = ports[0];
+                                connection.ports.state_transfer_port = ports[1];
+                                connection.ports.sst_port = ports[2];
+                                connection.ports.rdmc_port = ports[3];
+                                connection.ports.external_port = ports[4];
+                            });
+}
+
+void ViewManager::external_join_handler(PendingConnection&& connection) {
+    const node_id_t joiner_id = connection.join_request.joiner_id;
     try {
         if(curr_view->rank_of(joiner_id) != -1) {
             // external can't have same id as any member
-            client_socket.write(JoinResponse{JoinResponseCode::ID_IN_USE, getConfUInt32(Conf::DERECHO_LOCAL_ID)});
+            connection.socket.write(JoinResponse{JoinResponseCode::ID_IN_USE, getConfUInt32(Conf::DERECHO_LOCAL_ID)});
+            return;
         }
-        client_socket.write(JoinResponse{JoinResponseCode::OK, getConfUInt32(Conf::DERECHO_LOCAL_ID)});
-        client_socket.read(request);
+        connection.socket.write(JoinResponse{JoinResponseCode::OK, getConfUInt32(Conf::DERECHO_LOCAL_ID)});
     } catch(tcp::socket_error& ex) {
         dbg_warn(vm_logger, "TCP connection to external client {} failed before it could send a request. Ignoring request.", joiner_id);
         dbg_debug(vm_logger, "Socket error description: {}", ex.what());
         return;
     }
-    if(request == ExternalClientRequest::GET_VIEW) {
-        try {
-            send_view(*curr_view, client_socket);
-        } catch(tcp::socket_error& ex) {
-            dbg_warn(vm_logger, "External client {} failed while attempting to send it the view.", joiner_id);
-            dbg_debug(vm_logger, "Socket error description: {}", ex.what());
-        }
-    } else if(request == ExternalClientRequest::ESTABLISH_P2P) {
-        uint16_t external_client_external_port = 0;
-        try {
-            client_socket.read(external_client_external_port);
-        } catch(tcp::socket_error& ex) {
-            dbg_warn(vm_logger, "TCP connection to external client {} failed while attempting to establish a P2P connection", joiner_id);
-            dbg_debug(vm_logger, "Socket error description: {}", ex.what());
+    receive_handshake_stage(std::move(connection), sizeof(ExternalClientRequest),
+                            [](PendingConnection& connection, const uint8_t* bytes) {
+                                std::memcpy(&connection.external_request, bytes, sizeof(ExternalClientRequest));
+                            });
+}
+
+void ViewManager::handle_external_request(PendingConnection& connection) {
+    const node_id_t joiner_id = connection.join_request.joiner_id;
+    if(connection.external_request == ExternalClientRequest::GET_VIEW) {
+        //The View can be large, so send it through the event loop rather than blocking on the socket
+        std::vector<uint8_t> size_buffer(sizeof(std::size_t));
+        const std::size_t size_of_view = mutils::bytes_size(*curr_view);
+        std::memcpy(size_buffer.data(), &size_of_view, sizeof(size_of_view));
+        std::vector<uint8_t> view_buffer(size_of_view);
+        mutils::to_bytes(*curr_view, view_buffer.data());
+        std::vector<std::vector<uint8_t>> buffers;
+        buffers.emplace_back(std::move(size_buffer));
+        buffers.emplace_back(std::move(view_buffer));
+        gms_event_loop.async_write(
+                std::move(connection.socket), std::move(buffers), control_plane_timeout_ms,
+                [](tcp::socket) {},
+                [this, joiner_id](tcp::socket, const tcp::socket_error& ex) {
+                    dbg_warn(vm_logger, "External client {} failed while attempting to send it the view.", joiner_id);
+                    dbg_debug(vm_logger, "Socket error description: {}", ex.what());
+                });
+    } else if(connection.external_request == ExternalClientRequest::ESTABLISH_P2P) {
+        // An ESTABLISH_P2P request is followed by the client's external port, which needs
+        // another trip through the event loop; 0 is never a valid port
+        if(connection.ports.external_port == 0) {
+            receive_handshake_stage(std::move(connection), sizeof(uint16_t),
+                                    [](PendingConnection& connection, const uint8_t* bytes) {
+                                        std::memcpy(&connection.ports.external_port, bytes, sizeof(uint16_t));
+                                    });
             return;
         }
-        sst::add_external_node(joiner_id, {client_socket.get_remote_ip(),
-                                           external_client_external_port});
+        sst::add_external_node(joiner_id, {connection.socket.get_remote_ip(),
+                                           connection.ports.external_port});
         add_external_connection_upcall(joiner_id);
-    } else if(request == ExternalClientRequest::REMOVE_P2P) {
+    } else if(connection.external_request == ExternalClientRequest::REMOVE_P2P) {
         sst::remove_node(joiner_id);
         remove_external_connection_upcall(joiner_id);
 
         // send confirmation to client
         try {
-            client_socket.write(true);
+            connection.socket.write(true);
         } catch(tcp::socket_error& ex) {
             dbg_debug(vm_logger, "Socket error description: {}", ex.what());
         }
@@ -1281,6 +1403,10 @@ void ViewManager::start_meta_wedge(DerechoSST& gmsSST) {
     gmsSST.predicates.remove(change_commit_ready_handle);
     gmsSST.predicates.remove(leader_proposed_handle);
 
+    pending_view_change_timings = ViewChangeTimings{};
+    view_change_start_time = std::chrono::steady_clock::now();
+    view_change_phase_start_time = view_change_start_time;
+
     curr_view->wedge();
 
     /* We now need to wait for all other nodes to wedge the current view,
@@ -1305,8 +1431,24 @@ void ViewManager::start_meta_wedge(DerechoSST& gmsSST) {
 
 void ViewManager::terminate_epoch(DerechoSST& gmsSST) {
     dbg_debug(vm_logger, "MetaWedged is true; continuing epoch termination");
+    end_view_change_phase(pending_view_change_timings.meta_wedge);
+
+    // Flush the pending SST sends of every subgroup, then wait for them to finish with
+    // a single put and a single barrier with all the shard members, rather than one
+    // round trip per subgroup
+    dbg_debug(vm_logger, "Waiting for pending SST sends to finish");
+    std::set<uint32_t> all_shard_sst_indices;
+    for(const auto& shard_settings_pair :
+        curr_view->multicast_group->get_subgroup_settings()) {
+        curr_view->multicast_group->sst_send_trigger(shard_settings_pair.first, shard_settings_pair.second,
+                                                     shard_settings_pair.second.members.size(), gmsSST);
+        const auto shard_sst_indices = curr_view->multicast_group->get_shard_sst_indices(shard_settings_pair.first);
+        all_shard_sst_indices.insert(shard_sst_indices.begin(), shard_sst_indices.end());
+    }
+    gmsSST.put_with_completion();
+    gmsSST.sync_with_members(std::vector<uint32_t>(all_shard_sst_indices.begin(), all_shard_sst_indices.end()));
 
-    // go through all subgroups first and acknowledge all messages received through SST
+    // go through all subgroups and acknowledge all messages received through SST
     for(const auto& shard_settings_pair :
         curr_view->multicast_group->get_subgroup_settings()) {
         const subgroup_id_t subgroup_id = shard_settings_pair.first;
@@ -1321,11 +1463,6 @@ void ViewManager::terminate_epoch(DerechoSST& gmsSST) {
                 l++;
             }
         }
-        // wait for all pending sst sends to finish
-        dbg_debug(vm_logger, "Waiting for pending SST sends to finish");
-        curr_view->multicast_group->sst_send_trigger(subgroup_id, curr_subgroup_settings, num_shard_members, gmsSST);
-        gmsSST.put_with_completion();
-        gmsSST.sync_with_members(curr_view->multicast_group->get_shard_sst_indices(subgroup_id));
         while(curr_view->multicast_group->receiver_predicate(
                 curr_subgroup_settings, shard_ranks_by_sender_rank,
                 num_shard_senders, gmsSST)) {
@@ -1349,6 +1486,7 @@ void ViewManager::terminate_epoch(DerechoSST& gmsSST) {
 
     // For subgroups in which I'm the shard leader, do RaggedEdgeCleanup for the leader
     auto follower_subgroups_and_shards = std::make_shared<std::map<subgroup_id_t, uint32_t>>();
+    std::map<subgroup_id_t, int> leader_subgroups;
     for(const auto& shard_settings_pair : curr_view->multicast_group->get_subgroup_settings()) {
         const subgroup_id_t subgroup_id = shard_settings_pair.first;
         const uint32_t shard_num = shard_settings_pair.second.shard_num;
@@ -1363,6 +1501,7 @@ void ViewManager::terminate_epoch(DerechoSST& gmsSST) {
                         subgroup_id,
                         shard_settings_pair.second.num_received_offset, shard_view.members,
                         num_shard_senders);
+                leader_subgroups.emplace(subgroup_id, curr_view->my_rank);
             } else {
                 // Keep track of which subgroups I'm a non-leader in, and what my
                 // corresponding shard ID is
@@ -1370,6 +1509,11 @@ void ViewManager::terminate_epoch(DerechoSST& gmsSST) {
             }
         }
     }
+    // Send all the global_mins computed above at once, then log them
+    push_global_mins(leader_subgroups);
+    if(any_persistent_objects) {
+        log_ragged_trims(leader_subgroups);
+    }
 
     // Wait for the shard leaders of subgroups I'm not a leader in to post
     // global_min_ready before continuing.
@@ -1399,6 +1543,19 @@ void ViewManager::echo_ragged_trim(
         std::shared_ptr<std::map<subgroup_id_t, uint32_t>> follower_subgroups_and_shards,
         DerechoSST& gmsSST) {
     dbg_debug(vm_logger, "GlobalMins are ready for all {} subgroup leaders this node is waiting on", follower_subgroups_and_shards->size());
+    end_view_change_phase(pending_view_change_timings.epoch_termination);
+    std::map<subgroup_id_t, int> shard_leader_ranks;
+    for(const auto& subgroup_shard_pair : *follower_subgroups_and_shards) {
+        const SubView& shard_view = curr_view->subgroup_shard_views.at(subgroup_shard_pair.first)
+                                            .at(subgroup_shard_pair.second);
+        node_id_t shard_leader = shard_view.members[curr_view->subview_rank_of_shard_leader(
+                subgroup_shard_pair.first, subgroup_shard_pair.second)];
+        shard_leader_ranks.emplace(subgroup_shard_pair.first, curr_view->rank_of(shard_leader));
+    }
+    // Learn the leaders' ragged trims and log them before echoing any of them
+    if(any_persistent_objects) {
+        log_ragged_trims(shard_leader_ranks);
+    }
     // Call RaggedEdgeCleanup for subgroups in which I'm not the leader
     for(const auto& subgroup_shard_pair : *follower_subgroups_and_shards) {
         const subgroup_id_t subgroup_id = subgroup_shard_pair.first;
@@ -1408,14 +1565,13 @@ void ViewManager::echo_ragged_trim(
         for(auto v : shard_view.is_sender) {
             if(v) num_shard_senders++;
         }
-        node_id_t shard_leader = shard_view.members[curr_view->subview_rank_of_shard_leader(
-                subgroup_id, shard_num)];
         follower_ragged_edge_cleanup(
                 subgroup_id,
-                curr_view->rank_of(shard_leader),
+                shard_leader_ranks.at(subgroup_id),
                 curr_view->multicast_group->get_subgroup_settings().at(subgroup_id).num_received_offset,
                 num_shard_senders);
     }
+    push_global_mins(shard_leader_ranks);
 
     //Now, for all subgroups I'm in (leader or not), wait for everyone to have echoed the leader's
     //global_min_ready before delivering any messages; this means they have seen and logged the ragged trim
@@ -1445,6 +1601,7 @@ void ViewManager::echo_ragged_trim(
 
 void ViewManager::deliver_ragged_trim(DerechoSST& gmsSST) {
     dbg_debug(vm_logger, "GlobalMin has been echoed by everyone for all {} subgroups this node is in", curr_view->my_subgroups.size());
+    end_view_change_phase(pending_view_change_timings.ragged_trim);
     for(const auto& subgroup_shard_pair : curr_view->my_subgroups) {
         const subgroup_id_t subgroup_id = subgroup_shard_pair.first;
         const uint32_t shard_num = subgroup_shard_pair.second;
@@ -1501,6 +1658,7 @@ void ViewManager::deliver_ragged_trim(DerechoSST& gmsSST) {
 
 void ViewManager::finish_view_change(DerechoSST& gmsSST) {
     dbg_debug(vm_logger, "Ragged trim messages are persisted, finishing view change");
+    end_view_change_phase(pending_view_change_timings.delivery_and_persistence);
     std::unique_lock<std::shared_timed_mutex> write_lock(view_mutex);
 
     // Disable all the other SST predicates, except suspected_changed
@@ -1555,11 +1713,13 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
             send_view(*next_view, proposed_join_sockets.front().second);
             std::size_t size_of_vector = mutils::bytes_size(old_shard_leaders_by_id);
             dbg_debug(vm_logger, "Sending node {} the old shard leaders vector on the joiner socket. size_of_vector is {}", proposed_join_sockets.front().first, size_of_vector);
-            proposed_join_sockets.front().second.write(size_of_vector);
-            mutils::post_object([this](const uint8_t* bytes, std::size_t size) {
-                proposed_join_sockets.front().second.write(bytes, size);
+            VectoredSocketWriter joiner_writer(proposed_join_sockets.front().second);
+            joiner_writer.write(size_of_vector);
+            mutils::post_object([&joiner_writer](const uint8_t* bytes, std::size_t size) {
+                joiner_writer.write(bytes, size);
             },
                                 old_shard_leaders_by_id);
+            joiner_writer.flush();
             // save the socket for the commit step
             joiner_sockets.emplace_back(std::move(proposed_join_sockets.front().second));
             proposed_join_sockets.pop_front();
@@ -1575,6 +1735,7 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
     // from shard leaders if it is newly a member of a subgroup
     dbg_debug(vm_logger, "Receiving state for local Replicated Objects");
     initialize_subgroup_objects(my_id, *next_view, old_shard_leaders_by_id);
+    end_view_change_phase(pending_view_change_timings.state_transfer);
 
     // Once state transfer completes, we can tell joining clients to commit the view
     if(active_leader) {
@@ -1605,12 +1766,11 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
 #endif
         sst::remove_node(failed_node_id);
     }
-    // if new members have joined, tell RDMC and SST to add socket connections to them
-    for(std::size_t i = 0; i < next_view->joined.size(); ++i) {
-        // The new members will be the last joined.size() elements of the members lists
-        int joiner_rank = next_view->num_members - next_view->joined.size() + i;
+    // if new members have joined, tell RDMC and SST to add socket connections to them.
+    // Each joiner's connections are set up by a separate thread, so the TCP handshakes
+    // with all the joiners happen at the same time.
+    auto add_joiner_connections = [this](int joiner_rank) {
         dbg_debug(vm_logger, "Adding global TCP connections to node {}, at IP {} and port {}", next_view->members[joiner_rank], next_view->member_ips_and_ports[joiner_rank].ip_address, next_view->member_ips_and_ports[joiner_rank].rdmc_port);
-
 #ifdef USE_VERBS_API
         rdma::impl::verbs_add_connection(
                 next_view->members[joiner_rank],
@@ -1624,14 +1784,20 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
             dbg_warn(vm_logger, "Failed to add an RDMC TCP connection to new node {}", next_view->members[joiner_rank]);
         }
 #endif
-    }
-    for(std::size_t i = 0; i < next_view->joined.size(); ++i) {
-        int joiner_rank = next_view->num_members - next_view->joined.size() + i;
         if(!sst::add_node(next_view->members[joiner_rank],
                           {next_view->member_ips_and_ports[joiner_rank].ip_address,
                            next_view->member_ips_and_ports[joiner_rank].sst_port})) {
             dbg_warn(vm_logger, "Failed to add an SST TCP connection to new node {}", next_view->members[joiner_rank]);
         }
+    };
+    std::vector<std::thread> joiner_connection_threads;
+    for(std::size_t i = 0; i < next_view->joined.size(); ++i) {
+        // The new members will be the last joined.size() elements of the members lists
+        int joiner_rank = next_view->num_members - next_view->joined.size() + i;
+        joiner_connection_threads.emplace_back(add_joiner_connections, joiner_rank);
+    }
+    for(std::thread& connection_thread : joiner_connection_threads) {
+        connection_thread.join();
     }
 
     // This will block until everyone responds to SST/RDMC initial handshakes
@@ -1641,6 +1807,7 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
     // New members can now proceed to view_manager.finish_setup(), which will call put() and sync()
     next_view->gmsSST->push_row_except_slots();
     next_view->gmsSST->sync_with_members();
+    end_view_change_phase(pending_view_change_timings.multicast_setup);
     {
         lock_guard_t old_views_lock(old_views_mutex);
         old_views.push(std::move(curr_view));
@@ -1672,6 +1839,27 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
         view_upcall(*curr_view);
     }
 
+    pending_view_change_timings.vid = curr_view->vid;
+    pending_view_change_timings.total = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - view_change_start_time);
+    {
+        lock_guard_t timings_lock(view_change_timings_mutex);
+        last_view_change_timings = pending_view_change_timings;
+    }
+    dbg_info(vm_logger, "View change to view {} took {} us: meta-wedge {} us, epoch termination {} us, "
+                        "ragged trim {} us, delivery and persistence {} us, state transfer {} us, multicast setup {} us",
+             pending_view_change_timings.vid, pending_view_change_timings.total.count(),
+             pending_view_change_timings.meta_wedge.count(), pending_view_change_timings.epoch_termination.count(),
+             pending_view_change_timings.ragged_trim.count(), pending_view_change_timings.delivery_and_persistence.count(),
+             pending_view_change_timings.state_transfer.count(), pending_view_change_timings.multicast_setup.count());
+    // The new view's SST and multicast buffers have just been allocated, so this shows whether they got the pages asked for
+    const registered_memory_statistics memory_stats = get_registered_memory_statistics();
+    dbg_info(vm_logger, "Registered memory after view {}: {} bytes in use from {} allocations; {} bytes on huge pages, "
+                        "{} on transparent huge pages, {} on normal pages, {} on the NIC's NUMA node; {} huge page fallbacks",
+             curr_view->vid, memory_stats.bytes_in_use, memory_stats.allocations, memory_stats.huge_page_bytes,
+             memory_stats.transparent_huge_page_bytes, memory_stats.normal_page_bytes, memory_stats.numa_bound_bytes,
+             memory_stats.huge_page_fallbacks);
+
     curr_view->gmsSST->start_predicate_evaluation();
     view_change_cv.notify_all();
     dbg_debug(vm_logger, "Done with view change to view {}", curr_view->vid);
@@ -1696,7 +1884,7 @@ void ViewManager::construct_multicast_group(const UserMessageCallbacks& callback
             num_subgroups, signature_size, num_received_size, slot_size, index_field_size);
 
     curr_view->multicast_group = std::make_unique<MulticastGroup>(
-            curr_view->members, curr_view->members[curr_view->my_rank],
+            curr_view->members, curr_view->members[curr_view->my_rank], curr_view->vid,
             curr_view->gmsSST, callbacks, internal_callbacks, num_subgroups, subgroup_settings,
             getConfUInt32(Conf::DERECHO_HEARTBEAT_MS),
             persistence_manager, curr_view->failed);
@@ -1716,7 +1904,7 @@ void ViewManager::transition_multicast_group(
             num_subgroups, signature_size, new_num_received_size, new_slot_size, new_index_field_size);
 
     next_view->multicast_group = std::make_unique<MulticastGroup>(
-            next_view->members, next_view->members[next_view->my_rank],
+            next_view->members, next_view->members[next_view->my_rank], next_view->vid,
             next_view->gmsSST, std::move(*curr_view->multicast_group), num_subgroups,
             new_subgroup_settings,
             next_view->failed);
@@ -1731,34 +1919,24 @@ void ViewManager::transition_multicast_group(
     gmssst::set(next_view->gmsSST->vid[next_view->my_rank], next_view->vid);
 }
 
-bool ViewManager::receive_join(DerechoSST& gmsSST, const node_id_t joiner_id, tcp::socket& joiner_socket) {
+bool ViewManager::receive_join(DerechoSST& gmsSST, PendingConnection& joiner) {
+    const node_id_t joiner_id = joiner.join_request.joiner_id;
     struct in_addr joiner_ip_packed;
-    inet_aton(joiner_socket.get_remote_ip().c_str(), &joiner_ip_packed);
+    inet_aton(joiner.socket.get_remote_ip().c_str(), &joiner_ip_packed);
 
     const node_id_t my_id = curr_view->members[curr_view->my_rank];
-    uint16_t joiner_gms_port = 0;
-    uint16_t joiner_state_transfer_port = 0;
-    uint16_t joiner_sst_port = 0;
-    uint16_t joiner_rdmc_port = 0;
-    uint16_t joiner_external_port = 0;
-    try {
-        if(curr_view->rank_of(joiner_id) != -1) {
-            dbg_warn(vm_logger, "Joining node at IP {} announced it has ID {}, which is already in the View!", joiner_socket.get_remote_ip(), joiner_id);
-            joiner_socket.write(JoinResponse{JoinResponseCode::ID_IN_USE, my_id});
-            return false;
-        }
-        joiner_socket.write(JoinResponse{JoinResponseCode::OK, my_id});
-
-        joiner_socket.read(joiner_gms_port);
-        joiner_socket.read(joiner_state_transfer_port);
-        joiner_socket.read(joiner_sst_port);
-        joiner_socket.read(joiner_rdmc_port);
-        joiner_socket.read(joiner_external_port);
-    } catch(tcp::socket_error& ex) {
-        dbg_warn(vm_logger, "TCP connection to node {} at IP {} failed during join-request handshake. Ignoring request.", joiner_id, joiner_socket.get_remote_ip());
-        dbg_debug(vm_logger, "Socket error description: {}", ex.what());
+    //The ID was checked when the join request arrived, but another node with the same ID
+    //may have joined while this node was sending its ports. It was already sent
+    //JoinResponseCode::OK, so the only way to reject it now is to close the connection.
+    if(curr_view->rank_of(joiner_id) != -1) {
+        dbg_warn(vm_logger, "Joining node at IP {} announced it has ID {}, which is already in the View!", joiner.socket.get_remote_ip(), joiner_id);
         return false;
     }
+    const uint16_t joiner_gms_port = joiner.ports.gms_port;
+    const uint16_t joiner_state_transfer_port = joiner.ports.state_transfer_port;
+    const uint16_t joiner_sst_port = joiner.ports.sst_port;
+    const uint16_t joiner_rdmc_port = joiner.ports.rdmc_port;
+    const uint16_t joiner_external_port = joiner.ports.external_port;
 
     dbg_debug(vm_logger, "Proposing change #{} to add node {}. Num_installed is currently {}", gmsSST.num_changes[curr_view->my_rank] + 1, joiner_id, gmsSST.num_installed[curr_view->my_rank]);
     size_t next_change_index = gmsSST.num_changes[curr_view->my_rank]
@@ -1856,18 +2034,23 @@ std::vector<int> ViewManager::process_suspicions(DerechoSST& gmsSST) {
 }
 
 void ViewManager::send_view(const View& new_view, tcp::socket& client_socket) {
-    auto bind_socket_write = [&client_socket](const uint8_t* bytes, std::size_t size) {
-        client_socket.write(bytes, size);
+    //A View serializes into many small fragments (one per member ID, IP address, port, etc.)
+    VectoredSocketWriter socket_writer(client_socket);
+    auto bind_socket_write = [&socket_writer](const uint8_t* bytes, std::size_t size) {
+        socket_writer.write(bytes, size);
     };
     std::size_t size_of_view = mutils::bytes_size(new_view);
     dbg_trace(vm_logger, "Sending node at {} the new view. View size is {} bytes", client_socket.get_remote_ip(), size_of_view);
-    client_socket.write(size_of_view);
+    socket_writer.write(size_of_view);
     dbg_trace(vm_logger, "send_view starting to send view");
     mutils::post_object(bind_socket_write, new_view);
+    socket_writer.flush();
 }
 
 void ViewManager::send_objects_to_new_members(const vector_int64_2d& old_shard_leaders) {
     node_id_t my_id = next_view->members[next_view->my_rank];
+    //Subgroups are visited in ascending order, which is the order joiners receive them in
+    std::map<node_id_t, std::vector<subgroup_id_t>> subgroups_by_joiner;
     for(subgroup_id_t subgroup_id = 0; subgroup_id < old_shard_leaders.size(); ++subgroup_id) {
         for(uint32_t shard = 0; shard < old_shard_leaders[subgroup_id].size(); ++shard) {
             //if I was the leader of the shard in the old view...
@@ -1875,33 +2058,82 @@ void ViewManager::send_objects_to_new_members(const vector_int64_2d& old_shard_l
                 //send its object state to the new members
                 for(node_id_t shard_joiner : next_view->subgroup_shard_views[subgroup_id][shard].joined) {
                     if(shard_joiner != my_id) {
-                        send_subgroup_object(subgroup_id, shard_joiner);
+                        subgroups_by_joiner[shard_joiner].push_back(subgroup_id);
                     }
                 }
             }
         }
     }
+    send_objects_in_parallel(subgroups_by_joiner);
+}
+
+void ViewManager::send_objects_in_parallel(const std::map<node_id_t, std::vector<subgroup_id_t>>& subgroups_by_receiver) {
+    if(subgroups_by_receiver.empty()) {
+        return;
+    }
+    const auto start_time = std::chrono::steady_clock::now();
+    std::mutex send_error_mutex;
+    std::exception_ptr send_error;
+    auto send_to_receiver = [&](node_id_t receiver_id, const std::vector<subgroup_id_t>& subgroup_ids) {
+        try {
+            for(const subgroup_id_t subgroup_id : subgroup_ids) {
+                send_subgroup_object(subgroup_id, receiver_id);
+            }
+        } catch(...) {
+            std::lock_guard<std::mutex> lock(send_error_mutex);
+            if(!send_error) {
+                send_error = std::current_exception();
+            }
+        }
+    };
+    //The first receiver is handled by this thread, the rest by one thread each
+    std::vector<std::thread> sender_threads;
+    for(auto receiver_iter = std::next(subgroups_by_receiver.begin());
+        receiver_iter != subgroups_by_receiver.end(); ++receiver_iter) {
+        sender_threads.emplace_back(send_to_receiver, receiver_iter->first, std::cref(receiver_iter->second));
+    }
+    send_to_receiver(subgroups_by_receiver.begin()->first, subgroups_by_receiver.begin()->second);
+    for(std::thread& sender_thread : sender_threads) {
+        sender_thread.join();
+    }
+    dbg_debug(vm_logger, "Sent replicated objects to {} nodes in {} ms", subgroups_by_receiver.size(),
+              std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count());
+    if(send_error) {
+        std::rethrow_exception(send_error);
+    }
 }
 
 /* Note for the future: Since this "send" requires first receiving the log tail length,
- * it's really a blocking receive-then-send. Since all nodes call send_subgroup_object
- * before initialize_subgroup_objects, there's a small chance of a deadlock: node A could
- * be attempting to send an object to node B at the same time as B is attempting to send a
- * different object to A, and neither node will be able to send the log tail length that
- * the other one is waiting on. */
+ * it's really a blocking receive-then-send. Objects for different nodes are sent by
+ * different threads (see send_objects_in_parallel), so a node waiting on one receiver's
+ * log tail length no longer holds up the transfers to the others. */
 void ViewManager::send_subgroup_object(subgroup_id_t subgroup_id, node_id_t new_node_id) {
     LockedReference<std::unique_lock<std::mutex>, tcp::socket> joiner_socket = tcp_sockets.get_socket(new_node_id);
     assert(subgroup_objects.find(subgroup_id) != subgroup_objects.end());
     ReplicatedObject* subgroup_object = subgroup_objects.at(subgroup_id);
     if(subgroup_object->is_persistent()) {
-        //First, read the log tail length sent by the joining node
+        //First, read the log tail length sent by the joining node, and whether its own log
+        //can rebuild the object's state (a trimmed delta log can't)
         persistent::version_t persistent_log_length = 0;
+        bool joiner_can_rebuild = false;
         joiner_socket.get().read(persistent_log_length);
+        joiner_socket.get().read(joiner_can_rebuild);
         persistent::PersistentRegistry::setEarliestVersionToSerialize(persistent_log_length);
-        dbg_debug(vm_logger, "Got log tail length {} from {}", persistent_log_length, joiner_socket.get().get_remote_ip());
+        dbg_debug(vm_logger, "Got log tail length {} from {}; can rebuild from log: {}", persistent_log_length, joiner_socket.get().get_remote_ip(), joiner_can_rebuild);
+        //A joiner that already has a prefix of the log can rebuild the current state from
+        //its own log once it has the missing entries, so only the entries need to be sent.
+        //This node's own trimmed delta fields still include their state (see Persistent<T>)
+        const bool incremental = persistent_log_length != persistent::INVALID_VERSION
+                                 && joiner_can_rebuild
+                                 && getConfBoolean(Conf::DERECHO_INCREMENTAL_STATE_TRANSFER);
+        persistent::PersistentRegistry::setSerializeLogOnly(incremental);
+        if(incremental) {
+            dbg_debug(vm_logger, "Sending only log entries after version {} for subgroup {} to node {}", persistent_log_length, subgroup_id, new_node_id);
+        }
     }
     dbg_debug(vm_logger, "Sending Replicated Object state for subgroup {} to node {} over the state-transfer socket", subgroup_id, new_node_id);
     subgroup_object->send_object(joiner_socket.get());
+    persistent::PersistentRegistry::setSerializeLogOnly(false);
 }
 
 void ViewManager::update_tcp_connections() {
@@ -2422,16 +2654,6 @@ void ViewManager::leader_ragged_edge_cleanup(const subgroup_id_t subgroup_num,
 
     dbg_debug(vm_logger, "Shard leader for subgroup {} finished computing global_min", subgroup_num);
     gmssst::set(Vc.gmsSST->global_min_ready[myRank][subgroup_num], true);
-    Vc.gmsSST->put(
-            Vc.multicast_group->get_shard_sst_indices(subgroup_num),
-            (uint8_t*)std::addressof(Vc.gmsSST->global_min[0][num_received_offset]) - Vc.gmsSST->getBaseAddress(),
-            sizeof(Vc.gmsSST->global_min[0][num_received_offset]) * num_shard_senders);
-    Vc.gmsSST->put(Vc.multicast_group->get_shard_sst_indices(subgroup_num),
-                   Vc.gmsSST->global_min_ready, subgroup_num);
-
-    if(any_persistent_objects) {
-        log_ragged_trim(myRank, subgroup_num, num_received_offset, num_shard_senders);
-    }
 }
 
 void ViewManager::follower_ragged_edge_cleanup(
@@ -2441,21 +2663,71 @@ void ViewManager::follower_ragged_edge_cleanup(
     const View& Vc = *curr_view;
     int myRank = Vc.my_rank;
     dbg_debug(vm_logger, "Running follower RaggedEdgeCleanup for subgroup {}", subgroup_num);
-    // Learn the leader's ragged trim, log it, and echo it before acting upon it
-    if(any_persistent_objects) {
-        log_ragged_trim(shard_leader_rank, subgroup_num, num_received_offset, num_shard_senders);
-    }
     //Copy this shard's slice of global_min, starting at num_received_offset
     gmssst::set(&Vc.gmsSST->global_min[myRank][num_received_offset],
                 &Vc.gmsSST->global_min[shard_leader_rank][num_received_offset],
                 num_shard_senders);
     gmssst::set(Vc.gmsSST->global_min_ready[myRank][subgroup_num], true);
+}
+
+void ViewManager::push_global_mins(const std::map<subgroup_id_t, int>& subgroups) {
+    if(subgroups.empty()) {
+        return;
+    }
+    View& Vc = *curr_view;
+    //Find the range of global_min that covers all the subgroups' slices, and every
+    //node that is a member of any of their shards
+    uint32_t first_entry = Vc.gmsSST->global_min.size();
+    uint32_t end_entry = 0;
+    std::set<uint32_t> shard_sst_indices;
+    for(const auto& subgroup_rank_pair : subgroups) {
+        const SubgroupSettings& settings = Vc.multicast_group->get_subgroup_settings().at(subgroup_rank_pair.first);
+        first_entry = std::min(first_entry, settings.num_received_offset);
+        end_entry = std::max(end_entry, settings.num_received_offset
+                                                + Vc.multicast_group->get_num_senders(settings.senders));
+        const auto subgroup_indices = Vc.multicast_group->get_shard_sst_indices(subgroup_rank_pair.first);
+        shard_sst_indices.insert(subgroup_indices.begin(), subgroup_indices.end());
+    }
+    const std::vector<uint32_t> receiver_indices(shard_sst_indices.begin(), shard_sst_indices.end());
+    //Sending a node parts of this row that belong to other subgroups is harmless, since
+    //it only reads them once the corresponding global_min_ready is true. global_min must
+    //still be sent before global_min_ready.
+    if(end_entry > first_entry) {
+        Vc.gmsSST->put(
+                receiver_indices,
+                (uint8_t*)std::addressof(Vc.gmsSST->global_min[0][first_entry]) - Vc.gmsSST->getBaseAddress(),
+                sizeof(Vc.gmsSST->global_min[0][first_entry]) * (end_entry - first_entry));
+    }
+    const subgroup_id_t first_subgroup = subgroups.begin()->first;
+    const subgroup_id_t last_subgroup = subgroups.rbegin()->first;
     Vc.gmsSST->put(
-            Vc.multicast_group->get_shard_sst_indices(subgroup_num),
-            (uint8_t*)std::addressof(Vc.gmsSST->global_min[0][num_received_offset]) - Vc.gmsSST->getBaseAddress(),
-            sizeof(Vc.gmsSST->global_min[0][num_received_offset]) * num_shard_senders);
-    Vc.gmsSST->put(Vc.multicast_group->get_shard_sst_indices(subgroup_num),
-                   Vc.gmsSST->global_min_ready, subgroup_num);
+            receiver_indices,
+            (uint8_t*)std::addressof(Vc.gmsSST->global_min_ready[0][first_subgroup]) - Vc.gmsSST->getBaseAddress(),
+            sizeof(Vc.gmsSST->global_min_ready[0][first_subgroup]) * (last_subgroup - first_subgroup + 1));
+}
+
+void ViewManager::log_ragged_trims(const std::map<subgroup_id_t, int>& shard_leader_ranks) {
+    if(shard_leader_ranks.empty()) {
+        return;
+    }
+    //Each ragged trim is saved to its own file, so they can be written concurrently
+    std::vector<std::thread> logger_threads;
+    for(const auto& subgroup_rank_pair : shard_leader_ranks) {
+        const SubgroupSettings& settings = curr_view->multicast_group->get_subgroup_settings().at(subgroup_rank_pair.first);
+        logger_threads.emplace_back([this, subgroup_rank_pair, &settings]() {
+            log_ragged_trim(subgroup_rank_pair.second, subgroup_rank_pair.first, settings.num_received_offset,
+                            curr_view->multicast_group->get_num_senders(settings.senders));
+        });
+    }
+    for(std::thread& logger_thread : logger_threads) {
+        logger_thread.join();
+    }
+}
+
+void ViewManager::end_view_change_phase(std::chrono::microseconds& phase_duration) {
+    const auto now = std::chrono::steady_clock::now();
+    phase_duration = std::chrono::duration_cast<std::chrono::microseconds>(now - view_change_phase_start_time);
+    view_change_phase_start_time = now;
 }
 
 void ViewManager::deliver_in_order(const int shard_leader_rank,
@@ -2601,6 +2873,11 @@ int32_t ViewManager::get_my_rank() {
     return curr_view->my_rank;
 }
 
+ViewChangeTimings ViewManager::get_last_view_change_timings() {
+    lock_guard_t timings_lock(view_change_timings_mutex);
+    return last_view_change_timings;
+}
+
 std::vector<std::vector<node_id_t>> ViewManager::get_subgroup_members(subgroup_type_id_t subgroup_type, uint32_t subgroup_index) {
     shared_lock_t read_lock(view_mutex);
     subgroup_id_t subgroup_id = curr_view->subgroup_ids_by_type_id.at(subgroup_type).at(subgroup_index);
@@ -11,6 +11,7 @@
 namespace persistent {
 
 thread_local int64_t PersistentRegistry::earliest_version_to_serialize = INVALID_VERSION;
+thread_local bool PersistentRegistry::serialize_log_only = false;
 
 PersistentRegistry::PersistentRegistry(
         ITemporalQueryFrontierProvider* tqfp,
@@ -213,6 +214,15 @@ int64_t PersistentRegistry::getMinimumLatestPersistedVersion() {
     return min;
 }
 
+bool PersistentRegistry::canRebuildFromLog() const {
+    for(const auto& entry : m_registry) {
+        if(!entry.second->canRebuildWrappedObjectFromLog()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void PersistentRegistry::setEarliestVersionToSerialize(version_t ver) noexcept(true) {
     PersistentRegistry::earliest_version_to_serialize = ver;
 }
@@ -225,6 +235,14 @@ int64_t PersistentRegistry::getEarliestVersionToSerialize() noexcept(true) {
     return PersistentRegistry::earliest_version_to_serialize;
 }
 
+void PersistentRegistry::setSerializeLogOnly(bool log_only) noexcept(true) {
+    PersistentRegistry::serialize_log_only = log_only;
+}
+
+bool PersistentRegistry::getSerializeLogOnly() noexcept(true) {
+    return PersistentRegistry::serialize_log_only;
+}
+
 void PersistentRegistry::truncate(version_t last_version) {
     for(auto& entry : m_registry) {
         entry.second->truncate(last_version);
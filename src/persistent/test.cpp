@@ -11,7 +11,9 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <time.h>
+#include <filesystem>
 #include <iomanip>
+#include <vector>
 /**
  * @cond DoxygenSuppressed
  */
@@ -164,6 +166,9 @@ printhelp() {
     cout << "\tdelta-getbyidx <index>" << endl;
     cout << "\tdelta-getbyver <version>" << endl;
     cout << "\tdelta-verify <version> <desired-value>" << endl;
+    cout << "\tdelta-trimbyidx <index>" << endl;
+    cout << "\tdelta-logonly" << endl;
+    cout << "\tdelta-rejoin" << endl;
     cout << "NOTICE: test can crash if <datasize> is too large(>8MB).\n"
          << "This is probably due to the stack size is limited. Try \n"
          << "  \"ulimit -s unlimited\"\n"
@@ -416,7 +421,9 @@ int main(int argc, char** argv) {
             }
             PersistentRegistry::setEarliestVersionToSerialize(ver);
             ssize_t ds1 = npx_logtail.bytes_size();
-            ssize_t prefix = mutils::bytes_size(npx_logtail.getObjectName()) + mutils::bytes_size(*npx_logtail);
+            // object name, wrapped object flag, wrapped object, and signatures flag precede the log
+            ssize_t prefix = mutils::bytes_size(npx_logtail.getObjectName()) + sizeof(bool)
+                             + mutils::bytes_size(*npx_logtail) + sizeof(bool);
             uint8_t* buf = (uint8_t*)malloc(ds1);
             if(buf == NULL) {
                 cerr << "faile to allocate " << ds1 << " bytes for serialized data. prefix=" << prefix << " bytes" << endl;
@@ -566,6 +573,86 @@ int main(int argc, char** argv) {
             cout << "dx[ver:" << version << "] = " << dx[version]->value << endl;
             cout << "dx.delta[ver:" << version << "] = " << *dx.template getDelta<int>(version,true) << "\t- by copy" << endl;
             dx.template getDelta<int>(version, true, [version](const int& x){ cout << "dx.delta[ver:" << version << "] = " << x << "\t- by lambda" << std::endl;});
+        } else if(strcmp(argv[1], "delta-trimbyidx") == 0) {
+            int64_t nv = atol(argv[2]);
+            dx.trim(nv);
+            cout << "delta trim till index " << nv << " successfully" << endl;
+        } else if(strcmp(argv[1], "delta-logonly") == 0) {
+            // A log-only serialization may leave out the current state of a delta object only if
+            // the receiver can rebuild it by replaying the log from its first entry
+            const bool expect_wrapped_object = (dx.getNumOfVersions() == 0) || (dx.getEarliestIndex() != 0);
+            PersistentRegistry::setSerializeLogOnly(true);
+            const std::size_t expected_size = dx.bytes_size();
+            std::vector<uint8_t> buf(expected_size);
+            const std::size_t serialized_size = dx.to_bytes(buf.data());
+            PersistentRegistry::setSerializeLogOnly(false);
+            // the wrapped object flag follows the object name
+            const bool wrapped_object_included = *mutils::from_bytes_noalloc<bool>(
+                    nullptr, buf.data() + mutils::bytes_size(dx.getObjectName()));
+            cout << "versions=" << dx.getNumOfVersions() << ", earliest index=" << dx.getEarliestIndex()
+                 << ", wrapped object included=" << wrapped_object_included
+                 << " (expected " << expect_wrapped_object << ")" << endl;
+            if(wrapped_object_included != expect_wrapped_object || serialized_size != expected_size) {
+                cerr << "delta-logonly FAILED: serialized " << serialized_size << " of " << expected_size << " bytes" << endl;
+                return -1;
+            }
+            cout << "delta-logonly passed" << endl;
+        } else if(strcmp(argv[1], "delta-rejoin") == 0) {
+            // Replays the state transfer to a restarted node the way Group::receive_objects and
+            // ViewManager::send_subgroup_object do it, once for a joiner whose delta log is intact
+            // and once for a joiner that trimmed it. The leader's log is in the persistence path
+            // and the joiner's log is in the ramdisk, so both can use the same object name.
+            for(const bool trim_joiner_log : {false, true}) {
+                const std::string object_name = trim_joiner_log ? "DeltaRejoinTrimmed" : "DeltaRejoinIntact";
+                for(const char* suffix : {META_FILE_SUFFIX, LOG_FILE_SUFFIX, DATA_FILE_SUFFIX}) {
+                    std::filesystem::remove(getPersFilePath() + "/" + object_name + "." + suffix);
+                }
+                Persistent<IntegerWithDelta> leader([]() { return std::make_unique<IntegerWithDelta>(); },
+                                                    object_name.c_str(), nullptr, false);
+                version_t joiner_log_length;
+                bool joiner_can_rebuild;
+                {
+                    // The joiner saw the first three updates before it left the group
+                    PersistentRegistry joiner_pr(nullptr, typeid(ReplicatedT), 123, 322);
+                    Persistent<IntegerWithDelta, ST_MEM> joiner([]() { return std::make_unique<IntegerWithDelta>(); },
+                                                                object_name.c_str(), &joiner_pr, false);
+                    for(version_t ver = 0; ver < 3; ver++) {
+                        (*joiner).add(ver + 1);
+                        joiner.version(ver);
+                        joiner.persist();
+                    }
+                    if(trim_joiner_log) {
+                        joiner.trim(1);
+                    }
+                    joiner_log_length = joiner_pr.getMinimumLatestPersistedVersion();
+                    joiner_can_rebuild = joiner_pr.canRebuildFromLog();
+                }
+                for(version_t ver = 0; ver < 6; ver++) {
+                    (*leader).add(ver + 1);
+                    leader.version(ver);
+                    leader.persist();
+                }
+                PersistentRegistry::setEarliestVersionToSerialize(joiner_log_length);
+                PersistentRegistry::setSerializeLogOnly(joiner_can_rebuild);
+                std::vector<uint8_t> buf(leader.bytes_size());
+                leader.to_bytes(buf.data());
+                PersistentRegistry::setSerializeLogOnly(false);
+                PersistentRegistry::resetEarliestVersionToSerialize();
+                const bool wrapped_object_included = *mutils::from_bytes_noalloc<bool>(
+                        nullptr, buf.data() + mutils::bytes_size(leader.getObjectName()));
+                // Like a restarted joiner, the received object reopens the joiner's log and appends the tail to it
+                auto received = Persistent<IntegerWithDelta, ST_MEM>::from_bytes(nullptr, buf.data());
+                cout << object_name << ": joiner can rebuild=" << joiner_can_rebuild
+                     << ", wrapped object included=" << wrapped_object_included
+                     << ", received value=" << (**received).value << " at version " << received->getLatestVersion()
+                     << " (leader has " << (*leader).value << " at version " << leader.getLatestVersion() << ")" << endl;
+                if(joiner_can_rebuild == trim_joiner_log || wrapped_object_included != trim_joiner_log
+                   || (**received).value != (*leader).value || received->getLatestVersion() != leader.getLatestVersion()) {
+                    cerr << "delta-rejoin FAILED for " << object_name << endl;
+                    return -1;
+                }
+            }
+            cout << "delta-rejoin passed" << endl;
         } else if(strcmp(argv[1], "delta-verify") == 0) {
             if (!use_signature) {
                 std::cout << "unable to verify without signature...exit." << std::endl;
@@ -0,0 +1,148 @@
+#include <derecho/rdmc/detail/block_size.hpp>
+#include <derecho/rdmc/detail/message.hpp>
+#include <derecho/rdmc/detail/schedule.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/** With AUTO_TUNE, one in this many messages of a length class tries a different block size */
+constexpr uint32_t probe_interval = 16;
+/** The weight of the newest measurement in the moving average of throughput */
+constexpr double throughput_smoothing = 0.25;
+
+block_size_policy parse_block_size_policy(const string& name) {
+    if(name == "fixed") {
+        return block_size_policy::FIXED;
+    } else if(name == "model") {
+        return block_size_policy::MODEL;
+    } else if(name == "auto_tune") {
+        return block_size_policy::AUTO_TUNE;
+    }
+    throw invalid_argument("Unknown RDMC block size policy: " + name);
+}
+
+/** Returns the index of the highest set bit of a nonzero length. */
+static uint32_t length_class_of(size_t message_length) {
+    uint32_t length_class = 0;
+    while(message_length >>= 1) {
+        length_class++;
+    }
+    return length_class;
+}
+
+block_size_selector::block_size_selector(block_size_policy policy, size_t max_block_size,
+                                         double block_overhead_bytes, double rounds_per_block,
+                                         double pipeline_fill_rounds)
+        : policy(policy),
+          max_block_size(max_block_size),
+          block_overhead_bytes(block_overhead_bytes),
+          rounds_per_block(rounds_per_block),
+          pipeline_fill_rounds(pipeline_fill_rounds),
+          largest_shift(0) {
+    while(largest_shift < max_shift
+          && (max_block_size >> (largest_shift + 1)) >= min_block_size
+          && max_block_size % (size_t{1} << (largest_shift + 1)) == 0) {
+        largest_shift++;
+    }
+}
+
+block_size_selector block_size_selector::for_schedule(block_size_policy policy, size_t max_block_size,
+                                                      double block_overhead_bytes,
+                                                      const vector<unique_ptr<schedule>>& member_schedules,
+                                                      const vector<uint32_t>& member_racks,
+                                                      double uplink_capacity) {
+    double rounds_per_block = 1;
+    double pipeline_fill_rounds = 0;
+    if(policy != block_size_policy::FIXED) {
+        constexpr size_t fit_blocks = 16;
+        const double fit_rounds = estimate_schedule_time(member_schedules, member_racks, fit_blocks, uplink_capacity);
+        const double double_fit_rounds = estimate_schedule_time(member_schedules, member_racks, 2 * fit_blocks, uplink_capacity);
+        rounds_per_block = max((double_fit_rounds - fit_rounds) / fit_blocks, 1.0 / fit_blocks);
+        pipeline_fill_rounds = max(fit_rounds - fit_blocks * rounds_per_block, 0.0);
+    }
+    return block_size_selector(policy, max_block_size, block_overhead_bytes,
+                               rounds_per_block, pipeline_fill_rounds);
+}
+
+uint32_t block_size_selector::largest_shift_for(size_t message_length) const {
+    uint32_t shift = largest_shift;
+    while(shift > 0 && (message_length - 1) / get_block_size(shift) + 1 > max_blocks()) {
+        shift--;
+    }
+    return shift;
+}
+
+uint32_t block_size_selector::expected_shift(size_t message_length) const {
+    return policy == block_size_policy::FIXED ? 0 : model_shift(message_length);
+}
+
+uint32_t block_size_selector::model_shift(size_t message_length) const {
+    message_length = max(message_length, size_t{1});
+    uint32_t best_shift = 0;
+    double best_time = 0;
+    for(uint32_t shift = 0; shift <= largest_shift_for(message_length); ++shift) {
+        const size_t block_size = get_block_size(shift);
+        const size_t num_blocks = (message_length - 1) / block_size + 1;
+        // A block is never longer than the message
+        const double block_time = block_overhead_bytes + min(block_size, message_length);
+        const double time = (rounds_per_block * num_blocks + pipeline_fill_rounds) * block_time;
+        if(shift == 0 || time < best_time) {
+            best_shift = shift;
+            best_time = time;
+        }
+    }
+    return best_shift;
+}
+
+uint32_t block_size_selector::choose_shift(size_t message_length) {
+    if(policy == block_size_policy::FIXED) {
+        return 0;
+    } else if(policy == block_size_policy::MODEL) {
+        return model_shift(message_length);
+    }
+    const uint32_t shift_limit = largest_shift_for(message_length);
+    auto class_it = length_classes.find(length_class_of(message_length));
+    if(class_it == length_classes.end()) {
+        length_class new_class;
+        new_class.best_shift = model_shift(message_length);
+        new_class.messages_until_probe = probe_interval;
+        class_it = length_classes.emplace(length_class_of(message_length), new_class).first;
+    }
+    length_class& stats = class_it->second;
+    const uint32_t best_shift = min(stats.best_shift, shift_limit);
+    if(--stats.messages_until_probe > 0) {
+        return best_shift;
+    }
+    // Try the neighboring block sizes in turn, so the best one can drift
+    // toward whichever is faster
+    stats.messages_until_probe = probe_interval;
+    stats.probe_smaller_blocks = !stats.probe_smaller_blocks;
+    if(stats.probe_smaller_blocks && best_shift < shift_limit) {
+        return best_shift + 1;
+    } else if(!stats.probe_smaller_blocks && best_shift > 0) {
+        return best_shift - 1;
+    }
+    return best_shift;
+}
+
+void block_size_selector::record_transfer(size_t message_length, uint32_t shift,
+                                          std::chrono::nanoseconds duration) {
+    if(policy != block_size_policy::AUTO_TUNE || duration.count() <= 0) {
+        return;
+    }
+    auto class_it = length_classes.find(length_class_of(message_length));
+    if(class_it == length_classes.end()) {
+        return;
+    }
+    length_class& stats = class_it->second;
+    const double throughput = static_cast<double>(message_length) / duration.count();
+    double& average = stats.throughput[shift];
+    average = average == 0 ? throughput : (1 - throughput_smoothing) * average + throughput_smoothing * throughput;
+    for(uint32_t candidate = 0; candidate <= max_shift; ++candidate) {
+        if(stats.throughput[candidate] > stats.throughput[stats.best_shift]) {
+            stats.best_shift = candidate;
+        }
+    }
+}
@@ -53,7 +53,7 @@ void polling_group::initialize_message_types() {
                                            size_t length) {
         ParsedTag parsed_tag = parse_tag(tag);
         shared_ptr<group> g = find_group(parsed_tag.group_number);
-        if(g) g->receive_block(immediate, length);
+        if(g) g->receive_block(immediate, length, parsed_tag.target);
     };
     auto send_ready_for_block = [](uint64_t, uint32_t, size_t) {};
     auto receive_ready_for_block = [find_group](
@@ -71,14 +71,22 @@ polling_group::polling_group(uint16_t _group_number, size_t _block_size,
                              vector<uint32_t> _members, uint32_t _member_index,
                              incoming_message_callback_t upcall,
                              completion_callback_t callback,
-                             unique_ptr<schedule> _schedule)
+                             unique_ptr<schedule> _schedule,
+                             block_size_selector _block_sizes,
+                             uint32_t _pipeline_depth,
+                             size_t _expected_message_size)
         : group(_group_number, _block_size, _members, _member_index, upcall,
                 callback, std::move(_schedule)),
-          first_block_buffer(nullptr) {
+          pipeline_depth(max(_pipeline_depth, 1u)),
+          block_sizes(std::move(_block_sizes)),
+          message_block_size(_block_size),
+          first_block_buffer(nullptr),
+          expected_message_size(_expected_message_size) {
+    // No message has been sent yet, so the number of blocks is unknown
+    num_blocks = 0;
     if(member_index != 0) {
-        first_block_buffer = unique_ptr<uint8_t[]>(new uint8_t[block_size]);
-        memset(first_block_buffer.get(), 0, block_size);
-        first_block_mr = make_unique<memory_region>(first_block_buffer.get(), block_size);
+        first_block_buffer = derecho::allocate_registered_memory(block_size);
+        first_block_mr = make_unique<memory_region>(first_block_buffer.get(), block_size, true);
     }
 
     auto connections = transfer_schedule->get_connections();
@@ -87,155 +95,93 @@ polling_group::polling_group(uint16_t _group_number, size_t _block_size,
     }
 
     if(member_index > 0) {
-        auto transfer = transfer_schedule->get_first_block(num_blocks);
-        first_block_number = transfer->block_number;
-        post_recv(*transfer);
-        incoming_block = transfer->block_number;
-        send_ready_for_block(transfer->target);
-        // puts("Issued Ready For Block CCCCCCCCC");
+        prepare_for_next_message();
     }
 }
-void polling_group::receive_block(uint32_t send_imm, size_t received_block_size) {
+void polling_group::receive_block(uint32_t send_imm, size_t received_block_size, uint32_t sender) {
     unique_lock<mutex> lock(monitor);
 
     assert(member_index > 0);
 
-    if(receive_step == 0) {
-        num_blocks = parse_immediate(send_imm).total_blocks;
+    // With several blocks in flight from different neighbors, blocks can
+    // arrive out of schedule order, so rely on the block number the sender
+    // put in the immediate
+    const ParsedImmediate immediate = parse_immediate(send_imm, block_sizes.varies_block_size());
+    const size_t block_number = immediate.block_number;
+    receives_in_flight[sender]--;
+
+    if(num_received_blocks == 0) {
+        num_blocks = immediate.total_blocks;
+        message_block_shift = immediate.block_size_shift;
+        message_block_size = block_sizes.get_block_size(message_block_shift);
         first_block_number = min(transfer_schedule->get_first_block(num_blocks)->block_number,
                                  num_blocks - 1);
-        message_size = num_blocks * block_size;
+        first_block_length = received_block_size;
+        message_size = num_blocks * message_block_size;
         if(num_blocks == 1) {
             message_size = received_block_size;
         }
 
-        assert(*first_block_number == parse_immediate(send_imm).block_number);
+        assert(*first_block_number == block_number);
 
         //////////////////////////////////////////////////////
-        auto destination = incoming_message_upcall(message_size);
-        mr_offset = destination.offset;
-        mr = destination.mr;
+        if(next_destination && next_destination->mr->size >= next_destination->offset + message_size) {
+            mr_offset = next_destination->offset;
+            mr = next_destination->mr;
+        } else {
+            // The destination requested in advance, if any, is too small for this message
+            auto destination = incoming_message_upcall(message_size);
+            mr_offset = destination.offset;
+            mr = destination.mr;
+        }
 
         assert(mr->size >= mr_offset + message_size);
         //////////////////////////////////////////////////////
 
-        num_received_blocks = 1;
-        received_blocks = vector<bool>(num_blocks);
-        received_blocks[*first_block_number] = true;
-
-        LOG_EVENT(group_number, message_number, *first_block_number,
-                  "initialized_internal_datastructures");
-
-        assert(receive_step == 0);
-        auto transfer = transfer_schedule->get_incoming_transfer(num_blocks,
-                                                                 receive_step);
-        while((!transfer || transfer->block_number == *first_block_number) && receive_step < transfer_schedule->get_total_steps(num_blocks)) {
-            transfer = transfer_schedule->get_incoming_transfer(num_blocks, ++receive_step);
-        }
-
-        // cout << "receive_step = " << receive_step
-        //      << " transfer->block_number = "
-        //      << transfer->block_number
-        //      << " first_block_number = " << *first_block_number
-        //      << " total_steps = " << get_total_steps() << endl;
-
-        LOG_EVENT(group_number, message_number, *first_block_number,
-                  "found_next_transfer");
-
-        if(transfer) {
-            LOG_EVENT(group_number, message_number, transfer->block_number,
-                      "posting_recv");
-            // printf("Posting recv #%d (receive_step = %d,
-            // *first_block_number =
-            // %d, total_steps = %d)\n",
-            //        (int)transfer->block_number, (int)receive_step,
-            // (int)*first_block_number, (int)get_total_steps());
-            post_recv(*transfer);
-            incoming_block = transfer->block_number;
-            send_ready_for_block(transfer->target);
-            // cout << "Issued Ready For Block AAAAAAAA (receive_step = "
-            //      << receive_step << ", target = " << transfer->target << ")"
-            //      << endl;
-
-            for(auto r = receive_step + 1; r < transfer_schedule->get_total_steps(num_blocks); r++) {
-                auto t = transfer_schedule->get_incoming_transfer(num_blocks, r);
-                if(t) {
-                    // cout << "posting block for step " << (int)r
-                    //      << " (block #" << (*t).block_number << ")" << endl;
-                    post_recv(*t);
-                    break;
-                }
+        first_block_in_destination = first_block_landing_offset.has_value();
+        if(first_block_landing_offset) {
+            // The block landed where it would be in a message of the expected
+            // size; move it if this message is laid out differently. No other
+            // receives into the destination have been posted yet.
+            uint8_t* landed_block = next_destination->mr->buffer + next_destination->offset + *first_block_landing_offset;
+            uint8_t* final_block = mr->buffer + mr_offset + message_block_size * block_number;
+            if(landed_block != final_block) {
+                memmove(final_block, landed_block, received_block_size);
+                LOG_EVENT(group_number, message_number, block_number, "moved_first_block");
             }
         }
+        next_destination.reset();
+        first_block_landing_offset.reset();
 
-        LOG_EVENT(group_number, message_number, *first_block_number,
-                  "calling_send_next_block");
-
-        send_next_block();
+        received_blocks = vector<bool>(num_blocks);
+        receive_step = 0;
 
         LOG_EVENT(group_number, message_number, *first_block_number,
-                  "returned_from_send_next_block");
-
-        if(!sending && num_received_blocks == num_blocks && send_step == transfer_schedule->get_total_steps(num_blocks)) {
-            complete_message();
-        }
+                  "initialized_internal_datastructures");
     } else {
-        //        assert(tag.index() <= tag.message_size());
-        size_t block_number = incoming_block;
-        if(block_number != parse_immediate(send_imm).block_number) {
-            printf("Expected block #%d but got #%d on step %d\n",
-                   (int)block_number,
-                   (int)parse_immediate(send_imm).block_number,
-                   (int)receive_step);
-            fflush(stdout);
-        }
-        assert(block_number == parse_immediate(send_imm).block_number);
-
         if(block_number == num_blocks - 1) {
-            message_size = (num_blocks - 1) * block_size + received_block_size;
+            message_size = (num_blocks - 1) * message_block_size + received_block_size;
         } else {
-            assert(received_block_size == block_size);
+            assert(received_block_size == message_block_size);
         }
+    }
 
-        received_blocks[block_number] = true;
-
-        LOG_EVENT(group_number, message_number, block_number, "received_block");
+    received_blocks[block_number] = true;
+    ++num_received_blocks;
 
-        // Figure out the next block to receive.
-        std::optional<schedule::block_transfer> transfer;
-        while(!transfer && receive_step + 1 < transfer_schedule->get_total_steps(num_blocks)) {
-            transfer = transfer_schedule->get_incoming_transfer(num_blocks, ++receive_step);
-        }
+    LOG_EVENT(group_number, message_number, block_number, "received_block");
 
-        // Post a receive for it.
-        if(transfer) {
-            incoming_block = transfer->block_number;
-            send_ready_for_block(transfer->target);
-            // cout << "Issued Ready For Block BBBBBBBB (receive_step = "
-            //      << receive_step << ", target = " << transfer->target
-            //      << ", total_steps = " << get_total_steps() << ")" << endl;
-            for(auto r = receive_step + 1; r < transfer_schedule->get_total_steps(num_blocks); r++) {
-                auto t = transfer_schedule->get_incoming_transfer(num_blocks, r);
-                if(t) {
-                    post_recv(*t);
-                    break;
-                }
-            }
-        }
+    // Refill the receive window, then forward any blocks this one made available
+    post_receives();
+    send_next_block();
 
-        // If we just finished receiving a block and we weren't
-        // previously sending, then try to send now.
-        if(!sending) {
-            send_next_block();
-        }
-        // If we just received the last block and aren't still sending then
-        // issue a completion callback
-        if(++num_received_blocks == num_blocks && !sending && send_step == transfer_schedule->get_total_steps(num_blocks)) {
-            complete_message();
-        }
+    // If we just received the last block and aren't still sending then
+    // issue a completion callback
+    if(num_received_blocks == num_blocks && sends_in_flight == 0 && send_step == transfer_schedule->get_total_steps(num_blocks)) {
+        complete_message();
     }
 }
-void polling_group::receive_ready_for_block(uint32_t step, uint32_t sender) {
+void polling_group::receive_ready_for_block(uint32_t num_credits, uint32_t sender) {
     unique_lock<mutex> lock(monitor);
 
 #ifdef USE_VERBS_API
@@ -248,9 +194,10 @@ void polling_group::receive_ready_for_block(uint32_t step, uint32_t sender) {
     it->second.post_empty_recv(form_tag(group_number, sender),
                                message_types.ready_for_block);
 
-    receivers_ready.insert(sender);
+    // A ready-for-block message without a count grants a single credit
+    receiver_credits[sender] += max(num_credits, 1u);
 
-    if(!sending && mr) {
+    if(mr) {
         send_next_block();
     }
 }
@@ -260,12 +207,14 @@ void polling_group::complete_block_send() {
     LOG_EVENT(group_number, message_number, outgoing_block,
               "finished_sending_block");
 
+    assert(sends_in_flight > 0);
+    --sends_in_flight;
     send_next_block();
 
     // If we just send the last block, and were already done
     // receiving, then signal completion and prepare for the next
     // message.
-    if(!sending && send_step == transfer_schedule->get_total_steps(num_blocks) && (member_index == 0 || num_received_blocks == num_blocks)) {
+    if(sends_in_flight == 0 && send_step == transfer_schedule->get_total_steps(num_blocks) && (member_index == 0 || num_received_blocks == num_blocks)) {
         complete_message();
     }
 }
@@ -283,78 +232,101 @@ void polling_group::send_message(shared_ptr<memory_region> message_mr, size_t of
     if(receive_step > 0) throw rdmc::group_busy();
     if(send_step > 0) throw rdmc::group_busy();
 
+    message_block_shift = block_sizes.choose_shift(length);
+    message_block_size = block_sizes.get_block_size(message_block_shift);
+    num_blocks = (length - 1) / message_block_size + 1;
+    if(num_blocks > block_sizes.max_blocks())
+        throw rdmc::invalid_args();
     mr = message_mr;
     mr_offset = offset;
     message_size = length;
-    num_blocks = (message_size - 1) / block_size + 1;
-    if(num_blocks > std::numeric_limits<uint16_t>::max())
-        throw rdmc::invalid_args();
     // printf("message_size = %lu, block_size = %lu, num_blocks = %lu\n",
-    //        message_size, block_size, num_blocks);
+    //        message_size, message_block_size, num_blocks);
     LOG_EVENT(group_number, message_number, -1, "send_message");
+    send_start_time = std::chrono::steady_clock::now();
 
     send_next_block();
     // No need to worry about completion here. We must send at least
     // one block, so we can't be done already.
 }
 void polling_group::send_next_block() {
-    sending = false;
-    if(send_step == transfer_schedule->get_total_steps(num_blocks)) {
-        return;
-    }
-    auto transfer = transfer_schedule->get_outgoing_transfer(num_blocks, send_step);
-    while(!transfer) {
-        if(++send_step == transfer_schedule->get_total_steps(num_blocks)) return;
-
-        transfer = transfer_schedule->get_outgoing_transfer(num_blocks, send_step);
-    }
+    const size_t total_steps = transfer_schedule->get_total_steps(num_blocks);
+    while(send_step < total_steps) {
+        auto transfer = transfer_schedule->get_outgoing_transfer(num_blocks, send_step);
+        if(!transfer) {
+            ++send_step;
+            continue;
+        }
 
-    size_t target = transfer->target;
-    size_t block_number = transfer->block_number;
-    //    size_t forged_block_number = transfer->forged_block_number;
+        size_t target = transfer->target;
+        size_t block_number = transfer->block_number;
+        //    size_t forged_block_number = transfer->forged_block_number;
 
-    if(member_index > 0 && !received_blocks[block_number]) return;
+        if(member_index > 0 && !received_blocks[block_number]) return;
 
-    if(receivers_ready.count(transfer->target) == 0) {
-        LOG_EVENT(group_number, message_number, block_number,
-                  "receiver_not_ready");
-        return;
-    }
+        auto credits = receiver_credits.find(target);
+        if(credits == receiver_credits.end() || credits->second == 0) {
+            LOG_EVENT(group_number, message_number, block_number,
+                      "receiver_not_ready");
+            return;
+        }
 
-    receivers_ready.erase(transfer->target);
-    sending = true;
-    ++send_step;
+        credits->second--;
+        ++sends_in_flight;
+        ++send_step;
 
-    // printf("sending block #%d to node #%d on step %d\n", (int)block_number,
-    // 	   (int)target, (int)send_step-1);
-    // fflush(stdout);
 #ifdef USE_VERBS_API
-    auto it = queue_pairs.find(target);
-    assert(it != queue_pairs.end());
+        auto it = queue_pairs.find(target);
+        assert(it != queue_pairs.end());
 #else
-    auto it = endpoints.find(target);
-    assert(it != endpoints.end());
+        auto it = endpoints.find(target);
+        assert(it != endpoints.end());
 #endif
-    if(first_block_number && block_number == *first_block_number) {
-        CHECK(it->second.post_send(*first_block_mr, 0, block_size,
-                                   form_tag(group_number, target),
-                                   form_immediate(num_blocks, block_number),
-                                   message_types.data_block));
-    } else {
-        size_t offset = block_number * block_size;
-        size_t nbytes = min(block_size, message_size - offset);
-        CHECK(it->second.post_send(*mr, mr_offset + offset, nbytes,
-                                   form_tag(group_number, target),
-                                   form_immediate(num_blocks, block_number),
-                                   message_types.data_block));
+        if(!first_block_in_destination && first_block_number && block_number == *first_block_number) {
+            CHECK(it->second.post_send(*first_block_mr, 0, first_block_length,
+                                       form_tag(group_number, target),
+                                       form_immediate(block_sizes.varies_block_size(), message_block_shift, num_blocks, block_number),
+                                       message_types.data_block));
+        } else {
+            size_t offset = block_number * message_block_size;
+            size_t nbytes = min(message_block_size, message_size - offset);
+            CHECK(it->second.post_send(*mr, mr_offset + offset, nbytes,
+                                       form_tag(group_number, target),
+                                       form_immediate(block_sizes.varies_block_size(), message_block_shift, num_blocks, block_number),
+                                       message_types.data_block));
+        }
+        outgoing_block = block_number;
+        LOG_EVENT(group_number, message_number, block_number,
+                  "started_sending_block");
+    }
+}
+void polling_group::post_receives() {
+    const size_t total_steps = transfer_schedule->get_total_steps(num_blocks);
+    map<uint32_t, uint32_t> new_credits;
+    for(; receive_step < total_steps; ++receive_step) {
+        auto transfer = transfer_schedule->get_incoming_transfer(num_blocks, receive_step);
+        // The first block has already been received into first_block_mr
+        if(!transfer || transfer->block_number == *first_block_number) {
+            continue;
+        }
+        // Receives are matched in the order they are posted, so stop at the
+        // first neighbor whose window is full rather than skipping ahead
+        if(receives_in_flight[transfer->target] >= pipeline_depth) {
+            break;
+        }
+        LOG_EVENT(group_number, message_number, transfer->block_number,
+                  "posting_recv");
+        post_recv(*transfer);
+        receives_in_flight[transfer->target]++;
+        new_credits[transfer->target]++;
+    }
+    for(const auto& neighbor_credits : new_credits) {
+        send_ready_for_block(neighbor_credits.first, neighbor_credits.second);
     }
-    outgoing_block = block_number;
-    LOG_EVENT(group_number, message_number, block_number,
-              "started_sending_block");
 }
 void polling_group::complete_message() {
     // remap first_block into buffer
-    if(member_index > 0 && first_block_number) {
+    if(member_index > 0 && first_block_number && !first_block_in_destination) {
         LOG_EVENT(group_number, message_number, *first_block_number,
                   "starting_remap_first_block");
         // if(block_size > (128 << 10) && (block_size % 4096 == 0)) {
@@ -370,16 +342,20 @@ void polling_group::complete_message() {
         //            buffer + block_size * (*first_block_number));
         //     first_block_buffer = tmp_buffer;
         // } else {
-        memcpy(mr->buffer + mr_offset + block_size * (*first_block_number),
-               first_block_buffer.get(), block_size);
+        memcpy(mr->buffer + mr_offset + message_block_size * (*first_block_number),
+               first_block_buffer.get(), first_block_length);
         // }
         LOG_EVENT(group_number, message_number, *first_block_number,
                   "finished_remap_first_block");
     }
+    if(member_index == 0) {
+        block_sizes.record_transfer(message_size, message_block_shift,
+                                    std::chrono::steady_clock::now() - send_start_time);
+    }
     completion_callback(mr->buffer + mr_offset, message_size);
 
     ++message_number;
-    sending = false;
+    sends_in_flight = 0;
     send_step = 0;
     receive_step = 0;
     mr.reset();
@@ -395,16 +371,34 @@ void polling_group::complete_message() {
     if(member_index != 0) {
         num_received_blocks = 0;
         received_blocks.clear();
-        auto transfer = transfer_schedule->get_first_block(num_blocks);
-        assert(transfer);
-        first_block_number = transfer->block_number;
-        post_recv(*transfer);
-        incoming_block = transfer->block_number;
-        send_ready_for_block(transfer->target);
-        // cout << "Issued Ready For Block DDDDDDD (target = " <<
-        // transfer->target
-        //      << ")" << endl;
+        prepare_for_next_message();
+    }
+}
+void polling_group::prepare_for_next_message() {
+    first_block_in_destination = false;
+    size_t expected_num_blocks = num_blocks;
+    size_t expected_block_size = message_block_size;
+    if(expected_message_size > 0) {
+        expected_block_size = block_sizes.get_block_size(block_sizes.expected_shift(expected_message_size));
+        expected_num_blocks = (expected_message_size - 1) / expected_block_size + 1;
+        // Requesting the destination here keeps the upcall off the path
+        // between the first block's arrival and forwarding it
+        next_destination = incoming_message_upcall(expected_message_size);
+        LOG_EVENT(group_number, message_number, -1, "requested_next_destination");
+    }
+    auto transfer = transfer_schedule->get_first_block(expected_num_blocks);
+    assert(transfer);
+    first_block_number = transfer->block_number;
+    if(next_destination) {
+        const size_t capacity = next_destination->mr->size - next_destination->offset;
+        if(capacity >= block_size) {
+            // Leave room for a block of the largest size, in case the message uses it
+            first_block_landing_offset = min(expected_block_size * transfer->block_number, capacity - block_size);
+        }
     }
+    post_recv(*transfer);
+    receives_in_flight[transfer->target]++;
+    send_ready_for_block(transfer->target, 1);
 }
 void polling_group::post_recv(schedule::block_transfer transfer) {
 #ifdef USE_VERBS_API
@@ -419,12 +413,19 @@ void polling_group::post_recv(schedule::block_transfer transfer) {
     // fflush(stdout);
 
     if(first_block_number && transfer.block_number == *first_block_number) {
-        CHECK(it->second.post_recv(*first_block_mr, 0, block_size,
-                                   form_tag(group_number, transfer.target),
-                                   message_types.data_block));
+        if(first_block_landing_offset) {
+            CHECK(it->second.post_recv(*next_destination->mr,
+                                       next_destination->offset + *first_block_landing_offset, block_size,
+                                       form_tag(group_number, transfer.target),
+                                       message_types.data_block));
+        } else {
+            CHECK(it->second.post_recv(*first_block_mr, 0, block_size,
+                                       form_tag(group_number, transfer.target),
+                                       message_types.data_block));
+        }
     } else {
-        size_t offset = block_size * transfer.block_number;
-        size_t length = min(block_size, (size_t)(message_size - offset));
+        size_t offset = message_block_size * transfer.block_number;
+        size_t length = min(message_block_size, (size_t)(message_size - offset));
 
         if(length > 0) {
             CHECK(it->second.post_recv(*mr, mr_offset + offset, length,
@@ -439,9 +440,12 @@ void polling_group::connect(uint32_t neighbor) {
 #ifdef USE_VERBS_API
     queue_pairs.emplace(neighbor, queue_pair(members[neighbor]));
 
+    // The neighbor can have one ready-for-block message in flight per credit
     auto post_recv = [this, neighbor](rdma::queue_pair* qp) {
-        qp->post_empty_recv(form_tag(group_number, neighbor),
-                            message_types.ready_for_block);
+        for(uint32_t i = 0; i < pipeline_depth; ++i) {
+            qp->post_empty_recv(form_tag(group_number, neighbor),
+                                message_types.ready_for_block);
+        }
     };
 
     rfb_queue_pairs.emplace(neighbor, queue_pair(members[neighbor], post_recv));
@@ -450,16 +454,19 @@ void polling_group::connect(uint32_t neighbor) {
     bool is_lf_server = members[member_index] < members[neighbor];
     endpoints.emplace(neighbor, endpoint(members[neighbor], is_lf_server));
 
+    // The neighbor can have one ready-for-block message in flight per credit
     auto post_recv = [this, neighbor](rdma::endpoint* ep) {
-        ep->post_empty_recv(form_tag(group_number, neighbor),
-                            message_types.ready_for_block);
+        for(uint32_t i = 0; i < pipeline_depth; ++i) {
+            ep->post_empty_recv(form_tag(group_number, neighbor),
+                                message_types.ready_for_block);
+        }
     };
 
     rfb_endpoints.emplace(neighbor, endpoint(members[neighbor], is_lf_server, post_recv));
 #endif
 }
 
-void polling_group::send_ready_for_block(uint32_t neighbor) {
+void polling_group::send_ready_for_block(uint32_t neighbor, uint32_t num_credits) {
 #ifdef USE_VERBS_API
     auto it = rfb_queue_pairs.find(neighbor);
     assert(it != rfb_queue_pairs.end());
@@ -468,6 +475,6 @@ void polling_group::send_ready_for_block(uint32_t neighbor) {
     assert(it != rfb_endpoints.end());
 #endif
 
-    it->second.post_empty_send(form_tag(group_number, neighbor), 0,
+    it->second.post_empty_send(form_tag(group_number, neighbor), num_credits,
                                message_types.ready_for_block);
 }
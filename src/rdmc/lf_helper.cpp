@@ -1,12 +1,17 @@
 #include <derecho/rdmc/detail/lf_helper.hpp>
 
 #include <derecho/conf/conf.hpp>
+#include <derecho/core/detail/completion_poller.hpp>
 #include <derecho/core/detail/connection_manager.hpp>
+#include <derecho/core/detail/multi_rail.hpp>
 #include <derecho/rdmc/detail/util.hpp>
 #include <derecho/tcp/tcp.hpp>
 #include <derecho/utils/logger.hpp>
+#include <derecho/utils/registration_cache.hpp>
 
+#include <algorithm>
 #include <arpa/inet.h>
+#include <array>
 #include <atomic>
 #include <byteswap.h>
 #include <cstring>
@@ -58,8 +63,10 @@ inline void crash_with_message(const char* format_str, ...) {
  */
 static constexpr size_t max_lf_addr_size = 128 - sizeof(uint32_t) - 2 * sizeof(uint64_t);
 struct cm_con_data_t {
-    uint32_t pep_addr_len;           /** local endpoint address length */
-    char pep_addr[max_lf_addr_size]; /** local endpoint address */
+    uint32_t rail_mask;                                           /** rails the local node can use */
+    uint32_t rail_weights[derecho::max_rails];                    /** local weight of each rail */
+    uint32_t pep_addr_len[derecho::max_rails];                    /** local endpoint address length on each rail */
+    char pep_addr[derecho::max_rails][max_lf_addr_size];          /** local endpoint address on each rail */
 } __attribute__((packed));
 
 /**
@@ -89,21 +96,38 @@ static std::mutex completion_handlers_mutex;
  */
 struct lf_ctxt {
     struct fi_info* hints;           /** hints */
+    struct fi_eq_attr eq_attr;       /** event queue attributes */
+    struct fi_cq_attr cq_attr;       /** completion queue attributes */
+};
+/** The global context for libfabric */
+struct lf_ctxt g_ctxt;
+
+/**
+ * The libfabric resources of one rail, i.e. one NIC
+ */
+struct lf_rail {
+    std::string domain_name;         /** name of the rail's domain */
+    uint32_t weight;                 /** share of striped traffic */
+    std::atomic<bool> usable;        /** false if the rail failed to open or its link went down */
+    struct fi_info* hints;           /** hints, with the rail's domain */
     struct fi_info* fi;              /** fabric information */
     struct fid_fabric* fabric;       /** fabric handle */
     struct fid_domain* domain;       /** domain handle */
     struct fid_pep* pep;             /** passive endpoint for receiving connection */
     struct fid_eq* peq;              /** event queue for connection management */
-    struct fid_cq* cq;               /** completion queue for all rma operations */
+    struct fid_cq* cq;               /** completion queue for all rma operations on the rail */
     size_t pep_addr_len;             /** length of local pep address */
     char pep_addr[max_lf_addr_size]; /** local pep address */
-    struct fi_eq_attr eq_attr;       /** event queue attributes */
-    struct fi_cq_attr cq_attr;       /** completion queue attributes */
+    uint64_t completion_source_id;   /** the rail's completion queue in the completion poller */
 };
-/** The global context for libfabric */
-struct lf_ctxt g_ctxt;
-
-#define LF_USE_VADDR ((g_ctxt.fi->domain_attr->mr_mode) & (FI_MR_VIRT_ADDR | FI_MR_BASIC))
+/** The rails, in the order they are configured */
+static std::vector<std::unique_ptr<lf_rail>> rails;
+/** The lowest rail that opened, which completion queues and other per-domain objects use */
+static lf_rail* primary_rail;
+/** Caches registrations for memory regions that ask for it, if enabled in the configuration */
+static std::unique_ptr<derecho::registration_cache> registration_cache;
+
+#define LF_USE_VADDR ((primary_rail->fi->domain_attr->mr_mode) & (FI_MR_VIRT_ADDR | FI_MR_BASIC))
 #define LF_CONFIG_FILE "rdma.cfg"
 
 enum RDMAOps {
@@ -133,17 +157,12 @@ static void default_context() {
     g_ctxt.hints->mode = ~0;
     /** Set the completion format to contain additional context */
     g_ctxt.cq_attr.format = FI_CQ_FORMAT_DATA;
-    /** Use a file descriptor as the wait object (see polling_loop)*/
+    /** Use a file descriptor as the wait object, so the completion poller can block on it */
     g_ctxt.cq_attr.wait_obj = FI_WAIT_FD;
-    /** Set the size of the local pep address */
-    g_ctxt.pep_addr_len = max_lf_addr_size;
 
-    /** Set the provider, can be verbs|psm|sockets|usnic */
+    /** Set the provider, can be verbs|psm|sockets|usnic; each rail sets its own domain */
     g_ctxt.hints->fabric_attr->prov_name = crash_if_nullptr("strdup provider name.",
                                                             strdup, derecho::getConfString(derecho::Conf::RDMA_PROVIDER).c_str());
-    /** Set the domain */
-    g_ctxt.hints->domain_attr->name = crash_if_nullptr("strdup domain name.",
-                                                       strdup, derecho::getConfString(derecho::Conf::RDMA_DOMAIN).c_str());
     /** Set the memory region mode mode bits, see fi_mr(3) for details */
     if((strcmp(g_ctxt.hints->fabric_attr->prov_name, "sockets") == 0) ||
        (strcmp(g_ctxt.hints->fabric_attr->prov_name, "tcp") == 0)) {
@@ -161,6 +180,25 @@ static void default_context() {
         g_ctxt.hints->domain_attr->mr_mode = FI_MR_LOCAL | FI_MR_ALLOCATED | FI_MR_PROV_KEY | FI_MR_VIRT_ADDR;
     }
 }
+
+/**
+ * Returns a bitmask of the rails the local node can use for a new
+ * connection: those that opened and whose link is still up.
+ */
+static uint32_t get_usable_rail_mask() {
+    uint32_t mask = 0;
+    for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+        if(rails[rail]->usable && !derecho::rail_link_is_up(rails[rail]->domain_name)) {
+            dbg_default_warn("RDMC: the link of rail {} ({}) is down, so new connections will not use it",
+                             rail, rails[rail]->domain_name);
+            rails[rail]->usable = false;
+        }
+        if(rails[rail]->usable) {
+            mask |= 1u << rail;
+        }
+    }
+    return mask;
+}
 }  // namespace impl
 
 //Within the CPP file, the impl functions should be available
@@ -170,42 +208,61 @@ using namespace impl;
  * Memory region constructors and member functions
  */
 
-memory_region::memory_region(size_t s) : memory_region(new uint8_t[s], s) {
-    allocated_buffer.reset(buffer);
+memory_region::memory_region(size_t s) : memory_region(derecho::allocate_registered_memory(s), s) {}
+
+memory_region::memory_region(derecho::registered_array<uint8_t> buf, size_t s) : memory_region(buf.get(), s, true) {
+    allocated_buffer = std::move(buf);
 }
 
-memory_region::memory_region(uint8_t* buf, size_t s) : buffer(buf), size(s) {
+memory_region::memory_region(uint8_t* buf, size_t s, bool use_registration_cache) : buffer(buf), size(s) {
     if(!buffer || size <= 0) throw rdma::invalid_args();
 
-    const int mr_access = FI_WRITE | FI_REMOTE_READ | FI_REMOTE_WRITE;
-
     /** touch the memory region before register it, because some libfabric providers might not do that in fi_mr_reg **/
     memset(reinterpret_cast<void*>(buffer), 0, size);
 
-    /** Register the memory, use it to construct a smart pointer */
-    fid_mr* raw_mr;
-    fail_if_nonzero_retry_on_eagain(
-            "Failed to register memory", CRASH_ON_FAILURE,
-            fi_mr_reg, g_ctxt.domain, (void*)buffer, size, mr_access, 0, 0, 0, &raw_mr, nullptr);
-    if(!raw_mr) {
-        crash_with_message("Pointer to memory region is null");
+    if(use_registration_cache && registration_cache) {
+        mrs = std::static_pointer_cast<rail_registrations>(registration_cache->acquire(buffer, size));
+    } else {
+        mrs = register_memory(buffer, size);
     }
+}
+
+std::shared_ptr<memory_region::rail_registrations> memory_region::register_memory(void* start, size_t size) {
+    const int mr_access = FI_WRITE | FI_REMOTE_READ | FI_REMOTE_WRITE;
+
+    /** Register the memory in each rail's domain, use it to construct a smart pointer */
+    auto registrations = std::make_shared<rail_registrations>(rails.size());
+    for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+        if(!rails[rail]->domain) {
+            continue;
+        }
+        fid_mr* raw_mr;
+        fail_if_nonzero_retry_on_eagain(
+                "Failed to register memory", CRASH_ON_FAILURE,
+                fi_mr_reg, rails[rail]->domain, start, size, mr_access, 0, 0, 0, &raw_mr, nullptr);
+        if(!raw_mr) {
+            crash_with_message("Pointer to memory region is null");
+        }
 
-    mr = std::unique_ptr<fid_mr, std::function<void(fid_mr*)>>(
-            raw_mr, [](fid_mr* mr) { fi_close(&mr->fid); });
+        (*registrations)[rail] = std::unique_ptr<fid_mr, std::function<void(fid_mr*)>>(
+                raw_mr, [](fid_mr* mr) { fi_close(&mr->fid); });
+    }
+    return registrations;
 }
 
-uint64_t memory_region::get_key() const { return mr->key; }
+uint64_t memory_region::get_key(uint32_t rail) const {
+    return (rail < mrs->size() && (*mrs)[rail]) ? (*mrs)[rail]->key : 0;
+}
 
 /**
  * Completion queue constructor
  */
 completion_queue::completion_queue() {
-    g_ctxt.cq_attr.size = g_ctxt.fi->tx_attr->size;
+    g_ctxt.cq_attr.size = primary_rail->fi->tx_attr->size;
     fid_cq* raw_cq;
     fail_if_nonzero_retry_on_eagain(
             "failed to initialize tx completion queue", CRASH_ON_FAILURE,
-            fi_cq_open, g_ctxt.domain, &(g_ctxt.cq_attr), &raw_cq, nullptr);
+            fi_cq_open, primary_rail->domain, &(g_ctxt.cq_attr), &raw_cq, nullptr);
     if(!raw_cq) {
         crash_with_message("Pointer to completion queue is null");
     }
@@ -222,18 +279,19 @@ endpoint::endpoint(size_t remote_index, bool is_lf_server,
     connect(remote_index, is_lf_server, post_recvs);
 }
 
-int endpoint::init(struct fi_info* fi) {
+int endpoint::init(rail_endpoint& rail_ep, struct fi_info* fi) {
     int ret;
+    lf_rail& rail = *rails[rail_ep.rail];
     /** Open an endpoint */
     fid_ep* raw_ep;
     ret = fail_if_nonzero_retry_on_eagain(
             "Failed to open endpoint", REPORT_ON_FAILURE,
-            fi_endpoint, g_ctxt.domain, fi, &raw_ep, nullptr);
+            fi_endpoint, rail.domain, fi, &raw_ep, nullptr);
     if(ret) return ret;
-    dbg_default_trace("{}:{} created rdmc endpoint: {}", __FILE__, __func__, (void*)&raw_ep->fid);
+    dbg_default_trace("{}:{} created rdmc endpoint: {} on rail {}", __FILE__, __func__, (void*)&raw_ep->fid, rail_ep.rail);
     dbg_default_flush();
     /** Construct the smart pointer to manage the endpoint */
-    ep = std::unique_ptr<fid_ep, std::function<void(fid_ep*)>>(
+    rail_ep.ep = std::unique_ptr<fid_ep, std::function<void(fid_ep*)>>(
             raw_ep,
             [](fid_ep* ep) {
                 fi_close(&ep->fid);
@@ -243,10 +301,10 @@ int endpoint::init(struct fi_info* fi) {
     fid_eq* raw_eq;
     ret = fail_if_nonzero_retry_on_eagain(
             "Failed to open event queue", REPORT_ON_FAILURE,
-            fi_eq_open, g_ctxt.fabric, &g_ctxt.eq_attr, &raw_eq, nullptr);
+            fi_eq_open, rail.fabric, &g_ctxt.eq_attr, &raw_eq, nullptr);
     if(ret) return ret;
     /** Construct the smart pointer to manage the event queue */
-    eq = std::unique_ptr<fid_eq, std::function<void(fid_eq*)>>(
+    rail_ep.eq = std::unique_ptr<fid_eq, std::function<void(fid_eq*)>>(
             raw_eq, [](fid_eq* eq) { fi_close(&eq->fid); });
 
     /** Bind endpoint to event queue and completion queue */
@@ -257,7 +315,7 @@ int endpoint::init(struct fi_info* fi) {
     const uint64_t ep_flags = FI_RECV | FI_TRANSMIT | FI_SELECTIVE_COMPLETION;
     ret = fail_if_nonzero_retry_on_eagain(
             "Failed to bind endpoint and tx completion queue", REPORT_ON_FAILURE,
-            fi_ep_bind, raw_ep, &(g_ctxt.cq)->fid, ep_flags);
+            fi_ep_bind, raw_ep, &(rail.cq)->fid, ep_flags);
     if(ret) return ret;
     ret = fail_if_nonzero_retry_on_eagain(
             "Failed to enable endpoint", REPORT_ON_FAILURE,
@@ -282,8 +340,13 @@ void endpoint::connect(size_t remote_index, bool is_lf_server,
     memset(&remote_cm_data, 0, sizeof(remote_cm_data));
 
     /** Populate local cm struct and exchange cm info */
-    local_cm_data.pep_addr_len = (uint32_t)htonl((uint32_t)g_ctxt.pep_addr_len);
-    memcpy((void*)&local_cm_data.pep_addr, &g_ctxt.pep_addr, g_ctxt.pep_addr_len);
+    const uint32_t local_rail_mask = get_usable_rail_mask();
+    local_cm_data.rail_mask = htonl(local_rail_mask);
+    for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+        local_cm_data.rail_weights[rail] = htonl(rails[rail]->weight);
+        local_cm_data.pep_addr_len[rail] = (uint32_t)htonl((uint32_t)rails[rail]->pep_addr_len);
+        memcpy((void*)&local_cm_data.pep_addr[rail], &rails[rail]->pep_addr, rails[rail]->pep_addr_len);
+    }
 
     try {
         rdmc_connections->exchange(remote_index, local_cm_data, remote_cm_data);
@@ -291,8 +354,49 @@ void endpoint::connect(size_t remote_index, bool is_lf_server,
         crash_with_message("RDMC failed to exchange cm info\n");
     }
 
-    remote_cm_data.pep_addr_len = (uint32_t)ntohl(remote_cm_data.pep_addr_len);
+    /** Use each rail that both nodes can use, weighted by the lower of the two weights */
+    const uint32_t shared_rail_mask = local_rail_mask & ntohl(remote_cm_data.rail_mask);
+    std::vector<uint32_t> rail_weights;
+    for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+        if(shared_rail_mask & (1u << rail)) {
+            rail_weights.push_back(std::min(rails[rail]->weight, (uint32_t)ntohl(remote_cm_data.rail_weights[rail])));
+            rail_endpoints.emplace_back();
+            rail_endpoints.back().rail = rail;
+        } else {
+            rail_weights.push_back(0);
+        }
+    }
+    if(rail_endpoints.empty()) {
+        crash_with_message("RDMC: no usable rail is shared with node %lu\n", remote_index);
+    }
+    /** Translate the pattern of rails into a pattern of positions in rail_endpoints */
+    for(uint32_t rail : derecho::make_stripe_pattern(rail_weights)) {
+        auto rail_ep = std::find_if(rail_endpoints.begin(), rail_endpoints.end(),
+                                    [rail](const rail_endpoint& ep) { return ep.rail == rail; });
+        stripe_pattern.push_back(rail_ep - rail_endpoints.begin());
+    }
+
+    /** Connect the rails one at a time, in the same order on both nodes */
+    for(rail_endpoint& rail_ep : rail_endpoints) {
+        connect_rail(rail_ep, is_lf_server, remote_cm_data.pep_addr[rail_ep.rail],
+                     ntohl(remote_cm_data.pep_addr_len[rail_ep.rail]));
+    }
+
+    post_recvs(this);
+    int tmp = -1;
+    try {
+        rdmc_connections->exchange(remote_index, 0, tmp);
+        if(tmp != 0) {
+            crash_with_message("Failed to sync after endpoint creation");
+        }
+    } catch(tcp::socket_error&) {
+        crash_with_message("Failed to sync after endpoint creation");
+    }
+}
 
+void endpoint::connect_rail(rail_endpoint& rail_ep, bool is_lf_server,
+                            const char* remote_pep_addr, size_t remote_pep_addr_len) {
+    lf_rail& rail = *rails[rail_ep.rail];
     /** Connect to remote node */
     ssize_t nRead;
     struct fi_eq_cm_entry entry;
@@ -300,60 +404,60 @@ void endpoint::connect(size_t remote_index, bool is_lf_server,
 
     if(is_lf_server) {
         /** Synchronously read from the passive event queue, init the server ep */
-        nRead = fi_eq_sread(g_ctxt.peq, &event, &entry, sizeof(entry), -1, 0);
+        nRead = fi_eq_sread(rail.peq, &event, &entry, sizeof(entry), -1, 0);
         if(nRead != sizeof(entry)) {
             crash_with_message("Failed to get connection from remote. nRead=%ld\n", nRead);
         }
-        if(init(entry.info)) {
-            fi_reject(g_ctxt.pep, entry.info->handle, NULL, 0);
+        if(init(rail_ep, entry.info)) {
+            fi_reject(rail.pep, entry.info->handle, NULL, 0);
             fi_freeinfo(entry.info);
             crash_with_message("Failed to initialize server endpoint.\n");
         }
-        if(fi_accept(ep.get(), NULL, 0)) {
-            fi_reject(g_ctxt.pep, entry.info->handle, NULL, 0);
+        if(fi_accept(rail_ep.ep.get(), NULL, 0)) {
+            fi_reject(rail.pep, entry.info->handle, NULL, 0);
             fi_freeinfo(entry.info);
             crash_with_message("Failed to accept connection.\n");
         }
-        nRead = fi_eq_sread(this->eq.get(), &event, &entry, sizeof(entry), -1, 0);
+        nRead = fi_eq_sread(rail_ep.eq.get(), &event, &entry, sizeof(entry), -1, 0);
         if(nRead != sizeof(entry)) {
             crash_with_message("failed to connect remote. nRead=%ld.\n", nRead);
         }
-        if(event != FI_CONNECTED || entry.fid != &(ep->fid)) {
+        if(event != FI_CONNECTED || entry.fid != &(rail_ep.ep->fid)) {
             fi_freeinfo(entry.info);
             crash_with_message("RDMC Unexpected CM event: %d.\n", event);
         }
         fi_freeinfo(entry.info);
     } else {
-        struct fi_info* client_hints = fi_dupinfo(g_ctxt.hints);
+        struct fi_info* client_hints = fi_dupinfo(rail.hints);
         struct fi_info* client_info = NULL;
 
         /** TODO document this */
         client_hints->dest_addr = crash_if_nullptr("Failed to malloc address space for server pep.",
-                                                   malloc, remote_cm_data.pep_addr_len);
+                                                   malloc, remote_pep_addr_len);
         memcpy((void*)client_hints->dest_addr,
-               (void*)remote_cm_data.pep_addr,
-               (size_t)remote_cm_data.pep_addr_len);
-        client_hints->dest_addrlen = remote_cm_data.pep_addr_len;
+               (void*)remote_pep_addr,
+               remote_pep_addr_len);
+        client_hints->dest_addrlen = remote_pep_addr_len;
         fail_if_nonzero_retry_on_eagain(
                 "fi_getinfo() failed.", CRASH_ON_FAILURE,
                 fi_getinfo, LF_VERSION, nullptr, nullptr, 0, client_hints, &client_info);
 
         /** TODO document this */
-        if(init(client_info)) {
+        if(init(rail_ep, client_info)) {
             fi_freeinfo(client_hints);
             fi_freeinfo(client_info);
             crash_with_message("failed to initialize client endpoint.\n");
         }
         fail_if_nonzero_retry_on_eagain(
                 "fi_connect() failed", CRASH_ON_FAILURE,
-                fi_connect, ep.get(), remote_cm_data.pep_addr, nullptr, 0);
+                fi_connect, rail_ep.ep.get(), remote_pep_addr, nullptr, 0);
 
         /** TODO document this */
-        nRead = fi_eq_sread(this->eq.get(), &event, &entry, sizeof(entry), -1, 0);
+        nRead = fi_eq_sread(rail_ep.eq.get(), &event, &entry, sizeof(entry), -1, 0);
         if(nRead != sizeof(entry)) {
             crash_with_message("failed to connect remote. nRead=%ld.\n", nRead);
         }
-        if(event != FI_CONNECTED || entry.fid != &(ep->fid)) {
+        if(event != FI_CONNECTED || entry.fid != &(rail_ep.ep->fid)) {
             fi_freeinfo(client_hints);
             fi_freeinfo(client_info);
             crash_with_message("RDMC Unexpected CM event: %d.\n", event);
@@ -361,17 +465,6 @@ void endpoint::connect(size_t remote_index, bool is_lf_server,
         fi_freeinfo(client_hints);
         fi_freeinfo(client_info);
     }
-
-    post_recvs(this);
-    int tmp = -1;
-    try {
-        rdmc_connections->exchange(remote_index, 0, tmp);
-        if(tmp != 0) {
-            crash_with_message("Failed to sync after endpoint creation");
-        }
-    } catch(tcp::socket_error&) {
-        crash_with_message("Failed to sync after endpoint creation");
-    }
 }
 
 bool endpoint::post_send(const memory_region& mr, size_t offset, size_t size,
@@ -379,6 +472,7 @@ bool endpoint::post_send(const memory_region& mr, size_t offset, size_t size,
                          const message_type& type) {
     struct iovec msg_iov;
     struct fi_msg msg;
+    rail_endpoint& rail_ep = rail_endpoints[stripe_pattern[num_data_sends++ % stripe_pattern.size()]];
 
     msg_iov.iov_base = mr.buffer + offset;
     msg_iov.iov_len = size;
@@ -386,7 +480,7 @@ bool endpoint::post_send(const memory_region& mr, size_t offset, size_t size,
     msg.msg_iov = &msg_iov;
     // in v1.12.1, this API spec changed.
     // msg.desc = (void**)&mr.mr->key;
-    void *desc = fi_mr_desc(mr.mr.get());
+    void *desc = fi_mr_desc((*mr.mrs)[rail_ep.rail].get());
     msg.desc = &desc;
     msg.iov_count = 1;
     msg.addr = 0;
@@ -395,7 +489,7 @@ bool endpoint::post_send(const memory_region& mr, size_t offset, size_t size,
 
     fail_if_nonzero_retry_on_eagain(
             "fi_sendmsg() failed", REPORT_ON_FAILURE,
-            fi_sendmsg, ep.get(), &msg, FI_COMPLETION | FI_REMOTE_CQ_DATA);
+            fi_sendmsg, rail_ep.ep.get(), &msg, FI_COMPLETION | FI_REMOTE_CQ_DATA);
     return true;
 }
 
@@ -403,6 +497,7 @@ bool endpoint::post_recv(const memory_region& mr, size_t offset, size_t size,
                          uint64_t wr_id, const message_type& type) {
     struct iovec msg_iov;
     struct fi_msg msg;
+    rail_endpoint& rail_ep = rail_endpoints[stripe_pattern[num_data_recvs++ % stripe_pattern.size()]];
 
     msg_iov.iov_base = mr.buffer + offset;
     msg_iov.iov_len = size;
@@ -410,7 +505,7 @@ bool endpoint::post_recv(const memory_region& mr, size_t offset, size_t size,
     msg.msg_iov = &msg_iov;
     // in v1.12.1, this API spec changed.
     // msg.desc = (void**)&mr.mr->key;
-    void *desc = fi_mr_desc(mr.mr.get());
+    void *desc = fi_mr_desc((*mr.mrs)[rail_ep.rail].get());
     msg.desc = &desc;
     msg.iov_count = 1;
     msg.addr = 0;
@@ -418,7 +513,7 @@ bool endpoint::post_recv(const memory_region& mr, size_t offset, size_t size,
 
     fail_if_nonzero_retry_on_eagain(
             "fi_recvmsg() failed", REPORT_ON_FAILURE,
-            fi_recvmsg, ep.get(), &msg, FI_COMPLETION);
+            fi_recvmsg, rail_ep.ep.get(), &msg, FI_COMPLETION);
     return true;
 }
 
@@ -432,7 +527,7 @@ bool endpoint::post_empty_send(uint64_t wr_id, uint32_t immediate,
 
     fail_if_nonzero_retry_on_eagain(
             "fi_sendmsg() failed", REPORT_ON_FAILURE,
-            fi_sendmsg, ep.get(), &msg, FI_COMPLETION | FI_REMOTE_CQ_DATA);
+            fi_sendmsg, rail_endpoints[0].ep.get(), &msg, FI_COMPLETION | FI_REMOTE_CQ_DATA);
     return true;
 }
 
@@ -444,7 +539,7 @@ bool endpoint::post_empty_recv(uint64_t wr_id, const message_type& type) {
 
     fail_if_nonzero_retry_on_eagain(
             "fi_recvmsg() failed", REPORT_ON_FAILURE,
-            fi_recvmsg, ep.get(), &msg, FI_COMPLETION);
+            fi_recvmsg, rail_endpoints[0].ep.get(), &msg, FI_COMPLETION);
     return true;
 }
 
@@ -459,6 +554,10 @@ bool endpoint::post_write(const memory_region& mr, size_t offset, size_t size,
                   << " remote_offset = " << remote_offset << std::endl;
         return false;
     }
+    rail_endpoint& rail_ep = rail_endpoints[0];
+    if(rail_ep.rail >= remote_mr.rkeys.size()) {
+        return false;
+    }
 
     struct iovec msg_iov;
     struct fi_rma_iov rma_iov;
@@ -469,12 +568,12 @@ bool endpoint::post_write(const memory_region& mr, size_t offset, size_t size,
 
     rma_iov.addr = ((LF_USE_VADDR) ? remote_mr.buffer : 0) + remote_offset;
     rma_iov.len = size;
-    rma_iov.key = remote_mr.rkey;
+    rma_iov.key = remote_mr.rkeys[rail_ep.rail];
 
     msg.msg_iov = &msg_iov;
     // in v1.12.1, this API spec changed.
     // msg.desc = (void**)&mr.mr->key;
-    void *desc = fi_mr_desc(mr.mr.get());
+    void *desc = fi_mr_desc((*mr.mrs)[rail_ep.rail].get());
     msg.desc = &desc;
     msg.iov_count = 1;
     msg.addr = 0;
@@ -484,7 +583,7 @@ bool endpoint::post_write(const memory_region& mr, size_t offset, size_t size,
 
     fail_if_nonzero_retry_on_eagain(
             "fi_writemsg() failed", REPORT_ON_FAILURE,
-            fi_writemsg, ep.get(), &msg, FI_COMPLETION);
+            fi_writemsg, rail_ep.ep.get(), &msg, FI_COMPLETION);
 
     return true;
 }
@@ -562,85 +661,156 @@ bool lf_remove_connection(uint32_t node_id) {
 }
 
 static std::atomic<bool> interrupt_mode;
-static std::atomic<bool> polling_loop_shutdown_flag;
-static std::thread polling_thread;
-static void polling_loop() {
-    pthread_setname_np(pthread_self(), "rdmc_poll");
-
-    const int max_cq_entries = 1024;
-    std::unique_ptr<fi_cq_data_entry[]> cq_entries(new fi_cq_data_entry[max_cq_entries]);
-
-    while(true) {
-        int num_completions = 0;
-        while(num_completions == 0 || num_completions == -FI_EAGAIN) {
-            if(polling_loop_shutdown_flag) return;
-            uint64_t poll_end = get_time() + (interrupt_mode ? 0L : 50000000L);
-            do {
-                if(polling_loop_shutdown_flag) return;
-                num_completions = fi_cq_read(g_ctxt.cq, cq_entries.get(), max_cq_entries);
-            } while((num_completions == 0 || num_completions == -FI_EAGAIN) && get_time() < poll_end);
-
-            if(num_completions == 0 || num_completions == -FI_EAGAIN) {
-                /** Need ibv_req_notify_cq equivalent here? */
-
-                num_completions = fi_cq_read(g_ctxt.cq, cq_entries.get(), max_cq_entries);
-
-                if(num_completions == 0 || num_completions == -FI_EAGAIN) {
-                    pollfd file_descriptor;
-                    fi_control(&g_ctxt.cq->fid, FI_GETWAIT, &file_descriptor);
-                    int rc = 0;
-                    while(rc == 0 && !polling_loop_shutdown_flag) {
-                        if(polling_loop_shutdown_flag) return;
-                        file_descriptor.events = POLLIN | POLLERR | POLLHUP;
-                        file_descriptor.revents = 0;
-                        rc = poll(&file_descriptor, 1, 50);
-                    }
-
-                    if(rc > 0) {
-                        num_completions = fi_cq_read(g_ctxt.cq, cq_entries.get(), max_cq_entries);
-                    }
-                }
-            }
+/** The thread that polls the completion queues, which the SST may share */
+static std::shared_ptr<derecho::CompletionPoller> completion_poller;
+
+/**
+ * Reads every completion that is ready on a rail, up to a batch of 1024, and
+ * calls the completion handler registered for each one's message type. This
+ * is the completion source callback of each of RDMC's rails, so it runs on
+ * the completion poller's thread.
+ * @return The number of completions read
+ */
+static int poll_completion_batch(lf_rail& rail) {
+    static constexpr int max_cq_entries = 1024;
+    static fi_cq_data_entry cq_entries[max_cq_entries];
+
+    ssize_t num_completions = fi_cq_read(rail.cq, cq_entries, max_cq_entries);
+    if(num_completions == 0 || num_completions == -FI_EAGAIN) {
+        return 0;
+    }
+    if(num_completions < 0) {
+        struct fi_cq_err_entry err_entry;
+        fi_cq_readerr(rail.cq,  &err_entry, 0);
+        if (err_entry.err == FI_ECANCELED) {
+            // endpoint has been destructed already.
+            return 0;
+        }
+        std::cout << "Failed to read from completion queue, fi_cq_read returned "
+                  << num_completions << ", err_entry.err=" << err_entry.err << std::endl;
+        // Stop using the rail for new connections if the error was caused by its link going down
+        if(rail.usable && !derecho::rail_link_is_up(rail.domain_name)) {
+            dbg_default_warn("RDMC: the link of rail {} is down, so new connections will not use it", rail.domain_name);
+            rail.usable = false;
         }
+        return 0;
+    }
 
-        if(num_completions < 0) {
-            struct fi_cq_err_entry err_entry;
-            fi_cq_readerr(g_ctxt.cq,  &err_entry, 0);
-            if (err_entry.err == FI_ECANCELED) {
-                // endpoint has been destructed already.
-                continue;
-            }
-            std::cout << "Failed to read from completion queue, fi_cq_read returned "
-                      << num_completions << ", err_entry.err=" << err_entry.err << std::endl;
+    std::lock_guard<std::mutex> l(completion_handlers_mutex);
+    for(int i = 0; i < num_completions; i++) {
+        fi_cq_data_entry& cq_entry = cq_entries[i];
+
+        message_type::tag_type type = (uint64_t)cq_entry.op_context >> message_type::shift_bits;
+        if(type == std::numeric_limits<message_type::tag_type>::max())
+            continue;
+
+        uint64_t masked_wr_id = (uint64_t)cq_entry.op_context & 0x0000ffffffffffffull;
+        uint32_t opcode = (uint32_t)EXTRACT_RDMA_OP_CODE(cq_entry.op_context);
+        uint32_t immediate = cq_entry.data;
+        if(type >= completion_handlers.size()) {
+            // Unrecognized message type
+        } else if(opcode == RDMA_OP_SEND) {
+            completion_handlers[type].send(masked_wr_id, immediate,
+                                           cq_entry.len);
+        } else if(opcode == RDMA_OP_RECV) {
+            completion_handlers[type].recv(masked_wr_id, immediate,
+                                           cq_entry.len);
+        } else if(opcode == RDMA_OP_WRITE) {
+            completion_handlers[type].write(masked_wr_id, immediate,
+                                            cq_entry.len);
+        } else {
+            puts("Sent unrecognized completion type?!");
         }
+    }
+    return num_completions;
+}
 
-        std::lock_guard<std::mutex> l(completion_handlers_mutex);
-        for(int i = 0; i < num_completions; i++) {
-            fi_cq_data_entry& cq_entry = cq_entries[i];
-
-            message_type::tag_type type = (uint64_t)cq_entry.op_context >> message_type::shift_bits;
-            if(type == std::numeric_limits<message_type::tag_type>::max())
-                continue;
-
-            uint64_t masked_wr_id = (uint64_t)cq_entry.op_context & 0x0000ffffffffffffull;
-            uint32_t opcode = (uint32_t)EXTRACT_RDMA_OP_CODE(cq_entry.op_context);
-            uint32_t immediate = cq_entry.data;
-            if(type >= completion_handlers.size()) {
-                // Unrecognized message type
-            } else if(opcode == RDMA_OP_SEND) {
-                completion_handlers[type].send(masked_wr_id, immediate,
-                                               cq_entry.len);
-            } else if(opcode == RDMA_OP_RECV) {
-                completion_handlers[type].recv(masked_wr_id, immediate,
-                                               cq_entry.len);
-            } else if(opcode == RDMA_OP_WRITE) {
-                completion_handlers[type].write(masked_wr_id, immediate,
-                                                cq_entry.len);
-            } else {
-                puts("Sent unrecognized completion type?!");
-            }
+/**
+ * Opens the fabric, domain, completion queue and passive endpoint of a rail.
+ * If any of them can't be opened, the rail is returned unusable, so the
+ * other rails can still be used.
+ */
+static std::unique_ptr<lf_rail> open_rail(const derecho::RailConfig& rail_config) {
+    auto rail = std::make_unique<lf_rail>();
+    rail->domain_name = rail_config.domain;
+    rail->weight = rail_config.weight;
+    rail->usable = false;
+    rail->pep_addr_len = max_lf_addr_size;
+    rail->hints = fi_dupinfo(g_ctxt.hints);
+    free(rail->hints->domain_attr->name);
+    rail->hints->domain_attr->name = crash_if_nullptr("strdup domain name.",
+                                                      strdup, rail_config.domain.c_str());
+
+    dbg_default_trace("lf_initialize hints: {}", fi_tostr(rail->hints, FI_TYPE_INFO));
+    /** Initialize the fabric, domain and completion queue */
+    struct fi_info* info_candidates = nullptr;
+    if(fail_if_nonzero_retry_on_eagain(
+               "fi_getinfo() failed", REPORT_ON_FAILURE,
+               fi_getinfo, LF_VERSION, nullptr, nullptr, 0, rail->hints, &(info_candidates))) {
+        return rail;
+    }
+    // TODO: this is a bug in libfabric till at least v1.18.1:
+    // fi_getinfo() does not respect hints->domain_attr.
+    struct fi_info* info_candidate = info_candidates;
+    while (info_candidate != nullptr) {
+        if (strcmp(info_candidate->domain_attr->name,rail->hints->domain_attr->name)) {
+            info_candidate = info_candidate->next;
+        } else {
+            // found
+            rail->fi = fi_dupinfo(info_candidate);
+            break;
         }
     }
+
+    fi_freeinfo(info_candidates);
+    if (rail->fi == nullptr) {
+        dbg_default_error("RDMC: failed to get an fi_info data structure for domain {}", rail_config.domain);
+        return rail;
+    }
+
+    if(fail_if_nonzero_retry_on_eagain(
+               "fi_fabric() failed", REPORT_ON_FAILURE,
+               fi_fabric, rail->fi->fabric_attr, &(rail->fabric), nullptr)
+       || fail_if_nonzero_retry_on_eagain(
+               "fi_domain() failed", REPORT_ON_FAILURE,
+               fi_domain, rail->fabric, rail->fi, &(rail->domain), nullptr)) {
+        return rail;
+    }
+    /**
+     * libfabric 1.12 does not pick an adequate default value for completion queue size.
+     * We simply set it to a large enough one.
+     */
+    g_ctxt.cq_attr.size = 2097152;
+    if(fail_if_nonzero_retry_on_eagain(
+               "failed to initialize tx completion queue", REPORT_ON_FAILURE,
+               fi_cq_open, rail->domain, &(g_ctxt.cq_attr), &(rail->cq), nullptr)
+       || !rail->cq) {
+        return rail;
+    }
+
+    /** Initialize the event queue, initialize and configure pep  */
+    if(fail_if_nonzero_retry_on_eagain(
+               "failed to open the event queue for passive endpoint", REPORT_ON_FAILURE,
+               fi_eq_open, rail->fabric, &g_ctxt.eq_attr, &rail->peq, nullptr)
+       || fail_if_nonzero_retry_on_eagain(
+               "failed to open a local passive endpoint", REPORT_ON_FAILURE,
+               fi_passive_ep, rail->fabric, rail->fi, &rail->pep, nullptr)
+       || fail_if_nonzero_retry_on_eagain(
+               "failed to bind event queue to passive endpoint", REPORT_ON_FAILURE,
+               fi_pep_bind, rail->pep, &rail->peq->fid, 0)
+       || fail_if_nonzero_retry_on_eagain(
+               "failed to prepare passive endpoint for incoming connections", REPORT_ON_FAILURE,
+               fi_listen, rail->pep)
+       || fail_if_nonzero_retry_on_eagain(
+               "failed to get the local PEP address", REPORT_ON_FAILURE,
+               fi_getname, &rail->pep->fid, rail->pep_addr, &rail->pep_addr_len)) {
+        return rail;
+    }
+    if(rail->pep_addr_len > max_lf_addr_size) {
+        crash_with_message("local name is too big to fit in local buffer\n");
+    }
+    rail->usable = true;
+    return rail;
 }
 
 /**
@@ -667,80 +837,74 @@ bool lf_initialize(const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& ip
     default_context();
     // load_configuration();
 
-    dbg_default_trace("lf_initialize hints: {}", fi_tostr(g_ctxt.hints, FI_TYPE_INFO));
-    /** Initialize the fabric, domain and completion queue */
-    struct fi_info* info_candidates = nullptr;
-    fail_if_nonzero_retry_on_eagain(
-            "fi_getinfo() failed", CRASH_ON_FAILURE,
-            fi_getinfo, LF_VERSION, nullptr, nullptr, 0, g_ctxt.hints, &(info_candidates));
-    // TODO: this is a bug in libfabric till at least v1.18.1:
-    // fi_getinfo() does not respect hints->domain_attr.
-    struct fi_info* info_candidate = info_candidates;
-    while (info_candidate != nullptr) {
-        assert(g_ctxt.hints->domain_attr->name);
-        if (strcmp(info_candidate->domain_attr->name,g_ctxt.hints->domain_attr->name)) {
-            info_candidate = info_candidate->next;
-        } else {
-            // found
-            g_ctxt.fi = fi_dupinfo(info_candidate);
-            break;
+    std::vector<derecho::RailConfig> rail_configs;
+    try {
+        rail_configs = derecho::get_configured_rails();
+    } catch(std::exception& e) {
+        dbg_default_error("RDMC: invalid rail configuration: {}", e.what());
+        return false;
+    }
+    for(const derecho::RailConfig& rail_config : rail_configs) {
+        rails.emplace_back(open_rail(rail_config));
+        if(!primary_rail && rails.back()->usable) {
+            primary_rail = rails.back().get();
         }
     }
-
-    fi_freeinfo(info_candidates);
-    if (g_ctxt.fi == nullptr) {
-        crash_with_message("RDMC: failed to get an fi_info data structure.");
+    if(!primary_rail) {
+        crash_with_message("RDMC: failed to open any of the configured rails.");
     }
-
-    fail_if_nonzero_retry_on_eagain(
-            "fi_fabric() failed", CRASH_ON_FAILURE,
-            fi_fabric, g_ctxt.fi->fabric_attr, &(g_ctxt.fabric), nullptr);
-    fail_if_nonzero_retry_on_eagain(
-            "fi_domain() failed", CRASH_ON_FAILURE,
-            fi_domain, g_ctxt.fabric, g_ctxt.fi, &(g_ctxt.domain), nullptr);
-    /**
-     * libfabric 1.12 does not pick an adequate default value for completion queue size.
-     * We simply set it to a large enough one.
-     */
-    g_ctxt.cq_attr.size = 2097152;
-    fail_if_nonzero_retry_on_eagain(
-            "failed to initialize tx completion queue", CRASH_ON_FAILURE,
-            fi_cq_open, g_ctxt.domain, &(g_ctxt.cq_attr), &(g_ctxt.cq), nullptr);
-
-    if(!g_ctxt.cq) {
-        crash_with_message("Pointer to completion queue is null\n");
+    const uint32_t registration_cache_entries = derecho::getConfUInt32(derecho::Conf::DERECHO_REGISTRATION_CACHE_ENTRIES);
+    if(registration_cache_entries > 0) {
+        // A cached registration usually starts before the buffer it is used
+        // for, which only works if remote writes use virtual addresses
+        if(LF_USE_VADDR) {
+            registration_cache = std::make_unique<derecho::registration_cache>(
+                    registration_cache_entries, [](void* start, size_t length) {
+                        return std::static_pointer_cast<void>(memory_region::register_memory(start, length));
+                    });
+        } else {
+            dbg_default_warn("RDMC: the provider does not address remote memory by virtual address, so registrations will not be cached");
+        }
     }
 
-    /** Initialize the event queue, initialize and configure pep  */
-    fail_if_nonzero_retry_on_eagain(
-            "failed to open the event queue for passive endpoint", CRASH_ON_FAILURE,
-            fi_eq_open, g_ctxt.fabric, &g_ctxt.eq_attr, &g_ctxt.peq, nullptr);
-    fail_if_nonzero_retry_on_eagain(
-            "failed to open a local passive endpoint", CRASH_ON_FAILURE,
-            fi_passive_ep, g_ctxt.fabric, g_ctxt.fi, &g_ctxt.pep, nullptr);
-    fail_if_nonzero_retry_on_eagain(
-            "failed to bind event queue to passive endpoint", CRASH_ON_FAILURE,
-            fi_pep_bind, g_ctxt.pep, &g_ctxt.peq->fid, 0);
-    fail_if_nonzero_retry_on_eagain(
-            "failed to prepare passive endpoint for incoming connections", CRASH_ON_FAILURE,
-            fi_listen, g_ctxt.pep);
-    fail_if_nonzero_retry_on_eagain(
-            "failed to get the local PEP address", CRASH_ON_FAILURE,
-            fi_getname, &g_ctxt.pep->fid, g_ctxt.pep_addr, &g_ctxt.pep_addr_len);
-    if(g_ctxt.pep_addr_len > max_lf_addr_size) {
-        crash_with_message("local name is too big to fit in local buffer\n");
+    /** Start polling the completion queues in the background */
+    completion_poller = derecho::get_completion_poller(
+            "rdmc_poll", derecho::getConfInt32(derecho::Conf::DERECHO_RDMC_POLLER_CPU));
+    if(interrupt_mode) {
+        completion_poller->set_spin_time(std::chrono::nanoseconds(0));
+    }
+    for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+        lf_rail* rail_ptr = rails[rail].get();
+        if(!rail_ptr->cq) {
+            continue;
+        }
+        derecho::CompletionSource completion_source;
+        completion_source.name = rails.size() > 1 ? "RDMC rail " + std::to_string(rail) : "RDMC";
+        completion_source.poll_batch = [rail_ptr]() { return poll_completion_batch(*rail_ptr); };
+        int cq_wait_fd = -1;
+        if(fi_control(&rail_ptr->cq->fid, FI_GETWAIT, &cq_wait_fd) == 0) {
+            completion_source.wait_fd = cq_wait_fd;
+            completion_source.prepare_to_block = [rail_ptr]() {
+                struct fid* cq_fid = &rail_ptr->cq->fid;
+                return fi_trywait(rail_ptr->fabric, &cq_fid, 1) == FI_SUCCESS;
+            };
+        }
+        rail_ptr->completion_source_id = completion_poller->add_source(std::move(completion_source));
     }
-
-    /** Start a polling thread and run in the background */
-    polling_thread = std::move(std::thread(polling_loop));
-    polling_thread.detach();
 
     return true;
 }
 
 void lf_destroy() {
-    polling_loop_shutdown_flag = true;
-    polling_thread.join();
+    registration_cache.reset();
+    if(completion_poller) {
+        for(const auto& rail : rails) {
+            if(rail->cq) {
+                completion_poller->remove_source(rail->completion_source_id);
+            }
+        }
+        completion_poller.reset();
+    }
 }
 
 std::map<uint32_t, remote_memory_region> lf_exchange_memory_regions(
@@ -755,23 +919,35 @@ std::map<uint32_t, remote_memory_region> lf_exchange_memory_regions(
 
         uint64_t buffer;
         size_t size;
-        uint64_t rkey;
+        /** The remote node's key on each rail, so a write can use whichever rail its endpoint does */
+        std::array<uint64_t, derecho::max_rails> local_rkeys{};
+        std::array<uint64_t, derecho::max_rails> rkeys;
+        for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+            local_rkeys[rail] = mr.get_key(rail);
+        }
 
         try {
             rdmc_connections->exchange(m, (uint64_t)mr.buffer, buffer);
             rdmc_connections->exchange(m, mr.size, size);
-            rdmc_connections->exchange(m, mr.get_key(), rkey);
+            rdmc_connections->exchange(m, local_rkeys, rkeys);
         } catch(tcp::socket_error& e) {
             fprintf(stderr, "WARNING: lost connection to node %u\n", m);
             throw rdma::connection_broken();
         }
-        remote_mrs.emplace(m, remote_memory_region(buffer, size, rkey));
+        remote_mrs.emplace(m, remote_memory_region(buffer, size,
+                                                   std::vector<uint64_t>(rkeys.begin(), rkeys.begin() + rails.size())));
     }
     return remote_mrs;
 }
 
 bool set_interrupt_mode(bool enabled) {
     interrupt_mode = enabled;
+    // In interrupt mode, block as soon as the queue is empty instead of spinning first
+    if(completion_poller) {
+        completion_poller->set_spin_time(enabled
+                                                 ? std::chrono::nanoseconds(0)
+                                                 : std::chrono::microseconds(derecho::getConfUInt64(derecho::Conf::DERECHO_COMPLETION_SPIN_US)));
+    }
     return true;
 }
 
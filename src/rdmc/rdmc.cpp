@@ -1,5 +1,6 @@
 #include <derecho/rdmc/rdmc.hpp>
 #include <derecho/rdmc/group_send.hpp>
+#include <derecho/rdmc/detail/block_size.hpp>
 #include <derecho/rdmc/detail/message.hpp>
 #include <derecho/rdmc/detail/schedule.hpp>
 #include <derecho/rdmc/detail/util.hpp>
@@ -9,7 +10,9 @@
 #include <derecho/rdmc/detail/lf_helper.hpp>
 #endif
 
+#include <derecho/conf/conf.hpp>
 #include <derecho/core/derecho_type_definitions.hpp>
+#include <derecho/utils/logger.hpp>
 
 #include <atomic>
 #include <cmath>
@@ -19,6 +22,7 @@
 #include <memory>
 #include <mutex>
 #include <set>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -30,6 +34,10 @@ namespace rdmc {
 uint32_t node_rank;
 atomic<bool> shutdown_flag;
 
+// map from node ID to the rack (or switch) it is attached to, for nodes listed
+// in DERECHO/rdmc_rack_map
+map<uint32_t, uint32_t> node_racks;
+
 // map from group number to group
 map<uint16_t, shared_ptr<group>> groups;
 mutex groups_lock;
@@ -46,6 +54,23 @@ mutex groups_lock;
         return false;
     }
 
+    // The rack map is a comma-separated list of node_id:rack_id pairs
+    node_racks.clear();
+    std::istringstream rack_map(derecho::getConfString(derecho::Conf::DERECHO_RDMC_RACK_MAP));
+    std::string entry;
+    while(std::getline(rack_map, entry, ',')) {
+        if(entry.find_first_not_of(" \t") == std::string::npos) continue;
+        uint32_t node_id, rack_id;
+        char separator;
+        std::istringstream entry_stream(entry);
+        if(!(entry_stream >> node_id >> separator >> rack_id) || separator != ':') {
+            dbg_default_error("Configuration error! Malformed entry in {}: \"{}\"",
+                              derecho::Conf::DERECHO_RDMC_RACK_MAP, entry);
+            return false;
+        }
+        node_racks[node_id] = rack_id;
+    }
+
     polling_group::initialize_message_types();
     return true;
 }
@@ -57,33 +82,129 @@ void add_address(uint32_t index, const std::pair<ip_addr_t, uint16_t>& address)
 #endif
 }
 
+/**
+ * Returns the rack of each member of a group. Nodes that are not listed in
+ * the rack map are each treated as being in a rack of their own.
+ */
+static vector<uint32_t> get_member_racks(const vector<uint32_t>& members) {
+    uint32_t next_unlisted_rack = 0;
+    for(const auto& node_and_rack : node_racks) {
+        next_unlisted_rack = max(next_unlisted_rack, node_and_rack.second + 1);
+    }
+    vector<uint32_t> member_racks;
+    for(uint32_t node_id : members) {
+        auto rack = node_racks.find(node_id);
+        member_racks.push_back(rack != node_racks.end() ? rack->second : next_unlisted_rack++);
+    }
+    return member_racks;
+}
+
+static unique_ptr<schedule> make_schedule(send_algorithm algorithm,
+                                          const vector<uint32_t>& member_racks,
+                                          uint32_t member_index) {
+    uint32_t num_members = member_racks.size();
+    if(algorithm == BINOMIAL_SEND) {
+        return make_unique<binomial_schedule>(num_members, member_index);
+    } else if(algorithm == SEQUENTIAL_SEND) {
+        return make_unique<sequential_schedule>(num_members, member_index);
+    } else if(algorithm == CHAIN_SEND) {
+        return make_unique<chain_schedule>(num_members, member_index);
+    } else if(algorithm == TREE_SEND) {
+        return make_unique<tree_schedule>(num_members, member_index);
+    } else if(algorithm == HIERARCHICAL_SEND) {
+        return make_unique<hierarchical_schedule>(member_racks, member_index);
+    }
+    return nullptr;
+}
+
+/**
+ * Picks the schedule that is estimated to deliver a message of num_blocks
+ * blocks fastest, given the members' racks and the uplink capacity from the
+ * configuration. Every member makes the same choice, since it depends only on
+ * the group membership and the configuration.
+ */
+static send_algorithm choose_send_algorithm(const vector<uint32_t>& member_racks, size_t num_blocks) {
+    // Estimates scale linearly with the number of blocks once the pipeline
+    // is full, so there's no need to step through every block of a huge message
+    constexpr size_t max_estimated_blocks = 1024;
+    num_blocks = min(max(num_blocks, (size_t)1), max_estimated_blocks);
+    const double uplink_capacity = derecho::getConfDouble(derecho::Conf::DERECHO_RDMC_RACK_UPLINK_CAPACITY);
+
+    vector<send_algorithm> candidates{BINOMIAL_SEND, CHAIN_SEND};
+    if(set<uint32_t>(member_racks.begin(), member_racks.end()).size() > 1) {
+        candidates.push_back(HIERARCHICAL_SEND);
+    }
+    send_algorithm best_algorithm = BINOMIAL_SEND;
+    double best_time = 0;
+    for(send_algorithm candidate : candidates) {
+        vector<unique_ptr<schedule>> member_schedules;
+        for(uint32_t member = 0; member < member_racks.size(); ++member) {
+            member_schedules.emplace_back(make_schedule(candidate, member_racks, member));
+        }
+        double time = estimate_schedule_time(member_schedules, member_racks, num_blocks, uplink_capacity);
+        if(candidate == candidates.front() || time < best_time) {
+            best_algorithm = candidate;
+            best_time = time;
+        }
+    }
+    return best_algorithm;
+}
+
 bool create_group(uint16_t group_number, std::vector<uint32_t> members,
                   size_t block_size, send_algorithm algorithm,
                   incoming_message_callback_t incoming_upcall,
                   completion_callback_t callback,
-                  failure_callback_t failure_callback) {
+                  failure_callback_t failure_callback,
+                  size_t message_size) {
     if(shutdown_flag) return false;
 
-    schedule* send_schedule;
     uint32_t member_index = index_of(members, node_rank);
-    if(algorithm == BINOMIAL_SEND) {
-        send_schedule = new binomial_schedule(members.size(), member_index);
-    } else if(algorithm == SEQUENTIAL_SEND) {
-        send_schedule = new sequential_schedule(members.size(), member_index);
-    } else if(algorithm == CHAIN_SEND) {
-        send_schedule = new chain_schedule(members.size(), member_index);
-    } else if(algorithm == TREE_SEND) {
-        send_schedule = new tree_schedule(members.size(), member_index);
-    } else {
+    vector<uint32_t> member_racks = get_member_racks(members);
+    if(algorithm == ADAPTIVE_SEND) {
+        algorithm = choose_send_algorithm(member_racks, (message_size + block_size - 1) / block_size);
+        dbg_default_debug("RDMC group {} chose send algorithm {}", group_number, static_cast<int>(algorithm));
+    }
+    unique_ptr<schedule> send_schedule = make_schedule(algorithm, member_racks, member_index);
+    if(!send_schedule) {
         puts("Unsupported group type?!");
         fflush(stdout);
         return false;
     }
 
+    block_size_policy policy;
+    try {
+        policy = parse_block_size_policy(derecho::getConfString(derecho::Conf::DERECHO_RDMC_BLOCK_SIZE_POLICY));
+    } catch(const std::invalid_argument& e) {
+        dbg_default_error("{}; using fixed block sizes", e.what());
+        policy = block_size_policy::FIXED;
+    }
+    vector<unique_ptr<schedule>> member_schedules;
+    if(policy != block_size_policy::FIXED) {
+        for(uint32_t member = 0; member < members.size(); ++member) {
+            member_schedules.emplace_back(make_schedule(algorithm, member_racks, member));
+        }
+    }
+    block_size_selector block_sizes = block_size_selector::for_schedule(
+            policy, block_size, derecho::getConfDouble(derecho::Conf::DERECHO_RDMC_BLOCK_OVERHEAD_BYTES),
+            member_schedules, member_racks,
+            derecho::getConfDouble(derecho::Conf::DERECHO_RDMC_RACK_UPLINK_CAPACITY));
+    // Every message up to message_size must fit in the blocks the immediate can count
+    if(message_size > 0 && (message_size - 1) / block_size + 1 > block_sizes.max_blocks()) {
+        rls_default_error("Cannot create RDMC group {}: messages of up to {} bytes need {} blocks of {} bytes, "
+                          "but a message can have at most {} blocks{}. "
+                          "Increase the block size or reduce the maximum message size.",
+                          group_number, message_size, (message_size - 1) / block_size + 1, block_size,
+                          block_sizes.max_blocks(),
+                          block_sizes.varies_block_size() ? " when the block size is chosen per message" : "");
+        return false;
+    }
+
     unique_lock<mutex> lock(groups_lock);
     auto g = make_shared<polling_group>(group_number, block_size, members,
                                         member_index, incoming_upcall, callback,
-                                        unique_ptr<schedule>(send_schedule));
+                                        std::move(send_schedule), std::move(block_sizes),
+                                        derecho::getConfUInt32(derecho::Conf::DERECHO_RDMC_PIPELINE_DEPTH),
+                                        message_size);
     auto p = groups.emplace(group_number, std::move(g));
     return p.second;
 }
@@ -1,7 +1,9 @@
 #include <derecho/rdmc/detail/schedule.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
+#include <map>
 
 using std::min;
 using std::optional;
@@ -491,3 +493,199 @@ optional<schedule::block_transfer> binomial_schedule::get_first_block(size_t num
 
     return transfer;
 }
+
+hierarchical_schedule::hierarchical_schedule(const vector<uint32_t>& member_racks, uint32_t index)
+        : schedule(member_racks.size(), index), chain_position(0) {
+    // Racks are ordered by their first member, so the sender's rack comes first
+    vector<uint32_t> rack_ids;
+    for(uint32_t member = 0; member < num_members; ++member) {
+        if(std::find(rack_ids.begin(), rack_ids.end(), member_racks[member]) == rack_ids.end()) {
+            rack_ids.push_back(member_racks[member]);
+            leaders.push_back(member);
+        }
+        if(member_racks[member] == member_racks[member_index]) {
+            if(member == member_index) {
+                chain_position = rack_chain.size();
+            }
+            rack_chain.push_back(member);
+        }
+    }
+    uint32_t leader_rank = std::find(rack_ids.begin(), rack_ids.end(), member_racks[member_index])
+                           - rack_ids.begin();
+    leader_schedule = std::make_unique<binomial_schedule>(leaders.size(), leader_rank);
+}
+void hierarchical_schedule::compute_leader_block_order(size_t num_blocks) const {
+    if(cached_num_blocks == num_blocks) return;
+
+    leader_block_order.clear();
+    leader_block_arrivals.clear();
+    leader_block_arrival_steps.clear();
+    if(rack_chain[0] == 0 || leaders.size() == 1) {
+        // The sender has every block from the start, so it forwards them in order
+        for(size_t block = 0; block < num_blocks; ++block) {
+            leader_block_order.push_back(block);
+            leader_block_arrivals.push_back(block);
+            leader_block_arrival_steps.push_back(block);
+        }
+    } else {
+        size_t total_steps = leader_schedule->get_total_steps(num_blocks);
+        for(size_t step = 0; step < total_steps; ++step) {
+            auto transfer = leader_schedule->get_incoming_transfer(num_blocks, step);
+            if(transfer) {
+                leader_block_order.push_back(transfer->block_number);
+                leader_block_arrivals.push_back(transfer->block_number);
+                leader_block_arrival_steps.push_back(step);
+            } else {
+                leader_block_arrivals.push_back(std::nullopt);
+            }
+        }
+        assert(leader_block_order.size() == num_blocks);
+    }
+    cached_num_blocks = num_blocks;
+}
+vector<uint32_t> hierarchical_schedule::get_connections() const {
+    vector<uint32_t> ret;
+    if(is_multi_rack_leader()) {
+        for(uint32_t leader_rank : leader_schedule->get_connections()) {
+            ret.push_back(leaders[leader_rank]);
+        }
+    } else if(chain_position > 0) {
+        ret.push_back(rack_chain[chain_position - 1]);
+    }
+    if(chain_position + 1 < rack_chain.size()) {
+        ret.push_back(rack_chain[chain_position + 1]);
+    }
+    return ret;
+}
+size_t hierarchical_schedule::get_total_steps(size_t num_blocks) const {
+    // A leader alternates between a step of the binomial schedule and
+    // forwarding the block it received in that step to its rack
+    if(is_multi_rack_leader()) {
+        return 2 * leader_schedule->get_total_steps(num_blocks);
+    }
+    if(rack_chain.size() < 2) {
+        return 0;
+    }
+    return num_blocks + rack_chain.size() - 2;
+}
+optional<schedule::block_transfer> hierarchical_schedule::get_outgoing_transfer(size_t num_blocks, size_t step) const {
+    if(step >= get_total_steps(num_blocks)) {
+        return std::nullopt;
+    }
+    if(is_multi_rack_leader()) {
+        if(step % 2 == 0) {
+            auto transfer = leader_schedule->get_outgoing_transfer(num_blocks, step / 2);
+            if(transfer) {
+                transfer->target = leaders[transfer->target];
+            }
+            return transfer;
+        }
+        compute_leader_block_order(num_blocks);
+        if(rack_chain.size() < 2 || step / 2 >= leader_block_arrivals.size() || !leader_block_arrivals[step / 2]) {
+            return std::nullopt;
+        }
+        return block_transfer{rack_chain[1], *leader_block_arrivals[step / 2]};
+    }
+    if(chain_position + 1 == rack_chain.size() || step < chain_position || step - chain_position >= num_blocks) {
+        return std::nullopt;
+    }
+    compute_leader_block_order(num_blocks);
+    return block_transfer{rack_chain[chain_position + 1], leader_block_order[step - chain_position]};
+}
+optional<schedule::block_transfer> hierarchical_schedule::get_incoming_transfer(size_t num_blocks, size_t step) const {
+    if(step >= get_total_steps(num_blocks)) {
+        return std::nullopt;
+    }
+    if(is_multi_rack_leader()) {
+        if(step % 2 == 1) {
+            return std::nullopt;
+        }
+        auto transfer = leader_schedule->get_incoming_transfer(num_blocks, step / 2);
+        if(transfer) {
+            transfer->target = leaders[transfer->target];
+        }
+        return transfer;
+    }
+    if(chain_position == 0 || step + 1 < chain_position || step + 1 - chain_position >= num_blocks) {
+        return std::nullopt;
+    }
+    compute_leader_block_order(num_blocks);
+    return block_transfer{rack_chain[chain_position - 1], leader_block_order[step + 1 - chain_position]};
+}
+optional<schedule::block_transfer> hierarchical_schedule::get_first_block(size_t num_blocks) const {
+    if(member_index == 0) return std::nullopt;
+
+    if(is_multi_rack_leader()) {
+        auto transfer = leader_schedule->get_first_block(num_blocks);
+        transfer->target = leaders[transfer->target];
+        return transfer;
+    }
+    // Before the size of the message is known, the block number only needs
+    // to be a guess; the group corrects it when the first block arrives
+    if(num_blocks == 0) {
+        size_t block_number = 0;
+        if(rack_chain[0] != 0 && leaders.size() > 1) {
+            block_number = leader_schedule->get_first_block(num_blocks)->block_number;
+        }
+        return block_transfer{rack_chain[chain_position - 1], block_number};
+    }
+    compute_leader_block_order(num_blocks);
+    return block_transfer{rack_chain[chain_position - 1], leader_block_order[0]};
+}
+size_t hierarchical_schedule::get_step_round(size_t num_blocks, size_t step) const {
+    // A leader's binomial step and the forwarding step after it happen in the
+    // same round, on different links
+    if(is_multi_rack_leader()) {
+        return step / 2;
+    }
+    // The k-th block to reach the rack leader arrives in the round of the
+    // binomial step that delivers it, and moves one member down the chain per
+    // round after that
+    if(chain_position == 0 || step < chain_position || step - chain_position >= num_blocks) {
+        return step;
+    }
+    compute_leader_block_order(num_blocks);
+    return leader_block_arrival_steps[step - chain_position] + chain_position;
+}
+
+double estimate_schedule_time(const vector<std::unique_ptr<schedule>>& member_schedules,
+                              const vector<uint32_t>& member_racks,
+                              size_t num_blocks, double uplink_capacity) {
+    struct round_load {
+        std::map<uint32_t, uint32_t> member_sends;
+        std::map<uint32_t, uint32_t> member_receives;
+        std::map<uint32_t, uint32_t> rack_sends;
+        std::map<uint32_t, uint32_t> rack_receives;
+    };
+    std::map<size_t, round_load> rounds;
+    for(uint32_t member = 0; member < member_schedules.size(); ++member) {
+        const schedule& member_schedule = *member_schedules[member];
+        for(size_t step = 0; step < member_schedule.get_total_steps(num_blocks); ++step) {
+            auto transfer = member_schedule.get_outgoing_transfer(num_blocks, step);
+            if(!transfer) continue;
+            round_load& load = rounds[member_schedule.get_step_round(num_blocks, step)];
+            load.member_sends[member]++;
+            load.member_receives[transfer->target]++;
+            if(member_racks[member] != member_racks[transfer->target]) {
+                load.rack_sends[member_racks[member]]++;
+                load.rack_receives[member_racks[transfer->target]]++;
+            }
+        }
+    }
+    auto max_count = [](const std::map<uint32_t, uint32_t>& counts) {
+        uint32_t max_count = 0;
+        for(const auto& count : counts) {
+            max_count = std::max(max_count, count.second);
+        }
+        return max_count;
+    };
+    double total_time = 0;
+    for(const auto& round : rounds) {
+        const round_load& load = round.second;
+        double round_time = std::max(max_count(load.member_sends), max_count(load.member_receives));
+        round_time = std::max(round_time, std::max(max_count(load.rack_sends), max_count(load.rack_receives))
+                                                  / uplink_capacity);
+        total_time += round_time;
+    }
+    return total_time;
+}
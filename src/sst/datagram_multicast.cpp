@@ -0,0 +1,111 @@
+#include <derecho/sst/detail/datagram_multicast.hpp>
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <pthread.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+namespace sst {
+
+/** How often the receive thread wakes up to check whether it should stop */
+constexpr long receive_timeout_us = 100000;
+/** The socket receive buffer to ask for, so bursts of datagrams aren't dropped */
+constexpr int receive_buffer_size = 4 * 1024 * 1024;
+
+static in_addr parse_ipv4_address(const std::string& address) {
+    in_addr parsed;
+    if(inet_pton(AF_INET, address.c_str(), &parsed) != 1) {
+        throw std::invalid_argument("Not an IPv4 address: " + address);
+    }
+    return parsed;
+}
+
+template <typename T>
+static void set_socket_option(int socket_fd, int level, int option, const T& value, const char* name) {
+    if(setsockopt(socket_fd, level, option, &value, sizeof(value)) < 0) {
+        throw std::system_error(errno, std::system_category(), name);
+    }
+}
+
+datagram_multicast::datagram_multicast(const datagram_settings& settings,
+                                       std::function<void(const uint8_t*, std::size_t)> receive_callback)
+        : max_datagram_size(settings.max_datagram_size),
+          receive_callback(receive_callback),
+          socket_fd(-1),
+          group_sockaddr{},
+          thread_shutdown(false) {
+    const in_addr group_address = parse_ipv4_address(settings.group_address);
+    const in_addr interface_address = parse_ipv4_address(settings.interface_address);
+    if(!IN_MULTICAST(ntohl(group_address.s_addr))) {
+        throw std::invalid_argument("Not a multicast address: " + settings.group_address);
+    }
+    group_sockaddr.sin_family = AF_INET;
+    group_sockaddr.sin_addr = group_address;
+    group_sockaddr.sin_port = htons(settings.port);
+
+    socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if(socket_fd < 0) {
+        throw std::system_error(errno, std::system_category(), "socket");
+    }
+    try {
+        // The next view's group joins before the previous view's group leaves
+        set_socket_option(socket_fd, SOL_SOCKET, SO_REUSEADDR, 1, "SO_REUSEADDR");
+#ifdef IP_MULTICAST_ALL
+        // Only receive datagrams sent to this group, not to other groups on the same port
+        set_socket_option(socket_fd, IPPROTO_IP, IP_MULTICAST_ALL, 0, "IP_MULTICAST_ALL");
+#endif
+        if(bind(socket_fd, reinterpret_cast<const sockaddr*>(&group_sockaddr), sizeof(group_sockaddr)) < 0) {
+            throw std::system_error(errno, std::system_category(), "bind");
+        }
+        ip_mreq membership;
+        membership.imr_multiaddr = group_address;
+        membership.imr_interface = interface_address;
+        set_socket_option(socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, membership, "IP_ADD_MEMBERSHIP");
+        set_socket_option(socket_fd, IPPROTO_IP, IP_MULTICAST_IF, interface_address, "IP_MULTICAST_IF");
+        set_socket_option(socket_fd, IPPROTO_IP, IP_MULTICAST_TTL, static_cast<unsigned char>(1), "IP_MULTICAST_TTL");
+        // Other members may be running on the same host
+        set_socket_option(socket_fd, IPPROTO_IP, IP_MULTICAST_LOOP, static_cast<unsigned char>(1), "IP_MULTICAST_LOOP");
+        timeval receive_timeout{0, receive_timeout_us};
+        set_socket_option(socket_fd, SOL_SOCKET, SO_RCVTIMEO, receive_timeout, "SO_RCVTIMEO");
+        // The kernel may cap the buffer size, which only makes losses more likely
+        setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer_size, sizeof(receive_buffer_size));
+    } catch(...) {
+        close(socket_fd);
+        throw;
+    }
+    receive_thread = std::thread(&datagram_multicast::receive_loop, this);
+}
+
+datagram_multicast::~datagram_multicast() {
+    thread_shutdown = true;
+    if(receive_thread.joinable()) {
+        receive_thread.join();
+    }
+    close(socket_fd);
+}
+
+void datagram_multicast::receive_loop() {
+    pthread_setname_np(pthread_self(), "sst_datagram");
+    std::vector<uint8_t> buffer(max_datagram_size);
+    while(!thread_shutdown) {
+        // With MSG_TRUNC, recv returns the full length of a datagram that didn't fit
+        const ssize_t received = recv(socket_fd, buffer.data(), buffer.size(), MSG_TRUNC);
+        if(received < 0 || static_cast<std::size_t>(received) > buffer.size()) {
+            continue;
+        }
+        receive_callback(buffer.data(), received);
+    }
+}
+
+bool datagram_multicast::send(const uint8_t* data, std::size_t size) {
+    const ssize_t sent = sendto(socket_fd, data, size, 0,
+                                reinterpret_cast<const sockaddr*>(&group_sockaddr), sizeof(group_sockaddr));
+    return sent == static_cast<ssize_t>(size);
+}
+
+}  // namespace sst
@@ -7,18 +7,23 @@
 #include <derecho/sst/detail/lf.hpp>
 
 #include <derecho/conf/conf.hpp>
+#include <derecho/core/detail/completion_poller.hpp>
 #include <derecho/core/detail/connection_manager.hpp>
+#include <derecho/core/detail/multi_rail.hpp>
 #include <derecho/sst/detail/poll_utils.hpp>
 #include <derecho/sst/detail/sst_impl.hpp>
 #include <derecho/tcp/tcp.hpp>
 #include <derecho/utils/logger.hpp>
+#include <derecho/utils/registration_cache.hpp>
 #include <derecho/utils/time.h>
 #include <derecho/core/derecho_exception.hpp>
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <byteswap.h>
 #include <errno.h>
 #include <iostream>
+#include <random>
 #include <rdma/fabric.h>
 #include <rdma/fi_cm.h>
 #include <rdma/fi_domain.h>
@@ -57,17 +62,21 @@ __LITTLE_ENDIAN nor __BIG_ENDIAN
 
 namespace sst {
 
-static constexpr size_t max_lf_addr_size = 128 - sizeof(uint32_t) - 2 * sizeof(uint64_t);
+static constexpr size_t max_lf_addr_size = 128 - sizeof(uint32_t) - 4 * sizeof(uint64_t);
 
 /**
  * passive endpoint info to be exchanged.
  */
 struct cm_con_data_t {
-    uint32_t pep_addr_len;  // local endpoint address length
-    char pep_addr[max_lf_addr_size];
-    // local endpoint address
-    uint64_t mr_key;  // local memory key
+    uint32_t rail_mask;                          // rails the local node can use
+    uint32_t rail_weights[derecho::max_rails];   // local weight of each rail
+    uint32_t pep_addr_len[derecho::max_rails];   // local endpoint address length on each rail
+    char pep_addr[derecho::max_rails][max_lf_addr_size];
+    // local endpoint address on each rail
+    uint64_t mr_keys[derecho::max_rails];  // local memory key on each rail
     uint64_t vaddr;   // virtual addr
+    uint64_t cached_connection_id;  // ID of the SST endpoint that could be reused, or 0
+    uint64_t connection_nonce;      // contributes to the ID of a new connection
 } __attribute__((packed));
 
 /**
@@ -76,15 +85,7 @@ struct cm_con_data_t {
 class lf_ctxt {
 public:
     // libfabric resources
-    struct fi_info* hints;            // hints
-    struct fi_info* fi;               // fabric information
-    struct fid_fabric* fabric;        // fabric handle
-    struct fid_domain* domain;        // domain handle
-    struct fid_pep* pep;              // passive endpoint for receiving connection
-    struct fid_eq* peq;               // event queue for connection management
-    struct fid_cq* cq;                // completion queue for all rma operations
-    size_t pep_addr_len;              // length of local pep address
-    char pep_addr[max_lf_addr_size];  // local pep address
+    struct fi_info* hints;            // hints; each rail sets its own domain
 
     // configuration resources
     struct fi_eq_attr eq_attr;  // event queue attributes
@@ -95,14 +96,44 @@ public:
         lf_destroy();
     }
 };
+/**
+ * The libfabric resources of one rail, i.e. one NIC
+ */
+struct lf_rail {
+    std::string domain_name;          // name of the rail's domain
+    uint32_t weight;                  // share of the connections to other nodes
+    std::atomic<bool> usable;         // false if the rail failed to open or its link went down
+    struct fi_info* hints;            // hints, with the rail's domain
+    struct fi_info* fi;               // fabric information
+    struct fid_fabric* fabric;        // fabric handle
+    struct fid_domain* domain;        // domain handle
+    struct fid_pep* pep;              // passive endpoint for receiving connection
+    struct fid_eq* peq;               // event queue for connection management
+    struct fid_cq* cq;                // completion queue for all rma operations on the rail
+    size_t pep_addr_len;              // length of local pep address
+    char pep_addr[max_lf_addr_size];  // local pep address
+    uint64_t completion_source_id;    // the rail's completion queue in the completion poller
+};
 #define LF_CONFIG_FILE "rdma.cfg"
-#define LF_USE_VADDR ((g_ctxt.fi->domain_attr->mr_mode) & (FI_MR_VIRT_ADDR | FI_MR_BASIC))
+#define LF_USE_VADDR ((rails[0]->fi->domain_attr->mr_mode) & (FI_MR_VIRT_ADDR | FI_MR_BASIC))
 static bool shutdown = false;
-std::thread polling_thread;
+/** The thread that polls the completion queues, which RDMC may share */
+static std::shared_ptr<derecho::CompletionPoller> completion_poller;
 tcp::tcp_connections* sst_connections;
 tcp::tcp_connections* external_client_connections;
 // singleton: global states
 lf_ctxt g_ctxt;
+/**
+ * The rails, in the order they are configured. The first one must open,
+ * since out-of-band memory and connections that aren't behind SST rows use it.
+ */
+static std::vector<std::unique_ptr<lf_rail>> rails;
+/** The ID of the local node, which decides together with a remote node's ID which rail connects them */
+static uint32_t local_node_id;
+
+/** The SST endpoint most recently connected to each remote node, which the next SST can reuse */
+static std::map<uint32_t, std::shared_ptr<lf_endpoint>> sst_endpoints;
+static std::mutex sst_endpoints_mutex;
 
 /**
  * Prints a formatted message to stderr (via fprintf), then crashes the program.
@@ -134,9 +165,8 @@ static void default_context() {
     if(g_ctxt.cq_attr.format == FI_CQ_FORMAT_UNSPEC) {
         g_ctxt.cq_attr.format = FI_CQ_FORMAT_CONTEXT;
     }
-    g_ctxt.cq_attr.wait_obj = FI_WAIT_UNSPEC;
-
-    g_ctxt.pep_addr_len = max_lf_addr_size;
+    // Use a file descriptor as the wait object, so the completion poller can block on it
+    g_ctxt.cq_attr.wait_obj = FI_WAIT_FD;
 
     g_ctxt.sst_logger = spdlog::get(LoggerFactory::SST_LOGGER_NAME);
 }
@@ -153,9 +183,7 @@ static void load_configuration() {
     // provider:
     g_ctxt.hints->fabric_attr->prov_name = crash_if_nullptr("strdup provider name.",
                                                             strdup, derecho::getConfString(derecho::Conf::RDMA_PROVIDER).c_str());
-    // domain:
-    g_ctxt.hints->domain_attr->name = crash_if_nullptr("strdup domain name.",
-                                                       strdup, derecho::getConfString(derecho::Conf::RDMA_DOMAIN).c_str());
+    // domain: set by each rail in open_rail()
     if((strcmp(g_ctxt.hints->fabric_attr->prov_name, "sockets") == 0) || (strcmp(g_ctxt.hints->fabric_attr->prov_name, "tcp") == 0)) {
         g_ctxt.hints->domain_attr->mr_mode = FI_MR_BASIC;
     } else {  // default
@@ -178,20 +206,108 @@ static void load_configuration() {
     g_ctxt.hints->rx_attr->size = derecho::Conf::get()->getInt32(derecho::Conf::RDMA_RX_DEPTH);
 }
 
+/**
+ * Returns a bitmask of the rails the local node can use for a new
+ * connection: those that opened and whose link is still up.
+ */
+static uint32_t get_usable_rail_mask() {
+    uint32_t mask = 0;
+    for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+        if(rails[rail]->usable && !derecho::rail_link_is_up(rails[rail]->domain_name)) {
+            dbg_warn(g_ctxt.sst_logger, "The link of rail {} ({}) is down, so new connections will not use it",
+                     rail, rails[rail]->domain_name);
+            rails[rail]->usable = false;
+        }
+        if(rails[rail]->usable) {
+            mask |= 1u << rail;
+        }
+    }
+    return mask;
+}
+
 std::shared_mutex _resources::oob_mrs_mutex;
 std::map<uint64_t,struct _resources::oob_mr_t> _resources::oob_mrs;
+/** Caches the registrations of out-of-band system memory, if enabled in the configuration */
+static std::unique_ptr<derecho::registration_cache> oob_registration_cache;
+
+/**
+ * Registers out-of-band memory on the first rail.
+ * @return The registration, which deregisters the memory when the last pointer to it is dropped
+ * @throw derecho::derecho_exception on failure
+ */
+static std::shared_ptr<void> register_oob_region(void* addr, size_t size, enum fi_hmem_iface iface) {
+    struct fi_mr_attr   _attr; // libfabric attr
+    struct iovec        mr_iov;
+    mr_iov.iov_base     = addr;
+    mr_iov.iov_len      = size;
+    _attr.mr_iov        = &mr_iov;
+    _attr.iov_count     = 1;
+    _attr.access        = FI_SEND | FI_RECV | FI_READ | FI_WRITE | FI_REMOTE_READ | FI_REMOTE_WRITE;
+    _attr.offset        = 0;
+    _attr.requested_key = 0;
+    _attr.context       = nullptr;
+    _attr.auth_key_size = 0;
+    _attr.auth_key      = nullptr;
+    _attr.iface         = iface;
+
+    // register it with the domain
+    struct fid_mr* oob_mr;
+    int ret = fail_if_nonzero_retry_on_eagain("register memory buffer for write", REPORT_ON_FAILURE,
+                                    fi_mr_regattr, rails[0]->domain, &_attr, 0, &oob_mr);
+    if (ret != 0) {
+        throw derecho::derecho_exception(std::string("fi_mr_reg() on oob memory failed with return value:") + std::to_string(ret));
+    }
+    return std::shared_ptr<void>(oob_mr, [](void* mr) {
+        fail_if_nonzero_retry_on_eagain("deregister oob memory", REPORT_ON_FAILURE,
+                                        fi_close, &static_cast<struct fid_mr*>(mr)->fid);
+    });
+}
 
 void _resources::global_release() {
     std::unique_lock wr_lck(_resources::oob_mrs_mutex);
-    for (auto& oob_mr:_resources::oob_mrs) {
-        fail_if_nonzero_retry_on_eagain("close oob memory region", REPORT_ON_FAILURE,
-                                        fi_close, &oob_mr.second.mr->fid);
-    }
-    // -Why will this cause double free?
-    // _resources::oob_mrs.clear();
+    // Dropping the registrations closes them, unless the cache also holds them
+    _resources::oob_mrs.clear();
+    oob_registration_cache.reset();
     wr_lck.unlock();
 }
 
+lf_endpoint::~lf_endpoint() {
+    if(ep) {
+        fail_if_nonzero_retry_on_eagain("close endpoint", REPORT_ON_FAILURE,
+                                        fi_close, &ep->fid);
+    }
+    if(eq) {
+        fail_if_nonzero_retry_on_eagain("close event", REPORT_ON_FAILURE,
+                                        fi_close, &eq->fid);
+    }
+}
+
+row_memory::row_memory(std::size_t size) : capacity(size) {
+    allocation = derecho::allocate_registered_memory(capacity);
+    buffer = allocation.get();
+    // Register the block on every rail, so each row can be written through whichever rail connects its node
+    mrs.assign(rails.size(), nullptr);
+    for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+        if(!rails[rail]->domain) {
+            continue;
+        }
+        fail_if_nonzero_retry_on_eagain("register SST row memory", CRASH_ON_FAILURE,
+                                        fi_mr_reg, rails[rail]->domain, buffer, capacity,
+                                        FI_SEND | FI_RECV | FI_READ | FI_WRITE | FI_REMOTE_READ | FI_REMOTE_WRITE,
+                                        0, 0, 0, &mrs[rail], nullptr);
+    }
+    dbg_debug(g_ctxt.sst_logger, "Registered {} bytes of SST row memory at {}", capacity, (void*)buffer);
+}
+
+row_memory::~row_memory() {
+    for(struct fid_mr* mr : mrs) {
+        if(mr) {
+            fail_if_nonzero_retry_on_eagain("unregister SST row memory", REPORT_ON_FAILURE,
+                                            fi_close, &mr->fid);
+        }
+    }
+}
+
 int _resources::init_endpoint(struct fi_info* fi) {
     int ret = 0;
 
@@ -199,14 +315,14 @@ int _resources::init_endpoint(struct fi_info* fi) {
 
     // 2 - open endpoint
     ret = fail_if_nonzero_retry_on_eagain("open endpoint.", REPORT_ON_FAILURE,
-                                          fi_endpoint, g_ctxt.domain, fi, &(this->ep), nullptr);
+                                          fi_endpoint, rails[this->rail]->domain, fi, &(this->ep), nullptr);
 
     if(ret) return ret;
     dbg_debug(sst_logger, "{}:{} init_endpoint:ep->fid={}", __FILE__, __func__, (void*)&this->ep->fid);
 
     // 2.5 - open an event queue.
     fail_if_nonzero_retry_on_eagain("open the event queue for rdma transmission.", CRASH_ON_FAILURE,
-                                    fi_eq_open, g_ctxt.fabric, &g_ctxt.eq_attr, &this->eq, nullptr);
+                                    fi_eq_open, rails[this->rail]->fabric, &g_ctxt.eq_attr, &this->eq, nullptr);
     dbg_debug(sst_logger, "{}:{} event_queue opened={}", __FILE__, __func__, (void*)&this->eq->fid);
 
     // 3 - bind them and global event queue together
@@ -214,7 +330,7 @@ int _resources::init_endpoint(struct fi_info* fi) {
                                           fi_ep_bind, this->ep, &(this->eq)->fid, 0);
     if(ret) return ret;
     ret = fail_if_nonzero_retry_on_eagain("bind endpoint and tx completion queue", REPORT_ON_FAILURE,
-                                          fi_ep_bind, this->ep, &(g_ctxt.cq)->fid, FI_RECV | FI_TRANSMIT | FI_SELECTIVE_COMPLETION);
+                                          fi_ep_bind, this->ep, &(rails[this->rail]->cq)->fid, FI_RECV | FI_TRANSMIT | FI_SELECTIVE_COMPLETION);
     if(ret) return ret;
     ret = fail_if_nonzero_retry_on_eagain("enable endpoint", REPORT_ON_FAILURE,
                                           fi_enable, this->ep);
@@ -227,10 +343,35 @@ void _resources::connect_endpoint(bool is_lf_server) {
 
     // STEP 1 exchange CM info
     dbg_trace(sst_logger, "Exchanging connection management info.");
-    local_cm_data.pep_addr_len = (uint32_t)htonl((uint32_t)g_ctxt.pep_addr_len);
-    memcpy((void*)&local_cm_data.pep_addr, &g_ctxt.pep_addr, g_ctxt.pep_addr_len);
-    local_cm_data.mr_key = (uint64_t)htonll(this->mr_lwkey);
-    local_cm_data.vaddr = (uint64_t)htonll((uint64_t)this->write_buf);  // for pull mode
+    memset(&local_cm_data, 0, sizeof(local_cm_data));
+    const uint32_t local_rail_mask = get_usable_rail_mask();
+    local_cm_data.rail_mask = htonl(local_rail_mask);
+    for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+        local_cm_data.rail_weights[rail] = htonl(rails[rail]->weight);
+        local_cm_data.pep_addr_len[rail] = (uint32_t)htonl((uint32_t)rails[rail]->pep_addr_len);
+        memcpy((void*)&local_cm_data.pep_addr[rail], &rails[rail]->pep_addr, rails[rail]->pep_addr_len);
+        // SST rows are registered on every rail; other buffers only on the first
+        if(this->rows && this->rows->mrs[rail]) {
+            local_cm_data.mr_keys[rail] = (uint64_t)htonll(fi_mr_key(this->rows->mrs[rail]));
+        }
+    }
+    if(!this->rows) {
+        local_cm_data.mr_keys[0] = (uint64_t)htonll(this->mr_lwkey);
+    }
+    // without virtual addressing, remote writes are addressed relative to the start of the memory region
+    local_cm_data.vaddr = (uint64_t)htonll((uint64_t)this->write_buf
+                                           - ((LF_USE_VADDR) ? 0 : (uint64_t)this->mr_base));  // for pull mode
+    std::shared_ptr<lf_endpoint> cached_endpoint;
+    if(shares_sst_endpoint) {
+        std::lock_guard<std::mutex> lock(sst_endpoints_mutex);
+        auto endpoint_iter = sst_endpoints.find(this->remote_id);
+        if(endpoint_iter != sst_endpoints.end()) {
+            cached_endpoint = endpoint_iter->second;
+        }
+    }
+    const uint64_t local_nonce = (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}();
+    local_cm_data.cached_connection_id = (uint64_t)htonll(cached_endpoint ? cached_endpoint->connection_id : 0);
+    local_cm_data.connection_nonce = (uint64_t)htonll(local_nonce);
 
     try {
         if(sst_connections->contains_node(this->remote_id)) {
@@ -246,11 +387,56 @@ void _resources::connect_endpoint(bool is_lf_server) {
         crash_with_message("Failed to exchange connection management info with node %d\n", this->remote_id);
     }
 
-    remote_cm_data.pep_addr_len = (uint32_t)ntohl(remote_cm_data.pep_addr_len);
-    this->mr_rwkey = (uint64_t)ntohll(remote_cm_data.mr_key);
     this->remote_fi_addr = (fi_addr_t)ntohll(remote_cm_data.vaddr);
     dbg_trace(sst_logger, "Exchanging connection management info succeeds.");
 
+    // Both sides reuse the endpoint only if both still have the same one, and
+    // both can still use its rail, so they always agree
+    const uint32_t shared_rail_mask = local_rail_mask & ntohl(remote_cm_data.rail_mask);
+    const bool reuse_endpoint = cached_endpoint
+                                && ntohll(remote_cm_data.cached_connection_id) == cached_endpoint->connection_id
+                                && (shared_rail_mask & (1u << cached_endpoint->rail));
+    if(reuse_endpoint) {
+        this->rail = cached_endpoint->rail;
+    } else if(shares_sst_endpoint) {
+        // Spread the connections to different nodes across the rails both nodes can use
+        std::vector<uint32_t> rail_weights(rails.size(), 0);
+        for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+            if(shared_rail_mask & (1u << rail)) {
+                rail_weights[rail] = std::min(rails[rail]->weight, (uint32_t)ntohl(remote_cm_data.rail_weights[rail]));
+            }
+        }
+        if(shared_rail_mask != 0) {
+            this->rail = derecho::choose_pair_rail(local_node_id, this->remote_id, rail_weights);
+        } else {
+            dbg_warn(sst_logger, "No usable rail is shared with node {}, trying the first rail", this->remote_id);
+            this->rail = 0;
+        }
+    } else {
+        this->rail = 0;
+    }
+    if(this->rows) {
+        this->write_mr = this->rows->mrs[this->rail];
+        this->read_mr = this->rows->mrs[this->rail];
+        this->mr_lrkey = fi_mr_key(this->read_mr);
+        if(this->mr_lrkey == FI_KEY_NOTAVAIL) {
+            crash_with_message("fail to get SST row memory key.");
+        }
+        this->mr_lwkey = this->mr_lrkey;
+    }
+    this->mr_rwkey = (uint64_t)ntohll(remote_cm_data.mr_keys[this->rail]);
+    const uint32_t remote_pep_addr_len = (uint32_t)ntohl(remote_cm_data.pep_addr_len[this->rail]);
+    dbg_debug(sst_logger, "Connection to node {} uses rail {}", this->remote_id, this->rail);
+
+    if(reuse_endpoint) {
+        dbg_debug(sst_logger, "Reusing the existing SST endpoint to node {}", this->remote_id);
+        this->shared_endpoint = cached_endpoint;
+        this->ep = cached_endpoint->ep;
+        this->eq = cached_endpoint->eq;
+        sync(remote_id);
+        return;
+    }
+
     // STEP 2 connect to remote
     dbg_trace(sst_logger, "connect to remote node.");
     ssize_t nRead;
@@ -261,19 +447,19 @@ void _resources::connect_endpoint(bool is_lf_server) {
         dbg_trace(sst_logger, "connecting as a server.");
         dbg_trace(sst_logger, "waiting for connection.");
 
-        nRead = fi_eq_sread(g_ctxt.peq, &event, &entry, sizeof(entry), -1, 0);
+        nRead = fi_eq_sread(rails[this->rail]->peq, &event, &entry, sizeof(entry), -1, 0);
         if(nRead != sizeof(entry)) {
             dbg_error(sst_logger, "failed to get connection from remote.");
             crash_with_message("failed to get connection from remote. nRead=%ld\n", nRead);
         }
         if(init_endpoint(entry.info)) {
-            fi_reject(g_ctxt.pep, entry.info->handle, NULL, 0);
+            fi_reject(rails[this->rail]->pep, entry.info->handle, NULL, 0);
             fi_freeinfo(entry.info);
             crash_with_message("failed to initialize server endpoint.\n");
         }
         dbg_trace(sst_logger, "calling fi_accept()");
         if(fi_accept(this->ep, NULL, 0)) {
-            fi_reject(g_ctxt.pep, entry.info->handle, NULL, 0);
+            fi_reject(rails[this->rail]->pep, entry.info->handle, NULL, 0);
             fi_freeinfo(entry.info);
             crash_with_message("failed to accept connection.\n");
         }
@@ -294,13 +480,13 @@ void _resources::connect_endpoint(bool is_lf_server) {
         dbg_trace(sst_logger, "connecting as a client.\n");
         dbg_trace(sst_logger, "initiating a connection.\n");
 
-        struct fi_info* client_hints = fi_dupinfo(g_ctxt.hints);
+        struct fi_info* client_hints = fi_dupinfo(rails[this->rail]->hints);
         struct fi_info* client_info = NULL;
 
         client_hints->dest_addr = crash_if_nullptr("failed to malloc address space for server pep.",
-                                                   malloc, remote_cm_data.pep_addr_len);
-        memcpy((void*)client_hints->dest_addr, (void*)remote_cm_data.pep_addr, (size_t)remote_cm_data.pep_addr_len);
-        client_hints->dest_addrlen = remote_cm_data.pep_addr_len;
+                                                   malloc, remote_pep_addr_len);
+        memcpy((void*)client_hints->dest_addr, (void*)remote_cm_data.pep_addr[this->rail], (size_t)remote_pep_addr_len);
+        client_hints->dest_addrlen = remote_pep_addr_len;
         dbg_trace(sst_logger, "calling fi_getinfo()");
         fail_if_nonzero_retry_on_eagain("fi_getinfo() failed.", CRASH_ON_FAILURE,
                                         fi_getinfo, LF_VERSION, nullptr, nullptr, 0, client_hints, &client_info);
@@ -312,7 +498,7 @@ void _resources::connect_endpoint(bool is_lf_server) {
 
         dbg_trace(sst_logger, "calling fi_connect()");
         fail_if_nonzero_retry_on_eagain("fi_connect()", CRASH_ON_FAILURE,
-                                        fi_connect, this->ep, remote_cm_data.pep_addr, nullptr, 0);
+                                        fi_connect, this->ep, remote_cm_data.pep_addr[this->rail], nullptr, 0);
         dbg_trace(sst_logger, "fi_connect() succeeded, calling fi_eq_sread()");
         nRead = fi_eq_sread(this->eq, &event, &entry, sizeof(entry), -1, 0);
         if(nRead != sizeof(entry)) {
@@ -348,6 +534,13 @@ void _resources::connect_endpoint(bool is_lf_server) {
         fi_freeinfo(client_hints);
         fi_freeinfo(client_info);
     }
+    if(shares_sst_endpoint) {
+        // Hand the new endpoint to a shared owner so the next SST can reuse it
+        const uint64_t connection_id = (local_nonce ^ ntohll(remote_cm_data.connection_nonce)) | 1;
+        this->shared_endpoint = std::make_shared<lf_endpoint>(this->ep, this->eq, connection_id, this->rail);
+        std::lock_guard<std::mutex> lock(sst_endpoints_mutex);
+        sst_endpoints[this->remote_id] = this->shared_endpoint;
+    }
     sync(remote_id);
 }
 
@@ -365,7 +558,12 @@ _resources::_resources(
           remote_failed(false),
           remote_id(r_id),
           write_buf(write_addr),
-          read_buf(read_addr) {
+          read_buf(read_addr),
+          mr_base(write_addr),
+          owns_memory_regions(true),
+          shares_sst_endpoint(false),
+          rows(nullptr),
+          rail(0) {
     dbg_trace(sst_logger, "resources constructor: this={}", (void*)this);
 
     if(!write_addr) {
@@ -380,13 +578,13 @@ _resources::_resources(
 #define LF_WMR_KEY(rid) (((uint64_t)0xf8000000) << 32 | (uint64_t)(rid))
     // register the write buffer
     fail_if_nonzero_retry_on_eagain("register memory buffer for write", CRASH_ON_FAILURE,
-                                    fi_mr_reg, g_ctxt.domain, write_buf, size_w,
+                                    fi_mr_reg, rails[0]->domain, write_buf, size_w,
                                     FI_SEND | FI_RECV | FI_READ | FI_WRITE | FI_REMOTE_READ | FI_REMOTE_WRITE,
                                     0, 0, 0, &this->write_mr, nullptr);
     dbg_trace(sst_logger, "{}:{} registered memory for remote write: {}:{}", __FILE__, __func__, (void*)write_addr, size_w);
     // register the read buffer
     fail_if_nonzero_retry_on_eagain("register memory buffer for read", CRASH_ON_FAILURE,
-                                    fi_mr_reg, g_ctxt.domain, read_buf, size_r,
+                                    fi_mr_reg, rails[0]->domain, read_buf, size_r,
                                     FI_SEND | FI_RECV | FI_READ | FI_WRITE | FI_REMOTE_READ | FI_REMOTE_WRITE,
                                     0, 0, 0, &this->read_mr, nullptr);
     dbg_trace(sst_logger, "{}:{} registered memory for remote read: {}:{}", __FILE__, __func__, (void*)read_addr, size_r);
@@ -404,22 +602,56 @@ _resources::_resources(
     connect_endpoint(is_lf_server);
 }
 
+_resources::_resources(
+        int r_id,
+        uint8_t* write_addr,
+        uint8_t* read_addr,
+        int size_w,
+        int size_r,
+        int is_lf_server,
+        const row_memory& rows)
+        : sst_logger(spdlog::get(LoggerFactory::SST_LOGGER_NAME)),
+          remote_failed(false),
+          remote_id(r_id),
+          write_mr(nullptr),
+          read_mr(nullptr),
+          write_buf(write_addr),
+          read_buf(read_addr),
+          mr_base(rows.buffer),
+          owns_memory_regions(false),
+          shares_sst_endpoint(true),
+          rows(&rows),
+          rail(0) {
+    dbg_trace(sst_logger, "resources constructor for SST row: this={}", (void*)this);
+    assert(write_addr >= rows.buffer && write_addr + size_w <= rows.buffer + rows.capacity);
+    assert(read_addr >= rows.buffer && read_addr + size_r <= rows.buffer + rows.capacity);
+
+    // set up the endpoint, or reuse the one from the previous SST; this also
+    // picks the rail, and with it which of the rows' registrations to use
+    connect_endpoint(is_lf_server);
+}
+
 _resources::~_resources() {
     dbg_trace(sst_logger, "resources destructor:this={}", (void*)this);
-    if(this->ep) {
-        fail_if_nonzero_retry_on_eagain("close endpoint", REPORT_ON_FAILURE,
-                                        fi_close, &this->ep->fid);
+    // A shared endpoint is closed by its lf_endpoint when the last SST using it is destroyed
+    if(!this->shared_endpoint) {
+        if(this->ep) {
+            fail_if_nonzero_retry_on_eagain("close endpoint", REPORT_ON_FAILURE,
+                                            fi_close, &this->ep->fid);
+        }
+        if(this->eq) {
+            fail_if_nonzero_retry_on_eagain("close event", REPORT_ON_FAILURE,
+                                            fi_close, &this->eq->fid);
+        }
+    }
+    if(this->owns_memory_regions) {
+        if(this->write_mr)
+            fail_if_nonzero_retry_on_eagain("unregister write mr", REPORT_ON_FAILURE,
+                                            fi_close, &this->write_mr->fid);
+        if(this->read_mr)
+            fail_if_nonzero_retry_on_eagain("unregister read mr", REPORT_ON_FAILURE,
+                                            fi_close, &this->read_mr->fid);
     }
-    if(this->eq) {
-        fail_if_nonzero_retry_on_eagain("close event", REPORT_ON_FAILURE,
-                                        fi_close, &this->eq->fid);
-    }
-    if(this->write_mr)
-        fail_if_nonzero_retry_on_eagain("unregister write mr", REPORT_ON_FAILURE,
-                                        fi_close, &this->write_mr->fid);
-    if(this->read_mr)
-        fail_if_nonzero_retry_on_eagain("unregister read mr", REPORT_ON_FAILURE,
-                                        fi_close, &this->read_mr->fid);
 }
 
 int _resources::post_remote_send(
@@ -469,7 +701,7 @@ int _resources::post_remote_send(
         msg_iov.iov_base = read_buf + offset;
         msg_iov.iov_len = size;
 
-        rma_iov.addr = ((LF_USE_VADDR) ? remote_fi_addr : 0) + offset;
+        rma_iov.addr = remote_fi_addr + offset;
         rma_iov.len = size;
         rma_iov.key = this->mr_rwkey;
 
@@ -508,52 +740,39 @@ int _resources::post_remote_send(
     return ret;
 }
 
-void _resources::register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr) {
+void _resources::register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr,
+                                        bool use_registration_cache) {
 
-    struct fi_mr_attr   _attr; // libfabric attr
-    struct iovec        mr_iov;
-    mr_iov.iov_base     = addr;
-    mr_iov.iov_len      = size;
-    _attr.mr_iov        = &mr_iov;
-    _attr.iov_count     = 1;
-    _attr.access        = FI_SEND | FI_RECV | FI_READ | FI_WRITE | FI_REMOTE_READ | FI_REMOTE_WRITE;
-    _attr.offset        = 0;
-    _attr.requested_key = 0;
-    _attr.context       = nullptr;
-    _attr.auth_key_size = 0;
-    _attr.auth_key      = nullptr;
+    enum fi_hmem_iface iface;
     switch (attr.type) {
     case memory_attribute_t::SYSTEM:
-        _attr.iface = FI_HMEM_SYSTEM;
+        iface = FI_HMEM_SYSTEM;
         break;
     case memory_attribute_t::CUDA:
-        _attr.iface = FI_HMEM_CUDA;
+        iface = FI_HMEM_CUDA;
         break;
     case memory_attribute_t::ROCM:
-        _attr.iface = FI_HMEM_ROCR;
+        iface = FI_HMEM_ROCR;
         break;
     case memory_attribute_t::L0:
-        _attr.iface = FI_HMEM_ZE;
+        iface = FI_HMEM_ZE;
         break;
     default:
         throw derecho::derecho_exception(
             std::string("Unknown memory type :" + std::to_string(attr.type)));
     }
 
-    // register it with the domain
-    struct fid_mr* oob_mr;
-    int ret =
-    /*
-    fail_if_nonzero_retry_on_eagain("register memory buffer for write", REPORT_ON_FAILURE,
-                                    fi_mr_reg, g_ctxt.domain, addr, size,
-                                    FI_SEND | FI_RECV | FI_READ | FI_WRITE | FI_REMOTE_READ | FI_REMOTE_WRITE,
-                                    0, 0, 0, &oob_mr, nullptr);
-    */
-    fail_if_nonzero_retry_on_eagain("register memory buffer for write", REPORT_ON_FAILURE,
-                                    fi_mr_regattr, g_ctxt.domain, &_attr, 0, &oob_mr);
-    if (ret != 0) {
-        throw derecho::derecho_exception(std::string("fi_mr_reg() on oob memory failed with return value:") + std::to_string(ret));
+    // Only memory from allocate_registered_memory is cached: it is always released
+    // with munmap, which the cache sees, while malloc'd memory may be freed in a way
+    // it doesn't, and device memory isn't unmapped at all
+    std::shared_ptr<void> registration;
+    if (use_registration_cache && oob_registration_cache && iface == FI_HMEM_SYSTEM
+        && derecho::is_registered_memory(addr, size)) {
+        registration = oob_registration_cache->acquire(addr, size);
+    } else {
+        registration = register_oob_region(addr, size, iface);
     }
+    struct fid_mr* oob_mr = static_cast<struct fid_mr*>(registration.get());
 
     // register
     std::unique_lock lck(oob_mrs_mutex);
@@ -561,6 +780,7 @@ void _resources::register_oob_memory_ex(void* addr, size_t size, const memory_at
     mr.addr = addr;
     mr.size = size;
     mr.mr = oob_mr;
+    mr.registration = std::move(registration);
     oob_mrs.emplace(reinterpret_cast<uint64_t>(addr),mr);
 
     dbg_default_trace("OOB memory registered with \n"
@@ -578,11 +798,11 @@ void _resources::deregister_oob_memory(void* addr) {
     }
     rd_lck.unlock();
     std::unique_lock wr_lock(oob_mrs_mutex);
-    struct fid_mr* oob_mr = oob_mrs.at(reinterpret_cast<uint64_t>(addr)).mr;
+    std::shared_ptr<void> registration = std::move(oob_mrs.at(reinterpret_cast<uint64_t>(addr)).registration);
     oob_mrs.erase(reinterpret_cast<uint64_t>(addr));
     wr_lock.unlock();
-    fail_if_nonzero_retry_on_eagain("deregister write mr", REPORT_ON_FAILURE,
-                                    fi_close, &oob_mr->fid);
+    // Deregisters the memory here, outside the lock, unless the registration is cached
+    registration.reset();
 }
 
 void* _resources::get_oob_mr_desc(const struct iovec& iov) {
@@ -925,6 +1145,10 @@ bool add_external_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& ne
 }
 
 bool remove_node(uint32_t node_id) {
+    {
+        std::lock_guard<std::mutex> lock(sst_endpoints_mutex);
+        sst_endpoints.erase(node_id);
+    }
     if(sst_connections->contains_node(node_id)) {
         return sst_connections->delete_node(node_id);
     } else {
@@ -952,46 +1176,130 @@ void filter_external_to(const std::vector<node_id_t>& live_nodes_list) {
     external_client_connections->filter_to(live_nodes_list);
 }
 
-void polling_loop() {
-    pthread_setname_np(pthread_self(), "sst_poll");
-    auto sst_logger = spdlog::get(LoggerFactory::SST_LOGGER_NAME);
-    dbg_trace(sst_logger, "Polling thread starting.");
-
-    uint64_t last_time_ms = get_walltime() / INT64_1E6;
+/**
+ * Logs the error entry at the head of a rail's completion queue, after
+ * fi_cq_read has reported that there is one. If the rail's link has gone down,
+ * the rail is no longer used for new connections; the nodes connected through
+ * it are suspected through the usual failure detection.
+ */
+static void report_completion_error(lf_rail& rail) {
+    struct fi_cq_err_entry eentry;
+    fi_cq_readerr(rail.cq, &eentry, 0);
 
-    while(!shutdown) {
-        auto ce = lf_poll_completion();
-        if(shutdown) {
-            break;
+    dbg_error(g_ctxt.sst_logger, "fi_cq_readerr() read the following error entry:");
+    if(eentry.op_context == NULL) {
+        dbg_error(g_ctxt.sst_logger, "\top_context:NULL");
+    } else {
+#ifndef NOLOG
+        lf_completion_entry_ctxt* ce_ctxt = (lf_completion_entry_ctxt*)eentry.op_context;
+#endif
+        dbg_error(g_ctxt.sst_logger, "\top_context:ce_idx={},remote_id={}", ce_ctxt->ce_idx(), ce_ctxt->remote_id());
+#ifndef NOLOG
+        if (!ce_ctxt->is_managed()) {
+            delete ce_ctxt;
         }
+#endif
+    }
+#ifdef DEBUG_FOR_RELEASE
+    printf("\tflags=%x\n", eentry.flags);
+    printf("\tlen=%x\n", eentry.len);
+    printf("\tbuf=%p\n", eentry.buf);
+    printf("\tdata=0x%x\n", eentry.data);
+    printf("\ttag=0x%x\n", eentry.tag);
+    printf("\tolen=0x%x\n", eentry.olen);
+    printf("\terr=0x%x\n", eentry.err);
+#endif  //DEBUG_FOR_RELEASE
+    dbg_error(g_ctxt.sst_logger, "\tflags={}", eentry.flags);
+    dbg_error(g_ctxt.sst_logger, "\tlen={}", eentry.len);
+    dbg_error(g_ctxt.sst_logger, "\tbuf={}", eentry.buf);
+    dbg_error(g_ctxt.sst_logger, "\tdata={}", eentry.data);
+    dbg_error(g_ctxt.sst_logger, "\ttag={}", eentry.tag);
+    dbg_error(g_ctxt.sst_logger, "\tolen={}", eentry.olen);
+    dbg_error(g_ctxt.sst_logger, "\terr={}", eentry.err);
+#ifndef NOLOG
+    char errbuf[1024];
+#endif
+    dbg_error(g_ctxt.sst_logger, "\tprov_errno={}:{}", eentry.prov_errno,
+                      fi_cq_strerror(rail.cq, eentry.prov_errno, eentry.err_data, errbuf, 1024));
+#ifdef DEBUG_FOR_RELEASE
+    printf("\tproverr=0x%x,%s\n", eentry.prov_errno,
+           fi_cq_strerror(rail.cq, eentry.prov_errno, eentry.err_data, errbuf, 1024));
+#endif  //DEBUG_FOR_RELEASE
+    dbg_error(g_ctxt.sst_logger, "\terr_data={}", eentry.err_data);
+    dbg_error(g_ctxt.sst_logger, "\terr_data_size={}", eentry.err_data_size);
+#ifdef DEBUG_FOR_RELEASE
+    printf("\terr_data_size=%d\n", eentry.err_data_size);
+#endif  //DEBUG_FOR_RELEASE
+    // Since eentry.op_context is unreliable, callers report a generic error instead of using it
+    dbg_error(g_ctxt.sst_logger, "\tFailed polling the completion queue");
+    if(rail.usable && !derecho::rail_link_is_up(rail.domain_name)) {
+        dbg_warn(g_ctxt.sst_logger, "The link of rail {} is down, so new connections will not use it", rail.domain_name);
+        rail.usable = false;
+    }
+}
+
+/**
+ * Converts a successful completion queue entry to the form stored in
+ * util::polling_data, and frees its context if the caller did not manage it.
+ * @return pair(ce_idx,pair(remote_id,result)), or an entry with ce_idx
+ * 0xFFFFFFFF if the entry had no context
+ */
+static std::pair<uint32_t, std::pair<int32_t, int32_t>> decode_completion(const struct fi_cq_entry& entry) {
+    lf_completion_entry_ctxt* ce_ctxt = (lf_completion_entry_ctxt*)entry.op_context;
+    if(ce_ctxt == NULL) {
+        dbg_debug(g_ctxt.sst_logger, "WEIRD: we get an entry with op_context = NULL.");
+        return {0xFFFFFFFFu, {0, 0}};  // return a bad entry: weird!!!!
+    }
+    std::pair<uint32_t, std::pair<int32_t, int32_t>> ret = {ce_ctxt->ce_idx(), {ce_ctxt->remote_id(), 1}};
+    if(!ce_ctxt->is_managed()) {
+        delete ce_ctxt;
+    }
+    return ret;
+}
+
+/**
+ * Reads every completion that is ready on a rail, up to a batch of 1024, and
+ * hands each one to the thread that posted the operation through
+ * util::polling_data. This is the completion source callback of each of the
+ * SST's rails, so it runs on the completion poller's thread.
+ * @return The number of completions read
+ */
+static int poll_completion_batch(lf_rail& rail) {
+    // Like RDMC, drain as many completions as are ready with each read
+    static constexpr int max_cq_entries = 1024;
+    static struct fi_cq_entry cq_entries[max_cq_entries];
+
+    if(shutdown) {
+        return 0;
+    }
+    ssize_t num_completions = fi_cq_read(rail.cq, cq_entries, max_cq_entries);
+    if(num_completions == 0 || num_completions == -FI_EAGAIN) {
+        return 0;
+    } else if(num_completions < 0) {
+        report_completion_error(rail);
+        return 0;
+    }
+    for(ssize_t i = 0; i < num_completions; ++i) {
+        auto ce = decode_completion(cq_entries[i]);
         if(ce.first != 0xFFFFFFFF) {
             util::polling_data.insert_completion_entry(ce.first, ce.second);
-
-            // update last time
-            last_time_ms = get_walltime() / INT64_1E6;
-        } else {
-            uint64_t time_elapsed_in_ms = (get_walltime() / INT64_1E6) - last_time_ms;
-            if(time_elapsed_in_ms > 100) {
-                using namespace std::chrono_literals;
-                std::this_thread::sleep_for(1ms);
-            }
         }
     }
-    dbg_trace(sst_logger, "Polling thread ending.");
+    return num_completions;
 }
 
 /**
  * @details
- * This blocks until a single entry in the completion queue has
- * completed
- * It is exclusively used by the polling thread
- * the thread can sleep while in this function, when it calls util::polling_data.wait_for_requests
+ * This blocks until a single entry in any rail's completion queue has
+ * completed. The polling thread does not use it, since it reads completions
+ * in batches, but it can be used by programs that poll the queue themselves.
  * @return pair(remote_id,result) The queue pair number associated with the
  * completed request and the result (1 for successful, -1 for unsuccessful)
  */
 std::pair<uint32_t, std::pair<int32_t, int32_t>> lf_poll_completion() {
     struct fi_cq_entry entry;
     int poll_result = 0;
+    uint32_t polled_rail = 0;
 
     uint64_t last_time_ms = get_walltime() / INT64_1E6;
 
@@ -1004,7 +1312,15 @@ std::pair<uint32_t, std::pair<int32_t, int32_t>> lf_poll_completion() {
 
         poll_result = 0;
         for(int i = 0; i < 50; ++i) {
-            poll_result = fi_cq_read(g_ctxt.cq, &entry, 1);
+            for(polled_rail = 0; polled_rail < rails.size(); ++polled_rail) {
+                if(!rails[polled_rail]->cq) {
+                    continue;
+                }
+                poll_result = fi_cq_read(rails[polled_rail]->cq, &entry, 1);
+                if(poll_result && (poll_result != -FI_EAGAIN)) {
+                    break;
+                }
+            }
             if(poll_result && (poll_result != -FI_EAGAIN)) {
                 break;
             }
@@ -1012,88 +1328,102 @@ std::pair<uint32_t, std::pair<int32_t, int32_t>> lf_poll_completion() {
         if(poll_result && (poll_result != -FI_EAGAIN)) {
             break;
         }
-        // util::polling_data.wait_for_requests();
     }
     // not sure what to do when we cannot read entries off the CQ
     // this means that something is wrong with the local node
     if((poll_result < 0) && (poll_result != -FI_EAGAIN)) {
-        struct fi_cq_err_entry eentry;
-        fi_cq_readerr(g_ctxt.cq, &eentry, 0);
-
-        dbg_error(g_ctxt.sst_logger, "fi_cq_readerr() read the following error entry:");
-        if(eentry.op_context == NULL) {
-            dbg_error(g_ctxt.sst_logger, "\top_context:NULL");
-        } else {
-#ifndef NOLOG
-            lf_completion_entry_ctxt* ce_ctxt = (lf_completion_entry_ctxt*)eentry.op_context;
-#endif
-            dbg_error(g_ctxt.sst_logger, "\top_context:ce_idx={},remote_id={}", ce_ctxt->ce_idx(), ce_ctxt->remote_id());
-#ifndef NOLOG
-            if (!ce_ctxt->is_managed()) {
-                delete ce_ctxt;
-            }
-#endif
-        }
-#ifdef DEBUG_FOR_RELEASE
-        printf("\tflags=%x\n", eentry.flags);
-        printf("\tlen=%x\n", eentry.len);
-        printf("\tbuf=%p\n", eentry.buf);
-        printf("\tdata=0x%x\n", eentry.data);
-        printf("\ttag=0x%x\n", eentry.tag);
-        printf("\tolen=0x%x\n", eentry.olen);
-        printf("\terr=0x%x\n", eentry.err);
-#endif  //DEBUG_FOR_RELEASE
-        dbg_error(g_ctxt.sst_logger, "\tflags={}", eentry.flags);
-        dbg_error(g_ctxt.sst_logger, "\tlen={}", eentry.len);
-        dbg_error(g_ctxt.sst_logger, "\tbuf={}", eentry.buf);
-        dbg_error(g_ctxt.sst_logger, "\tdata={}", eentry.data);
-        dbg_error(g_ctxt.sst_logger, "\ttag={}", eentry.tag);
-        dbg_error(g_ctxt.sst_logger, "\tolen={}", eentry.olen);
-        dbg_error(g_ctxt.sst_logger, "\terr={}", eentry.err);
-#ifndef NOLOG
-        char errbuf[1024];
-#endif
-        dbg_error(g_ctxt.sst_logger, "\tprov_errno={}:{}", eentry.prov_errno,
-                          fi_cq_strerror(g_ctxt.cq, eentry.prov_errno, eentry.err_data, errbuf, 1024));
-#ifdef DEBUG_FOR_RELEASE
-        printf("\tproverr=0x%x,%s\n", eentry.prov_errno,
-               fi_cq_strerror(g_ctxt.cq, eentry.prov_errno, eentry.err_data, errbuf, 1024));
-#endif  //DEBUG_FOR_RELEASE
-        dbg_error(g_ctxt.sst_logger, "\terr_data={}", eentry.err_data);
-        dbg_error(g_ctxt.sst_logger, "\terr_data_size={}", eentry.err_data_size);
-#ifdef DEBUG_FOR_RELEASE
-        printf("\terr_data_size=%d\n", eentry.err_data_size);
-#endif  //DEBUG_FOR_RELEASE
-        /**
-         * Since eentry.op_context is unreliable, we ignore it with returning a generic error.
-        if(eentry.op_context != NULL) {
-            lf_completion_entry_ctxt* ce_ctxt = (lf_completion_entry_ctxt*)eentry.op_context;
-            return {ce_ctxt->ce_idx(), {ce_ctxt->remote_id(), -1}};
-        } else {
-            dbg_error(g_ctxt.sst_logger, "\tFailed polling the completion queue");
-            fprintf(stderr, "Failed polling the completion queue");
-            return {(uint32_t)0xFFFFFFFF, {0, -1}};  // we don't know who sent the message.
-        }*/
-        dbg_error(g_ctxt.sst_logger, "\tFailed polling the completion queue");
+        report_completion_error(*rails[polled_rail]);
         return {(uint32_t)0xFFFFFFFF, {0, -1}};  // we don't know who sent the message.
     }
     if(!shutdown) {
-        lf_completion_entry_ctxt* ce_ctxt = (lf_completion_entry_ctxt*)entry.op_context;
-        if(ce_ctxt == NULL) {
-            dbg_debug(g_ctxt.sst_logger, "WEIRD: we get an entry with op_context = NULL.");
-            return {0xFFFFFFFFu, {0, 0}};  // return a bad entry: weird!!!!
+        return decode_completion(entry);
+    } else {  // shutdown return a bad entry
+        return {0, {0, 0}};
+    }
+}
+
+/**
+ * Opens the fabric, domain, completion queue and passive endpoint of a rail.
+ * @param num_remote_nodes The number of nodes the rail may connect to, which
+ * sizes its completion queue
+ * @param required True if the program should crash if the rail can't be
+ * opened; otherwise the rail is returned unusable, so the other rails can
+ * still be used
+ */
+static std::unique_ptr<lf_rail> open_rail(const derecho::RailConfig& rail_config,
+                                          size_t num_remote_nodes, bool required) {
+    const NextOnFailure failure_mode = required ? CRASH_ON_FAILURE : REPORT_ON_FAILURE;
+    auto rail = std::make_unique<lf_rail>();
+    rail->domain_name = rail_config.domain;
+    rail->weight = rail_config.weight;
+    rail->usable = false;
+    rail->pep_addr_len = max_lf_addr_size;
+    rail->hints = fi_dupinfo(g_ctxt.hints);
+    free(rail->hints->domain_attr->name);
+    rail->hints->domain_attr->name = crash_if_nullptr("strdup domain name.",
+                                                      strdup, rail_config.domain.c_str());
+
+    //dbg_default_info(fi_tostr(rail->hints,FI_TYPE_INFO));
+    struct fi_info* info_candidates = nullptr;
+    if(fail_if_nonzero_retry_on_eagain("fi_getinfo()", failure_mode,
+                                       fi_getinfo, LF_VERSION, nullptr, nullptr, 0, rail->hints, &(info_candidates))) {
+        return rail;
+    }
+
+    // TOOD: this is a bug in libfabric till at least v1.18.1:
+    // fi_getinfo() does not respect hints->domain_attr.
+    struct fi_info* info_candidate = info_candidates;
+    while (info_candidate != nullptr) {
+        if (strcmp(info_candidate->domain_attr->name,rail->hints->domain_attr->name)) {
+            info_candidate = info_candidate->next;
         } else {
+            // found
+            rail->fi = fi_dupinfo(info_candidate);
+            break;
+        }
+    }
 
-            // dbg_trace(g_ctxt.sst_logger, "Normal: we get an entry with op_context = {:p}.", static_cast<void*>(ce_ctxt));
-            std::pair<uint32_t,std::pair<int32_t,int32_t>> ret = {ce_ctxt->ce_idx(), {ce_ctxt->remote_id(), 1}};
-            if (!ce_ctxt->is_managed()) {
-                delete ce_ctxt;
-            }
-            return ret;
+    fi_freeinfo(info_candidates);
+    if (rail->fi == nullptr) {
+        if(required) {
+            crash_with_message("SST: failed to get an fi_info data structure.");
         }
-    } else {  // shutdown return a bad entry
-        return {0, {0, 0}};
+        dbg_error(g_ctxt.sst_logger, "Failed to get an fi_info data structure for domain {}", rail_config.domain);
+        return rail;
+    }
+
+    if(fail_if_nonzero_retry_on_eagain("fi_fabric()", failure_mode,
+                                       fi_fabric, rail->fi->fabric_attr, &(rail->fabric), nullptr)
+       || fail_if_nonzero_retry_on_eagain("fi_domain()", failure_mode,
+                                          fi_domain, rail->fabric, rail->fi, &(rail->domain), nullptr)) {
+        return rail;
+    }
+    size_t max_cqe = rail->fi->tx_attr->size * num_remote_nodes;
+    g_ctxt.cq_attr.size = (max_cqe > 2097152) ? max_cqe : 2097152;
+    if(fail_if_nonzero_retry_on_eagain("initialize tx completion queue.", REPORT_ON_FAILURE,
+                                       fi_cq_open, rail->domain, &(g_ctxt.cq_attr), &(rail->cq), nullptr)
+       && !required) {
+        return rail;
     }
+
+    // prepare local PEP
+    if(fail_if_nonzero_retry_on_eagain("open the event queue for passive endpoint", failure_mode,
+                                       fi_eq_open, rail->fabric, &g_ctxt.eq_attr, &rail->peq, nullptr)
+       || fail_if_nonzero_retry_on_eagain("open a local passive endpoint", failure_mode,
+                                          fi_passive_ep, rail->fabric, rail->fi, &rail->pep, nullptr)
+       || fail_if_nonzero_retry_on_eagain("binding event queue to passive endpoint", failure_mode,
+                                          fi_pep_bind, rail->pep, &rail->peq->fid, 0)
+       || fail_if_nonzero_retry_on_eagain("preparing passive endpoint for incoming connections", failure_mode,
+                                          fi_listen, rail->pep)
+       || fail_if_nonzero_retry_on_eagain("get the local PEP address", failure_mode,
+                                          fi_getname, &rail->pep->fid, rail->pep_addr, &rail->pep_addr_len)) {
+        return rail;
+    }
+    if(rail->pep_addr_len > max_lf_addr_size) {
+        crash_with_message("LibFabric error! local name is too big to fit in local buffer");
+    }
+    rail->usable = true;
+    return rail;
 }
 
 void lf_initialize(const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& internal_ip_addrs_and_ports,
@@ -1137,72 +1467,73 @@ void lf_initialize(const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& in
     // STEP 1: initialize with configuration.
     default_context();     // default the context
     load_configuration();  // load configuration
+    local_node_id = node_id;
 
-    //dbg_default_info(fi_tostr(g_ctxt.hints,FI_TYPE_INFO));
-    // STEP 2: initialize fabric, domain, and completion queue
-    struct fi_info* info_candidates = nullptr;
-    fail_if_nonzero_retry_on_eagain("fi_getinfo()", CRASH_ON_FAILURE,
-                                    fi_getinfo, LF_VERSION, nullptr, nullptr, 0, g_ctxt.hints, &(info_candidates));
-
-    // TOOD: this is a bug in libfabric till at least v1.18.1:
-    // fi_getinfo() does not respect hints->domain_attr.
-    struct fi_info* info_candidate = info_candidates;
-    while (info_candidate != nullptr) {
-        assert(g_ctxt.hints->domain_attr->name);
-        if (strcmp(info_candidate->domain_attr->name,g_ctxt.hints->domain_attr->name)) {
-            info_candidate = info_candidate->next;
-        } else {
-            // found
-            g_ctxt.fi = fi_dupinfo(info_candidate);
-            break;
-        }
-    }
-
-    fi_freeinfo(info_candidates);
-    if (g_ctxt.fi == nullptr) {
-        crash_with_message("SST: failed to get an fi_info data structure.");
+    // STEP 2: open each rail's fabric, domain, completion queue and passive endpoint
+    std::vector<derecho::RailConfig> rail_configs;
+    try {
+        rail_configs = derecho::get_configured_rails();
+    } catch(std::exception& e) {
+        dbg_error(logger, "Invalid rail configuration: {}", e.what());
+        crash_with_message("Invalid rail configuration: %s\n", e.what());
     }
-
-    dbg_trace(logger, "going to use virtual address?{}", LF_USE_VADDR);
-    fail_if_nonzero_retry_on_eagain("fi_fabric()", CRASH_ON_FAILURE,
-                                    fi_fabric, g_ctxt.fi->fabric_attr, &(g_ctxt.fabric), nullptr);
-    fail_if_nonzero_retry_on_eagain("fi_domain()", CRASH_ON_FAILURE,
-                                    fi_domain, g_ctxt.fabric, g_ctxt.fi, &(g_ctxt.domain), nullptr);
     // Note: we don't have a way to throttle the sender based on the completion queue size.
     // Therefore we just use a very large completion queue size to buffer cq entries as much as possible.
     // ibv_query_device() in verbs API reports max_cqe, which is "Maximum number of entries in each CQ supported
     // by this device". The number is 4194303 (2^22-1) with Mellanox connectx-4 VPI. We hard lift the setting to
     // >=2097151(2^21-1), hoping it works for as many RDMA devices as possible. TODO: find a better approach
     // to determining completion queue size.
-    size_t max_cqe = g_ctxt.fi->tx_attr->size * internal_ip_addrs_and_ports.size()
-                     + g_ctxt.fi->tx_attr->size * external_ip_addrs_and_ports.size();
-    g_ctxt.cq_attr.size = (max_cqe > 2097152) ? max_cqe : 2097152;
-    fail_if_nonzero_retry_on_eagain("initialize tx completion queue.", REPORT_ON_FAILURE,
-                                    fi_cq_open, g_ctxt.domain, &(g_ctxt.cq_attr), &(g_ctxt.cq), nullptr);
-
-    // STEP 3: prepare local PEP
-    fail_if_nonzero_retry_on_eagain("open the event queue for passive endpoint", CRASH_ON_FAILURE,
-                                    fi_eq_open, g_ctxt.fabric, &g_ctxt.eq_attr, &g_ctxt.peq, nullptr);
-    fail_if_nonzero_retry_on_eagain("open a local passive endpoint", CRASH_ON_FAILURE,
-                                    fi_passive_ep, g_ctxt.fabric, g_ctxt.fi, &g_ctxt.pep, nullptr);
-    fail_if_nonzero_retry_on_eagain("binding event queue to passive endpoint", CRASH_ON_FAILURE,
-                                    fi_pep_bind, g_ctxt.pep, &g_ctxt.peq->fid, 0);
-    fail_if_nonzero_retry_on_eagain("preparing passive endpoint for incoming connections", CRASH_ON_FAILURE,
-                                    fi_listen, g_ctxt.pep);
-    fail_if_nonzero_retry_on_eagain("get the local PEP address", CRASH_ON_FAILURE,
-                                    fi_getname, &g_ctxt.pep->fid, g_ctxt.pep_addr, &g_ctxt.pep_addr_len);
-    if(g_ctxt.pep_addr_len > max_lf_addr_size) {
-        crash_with_message("LibFabric error! local name is too big to fit in local buffer");
+    const size_t num_remote_nodes = internal_ip_addrs_and_ports.size() + external_ip_addrs_and_ports.size();
+    for(uint32_t rail = 0; rail < rail_configs.size(); ++rail) {
+        rails.emplace_back(open_rail(rail_configs[rail], num_remote_nodes, rail == 0));
+    }
+    dbg_trace(logger, "going to use virtual address?{}", LF_USE_VADDR);
+    const uint32_t registration_cache_entries = derecho::getConfUInt32(derecho::Conf::DERECHO_REGISTRATION_CACHE_ENTRIES);
+    if(registration_cache_entries > 0) {
+        // A cached registration usually starts before the buffer it is used
+        // for, which only works if remote accesses use virtual addresses
+        if(LF_USE_VADDR) {
+            oob_registration_cache = std::make_unique<derecho::registration_cache>(
+                    registration_cache_entries, [](void* start, size_t length) {
+                        return register_oob_region(start, length, FI_HMEM_SYSTEM);
+                    });
+        } else {
+            dbg_warn(logger, "The provider does not address remote memory by virtual address, so out-of-band registrations will not be cached");
+        }
     }
 
-    // STEP 4: start polling thread.
-    polling_thread = std::thread(polling_loop);
+    // STEP 3: start polling the completion queues.
+    completion_poller = derecho::get_completion_poller(
+            "sst_poll", derecho::getConfInt32(derecho::Conf::DERECHO_SST_POLLER_CPU));
+    for(uint32_t rail = 0; rail < rails.size(); ++rail) {
+        lf_rail* rail_ptr = rails[rail].get();
+        if(!rail_ptr->cq) {
+            continue;
+        }
+        derecho::CompletionSource completion_source;
+        completion_source.name = rails.size() > 1 ? "SST rail " + std::to_string(rail) : "SST";
+        completion_source.poll_batch = [rail_ptr]() { return poll_completion_batch(*rail_ptr); };
+        int cq_wait_fd = -1;
+        if(fi_control(&rail_ptr->cq->fid, FI_GETWAIT, &cq_wait_fd) == 0) {
+            completion_source.wait_fd = cq_wait_fd;
+            completion_source.prepare_to_block = [rail_ptr]() {
+                struct fid* cq_fid = &rail_ptr->cq->fid;
+                return fi_trywait(rail_ptr->fabric, &cq_fid, 1) == FI_SUCCESS;
+            };
+        }
+        rail_ptr->completion_source_id = completion_poller->add_source(std::move(completion_source));
+    }
 }
 
 void shutdown_polling_thread() {
     shutdown = true;
-    if(polling_thread.joinable()) {
-        polling_thread.join();
+    if(completion_poller) {
+        for(const auto& rail : rails) {
+            if(rail->cq) {
+                completion_poller->remove_source(rail->completion_source_id);
+            }
+        }
+        completion_poller.reset();
     }
 }
 
@@ -1214,31 +1545,40 @@ void lf_destroy() {
 
     // TODO: make sure all resources are destroyed first.
     _resources::global_release();
-
-    if(g_ctxt.pep) {
-        fail_if_nonzero_retry_on_eagain("close passive endpoint", REPORT_ON_FAILURE,
-                                        fi_close, &g_ctxt.pep->fid);
-    }
-    if(g_ctxt.peq) {
-        fail_if_nonzero_retry_on_eagain("close event queue for passive endpoint", REPORT_ON_FAILURE,
-                                        fi_close, &g_ctxt.peq->fid);
-    }
-    if(g_ctxt.cq) {
-        fail_if_nonzero_retry_on_eagain("close completion queue", REPORT_ON_FAILURE,
-                                        fi_close, &g_ctxt.cq->fid);
+    {
+        std::lock_guard<std::mutex> lock(sst_endpoints_mutex);
+        sst_endpoints.clear();
     }
-    if(g_ctxt.domain) {
-        fail_if_nonzero_retry_on_eagain("close domain", REPORT_ON_FAILURE,
-                                        fi_close, &g_ctxt.domain->fid);
-    }
-    if(g_ctxt.fabric) {
-        fail_if_nonzero_retry_on_eagain("close fabric", REPORT_ON_FAILURE,
-                                        fi_close, &g_ctxt.fabric->fid);
-    }
-    if(g_ctxt.fi) {
-        fi_freeinfo(g_ctxt.fi);
-        g_ctxt.hints = nullptr;
+
+    for(const auto& rail : rails) {
+        if(rail->pep) {
+            fail_if_nonzero_retry_on_eagain("close passive endpoint", REPORT_ON_FAILURE,
+                                            fi_close, &rail->pep->fid);
+        }
+        if(rail->peq) {
+            fail_if_nonzero_retry_on_eagain("close event queue for passive endpoint", REPORT_ON_FAILURE,
+                                            fi_close, &rail->peq->fid);
+        }
+        if(rail->cq) {
+            fail_if_nonzero_retry_on_eagain("close completion queue", REPORT_ON_FAILURE,
+                                            fi_close, &rail->cq->fid);
+        }
+        if(rail->domain) {
+            fail_if_nonzero_retry_on_eagain("close domain", REPORT_ON_FAILURE,
+                                            fi_close, &rail->domain->fid);
+        }
+        if(rail->fabric) {
+            fail_if_nonzero_retry_on_eagain("close fabric", REPORT_ON_FAILURE,
+                                            fi_close, &rail->fabric->fid);
+        }
+        if(rail->fi) {
+            fi_freeinfo(rail->fi);
+        }
+        if(rail->hints) {
+            fi_freeinfo(rail->hints);
+        }
     }
+    rails.clear();
     if(g_ctxt.hints) {
         fi_freeinfo(g_ctxt.hints);
         g_ctxt.hints = nullptr;
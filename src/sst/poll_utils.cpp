@@ -1,76 +1,157 @@
 #include <derecho/sst/detail/poll_utils.hpp>
 
-#include <functional>
-#include <iostream>
-#include <numeric>
+#include <stdexcept>
+#include <string>
 
 namespace sst {
 namespace util {
 
-//std::vector<std::list<std::pair<int32_t, int32_t>>> PollingData::completion_entries;
-//std::map<std::thread::id, uint32_t> PollingData::tid_to_index;
-//std::vector<bool> PollingData::if_waiting;
-//std::condition_variable PollingData::poll_cv;
-//std::mutex PollingData::poll_mutex;
-
 //Single global instance, defined here
 PollingData polling_data;
 
+namespace {
+/**
+ * The calling thread's completion entry index. Caches the index, so that
+ * looking it up while waiting for a completion doesn't take the registration
+ * lock, and gives the index back to its PollingData when the thread exits.
+ */
+struct ThreadRegistration {
+    PollingData* polling_data = nullptr;
+    uint32_t index = 0;
+    ~ThreadRegistration() {
+        if(polling_data) {
+            polling_data->release_index(std::this_thread::get_id(), index);
+        }
+    }
+};
+thread_local ThreadRegistration thread_registration;
+}  // namespace
+
 bool PollingData::check_waiting() {
-    return std::accumulate(if_waiting.begin(), if_waiting.end(), false, [](bool a, bool b) { return a || b; });
+    const uint32_t count = num_rings.load(std::memory_order_acquire);
+    for(uint32_t index = 0; index < count; ++index) {
+        if(rings[index]->waiting.load(std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void PollingData::insert_completion_entry(uint32_t index, std::pair<int32_t, int32_t> ce) {
-    std::lock_guard<std::mutex> lk(poll_mutex);
-    int32_t nid     = ce.first;
-    int32_t result  = ce.second;
-    if (completion_entries[index].find(nid) == completion_entries[index].end()) {
-        completion_entries[index].emplace(std::pair<int32_t,std::list<int32_t>>{nid,{}});
+    if(index >= num_rings.load(std::memory_order_acquire)) {
+        return;
     }
-    completion_entries[index][nid].push_back(result);
+    CompletionRing& ring = *rings[index];
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if(!ring.has_overflow.load(std::memory_order_acquire)
+       && head - ring.tail.load(std::memory_order_acquire) < ring_capacity) {
+        ring.entries[head % ring_capacity] = ce;
+        ring.head.store(head + 1, std::memory_order_release);
+        return;
+    }
+    // The owner has fallen behind; once anything is in the overflow list, later
+    // completions must go there too until the owner drains it
+    std::lock_guard<std::mutex> lk(ring.overflow_mutex);
+    ring.overflow.push_back(ce);
+    ring.has_overflow.store(true, std::memory_order_release);
 }
 
-std::optional<int32_t> PollingData::get_completion_entry(const std::thread::id tid, const int nid) {
-    std::lock_guard<std::mutex> lk(poll_mutex);
-    auto index = tid_to_index[tid];
-    if(completion_entries[index].find(nid)==completion_entries[index].end()) {
-        return {};
+void PollingData::drain_ring(CompletionRing& ring) {
+    auto move_ring_to_pending = [&ring]() {
+        uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        const uint64_t head = ring.head.load(std::memory_order_acquire);
+        for(; tail != head; ++tail) {
+            const std::pair<int32_t, int32_t>& ce = ring.entries[tail % ring_capacity];
+            ring.pending[ce.first].push_back(ce.second);
+        }
+        ring.tail.store(tail, std::memory_order_release);
+    };
+    move_ring_to_pending();
+    if(ring.has_overflow.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lk(ring.overflow_mutex);
+        // While has_overflow is set the polling thread does not add to the ring,
+        // so everything now in the ring is older than everything in the overflow list
+        move_ring_to_pending();
+        for(const std::pair<int32_t, int32_t>& ce : ring.overflow) {
+            ring.pending[ce.first].push_back(ce.second);
+        }
+        ring.overflow.clear();
+        ring.has_overflow.store(false, std::memory_order_release);
     }
-    if(completion_entries[index][nid].empty()) {
+}
+
+std::optional<int32_t> PollingData::get_completion_entry(const std::thread::id tid, const int nid) {
+    CompletionRing& ring = *rings[get_index(tid)];
+    drain_ring(ring);
+    auto pending_iter = ring.pending.find(nid);
+    if(pending_iter == ring.pending.end() || pending_iter->second.empty()) {
         return {};
     }
-    int32_t result = completion_entries[index][nid].front();
-    completion_entries[index][nid].pop_front();
+    int32_t result = pending_iter->second.front();
+    pending_iter->second.pop_front();
     return result;
 }
 
 uint32_t PollingData::get_index(const std::thread::id id) {
-    std::lock_guard<std::mutex> lk(poll_mutex);
-    if(tid_to_index.find(id) == tid_to_index.end()) {
-        completion_entries.push_back(std::map<int32_t,std::list<int32_t>>());
-        tid_to_index[id] = completion_entries.size() - 1;
-        if_waiting.push_back(false);
+    const bool is_calling_thread = (id == std::this_thread::get_id());
+    if(is_calling_thread && thread_registration.polling_data == this) {
+        return thread_registration.index;
+    }
+    std::lock_guard<std::mutex> lk(registration_mutex);
+    auto index_iter = tid_to_index.find(id);
+    uint32_t index;
+    if(index_iter != tid_to_index.end()) {
+        index = index_iter->second;
+    } else if(is_calling_thread && !free_indices.empty()) {
+        // Reuse the ring of a thread that has exited
+        index = free_indices.back();
+        free_indices.pop_back();
+        tid_to_index.emplace(id, index);
+    } else {
+        index = num_rings.load(std::memory_order_relaxed);
+        if(index >= max_threads) {
+            throw std::runtime_error("PollingData: more than " + std::to_string(max_threads)
+                                     + " threads are waiting for completions");
+        }
+        rings[index] = std::make_unique<CompletionRing>();
+        tid_to_index.emplace(id, index);
+        // Publish the ring to the polling thread only after it is constructed
+        num_rings.store(index + 1, std::memory_order_release);
     }
-    return tid_to_index[id];
+    // Only the calling thread can be given a registration that releases its
+    // index when it exits; any other thread's index stays registered
+    if(is_calling_thread && thread_registration.polling_data == nullptr) {
+        thread_registration.polling_data = this;
+        thread_registration.index = index;
+    }
+    return index;
+}
+
+void PollingData::release_index(const std::thread::id id, uint32_t index) {
+    CompletionRing& ring = *rings[index];
+    ring.waiting.store(false, std::memory_order_relaxed);
+    // The exiting thread is still the ring's owner, so it can empty the ring
+    // for the next owner; completions it never collected are discarded
+    drain_ring(ring);
+    ring.pending.clear();
+    std::lock_guard<std::mutex> lk(registration_mutex);
+    tid_to_index.erase(id);
+    free_indices.push_back(index);
 }
 
 void PollingData::set_waiting(const std::thread::id id) {
+    rings[get_index(id)]->waiting.store(true, std::memory_order_relaxed);
     std::lock_guard<std::mutex> lk(poll_mutex);
-    auto index = tid_to_index[id];
-    if_waiting[index] = true;
     poll_cv.notify_all();
 }
 
 void PollingData::reset_waiting(const std::thread::id id) {
-    std::lock_guard<std::mutex> lk(poll_mutex);
-    auto index = tid_to_index[id];
-    if_waiting[index] = false;
+    rings[get_index(id)]->waiting.store(false, std::memory_order_relaxed);
 }
 
 void PollingData::wait_for_requests() {
     std::unique_lock<std::mutex> lk(poll_mutex);
-    // poll_cv.wait(lk, check_waiting);
-    poll_cv.wait(lk, std::bind(&PollingData::check_waiting, this));
+    poll_cv.wait(lk, [this]() { return check_waiting(); });
 }
 }  // namespace util
 }  // namespace sst
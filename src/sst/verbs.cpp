@@ -389,7 +389,7 @@ int _resources::post_remote_send(verbs_sender_ctxt* sctxt, const long long int o
     return ret;
 }
 
-void _resources::register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr) {
+void _resources::register_oob_memory_ex(void* addr, size_t size, const memory_attribute_t& attr, bool use_registration_cache) {
     throw unsupported_operation_exception("register_oob_memory_ex");
 }
 
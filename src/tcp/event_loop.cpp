@@ -0,0 +1,326 @@
+#include <derecho/tcp/event_loop.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace tcp {
+
+namespace {
+/** Sets or clears O_NONBLOCK on a file descriptor. */
+void set_nonblocking(int fd, bool nonblocking) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if(nonblocking) {
+        flags |= O_NONBLOCK;
+    } else {
+        flags &= ~O_NONBLOCK;
+    }
+    fcntl(fd, F_SETFL, flags);
+}
+
+/**
+ * Prints a formatted message to stderr (via fprintf), then crashes the program.
+ * @param format_str A printf-style format string
+ * @param ... Any number of arguments to the format string
+ */
+void crash_with_message(const char* format_str, ...) {
+    va_list format_args;
+    va_start(format_args, format_str);
+    vfprintf(stderr, format_str, format_args);
+    va_end(format_args);
+    fflush(stderr);
+    exit(-1);
+}
+}  // namespace
+
+event_loop::event_loop(const std::string& thread_name)
+        : epoll_fd(epoll_create1(0)),
+          wakeup_fd(eventfd(0, EFD_NONBLOCK)),
+          thread_shutdown(false) {
+    if(epoll_fd < 0 || wakeup_fd < 0) {
+        throw socket_io_error(errno, "event_loop: failed to create epoll or eventfd descriptor");
+    }
+    struct epoll_event wakeup_event;
+    memset(&wakeup_event, 0, sizeof(wakeup_event));
+    wakeup_event.data.fd = wakeup_fd;
+    wakeup_event.events = EPOLLIN;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &wakeup_event);
+    loop_thread = std::thread(&event_loop::loop, this, thread_name);
+}
+
+event_loop::~event_loop() {
+    stop();
+    close(wakeup_fd);
+    close(epoll_fd);
+}
+
+void event_loop::stop() {
+    thread_shutdown = true;
+    uint64_t wakeup = 1;
+    [[maybe_unused]] ssize_t ignored = ::write(wakeup_fd, &wakeup, sizeof(wakeup));
+    if(loop_thread.joinable()) {
+        loop_thread.join();
+    }
+}
+
+void event_loop::add_listener(connection_listener& listener, accept_handler on_accept) {
+    const int listener_fd = *listener.fd;
+    set_nonblocking(listener_fd, true);
+    {
+        std::lock_guard<std::mutex> lock(submitted_mutex);
+        listeners.emplace(listener_fd, std::move(on_accept));
+    }
+    struct epoll_event accept_event;
+    memset(&accept_event, 0, sizeof(accept_event));
+    accept_event.data.fd = listener_fd;
+    accept_event.events = EPOLLIN;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener_fd, &accept_event);
+}
+
+void event_loop::async_read(socket sock, std::size_t size, int timeout_ms,
+                            read_handler on_complete, error_handler on_error) {
+    operation op{std::move(sock), false, std::vector<uint8_t>(size), {}, 0,
+                 timeout_ms >= 0, std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms),
+                 std::move(on_complete), nullptr, std::move(on_error)};
+    submit(std::move(op));
+}
+
+void event_loop::async_write(socket sock, std::vector<std::vector<uint8_t>> buffers, int timeout_ms,
+                             write_handler on_complete, error_handler on_error) {
+    operation op{std::move(sock), true, {}, std::move(buffers), 0,
+                 timeout_ms >= 0, std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms),
+                 nullptr, std::move(on_complete), std::move(on_error)};
+    submit(std::move(op));
+}
+
+void event_loop::submit(operation&& op) {
+    {
+        std::lock_guard<std::mutex> lock(submitted_mutex);
+        submitted_operations.emplace_back(std::move(op));
+    }
+    uint64_t wakeup = 1;
+    [[maybe_unused]] ssize_t ignored = ::write(wakeup_fd, &wakeup, sizeof(wakeup));
+}
+
+void event_loop::loop(const std::string& thread_name) {
+    pthread_setname_np(pthread_self(), thread_name.c_str());
+    constexpr int max_events = 64;
+    struct epoll_event events[max_events];
+    while(!thread_shutdown) {
+        start_submitted_operations();
+        int num_events = epoll_wait(epoll_fd, events, max_events, time_to_next_deadline());
+        if(num_events < 0 && errno != EINTR) {
+            // Any error but an interruption means the epoll descriptor itself is broken, and
+            // without this loop the node can't accept joins or client connections
+            crash_with_message("event_loop %s: epoll_wait failed: %s\n", thread_name.c_str(), strerror(errno));
+        }
+        for(int i = 0; i < num_events; ++i) {
+            const int fd = events[i].data.fd;
+            if(fd == wakeup_fd) {
+                uint64_t wakeups;
+                [[maybe_unused]] ssize_t ignored = ::read(wakeup_fd, &wakeups, sizeof(wakeups));
+                continue;
+            }
+            auto op_iter = active_operations.find(fd);
+            if(op_iter == active_operations.end()) {
+                accept_connections(fd);
+                continue;
+            }
+            try {
+                if(make_progress(op_iter->second)) {
+                    finish_operation(op_iter);
+                }
+            } catch(socket_error& ex) {
+                fail_operation(op_iter, ex);
+            }
+        }
+        expire_operations();
+    }
+    //Close any sockets that were still in use
+    active_operations.clear();
+    std::lock_guard<std::mutex> lock(submitted_mutex);
+    submitted_operations.clear();
+}
+
+void event_loop::start_submitted_operations() {
+    std::list<operation> new_operations;
+    {
+        std::lock_guard<std::mutex> lock(submitted_mutex);
+        new_operations.swap(submitted_operations);
+    }
+    for(operation& op : new_operations) {
+        const int fd = op.sock.sock;
+        if(fd < 0) {
+            //Can't wait on a closed socket; report the error right away
+            socket_closed_error error("event_loop: operation submitted on a closed socket");
+            op.on_error(std::move(op.sock), error);
+            continue;
+        }
+        set_nonblocking(fd, true);
+        struct epoll_event op_event;
+        memset(&op_event, 0, sizeof(op_event));
+        op_event.data.fd = fd;
+        op_event.events = op.is_write ? EPOLLOUT : EPOLLIN;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &op_event);
+        active_operations.emplace(fd, std::move(op));
+    }
+}
+
+void event_loop::accept_connections(int listener_fd) {
+    accept_handler on_accept;
+    {
+        std::lock_guard<std::mutex> lock(submitted_mutex);
+        auto listener_iter = listeners.find(listener_fd);
+        if(listener_iter == listeners.end()) {
+            return;
+        }
+        on_accept = listener_iter->second;
+    }
+    while(true) {
+        struct sockaddr_storage client_addr_info;
+        socklen_t len = sizeof client_addr_info;
+        //Sockets returned by accept() do not inherit O_NONBLOCK from the listener
+        int client_sock = ::accept(listener_fd, (struct sockaddr*)&client_addr_info, &len);
+        if(client_sock < 0) {
+            //EAGAIN means there are no more pending connections; any other error only affects one connection
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            } else if(errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        on_accept(connection_listener::wrap_client_socket(client_sock, client_addr_info));
+    }
+}
+
+bool event_loop::make_progress(operation& op) {
+    const int fd = op.sock.sock;
+    if(!op.is_write) {
+        while(op.bytes_done < op.read_buffer.size()) {
+            ssize_t new_bytes = ::read(fd, op.read_buffer.data() + op.bytes_done,
+                                       op.read_buffer.size() - op.bytes_done);
+            if(new_bytes > 0) {
+                op.bytes_done += new_bytes;
+            } else if(new_bytes == 0) {
+                throw incomplete_read_error("Read EOF prematurely");
+            } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                return false;
+            } else if(errno != EINTR) {
+                throw socket_io_error(errno, "Read failed due to an error in socket connected to " + op.sock.remote_ip);
+            }
+        }
+        return true;
+    }
+    //Skip past the buffers that have already been sent, then gather the rest into one sendmsg
+    std::size_t bytes_to_skip = op.bytes_done;
+    std::vector<struct iovec> remaining;
+    for(std::vector<uint8_t>& buffer : op.write_buffers) {
+        if(bytes_to_skip >= buffer.size()) {
+            bytes_to_skip -= buffer.size();
+            continue;
+        }
+        remaining.push_back({buffer.data() + bytes_to_skip, buffer.size() - bytes_to_skip});
+        bytes_to_skip = 0;
+        if(remaining.size() == IOV_MAX) {
+            break;
+        }
+    }
+    while(!remaining.empty()) {
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = remaining.data();
+        message.msg_iovlen = remaining.size();
+        ssize_t bytes_written = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if(bytes_written >= 0) {
+            op.bytes_done += bytes_written;
+            //Drop the fully-sent iovecs and advance the first partially-sent one
+            std::size_t bytes_left = bytes_written;
+            auto first_unsent = remaining.begin();
+            while(first_unsent != remaining.end() && bytes_left >= first_unsent->iov_len) {
+                bytes_left -= first_unsent->iov_len;
+                ++first_unsent;
+            }
+            remaining.erase(remaining.begin(), first_unsent);
+            if(bytes_left > 0) {
+                remaining.front().iov_base = static_cast<uint8_t*>(remaining.front().iov_base) + bytes_left;
+                remaining.front().iov_len -= bytes_left;
+            }
+        } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+            return false;
+        } else if(errno == ECONNRESET) {
+            throw connection_reset_error("event_loop: Connection reset on socket to " + op.sock.remote_ip);
+        } else if(errno == EPIPE) {
+            throw remote_closed_connection_error("event_loop: Socket closed by remote at " + op.sock.remote_ip);
+        } else if(errno != EINTR) {
+            throw socket_io_error(errno, "event_loop: Unexpected error in socket connected to " + op.sock.remote_ip);
+        }
+    }
+    //There may be more than IOV_MAX buffers, in which case this is not done yet
+    std::size_t total_bytes = 0;
+    for(const std::vector<uint8_t>& buffer : op.write_buffers) {
+        total_bytes += buffer.size();
+    }
+    return op.bytes_done == total_bytes;
+}
+
+void event_loop::finish_operation(std::map<int, operation>::iterator op_iter) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, op_iter->first, nullptr);
+    set_nonblocking(op_iter->first, false);
+    operation op = std::move(op_iter->second);
+    active_operations.erase(op_iter);
+    if(op.is_write) {
+        op.on_write(std::move(op.sock));
+    } else {
+        op.on_read(std::move(op.sock), std::move(op.read_buffer));
+    }
+}
+
+void event_loop::fail_operation(std::map<int, operation>::iterator op_iter, const socket_error& error) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, op_iter->first, nullptr);
+    set_nonblocking(op_iter->first, false);
+    operation op = std::move(op_iter->second);
+    active_operations.erase(op_iter);
+    op.on_error(std::move(op.sock), error);
+}
+
+void event_loop::expire_operations() {
+    const auto now = std::chrono::steady_clock::now();
+    for(auto op_iter = active_operations.begin(); op_iter != active_operations.end();) {
+        auto next_iter = std::next(op_iter);
+        if(op_iter->second.has_deadline && op_iter->second.deadline <= now) {
+            fail_operation(op_iter, socket_timeout_error("event_loop: Timed out waiting for socket connected to "
+                                                         + op_iter->second.sock.remote_ip));
+        }
+        op_iter = next_iter;
+    }
+}
+
+int event_loop::time_to_next_deadline() const {
+    int timeout_ms = -1;
+    const auto now = std::chrono::steady_clock::now();
+    for(const auto& fd_and_op : active_operations) {
+        if(!fd_and_op.second.has_deadline) {
+            continue;
+        }
+        //Round up, so the loop doesn't wake up just before the deadline and spin
+        auto time_left = std::chrono::ceil<std::chrono::milliseconds>(fd_and_op.second.deadline - now);
+        int time_left_ms = std::max<int>(time_left.count(), 0);
+        if(timeout_ms < 0 || time_left_ms < timeout_ms) {
+            timeout_ms = time_left_ms;
+        }
+    }
+    return timeout_ms;
+}
+
+}  // namespace tcp
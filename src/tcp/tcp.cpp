@@ -4,6 +4,7 @@
 #include <arpa/inet.h>
 #include <cassert>
 #include <cerrno>
+#include <climits>
 #include <cstring>
 #include <fcntl.h>
 #include <iostream>
@@ -12,7 +13,9 @@
 #include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <unistd.h>
+#include <vector>
 
 namespace tcp {
 
@@ -148,6 +151,16 @@ int socket::try_connect(std::string servername, uint16_t port, int timeout_ms) {
     return return_code;
 }
 
+void socket::set_timeout(int timeout_ms) {
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    if(setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0
+       || setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) != 0) {
+        throw socket_io_error(errno, "Failed to set the timeout on socket connected to " + remote_ip);
+    }
+}
+
 void socket::read(uint8_t* buffer, size_t size) {
     if(sock < 0) {
         throw socket_closed_error("Attempted to read from closed socket");
@@ -160,6 +173,8 @@ void socket::read(uint8_t* buffer, size_t size) {
             total_bytes += new_bytes;
         } else if(new_bytes == 0) {
             throw incomplete_read_error("Read EOF prematurely");
+        } else if(new_bytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            throw socket_timeout_error("Read timed out on socket connected to " + remote_ip);
         } else if(new_bytes == -1 && errno != EINTR) {
             throw socket_io_error(errno, "Read failed due to an error in socket connected to " + remote_ip);
         }
@@ -196,6 +211,8 @@ void socket::write(const uint8_t* buffer, size_t size) {
             throw connection_reset_error("socket::write: Connection reset on socket to " + remote_ip);
         } else if(bytes_written == -1 && errno == EPIPE) {
             throw remote_closed_connection_error("socket::write: Socket closed by remote at " + remote_ip);
+        } else if(bytes_written == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            throw socket_timeout_error("socket::write: Write timed out on socket connected to " + remote_ip);
         } else if(bytes_written == -1 && errno != EINTR) {
             std::cerr << "socket::write: Error in the socket! Errno " << errno << std::endl;
             throw socket_io_error(errno, "socket::write: Unexpected error in socket connected to " + remote_ip);
@@ -203,6 +220,42 @@ void socket::write(const uint8_t* buffer, size_t size) {
     }
 }
 
+void socket::writev(const struct iovec* buffers, int count) {
+    if(sock < 0) {
+        throw socket_closed_error("Attempted to write to closed socket");
+    }
+    //Copy the iovecs so they can be advanced past the bytes already sent after a partial write
+    std::vector<struct iovec> remaining(buffers, buffers + count);
+    std::size_t first_buffer = 0;
+    while(first_buffer < remaining.size()) {
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = remaining.data() + first_buffer;
+        message.msg_iovlen = std::min<std::size_t>(remaining.size() - first_buffer, IOV_MAX);
+        //sendmsg is used instead of ::writev so that MSG_NOSIGNAL can be set, as in write()
+        ssize_t bytes_written = sendmsg(sock, &message, MSG_NOSIGNAL);
+        if(bytes_written >= 0) {
+            std::size_t bytes_left = bytes_written;
+            while(first_buffer < remaining.size() && bytes_left >= remaining[first_buffer].iov_len) {
+                bytes_left -= remaining[first_buffer].iov_len;
+                ++first_buffer;
+            }
+            if(bytes_left > 0) {
+                remaining[first_buffer].iov_base = static_cast<uint8_t*>(remaining[first_buffer].iov_base) + bytes_left;
+                remaining[first_buffer].iov_len -= bytes_left;
+            }
+        } else if(errno == ECONNRESET) {
+            throw connection_reset_error("socket::writev: Connection reset on socket to " + remote_ip);
+        } else if(errno == EPIPE) {
+            throw remote_closed_connection_error("socket::writev: Socket closed by remote at " + remote_ip);
+        } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+            throw socket_timeout_error("socket::writev: Write timed out on socket connected to " + remote_ip);
+        } else if(errno != EINTR) {
+            throw socket_io_error(errno, "socket::writev: Unexpected error in socket connected to " + remote_ip);
+        }
+    }
+}
+
 std::string socket::get_self_ip() const {
     struct sockaddr_storage my_addr_info;
     socklen_t len = sizeof my_addr_info;
@@ -255,29 +308,32 @@ connection_listener::connection_listener(uint16_t port, int queue_depth) : port(
             new int(listenfd), [](int* fd) { close(*fd); delete fd; });
 }
 
-socket connection_listener::accept() {
+socket connection_listener::wrap_client_socket(int client_sock, const struct sockaddr_storage& client_addr_info) {
     char client_ip_cstr[INET6_ADDRSTRLEN + 1];
-    struct sockaddr_storage client_addr_info;
-    socklen_t len = sizeof client_addr_info;
-
-    int sock = ::accept(*fd, (struct sockaddr*)&client_addr_info, &len);
-    if(sock < 0) throw connection_failure("connection_listener: accept() failed");
-
     uint16_t client_port;
     if(client_addr_info.ss_family == AF_INET) {
         // Client has an IPv4 address
-        struct sockaddr_in* s = (struct sockaddr_in*)&client_addr_info;
+        const struct sockaddr_in* s = (const struct sockaddr_in*)&client_addr_info;
         inet_ntop(AF_INET, &s->sin_addr, client_ip_cstr, sizeof client_ip_cstr);
         client_port = ntohs(s->sin_port);
     } else {  // AF_INET6
         // Client has an IPv6 address
-        struct sockaddr_in6* s = (struct sockaddr_in6*)&client_addr_info;
+        const struct sockaddr_in6* s = (const struct sockaddr_in6*)&client_addr_info;
         inet_ntop(AF_INET6, &s->sin6_addr, client_ip_cstr,
                   sizeof client_ip_cstr);
         client_port = ntohs(s->sin6_port);
     }
+    return socket(client_sock, std::string(client_ip_cstr), client_port);
+}
+
+socket connection_listener::accept() {
+    struct sockaddr_storage client_addr_info;
+    socklen_t len = sizeof client_addr_info;
 
-    return socket(sock, std::string(client_ip_cstr), client_port);
+    int sock = ::accept(*fd, (struct sockaddr*)&client_addr_info, &len);
+    if(sock < 0) throw connection_failure("connection_listener: accept() failed");
+
+    return wrap_client_socket(sock, client_addr_info);
 }
 
 std::optional<socket> connection_listener::try_accept(int timeout_ms) noexcept {
@@ -319,21 +375,7 @@ std::optional<socket> connection_listener::try_accept(int timeout_ms) noexcept {
     }
 
     if(success) {
-        char client_ip_cstr[INET6_ADDRSTRLEN + 1];
-        uint16_t client_port;
-        if(client_addr_info.ss_family == AF_INET) {
-            // Client has an IPv4 address
-            struct sockaddr_in* s = (struct sockaddr_in*)&client_addr_info;
-            inet_ntop(AF_INET, &s->sin_addr, client_ip_cstr, sizeof client_ip_cstr);
-            client_port = ntohs(s->sin_port);
-        } else {  // AF_INET6
-            // Client has an IPv6 address
-            struct sockaddr_in6* s = (struct sockaddr_in6*)&client_addr_info;
-            inet_ntop(AF_INET6, &s->sin6_addr, client_ip_cstr,
-                      sizeof client_ip_cstr);
-            client_port = ntohs(s->sin6_port);
-        }
-        return socket(client_sock, std::string(client_ip_cstr), client_port);
+        return wrap_client_socket(client_sock, client_addr_info);
     } else {
         return std::nullopt;
     }
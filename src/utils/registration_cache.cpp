@@ -0,0 +1,238 @@
+#include <derecho/utils/registration_cache.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <dlfcn.h>
+#include <set>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace derecho {
+
+/**
+ * Nonzero while this thread is inside the unmap hook or holds a cache's lock.
+ * Any memory unmapped then belongs to an allocator or to libfabric, never to
+ * a cached registration, and invalidating would deadlock on the locks held.
+ */
+static thread_local int hook_suppression_depth = 0;
+
+struct hook_suppression {
+    hook_suppression() { ++hook_suppression_depth; }
+    ~hook_suppression() { --hook_suppression_depth; }
+};
+
+/** The live caches. Never destroyed, since memory can be unmapped during static destruction. */
+static std::mutex& cache_set_mutex() {
+    static std::mutex* mutex = new std::mutex;
+    return *mutex;
+}
+static std::set<registration_cache*>& cache_set() {
+    static std::set<registration_cache*>* caches = new std::set<registration_cache*>;
+    return *caches;
+}
+/** Lets the hooks skip the lock entirely when there are no caches */
+static std::atomic<std::size_t> num_caches{0};
+/** Counts the calls to the hooks that reached the caches */
+static std::atomic<uint64_t> unmap_epoch{0};
+
+static void invalidate_registrations(const void* addr, std::size_t length) {
+    if(num_caches.load(std::memory_order_acquire) == 0 || hook_suppression_depth > 0) {
+        return;
+    }
+    hook_suppression suppression;
+    unmap_epoch++;
+    std::lock_guard<std::mutex> lock(cache_set_mutex());
+    for(registration_cache* cache : cache_set()) {
+        cache->invalidate(addr, length);
+    }
+}
+
+registration_cache::registration_cache(std::size_t max_entries, register_function_t register_function)
+        : max_entries(max_entries),
+          register_function(std::move(register_function)),
+          max_range_length(0) {
+    std::lock_guard<std::mutex> lock(cache_set_mutex());
+    cache_set().insert(this);
+    num_caches++;
+}
+
+registration_cache::~registration_cache() {
+    {
+        std::lock_guard<std::mutex> lock(cache_set_mutex());
+        cache_set().erase(this);
+        num_caches--;
+    }
+    clear();
+}
+
+registration_cache::index_t::iterator registration_cache::find_covering(uintptr_t start, uintptr_t end) {
+    // Only entries that start at or before start can cover it, and none of
+    // them starts further back than the longest range
+    auto it = index.upper_bound({start, UINTPTR_MAX});
+    while(it != index.begin()) {
+        --it;
+        if(start - it->first.first > max_range_length) {
+            break;
+        }
+        if(it->first.second >= end) {
+            return it;
+        }
+    }
+    return index.end();
+}
+
+void registration_cache::remove(index_t::iterator entry_it, std::list<registration_t>& released) {
+    released.emplace_back(std::move(entry_it->second.registration));
+    lru_list.erase(entry_it->second.lru_position);
+    index.erase(entry_it);
+}
+
+void registration_cache::evict(std::list<registration_t>& released) {
+    auto lru_it = lru_list.end();
+    while(index.size() > max_entries && lru_it != lru_list.begin()) {
+        --lru_it;
+        index_t::iterator entry_it = *lru_it;
+        // Anyone else holding the registration is still using it
+        if(entry_it->second.registration.use_count() == 1) {
+            ++lru_it;
+            remove(entry_it, released);
+            stats.evictions++;
+        }
+    }
+}
+
+registration_cache::registration_t registration_cache::acquire(void* addr, std::size_t length) {
+    const uintptr_t start = reinterpret_cast<uintptr_t>(addr);
+    const uintptr_t end = start + std::max(length, std::size_t{1});
+    uint64_t epoch;
+    {
+        hook_suppression suppression;
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto entry_it = find_covering(start, end);
+        if(entry_it != index.end()) {
+            stats.hits++;
+            lru_list.splice(lru_list.begin(), lru_list, entry_it->second.lru_position);
+            return entry_it->second.registration;
+        }
+        stats.misses++;
+        epoch = unmap_epoch;
+    }
+    // Register whole pages, so other buffers on the same pages hit. The
+    // registration happens without the lock, since it can take a while and
+    // may unmap memory of its own.
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const uintptr_t page_start = start & ~(page_size - 1);
+    const uintptr_t page_end = (end + page_size - 1) & ~(page_size - 1);
+    registration_t registration = register_function(reinterpret_cast<void*>(page_start), page_end - page_start);
+
+    std::list<registration_t> released;
+    hook_suppression suppression;
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if(unmap_epoch != epoch) {
+        // The pages may have been unmapped while they were being registered,
+        // and the invalidation would have missed this registration
+        return registration;
+    }
+    auto [entry_it, inserted] = index.try_emplace({page_start, page_end});
+    if(!inserted) {
+        // Another thread registered the same pages first
+        released.emplace_back(std::move(registration));
+        lru_list.splice(lru_list.begin(), lru_list, entry_it->second.lru_position);
+        return entry_it->second.registration;
+    }
+    entry_it->second.registration = registration;
+    lru_list.push_front(entry_it);
+    entry_it->second.lru_position = lru_list.begin();
+    max_range_length = std::max(max_range_length, page_end - page_start);
+    evict(released);
+    return registration;
+}
+
+void registration_cache::invalidate(const void* addr, std::size_t length) {
+    const uintptr_t start = reinterpret_cast<uintptr_t>(addr);
+    const uintptr_t end = start + length;
+    std::list<registration_t> released;
+    {
+        hook_suppression suppression;
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        const uintptr_t search_start = start > max_range_length ? start - max_range_length : 0;
+        auto entry_it = index.lower_bound({search_start, 0});
+        while(entry_it != index.end() && entry_it->first.first < end) {
+            auto next_it = std::next(entry_it);
+            if(entry_it->first.second > start) {
+                remove(entry_it, released);
+                stats.invalidations++;
+            }
+            entry_it = next_it;
+        }
+    }
+    // Deregistering may unmap memory, which must not find this thread holding the lock
+    hook_suppression suppression;
+    released.clear();
+}
+
+void registration_cache::clear() {
+    std::list<registration_t> released;
+    {
+        hook_suppression suppression;
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        while(!index.empty()) {
+            remove(index.begin(), released);
+        }
+    }
+}
+
+registration_cache::statistics registration_cache::get_statistics() const {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return stats;
+}
+
+}  // namespace derecho
+
+/*
+ * The hooks that remove registrations of memory that is about to be unmapped.
+ * They take the place of the C library's munmap and mremap for the whole
+ * process, and pass each call on to the next definition in the lookup order.
+ */
+
+extern "C" int munmap(void* addr, size_t length) noexcept {
+    using munmap_function_t = int (*)(void*, size_t);
+    static std::atomic<munmap_function_t> next_munmap{nullptr};
+    derecho::invalidate_registrations(addr, length);
+    munmap_function_t next = next_munmap.load(std::memory_order_relaxed);
+    if(!next) {
+        next = reinterpret_cast<munmap_function_t>(dlsym(RTLD_NEXT, "munmap"));
+        if(!next) {
+            return syscall(SYS_munmap, addr, length);
+        }
+        next_munmap.store(next, std::memory_order_relaxed);
+    }
+    return next(addr, length);
+}
+
+extern "C" void* mremap(void* old_address, size_t old_size, size_t new_size, int flags, ...) noexcept {
+    using mremap_function_t = void* (*)(void*, size_t, size_t, int, ...);
+    static std::atomic<mremap_function_t> next_mremap{nullptr};
+    void* new_address = nullptr;
+    if(flags & MREMAP_FIXED) {
+        va_list args;
+        va_start(args, flags);
+        new_address = va_arg(args, void*);
+        va_end(args);
+        // Whatever was mapped at the new address is replaced
+        derecho::invalidate_registrations(new_address, new_size);
+    }
+    // The mapping may move, or shrink; either way, its pages may change
+    derecho::invalidate_registrations(old_address, old_size);
+    mremap_function_t next = next_mremap.load(std::memory_order_relaxed);
+    if(!next) {
+        next = reinterpret_cast<mremap_function_t>(dlsym(RTLD_NEXT, "mremap"));
+        if(!next) {
+            return reinterpret_cast<void*>(syscall(SYS_mremap, old_address, old_size, new_size, flags, new_address));
+        }
+        next_mremap.store(next, std::memory_order_relaxed);
+    }
+    return next(old_address, old_size, new_size, flags, new_address);
+}